@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CaptureSource.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Median wall time of `runs` calls of fn(), in milliseconds, after one
+// untimed warm-up call.
+template <typename Fn>
+double medianMs(std::size_t runs, Fn&& fn)
+{
+    fn();
+    std::vector<double> times;
+    times.reserve(runs);
+    for (std::size_t i = 0; i < runs; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Bytes per millisecond to GB/s.
+inline double gigabytesPerSecond(double bytes, double ms)
+{
+    return ms > 0.0 ? bytes / ms / 1.0e6 : 0.0;
+}
+
+// Frames recorded from a capture source into memory, so a stage can be timed
+// over the same sequence repeatedly without paying for the source.
+struct CapturedClip {
+    std::vector<CaptureSource::Frame> frames;
+    std::vector<std::vector<std::uint8_t>> buffers;
+};
+
+// Records up to `count` frames, or whatever `source` delivers in 30 seconds.
+inline CapturedClip captureClip(CaptureSource& source, std::size_t count)
+{
+    CapturedClip clip;
+    clip.frames.reserve(count);
+    clip.buffers.reserve(count);
+    std::atomic<bool> full{false};
+    source.start(
+        [&](const CaptureSource::Frame& frame) {
+            if (full.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            clip.buffers.emplace_back(frame.data, frame.data + frame.dataSize);
+            clip.frames.push_back(frame);
+            if (clip.frames.size() == count)
+            {
+                full.store(true, std::memory_order_release);
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!full.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    source.stop();
+    for (std::size_t i = 0; i < clip.frames.size(); ++i)
+    {
+        clip.frames[i].data = clip.buffers[i].data();
+    }
+    return clip;
+}
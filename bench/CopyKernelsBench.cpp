@@ -0,0 +1,57 @@
+#include "BenchSupport.hpp"
+#include "CopyKernels.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Row copies of whole frames into a destination with the renderer's 256-byte
+// aligned row pitch, far larger than the cache like an upload heap mapping.
+// Each streaming tier against plain memcpy.
+int main()
+{
+    struct Case {
+        std::uint32_t width;
+        std::uint32_t height;
+        const char* name;
+    };
+    const Case cases[] = {{1920, 1080, "1080p"}, {2560, 1440, "1440p"}, {3840, 2160, "4K"}, {1366, 768, "1366x768"}};
+    const CopyKernelTier tiers[] = {CopyKernelTier::Memcpy, CopyKernelTier::SSE2, CopyKernelTier::AVX2, CopyKernelTier::AVX512};
+
+    std::printf("%-9s %6s", "frame", "pitch");
+    for (const CopyKernelTier tier : tiers)
+    {
+        std::printf(" %9s", copyKernelTierName(tier));
+    }
+    std::printf("   (GB/s)\n");
+
+    for (const Case& c : cases)
+    {
+        const std::size_t rowBytes = static_cast<std::size_t>(c.width) * 4;
+        const std::size_t pitch = (rowBytes + 255) / 256 * 256;
+        std::vector<std::uint8_t> source(rowBytes * c.height, 1);
+        std::vector<std::uint8_t> destination(pitch * c.height, 0);
+
+        std::printf("%-9s %6zu", c.name, pitch);
+        for (const CopyKernelTier tier : tiers)
+        {
+            const RowCopyFn kernel = copyKernelFor(tier);
+            if (!kernel)
+            {
+                std::printf(" %9s", "-");
+                continue;
+            }
+            const double ms = medianMs(30, [&]() {
+                for (std::uint32_t y = 0; y < c.height; ++y)
+                {
+                    kernel(destination.data() + y * pitch, source.data() + (c.height - 1 - y) * rowBytes, rowBytes);
+                }
+                streamCopyFence();
+            });
+            std::printf(" %9.1f", gigabytesPerSecond(static_cast<double>(source.size()), ms));
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "BenchSupport.hpp"
+#include "DirtyTracker.hpp"
+#include "FileReplayCapture.hpp"
+#include "MemoryFrameSink.hpp"
+#include "TestPatternCapture.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Tile hashing and rectangle merging over a recorded sequence, and how much
+// of the full-frame copy the tracked writes leave.
+void runClip(const std::string& label, const CapturedClip& clip)
+{
+    if (clip.frames.empty())
+    {
+        std::printf("%-28s no frames\n", label.c_str());
+        return;
+    }
+
+    DirtyTracker tracker;
+    const double analyzeMs = medianMs(5, [&]() {
+        for (const auto& frame : clip.frames)
+        {
+            tracker.analyze(frame);
+        }
+    }) / static_cast<double>(clip.frames.size());
+
+    std::size_t rects = 0;
+    DirtyTracker::TileMask mask;
+    std::vector<DirtyRect> scratch;
+    scratch.reserve(DirtyTracker::kMaxRects);
+    DirtyTracker rectTracker;
+    std::vector<std::uint64_t> sequences;
+    for (const auto& frame : clip.frames)
+    {
+        sequences.push_back(rectTracker.analyze(frame));
+    }
+    const std::size_t history = std::min<std::size_t>(sequences.size(), DirtyTracker::kHistory);
+    const double rectsUs = medianMs(5, [&]() {
+        rects = 0;
+        for (std::size_t i = sequences.size() - history + 1; i < sequences.size(); ++i)
+        {
+            if (rectTracker.collectSince(sequences[i - 1], sequences[i], mask))
+            {
+                DirtyTracker::buildRects(mask, clip.frames[i].width, clip.frames[i].height, scratch);
+                rects += scratch.size();
+            }
+        }
+    }) * 1000.0 / static_cast<double>(history > 1 ? history - 1 : 1);
+
+    FramePool pool;
+    MemoryFrameSink tracked(pool);
+    MemoryFrameSink full(pool);
+    DirtyTracker copyTracker;
+    for (const auto& frame : clip.frames)
+    {
+        FrameWriteOptions options;
+        options.tracker = &copyTracker;
+        options.sequence = copyTracker.analyze(frame);
+        writeFrameToSink(frame, tracked, options);
+        writeFrameToSink(frame, full);
+        (void)tracked.acquireLatest();
+        (void)full.acquireLatest();
+    }
+
+    const auto& first = clip.frames.front();
+    const double frameBytes = static_cast<double>(frameSourceStride(first)) * first.height;
+    std::printf("%-28s %9.3f %8.2f %8.2f %9.1f%%\n",
+                label.c_str(),
+                analyzeMs,
+                gigabytesPerSecond(frameBytes, analyzeMs),
+                rectsUs,
+                full.bytesCopied() ? 100.0 * static_cast<double>(tracked.bytesCopied()) / static_cast<double>(full.bytesCopied()) : 0.0);
+}
+
+} // namespace
+
+// Usage: DirtyTrackerBench [file.y4m | file.bgra WxH]
+// Without arguments the sequences come from TestPatternCapture; with a file
+// they are replayed from it as well.
+int main(int argc, char** argv)
+{
+    std::printf("%-28s %9s %8s %8s %10s\n", "sequence", "hash ms", "GB/s", "rects us", "copied");
+
+    const std::pair<std::uint32_t, std::uint32_t> sizes[] = {{1920, 1080}, {3840, 2160}};
+    const TestPatternCapture::Motion motions[] = {TestPatternCapture::Motion::Static, TestPatternCapture::Motion::MovingBox,
+                                                  TestPatternCapture::Motion::ScrollingBars, TestPatternCapture::Motion::Noise};
+    for (const auto& [width, height] : sizes)
+    {
+        for (const auto motion : motions)
+        {
+            TestPatternCapture::Config config;
+            config.width = width;
+            config.height = height;
+            config.motion = motion;
+            config.paced = false;
+            TestPatternCapture source(config);
+            const CapturedClip clip = captureClip(source, 30);
+            runClip(std::to_string(width) + "x" + std::to_string(height) + " " + TestPatternCapture::motionName(motion), clip);
+        }
+    }
+
+    if (argc > 1)
+    {
+        FileReplayCapture::Config config;
+        config.path = argv[1];
+        config.paced = false;
+        config.loop = false;
+        if (argc > 2 && std::sscanf(argv[2], "%ux%u", &config.width, &config.height) != 2)
+        {
+            std::fprintf(stderr, "frame size must be WxH\n");
+            return 1;
+        }
+        FileReplayCapture source(config);
+        const CapturedClip clip = captureClip(source, 300);
+        runClip(argv[1], clip);
+    }
+    return 0;
+}
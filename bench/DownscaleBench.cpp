@@ -0,0 +1,95 @@
+#include "BenchSupport.hpp"
+#include "Downscale.hpp"
+#include "MemoryFrameSink.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestPatternCapture.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr DownscaleTier kTiers[] = {DownscaleTier::Scalar, DownscaleTier::SSE2, DownscaleTier::AVX2};
+
+struct Case {
+    std::uint32_t sourceWidth;
+    std::uint32_t sourceHeight;
+    std::uint32_t outputWidth;
+    std::uint32_t outputHeight;
+    const char* name;
+};
+
+// The box filters, and the general path at 1.5:1 and 3:1.
+constexpr Case kCases[] = {
+    {3840, 2160, 1920, 1080, "4K -> 1080p"},
+    {3840, 2160, 960, 540, "4K -> 540p"},
+    {3840, 2160, 2560, 1440, "4K -> 1440p"},
+    {3840, 2160, 1280, 720, "4K -> 720p"},
+    {1920, 1080, 1280, 720, "1080p -> 720p"},
+};
+
+} // namespace
+
+// Downscales a test pattern frame per tier on one thread, then through
+// writeFrameToSink() on every core, against copying the frame unscaled.
+int main()
+{
+    StripeWorkerPool workers;
+
+    std::printf("%-16s", "");
+    for (const DownscaleTier tier : kTiers)
+    {
+        std::printf(" %10s ms %8s", downscaleTierName(tier), "Mpix/s");
+    }
+    std::printf(" %10s ms %10s ms\n", "striped", "copy");
+
+    for (const Case& c : kCases)
+    {
+        TestPatternCapture::Config config;
+        config.width = c.sourceWidth;
+        config.height = c.sourceHeight;
+        config.motion = TestPatternCapture::Motion::Noise;
+        config.paced = false;
+        TestPatternCapture capture(config);
+        CapturedClip clip = captureClip(capture, 1);
+        if (clip.frames.empty())
+        {
+            return 1;
+        }
+        const DirectShowCapture::Frame& frame = clip.frames.front();
+
+        const AreaScaler scaler(c.sourceWidth, c.sourceHeight, c.outputWidth, c.outputHeight);
+        const DirtyRect whole{0, 0, c.outputWidth, c.outputHeight};
+        std::vector<std::uint8_t> output(static_cast<std::size_t>(c.outputWidth) * 4 * c.outputHeight);
+        DownscaleScratch scratch;
+        const AreaScaler::SourceRowFn sourceRow = [&frame](std::uint32_t row, std::uint32_t firstColumn, std::uint32_t, std::uint8_t*) {
+            return frame.data + frameSourceRowOffset(frame, row) + static_cast<std::size_t>(firstColumn) * 4;
+        };
+
+        std::printf("  %-14s", c.name);
+        for (const DownscaleTier tier : kTiers)
+        {
+            if (!downscaleKernels(tier))
+            {
+                std::printf(" %13s %8s", "-", "-");
+                continue;
+            }
+            const double ms = medianMs(15, [&]() {
+                (void)scaler.scaleRegionWith(tier, output.data(), static_cast<std::size_t>(c.outputWidth) * 4, whole, 1, sourceRow, scratch);
+            });
+            std::printf(" %13.3f %8.0f", ms, static_cast<double>(c.sourceWidth) * c.sourceHeight / ms / 1000.0);
+        }
+
+        FramePool pool;
+        MemoryFrameSink sink(pool);
+        FrameWriteOptions options;
+        options.workers = &workers;
+        options.scaler = &scaler;
+        const double striped = medianMs(15, [&]() { (void)writeFrameToSink(frame, sink, options); });
+        options.scaler = nullptr;
+        const double copy = medianMs(15, [&]() { (void)writeFrameToSink(frame, sink, options); });
+        std::printf(" %13.3f %13.3f\n", striped, copy);
+    }
+    return 0;
+}
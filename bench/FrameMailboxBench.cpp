@@ -0,0 +1,81 @@
+#include "BenchSupport.hpp"
+#include "FrameMailbox.hpp"
+#include "LatencyStats.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BenchSlot {
+    std::uint64_t publishedNs = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+// A synthetic producer fills and publishes frames of `frameBytes` while the
+// consumer takes the newest one in a loop, as the render thread does.
+// Reports producer throughput, publish cost and publish-to-acquire latency.
+void runCase(const char* label, std::size_t frameBytes, std::uint64_t frames)
+{
+    FrameMailbox<BenchSlot> mailbox;
+    mailbox.forEachSlot([&](BenchSlot& slot) { slot.pixels.assign(frameBytes, 0); });
+
+    LatencyHistogram publishCost;
+    LatencyHistogram handoff;
+    std::atomic<bool> done{false};
+
+    std::thread consumer([&]() {
+        for (;;)
+        {
+            const bool finished = done.load(std::memory_order_acquire);
+            if (const BenchSlot* slot = mailbox.acquireLatest())
+            {
+                handoff.record(latencyClockNs() - slot->publishedNs);
+            }
+            else if (finished)
+            {
+                return;
+            }
+        }
+    });
+
+    const std::uint64_t start = latencyClockNs();
+    for (std::uint64_t i = 0; i < frames; ++i)
+    {
+        BenchSlot& slot = mailbox.writeSlot();
+        std::memset(slot.pixels.data(), static_cast<int>(i), slot.pixels.size());
+        const std::uint64_t before = latencyClockNs();
+        slot.publishedNs = before;
+        mailbox.publish();
+        publishCost.record(latencyClockNs() - before);
+    }
+    const double elapsedMs = static_cast<double>(latencyClockNs() - start) / 1.0e6;
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    std::printf("%-8s %10.0f %12.2f %10llu %10llu %10llu %10llu\n",
+                label,
+                static_cast<double>(frames) / (elapsedMs / 1000.0),
+                gigabytesPerSecond(static_cast<double>(frameBytes) * static_cast<double>(frames), elapsedMs),
+                static_cast<unsigned long long>(publishCost.valueAtQuantile(0.99)),
+                static_cast<unsigned long long>(handoff.valueAtQuantile(0.5)),
+                static_cast<unsigned long long>(handoff.valueAtQuantile(0.99)),
+                static_cast<unsigned long long>(mailbox.overwrittenCount()));
+}
+
+} // namespace
+
+int main()
+{
+    std::printf("%-8s %10s %12s %10s %10s %10s %10s\n",
+                "frame", "frames/s", "fill GB/s", "pub p99ns", "hand p50", "hand p99", "replaced");
+    runCase("empty", 0, 2000000);
+    runCase("64KiB", 64u * 1024u, 100000);
+    runCase("1080p", 1920u * 1080u * 4u, 600);
+    runCase("4K", 3840u * 2160u * 4u, 200);
+    return 0;
+}
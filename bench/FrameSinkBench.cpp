@@ -0,0 +1,89 @@
+#include "BenchSupport.hpp"
+#include "FrameSink.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Stands in for the renderer's mapped upload buffer.
+class UploadBufferSink : public FrameSink {
+public:
+    UploadBufferSink(std::uint32_t width, std::uint32_t height)
+        : rowPitch_((width * 4 + 255) / 256 * 256), pixels_(static_cast<std::size_t>(rowPitch_) * height)
+    {
+    }
+
+    bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) override
+    {
+        target.data = pixels_.data();
+        target.rowPitch = rowPitch_;
+        target.width = width;
+        target.height = height;
+        return true;
+    }
+
+    void commitFrame(const DirectShowCapture::Frame&, std::uint64_t) override {}
+
+    [[nodiscard]] std::uint8_t* data() noexcept { return pixels_.data(); }
+    [[nodiscard]] std::uint32_t rowPitch() const noexcept { return rowPitch_; }
+
+private:
+    std::uint32_t rowPitch_;
+    std::vector<std::uint8_t> pixels_;
+};
+
+// The old path: flip the sample into a CPU frame, then copy that into the
+// upload buffer. The new one writes the sample straight into the sink.
+void runCase(const char* label, std::uint32_t width, std::uint32_t height)
+{
+    const std::uint32_t stride = width * 4;
+    std::vector<std::uint8_t> sample(static_cast<std::size_t>(stride) * height);
+    for (std::size_t i = 0; i < sample.size(); ++i)
+    {
+        sample[i] = static_cast<std::uint8_t>(i * 7);
+    }
+
+    DirectShowCapture::Frame frame{};
+    frame.width = width;
+    frame.height = height;
+    frame.stride = stride;
+    frame.data = sample.data();
+    frame.dataSize = sample.size();
+    frame.bottomUp = true;
+
+    UploadBufferSink sink(width, height);
+    std::vector<std::uint8_t> cpuFrame(sample.size());
+    std::size_t legacyBytes = 0;
+    const double legacyMs = medianMs(20, [&]() {
+        for (std::uint32_t y = 0; y < height; ++y)
+        {
+            std::memcpy(cpuFrame.data() + static_cast<std::size_t>(y) * stride,
+                        sample.data() + static_cast<std::size_t>(height - 1 - y) * stride, stride);
+        }
+        for (std::uint32_t y = 0; y < height; ++y)
+        {
+            std::memcpy(sink.data() + static_cast<std::size_t>(y) * sink.rowPitch(),
+                        cpuFrame.data() + static_cast<std::size_t>(y) * stride, stride);
+        }
+        legacyBytes = sample.size() * 2;
+    });
+
+    std::size_t directBytes = 0;
+    const double directMs = medianMs(20, [&]() { directBytes = writeFrameToSink(frame, sink).bytesWritten; });
+
+    std::printf("%-6s %12zu %10.2f %12zu %10.2f\n", label, legacyBytes, legacyMs, directBytes, directMs);
+}
+
+} // namespace
+
+int main()
+{
+    std::printf("%-6s %12s %10s %12s %10s\n", "frame", "legacy B", "legacy ms", "direct B", "direct ms");
+    runCase("1080p", 1920, 1080);
+    runCase("1440p", 2560, 1440);
+    runCase("4K", 3840, 2160);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "BenchSupport.hpp"
+#include "ImageEncoder.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestPatternCapture.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct Case {
+    std::uint32_t width;
+    std::uint32_t height;
+    TestPatternCapture::Motion motion;
+    const char* name;
+};
+
+// The test pattern compresses like a desktop; noise is the worst case.
+constexpr Case kCases[] = {
+    {1920, 1080, TestPatternCapture::Motion::MovingBox, "1080p pattern"},
+    {3840, 2160, TestPatternCapture::Motion::MovingBox, "4K pattern"},
+    {1920, 1080, TestPatternCapture::Motion::Noise, "1080p noise"},
+    {3840, 2160, TestPatternCapture::Motion::Noise, "4K noise"},
+};
+
+} // namespace
+
+// Encode time and size of one screenshot per format, PNG both on one thread
+// and striped over every core as ScreenshotWriter runs it. Sizes are relative
+// to raw RGB.
+int main()
+{
+    StripeWorkerPool workers;
+    std::printf("%-16s %10s %7s %10s %10s %7s   (%zu threads)\n", "", "QOI ms", "size", "PNG ms", "striped ms", "size", workers.concurrency());
+
+    for (const Case& c : kCases)
+    {
+        TestPatternCapture::Config config;
+        config.width = c.width;
+        config.height = c.height;
+        config.motion = c.motion;
+        config.paced = false;
+        TestPatternCapture capture(config);
+        CapturedClip clip = captureClip(capture, 1);
+        if (clip.frames.empty())
+        {
+            return 1;
+        }
+        const CaptureSource::Frame& frame = clip.frames.front();
+        const double raw = static_cast<double>(c.width) * c.height * 3;
+
+        std::vector<std::uint8_t> out;
+        const double qoiMs = medianMs(7, [&]() { encodeQoi(frame.data, frame.stride, c.width, c.height, out); });
+        const double qoiSize = static_cast<double>(out.size()) / raw;
+        const double pngMs = medianMs(5, [&]() { encodePng(frame.data, frame.stride, c.width, c.height, out); });
+        const double stripedMs = medianMs(7, [&]() { encodePng(frame.data, frame.stride, c.width, c.height, out, &workers); });
+        const double pngSize = static_cast<double>(out.size()) / raw;
+        std::printf("  %-14s %10.2f %6.1f%% %10.2f %10.2f %6.1f%%\n", c.name, qoiMs, qoiSize * 100.0, pngMs, stripedMs, pngSize * 100.0);
+    }
+    return 0;
+}
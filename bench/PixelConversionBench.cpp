@@ -0,0 +1,179 @@
+#include "BenchSupport.hpp"
+#include "PixelConversion.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using PixelFormat = CaptureSource::PixelFormat;
+
+constexpr ConversionTier kTiers[] = {ConversionTier::Scalar, ConversionTier::SSSE3, ConversionTier::AVX2};
+
+struct Resolution {
+    std::uint32_t width;
+    std::uint32_t height;
+    const char* name;
+};
+
+constexpr Resolution kResolutions[] = {{1920, 1080, "1080p"}, {3840, 2160, "4K"}};
+
+std::vector<std::uint8_t> noise(std::size_t bytes)
+{
+    std::vector<std::uint8_t> data(bytes);
+    std::uint32_t seed = 1;
+    for (auto& byte : data)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(seed >> 24);
+    }
+    return data;
+}
+
+void printHeader(const char* title)
+{
+    std::printf("\n%-14s", title);
+    for (const ConversionTier tier : kTiers)
+    {
+        std::printf(" %10s ms %8s", conversionTierName(tier), "Mpix/s");
+    }
+    std::printf("\n");
+}
+
+// Converts a whole frame row by row with one tier; prints ms per frame.
+template <typename ConvertFrame>
+void printTier(bool available, const Resolution& resolution, ConvertFrame&& convertFrame)
+{
+    if (!available)
+    {
+        std::printf(" %13s %8s", "-", "-");
+        return;
+    }
+    const double ms = medianMs(15, convertFrame);
+    std::printf(" %13.3f %8.0f", ms, static_cast<double>(resolution.width) * resolution.height / ms / 1000.0);
+}
+
+void benchPacked422()
+{
+    for (const PixelFormat format : {PixelFormat::YUY2, PixelFormat::UYVY})
+    {
+        printHeader(format == PixelFormat::YUY2 ? "YUY2" : "UYVY");
+        const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT709, false);
+        for (const Resolution& resolution : kResolutions)
+        {
+            const std::size_t sourcePitch = pixelFormatRowBytes(format, resolution.width);
+            const std::vector<std::uint8_t> source = noise(sourcePitch * resolution.height);
+            std::vector<std::uint8_t> destination(static_cast<std::size_t>(resolution.width) * 4 * resolution.height);
+            std::printf("  %-12s", resolution.name);
+            for (const ConversionTier tier : kTiers)
+            {
+                const Packed422RowFn kernel = packed422Kernel(format, tier);
+                printTier(kernel != nullptr, resolution, [&]() {
+                    for (std::uint32_t y = 0; y < resolution.height; ++y)
+                    {
+                        kernel(destination.data() + static_cast<std::size_t>(y) * resolution.width * 4, source.data() + y * sourcePitch,
+                               resolution.width, coefficients);
+                    }
+                });
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+void benchSemiPlanar()
+{
+    for (const PixelFormat format : {PixelFormat::NV12, PixelFormat::P010})
+    {
+        const bool tenBit = format == PixelFormat::P010;
+        printHeader(tenBit ? "P010" : "NV12");
+        const YuvCoefficients coefficients =
+            yuvCoefficients(tenBit ? CaptureSource::ColorMatrix::BT2020 : CaptureSource::ColorMatrix::BT709, false);
+        for (const Resolution& resolution : kResolutions)
+        {
+            const std::size_t sourcePitch = pixelFormatRowBytes(format, resolution.width);
+            const std::vector<std::uint8_t> luma = noise(sourcePitch * resolution.height);
+            const std::vector<std::uint8_t> chroma = noise(sourcePitch * resolution.height / 2);
+            std::vector<std::uint8_t> destination(static_cast<std::size_t>(resolution.width) * 4 * resolution.height);
+            std::printf("  %-12s", resolution.name);
+            for (const ConversionTier tier : kTiers)
+            {
+                const SemiPlanarRowFn kernel = semiPlanarKernel(format, tier);
+                printTier(kernel != nullptr, resolution, [&]() {
+                    for (std::uint32_t y = 0; y < resolution.height; ++y)
+                    {
+                        kernel(destination.data() + static_cast<std::size_t>(y) * resolution.width * 4, luma.data() + y * sourcePitch,
+                               chroma.data() + y / 2 * sourcePitch, resolution.width, coefficients);
+                    }
+                });
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+void benchPackedRgb()
+{
+    for (const PixelFormat format : {PixelFormat::RGB24, PixelFormat::RGB565})
+    {
+        const std::size_t pixelBytes = format == PixelFormat::RGB24 ? 3 : 2;
+        printHeader(format == PixelFormat::RGB24 ? "RGB24" : "RGB565");
+        for (const Resolution& resolution : kResolutions)
+        {
+            const std::size_t sourcePitch = (resolution.width * pixelBytes + 3) / 4 * 4;
+            const std::vector<std::uint8_t> source = noise(sourcePitch * resolution.height);
+            std::vector<std::uint8_t> destination(static_cast<std::size_t>(resolution.width) * 4 * resolution.height);
+            std::printf("  %-12s", resolution.name);
+            for (const ConversionTier tier : kTiers)
+            {
+                const PackedRgbRowFn kernel = packedRgbKernel(format, tier);
+                printTier(kernel != nullptr, resolution, [&]() {
+                    for (std::uint32_t y = 0; y < resolution.height; ++y)
+                    {
+                        kernel(destination.data() + static_cast<std::size_t>(y) * resolution.width * 4, source.data() + y * sourcePitch,
+                               resolution.width);
+                    }
+                });
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+void benchV210()
+{
+    printHeader("v210");
+    const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT709, false);
+    for (const Resolution& resolution : kResolutions)
+    {
+        const std::size_t sourcePitch = (resolution.width + 47) / 48 * 128;
+        const std::vector<std::uint8_t> source = noise(sourcePitch * resolution.height);
+        std::vector<std::uint8_t> destination(static_cast<std::size_t>(resolution.width) * 4 * resolution.height);
+        std::printf("  %-12s", resolution.name);
+        for (const ConversionTier tier : kTiers)
+        {
+            const V210RowFn kernel = v210Kernel(tier);
+            printTier(kernel != nullptr, resolution, [&]() {
+                for (std::uint32_t y = 0; y < resolution.height; ++y)
+                {
+                    kernel(destination.data() + static_cast<std::size_t>(y) * resolution.width * 4, source.data() + y * sourcePitch,
+                           resolution.width, coefficients);
+                }
+            });
+        }
+        std::printf("\n");
+    }
+}
+
+} // namespace
+
+// Single-threaded conversion of whole frames to BGRA, per format and tier.
+int main()
+{
+    benchPacked422();
+    benchSemiPlanar();
+    benchPackedRgb();
+    benchV210();
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "PresentPacer.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+
+namespace {
+
+struct Case {
+    double sourceHz;
+    double displayHz;
+    double jitterNs;
+    const char* name;
+};
+
+constexpr Case kCases[] = {
+    {60.0, 60.0, 300'000.0, "60 on 60"},
+    {60.0, 60.0, 2'000'000.0, "60 on 60, 2 ms"},
+    {60000.0 / 1001.0, 60.0, 300'000.0, "59.94 on 60"},
+    {60.0, 60000.0 / 1001.0, 300'000.0, "60 on 59.94"},
+    {30.0, 60.0, 300'000.0, "30 on 60"},
+};
+
+constexpr int kFrames = 6000;
+constexpr double kStepNs = 50'000.0;
+constexpr double kRenderNs = 1'000'000.0;
+// Where frames arrive between two vblanks at matching rates.
+constexpr double kPhaseNs = 5'000'000.0;
+constexpr std::uint64_t kStartNs = 1'000'000'000;
+
+// A repeatable stand-in for capture jitter: a sum of twelve uniforms.
+class Jitter {
+public:
+    explicit Jitter(double sigmaNs) : sigma_(sigmaNs) {}
+
+    double next()
+    {
+        double sum = -6.0;
+        for (int i = 0; i < 12; ++i)
+        {
+            seed_ = seed_ * 1664525u + 1013904223u;
+            sum += static_cast<double>(seed_ >> 8) / static_cast<double>(1u << 24);
+        }
+        return sum * sigma_;
+    }
+
+private:
+    double sigma_;
+    std::uint32_t seed_ = 3;
+};
+
+// Plays `kFrames` of a source into a simulated flip-model swap chain with one
+// frame of latency, presenting each frame as soon as the swap chain has room
+// or, when `paced`, no earlier than presentNotBefore() allows.
+void runCase(const Case& c, bool paced)
+{
+    const double sourcePeriod = 1.0e9 / c.sourceHz;
+    const double refreshPeriod = 1.0e9 / c.displayHz;
+    const auto at = [](double timeNs) { return kStartNs + static_cast<std::uint64_t>(std::llround(timeNs)); };
+
+    PresentPacer pacer;
+    Jitter jitter(c.jitterNs);
+    struct Queued {
+        std::uint32_t id;
+        double readyNs;
+    };
+    std::deque<Queued> queue;
+    std::uint32_t nextPresentId = 1;
+    std::uint32_t shownId = 0;
+    std::uint64_t shownRefresh = 0;
+    std::uint64_t lastVBlank = 0;
+    int arrived = 0;
+    double nextArrival = kPhaseNs + sourcePeriod + jitter.next();
+    bool framePending = false;
+
+    for (double now = 0.0; now < sourcePeriod * (kFrames + 2); now += kStepNs)
+    {
+        for (const auto vblank = static_cast<std::uint64_t>(now / refreshPeriod); lastVBlank < vblank; ++lastVBlank)
+        {
+            const double vblankTime = refreshPeriod * static_cast<double>(lastVBlank + 1);
+            if (!queue.empty() && queue.front().readyNs <= vblankTime)
+            {
+                shownId = queue.front().id;
+                shownRefresh = lastVBlank + 1;
+                queue.pop_front();
+            }
+            pacer.observeDisplay(shownId, shownRefresh, lastVBlank + 1, at(vblankTime));
+        }
+
+        if (arrived < kFrames && now >= nextArrival)
+        {
+            ++arrived;
+            pacer.observeFrame(static_cast<std::uint64_t>(sourcePeriod * arrived / 100.0), at(now));
+            pacer.frameDelivered();
+            framePending = true;
+            nextArrival = kPhaseNs + sourcePeriod * (arrived + 1) + jitter.next();
+        }
+
+        const bool allowed = !paced || pacer.presentNotBefore(at(now)) == 0;
+        if (framePending && queue.empty() && allowed)
+        {
+            const std::uint32_t id = nextPresentId++;
+            pacer.presented(id);
+            queue.push_back({id, now + kRenderNs});
+            framePending = false;
+        }
+    }
+
+    const LatencyHistogram& latency = pacer.scanoutLatency();
+    std::printf(" %7llu %7llu %7.2f %7.2f", static_cast<unsigned long long>(pacer.framesDropped()),
+                static_cast<unsigned long long>(pacer.framesRepeated()), static_cast<double>(latency.valueAtQuantile(0.5)) / 1.0e6,
+                static_cast<double>(latency.valueAtQuantile(0.99)) / 1.0e6);
+}
+
+} // namespace
+
+// Judder and arrival-to-scanout latency of a simulated display, presenting
+// every frame as soon as possible against timing presents with PresentPacer.
+// Drops, and repeats beyond the share of refreshes the two rates give each
+// frame, are the judder.
+int main()
+{
+    std::printf("%-18s %31s   %31s\n", "", "immediate", "paced");
+    std::printf("%-18s", "");
+    for (int i = 0; i < 2; ++i)
+    {
+        std::printf(" %7s %7s %7s %7s", "dropped", "repeat", "p50 ms", "p99 ms");
+        std::printf(i == 0 ? "  " : "\n");
+    }
+    for (const Case& c : kCases)
+    {
+        std::printf("  %-16s", c.name);
+        runCase(c, false);
+        std::printf("  ");
+        runCase(c, true);
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "BenchSupport.hpp"
+#include "ReferenceRenderer.hpp"
+#include "TestPatternCapture.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+struct Case {
+    std::uint32_t sourceWidth;
+    std::uint32_t sourceHeight;
+    std::uint32_t clientWidth;
+    std::uint32_t clientHeight;
+    const char* name;
+};
+
+constexpr Case kCases[] = {
+    {1920, 1080, 1920, 1080, "1080p 1:1"},
+    {1920, 1080, 2560, 1440, "1080p in 1440p"},
+    {3840, 2160, 1920, 1080, "4K in 1080p"},
+    {3840, 2160, 1280, 720, "4K in 720p"},
+};
+
+struct Filter {
+    ScalingFilter filter;
+    const char* name;
+};
+
+constexpr Filter kFilters[] = {
+    {ScalingFilter::Bilinear, "bilinear"}, {ScalingFilter::Nearest, "nearest"}, {ScalingFilter::Bicubic, "bicubic"},
+    {ScalingFilter::Lanczos3, "lanczos3"}, {ScalingFilter::Sharpen, "sharpen"},
+};
+
+} // namespace
+
+// What showing one frame costs on the CPU, from the captured frame to the
+// window image: frame copy or downscale, then the scaling filter. Without a
+// GPU this bounds the reference renderer, not the window itself.
+int main()
+{
+    std::printf("%-18s", "");
+    for (const Filter& filter : kFilters)
+    {
+        std::printf(" %10s ms", filter.name);
+    }
+    std::printf(" %12s ms\n", "no downscale");
+
+    for (const Case& c : kCases)
+    {
+        TestPatternCapture::Config config;
+        config.width = c.sourceWidth;
+        config.height = c.sourceHeight;
+        config.motion = TestPatternCapture::Motion::MovingBox;
+        config.paced = false;
+        TestPatternCapture capture(config);
+        CapturedClip clip = captureClip(capture, 1);
+        if (clip.frames.empty())
+        {
+            return 1;
+        }
+        const DirectShowCapture::Frame& frame = clip.frames.front();
+
+        ReferenceRenderer renderer;
+        std::printf("  %-16s", c.name);
+        ReferenceRenderOptions options;
+        for (const Filter& filter : kFilters)
+        {
+            options.filter = filter.filter;
+            std::printf(" %13.3f", medianMs(9, [&]() { (void)renderer.render(frame, c.clientWidth, c.clientHeight, options); }));
+        }
+        options.filter = ScalingFilter::Bilinear;
+        options.downscale = false;
+        std::printf(" %15.3f\n", medianMs(9, [&]() { (void)renderer.render(frame, c.clientWidth, c.clientHeight, options); }));
+    }
+    return 0;
+}
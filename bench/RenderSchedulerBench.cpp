@@ -0,0 +1,129 @@
+#include "LatencyStats.hpp"
+#include "RenderScheduler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+struct Case {
+    double captureHz;
+    double displayHz;
+    const char* name;
+};
+
+constexpr Case kCases[] = {
+    {30.0, 60.0, "30 fps on 60 Hz"},   {60.0, 60.0, "60 fps on 60 Hz"},    {60.0, 144.0, "60 fps on 144 Hz"},
+    {144.0, 60.0, "144 fps on 60 Hz"}, {1000.0, 60.0, "1000 fps on 60 Hz"},
+};
+
+constexpr std::uint64_t kRunNs = 2'000'000'000;
+
+// A synthetic producer publishes frames at `captureHz` while the render loop
+// waits on the scheduler; each present occupies the swap chain until the next
+// simulated vblank at `displayHz`. Reports publish-to-render latency of the
+// frames that were presented, how many were coalesced away, and how often the
+// render thread woke per second.
+void runCase(const Case& c)
+{
+    ConditionRenderWaitSet waitSet;
+    RenderScheduler scheduler;
+    std::atomic<std::uint64_t> publishedNs{0};
+    std::atomic<std::uint64_t> published{0};
+    std::atomic<bool> done{false};
+
+    const std::uint64_t captureIntervalNs = static_cast<std::uint64_t>(1.0e9 / c.captureHz);
+    const std::uint64_t vblankNs = static_cast<std::uint64_t>(1.0e9 / c.displayHz);
+    const std::uint64_t start = latencyClockNs();
+
+    std::thread producer([&]() {
+        std::uint64_t next = start;
+        while (!done.load(std::memory_order_acquire))
+        {
+            const std::uint64_t now = latencyClockNs();
+            if (now < next)
+            {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+                continue;
+            }
+            next += captureIntervalNs;
+            publishedNs.store(latencyClockNs(), std::memory_order_release);
+            published.fetch_add(1, std::memory_order_relaxed);
+            waitSet.signal(kWakeFrame);
+        }
+    });
+
+    std::atomic<std::uint64_t> presentedAt{0};
+    std::thread display([&]() {
+        std::uint64_t next = start + vblankNs;
+        while (!done.load(std::memory_order_acquire))
+        {
+            const std::uint64_t now = latencyClockNs();
+            if (now < next)
+            {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+                continue;
+            }
+            // The swap chain frees a slot at each vblank after a present.
+            if (presentedAt.exchange(0, std::memory_order_acq_rel) != 0)
+            {
+                waitSet.signal(kWakeSwapChain);
+            }
+            next += vblankNs;
+        }
+    });
+
+    LatencyHistogram latency;
+    std::uint64_t wakes = 0;
+    std::uint64_t presents = 0;
+    std::uint64_t lastStamp = 0;
+    while (latencyClockNs() - start < kRunNs)
+    {
+        (void)scheduler.waitForWork(waitSet);
+        ++wakes;
+        if (!scheduler.shouldRender())
+        {
+            continue;
+        }
+        const std::uint64_t stamp = publishedNs.load(std::memory_order_acquire);
+        if (stamp != lastStamp)
+        {
+            latency.record(latencyClockNs() - stamp);
+            lastStamp = stamp;
+        }
+        scheduler.rendered(true);
+        presentedAt.store(latencyClockNs(), std::memory_order_release);
+        ++presents;
+    }
+    done.store(true, std::memory_order_release);
+    // The render loop may be waiting on the swap chain; the display thread
+    // has stopped, so release it once more for a clean exit.
+    waitSet.signal(kWakeSwapChain);
+    producer.join();
+    display.join();
+
+    const double seconds = static_cast<double>(latencyClockNs() - start) / 1.0e9;
+    const std::uint64_t frames = published.load();
+    std::printf("  %-18s %8llu %8llu %9llu %9.3f %9.3f %9.3f %8.0f\n", c.name, static_cast<unsigned long long>(frames),
+                static_cast<unsigned long long>(presents), static_cast<unsigned long long>(frames > latency.count() ? frames - latency.count() : 0),
+                static_cast<double>(latency.valueAtQuantile(0.5)) / 1.0e6, static_cast<double>(latency.valueAtQuantile(0.99)) / 1.0e6,
+                static_cast<double>(latency.max()) / 1.0e6, static_cast<double>(wakes) / seconds);
+}
+
+} // namespace
+
+// Frame-to-render latency and wake rate of the render loop's wait policy,
+// without a window or GPU: a present takes the swap chain until the next
+// simulated vblank, as a waitable flip-model swap chain does.
+int main()
+{
+    std::printf("  %-18s %8s %8s %9s %9s %9s %9s %8s\n", "", "frames", "presents", "coalesced", "p50 ms", "p99 ms", "max ms", "wakes/s");
+    for (const Case& c : kCases)
+    {
+        runCase(c);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "BenchSupport.hpp"
+#include "ScalingFilter.hpp"
+#include "TestPatternCapture.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr ScalingTier kTiers[] = {ScalingTier::Scalar, ScalingTier::SSE2, ScalingTier::AVX2};
+
+struct Case {
+    std::uint32_t sourceWidth;
+    std::uint32_t sourceHeight;
+    std::uint32_t outputWidth;
+    std::uint32_t outputHeight;
+    const char* name;
+};
+
+constexpr Case kCases[] = {
+    {1920, 1080, 2560, 1440, "1080p -> 1440p"},
+    {1920, 1080, 3840, 2160, "1080p -> 4K"},
+    {1280, 720, 1920, 1080, "720p -> 1080p"},
+};
+
+struct Filter {
+    ScalingFilter filter;
+    const char* name;
+};
+
+constexpr Filter kFilters[] = {
+    {ScalingFilter::Nearest, "nearest"}, {ScalingFilter::Bicubic, "bicubic"}, {ScalingFilter::Lanczos3, "lanczos3"}};
+
+} // namespace
+
+// Scales a test pattern frame into the viewport with each separable filter
+// per tier on one thread, and times the Sharpen filter's texel pass, which
+// runs at source size before the bilinear sample.
+int main()
+{
+    std::printf("%-28s", "");
+    for (const ScalingTier tier : kTiers)
+    {
+        std::printf(" %10s ms %8s", scalingTierName(tier), "Mpix/s");
+    }
+    std::printf("\n");
+
+    for (const Case& c : kCases)
+    {
+        TestPatternCapture::Config config;
+        config.width = c.sourceWidth;
+        config.height = c.sourceHeight;
+        config.motion = TestPatternCapture::Motion::Noise;
+        config.paced = false;
+        TestPatternCapture capture(config);
+        CapturedClip clip = captureClip(capture, 1);
+        if (clip.frames.empty())
+        {
+            return 1;
+        }
+        const DirectShowCapture::Frame& frame = clip.frames.front();
+        const std::size_t srcPitch = static_cast<std::size_t>(frame.stride);
+        const std::uint8_t* src = frame.data;
+        const std::size_t dstPitch = static_cast<std::size_t>(c.outputWidth) * 4;
+        std::vector<std::uint8_t> output(dstPitch * c.outputHeight);
+        std::vector<std::uint8_t> sharpened(static_cast<std::size_t>(c.sourceWidth) * 4 * c.sourceHeight);
+        ScalingScratch scratch;
+
+        for (const Filter& filter : kFilters)
+        {
+            const FilterScaler scaler(filter.filter, c.sourceWidth, c.sourceHeight, c.outputWidth, c.outputHeight);
+            const DirtyRect whole{0, 0, c.outputWidth, c.outputHeight};
+            std::printf("  %-16s %-9s", c.name, filter.name);
+            for (const ScalingTier tier : kTiers)
+            {
+                if (!scalingKernels(tier))
+                {
+                    std::printf(" %13s %8s", "-", "-");
+                    continue;
+                }
+                const double ms = medianMs(9, [&]() { (void)scaler.scaleRegionWith(tier, output.data(), dstPitch, whole, src, srcPitch, scratch); });
+                std::printf(" %13.3f %8.0f", ms, static_cast<double>(c.outputWidth) * c.outputHeight / ms / 1000.0);
+            }
+            std::printf("\n");
+        }
+
+        std::printf("  %-16s %-9s", c.name, "sharpen");
+        for (const ScalingTier tier : kTiers)
+        {
+            if (!scalingKernels(tier))
+            {
+                std::printf(" %13s %8s", "-", "-");
+                continue;
+            }
+            const double ms = medianMs(9, [&]() {
+                (void)sharpenTextureWith(tier, sharpened.data(), static_cast<std::size_t>(c.sourceWidth) * 4, src, srcPitch, c.sourceWidth,
+                                         c.sourceHeight);
+            });
+            std::printf(" %13.3f %8.0f", ms, static_cast<double>(c.sourceWidth) * c.sourceHeight / ms / 1000.0);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "BenchSupport.hpp"
+#include "DirtyTracker.hpp"
+#include "FrameSink.hpp"
+#include "SessionRecorder.hpp"
+#include "TestPatternCapture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+namespace {
+
+struct Case {
+    std::uint32_t width;
+    std::uint32_t height;
+    TestPatternCapture::Motion motion;
+    std::size_t frames;
+    const char* name;
+};
+
+// The test pattern changes a little each frame like a desktop; noise changes
+// every tile and is the worst case for both the encoder and the file.
+constexpr Case kCases[] = {
+    {1920, 1080, TestPatternCapture::Motion::MovingBox, 60, "1080p pattern"},
+    {3840, 2160, TestPatternCapture::Motion::MovingBox, 30, "4K pattern"},
+    {1920, 1080, TestPatternCapture::Motion::Noise, 60, "1080p noise"},
+};
+
+constexpr double kFrameRate = 60.0;
+
+} // namespace
+
+// Records a clip at its frame rate as the capture thread would and reports
+// what that costs the capture thread per frame, the encoder's time per frame,
+// how many frames it could not keep up with and how well the file compresses.
+int main()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "pckvm-recorder-bench.pkvmrec";
+    StripeWorkerPool copyWorkers;
+    std::printf("%-16s %10s %10s %10s %8s %8s   (%zu threads)\n", "", "write ms", "max ms", "encode ms", "dropped", "ratio",
+                copyWorkers.concurrency());
+
+    for (const Case& c : kCases)
+    {
+        TestPatternCapture::Config config;
+        config.width = c.width;
+        config.height = c.height;
+        config.motion = c.motion;
+        config.paced = false;
+        TestPatternCapture capture(config);
+        CapturedClip clip = captureClip(capture, c.frames);
+        if (clip.frames.empty())
+        {
+            return 1;
+        }
+
+        DirtyTracker tracker;
+        SessionRecorder recorder;
+        if (!recorder.start(path))
+        {
+            std::fprintf(stderr, "%s\n", recorder.error().c_str());
+            return 1;
+        }
+
+        double writeMs = 0.0;
+        double maxMs = 0.0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < clip.frames.size(); ++i)
+        {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<long long>(i * 1.0e6 / kFrameRate)));
+            FrameWriteOptions options;
+            options.tracker = &tracker;
+            options.sequence = tracker.analyze(clip.frames[i]);
+            options.workers = &copyWorkers;
+            const auto before = std::chrono::steady_clock::now();
+            (void)writeFrameToSink(clip.frames[i], recorder, options);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count();
+            writeMs += ms;
+            maxMs = std::max(maxMs, ms);
+        }
+        const SessionRecorderStats stats = recorder.stop();
+        std::printf("  %-14s %10.3f %10.3f %10.2f %8llu %7.1f:1\n", c.name, writeMs / static_cast<double>(clip.frames.size()), maxMs,
+                    stats.encodeMs / static_cast<double>(std::max<std::uint64_t>(1, stats.framesRecorded)),
+                    static_cast<unsigned long long>(stats.framesDropped),
+                    static_cast<double>(stats.rawBytes) / static_cast<double>(std::max<std::uint64_t>(1, stats.fileBytes)));
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "BenchSupport.hpp"
+#include "MemoryFrameSink.hpp"
+#include "StripeWorkerPool.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Bottom-up frame copy and flip split across 1, 2, 4 and 8 stripes.
+int main()
+{
+    struct Resolution {
+        std::uint32_t width;
+        std::uint32_t height;
+        const char* name;
+    };
+    const Resolution resolutions[] = {{1920, 1080, "1080p"}, {2560, 1440, "1440p"}, {3840, 2160, "4K"}, {7680, 4320, "8K"}};
+    const std::size_t stripeCounts[] = {1, 2, 4, 8};
+
+    std::printf("%-6s", "frame");
+    for (const std::size_t stripes : stripeCounts)
+    {
+        std::printf(" %9zu ms %6s", stripes, "GB/s");
+    }
+    std::printf("\n");
+
+    for (const Resolution& resolution : resolutions)
+    {
+        std::vector<std::uint8_t> sample(static_cast<std::size_t>(resolution.width) * 4 * resolution.height, 3);
+        DirectShowCapture::Frame frame{};
+        frame.data = sample.data();
+        frame.dataSize = sample.size();
+        frame.width = resolution.width;
+        frame.height = resolution.height;
+        frame.stride = resolution.width * 4;
+        frame.bottomUp = true;
+
+        std::printf("%-6s", resolution.name);
+        for (const std::size_t stripes : stripeCounts)
+        {
+            StripeWorkerPool workers(stripes - 1);
+            FramePool pool(2ull * 1024ull * 1024ull * 1024ull);
+            MemoryFrameSink sink(pool);
+            FrameWriteOptions options;
+            options.workers = &workers;
+            const double ms = medianMs(resolution.width > 4000 ? 15 : 40, [&]() {
+                (void)writeFrameToSink(frame, sink, options);
+                (void)sink.acquireLatest();
+            });
+            std::printf(" %12.3f %6.1f", ms, gigabytesPerSecond(static_cast<double>(sample.size()), ms));
+        }
+        std::printf("\n");
+    }
+    std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "BenchSupport.hpp"
+#include "MemoryFrameSink.hpp"
+#include "StripeWorkerPool.hpp"
+#include "ToneMapping.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using PixelFormat = CaptureSource::PixelFormat;
+
+constexpr ConversionTier kTiers[] = {ConversionTier::Scalar, ConversionTier::AVX2};
+
+struct Resolution {
+    std::uint32_t width;
+    std::uint32_t height;
+    const char* name;
+};
+
+constexpr Resolution kResolutions[] = {{1920, 1080, "1080p"}, {3840, 2160, "4K"}};
+
+// Limited-range 10-bit samples, MSB-aligned, for the luma and chroma planes.
+std::vector<std::uint8_t> p010Frame(const Resolution& resolution)
+{
+    const std::size_t samples = static_cast<std::size_t>(resolution.width) * resolution.height * 3 / 2;
+    std::vector<std::uint8_t> data(samples * 2);
+    std::uint32_t seed = 1;
+    for (std::size_t i = 0; i < samples; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const unsigned value = (64 + (seed >> 16) % 877) << 6;
+        data[i * 2] = static_cast<std::uint8_t>(value);
+        data[i * 2 + 1] = static_cast<std::uint8_t>(value >> 8);
+    }
+    return data;
+}
+
+void printMs(double ms, const Resolution& resolution)
+{
+    std::printf(" %13.3f %8.0f", ms, static_cast<double>(resolution.width) * resolution.height / ms / 1000.0);
+}
+
+} // namespace
+
+// Cost of tone mapping a whole P010 frame per tier on one thread, next to the
+// plain P010 conversion it replaces, and through writeFrameToSink() on every
+// core.
+int main()
+{
+    const ToneMapper mapper{ToneMapParams{}};
+    const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT2020, false);
+    StripeWorkerPool workers;
+
+    std::printf("%-14s %13s %8s", "", "P010 ms", "Mpix/s");
+    for (const ConversionTier tier : kTiers)
+    {
+        std::printf(" %10s ms %8s", conversionTierName(tier), "Mpix/s");
+    }
+    std::printf(" %10s ms %8s\n", "striped", "Mpix/s");
+
+    for (const Resolution& resolution : kResolutions)
+    {
+        const std::vector<std::uint8_t> source = p010Frame(resolution);
+        const std::size_t pitch = static_cast<std::size_t>(resolution.width) * 2;
+        const std::uint8_t* chroma = source.data() + pitch * resolution.height;
+        std::vector<std::uint8_t> destination(static_cast<std::size_t>(resolution.width) * 4 * resolution.height);
+        const auto row = [&](std::uint32_t y) { return destination.data() + static_cast<std::size_t>(y) * resolution.width * 4; };
+
+        std::printf("  %-12s", resolution.name);
+        const SemiPlanarRowFn plain = semiPlanarKernel(PixelFormat::P010, activeConversionTier());
+        printMs(medianMs(15,
+                         [&]() {
+                             for (std::uint32_t y = 0; y < resolution.height; ++y)
+                             {
+                                 plain(row(y), source.data() + y * pitch, chroma + y / 2 * pitch, resolution.width, coefficients);
+                             }
+                         }),
+                resolution);
+
+        for (const ConversionTier tier : kTiers)
+        {
+            if (!setActiveToneMapTier(tier))
+            {
+                std::printf(" %13s %8s", "-", "-");
+                continue;
+            }
+            printMs(medianMs(15,
+                             [&]() {
+                                 for (std::uint32_t y = 0; y < resolution.height; ++y)
+                                 {
+                                     mapper.convertRow(row(y), source.data() + y * pitch, chroma + y / 2 * pitch, resolution.width,
+                                                       coefficients);
+                                 }
+                             }),
+                    resolution);
+        }
+
+        DirectShowCapture::Frame frame{};
+        frame.format = PixelFormat::P010;
+        frame.matrix = CaptureSource::ColorMatrix::BT2020;
+        frame.transfer = CaptureSource::TransferFunction::PQ;
+        frame.width = resolution.width;
+        frame.height = resolution.height;
+        frame.stride = static_cast<std::uint32_t>(pitch);
+        frame.data = source.data();
+        frame.dataSize = source.size();
+        FramePool pool;
+        MemoryFrameSink sink(pool);
+        FrameWriteOptions options;
+        options.workers = &workers;
+        options.toneMapper = &mapper;
+        printMs(medianMs(15, [&]() { (void)writeFrameToSink(frame, sink, options); }), resolution);
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -4,17 +4,35 @@
 
 #include "DirectShowCapture.hpp"
 #include "D3DRenderer.hpp"
+#include "FileReplayCapture.hpp"
+#include "KernelRegistry.hpp"
 #include "Settings.hpp"
 #include "SerialStreamer.hpp"
 #include "InputCapture.hpp"
 #include "MicrophoneCapture.hpp"
 #include "AudioPlayback.hpp"
 #include "OverlayUI.hpp"
+#include "PixelConversion.hpp"
+#include "PresentPacer.hpp"
+#include "RenderScheduler.hpp"
+#include "ScreenshotWriter.hpp"
+#include "SessionRecorder.hpp"
 #include "DeviceEnumeration.hpp"
+#include "DirtyTracker.hpp"
+#include "Downscale.hpp"
+#include "LatencyStats.hpp"
+#include "MemoryFrameSink.hpp"
+#include "MjpegDecoder.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestPatternCapture.hpp"
+#include "ToneMapping.hpp"
+#include "VideoViewport.hpp"
 
 #include <Windows.h>
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <vector>
 
 class Application {
@@ -26,13 +44,6 @@ public:
 
 private:
     friend class OverlayUI;
-    struct CpuFrame {
-        std::uint32_t width = 0;
-        std::uint32_t height = 0;
-        std::uint32_t stride = 0;
-        std::uint64_t timestamp100ns = 0;
-        std::vector<std::uint8_t> data;
-    };
 
     static LRESULT CALLBACK windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
     bool createWindow(int width, int height);
@@ -52,6 +63,7 @@ private:
     void applySerialTargetSetting();
     void updateInputCaptureBounds();
     void restartVideoCapture();
+    CaptureSource& videoCapture();
     bool shouldUseVideoAudio() const;
     bool shouldEnableCaptureAudio() const;
     void applySourceDimensions(std::uint32_t width, std::uint32_t height);
@@ -59,8 +71,9 @@ private:
     void updateWindowResizeMode();
     bool applyLockedWindowSize(MINMAXINFO* info) const;
     RECT computeVideoViewport(const RECT& clientRect, bool& valid) const;
-    bool uploadLatestFrame();
-    void renderFrame(bool forcePresent);
+    bool uploadLatestFrame(FrameTimestamps& timestamps);
+    // True when it presented.
+    bool renderFrame(bool forcePresent);
     void setAudioPlaybackEnabled(bool enabled);
     void setMicrophoneCaptureEnabled(bool enabled);
     void setInputCaptureEnabled(bool enabled);
@@ -70,7 +83,21 @@ private:
     void setVideoResolution(std::uint32_t width, std::uint32_t height);
     void setVideoAllowResizing(bool enabled);
     void setVideoAspectMode(VideoAspectMode mode);
+    void setVideoScalingFilter(ScalingFilter filter);
+    void setScreenshotFormat(ScreenshotFormat format);
+    void takeScreenshot();
+    void setSessionRecording(bool enabled);
+    void startSessionRecording();
+    void stopSessionRecording();
+    void setHdrInput(HdrInputMode mode);
+    void setHdrToneMapping(ToneMapCurve curve, unsigned int peakNits);
+    void setVideoDownscale(bool enabled);
+    void setVideoPresentPacing(bool enabled);
+    void rebuildToneMapper();
+    const AreaScaler* updateDownscaler(const DirectShowCapture::Frame& frame);
+    void configureKernelDispatch();
     void requestImmediateRender();
+    static void wakeRenderLoop(HANDLE event);
     void processPendingSourceDimensions();
     void selectBridgeDevice(const SerialPortInfo& info, bool autoSelect);
     bool classifyBridgeDevice(const SerialPortInfo& info, unsigned int* outBaud) const;
@@ -78,18 +105,45 @@ private:
     HWND hwnd() const { return hwnd_; }
     AppSettings& settings() { return settings_; }
     const AppSettings& settings() const { return settings_; }
+    const LatencyTracker& latency() const { return latency_; }
+    const PresentPacer& presentPacer() const { return presentPacer_; }
+    const SessionRecorder& sessionRecorder() const { return sessionRecorder_; }
+    std::uint64_t framesSkipped() const { return framesSkipped_.load(std::memory_order_relaxed); }
     std::uint32_t currentCaptureWidth() const { return currentSourceWidth_.load(std::memory_order_acquire); }
     std::uint32_t currentCaptureHeight() const { return currentSourceHeight_.load(std::memory_order_acquire); }
 
     HWND hwnd_ = nullptr;
+    DirtyTracker dirtyTracker_;
+    StripeWorkerPool copyWorkers_;
     D3DRenderer renderer_;
     DirectShowCapture directShowCapture_;
+    // Test pattern or file replay selected on the command line; replaces the device.
+    std::unique_ptr<CaptureSource> syntheticCapture_;
 
-    std::mutex frameMutex_;
-    CpuFrame frames_[2];
+    FramePool framePool_;
+    MemoryFrameSink cpuFrames_{framePool_};
+    MjpegDecoder mjpegDecoder_{framePool_, &copyWorkers_};
+    ScreenshotWriter screenshots_;
+    SessionRecorder sessionRecorder_;
+    // UI thread only.
+    bool sessionRecordingActive_ = false;
+    std::atomic<bool> recordingStarted_{false};
+    // Rebuilt from the UI thread; the capture thread takes a reference per frame.
+    std::mutex toneMapperMutex_;
+    std::shared_ptr<const ToneMapper> toneMapper_;
+    std::atomic<bool> toneMapperChanged_{false};
+    std::atomic<HdrInputMode> hdrInput_{HdrInputMode::Auto};
+    // The viewport and setting the capture thread sizes downscaled frames by.
+    std::atomic<std::uint32_t> viewportWidth_{0};
+    std::atomic<std::uint32_t> viewportHeight_{0};
+    std::atomic<bool> videoDownscale_{true};
+    // Capture thread only.
+    std::optional<AreaScaler> downscaler_;
     std::atomic<std::uint64_t> frameCounter_{0};
+    std::atomic<std::uint64_t> framesSkipped_{0};
     std::uint64_t lastPresentedFrame_ = 0;
-    int frontBufferIndex_ = 0;
+    LatencyTracker latency_;
+    PresentPacer presentPacer_;
     bool running_ = false;
     bool classRegistered_ = false;
     bool audioEnabled_ = false;
@@ -105,6 +159,8 @@ private:
     unsigned int menuHotkeyId_ = 1;
     DWORD ignoreMenuHotkeyUntil_ = 0;
     bool menuHotkeyRegistered_ = false;
+    unsigned int screenshotHotkeyId_ = 2;
+    bool screenshotHotkeyRegistered_ = false;
     std::atomic<std::uint32_t> pendingSourceWidth_{0};
     std::atomic<std::uint32_t> pendingSourceHeight_{0};
     std::atomic<bool> sourceChangePending_{false};
@@ -113,4 +169,8 @@ private:
     int lockedClientWidth_ = 0;
     int lockedClientHeight_ = 0;
     std::atomic<bool> forceRender_{false};
+    // Set by the capture thread per frame and by requestImmediateRender().
+    HANDLE frameEvent_ = nullptr;
+    HANDLE redrawEvent_ = nullptr;
+    RenderScheduler renderScheduler_;
 };
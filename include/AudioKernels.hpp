@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample loops of the microphone path. Every tier matches the scalar one bit
+// for bit; the widest the CPU supports is picked on first use, and
+// configureKernels() may switch it later.
+enum class AudioKernelTier {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+// Float samples to 16-bit PCM: clamped to [-1, 1], scaled by 32767 and
+// truncated toward zero. NaN becomes -32767.
+using FloatToPcm16Fn = void (*)(std::int16_t* dst, const float* src, std::size_t count);
+
+// Largest |sample|, so 32768 for a buffer holding -32768; 0 when empty.
+using PeakMagnitudeFn = int (*)(const std::int16_t* samples, std::size_t count);
+
+// A specific tier, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] FloatToPcm16Fn floatToPcm16Kernel(AudioKernelTier tier);
+[[nodiscard]] PeakMagnitudeFn peakMagnitudeKernel(AudioKernelTier tier);
+
+[[nodiscard]] AudioKernelTier activeAudioKernelTier();
+[[nodiscard]] const char* audioKernelTierName(AudioKernelTier tier);
+// False, and no change, when `tier` cannot run.
+bool setActiveAudioKernelTier(AudioKernelTier tier);
+
+void convertFloatToPcm16(std::int16_t* dst, const float* src, std::size_t count);
+[[nodiscard]] int peakMagnitude(const std::int16_t* samples, std::size_t count);
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Anything that delivers video frames to the pipeline: the DirectShow device,
+// or one of the synthetic backends used to run the pipeline without capture
+// hardware. Frames are handed to the handler on the source's own thread and
+// their memory is only valid for the duration of the call.
+class CaptureSource {
+public:
+    enum class PixelFormat {
+        BGRA8,
+        RGB24,  // packed B G R, no alpha
+        RGB565, // 16-bit little-endian words: red in the top 5 bits, blue in the bottom 5
+        YUY2,   // packed 4:2:2: Y0 Cb Y1 Cr
+        UYVY,   // packed 4:2:2: Cb Y0 Cr Y1
+        NV12,   // 4:2:0: 8-bit Y plane, then a half-height plane of Cb Cr pairs
+        P010,   // NV12 layout with 16-bit little-endian samples, 10 bits MSB-aligned
+        V210,   // packed 10-bit 4:2:2: six pixels in 16 bytes, three samples per 32-bit word
+        MJPEG,  // compressed: data holds one JPEG picture; see MjpegDecoder
+    };
+
+    // How YUV formats encode colour; ignored for RGB formats.
+    enum class ColorMatrix {
+        BT601,
+        BT709,
+        BT2020,
+    };
+
+    // Transfer function of the samples. PQ (SMPTE ST 2084) frames are HDR10
+    // and get tone mapped before they reach the SDR swapchain.
+    enum class TransferFunction {
+        SDR,
+        PQ,
+    };
+
+    struct Frame {
+        std::uint32_t width{};
+        std::uint32_t height{};
+        std::uint32_t stride{};
+        std::uint64_t timestamp100ns{};
+        const std::uint8_t* data{};
+        std::size_t dataSize{};
+        bool bottomUp{};
+        std::uint32_t sampleWidth{};
+        std::uint32_t sampleHeight{};
+        std::uint32_t contentLeft{};
+        std::uint32_t contentTop{};
+        std::uint32_t contentRight{};
+        std::uint32_t contentBottom{};
+        // latencyClockNs() when the source handed the buffer over.
+        std::uint64_t arrivalNs{};
+        // YUV formats start the content rectangle on a pixel group (see
+        // pixelFormatGroupPixels()) and are always stored top-down.
+        PixelFormat format = PixelFormat::BGRA8;
+        ColorMatrix matrix = ColorMatrix::BT709;
+        bool fullRange = false;
+        TransferFunction transfer = TransferFunction::SDR;
+        // Semi-planar formats: where the CbCr plane starts in data and its row
+        // pitch. Zero means it directly follows the luma rows with their stride.
+        std::size_t chromaOffset{};
+        std::uint32_t chromaStride{};
+    };
+
+    using FrameHandler = std::function<void(const Frame&)>;
+
+    struct Options {
+        std::string deviceMoniker;
+        bool enableAudio = false;
+        std::uint32_t desiredWidth = 0;
+        std::uint32_t desiredHeight = 0;
+    };
+
+    virtual ~CaptureSource() = default;
+
+    // Throws when the source cannot be started; errors after that are kept
+    // for consumeLastError().
+    virtual void start(FrameHandler handler, const Options& options) = 0;
+    virtual void stop() = 0;
+
+    [[nodiscard]] virtual std::string consumeLastError() = 0;
+    [[nodiscard]] virtual std::string currentDeviceFriendlyName() const = 0;
+};
+
+// Rows are addressed in groups of pixels that share storage: one RGB pixel,
+// a 4:2:2 or 4:2:0 pixel pair, or a v210 block of six. Rows start on a group.
+[[nodiscard]] constexpr std::uint32_t pixelFormatGroupPixels(CaptureSource::PixelFormat format)
+{
+    switch (format)
+    {
+    case CaptureSource::PixelFormat::BGRA8:
+    case CaptureSource::PixelFormat::RGB24:
+    case CaptureSource::PixelFormat::RGB565:
+        return 1;
+    case CaptureSource::PixelFormat::V210:
+        return 6;
+    case CaptureSource::PixelFormat::YUY2:
+    case CaptureSource::PixelFormat::UYVY:
+    case CaptureSource::PixelFormat::NV12:
+    case CaptureSource::PixelFormat::P010:
+    case CaptureSource::PixelFormat::MJPEG:
+        break;
+    }
+    return 2;
+}
+
+// Bytes of one group in a packed row, or in the luma row of a semi-planar
+// one; 0 for compressed formats.
+[[nodiscard]] constexpr std::uint32_t pixelFormatGroupBytes(CaptureSource::PixelFormat format)
+{
+    switch (format)
+    {
+    case CaptureSource::PixelFormat::BGRA8:
+    case CaptureSource::PixelFormat::YUY2:
+    case CaptureSource::PixelFormat::UYVY:
+    case CaptureSource::PixelFormat::P010:
+        return 4;
+    case CaptureSource::PixelFormat::RGB24:
+        return 3;
+    case CaptureSource::PixelFormat::RGB565:
+    case CaptureSource::PixelFormat::NV12:
+        return 2;
+    case CaptureSource::PixelFormat::V210:
+        return 16;
+    case CaptureSource::PixelFormat::MJPEG:
+        break;
+    }
+    return 0;
+}
+
+// Offset within a row of the group holding column `pixel`.
+[[nodiscard]] constexpr std::size_t pixelFormatRowOffset(CaptureSource::PixelFormat format, std::size_t pixel)
+{
+    return pixel / pixelFormatGroupPixels(format) * pixelFormatGroupBytes(format);
+}
+
+// Bytes of the groups holding the first `pixels` pixels of a row.
+[[nodiscard]] constexpr std::size_t pixelFormatRowBytes(CaptureSource::PixelFormat format, std::size_t pixels)
+{
+    const std::size_t group = pixelFormatGroupPixels(format);
+    return (pixels + group - 1) / group * pixelFormatGroupBytes(format);
+}
+
+// RGB formats have no chroma to share, so their rows may be stored bottom-up
+// and start on any column.
+[[nodiscard]] constexpr bool isRgb(CaptureSource::PixelFormat format)
+{
+    return format == CaptureSource::PixelFormat::BGRA8 || format == CaptureSource::PixelFormat::RGB24 ||
+           format == CaptureSource::PixelFormat::RGB565;
+}
+
+[[nodiscard]] constexpr bool isSemiPlanar(CaptureSource::PixelFormat format)
+{
+    return format == CaptureSource::PixelFormat::NV12 || format == CaptureSource::PixelFormat::P010;
+}
+
+// Compressed frames have no rows; they must be decoded before anything reads
+// pixels from them.
+[[nodiscard]] constexpr bool isCompressed(CaptureSource::PixelFormat format)
+{
+    return format == CaptureSource::PixelFormat::MJPEG;
+}
+
+// Matrix assumed when a source does not signal one: BT.2020 for P010, else
+// BT.709 for HD and BT.601 below. v210 is usually SDI video, so it follows
+// the frame size like the 8-bit formats.
+[[nodiscard]] constexpr CaptureSource::ColorMatrix defaultColorMatrix(CaptureSource::PixelFormat format, std::uint32_t height)
+{
+    if (format == CaptureSource::PixelFormat::P010)
+    {
+        return CaptureSource::ColorMatrix::BT2020;
+    }
+    return height >= 720 ? CaptureSource::ColorMatrix::BT709 : CaptureSource::ColorMatrix::BT601;
+}
+
+// Transfer assumed when a source does not signal one: P010 capture is HDR10
+// in practice, everything else SDR.
+[[nodiscard]] constexpr CaptureSource::TransferFunction defaultTransferFunction(CaptureSource::PixelFormat format)
+{
+    return format == CaptureSource::PixelFormat::P010 ? CaptureSource::TransferFunction::PQ : CaptureSource::TransferFunction::SDR;
+}
+
+// Releases frames on their presentation timestamps for sources that are not
+// clocked by hardware. The first frame starts the schedule. A frame that is
+// already more than a period late restarts it from now instead of bursting to
+// catch up, as a capture card would drop rather than queue.
+class FramePacer {
+public:
+    void restart() noexcept { started_ = false; }
+
+    // Blocks until the frame is due. Returns false when the frame was late.
+    bool waitFor(std::uint64_t timestamp100ns, std::uint64_t period100ns);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool started_ = false;
+    Clock::time_point origin_{};
+    std::uint64_t originTimestamp100ns_ = 0;
+};
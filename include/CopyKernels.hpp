@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Row copies with non-temporal (streaming) stores. Frame data goes either to
+// write-combined UPLOAD heap mappings or to buffers far larger than the cache,
+// so regular stores only cost read-for-ownership traffic and evict useful
+// lines. The widest tier the CPU supports is picked on first use, and
+// configureKernels() may switch it later; plain memcpy is the fallback.
+enum class CopyKernelTier {
+    Memcpy,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+using RowCopyFn = void (*)(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes);
+
+// Copies with the selected kernel. Streaming stores are weakly ordered: call
+// streamCopyFence() once a batch of rows is done, before handing the memory to
+// another thread or the GPU.
+void streamCopy(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes);
+void streamCopyFence();
+
+[[nodiscard]] CopyKernelTier activeCopyKernelTier();
+[[nodiscard]] const char* copyKernelTierName(CopyKernelTier tier);
+
+// A specific tier, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] RowCopyFn copyKernelFor(CopyKernelTier tier);
+
+// Makes streamCopy() use `tier`; false, and no change, when it cannot run.
+bool setActiveCopyKernelTier(CopyKernelTier tier);
@@ -1,18 +1,34 @@
 #pragma once
 
+#include "DirtyTracker.hpp"
+#include "FrameMailbox.hpp"
+#include "FrameSink.hpp"
+#include "LatencyStats.hpp"
+#include "ScalingFilter.hpp"
+
 #include <Windows.h>
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <vector>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <wrl/client.h>
 
-class D3DRenderer {
+// What DXGI last reported about the swap chain reaching the screen.
+struct PresentStatistics {
+    std::uint32_t presentId = 0;       // latest Present that was displayed
+    std::uint64_t presentRefresh = 0;  // the vblank it first appeared on
+    std::uint64_t syncRefresh = 0;     // a recent vblank
+    std::uint64_t syncNs = 0;          // and when it happened; 0 before any
+};
+
+class D3DRenderer : public FrameSink {
 public:
     D3DRenderer() = default;
-    ~D3DRenderer();
+    ~D3DRenderer() override;
 
     bool initialize(HWND hwnd, bool enableDebug = false);
     void shutdown();
@@ -24,11 +40,40 @@ public:
                      std::uint32_t width,
                      std::uint32_t height);
 
+    // FrameSink: runs on the capture thread and writes straight into the
+    // mapped upload heap. Rejects frames until the render thread has sized the
+    // upload ring for them.
+    bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) override;
+    void commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence) override;
+
+    // Render thread: takes the newest frame committed through the sink and
+    // reports the stamps it collected on the capture thread.
+    bool acquireSinkFrame(FrameTimestamps* timestamps = nullptr);
+
+    // With a tracker, only tiles that changed since the texture's frame are
+    // copied from the upload heap. The tracker must outlive the renderer.
+    void setDirtyTracker(const DirtyTracker* tracker) { dirtyTracker_ = tracker; }
+    [[nodiscard]] std::uint64_t texelsUploaded() const { return texelsUploaded_; }
+
+    // latencyClockNs() around the most recent ExecuteCommandLists / Present.
+    [[nodiscard]] std::uint64_t lastSubmitNs() const { return lastSubmitNs_; }
+    [[nodiscard]] std::uint64_t lastPresentNs() const { return lastPresentNs_; }
+    // GetLastPresentCount() after the most recent Present.
+    [[nodiscard]] std::uint32_t lastPresentId() const { return lastPresentId_; }
+    [[nodiscard]] const PresentStatistics& presentStatistics() const { return presentStats_; }
+    // Presents go out immediately rather than on a vblank.
+    [[nodiscard]] bool tearingEnabled() const { return allowTearing_; }
+
     void render(const std::function<void(ID3D12GraphicsCommandList*)>& overlayCallback = nullptr);
 
     void setDebugGradient(bool enable);
     [[nodiscard]] bool debugGradientEnabled() const { return debugGradient_; }
 
+    // Takes effect from the next render(); every filter's pipeline is built
+    // at initialization.
+    void setScalingFilter(ScalingFilter filter);
+    [[nodiscard]] ScalingFilter scalingFilter() const { return scalingFilter_; }
+
     [[nodiscard]] ID3D12Device* device() const { return device_.Get(); }
     [[nodiscard]] ID3D12CommandQueue* commandQueue() const { return commandQueue_.Get(); }
     [[nodiscard]] ID3D12DescriptorHeap* srvHeap() const { return srvHeap_.Get(); }
@@ -42,6 +87,9 @@ public:
 
     void setViewportRect(float x, float y, float width, float height);
 
+    // Signalled when the swap chain can queue another frame; nullptr without one.
+    [[nodiscard]] HANDLE frameLatencyWaitable() const { return frameLatencyWaitableObject_; }
+
 private:
     struct FrameContext {
         Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
@@ -53,9 +101,7 @@ private:
     bool createPipelineResources();
     bool createRenderTargets();
     void destroyRenderTarget();
-    bool ensureFrameResources(std::uint32_t width,
-                              std::uint32_t height,
-                              std::uint32_t stride);
+    bool ensureFrameResources(std::uint32_t width, std::uint32_t height);
     void destroyFrameResources();
     void waitForFrame(FrameContext& frameContext);
     void waitForGpu();
@@ -79,7 +125,7 @@ private:
     std::uint64_t fenceValue_ = 1;
 
     Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature_;
-    Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState_;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStates_[kScalingFilterCount];
     Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStateGradient_;
 
     Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer_;
@@ -92,11 +138,33 @@ private:
         D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout{};
         std::uint64_t sizeBytes = 0;
         std::uint8_t* cpuAddress = nullptr;
+        std::uint64_t fenceValue = 0;
+        std::uint64_t sequence = 0;
+        // Size of the captured frame; larger than the texture when it was
+        // downscaled, which is where `sequence`'s dirty tiles live.
+        std::uint32_t sourceWidth = 0;
+        std::uint32_t sourceHeight = 0;
+        FrameTimestamps timestamps;
     };
 
+    void waitForUpload(const UploadResource& upload, HANDLE event);
+
     Microsoft::WRL::ComPtr<ID3D12Resource> frameTexture_;
-    UploadResource frameUploads_[kFrameCount];
-    bool pendingUpload_[kFrameCount] = {};
+    FrameMailbox<UploadResource> frameUploads_;
+    bool pendingUpload_ = false;
+    std::atomic<bool> uploadsReady_{false};
+    std::atomic<bool> sinkWriterActive_{false};
+    HANDLE sinkFenceEvent_ = nullptr;
+
+    const DirtyTracker* dirtyTracker_ = nullptr;
+    std::uint64_t textureSequence_ = 0;
+    std::uint64_t texelsUploaded_ = 0;
+    std::uint64_t lastSubmitNs_ = 0;
+    std::uint64_t lastPresentNs_ = 0;
+    std::uint32_t lastPresentId_ = 0;
+    PresentStatistics presentStats_;
+    DirtyTracker::TileMask uploadMask_{};
+    std::vector<DirtyRect> uploadRects_;
 
     D3D12_CPU_DESCRIPTOR_HANDLE rtvHandleStart_{};
     UINT srvDescriptorSize_ = 0;
@@ -112,13 +180,13 @@ private:
 
     UINT frameWidth_ = 0;
     UINT frameHeight_ = 0;
-    UINT frameStride_ = 0;
     UINT backBufferWidth_ = 0;
     UINT backBufferHeight_ = 0;
 
     HANDLE frameLatencyWaitableObject_ = nullptr;
     bool allowTearing_ = false;
     bool debugGradient_ = false;
+    ScalingFilter scalingFilter_ = ScalingFilter::Bilinear;
     bool loggedGpuPixels_ = false;
     bool debugLayerEnabled_ = false;
 
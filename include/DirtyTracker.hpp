@@ -0,0 +1,121 @@
+#pragma once
+
+#include "DirectShowCapture.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct DirtyRect {
+    std::uint32_t left = 0;
+    std::uint32_t top = 0;
+    std::uint32_t right = 0;
+    std::uint32_t bottom = 0;
+};
+
+// Finds the parts of a frame that changed since an earlier one. Every analyzed
+// frame gets a sequence number and a bitmask of 64x64 tiles whose hash differs
+// from the frame before it. The last few masks are kept, so any buffer that
+// still holds an older frame can ask which tiles changed since then and copy
+// only those.
+//
+// analyze() and rectsSince() belong to the capture thread; collectSince() may
+// be called from any thread and simply fails when history was overwritten.
+class DirtyTracker {
+public:
+    static constexpr std::uint32_t kTileSize = 64;
+    static constexpr std::uint32_t kMaxTilesX = 128;
+    static constexpr std::uint32_t kMaxTilesY = 128;
+    static constexpr std::size_t kMaxMaskWords = (kMaxTilesX * kMaxTilesY + 63) / 64;
+    static constexpr std::size_t kHistory = 16;
+    static constexpr std::size_t kMaxRects = 64;
+
+    struct TileMask {
+        std::uint32_t tilesX = 0;
+        std::uint32_t tilesY = 0;
+        std::array<std::uint64_t, kMaxMaskWords> bits{};
+
+        [[nodiscard]] bool test(std::uint32_t x, std::uint32_t y) const noexcept
+        {
+            const std::size_t index = static_cast<std::size_t>(y) * tilesX + x;
+            return (bits[index / 64] >> (index % 64)) & 1u;
+        }
+        [[nodiscard]] std::size_t wordCount() const noexcept
+        {
+            return (static_cast<std::size_t>(tilesX) * tilesY + 63) / 64;
+        }
+    };
+
+    DirtyTracker();
+
+    DirtyTracker(const DirtyTracker&) = delete;
+    DirtyTracker& operator=(const DirtyTracker&) = delete;
+
+    // Hashes the frame's tiles and records which changed. Returns the frame's
+    // sequence number, or 0 when the frame is compressed or too large to track.
+    std::uint64_t analyze(const DirectShowCapture::Frame& frame);
+
+    // Tiles that changed in the most recently analyzed frame. Zero after a
+    // tracked frame means it is byte-identical to the one before it.
+    [[nodiscard]] std::uint32_t lastDirtyTiles() const noexcept { return lastDirtyTiles_; }
+
+    // Forget the previous frame's hashes so the next frame counts as fully
+    // changed. Capture thread only, or while capture is stopped.
+    void invalidate() noexcept { hashesValid_ = false; }
+
+    // Union of the tiles that changed after frame `since` up to and including
+    // frame `until`. Returns false when that cannot be answered, in which case
+    // the caller must treat the whole frame as dirty.
+    bool collectSince(std::uint64_t since, std::uint64_t until, TileMask& mask) const;
+
+    // Capture-thread convenience: collectSince() turned into merged pixel
+    // rectangles for the current frame size. Returns nullptr for "everything".
+    const std::vector<DirtyRect>* rectsSince(std::uint64_t since, std::uint64_t until);
+
+    // Merges dirty tiles into at most kMaxRects rectangles, clipped to the frame.
+    static void buildRects(const TileMask& mask,
+                           std::uint32_t width,
+                           std::uint32_t height,
+                           std::vector<DirtyRect>& rects);
+
+    [[nodiscard]] std::uint64_t framesAnalyzed() const noexcept { return framesAnalyzed_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t tilesDirty() const noexcept { return tilesDirty_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t tilesTotal() const noexcept { return tilesTotal_.load(std::memory_order_relaxed); }
+
+private:
+    struct TileState {
+        std::uint64_t acc[2];
+        std::uint64_t key[2];
+    };
+
+    struct HistoryEntry {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::uint32_t> tilesX{0};
+        std::atomic<std::uint32_t> tilesY{0};
+        std::array<std::atomic<std::uint64_t>, kMaxMaskWords> bits{};
+    };
+
+    bool configure(std::uint32_t width, std::uint32_t height);
+
+    std::uint32_t width_ = 0;
+    std::uint32_t height_ = 0;
+    std::uint32_t tilesX_ = 0;
+    std::uint32_t tilesY_ = 0;
+    bool hashesValid_ = false;
+    std::uint32_t lastDirtyTiles_ = 0;
+    std::uint64_t nextSequence_ = 1;
+    std::vector<std::uint64_t> hashes_;
+    std::array<TileState, kMaxTilesX> rowState_{};
+
+    std::atomic<std::uint64_t> baseSequence_{1};
+    std::array<HistoryEntry, kHistory> history_{};
+
+    TileMask scratchMask_{};
+    std::vector<DirtyRect> scratchRects_;
+
+    std::atomic<std::uint64_t> framesAnalyzed_{0};
+    std::atomic<std::uint64_t> tilesDirty_{0};
+    std::atomic<std::uint64_t> tilesTotal_{0};
+};
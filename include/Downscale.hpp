@@ -0,0 +1,149 @@
+#pragma once
+
+#include "DirtyTracker.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Shrinks BGRA frames on the CPU before they are uploaded, so a 4K source in
+// a 1080p window moves a quarter of the bytes and the sampler no longer
+// minifies (and aliases) it.
+//
+// Every output pixel is the area average of the source pixels its footprint
+// covers, computed separably in fixed point:
+//   horizontal: Q14 weights summing to 2^14 along each source row, kept as
+//               Q7 (+2^6 >> 7) so the result still fits int16
+//   vertical:   Q14 weights over those Q7 rows, (+2^20 >> 21) back to 8 bits
+// Exact 2:1 and 4:1 ratios take box-filter fast paths that produce the same
+// bytes as the general path. Every tier matches the scalar one bit for bit;
+// the widest the CPU supports is picked on first use, and configureKernels()
+// may switch it later.
+enum class DownscaleTier {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+struct DownscaleKernels {
+    // dst[i] = rounded average of the 2x2 block at source column 2i.
+    void (*box2)(std::uint8_t* dst, const std::uint8_t* row0, const std::uint8_t* row1, std::size_t dstPixels);
+    // dst[i] = rounded average of the 4x4 block at source column 4i.
+    void (*box4)(std::uint8_t* dst, const std::uint8_t* const* rows, std::size_t dstPixels);
+    // Pixel i blends `taps` of the `srcPixels` source pixels from
+    // firstColumn[i] with weights[i * taps ...] into four Q7 channels.
+    // `weights` must stay readable three entries past the last pixel's.
+    void (*horizontal)(std::uint16_t* dst,
+                       const std::uint8_t* src,
+                       std::size_t srcPixels,
+                       const std::uint32_t* firstColumn,
+                       const std::int16_t* weights,
+                       std::size_t taps,
+                       std::size_t dstPixels);
+    // Blends `count` Q7 rows with `weights` back into `values` bytes.
+    void (*vertical)(std::uint8_t* dst,
+                     const std::uint16_t* const* rows,
+                     const std::int16_t* weights,
+                     std::size_t count,
+                     std::size_t values);
+};
+
+// A specific tier, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] const DownscaleKernels* downscaleKernels(DownscaleTier tier);
+
+[[nodiscard]] DownscaleTier activeDownscaleTier();
+[[nodiscard]] const char* downscaleTierName(DownscaleTier tier);
+// False, and no change, when `tier` cannot run.
+bool setActiveDownscaleTier(DownscaleTier tier);
+
+// Below this ratio the saving is small and bilinear sampling still looks fine.
+inline constexpr double kMinDownscaleRatio = 1.5;
+// Beyond it the sampler does the rest; keeps the filters short.
+inline constexpr double kMaxDownscaleRatio = 8.0;
+
+// Size to shrink a source to before showing it in a viewport, never smaller
+// than the viewport. Ratios just above 2 or 4 snap to the box filters; others
+// are rounded down to 1/8 steps so dragging a window edge rarely changes the
+// result. Returns false, leaving the outputs alone, when the source should be
+// uploaded as is.
+bool chooseDownscaleSize(std::uint32_t sourceWidth,
+                         std::uint32_t sourceHeight,
+                         std::uint32_t viewportWidth,
+                         std::uint32_t viewportHeight,
+                         std::uint32_t& outputWidth,
+                         std::uint32_t& outputHeight);
+
+// The output rectangle whose pixels depend on any source pixel of `rect`.
+[[nodiscard]] DirtyRect scaleDirtyRect(const DirtyRect& rect,
+                                       std::uint32_t sourceWidth,
+                                       std::uint32_t sourceHeight,
+                                       std::uint32_t outputWidth,
+                                       std::uint32_t outputHeight);
+
+// Working memory for AreaScaler::scaleRegion(); one per thread, reused across
+// frames.
+struct DownscaleScratch {
+    std::vector<std::uint8_t> sourceRows;
+    std::vector<std::uint16_t> filteredRows;
+    std::vector<std::uint32_t> filteredTags;
+    std::vector<const std::uint16_t*> windowRows;
+    std::vector<std::uint32_t> firstColumns;
+};
+
+// Filter taps for one source and output size. Immutable once built, so copy
+// workers can share it.
+class AreaScaler {
+public:
+    AreaScaler(std::uint32_t sourceWidth, std::uint32_t sourceHeight, std::uint32_t outputWidth, std::uint32_t outputHeight);
+
+    [[nodiscard]] std::uint32_t sourceWidth() const noexcept { return sourceWidth_; }
+    [[nodiscard]] std::uint32_t sourceHeight() const noexcept { return sourceHeight_; }
+    [[nodiscard]] std::uint32_t outputWidth() const noexcept { return outputWidth_; }
+    [[nodiscard]] std::uint32_t outputHeight() const noexcept { return outputHeight_; }
+    // 2 or 4 for the box filters, 0 for general area averaging.
+    [[nodiscard]] std::uint32_t boxFactor() const noexcept { return boxFactor_; }
+
+    // Returns BGRA source pixels [firstColumn, firstColumn + columns) of
+    // source row `row`: either written to `scratch`, which has room for them,
+    // or straight from the frame when it already holds BGRA.
+    using SourceRowFn = std::function<const std::uint8_t*(std::uint32_t row, std::uint32_t firstColumn, std::uint32_t columns, std::uint8_t* scratch)>;
+
+    // Produces output pixels [left, right) x [top, bottom) into `dst` (the
+    // output's row 0, column 0). Source spans start on a multiple of
+    // `columnAlignment` so 4:2:2 and 4:2:0 rows begin on a pixel pair.
+    // Runs activeDownscaleTier().
+    void scaleRegion(std::uint8_t* dst,
+                     std::size_t dstPitch,
+                     const DirtyRect& region,
+                     std::uint32_t columnAlignment,
+                     const SourceRowFn& sourceRow,
+                     DownscaleScratch& scratch) const;
+
+    // Same, with a specific tier; false when this build or CPU cannot run it.
+    bool scaleRegionWith(DownscaleTier tier,
+                         std::uint8_t* dst,
+                         std::size_t dstPitch,
+                         const DirtyRect& region,
+                         std::uint32_t columnAlignment,
+                         const SourceRowFn& sourceRow,
+                         DownscaleScratch& scratch) const;
+
+private:
+    struct Axis {
+        // Taps per output pixel; shorter windows are padded with zero weights.
+        std::uint32_t taps = 0;
+        std::vector<std::uint32_t> first;
+        std::vector<std::int16_t> weights;
+    };
+
+    static Axis buildAxis(std::uint32_t source, std::uint32_t output);
+
+    std::uint32_t sourceWidth_;
+    std::uint32_t sourceHeight_;
+    std::uint32_t outputWidth_;
+    std::uint32_t outputHeight_;
+    std::uint32_t boxFactor_ = 0;
+    Axis columns_;
+    Axis rows_;
+};
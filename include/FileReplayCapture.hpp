@@ -0,0 +1,116 @@
+#pragma once
+
+#include "CaptureSource.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Plays back recorded video as if it came from a capture card. Three containers
+// are understood:
+//  - Y4M (YUV4MPEG2, 8-bit 4:2:0, 4:2:2, 4:4:4 or mono), converted to BGRA;
+//  - concatenated JPEG pictures (a raw .mjpeg dump of a USB dongle), delivered
+//    still compressed as PixelFormat::MJPEG, so they go through MjpegDecoder
+//    exactly like device samples;
+//  - headerless raw BGRA8 frames, whose size and rate come from the Config.
+// Frames are released on their timestamps: the Y4M frame rate, the configured
+// rate for MJPEG and raw files, or per-frame times from a Matroska v2
+// timestamp file (one millisecond value per line) when one is given.
+class FileReplayCapture : public CaptureSource {
+public:
+    struct Config {
+        std::string path;
+        std::string timestampsPath;
+        // Raw files only.
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        bool bottomUp = false;
+        // Raw and MJPEG files, or Y4M files without a rate.
+        double fps = 60.0;
+        bool loop = true;
+        // Deliver frames on their timestamps; otherwise as fast as the handler returns.
+        bool paced = true;
+        // Read the whole file up front so disk reads and colour conversion
+        // stay out of the measurement. Limited to kPreloadLimitBytes.
+        bool preload = false;
+    };
+
+    static constexpr std::size_t kPreloadLimitBytes = 1024ull * 1024ull * 1024ull;
+
+    FileReplayCapture();
+    explicit FileReplayCapture(Config config);
+    ~FileReplayCapture() override;
+
+    // Opens and validates the file; throws when it cannot be played.
+    void start(FrameHandler handler, const Options& options) override;
+    void stop() override;
+
+    [[nodiscard]] std::string consumeLastError() override;
+    [[nodiscard]] std::string currentDeviceFriendlyName() const override;
+
+    [[nodiscard]] std::uint64_t framesDelivered() const noexcept { return framesDelivered_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t framesLate() const noexcept { return framesLate_.load(std::memory_order_relaxed); }
+
+    FileReplayCapture(const FileReplayCapture&) = delete;
+    FileReplayCapture& operator=(const FileReplayCapture&) = delete;
+
+private:
+    enum class Container {
+        Raw,
+        Y4M,
+        Mjpeg,
+    };
+
+    void open();
+    void rewind();
+    void parseY4mHeader(const std::string& header);
+    void loadTimestamps();
+    // Reads the next frame into buffer_. Returns its size, or 0 at the end.
+    std::size_t readFrame();
+    std::size_t readMjpegFrame();
+    void convertY4m(std::uint8_t* bgra) const;
+    [[nodiscard]] std::uint64_t frameTimestamp(std::uint64_t index) const;
+    void run();
+
+    Config config_;
+    FrameHandler handler_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    std::mutex errorMutex_;
+    std::string lastError_;
+
+    Container container_ = Container::Raw;
+    std::ifstream file_;
+    std::streamoff dataStart_ = 0;
+    std::uint32_t width_ = 0;
+    std::uint32_t height_ = 0;
+    std::uint64_t rateNum_ = 60;
+    std::uint64_t rateDen_ = 1;
+    std::uint64_t frameCount_ = 0;
+    std::size_t fileFrameBytes_ = 0;
+
+    // Y4M layout and colour conversion.
+    std::uint32_t chromaShiftX_ = 1;
+    std::uint32_t chromaShiftY_ = 1;
+    bool monochrome_ = false;
+    bool fullRange_ = false;
+    std::vector<std::uint8_t> planes_;
+
+    // MJPEG: file bytes read ahead of the current picture.
+    std::vector<std::uint8_t> pending_;
+    std::size_t pendingStart_ = 0;
+
+    std::vector<std::uint64_t> timestamps100ns_;
+    std::vector<std::uint8_t> buffer_;
+    std::vector<std::uint8_t> preloaded_;
+    // Start of each preloaded frame, plus the end of the last one.
+    std::vector<std::size_t> preloadedOffsets_;
+
+    std::atomic<std::uint64_t> framesDelivered_{0};
+    std::atomic<std::uint64_t> framesLate_{0};
+};
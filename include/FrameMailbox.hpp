@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single-producer / single-consumer triple buffer. The producer always owns one
+// slot, the consumer owns another and the third sits in the shared middle
+// position. Publishing swaps the producer's slot into the middle, acquiring
+// swaps the consumer's slot out of it, so neither side ever waits and the
+// consumer always sees the newest complete slot.
+template <typename Slot>
+class FrameMailbox {
+public:
+    FrameMailbox() = default;
+
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+    // Producer side: the slot to fill before calling publish().
+    [[nodiscard]] Slot& writeSlot() noexcept { return slots_[producer_.index]; }
+
+    void publish() noexcept
+    {
+        const std::uint8_t tagged = static_cast<std::uint8_t>(producer_.index | kFreshBit);
+        const std::uint8_t previous = middle_.exchange(tagged, std::memory_order_acq_rel);
+        if ((previous & kFreshBit) != 0)
+        {
+            overwritten_.fetch_add(1, std::memory_order_relaxed);
+        }
+        producer_.index = static_cast<std::uint8_t>(previous & kIndexMask);
+    }
+
+    // Consumer side: returns the newest published slot, or nullptr when nothing
+    // was published since the previous call.
+    [[nodiscard]] const Slot* acquireLatest() noexcept
+    {
+        if ((middle_.load(std::memory_order_relaxed) & kFreshBit) == 0)
+        {
+            return nullptr;
+        }
+        const std::uint8_t previous = middle_.exchange(consumer_.index, std::memory_order_acq_rel);
+        consumer_.index = static_cast<std::uint8_t>(previous & kIndexMask);
+        return &slots_[consumer_.index];
+    }
+
+    [[nodiscard]] Slot& frontSlot() noexcept { return slots_[consumer_.index]; }
+    [[nodiscard]] const Slot& frontSlot() const noexcept { return slots_[consumer_.index]; }
+
+    // Frames replaced in the middle slot before the consumer picked them up.
+    [[nodiscard]] std::uint64_t overwrittenCount() const noexcept { return overwritten_.load(std::memory_order_relaxed); }
+
+    // Only valid while no producer is running.
+    template <typename Fn>
+    void forEachSlot(Fn&& fn)
+    {
+        for (auto& slot : slots_)
+        {
+            fn(slot);
+        }
+    }
+
+    // Only valid while no producer is running.
+    void reset()
+    {
+        for (auto& slot : slots_)
+        {
+            slot = Slot{};
+        }
+        producer_.index = 0;
+        middle_.store(1, std::memory_order_release);
+        consumer_.index = 2;
+        overwritten_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::uint8_t kIndexMask = 0x03;
+    static constexpr std::uint8_t kFreshBit = 0x04;
+
+    struct alignas(64) OwnedIndex {
+        std::uint8_t index = 0;
+    };
+
+    std::array<Slot, 3> slots_{};
+    OwnedIndex producer_{0};
+    alignas(64) std::atomic<std::uint8_t> middle_{1};
+    OwnedIndex consumer_{2};
+    std::atomic<std::uint64_t> overwritten_{0};
+};
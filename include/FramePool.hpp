@@ -0,0 +1,92 @@
+#pragma once
+
+#include "DirectShowCapture.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Recycles large, cache-line aligned frame buffers so capture stops touching
+// the heap once the working set for the current mode exists. Released buffers
+// are cached per (size, format) for the few most recently used keys, which
+// keeps a mode switch and the switch back allocation-free. The total footprint
+// (cached plus in use) is capped. The pool must outlive every handle.
+class FramePool {
+    struct Block;
+
+public:
+    using PixelFormat = DirectShowCapture::PixelFormat;
+
+    static constexpr std::size_t kAlignment = 64;
+    static constexpr std::size_t kDefaultLimitBytes = 512ull * 1024ull * 1024ull;
+
+    // Shared, reference-counted view of one pooled buffer. The buffer goes back
+    // to the pool when the last handle is dropped.
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(const Handle& other) noexcept;
+        Handle(Handle&& other) noexcept;
+        Handle& operator=(const Handle& other) noexcept;
+        Handle& operator=(Handle&& other) noexcept;
+        ~Handle();
+
+        [[nodiscard]] std::uint8_t* data() const noexcept;
+        [[nodiscard]] std::size_t size() const noexcept;
+        [[nodiscard]] PixelFormat format() const noexcept;
+        [[nodiscard]] bool empty() const noexcept { return block_ == nullptr; }
+        [[nodiscard]] std::uint32_t useCount() const noexcept;
+        void reset() noexcept;
+
+    private:
+        friend class FramePool;
+        explicit Handle(Block* block) noexcept : block_(block) {}
+
+        Block* block_ = nullptr;
+    };
+
+    explicit FramePool(std::size_t limitBytes = kDefaultLimitBytes);
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Returns an empty handle when the buffer cannot fit under the limit even
+    // after dropping every cached buffer.
+    [[nodiscard]] Handle acquire(std::size_t bytes, PixelFormat format);
+
+    void setLimit(std::size_t limitBytes);
+    void trim();
+
+    // Number of buffers ever taken from the heap; flat in steady state.
+    [[nodiscard]] std::uint64_t allocationCount() const;
+    [[nodiscard]] std::size_t totalBytes() const;
+    [[nodiscard]] std::size_t cachedBytes() const;
+
+private:
+    static constexpr std::size_t kBucketCount = 4;
+
+    struct Bucket {
+        std::size_t bytes = 0;
+        PixelFormat format = PixelFormat::BGRA8;
+        Block* freeList = nullptr;
+        std::uint64_t lastUse = 0;
+        bool used = false;
+    };
+
+    Bucket* findBucketLocked(std::size_t bytes, PixelFormat format);
+    Bucket& claimBucketLocked(std::size_t bytes, PixelFormat format);
+    bool evictOneLocked(const Bucket* keep);
+    void releaseFreeListLocked(Bucket& bucket);
+    void destroyBlockLocked(Block* block);
+    void recycle(Block* block) noexcept;
+
+    mutable std::mutex mutex_;
+    std::array<Bucket, kBucketCount> buckets_{};
+    std::size_t limitBytes_ = kDefaultLimitBytes;
+    std::size_t totalBytes_ = 0;
+    std::size_t cachedBytes_ = 0;
+    std::uint64_t allocations_ = 0;
+    std::uint64_t clock_ = 0;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "DirectShowCapture.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class AreaScaler;
+class DirtyTracker;
+class StripeWorkerPool;
+class ToneMapper;
+
+struct FrameSinkTarget {
+    std::uint8_t* data = nullptr;
+    std::uint32_t rowPitch = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    // DirtyTracker sequence of the frame the memory still holds; 0 if unknown.
+    std::uint64_t contentSequence = 0;
+};
+
+// Destination for captured frames. The capture thread asks the sink for
+// writable memory, copies the frame into it exactly once and commits it.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    // Returns false when the sink cannot accept a frame of this size right now.
+    virtual bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) = 0;
+    // `sequence` is the frame's DirtyTracker sequence, or 0 when untracked.
+    virtual void commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence) = 0;
+
+    void recordCopy(std::size_t bytes) noexcept
+    {
+        framesCopied_.fetch_add(1, std::memory_order_relaxed);
+        bytesCopied_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t framesCopied() const noexcept { return framesCopied_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t bytesCopied() const noexcept { return bytesCopied_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> framesCopied_{0};
+    std::atomic<std::uint64_t> bytesCopied_{0};
+};
+
+[[nodiscard]] inline std::size_t frameSourceStride(const DirectShowCapture::Frame& frame)
+{
+    if (frame.stride != 0)
+    {
+        return frame.stride;
+    }
+    const std::uint32_t sampleWidth = frame.sampleWidth != 0 ? frame.sampleWidth : frame.width;
+    return pixelFormatRowBytes(frame.format, sampleWidth);
+}
+
+inline constexpr std::size_t kMissingSourceRow = static_cast<std::size_t>(-1);
+
+// Offset into frame.data of the first active pixel of row `y` of the active
+// content rectangle, counted top-down. frame.width/height describe that
+// rectangle; the sample buffer around it may be letterboxed or overscanned and
+// stored bottom-up. Returns kMissingSourceRow when the row lies outside the
+// sample.
+[[nodiscard]] inline std::size_t frameSourceRowOffset(const DirectShowCapture::Frame& frame, std::uint32_t y)
+{
+    const std::uint32_t sampleHeight = frame.sampleHeight != 0 ? frame.sampleHeight : frame.height;
+    const std::uint64_t imageRow = static_cast<std::uint64_t>(frame.contentTop) + y;
+    if (imageRow >= sampleHeight)
+    {
+        return kMissingSourceRow;
+    }
+    const std::uint64_t srcIndex = frame.bottomUp ? (sampleHeight - 1 - imageRow) : imageRow;
+    return static_cast<std::size_t>(srcIndex) * frameSourceStride(frame) + pixelFormatRowOffset(frame.format, frame.contentLeft);
+}
+
+// Offset into frame.data of the CbCr pair of the first active pixel of row
+// `y` in a semi-planar frame; each chroma row serves two luma rows. Returns
+// kMissingSourceRow when the row lies outside the sample.
+[[nodiscard]] inline std::size_t frameChromaRowOffset(const DirectShowCapture::Frame& frame, std::uint32_t y)
+{
+    const std::uint32_t sampleHeight = frame.sampleHeight != 0 ? frame.sampleHeight : frame.height;
+    const std::uint64_t imageRow = static_cast<std::uint64_t>(frame.contentTop) + y;
+    if (imageRow >= sampleHeight)
+    {
+        return kMissingSourceRow;
+    }
+    const std::size_t lumaStride = frameSourceStride(frame);
+    const std::size_t planeOffset = frame.chromaOffset != 0 ? frame.chromaOffset : lumaStride * sampleHeight;
+    const std::size_t chromaStride = frame.chromaStride != 0 ? frame.chromaStride : lumaStride;
+    return planeOffset + static_cast<std::size_t>(imageRow / 2) * chromaStride + pixelFormatRowOffset(frame.format, frame.contentLeft);
+}
+
+struct FrameWriteOptions {
+    // With a tracker and the frame's sequence from DirtyTracker::analyze(),
+    // only the tiles that changed since the frame the sink memory already
+    // holds are copied, so an accepted frame may write nothing at all.
+    DirtyTracker* tracker = nullptr;
+    std::uint64_t sequence = 0;
+    // Large copies are split into horizontal bands across these workers.
+    StripeWorkerPool* workers = nullptr;
+    // Converts PQ frames to SDR; without one they are shown as if SDR.
+    const ToneMapper* toneMapper = nullptr;
+    // Shrinks the frame to the scaler's output size on the way. Ignored when
+    // its source size is not the frame's.
+    const AreaScaler* scaler = nullptr;
+};
+
+struct FrameWriteResult {
+    bool accepted = false;
+    std::size_t bytesWritten = 0;
+};
+
+// Copies the active rectangle of a captured frame top-down into the sink,
+// converting YUV formats to BGRA (and downscaling, if asked) on the way.
+FrameWriteResult writeFrameToSink(const DirectShowCapture::Frame& frame,
+                                  FrameSink& sink,
+                                  const FrameWriteOptions& options = {});
@@ -10,6 +10,7 @@
 
 constexpr UINT WM_INPUT_CAPTURE_SHOW_MENU = WM_APP + 0x201;
 constexpr UINT WM_INPUT_CAPTURE_UPDATE_CLIP = WM_APP + 0x202;
+constexpr UINT WM_INPUT_CAPTURE_SCREENSHOT = WM_APP + 0x203;
 
 class SerialStreamer;
 
@@ -92,6 +93,7 @@ private:
     bool leftWin_ = false;
     bool rightWin_ = false;
     bool menuChordLatched_ = false;
+    bool screenshotChordLatched_ = false;
     std::atomic<bool> relativeCaptureSuspended_{false};
     POINT relativeAnchorPoint_{};
     bool cursorHidden_ = false;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// x86 extensions usable by this process (CPU and OS support), probed once.
+// All false on other architectures; SSE2 is assumed on x86-64.
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool avx2 = false;
+    bool avx512f = false;
+};
+
+[[nodiscard]] const CpuFeatures& cpuFeatures();
+
+// Instruction sets kernels are written for, narrowest first. Every kernel
+// family maps its own tiers onto these.
+enum class SimdLevel : unsigned int {
+    Scalar = 0,
+    SSE2 = 1,
+    SSSE3 = 2,
+    AVX2 = 3,
+    AVX512 = 4,
+};
+
+// The widest level this CPU and OS can run.
+[[nodiscard]] SimdLevel detectedSimdLevel();
+[[nodiscard]] const char* simdLevelName(SimdLevel level);
+
+// Accepts the lower-case names ("scalar", "sse2", "ssse3", "avx2", "avx512").
+[[nodiscard]] bool parseSimdLevel(std::string_view text, SimdLevel& level);
+
+// Set to one of the names above to cap every kernel family, e.g. for A/B
+// timing; wins over the settings file.
+inline constexpr const char* kSimdLevelEnvironmentVariable = "PCKVM_SIMD";
+
+// The level from kSimdLevelEnvironmentVariable, or `fallback` when it is
+// unset or not a level name.
+[[nodiscard]] SimdLevel simdLevelFromEnvironment(SimdLevel fallback);
+
+struct KernelFamilyReport {
+    const char* family = "";
+    // Tier now in use.
+    const char* active = "";
+    // Tiers that did not match the scalar reference, comma separated.
+    std::string failed;
+};
+
+// The one place that picks the frame copy, pixel conversion, HDR tone mapping,
+// downscale, scaling filter and audio sample kernels. Until this runs each
+// family uses the widest tier the CPU supports.
+//
+// The first call checks every tier the CPU can run against its family's
+// scalar reference on synthetic data. Each family then switches to the widest
+// tier that passed and needs no more than `limit`. May be called again at any
+// time: threads in the middle of a row finish it with the old kernel and pick
+// up the new one on their next call.
+std::vector<KernelFamilyReport> configureKernels(SimdLevel limit);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Monotonic nanoseconds shared by every latency stamp in the pipeline.
+std::uint64_t latencyClockNs();
+
+// Log-linear histogram in the style of HdrHistogram: 128 linear sub-buckets
+// per power of two, so any recorded value is reported within 1/64 of itself.
+// record() is lock-free and may run on any thread concurrently with readers.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 7;
+    static constexpr std::uint64_t kSubBucketCount = 1ull << kSubBucketBits;
+    static constexpr unsigned kMaxValueBits = 40;  // ~18 minutes in nanoseconds
+    static constexpr std::size_t kBucketCount =
+        kSubBucketCount + (kMaxValueBits - kSubBucketBits) * (kSubBucketCount / 2);
+
+    void record(std::uint64_t value) noexcept;
+    void reset() noexcept;
+
+    [[nodiscard]] std::uint64_t count() const noexcept { return total_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+    [[nodiscard]] double mean() const noexcept;
+
+    // Smallest recorded-value bound that at least `quantile` of the samples
+    // fall under, e.g. 0.99 for p99. Returns 0 when empty.
+    [[nodiscard]] std::uint64_t valueAtQuantile(double quantile) const noexcept;
+
+    [[nodiscard]] static std::size_t bucketIndex(std::uint64_t value) noexcept;
+    [[nodiscard]] static std::uint64_t bucketUpperBound(std::size_t index) noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBucketCount> counts_{};
+    std::atomic<std::uint64_t> total_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+// Monotonic stamps a frame collects on its way from the capture callback to
+// the screen. Zero means "not reached".
+struct FrameTimestamps {
+    std::uint64_t captured = 0;   // BufferCB entry
+    std::uint64_t handled = 0;    // handleFrame finished writing the frame
+    std::uint64_t uploaded = 0;   // render thread picked it up for the GPU
+    std::uint64_t submitted = 0;  // command list submitted
+    std::uint64_t presented = 0;  // Present returned
+};
+
+enum class LatencyStage : std::size_t {
+    Handle,
+    Queue,
+    Record,
+    Present,
+    Total,
+    Count
+};
+
+class LatencyTracker {
+public:
+    static constexpr std::size_t kStageCount = static_cast<std::size_t>(LatencyStage::Count);
+
+    // Adds one histogram sample per stage whose two stamps are both present.
+    void record(const FrameTimestamps& stamps) noexcept;
+    void reset() noexcept;
+
+    [[nodiscard]] const LatencyHistogram& histogram(LatencyStage stage) const noexcept
+    {
+        return histograms_[static_cast<std::size_t>(stage)];
+    }
+    [[nodiscard]] static const char* stageName(LatencyStage stage) noexcept;
+
+    // Plain-text table of count, p50, p99, p99.9 and max per stage.
+    [[nodiscard]] std::string formatReport() const;
+    bool writeReport(const std::string& path) const;
+
+private:
+    std::array<LatencyHistogram, kStageCount> histograms_{};
+};
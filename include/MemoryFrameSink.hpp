@@ -0,0 +1,40 @@
+#pragma once
+
+#include "FrameMailbox.hpp"
+#include "FramePool.hpp"
+#include "FrameSink.hpp"
+#include "LatencyStats.hpp"
+
+#include <cstdint>
+
+struct CpuFrame {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t stride = 0;
+    std::uint64_t timestamp100ns = 0;
+    std::uint64_t sequence = 0;
+    FrameTimestamps timestamps;
+    FramePool::Handle data;
+};
+
+// System-memory sink behind a triple-buffer mailbox. The renderer falls back to
+// it while its upload ring is being (re)allocated, and it needs no GPU at all.
+// Slot storage comes from a FramePool and is only swapped on a size change.
+class MemoryFrameSink : public FrameSink {
+public:
+    explicit MemoryFrameSink(FramePool& pool) : pool_(pool) {}
+
+    bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) override;
+    void commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence) override;
+
+    [[nodiscard]] const CpuFrame* acquireLatest() noexcept { return mailbox_.acquireLatest(); }
+    [[nodiscard]] const CpuFrame& frontFrame() const noexcept { return mailbox_.frontSlot(); }
+    [[nodiscard]] std::uint64_t overwrittenCount() const noexcept { return mailbox_.overwrittenCount(); }
+
+    // Only valid while no capture is running.
+    void reset() { mailbox_.reset(); }
+
+private:
+    FramePool& pool_;
+    FrameMailbox<CpuFrame> mailbox_;
+};
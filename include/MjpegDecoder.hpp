@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CaptureSource.hpp"
+#include "FramePool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class StripeWorkerPool;
+struct MjpegDecoderState;
+
+// Baseline JPEG decoder for Motion JPEG capture. Pictures decode into
+// FramePool buffers as YUY2 (4:2:2 and 4:4:4 sources) or NV12 (4:2:0 and
+// greyscale), so colour conversion, dirty tracking and the sink copy treat
+// them like uncompressed capture. When the stream has restart intervals they
+// are entropy-decoded in parallel on the worker pool. A bitstream identical
+// to the previous one is not decoded again.
+//
+// One caller at a time; the decoded frame stays valid until the next call.
+class MjpegDecoder {
+public:
+    enum class Result {
+        Decoded,
+        Duplicate,
+        Failed,
+    };
+
+    explicit MjpegDecoder(FramePool& pool, StripeWorkerPool* workers = nullptr);
+    ~MjpegDecoder();
+
+    MjpegDecoder(const MjpegDecoder&) = delete;
+    MjpegDecoder& operator=(const MjpegDecoder&) = delete;
+
+    // Decodes a frame whose format is MJPEG. On Decoded and Duplicate,
+    // `decoded` describes the picture and carries the input's timestamps.
+    Result decode(const CaptureSource::Frame& compressed, CaptureSource::Frame& decoded);
+
+    // Forgets the previous bitstream and returns the picture buffer to the
+    // pool. Call when the stream restarts.
+    void reset();
+
+    // Why the last Failed result happened.
+    [[nodiscard]] const std::string& lastError() const noexcept { return lastError_; }
+
+    [[nodiscard]] std::uint64_t framesDecoded() const noexcept { return framesDecoded_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t framesDuplicate() const noexcept { return framesDuplicate_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t framesFailed() const noexcept { return framesFailed_.load(std::memory_order_relaxed); }
+
+    // Reads the picture size from the frame header without decoding.
+    [[nodiscard]] static bool probe(const std::uint8_t* data, std::size_t size, std::uint32_t& width, std::uint32_t& height);
+
+    // Bytes from the SOI at `data` through the matching EOI, or 0 when the
+    // JPEG is incomplete or malformed.
+    [[nodiscard]] static std::size_t frameLength(const std::uint8_t* data, std::size_t size);
+
+private:
+    bool decodePicture(const std::uint8_t* data, std::size_t size);
+
+    FramePool& pool_;
+    StripeWorkerPool* workers_ = nullptr;
+    std::unique_ptr<MjpegDecoderState> state_;
+
+    FramePool::Handle output_;
+    CaptureSource::Frame picture_{};
+    std::vector<std::uint8_t> previous_;
+    bool previousValid_ = false;
+    std::string lastError_;
+
+    std::atomic<std::uint64_t> framesDecoded_{0};
+    std::atomic<std::uint64_t> framesDuplicate_{0};
+    std::atomic<std::uint64_t> framesFailed_{0};
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "CaptureSource.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Row converters from the capture formats to the BGRA the renderer samples.
+// Each format has a scalar reference and SIMD tiers that must match it bit
+// for bit; the widest tier the CPU supports is picked on first use, and
+// configureKernels() may switch it later.
+
+// YCbCr -> RGB in Q13 fixed point:
+//   luma = (Y - lumaOffset) * lumaScale + 2^12
+//   B = (luma + cbToB * Cb) >> 13
+//   G = (luma - cbToG * Cb - crToG * Cr) >> 13
+//   R = (luma + crToR * Cr) >> 13
+// with Cb/Cr centred on zero and every channel clamped to [0, 255]. 10-bit
+// samples use lumaOffset * 4, a rounding term of 2^14 and a shift of 15, so
+// their two extra bits survive until the end.
+struct YuvCoefficients {
+    std::int16_t lumaScale = 0;
+    std::int16_t lumaOffset = 0;
+    std::int16_t crToR = 0;
+    std::int16_t cbToG = 0;
+    std::int16_t crToG = 0;
+    std::int16_t cbToB = 0;
+};
+
+[[nodiscard]] YuvCoefficients yuvCoefficients(CaptureSource::ColorMatrix matrix, bool fullRange);
+
+enum class ConversionTier {
+    Scalar,
+    SSSE3,
+    AVX2,
+};
+
+// Converts `pixels` pixels of a packed 4:2:2 row to BGRA. `src` must point at
+// the start of a pixel pair; an odd count ends on the first half of a pair.
+using Packed422RowFn = void (*)(std::uint8_t* dst,
+                                const std::uint8_t* src,
+                                std::size_t pixels,
+                                const YuvCoefficients& coefficients);
+
+// A specific tier for YUY2 or UYVY, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] Packed422RowFn packed422Kernel(CaptureSource::PixelFormat format, ConversionTier tier);
+
+// Converts `pixels` pixels of a semi-planar (NV12/P010) row to BGRA. `luma`
+// points at the first pixel's Y sample and `chroma` at its Cb Cr pair, so the
+// row starts on an even column.
+using SemiPlanarRowFn = void (*)(std::uint8_t* dst,
+                                 const std::uint8_t* luma,
+                                 const std::uint8_t* chroma,
+                                 std::size_t pixels,
+                                 const YuvCoefficients& coefficients);
+
+// A specific tier for NV12 or P010, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] SemiPlanarRowFn semiPlanarKernel(CaptureSource::PixelFormat format, ConversionTier tier);
+
+// Expands `pixels` pixels of an RGB24 or RGB565 row to BGRA with opaque
+// alpha. 5- and 6-bit channels repeat their top bits below themselves, so
+// black and full scale stay 0 and 255.
+using PackedRgbRowFn = void (*)(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels);
+
+// A specific tier for RGB24 or RGB565, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] PackedRgbRowFn packedRgbKernel(CaptureSource::PixelFormat format, ConversionTier tier);
+
+// Converts `pixels` pixels of a v210 row to BGRA. `src` must point at the
+// start of a 16-byte, six-pixel block; a count that is not a multiple of six
+// ends partway into a block, which must still be readable in full.
+using V210RowFn = void (*)(std::uint8_t* dst,
+                           const std::uint8_t* src,
+                           std::size_t pixels,
+                           const YuvCoefficients& coefficients);
+
+// A specific tier, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] V210RowFn v210Kernel(ConversionTier tier);
+
+[[nodiscard]] ConversionTier activeConversionTier();
+// Switches every format to `tier`; false, and no change, when it cannot run.
+bool setActiveConversionTier(ConversionTier tier);
+[[nodiscard]] const char* conversionTierName(ConversionTier tier);
+
+// Writes `pixels` BGRA pixels converted from a row of a packed `format`. BGRA
+// rows are copied with streamCopy(); RGB formats ignore `coefficients`; v210
+// rows must start on a block.
+void convertRowToBgra(CaptureSource::PixelFormat format,
+                      std::uint8_t* dst,
+                      const std::uint8_t* src,
+                      std::size_t pixels,
+                      const YuvCoefficients& coefficients);
+
+void convertSemiPlanarRowToBgra(CaptureSource::PixelFormat format,
+                                std::uint8_t* dst,
+                                const std::uint8_t* luma,
+                                const std::uint8_t* chroma,
+                                std::size_t pixels,
+                                const YuvCoefficients& coefficients);
+
+// Same as convertRowToBgra() for a v210 row that starts `skip` (< 6) pixels
+// into the block at `src`.
+void convertV210RowToBgra(std::uint8_t* dst,
+                          const std::uint8_t* src,
+                          std::size_t skip,
+                          std::size_t pixels,
+                          const YuvCoefficients& coefficients);
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "LatencyStats.hpp"
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Follows a periodic event stream, such as frame arrivals or vblanks, with a
+// second-order tracking loop. Each event is predicted from the estimated
+// phase and period, and the prediction error corrects both. The gains start
+// at those of a growing least-squares line fit, so the loop locks within a
+// few events, and then settle at kSteadyGain, which averages jitter out while
+// still following clock drift. The spread of the errors is tracked too.
+class CadenceTracker {
+public:
+    static constexpr unsigned kLockEvents = 8;
+    static constexpr double kSteadyGain = 0.02;
+    // Once locked, events further than this fraction of a period from their
+    // prediction are ignored; more than kMaxOutliers in a row (a mode change
+    // or a stalled source) start the loop over.
+    static constexpr double kOutlierFraction = 0.4;
+    static constexpr unsigned kMaxOutliers = 4;
+
+    void reset() noexcept;
+
+    // `index` numbers the event within its stream: gaps are missed events,
+    // and an index that does not increase is ignored.
+    void observe(std::int64_t index, std::uint64_t timeNs) noexcept;
+
+    [[nodiscard]] bool locked() const noexcept { return events_ >= kLockEvents; }
+    [[nodiscard]] bool hasPeriod() const noexcept { return events_ >= 2 && period_ > 0.0; }
+    [[nodiscard]] double periodNs() const noexcept { return period_; }
+    [[nodiscard]] std::int64_t lastIndex() const noexcept { return index_; }
+    // RMS distance of events from their prediction.
+    [[nodiscard]] double jitterNs() const noexcept;
+
+    // When event `index` is expected, on the loop's smoothed time line.
+    [[nodiscard]] double timeOf(std::int64_t index) const noexcept;
+    // The first event expected at or after `timeNs`. Needs hasPeriod().
+    [[nodiscard]] std::int64_t firstIndexAtOrAfter(double timeNs) const noexcept;
+
+private:
+    std::int64_t index_ = 0;
+    double time_ = 0.0;
+    double period_ = 0.0;
+    double variance_ = 0.0;
+    unsigned events_ = 0;
+    unsigned outliers_ = 0;
+};
+
+// Times presents against the capture cadence. Frames are numbered from
+// their capture timestamps and their arrivals tracked on the latency clock;
+// vblanks are tracked from the swap chain's frame statistics. Each frame is
+// then aimed at the first vblank after its predicted arrival that leaves
+// time to render and room for kJitterSigmas of arrival jitter:
+// - A frame that arrives early is held until the vblank before its target
+//   has passed, so jitter cannot pull it a refresh forward and leave its
+//   neighbours showing twice.
+// - A frame that arrives too late for its target is shown on the next
+//   vblank it can make, unless that belongs to the next frame. Presenting it
+//   there would push every following frame a refresh later, so it waits
+//   there instead and is replaced if the next frame turns up.
+// - When the two clocks drift (59.94 Hz capture on a 60 Hz display), the
+//   target stays with the cadence until the lead leaves the hysteresis band.
+//   That gives one repeat per slip instead of a burst of repeats and drops.
+//
+// observeFrame() and frameDelivered() run on the capture thread; everything
+// else runs on the render thread. The statistics can be read from either.
+class PresentPacer {
+public:
+    // Time to render and present a frame ahead of the vblank it has to make.
+    static constexpr std::uint64_t kLatchMarginNs = 2'000'000;
+    // Arrival jitter the target vblank leaves room for, in RMS multiples.
+    static constexpr double kJitterSigmas = 3.0;
+    // How far the lead may grow past margin + refresh before the frame moves
+    // to an earlier vblank. Below the margin it moves to a later one at once:
+    // a frame that cannot make its vblank would wait for the next frame's and
+    // be dropped.
+    static constexpr std::uint64_t kHysteresisNs = 1'000'000;
+    // A present this long after a vblank cannot land on it any more.
+    static constexpr std::uint64_t kVBlankGuardNs = 500'000;
+    // More missing frames than this and the source is tracked afresh.
+    static constexpr std::int64_t kMaxFrameGap = 30;
+
+    // Every frame the source delivers, including ones that repeat the last
+    // and are never presented, so a static screen keeps the cadence locked.
+    void observeFrame(std::uint64_t timestamp100ns, std::uint64_t arrivalNs);
+    // The frame last observed is new and on its way to the display. Frames
+    // observed but not delivered are neither presented nor counted as dropped.
+    void frameDelivered();
+
+    // When to present the newest frame: 0 for now, otherwise a
+    // latencyClockNs() time to wait for. Always 0 until both cadences lock.
+    std::uint64_t presentNotBefore(std::uint64_t nowNs);
+
+    // The newest frame went out as Present number `presentId`.
+    void presented(std::uint32_t presentId);
+
+    // From the swap chain's frame statistics: Present `presentId` reached
+    // the screen on vblank `presentRefresh`, and vblank `syncRefresh`
+    // happened at `syncNs`.
+    void observeDisplay(std::uint32_t presentId, std::uint64_t presentRefresh, std::uint64_t syncRefresh, std::uint64_t syncNs);
+
+    // Frames seen on screen, frames that were delivered but replaced before
+    // they got there, and frames held longer than the cadence ever requires.
+    [[nodiscard]] std::uint64_t framesShown() const;
+    [[nodiscard]] std::uint64_t framesDropped() const;
+    [[nodiscard]] std::uint64_t framesRepeated() const;
+    // Arrival to the vblank that showed the frame.
+    [[nodiscard]] const LatencyHistogram& scanoutLatency() const noexcept { return scanoutLatency_; }
+    [[nodiscard]] double sourcePeriodNs() const;
+    [[nodiscard]] bool sourceLocked() const;
+    [[nodiscard]] double refreshPeriodNs() const;
+
+    [[nodiscard]] std::string formatReport() const;
+
+private:
+    struct PendingPresent {
+        std::uint32_t presentId = 0;
+        std::int64_t frame = 0;
+        std::uint64_t delivered = 0;
+        std::uint64_t arrivalNs = 0;
+    };
+
+    void frameShown(const PendingPresent& present, std::uint64_t refresh);
+
+    mutable std::mutex mutex_;
+    CadenceTracker source_;
+    CadenceTracker display_;
+
+    // The newest frame observed, numbered on the source cadence.
+    std::int64_t captured_ = 0;
+    std::uint64_t observed_ = 0;
+    std::uint64_t lastTimestamp100ns_ = 0;
+    std::uint64_t lastArrivalNs_ = 0;
+
+    // The newest frame delivered, which the plan and presents refer to.
+    std::int64_t frame_ = 0;
+    std::uint64_t delivered_ = 0;
+    std::uint64_t frameArrivalNs_ = 0;
+
+    bool planned_ = false;
+    std::int64_t plannedFrame_ = 0;
+    std::int64_t plannedVBlank_ = 0;
+    double plannedArrivalNs_ = 0.0;
+
+    std::array<PendingPresent, 8> pending_{};
+    std::size_t pendingCount_ = 0;
+    std::int64_t lastPresentedFrame_ = -1;
+
+    bool shown_ = false;
+    PendingPresent lastShown_{};
+    std::uint64_t lastShownRefresh_ = 0;
+    std::uint64_t framesShown_ = 0;
+    std::uint64_t framesDropped_ = 0;
+    std::uint64_t framesRepeated_ = 0;
+    LatencyHistogram scanoutLatency_;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Downscale.hpp"
+#include "FramePool.hpp"
+#include "FrameSink.hpp"
+#include "MemoryFrameSink.hpp"
+#include "ScalingFilter.hpp"
+#include "Settings.hpp"
+#include "ToneMapping.hpp"
+#include "VideoViewport.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Draws a BGRA texture into `viewport` of a BGRA target as D3DRenderer's
+// quad does: the target is cleared to opaque black, and every pixel of the
+// viewport (clipped to the target) samples the texture at its centre with
+// bilinear filtering and clamped edges. Filter weights have eight fractional
+// bits and the result rounds to nearest, as D3D hardware filters UNORM
+// textures; GPUs may still differ by one step where their interpolated
+// coordinate rounds the other way.
+void compositeTexture(std::uint8_t* target,
+                      std::size_t targetPitch,
+                      std::uint32_t targetWidth,
+                      std::uint32_t targetHeight,
+                      const ViewportRect& viewport,
+                      const std::uint8_t* texture,
+                      std::size_t texturePitch,
+                      std::uint32_t textureWidth,
+                      std::uint32_t textureHeight);
+
+struct ReferenceRenderOptions {
+    VideoAspectMode aspectMode = VideoAspectMode::Maintain;
+    // As AppSettings::videoDownscale.
+    bool downscale = true;
+    // As AppSettings::videoScalingFilter.
+    ScalingFilter filter = ScalingFilter::Bilinear;
+    const ToneMapper* toneMapper = nullptr;
+};
+
+// CPU stand-in for the window: a frame goes through the same viewport choice,
+// downscaling and frame copy as Application, then the scaling filter's CPU
+// kernels (compositeTexture() for bilinear). Needs no GPU, so the whole path
+// can be checked against golden images and timed anywhere.
+class ReferenceRenderer {
+public:
+    ReferenceRenderer() = default;
+    ReferenceRenderer(const ReferenceRenderer&) = delete;
+    ReferenceRenderer& operator=(const ReferenceRenderer&) = delete;
+
+    // Renders `frame` as a clientWidth x clientHeight client area would show
+    // it. False, leaving the image cleared, when the frame has no pixels to
+    // draw (compressed frames must be decoded first).
+    bool render(const DirectShowCapture::Frame& frame,
+                std::uint32_t clientWidth,
+                std::uint32_t clientHeight,
+                const ReferenceRenderOptions& options = {});
+
+    // The last image, top-down BGRA with width() * 4 bytes per row.
+    [[nodiscard]] const std::uint8_t* pixels() const noexcept { return image_.data(); }
+    [[nodiscard]] std::uint32_t width() const noexcept { return width_; }
+    [[nodiscard]] std::uint32_t height() const noexcept { return height_; }
+    [[nodiscard]] std::size_t stride() const noexcept { return static_cast<std::size_t>(width_) * 4; }
+
+    // Where the video went, and the size of the texture it was sampled from.
+    [[nodiscard]] const ViewportRect& viewport() const noexcept { return viewport_; }
+    [[nodiscard]] std::uint32_t textureWidth() const noexcept { return textureWidth_; }
+    [[nodiscard]] std::uint32_t textureHeight() const noexcept { return textureHeight_; }
+
+private:
+    FramePool pool_;
+    MemoryFrameSink texture_{pool_};
+    std::optional<AreaScaler> scaler_;
+    std::optional<FilterScaler> filterScaler_;
+    ScalingScratch scalingScratch_;
+    std::vector<std::uint8_t> sharpened_;
+    std::vector<std::uint8_t> image_;
+    std::uint32_t width_ = 0;
+    std::uint32_t height_ = 0;
+    ViewportRect viewport_;
+    std::uint32_t textureWidth_ = 0;
+    std::uint32_t textureHeight_ = 0;
+
+    void composite(const CpuFrame& texture, ScalingFilter filter);
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// What can wake the render thread; combined as a bit mask.
+enum RenderWake : unsigned {
+    kWakeFrame = 1u << 0,     // the capture thread published a frame
+    kWakeMessage = 1u << 1,   // window messages are queued
+    kWakeSwapChain = 1u << 2, // the swap chain can queue another frame
+    kWakeOverlay = 1u << 3,   // a redraw was requested without a new frame
+};
+
+inline constexpr std::uint64_t kWaitForever = ~std::uint64_t{0};
+
+// The objects the render thread sleeps on. The window implements it with
+// MsgWaitForMultipleObjectsEx; ConditionRenderWaitSet is a portable one for
+// synthetic producers.
+class RenderWaitSet {
+public:
+    virtual ~RenderWaitSet() = default;
+
+    // Blocks until a source in `sources` is signalled or `timeoutNs` passes,
+    // then returns the signalled ones (0 on timeout). Event sources are
+    // consumed; kWakeMessage stays set until the caller drains the queue.
+    virtual unsigned wait(unsigned sources, std::uint64_t timeoutNs) = 0;
+};
+
+// Decides when the render loop presents and what it sleeps on meanwhile.
+// Work is a new frame, a requested redraw, or an overlay with changes still
+// to draw, which redraws on every swap-chain slot until it settles.
+// Work waits for the swap chain to take another frame, and for any hold, so
+// frames arriving in the meantime are coalesced and the newest one is
+// presented the moment there is room. Without work only frames, messages and
+// redraw requests are waited for, so an idle window costs no CPU.
+class RenderScheduler {
+public:
+    // A swap chain that never signals (e.g. while the window is occluded)
+    // is assumed ready after this long, so work is never stuck.
+    static constexpr std::uint64_t kSwapChainTimeoutNs = 100'000'000;
+
+    // `swapChainWaitable`: whether kWakeSwapChain is ever signalled; without
+    // it the swap chain is always treated as ready.
+    explicit RenderScheduler(bool swapChainWaitable = true) : swapChainWaitable_(swapChainWaitable) {}
+
+    void setSwapChainWaitable(bool waitable);
+    // Overlay changing: redraw on every swap-chain slot.
+    void setContinuousRedraw(bool enabled) { continuous_ = enabled; }
+
+    // Records wakes seen outside waitForWork(), e.g. a forced redraw.
+    void notify(unsigned wakes);
+
+    // Keeps pending work from rendering before `timeNs` (latencyClockNs()),
+    // e.g. to pace presents; rendered() lifts it.
+    void holdUntil(std::uint64_t timeNs) { holdUntilNs_ = timeNs; }
+
+    [[nodiscard]] bool hasWork() const noexcept { return framePending_ || redrawPending_ || continuous_; }
+    [[nodiscard]] bool framePending() const noexcept { return framePending_; }
+    [[nodiscard]] bool shouldRender() const { return hasWork() && swapChainReady_ && !held(); }
+    // The sources waitForWork() sleeps on in the current state.
+    [[nodiscard]] unsigned waitSources() const noexcept;
+
+    // Sleeps on `waitSet` until shouldRender(), a window message or, during
+    // a hold, a new frame, and returns every wake it saw. Messages are
+    // checked without blocking even when there is already work, so input is
+    // never starved by video.
+    unsigned waitForWork(RenderWaitSet& waitSet);
+
+    // After the loop rendered: pending work is done and, when it `presented`
+    // to a waitable swap chain, the next present waits for its signal.
+    void rendered(bool presented);
+
+private:
+    [[nodiscard]] bool held() const;
+
+    bool swapChainWaitable_;
+    bool swapChainReady_ = true;
+    bool framePending_ = false;
+    bool redrawPending_ = false;
+    bool continuous_ = false;
+    std::uint64_t holdUntilNs_ = 0;
+};
+
+// RenderWaitSet over a mutex and condition variable: any thread calls
+// signal(), and every source behaves as an auto-reset event.
+class ConditionRenderWaitSet : public RenderWaitSet {
+public:
+    void signal(unsigned sources);
+    unsigned wait(unsigned sources, std::uint64_t timeoutNs) override;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned signalled_ = 0;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "DirtyTracker.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How the video texture is resampled into the viewport. D3DRenderer has a
+// pixel shader for each; the kernels below compute the same filters on the
+// CPU for the reference renderer.
+//   Bilinear: the hardware sampler (compositeTexture() on the CPU)
+//   Nearest:  the texel under each pixel's centre; with the viewport snapped
+//             to a whole multiple of the texture (snapViewportToIntegerScale)
+//             every texel becomes an exact square block
+//   Bicubic:  Catmull-Rom over 4x4 texels; sharper edges, a slight halo
+//   Lanczos3: Lanczos-windowed sinc over 6x6 texels; sharpest, some ringing
+//   Sharpen:  contrast-adaptive sharpening of each texel against its four
+//             neighbours, then bilinear. Strongest where contrast is low,
+//             so text gains edge without flat areas turning grainy
+// Every filter samples pixel i of an extent-E viewport at texel coordinate
+// (i + 0.5) * size / E - 0.5 and repeats edge texels past the border.
+enum class ScalingFilter : unsigned int {
+    Bilinear = 0,
+    Nearest = 1,
+    Bicubic = 2,
+    Lanczos3 = 3,
+    Sharpen = 4,
+};
+
+inline constexpr unsigned int kScalingFilterCount = 5;
+
+[[nodiscard]] const char* scalingFilterName(ScalingFilter filter);
+
+// Sharpen strength from 0 (mild) to 1 (strongest), and the negative
+// neighbour weight it gives at full amplitude. Shared with the shader.
+inline constexpr float kSharpenStrength = 0.5f;
+inline constexpr float kSharpenPeak = -1.0f / (8.0f - 3.0f * kSharpenStrength);
+
+// CPU kernels. Bicubic and Lanczos run separably in fixed point:
+//   horizontal: Q14 taps over source bytes, (+2^7 >> 8) to Q6 int16, which
+//               keeps negative lobes and overshoot past 255
+//   vertical:   Q14 taps over those Q6 rows, (+2^19 >> 20) clamped to bytes
+// Sharpening works in float with exactly rounded operations only (no
+// reciprocal estimates), so every tier matches the scalar one bit for bit;
+// the widest the CPU supports is picked on first use, and configureKernels()
+// may switch it later.
+enum class ScalingTier {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+struct ScalingKernels {
+    // dst[i] = src[columns[i]], whole BGRA pixels.
+    void (*gather)(std::uint32_t* dst, const std::uint32_t* src, const std::uint32_t* columns, std::size_t pixels);
+    // Pixel i blends `taps` source pixels from firstColumn[i] with
+    // weights[i * taps ...] into four Q6 channels.
+    void (*horizontal)(std::int16_t* dst,
+                       const std::uint8_t* src,
+                       const std::uint32_t* firstColumn,
+                       const std::int16_t* weights,
+                       std::size_t taps,
+                       std::size_t pixels);
+    // Blends `count` Q6 rows with `weights` into `values` bytes.
+    void (*vertical)(std::uint8_t* dst,
+                     const std::int16_t* const* rows,
+                     const std::int16_t* weights,
+                     std::size_t count,
+                     std::size_t values);
+    // Sharpens a row of BGRA pixels against its left and right neighbours
+    // and the pixels above and below; edge pixels stand in for the missing
+    // left and right ones.
+    void (*sharpen)(std::uint8_t* dst,
+                    const std::uint8_t* above,
+                    const std::uint8_t* row,
+                    const std::uint8_t* below,
+                    std::size_t pixels);
+};
+
+// A specific tier, or nullptr when this build or CPU cannot run it.
+[[nodiscard]] const ScalingKernels* scalingKernels(ScalingTier tier);
+
+[[nodiscard]] ScalingTier activeScalingTier();
+[[nodiscard]] const char* scalingTierName(ScalingTier tier);
+// False, and no change, when `tier` cannot run.
+bool setActiveScalingTier(ScalingTier tier);
+
+// Working memory for FilterScaler; one per thread, reused across frames.
+struct ScalingScratch {
+    std::vector<std::int16_t> filteredRows;
+    std::vector<std::uint32_t> filteredTags;
+    std::vector<const std::int16_t*> windowRows;
+};
+
+// Taps of a separable filter (Nearest, Bicubic or Lanczos3) for one texture
+// and viewport size. Immutable once built. Texels past the edges are folded
+// into the edge texel, which is the same as repeating it.
+class FilterScaler {
+public:
+    FilterScaler(ScalingFilter filter, std::uint32_t sourceWidth, std::uint32_t sourceHeight, std::uint32_t outputWidth, std::uint32_t outputHeight);
+
+    [[nodiscard]] ScalingFilter filter() const noexcept { return filter_; }
+    [[nodiscard]] std::uint32_t sourceWidth() const noexcept { return sourceWidth_; }
+    [[nodiscard]] std::uint32_t sourceHeight() const noexcept { return sourceHeight_; }
+    [[nodiscard]] std::uint32_t outputWidth() const noexcept { return outputWidth_; }
+    [[nodiscard]] std::uint32_t outputHeight() const noexcept { return outputHeight_; }
+
+    // Produces output pixels [left, right) x [top, bottom) of `region` from
+    // the BGRA `src`. `dst` points at the region's first pixel, so a viewport
+    // hanging off the target never needs a pointer outside it. Runs
+    // activeScalingTier().
+    void scaleRegion(std::uint8_t* dst,
+                     std::size_t dstPitch,
+                     const DirtyRect& region,
+                     const std::uint8_t* src,
+                     std::size_t srcPitch,
+                     ScalingScratch& scratch) const;
+
+    // Same, with a specific tier; false when this build or CPU cannot run it.
+    bool scaleRegionWith(ScalingTier tier,
+                         std::uint8_t* dst,
+                         std::size_t dstPitch,
+                         const DirtyRect& region,
+                         const std::uint8_t* src,
+                         std::size_t srcPitch,
+                         ScalingScratch& scratch) const;
+
+private:
+    struct Axis {
+        std::uint32_t taps = 0;
+        std::vector<std::uint32_t> first;
+        std::vector<std::int16_t> weights;
+    };
+
+    static Axis buildAxis(ScalingFilter filter, std::uint32_t source, std::uint32_t output);
+
+    ScalingFilter filter_;
+    std::uint32_t sourceWidth_;
+    std::uint32_t sourceHeight_;
+    std::uint32_t outputWidth_;
+    std::uint32_t outputHeight_;
+    Axis columns_;
+    Axis rows_;
+};
+
+// The Sharpen filter's first pass: `src` sharpened texel by texel into
+// `dst`, both width x height BGRA. Bilinear sampling of `dst` completes it.
+void sharpenTexture(std::uint8_t* dst,
+                    std::size_t dstPitch,
+                    const std::uint8_t* src,
+                    std::size_t srcPitch,
+                    std::uint32_t width,
+                    std::uint32_t height);
+
+// Same, with a specific tier; false when this build or CPU cannot run it.
+bool sharpenTextureWith(ScalingTier tier,
+                        std::uint8_t* dst,
+                        std::size_t dstPitch,
+                        const std::uint8_t* src,
+                        std::size_t srcPitch,
+                        std::uint32_t width,
+                        std::uint32_t height);
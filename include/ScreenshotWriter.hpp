@@ -0,0 +1,90 @@
+#pragma once
+
+#include "FramePool.hpp"
+#include "FrameSink.hpp"
+#include "MemoryFrameSink.hpp"
+#include "Settings.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StripeWorkerPool;
+
+struct ScreenshotResult {
+    bool saved = false;
+    std::vector<std::filesystem::path> files;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    // Encoding only, without the file writes.
+    double encodeMs = 0.0;
+    std::string error;
+};
+
+// Saves captured frames as lossless image files (see ImageEncoder) without
+// holding up capture or rendering. request() arms it from any thread; the
+// capture thread then writes the next frame into it like into any other
+// sink: at source resolution, tone mapped but never downscaled, and without
+// the overlay. A background thread encodes that copy and writes the files.
+// At most kMaxQueued copies wait for it; a request beyond that is dropped and
+// reported instead of making capture wait.
+class ScreenshotWriter : public FrameSink {
+public:
+    static constexpr std::size_t kMaxQueued = 2;
+
+    using CompletionHandler = std::function<void(const ScreenshotResult&)>;
+
+    ScreenshotWriter();
+    // Finishes the screenshots already copied.
+    ~ScreenshotWriter() override;
+
+    ScreenshotWriter(const ScreenshotWriter&) = delete;
+    ScreenshotWriter& operator=(const ScreenshotWriter&) = delete;
+
+    // Called on the writer thread once per request. Set it before the first.
+    void setCompletionHandler(CompletionHandler handler) { onComplete_ = std::move(handler); }
+
+    // Saves the next frame as `stem` plus ".png" and/or ".qoi", creating
+    // missing directories. Replaces a request that no frame has met yet.
+    void request(std::filesystem::path stem, ScreenshotFormat format);
+    [[nodiscard]] bool requested() const noexcept { return requested_.load(std::memory_order_acquire); }
+
+    // Capture thread, through writeFrameToSink(). Refuses frames unless a
+    // request is waiting.
+    bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) override;
+    void commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence) override;
+
+private:
+    struct Job {
+        CpuFrame frame;
+        std::filesystem::path stem;
+        ScreenshotFormat format = ScreenshotFormat::Png;
+        // Set, with no frame, for a request that could not be taken.
+        std::string error;
+    };
+
+    void enqueue(Job job);
+    void writerLoop();
+    static ScreenshotResult save(const Job& job, StripeWorkerPool* workers);
+
+    FramePool pool_;
+    CompletionHandler onComplete_;
+    std::atomic<bool> requested_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::filesystem::path requestStem_;
+    ScreenshotFormat requestFormat_ = ScreenshotFormat::Png;
+    std::deque<Job> queue_;
+    bool exitRequested_ = false;
+    // Between beginFrame() and commitFrame(); capture thread only.
+    std::optional<Job> pending_;
+    std::thread thread_;
+};
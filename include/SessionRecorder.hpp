@@ -0,0 +1,183 @@
+#pragma once
+
+#include "FramePool.hpp"
+#include "FrameSink.hpp"
+#include "MemoryFrameSink.hpp"
+#include "StripeWorkerPool.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RecordingFile;
+
+// Recording file layout, all integers little-endian:
+//
+//   file:    "PKVMREC1", u32 version, u32 tile size, then records
+//   record:  u32 type, u32 payload bytes, payload
+//   'FRAM':  u64 index, u64 timestamp100ns, u64 arrivalNs, u32 width,
+//            u32 height, u32 flags, u32 frames dropped since the previous
+//            record, the tile mask (one bit per tile, row-major, LSB first),
+//            then for every tile row with a bit set: u32 raw bytes, u32 stored
+//            bytes and the LZ4 block of its marked tiles, each tile's rows in
+//            order as BGR. Stored == raw means the bytes are not compressed
+//   'END ':  u64 frames recorded, u64 frames dropped
+//
+// A key frame (kRecordKeyFrame) marks every tile and stores its pixels. Other
+// frames mark the tiles that differ from the previous recorded frame and store
+// them XORed with it, so a cursor or a line of text in a tile costs little
+// more than the pixels that changed. Alpha is not stored.
+inline constexpr std::uint32_t kRecordingVersion = 1;
+inline constexpr std::uint32_t kRecordTileSize = 64;
+inline constexpr std::uint32_t kRecordKeyFrame = 1;
+
+struct SessionRecorderStats {
+    std::uint64_t framesRecorded = 0;
+    std::uint64_t framesDropped = 0;
+    std::uint64_t keyFrames = 0;
+    // BGR bytes of the recorded frames, and what reached the file for them.
+    std::uint64_t rawBytes = 0;
+    std::uint64_t fileBytes = 0;
+    double encodeMs = 0.0;
+};
+
+// Lossless recording of the captured video, for auditing sessions. It is a
+// FrameSink the capture thread writes the displayed frames into after the
+// renderer has them. Frames go into a small ring of slots that, like the
+// renderer's upload ring, only receive the tiles that changed since the slot
+// was last filled. An encoder thread compresses each frame's tile rows on its
+// own StripeWorkerPool and queues the result to the file, which is written
+// with overlapped I/O and a few writes in flight.
+//
+// Capture never waits for the recorder: when every slot is still waiting to
+// be encoded the frame is dropped and counted, in the stats and in the next
+// frame record.
+class SessionRecorder : public FrameSink {
+public:
+    static constexpr std::size_t kSlots = 4;
+    // Recorded frames between key frames.
+    static constexpr std::uint64_t kKeyFrameInterval = 600;
+
+    SessionRecorder();
+    // Stops the recording, if any.
+    ~SessionRecorder() override;
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    // Creates `path` (and missing directories) and records into it until
+    // stop(). Any earlier recording is stopped first.
+    bool start(const std::filesystem::path& path);
+    // Encodes the frames already taken, ends the file and returns the totals.
+    SessionRecorderStats stop();
+
+    [[nodiscard]] bool recording() const noexcept { return recording_.load(std::memory_order_acquire); }
+    [[nodiscard]] SessionRecorderStats stats() const;
+    // Why the last recording stopped early or failed to start, if it did.
+    [[nodiscard]] std::string error() const;
+
+    // Whether frames were dropped since the last one recorded. The next frame
+    // must then reach the recorder even when it matches the previous one, or
+    // the recording would stay on the dropped frame's predecessor.
+    [[nodiscard]] bool missedFrame() const;
+
+    // Capture thread, through writeFrameToSink().
+    bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) override;
+    void commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence) override;
+
+private:
+    enum class SlotState {
+        Free,
+        Writing,
+        Queued,
+        Encoding,
+    };
+
+    struct Slot {
+        CpuFrame frame;
+        SlotState state = SlotState::Free;
+        // Capture frames dropped while no slot was free, before this one.
+        std::uint32_t droppedBefore = 0;
+    };
+
+    struct BandScratch {
+        std::vector<std::uint8_t> raw;
+        std::vector<std::uint8_t> packed;
+        std::vector<std::uint8_t> marked;
+        std::vector<std::uint32_t> hashTable;
+    };
+
+    void encoderLoop();
+    // Appends the frame record to `out`; true for a key frame.
+    bool encodeFrame(const Slot& slot, std::vector<std::uint8_t>& out);
+    void fail(const std::string& message);
+
+    FramePool pool_;
+    std::array<Slot, kSlots> slots_{};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::size_t> queue_;
+    std::size_t writingSlot_ = kSlots;
+    std::atomic<bool> recording_{false};
+    bool stopRequested_ = false;
+    std::uint32_t droppedSinceCommit_ = 0;
+    std::string error_;
+    SessionRecorderStats stats_;
+
+    // Encoder thread only while recording.
+    std::unique_ptr<RecordingFile> file_;
+    std::unique_ptr<StripeWorkerPool> workers_;
+    std::vector<BandScratch> bands_;
+    // The previous recorded frame, BGRA, which non-key frames are coded against.
+    std::vector<std::uint8_t> reference_;
+    std::uint32_t referenceWidth_ = 0;
+    std::uint32_t referenceHeight_ = 0;
+    std::uint64_t frameIndex_ = 0;
+    std::thread thread_;
+};
+
+struct RecordedFrame {
+    std::uint64_t index = 0;
+    std::uint64_t timestamp100ns = 0;
+    std::uint64_t arrivalNs = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t flags = 0;
+    std::uint32_t droppedBefore = 0;
+    // Top-down BGRA, width * 4 bytes per row, alpha 255.
+    std::vector<std::uint8_t> pixels;
+};
+
+// Plays a recording back frame by frame, for review tools and tests.
+class RecordingReader {
+public:
+    bool open(const std::filesystem::path& path);
+    // False at the end of the recording or on a damaged record; see error().
+    bool next(RecordedFrame& frame);
+
+    [[nodiscard]] bool finished() const noexcept { return finished_; }
+    [[nodiscard]] std::uint64_t framesRecorded() const noexcept { return framesRecorded_; }
+    [[nodiscard]] std::uint64_t framesDropped() const noexcept { return framesDropped_; }
+    [[nodiscard]] const std::string& error() const noexcept { return error_; }
+
+private:
+    std::ifstream file_;
+    std::vector<std::uint8_t> payload_;
+    std::vector<std::uint8_t> raw_;
+    std::vector<std::uint8_t> reference_;
+    std::uint32_t referenceWidth_ = 0;
+    std::uint32_t referenceHeight_ = 0;
+    bool finished_ = false;
+    std::uint64_t framesRecorded_ = 0;
+    std::uint64_t framesDropped_ = 0;
+    std::string error_;
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "ScalingFilter.hpp"
+#include "ToneMapping.hpp"
+
 #include <string>
 #include <filesystem>
 
@@ -19,6 +22,13 @@ enum class VideoAspectMode : unsigned int {
     Capture = 2,
 };
 
+// Files a screenshot is saved as; see ImageEncoder.
+enum class ScreenshotFormat : unsigned int {
+    Png = 0,
+    Qoi = 1,
+    PngAndQoi = 2,
+};
+
 struct AppSettings {
     std::string videoDeviceMoniker;
     std::string audioDeviceMoniker;
@@ -34,6 +44,22 @@ struct AppSettings {
     unsigned int videoPreferredHeight = 0;
     bool videoAllowResizing = true;
     VideoAspectMode videoAspectMode = VideoAspectMode::Maintain;
+    // How the frame is resampled to the viewport; Nearest also snaps the
+    // viewport to a whole multiple of the source.
+    ScalingFilter videoScalingFilter = ScalingFilter::Bilinear;
+    // Shrink frames on the CPU when the window shows them much smaller.
+    bool videoDownscale = true;
+    // Time presents to the capture cadence; see PresentPacer. Off by default:
+    // it trades up to a refresh of latency for even frame pacing.
+    bool videoPresentPacing = false;
+    HdrInputMode hdrInput = HdrInputMode::Auto;
+    ToneMapCurve hdrToneMapCurve = ToneMapCurve::Hable;
+    unsigned int hdrPeakNits = 1000;
+    // "auto", or a SimdLevel name capping every kernel family.
+    std::string simdLevel = "auto";
+    ScreenshotFormat screenshotFormat = ScreenshotFormat::Png;
+    // Record every session losslessly under recordings\; see SessionRecorder.
+    bool sessionRecording = false;
     HotkeyConfig menuHotkey;
 };
 
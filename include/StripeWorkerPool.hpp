@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Small persistent thread pool for splitting one frame-sized job into stripes.
+// run() hands stripes to the workers and to the calling thread and returns
+// once every stripe is done. It never allocates, so it is safe on the
+// capture path. One caller at a time; stripe functions must not throw.
+class StripeWorkerPool {
+public:
+    explicit StripeWorkerPool(std::size_t workerCount = defaultWorkerCount());
+    ~StripeWorkerPool();
+
+    StripeWorkerPool(const StripeWorkerPool&) = delete;
+    StripeWorkerPool& operator=(const StripeWorkerPool&) = delete;
+
+    // Threads that execute stripes, the caller included.
+    [[nodiscard]] std::size_t concurrency() const noexcept { return workers_.size() + 1; }
+
+    // Calls fn(stripe) for every stripe in [0, stripes).
+    template <typename Fn>
+    void run(std::size_t stripes, Fn&& fn)
+    {
+        using Callable = std::remove_reference_t<Fn>;
+        dispatch(stripes,
+                 [](void* context, std::size_t stripe) { (*static_cast<Callable*>(context))(stripe); },
+                 const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    [[nodiscard]] static std::size_t defaultWorkerCount();
+
+private:
+    using Invoke = void (*)(void*, std::size_t);
+
+    void dispatch(std::size_t stripes, Invoke invoke, void* context);
+    void runStripes(std::size_t stripes, Invoke invoke, void* context);
+    void workerLoop();
+
+    std::mutex mutex_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    std::uint64_t generation_ = 0;
+    std::size_t activeWorkers_ = 0;
+    bool exitRequested_ = false;
+
+    std::size_t stripes_ = 0;
+    Invoke invoke_ = nullptr;
+    void* context_ = nullptr;
+    std::atomic<std::size_t> nextStripe_{0};
+    std::atomic<std::size_t> remaining_{0};
+
+    std::vector<std::thread> workers_;
+};
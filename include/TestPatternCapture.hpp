@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CaptureSource.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Generates BGRA frames on a timer, laid out like a capture card sample
+// (optionally bottom-up, optionally with a content rectangle inside a larger
+// sample), so the pipeline can be exercised and measured without hardware.
+class TestPatternCapture : public CaptureSource {
+public:
+    enum class Motion {
+        Static,         // colour bars that never change
+        MovingBox,      // static bars with a small box bouncing around
+        ScrollingBars,  // bars shifted every frame, so every tile changes
+        Noise,          // fresh random pixels every frame
+    };
+
+    struct Config {
+        std::uint32_t width = 1920;
+        std::uint32_t height = 1080;
+        double fps = 60.0;
+        bool bottomUp = false;
+        // Sample stride in bytes; 0 packs rows at width * 4.
+        std::uint32_t stride = 0;
+        // Active area inside the sample; all zero means the whole sample.
+        std::uint32_t contentLeft = 0;
+        std::uint32_t contentTop = 0;
+        std::uint32_t contentRight = 0;
+        std::uint32_t contentBottom = 0;
+        Motion motion = Motion::MovingBox;
+        // Deliver frames at `fps`; otherwise as fast as the handler returns.
+        bool paced = true;
+        // Stop after this many frames; 0 runs until stop().
+        std::uint64_t frameLimit = 0;
+    };
+
+    TestPatternCapture();
+    explicit TestPatternCapture(Config config);
+    ~TestPatternCapture() override;
+
+    // options.desiredWidth/desiredHeight, when set, override the configured size.
+    void start(FrameHandler handler, const Options& options) override;
+    void stop() override;
+
+    [[nodiscard]] std::string consumeLastError() override;
+    [[nodiscard]] std::string currentDeviceFriendlyName() const override;
+
+    [[nodiscard]] std::uint64_t framesDelivered() const noexcept { return framesDelivered_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t framesLate() const noexcept { return framesLate_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] static const char* motionName(Motion motion);
+
+    TestPatternCapture(const TestPatternCapture&) = delete;
+    TestPatternCapture& operator=(const TestPatternCapture&) = delete;
+
+private:
+    void run();
+    void drawBackground(std::uint32_t phase);
+    void drawBox(std::uint32_t left, std::uint32_t top, bool erase);
+    void drawNoise();
+    void renderFrame(std::uint64_t index);
+    [[nodiscard]] std::uint8_t* row(std::uint32_t y) noexcept;
+
+    Config config_;
+    FrameHandler handler_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    std::mutex errorMutex_;
+    std::string lastError_;
+
+    std::vector<std::uint8_t> buffer_;
+    std::vector<std::uint32_t> patternRows_;
+    std::uint32_t boxLeft_ = 0;
+    std::uint32_t boxTop_ = 0;
+    bool boxDrawn_ = false;
+    std::uint64_t noiseState_ = 0;
+
+    std::atomic<std::uint64_t> framesDelivered_{0};
+    std::atomic<std::uint64_t> framesLate_{0};
+};
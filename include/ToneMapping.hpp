@@ -0,0 +1,104 @@
+#pragma once
+
+#include "PixelConversion.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class ToneMapCurve : unsigned int {
+    Reinhard = 0,
+    Hable = 1,
+    // No curve: everything above SDR white clips.
+    Clip = 2,
+};
+
+// Whether P010 capture is treated as HDR10. Auto trusts what the source
+// signals, which for a capture card without colour info is
+// defaultTransferFunction(); Off suits cards that send SDR in 10 bits.
+enum class HdrInputMode : unsigned int {
+    Auto = 0,
+    On = 1,
+    Off = 2,
+};
+
+// Transfer the frame is converted with under `mode`. Only P010 can be PQ.
+[[nodiscard]] constexpr CaptureSource::TransferFunction resolveTransferFunction(HdrInputMode mode,
+                                                                                const CaptureSource::Frame& frame)
+{
+    switch (mode)
+    {
+    case HdrInputMode::On:
+        return frame.format == CaptureSource::PixelFormat::P010 ? CaptureSource::TransferFunction::PQ
+                                                                : CaptureSource::TransferFunction::SDR;
+    case HdrInputMode::Off:
+        return CaptureSource::TransferFunction::SDR;
+    case HdrInputMode::Auto:
+        break;
+    }
+    return frame.transfer;
+}
+
+struct ToneMapParams {
+    ToneMapCurve curve = ToneMapCurve::Hable;
+    // Brightest level the source is graded to; it lands on SDR peak white.
+    float peakNits = 1000.0f;
+    // Luminance that maps to SDR white (BT.2408 graphics white).
+    float whiteNits = 203.0f;
+};
+
+// Turns HDR10 rows (P010 samples, PQ transfer, BT.2020 primaries) into SDR
+// BGRA for an 8-bit swapchain:
+//   YCbCr -> R'G'B' -> linear light through a PQ EOTF table -> tone curve,
+//   applied as a gain from the brightest channel so hues stay put ->
+//   BT.2020 to BT.709 primaries, desaturating colours the smaller gamut
+//   cannot hold -> gamma 2.2.
+// The EOTF, curve gain and output gamma are 4096-entry tables, so a pixel
+// costs a few gathers instead of pow() calls. The AVX2 tier matches the
+// scalar one bit for bit. Immutable once built, so copy workers can share it.
+class ToneMapper {
+public:
+    static constexpr std::size_t kTableSize = 4096;
+
+    explicit ToneMapper(const ToneMapParams& params);
+
+    [[nodiscard]] const ToneMapParams& params() const noexcept { return params_; }
+
+    // Same contract as the P010 SemiPlanarRowFn; `coefficients` describe the
+    // YCbCr matrix and range of the samples. Runs activeToneMapTier().
+    void convertRow(std::uint8_t* dst,
+                    const std::uint8_t* luma,
+                    const std::uint8_t* chroma,
+                    std::size_t pixels,
+                    const YuvCoefficients& coefficients) const;
+
+    // Runs a specific tier; false when this build or CPU cannot.
+    bool convertRowWith(ConversionTier tier,
+                        std::uint8_t* dst,
+                        const std::uint8_t* luma,
+                        const std::uint8_t* chroma,
+                        std::size_t pixels,
+                        const YuvCoefficients& coefficients) const;
+
+    struct Tables {
+        // PQ code value (i / 4095) -> linear light, 1.0 = SDR white.
+        std::array<float, kTableSize> eotf{};
+        // Gain the tone curve applies at the brightest channel's code value.
+        std::array<float, kTableSize> gain{};
+        // Linear light, indexed by its float bits -> 8-bit gamma 2.2 code.
+        std::array<std::int32_t, kTableSize> oetf{};
+    };
+
+private:
+    ToneMapParams params_;
+    Tables tables_;
+};
+
+[[nodiscard]] const char* toneMapCurveName(ToneMapCurve curve);
+[[nodiscard]] const char* hdrInputModeName(HdrInputMode mode);
+
+// Tier every ToneMapper runs: the widest the CPU supports until
+// configureKernels() picks one.
+[[nodiscard]] ConversionTier activeToneMapTier();
+// False, and no change, when `tier` cannot run.
+bool setActiveToneMapTier(ConversionTier tier);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Settings.hpp"
+
+#include <cstdint>
+
+// Client-area pixels, right and bottom exclusive.
+struct ViewportRect {
+    std::int32_t left = 0;
+    std::int32_t top = 0;
+    std::int32_t right = 0;
+    std::int32_t bottom = 0;
+
+    [[nodiscard]] std::int32_t width() const noexcept { return right - left; }
+    [[nodiscard]] std::int32_t height() const noexcept { return bottom - top; }
+};
+
+// Where a sourceWidth x sourceHeight frame is drawn in a client area:
+//   Stretch:  the whole client area
+//   Maintain: the largest centred rectangle with the source's aspect ratio
+//   Capture:  the same, but never larger than the source
+// False, with an empty rectangle, when either size is zero. Shared by the
+// window and the reference renderer so both place the video identically.
+bool computeVideoViewport(VideoAspectMode mode,
+                          std::uint32_t sourceWidth,
+                          std::uint32_t sourceHeight,
+                          std::int32_t clientWidth,
+                          std::int32_t clientHeight,
+                          ViewportRect& viewport);
+
+// For nearest-neighbour scaling: shrinks `viewport` to the largest whole
+// multiple of the source that fits in it, centred, so every texel covers
+// the same block of pixels. Stretch scales each axis by its own multiple;
+// the other modes keep one for both. An axis the source does not fit into
+// at least once is left alone.
+void snapViewportToIntegerScale(VideoAspectMode mode,
+                                std::uint32_t sourceWidth,
+                                std::uint32_t sourceHeight,
+                                ViewportRect& viewport);
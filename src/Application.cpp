@@ -8,20 +8,27 @@
 
 #include <algorithm>
 #include <array>
-#include <chrono>
 #include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cwchar>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <stdexcept>
-#include <thread>
 #include <cmath>
 #include <shellapi.h>
 
+// Windows 10 1803 and later; older systems fail the call and fall back to
+// millisecond waits.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 namespace
 {
     constexpr wchar_t kWindowClassName[] = L"PCKVM.GC573.Window";
@@ -32,6 +39,135 @@ namespace
     const std::string kAudioSourceVideoSentinel = "@video";
     constexpr unsigned int kSerialBaudRateDefault = 6000000;
 
+    // The render thread's wait: the window's message queue plus the frame and
+    // redraw events and the swap chain's frame latency waitable. Timeouts run
+    // on a high-resolution timer where there is one, as present holds need
+    // better than the scheduler tick.
+    class WindowRenderWaitSet : public RenderWaitSet {
+    public:
+        WindowRenderWaitSet(HANDLE frameEvent, HANDLE redrawEvent, const D3DRenderer& renderer)
+            : frameEvent_(frameEvent), redrawEvent_(redrawEvent), renderer_(renderer)
+        {
+            timer_ = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        }
+
+        ~WindowRenderWaitSet() override
+        {
+            if (timer_)
+            {
+                CloseHandle(timer_);
+            }
+        }
+
+        WindowRenderWaitSet(const WindowRenderWaitSet&) = delete;
+        WindowRenderWaitSet& operator=(const WindowRenderWaitSet&) = delete;
+
+        unsigned wait(unsigned sources, std::uint64_t timeoutNs) override
+        {
+            HANDLE handles[4];
+            unsigned kinds[4];
+            DWORD count = 0;
+            const auto add = [&](unsigned kind, HANDLE handle) {
+                if ((sources & kind) != 0 && handle)
+                {
+                    handles[count] = handle;
+                    kinds[count] = kind;
+                    ++count;
+                }
+            };
+            add(kWakeSwapChain, renderer_.frameLatencyWaitable());
+            add(kWakeFrame, frameEvent_);
+            add(kWakeOverlay, redrawEvent_);
+            const DWORD eventCount = count;
+
+            DWORD timeoutMs = timeoutNs == kWaitForever ? INFINITE : static_cast<DWORD>((timeoutNs + 999'999) / 1'000'000);
+            if (timer_ && timeoutMs != INFINITE && timeoutMs != 0)
+            {
+                LARGE_INTEGER due{};
+                due.QuadPart = -static_cast<LONGLONG>((timeoutNs + 99) / 100);
+                if (SetWaitableTimer(timer_, &due, 0, nullptr, nullptr, FALSE))
+                {
+                    handles[count++] = timer_;
+                    timeoutMs = INFINITE;
+                }
+            }
+
+            const DWORD messageMask = (sources & kWakeMessage) != 0 ? QS_ALLINPUT : 0;
+            const DWORD result = MsgWaitForMultipleObjectsEx(count, count != 0 ? handles : nullptr, timeoutMs, messageMask, MWMO_INPUTAVAILABLE);
+            if (count != eventCount)
+            {
+                CancelWaitableTimer(timer_);
+            }
+
+            // Only the first signalled handle is reported; collect the rest.
+            unsigned wakes = 0;
+            for (DWORD i = 0; i < eventCount; ++i)
+            {
+                if (result == WAIT_OBJECT_0 + i || WaitForSingleObject(handles[i], 0) == WAIT_OBJECT_0)
+                {
+                    wakes |= kinds[i];
+                }
+            }
+            if (messageMask != 0 && HIWORD(GetQueueStatus(QS_ALLINPUT)) != 0)
+            {
+                wakes |= kWakeMessage;
+            }
+            return wakes;
+        }
+
+    private:
+        HANDLE frameEvent_;
+        HANDLE redrawEvent_;
+        const D3DRenderer& renderer_;
+        HANDLE timer_ = nullptr;
+    };
+
+    std::string wideToUtf8(std::wstring_view text)
+    {
+        if (text.empty())
+        {
+            return {};
+        }
+        const int required = WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+        if (required <= 0)
+        {
+            return {};
+        }
+        std::string result(static_cast<std::size_t>(required), '\0');
+        WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), result.data(), required, nullptr, nullptr);
+        return result;
+    }
+
+    // "--name=value" -> value.
+    bool matchArgValue(std::wstring_view arg, std::wstring_view name, std::wstring_view& value)
+    {
+        if (arg.size() <= name.size() || arg.substr(0, name.size()) != name || arg[name.size()] != L'=')
+        {
+            return false;
+        }
+        value = arg.substr(name.size() + 1);
+        return true;
+    }
+
+    // Unsigned integers joined by `separator`, e.g. "1920x1080" or "0,60,1920,1020".
+    bool parseUnsignedList(std::wstring_view text, wchar_t separator, std::uint32_t* values, std::size_t count)
+    {
+        const std::wstring buffer(text);
+        const wchar_t* cursor = buffer.c_str();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            wchar_t* end = nullptr;
+            const unsigned long value = std::wcstoul(cursor, &end, 10);
+            if (end == cursor || *end != (i + 1 < count ? separator : L'\0'))
+            {
+                return false;
+            }
+            values[i] = static_cast<std::uint32_t>(value);
+            cursor = end + 1;
+        }
+        return true;
+    }
+
     std::wstring utf8ToWide(const std::string& text)
     {
         if (text.empty())
@@ -52,6 +188,17 @@ namespace
     {
         std::ofstream("pckvm.log", std::ios::app) << message << '\n';
     }
+
+    // YYYYMMDD-HHMMSS-mmm local time, for file names.
+    std::string localTimestamp()
+    {
+        SYSTEMTIME now{};
+        GetLocalTime(&now);
+        char text[32];
+        std::snprintf(text, sizeof(text), "%04u%02u%02u-%02u%02u%02u-%03u",
+                      now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond, now.wMilliseconds);
+        return text;
+    }
 }
 
 Application::Application() = default;
@@ -62,10 +209,32 @@ Application::~Application()
     microphoneCapture_.stop();
     audioPlayback_.stop();
     serialStreamer_.stop();
-    directShowCapture_.stop();
+    videoCapture().stop();
+    stopSessionRecording();
     renderer_.shutdown();
     unregisterMenuHotkey();
     destroyWindow();
+    for (HANDLE* event : {&frameEvent_, &redrawEvent_})
+    {
+        if (*event)
+        {
+            CloseHandle(*event);
+            *event = nullptr;
+        }
+    }
+
+    if (latency_.histogram(LatencyStage::Total).count() != 0)
+    {
+        if (latency_.writeReport("pckvm-latency.txt"))
+        {
+            logApp("[App] Latency report written to pckvm-latency.txt");
+        }
+        else
+        {
+            logApp("[App] Failed to write latency report");
+        }
+        std::ofstream("pckvm-latency.txt", std::ios::app) << '\n' << presentPacer_.formatReport();
+    }
 }
 
 int Application::run()
@@ -77,6 +246,7 @@ int Application::run()
 
     loadPersistentSettings();
     parseCommandLine();
+    configureKernelDispatch();
     audioEnabled_ = shouldEnableCaptureAudio();
     logApp(std::string("[App] Audio capture ") + (audioEnabled_ ? "enabled" : "disabled"));
 
@@ -97,6 +267,8 @@ int Application::run()
         destroyWindow();
         return EXIT_FAILURE;
     }
+    renderer_.setDirtyTracker(&dirtyTracker_);
+    renderer_.setScalingFilter(settings_.videoScalingFilter);
     logApp("[App] Renderer initialized");
 
     if (!overlay_.initialize(hwnd_, renderer_))
@@ -105,9 +277,35 @@ int Application::run()
         // Continue without overlay
     }
 
+    screenshots_.setCompletionHandler([](const ScreenshotResult& result) {
+        if (!result.saved)
+        {
+            logApp("[App] Screenshot failed: " + result.error);
+            return;
+        }
+        std::ostringstream message;
+        message << "[App] Screenshot " << result.width << "x" << result.height << " saved to";
+        for (const std::filesystem::path& file : result.files)
+        {
+            message << ' ' << file.string();
+        }
+        message << " (encoded in " << std::fixed << std::setprecision(1) << result.encodeMs << " ms)";
+        logApp(message.str());
+    });
+
+    if (settings_.sessionRecording)
+    {
+        startSessionRecording();
+    }
+
+    // Auto-reset: the render loop sleeps until the capture thread or a
+    // settings change has something to show.
+    frameEvent_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    redrawEvent_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
     running_ = true;
 
-    logApp("[App] Starting DirectShow capture");
+    logApp("[App] Starting video capture");
 
     try
     {
@@ -117,21 +315,21 @@ int Application::run()
         captureOptions.desiredWidth = settings_.videoPreferredWidth;
         captureOptions.desiredHeight = settings_.videoPreferredHeight;
 
-        directShowCapture_.start([this](const DirectShowCapture::Frame& frame) {
+        videoCapture().start([this](const DirectShowCapture::Frame& frame) {
             handleFrame(frame);
         }, captureOptions);
-        logApp("[App] DirectShow capture started successfully");
+        logApp("[App] Video capture started: " + videoCapture().currentDeviceFriendlyName());
     }
     catch (const std::exception& ex)
     {
         running_ = false;
-        logApp(std::string("[App] DirectShow capture start failed: ") + ex.what());
+        logApp(std::string("[App] Video capture start failed: ") + ex.what());
         return EXIT_FAILURE;
     }
     catch (...)
     {
         running_ = false;
-        logApp("[App] DirectShow capture start failed: unknown exception");
+        logApp("[App] Video capture start failed: unknown exception");
         return EXIT_FAILURE;
     }
 
@@ -151,9 +349,9 @@ int Application::run()
     audioPlayback_.stop();
     serialStreamer_.stop();
 
-    directShowCapture_.stop();
-    logApp("[App] DirectShow capture stopped");
-    std::string captureError = directShowCapture_.consumeLastError();
+    videoCapture().stop();
+    logApp("[App] Video capture stopped");
+    std::string captureError = videoCapture().consumeLastError();
     const bool anyFrames = frameCounter_.load(std::memory_order_acquire) > 0;
 
     overlay_.shutdown();
@@ -162,7 +360,7 @@ int Application::run()
 
     if (captureError.empty() && !anyFrames)
     {
-        const std::string deviceLabel = directShowCapture_.currentDeviceFriendlyName();
+        const std::string deviceLabel = videoCapture().currentDeviceFriendlyName();
         captureError = "No video frames received from '" + (deviceLabel.empty() ? std::string("the selected capture device") : deviceLabel) + "'. Confirm a valid input signal and that no other application is using the device.";
     }
 
@@ -188,9 +386,13 @@ void Application::parseCommandLine()
     }
 
     bool enableAudio = settings_.audioPlaybackEnabled;
+    bool testPattern = false;
+    TestPatternCapture::Config patternConfig;
+    FileReplayCapture::Config replayConfig;
     for (int i = 1; i < argc; ++i)
     {
         std::wstring_view arg(argv[i]);
+        std::wstring_view value;
         if (arg == L"--enable-audio" || arg == L"--audio")
         {
             enableAudio = true;
@@ -199,6 +401,94 @@ void Application::parseCommandLine()
         {
             enableAudio = false;
         }
+        else if (arg == L"--test-pattern")
+        {
+            testPattern = true;
+        }
+        else if (matchArgValue(arg, L"--test-pattern", value))
+        {
+            testPattern = true;
+            if (value == L"static")
+            {
+                patternConfig.motion = TestPatternCapture::Motion::Static;
+            }
+            else if (value == L"bars")
+            {
+                patternConfig.motion = TestPatternCapture::Motion::ScrollingBars;
+            }
+            else if (value == L"noise")
+            {
+                patternConfig.motion = TestPatternCapture::Motion::Noise;
+            }
+            else
+            {
+                patternConfig.motion = TestPatternCapture::Motion::MovingBox;
+            }
+        }
+        else if (matchArgValue(arg, L"--replay", value))
+        {
+            replayConfig.path = wideToUtf8(value);
+        }
+        else if (matchArgValue(arg, L"--replay-timestamps", value))
+        {
+            replayConfig.timestampsPath = wideToUtf8(value);
+        }
+        else if (arg == L"--replay-once")
+        {
+            replayConfig.loop = false;
+        }
+        else if (arg == L"--replay-preload")
+        {
+            replayConfig.preload = true;
+        }
+        else if (matchArgValue(arg, L"--source-size", value))
+        {
+            std::uint32_t size[2] = {};
+            if (parseUnsignedList(value, L'x', size, 2))
+            {
+                patternConfig.width = replayConfig.width = size[0];
+                patternConfig.height = replayConfig.height = size[1];
+            }
+        }
+        else if (matchArgValue(arg, L"--source-content", value))
+        {
+            std::uint32_t rect[4] = {};
+            if (parseUnsignedList(value, L',', rect, 4))
+            {
+                patternConfig.contentLeft = rect[0];
+                patternConfig.contentTop = rect[1];
+                patternConfig.contentRight = rect[2];
+                patternConfig.contentBottom = rect[3];
+            }
+        }
+        else if (matchArgValue(arg, L"--source-fps", value))
+        {
+            const double fps = std::wcstod(std::wstring(value).c_str(), nullptr);
+            if (fps > 0.0)
+            {
+                patternConfig.fps = replayConfig.fps = fps;
+            }
+        }
+        else if (arg == L"--source-bottom-up")
+        {
+            patternConfig.bottomUp = replayConfig.bottomUp = true;
+        }
+        else if (arg == L"--source-unpaced")
+        {
+            patternConfig.paced = replayConfig.paced = false;
+        }
+    }
+
+    if (!replayConfig.path.empty())
+    {
+        logApp("[App] Replaying '" + replayConfig.path + "' instead of the capture device");
+        syntheticCapture_ = std::make_unique<FileReplayCapture>(replayConfig);
+    }
+    else if (testPattern)
+    {
+        logApp(std::string("[App] Using the ") + TestPatternCapture::motionName(patternConfig.motion) +
+               " test pattern instead of the capture device");
+        syntheticCapture_ = std::make_unique<TestPatternCapture>(patternConfig);
     }
 
     if (enableAudio != settings_.audioPlaybackEnabled)
@@ -316,7 +606,7 @@ LRESULT CALLBACK Application::windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPA
         }
         break;
     case WM_HOTKEY:
-        if (self->ignoreMenuHotkeyUntil_ != 0)
+        if (wParam == self->menuHotkeyId_ && self->ignoreMenuHotkeyUntil_ != 0)
         {
             const DWORD now = GetTickCount();
             if (now <= self->ignoreMenuHotkeyUntil_)
@@ -331,11 +621,19 @@ LRESULT CALLBACK Application::windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPA
             self->showSettingsMenu();
             return 0;
         }
+        if (wParam == self->screenshotHotkeyId_)
+        {
+            self->takeScreenshot();
+            return 0;
+        }
         break;
     case WM_INPUT_CAPTURE_SHOW_MENU:
         self->ignoreMenuHotkeyUntil_ = GetTickCount() + 250;
         self->showSettingsMenu();
         return 0;
+    case WM_INPUT_CAPTURE_SCREENSHOT:
+        self->takeScreenshot();
+        return 0;
     case WM_INPUT_CAPTURE_UPDATE_CLIP:
         self->inputCaptureManager_.applyCursorClip(wParam != 0);
         return 0;
@@ -433,19 +731,45 @@ void Application::destroyWindow()
 
 void Application::handleFrame(const DirectShowCapture::Frame& frame)
 {
-    std::scoped_lock lock(frameMutex_);
-
-    int backIndex = 1 - frontBufferIndex_;
-    CpuFrame& dst = frames_[backIndex];
+    if (frame.format == DirectShowCapture::PixelFormat::MJPEG)
+    {
+        DirectShowCapture::Frame decoded{};
+        switch (mjpegDecoder_.decode(frame, decoded))
+        {
+        case MjpegDecoder::Result::Decoded:
+            handleFrame(decoded);
+            break;
+        case MjpegDecoder::Result::Duplicate:
+            // Same bitstream as the previous sample, so the same picture.
+            framesSkipped_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case MjpegDecoder::Result::Failed:
+        {
+            // Log the 1st, 2nd, 4th, 8th... failure; a bad stream fails every frame.
+            const std::uint64_t failures = mjpegDecoder_.framesFailed();
+            if ((failures & (failures - 1)) == 0)
+            {
+                logApp("[App] Dropped MJPEG frame (" + std::to_string(failures) + " so far): " + mjpegDecoder_.lastError());
+            }
+            break;
+        }
+        }
+        return;
+    }
 
-    dst.timestamp100ns = frame.timestamp100ns;
+    const DirectShowCapture::TransferFunction transfer =
+        resolveTransferFunction(hdrInput_.load(std::memory_order_acquire), frame);
+    if (transfer != frame.transfer)
+    {
+        DirectShowCapture::Frame resolved = frame;
+        resolved.transfer = transfer;
+        handleFrame(resolved);
+        return;
+    }
 
     const std::uint32_t frameWidth = frame.width;
     const std::uint32_t frameHeight = frame.height;
-    const std::uint32_t stride = frame.stride != 0 ? frame.stride : frameWidth * 4;
-
-    dst.width = frameWidth;
-    dst.height = frameHeight;
+    const std::size_t stride = frameSourceStride(frame);
 
     const std::uint32_t knownWidth = currentSourceWidth_.load(std::memory_order_acquire);
     const std::uint32_t knownHeight = currentSourceHeight_.load(std::memory_order_acquire);
@@ -454,69 +778,107 @@ void Application::handleFrame(const DirectShowCapture::Frame& frame)
         pendingSourceWidth_.store(frameWidth, std::memory_order_release);
         pendingSourceHeight_.store(frameHeight, std::memory_order_release);
         sourceChangePending_.store(true, std::memory_order_release);
+        wakeRenderLoop(frameEvent_);
     }
 
     inputCaptureManager_.setTargetResolution(static_cast<int>(frameWidth), static_cast<int>(frameHeight));
 
-    const std::size_t requiredBytes = static_cast<std::size_t>(stride) * frameHeight;
+    const std::uint32_t sampleHeight = frame.sampleHeight != 0 ? frame.sampleHeight : frameHeight;
+    const std::size_t requiredBytes = stride * sampleHeight;
     if (frame.dataSize < requiredBytes)
     {
         logApp("[App] Warning: frame data shorter than expected (" + std::to_string(frame.dataSize) + " < " + std::to_string(requiredBytes) + ")");
     }
 
-    dst.stride = stride;
-    dst.data.resize(requiredBytes);
+    // Straight into the renderer's mapped upload heap; system memory only while
+    // the renderer is still sizing its upload ring for a new resolution. Either
+    // way only the tiles that changed since the slot's previous frame are copied.
+    if (toneMapperChanged_.exchange(false, std::memory_order_acq_rel))
+    {
+        // Every buffer holds pixels from the old curve, so the next frame must
+        // be copied whole even if the source did not change.
+        dirtyTracker_.invalidate();
+    }
+    if (recordingStarted_.exchange(false, std::memory_order_acq_rel))
+    {
+        // A new recording starts with a frame even if the screen is static.
+        dirtyTracker_.invalidate();
+    }
+    std::shared_ptr<const ToneMapper> toneMapper;
+    {
+        std::lock_guard<std::mutex> lock(toneMapperMutex_);
+        toneMapper = toneMapper_;
+    }
 
-    const bool bottomUp = frame.bottomUp;
+    const AreaScaler* scaler = updateDownscaler(frame);
 
-    if (frame.data && frame.dataSize > 0)
+    if (screenshots_.requested())
     {
-        const auto* srcRows = static_cast<const std::uint8_t*>(frame.data);
-        if (!bottomUp)
+        // Ahead of the skip below, so a static screen can be saved too.
+        FrameWriteOptions screenshotOptions;
+        screenshotOptions.workers = &copyWorkers_;
+        screenshotOptions.toneMapper = toneMapper.get();
+        writeFrameToSink(frame, screenshots_, screenshotOptions);
+    }
+
+    // Every frame, repeats too: a static screen must not lose the cadence.
+    presentPacer_.observeFrame(frame.timestamp100ns, frame.arrivalNs);
+
+    const std::uint64_t sequence = dirtyTracker_.analyze(frame);
+    if (sequence != 0 && dirtyTracker_.lastDirtyTiles() == 0)
+    {
+        // Byte-identical to the previous frame: nothing to copy, upload or present.
+        // Only a recorder that dropped the frame with the last change still
+        // needs it; the tracker gives it every tile since its slot's frame.
+        if (sessionRecorder_.recording() && sessionRecorder_.missedFrame())
         {
-            for (std::uint32_t y = 0; y < frameHeight; ++y)
-            {
-                const std::size_t offset = static_cast<std::size_t>(y) * stride;
-                const std::size_t copyBytes = std::min<std::size_t>(stride, frame.dataSize - offset);
-                std::memcpy(dst.data.data() + offset, srcRows + offset, copyBytes);
-                if (copyBytes < stride)
-                {
-                    std::memset(dst.data.data() + offset + copyBytes, 0, stride - copyBytes);
-                }
-            }
-        }
-        else
-        {
-            for (std::uint32_t y = 0; y < frameHeight; ++y)
-            {
-                const std::uint32_t srcIndex = frameHeight - 1 - y;
-                const std::size_t srcOffset = static_cast<std::size_t>(srcIndex) * stride;
-                const std::size_t dstOffset = static_cast<std::size_t>(y) * stride;
-                const std::size_t copyBytes = std::min<std::size_t>(stride, frame.dataSize - srcOffset);
-                std::memcpy(dst.data.data() + dstOffset, srcRows + srcOffset, copyBytes);
-                if (copyBytes < stride)
-                {
-                    std::memset(dst.data.data() + dstOffset + copyBytes, 0, stride - copyBytes);
-                }
-            }
+            FrameWriteOptions recordOptions;
+            recordOptions.tracker = &dirtyTracker_;
+            recordOptions.sequence = sequence;
+            recordOptions.workers = &copyWorkers_;
+            recordOptions.toneMapper = toneMapper.get();
+            writeFrameToSink(frame, sessionRecorder_, recordOptions);
         }
+        framesSkipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    else
+
+    FrameWriteOptions writeOptions;
+    writeOptions.tracker = &dirtyTracker_;
+    writeOptions.sequence = sequence;
+    writeOptions.workers = &copyWorkers_;
+    writeOptions.toneMapper = toneMapper.get();
+    writeOptions.scaler = scaler;
+
+    bool direct = true;
+    FrameWriteResult result = writeFrameToSink(frame, renderer_, writeOptions);
+    if (!result.accepted)
     {
-        std::memset(dst.data.data(), 0, dst.data.size());
+        direct = false;
+        result = writeFrameToSink(frame, cpuFrames_, writeOptions);
+    }
+
+    if (sessionRecorder_.recording())
+    {
+        // After the display copy so recording adds no latency; never downscaled.
+        FrameWriteOptions recordOptions = writeOptions;
+        recordOptions.scaler = nullptr;
+        writeFrameToSink(frame, sessionRecorder_, recordOptions);
     }
 
     static std::atomic<bool> loggedPixels{false};
-    if (!loggedPixels.exchange(true))
+    if (frame.data && !loggedPixels.exchange(true))
     {
-        logApp("[App] Stored frame size=" + std::to_string(dst.data.size()) + " stride=" + std::to_string(dst.stride));
+        logApp("[App] Stored frame size=" + std::to_string(result.bytesWritten) + " stride=" + std::to_string(stride) + (direct ? " (direct upload)" : " (system memory)"));
         auto logPixel = [&](const char* label, std::size_t row, std::size_t col) {
-            if (row < dst.height && col < dst.width)
+            if (row < frameHeight && col < frameWidth)
             {
-                const std::size_t offset = row * dst.stride + col * 4;
-                if (offset + 3 < dst.data.size())
+                const std::size_t rowOffset = frameSourceRowOffset(frame, static_cast<std::uint32_t>(row));
+                // Packed YUV logs the start of the pixel group the column falls in.
+                const std::size_t offset = rowOffset + pixelFormatRowOffset(frame.format, col);
+                if (rowOffset != kMissingSourceRow && offset + 3 < frame.dataSize)
                 {
-                    const auto* px = dst.data.data() + offset;
+                    const auto* px = frame.data + offset;
                     std::ostringstream oss;
                     oss << "[App] Sample pixel " << label << " (row=" << row << ", col=" << col << ") = "
                         << std::hex << std::uppercase
@@ -529,40 +891,123 @@ void Application::handleFrame(const DirectShowCapture::Frame& frame)
             }
         };
         logPixel("top-left", 0, 0);
-        logPixel("center", dst.height / 2, dst.width / 2);
-        logPixel("bottom-right", dst.height - 1, dst.width - 1);
+        logPixel("center", frameHeight / 2, frameWidth / 2);
+        logPixel("bottom-right", frameHeight - 1, frameWidth - 1);
+    }
+
+    if (!result.accepted)
+    {
+        // analyze() already took this frame's hashes. Nothing shows the frame,
+        // so an unchanged next one must not be skipped as already displayed.
+        dirtyTracker_.invalidate();
+        return;
     }
 
-    frontBufferIndex_ = backIndex;
     frameCounter_.fetch_add(1, std::memory_order_acq_rel);
+    presentPacer_.frameDelivered();
+    wakeRenderLoop(frameEvent_);
 
     static std::atomic<bool> logged{false};
     if (!logged.exchange(true))
     {
-        logApp("[App] First frame received: " + std::to_string(dst.width) + "x" + std::to_string(dst.height) + " stride=" + std::to_string(dst.stride));
+        logApp("[App] First frame received: " + std::to_string(frameWidth) + "x" + std::to_string(frameHeight) + " stride=" + std::to_string(stride));
     }
 }
 
+// Keeps downscaler_ matched to the frame and the current viewport; nullptr
+// when the frame goes up at full size.
+const AreaScaler* Application::updateDownscaler(const DirectShowCapture::Frame& frame)
+{
+    std::uint32_t outputWidth = frame.width;
+    std::uint32_t outputHeight = frame.height;
+    if (videoDownscale_.load(std::memory_order_acquire))
+    {
+        chooseDownscaleSize(frame.width, frame.height,
+                            viewportWidth_.load(std::memory_order_acquire),
+                            viewportHeight_.load(std::memory_order_acquire),
+                            outputWidth, outputHeight);
+    }
+
+    const bool scaled = outputWidth != frame.width || outputHeight != frame.height;
+    const bool current = downscaler_ ? (downscaler_->sourceWidth() == frame.width && downscaler_->sourceHeight() == frame.height &&
+                                        downscaler_->outputWidth() == outputWidth && downscaler_->outputHeight() == outputHeight)
+                                     : !scaled;
+    if (!current)
+    {
+        if (scaled)
+        {
+            downscaler_.emplace(frame.width, frame.height, outputWidth, outputHeight);
+            logApp("[App] Downscaling " + std::to_string(frame.width) + "x" + std::to_string(frame.height) + " -> " +
+                   std::to_string(outputWidth) + "x" + std::to_string(outputHeight) + " before upload");
+        }
+        else
+        {
+            downscaler_.reset();
+            logApp("[App] Uploading " + std::to_string(frame.width) + "x" + std::to_string(frame.height) + " at full size");
+        }
+        // Buffers holding the old scale cannot be patched tile by tile.
+        dirtyTracker_.invalidate();
+    }
+    return downscaler_ ? &*downscaler_ : nullptr;
+}
+
+// Sleeps until there is a frame, a window message, a redraw request or, with
+// work pending, room in the swap chain; see RenderScheduler.
 void Application::renderLoop()
 {
     MSG msg = {};
+    WindowRenderWaitSet waitSet(frameEvent_, redrawEvent_, renderer_);
 
     while (running_)
     {
-        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+        renderScheduler_.setSwapChainWaitable(renderer_.frameLatencyWaitable() != nullptr);
+        renderScheduler_.setContinuousRedraw(overlay_.needsUpdate());
+        const unsigned wakes = renderScheduler_.waitForWork(waitSet);
+        if ((wakes & kWakeMessage) != 0)
         {
-            if (msg.message == WM_QUIT)
+            while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
             {
-                logApp("[App] WM_QUIT in render loop");
-                running_ = false;
-                break;
+                if (msg.message == WM_QUIT)
+                {
+                    logApp("[App] WM_QUIT in render loop");
+                    running_ = false;
+                    break;
+                }
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
             }
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
         }
 
         processPendingSourceDimensions();
-        renderFrame(false);
+        renderScheduler_.setContinuousRedraw(overlay_.needsUpdate());
+
+        // Holding would delay the open menu's response to input, and with
+        // tearing a present shows at once.
+        const bool paced = settings_.videoPresentPacing && !overlay_.isMenuVisible() && !renderer_.tearingEnabled();
+        if (paced && (wakes & kWakeFrame) != 0 && renderScheduler_.framePending())
+        {
+            renderScheduler_.holdUntil(presentPacer_.presentNotBefore(latencyClockNs()));
+        }
+
+        if (running_ && renderScheduler_.shouldRender())
+        {
+            const bool presented = renderFrame(false);
+            renderScheduler_.rendered(presented);
+            if (presented)
+            {
+                const PresentStatistics& stats = renderer_.presentStatistics();
+                presentPacer_.presented(renderer_.lastPresentId());
+                presentPacer_.observeDisplay(stats.presentId, stats.presentRefresh, stats.syncRefresh, stats.syncNs);
+            }
+        }
+    }
+}
+
+void Application::wakeRenderLoop(HANDLE event)
+{
+    if (event)
+    {
+        SetEvent(event);
     }
 }
 
@@ -584,6 +1029,9 @@ void Application::loadPersistentSettings()
     }
     settings_.mouseAbsoluteMode = true;
     inputCaptureManager_.setAbsoluteMode(settings_.mouseAbsoluteMode);
+    rebuildToneMapper();
+    hdrInput_.store(settings_.hdrInput, std::memory_order_release);
+    videoDownscale_.store(settings_.videoDownscale, std::memory_order_release);
     audioEnabled_ = shouldEnableCaptureAudio();
 }
 
@@ -631,6 +1079,13 @@ bool Application::registerMenuHotkey()
 
     inputCaptureManager_.setMenuChordEnabled(true);
 
+    screenshotHotkeyRegistered_ =
+        RegisterHotKey(hwnd_, static_cast<int>(screenshotHotkeyId_), MOD_CONTROL | MOD_ALT | MOD_NOREPEAT, 'S') != FALSE;
+    if (!screenshotHotkeyRegistered_)
+    {
+        logApp("[App] Failed to register screenshot hotkey");
+    }
+
     if (RegisterHotKey(hwnd_, static_cast<int>(menuHotkeyId_), modifiers, static_cast<UINT>(hotkey.virtualKey)))
     {
         menuHotkeyRegistered_ = true;
@@ -647,7 +1102,12 @@ void Application::unregisterMenuHotkey()
     {
         UnregisterHotKey(hwnd_, static_cast<int>(menuHotkeyId_));
     }
+    if (hwnd_ && screenshotHotkeyRegistered_)
+    {
+        UnregisterHotKey(hwnd_, static_cast<int>(screenshotHotkeyId_));
+    }
     menuHotkeyRegistered_ = false;
+    screenshotHotkeyRegistered_ = false;
     inputCaptureManager_.setMenuChordEnabled(false);
 }
 
@@ -962,34 +1422,226 @@ void Application::setVideoAspectMode(VideoAspectMode mode)
     requestImmediateRender();
 }
 
+void Application::setVideoScalingFilter(ScalingFilter filter)
+{
+    if (settings_.videoScalingFilter == filter)
+    {
+        return;
+    }
+
+    settings_.videoScalingFilter = filter;
+    savePersistentSettings();
+    logApp(std::string("[App] Video scaling filter -> ") + scalingFilterName(filter));
+    renderer_.setScalingFilter(filter);
+    // Nearest snaps the viewport to a whole multiple of the source.
+    updateInputCaptureBounds();
+    requestImmediateRender();
+}
+
+void Application::setScreenshotFormat(ScreenshotFormat format)
+{
+    if (settings_.screenshotFormat == format)
+    {
+        return;
+    }
+
+    settings_.screenshotFormat = format;
+    savePersistentSettings();
+    logApp("[App] Screenshot format -> " + std::to_string(static_cast<unsigned int>(format)));
+}
+
+void Application::takeScreenshot()
+{
+    // Taken from the next captured frame; the completion handler logs the result.
+    const std::filesystem::path stem = std::filesystem::path("screenshots") / ("pckvm-" + localTimestamp());
+    screenshots_.request(stem, settings_.screenshotFormat);
+    logApp("[App] Screenshot requested: " + stem.string());
+}
+
+void Application::setSessionRecording(bool enabled)
+{
+    if (settings_.sessionRecording == enabled && sessionRecorder_.recording() == enabled)
+    {
+        return;
+    }
+
+    settings_.sessionRecording = enabled;
+    savePersistentSettings();
+    if (enabled)
+    {
+        startSessionRecording();
+    }
+    else
+    {
+        stopSessionRecording();
+    }
+}
+
+void Application::startSessionRecording()
+{
+    stopSessionRecording();
+    const std::filesystem::path path = std::filesystem::path("recordings") / ("pckvm-" + localTimestamp() + ".pkvr");
+    if (!sessionRecorder_.start(path))
+    {
+        logApp("[App] Session recording failed: " + sessionRecorder_.error());
+        return;
+    }
+    sessionRecordingActive_ = true;
+    recordingStarted_.store(true, std::memory_order_release);
+    logApp("[App] Session recording started: " + path.string());
+}
+
+void Application::stopSessionRecording()
+{
+    if (!sessionRecordingActive_)
+    {
+        return;
+    }
+
+    sessionRecordingActive_ = false;
+    const SessionRecorderStats stats = sessionRecorder_.stop();
+    std::ostringstream message;
+    message << "[App] Session recording stopped: " << stats.framesRecorded << " frames (" << stats.keyFrames
+            << " key), " << stats.framesDropped << " dropped, " << std::fixed << std::setprecision(1)
+            << static_cast<double>(stats.fileBytes) / (1024.0 * 1024.0) << " MB";
+    if (stats.framesRecorded != 0)
+    {
+        message << ", " << stats.encodeMs / static_cast<double>(stats.framesRecorded) << " ms/frame to encode";
+    }
+    const std::string error = sessionRecorder_.error();
+    if (!error.empty())
+    {
+        message << " (" << error << ")";
+    }
+    logApp(message.str());
+}
+
+void Application::setHdrInput(HdrInputMode mode)
+{
+    if (settings_.hdrInput == mode)
+    {
+        return;
+    }
+
+    settings_.hdrInput = mode;
+    savePersistentSettings();
+    logApp(std::string("[App] HDR input -> ") + hdrInputModeName(mode));
+    hdrInput_.store(mode, std::memory_order_release);
+    // Buffers hold the frame converted the other way; copy the next one whole.
+    toneMapperChanged_.store(true, std::memory_order_release);
+    requestImmediateRender();
+}
+
+void Application::setHdrToneMapping(ToneMapCurve curve, unsigned int peakNits)
+{
+    if (settings_.hdrToneMapCurve == curve && settings_.hdrPeakNits == peakNits)
+    {
+        return;
+    }
+
+    settings_.hdrToneMapCurve = curve;
+    settings_.hdrPeakNits = peakNits;
+    savePersistentSettings();
+    rebuildToneMapper();
+    requestImmediateRender();
+}
+
+void Application::setVideoDownscale(bool enabled)
+{
+    if (settings_.videoDownscale == enabled)
+    {
+        return;
+    }
+
+    settings_.videoDownscale = enabled;
+    savePersistentSettings();
+    logApp(std::string("[App] Video downscale -> ") + (enabled ? "enabled" : "disabled"));
+    videoDownscale_.store(enabled, std::memory_order_release);
+    requestImmediateRender();
+}
+
+void Application::setVideoPresentPacing(bool enabled)
+{
+    if (settings_.videoPresentPacing == enabled)
+    {
+        return;
+    }
+
+    settings_.videoPresentPacing = enabled;
+    savePersistentSettings();
+    logApp(std::string("[App] Present pacing -> ") + (enabled ? "enabled" : "disabled"));
+    requestImmediateRender();
+}
+
+void Application::rebuildToneMapper()
+{
+    ToneMapParams params;
+    params.curve = settings_.hdrToneMapCurve;
+    params.peakNits = static_cast<float>(settings_.hdrPeakNits);
+    auto toneMapper = std::make_shared<const ToneMapper>(params);
+    logApp(std::string("[App] HDR tone mapping: ") + toneMapCurveName(params.curve) + ", peak " +
+           std::to_string(settings_.hdrPeakNits) + " nits");
+    {
+        std::lock_guard<std::mutex> lock(toneMapperMutex_);
+        toneMapper_ = std::move(toneMapper);
+    }
+    toneMapperChanged_.store(true, std::memory_order_release);
+}
+
+void Application::configureKernelDispatch()
+{
+    SimdLevel limit = detectedSimdLevel();
+    if (settings_.simdLevel != "auto" && !parseSimdLevel(settings_.simdLevel, limit))
+    {
+        logApp("[App] Ignoring unknown simdLevel '" + settings_.simdLevel + "'");
+    }
+    limit = simdLevelFromEnvironment(limit);
+    logApp(std::string("[App] Kernel dispatch: CPU supports ") + simdLevelName(detectedSimdLevel()) + ", limit " + simdLevelName(limit));
+
+    for (const KernelFamilyReport& report : configureKernels(limit))
+    {
+        logApp(std::string("[App] ") + report.family + " kernel: " + report.active);
+        if (!report.failed.empty())
+        {
+            logApp(std::string("[App] ") + report.family + " self-test failed for " + report.failed + "; not used");
+        }
+    }
+}
+
 void Application::requestImmediateRender()
 {
     forceRender_.store(true, std::memory_order_release);
+    wakeRenderLoop(redrawEvent_);
 }
 
-bool Application::uploadLatestFrame()
+bool Application::uploadLatestFrame(FrameTimestamps& timestamps)
 {
-    std::unique_lock<std::mutex> lock(frameMutex_, std::try_to_lock);
-    if (!lock.owns_lock())
+    bool uploaded = false;
+
+    // A system-memory frame is only ever older than a direct one, so take it first.
+    const CpuFrame* src = cpuFrames_.acquireLatest();
+    if (src && !src->data.empty() && src->width != 0 && src->height != 0)
     {
-        return false;
+        renderer_.uploadFrame(src->data.data(), src->stride, src->width, src->height);
+        timestamps = src->timestamps;
+        uploaded = true;
     }
 
-    const std::uint64_t latest = frameCounter_.load(std::memory_order_acquire);
-    if (latest == lastPresentedFrame_)
+    if (renderer_.acquireSinkFrame(&timestamps))
     {
-        return false;
+        uploaded = true;
     }
 
-    const CpuFrame& src = frames_[frontBufferIndex_];
-    if (src.data.empty() || src.width == 0 || src.height == 0)
+    if (uploaded)
     {
-        return false;
+        timestamps.uploaded = latencyClockNs();
     }
 
-    renderer_.uploadFrame(src.data.data(), src.stride, src.width, src.height);
-    lastPresentedFrame_ = latest;
-    return true;
+    if (uploaded)
+    {
+        lastPresentedFrame_ = frameCounter_.load(std::memory_order_acquire);
+    }
+    return uploaded;
 }
 
 void Application::processPendingSourceDimensions()
@@ -1008,28 +1660,33 @@ void Application::processPendingSourceDimensions()
     sourceChangePending_.store(false, std::memory_order_release);
 }
 
-void Application::renderFrame(bool forcePresent)
+bool Application::renderFrame(bool forcePresent)
 {
     processPendingSourceDimensions();
-    overlay_.newFrame();
-    overlay_.buildUI(*this);
-    overlay_.endFrame();
+    const bool overlayChanged = overlay_.updateFrame(*this);
 
-    const bool uploaded = uploadLatestFrame();
+    FrameTimestamps timestamps{};
+    const bool uploaded = uploadLatestFrame(timestamps);
     const bool forced = forcePresent || forceRender_.exchange(false, std::memory_order_acq_rel);
-    const bool overlayHasDraw = overlay_.hasDrawData();
     const bool hasFrame = (lastPresentedFrame_ != 0);
 
-    if (uploaded || forced || overlayHasDraw || (forcePresent && hasFrame))
+    if (!uploaded && !forced && !overlayChanged && !(forcePresent && hasFrame))
     {
-        renderer_.render([&](ID3D12GraphicsCommandList* cmdList) {
-            overlay_.render(cmdList);
-        });
+        return false;
     }
-    else if (!forcePresent)
+
+    renderer_.render([&](ID3D12GraphicsCommandList* cmdList) {
+        overlay_.render(cmdList);
+    });
+
+    // render() bails out early without a swapchain; its stamps are stale then.
+    if (uploaded && renderer_.lastSubmitNs() >= timestamps.uploaded)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        timestamps.submitted = renderer_.lastSubmitNs();
+        timestamps.presented = renderer_.lastPresentNs();
+        latency_.record(timestamps);
     }
+    return true;
 }
 
 void Application::selectBridgeDevice(const SerialPortInfo& info, bool autoSelect)
@@ -1232,98 +1889,20 @@ bool Application::applyLockedWindowSize(MINMAXINFO* info) const
 
 RECT Application::computeVideoViewport(const RECT& clientRect, bool& valid) const
 {
-    valid = false;
-    RECT viewport{0, 0, 0, 0};
-
-    const LONG clientWidth = clientRect.right - clientRect.left;
-    const LONG clientHeight = clientRect.bottom - clientRect.top;
-    if (clientWidth <= 0 || clientHeight <= 0)
-    {
-        return viewport;
-    }
-
-    const std::uint32_t srcWidth = currentSourceWidth_.load(std::memory_order_acquire);
-    const std::uint32_t srcHeight = currentSourceHeight_.load(std::memory_order_acquire);
-    if (srcWidth == 0 || srcHeight == 0)
-    {
-        return viewport;
-    }
-
-    switch (settings_.videoAspectMode)
-    {
-    case VideoAspectMode::Stretch:
-        viewport.left = 0;
-        viewport.top = 0;
-        viewport.right = clientWidth;
-        viewport.bottom = clientHeight;
-        valid = true;
-        return viewport;
-
-    case VideoAspectMode::Maintain:
-    {
-        const double srcAspect = static_cast<double>(srcWidth) / static_cast<double>(srcHeight);
-        const double clientAspect = static_cast<double>(clientWidth) / static_cast<double>(clientHeight);
-        constexpr double epsilon = 1e-4;
-
-        int viewportWidth = static_cast<int>(clientWidth);
-        int viewportHeight = static_cast<int>(clientHeight);
-        if (std::abs(clientAspect - srcAspect) > epsilon)
-        {
-            if (clientAspect > srcAspect)
-            {
-                viewportHeight = static_cast<int>(clientHeight);
-                viewportWidth = static_cast<int>(std::round(static_cast<double>(viewportHeight) * srcAspect));
-            }
-            else
-            {
-                viewportWidth = static_cast<int>(clientWidth);
-                viewportHeight = static_cast<int>(std::round(static_cast<double>(viewportWidth) / srcAspect));
-            }
-        }
-
-        viewportWidth = std::max(1, std::min(viewportWidth, static_cast<int>(clientWidth)));
-        viewportHeight = std::max(1, std::min(viewportHeight, static_cast<int>(clientHeight)));
-
-        const int offsetX = (static_cast<int>(clientWidth) - viewportWidth) / 2;
-        const int offsetY = (static_cast<int>(clientHeight) - viewportHeight) / 2;
-
-        viewport.left = offsetX;
-        viewport.top = offsetY;
-        viewport.right = offsetX + viewportWidth;
-        viewport.bottom = offsetY + viewportHeight;
-        valid = true;
-        return viewport;
-    }
-
-    case VideoAspectMode::Capture:
-    {
-        double scale = std::min<double>(static_cast<double>(clientWidth) / static_cast<double>(srcWidth),
-                                        static_cast<double>(clientHeight) / static_cast<double>(srcHeight));
-        if (scale <= 0.0)
-        {
-            scale = 1.0;
-        }
-        if (scale > 1.0)
-        {
-            scale = 1.0; // never upscale beyond native resolution
-        }
-
-        int viewportWidth = static_cast<int>(std::round(static_cast<double>(srcWidth) * scale));
-        int viewportHeight = static_cast<int>(std::round(static_cast<double>(srcHeight) * scale));
-        viewportWidth = std::max(1, std::min(viewportWidth, static_cast<int>(clientWidth)));
-        viewportHeight = std::max(1, std::min(viewportHeight, static_cast<int>(clientHeight)));
-        const int offsetX = (static_cast<int>(clientWidth) - viewportWidth) / 2;
-        const int offsetY = (static_cast<int>(clientHeight) - viewportHeight) / 2;
-        viewport.left = offsetX;
-        viewport.top = offsetY;
-        viewport.right = offsetX + viewportWidth;
-        viewport.bottom = offsetY + viewportHeight;
-        valid = true;
-        return viewport;
-    }
-    }
-
-    return viewport;
+    ViewportRect viewport;
+    const std::uint32_t sourceWidth = currentSourceWidth_.load(std::memory_order_acquire);
+    const std::uint32_t sourceHeight = currentSourceHeight_.load(std::memory_order_acquire);
+    valid = ::computeVideoViewport(settings_.videoAspectMode,
+                                   sourceWidth,
+                                   sourceHeight,
+                                   clientRect.right - clientRect.left,
+                                   clientRect.bottom - clientRect.top,
+                                   viewport);
+    if (valid && settings_.videoScalingFilter == ScalingFilter::Nearest)
+    {
+        snapViewportToIntegerScale(settings_.videoAspectMode, sourceWidth, sourceHeight, viewport);
+    }
+    return RECT{viewport.left, viewport.top, viewport.right, viewport.bottom};
 }
 
 void Application::updateInputCaptureBounds()
@@ -1383,6 +1962,11 @@ void Application::updateInputCaptureBounds()
                               static_cast<float>(viewportClient.top),
                               static_cast<float>(viewportClient.right - viewportClient.left),
                               static_cast<float>(viewportClient.bottom - viewportClient.top));
+
+    // A hidden or minimised window keeps the last size, so restoring it does
+    // not start with a full-size frame.
+    viewportWidth_.store(static_cast<std::uint32_t>(viewportClient.right - viewportClient.left), std::memory_order_release);
+    viewportHeight_.store(static_cast<std::uint32_t>(viewportClient.bottom - viewportClient.top), std::memory_order_release);
 }
 
 bool Application::shouldUseVideoAudio() const
@@ -1407,6 +1991,15 @@ bool Application::shouldEnableCaptureAudio() const
     return settings_.audioPlaybackEnabled && shouldUseVideoAudio();
 }
 
+CaptureSource& Application::videoCapture()
+{
+    if (syntheticCapture_)
+    {
+        return *syntheticCapture_;
+    }
+    return directShowCapture_;
+}
+
 void Application::restartVideoCapture()
 {
     if (!running_)
@@ -1415,15 +2008,22 @@ void Application::restartVideoCapture()
     }
 
     logApp("[App] Restarting video capture with updated settings");
-    directShowCapture_.stop();
+    videoCapture().stop();
 
-    {
-        std::lock_guard<std::mutex> lock(frameMutex_);
-        frames_[0] = CpuFrame{};
-        frames_[1] = CpuFrame{};
-    }
+    // Slot buffers go back to the pool and are reused if the mode is unchanged.
+    cpuFrames_.reset();
+    mjpegDecoder_.reset();
+    dirtyTracker_.invalidate();
     frameCounter_.store(0, std::memory_order_release);
     lastPresentedFrame_ = 0;
+    logApp("[App] Frame pool: " + std::to_string(framePool_.allocationCount()) + " allocations, " +
+           std::to_string(framePool_.cachedBytes()) + " bytes cached");
+    if (mjpegDecoder_.framesDecoded() != 0 || mjpegDecoder_.framesFailed() != 0)
+    {
+        logApp("[App] MJPEG: " + std::to_string(mjpegDecoder_.framesDecoded()) + " decoded, " +
+               std::to_string(mjpegDecoder_.framesDuplicate()) + " duplicate, " +
+               std::to_string(mjpegDecoder_.framesFailed()) + " failed");
+    }
 
     try
     {
@@ -1432,7 +2032,7 @@ void Application::restartVideoCapture()
         options.enableAudio = audioEnabled_;
         options.desiredWidth = settings_.videoPreferredWidth;
         options.desiredHeight = settings_.videoPreferredHeight;
-        directShowCapture_.start([this](const DirectShowCapture::Frame& frame) {
+        videoCapture().start([this](const DirectShowCapture::Frame& frame) {
             handleFrame(frame);
         }, options);
         logApp("[App] Video capture restarted successfully");
@@ -0,0 +1,225 @@
+#include "AudioKernels.hpp"
+#include "KernelRegistry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <initializer_list>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_AUDIO_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PCKVM_AUDIO_TARGET(features)
+#else
+#define PCKVM_AUDIO_TARGET(features) __attribute__((target(features)))
+#endif
+#else
+#define PCKVM_AUDIO_X86 0
+#endif
+
+namespace
+{
+    // Written as the comparisons MAXPS/MINPS perform, so NaN takes the same
+    // path in every tier.
+    void floatToPcm16Scalar(std::int16_t* dst, const float* src, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            float value = src[i] > -1.0f ? src[i] : -1.0f;
+            value = value < 1.0f ? value : 1.0f;
+            dst[i] = static_cast<std::int16_t>(value * 32767.0f);
+        }
+    }
+
+    int peakMagnitudeScalar(const std::int16_t* samples, std::size_t count)
+    {
+        int peak = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            peak = std::max(peak, std::abs(static_cast<int>(samples[i])));
+        }
+        return peak;
+    }
+
+#if PCKVM_AUDIO_X86
+    PCKVM_AUDIO_TARGET("sse2")
+    __m128i floatToPcm16Quad(const float* src)
+    {
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        return _mm_cvttps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(32767.0f)));
+    }
+
+    PCKVM_AUDIO_TARGET("sse2")
+    void floatToPcm16Sse2(std::int16_t* dst, const float* src, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i packed = _mm_packs_epi32(floatToPcm16Quad(src + i), floatToPcm16Quad(src + i + 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+        }
+        floatToPcm16Scalar(dst + i, src + i, count - i);
+    }
+
+    PCKVM_AUDIO_TARGET("avx2")
+    void floatToPcm16Avx2(std::int16_t* dst, const float* src, std::size_t count)
+    {
+        const __m256 low = _mm256_set1_ps(-1.0f);
+        const __m256 high = _mm256_set1_ps(1.0f);
+        const __m256 scale = _mm256_set1_ps(32767.0f);
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m256i a = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), low), high), scale));
+            const __m256i b = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i + 8), low), high), scale));
+            // packs works within 128-bit lanes; put the quads back in order.
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+        }
+        floatToPcm16Sse2(dst + i, src + i, count - i);
+    }
+
+    // Tracks the largest and the smallest sample; -32768 has no 16-bit
+    // magnitude, so the sign is only dropped once widened to int.
+    PCKVM_AUDIO_TARGET("sse2")
+    int peakMagnitudeSse2(const std::int16_t* samples, std::size_t count)
+    {
+        __m128i largest = _mm_setzero_si128();
+        __m128i smallest = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+            largest = _mm_max_epi16(largest, values);
+            smallest = _mm_min_epi16(smallest, values);
+        }
+        alignas(16) std::int16_t high[8];
+        alignas(16) std::int16_t low[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(high), largest);
+        _mm_store_si128(reinterpret_cast<__m128i*>(low), smallest);
+        int peak = peakMagnitudeScalar(samples + i, count - i);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            peak = std::max({peak, static_cast<int>(high[lane]), -static_cast<int>(low[lane])});
+        }
+        return peak;
+    }
+
+    PCKVM_AUDIO_TARGET("avx2")
+    int peakMagnitudeAvx2(const std::int16_t* samples, std::size_t count)
+    {
+        __m256i largest = _mm256_setzero_si256();
+        __m256i smallest = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+            largest = _mm256_max_epi16(largest, values);
+            smallest = _mm256_min_epi16(smallest, values);
+        }
+        alignas(32) std::int16_t high[16];
+        alignas(32) std::int16_t low[16];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(high), largest);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(low), smallest);
+        int peak = peakMagnitudeSse2(samples + i, count - i);
+        for (int lane = 0; lane < 16; ++lane)
+        {
+            peak = std::max({peak, static_cast<int>(high[lane]), -static_cast<int>(low[lane])});
+        }
+        return peak;
+    }
+#endif
+
+    std::atomic<AudioKernelTier>& activeTier()
+    {
+        static std::atomic<AudioKernelTier> tier = []() {
+            for (AudioKernelTier candidate : {AudioKernelTier::AVX2, AudioKernelTier::SSE2})
+            {
+                if (floatToPcm16Kernel(candidate) && peakMagnitudeKernel(candidate))
+                {
+                    return candidate;
+                }
+            }
+            return AudioKernelTier::Scalar;
+        }();
+        return tier;
+    }
+}
+
+FloatToPcm16Fn floatToPcm16Kernel(AudioKernelTier tier)
+{
+    switch (tier)
+    {
+    case AudioKernelTier::Scalar:
+        return floatToPcm16Scalar;
+#if PCKVM_AUDIO_X86
+    case AudioKernelTier::SSE2:
+        return floatToPcm16Sse2;
+    case AudioKernelTier::AVX2:
+        return cpuFeatures().avx2 ? floatToPcm16Avx2 : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+PeakMagnitudeFn peakMagnitudeKernel(AudioKernelTier tier)
+{
+    switch (tier)
+    {
+    case AudioKernelTier::Scalar:
+        return peakMagnitudeScalar;
+#if PCKVM_AUDIO_X86
+    case AudioKernelTier::SSE2:
+        return peakMagnitudeSse2;
+    case AudioKernelTier::AVX2:
+        return cpuFeatures().avx2 ? peakMagnitudeAvx2 : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+AudioKernelTier activeAudioKernelTier()
+{
+    return activeTier().load(std::memory_order_relaxed);
+}
+
+const char* audioKernelTierName(AudioKernelTier tier)
+{
+    switch (tier)
+    {
+    case AudioKernelTier::Scalar:
+        return "scalar";
+    case AudioKernelTier::SSE2:
+        return "SSE2";
+    case AudioKernelTier::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+bool setActiveAudioKernelTier(AudioKernelTier tier)
+{
+    if (!floatToPcm16Kernel(tier) || !peakMagnitudeKernel(tier))
+    {
+        return false;
+    }
+    activeTier().store(tier, std::memory_order_relaxed);
+    return true;
+}
+
+void convertFloatToPcm16(std::int16_t* dst, const float* src, std::size_t count)
+{
+    floatToPcm16Kernel(activeAudioKernelTier())(dst, src, count);
+}
+
+int peakMagnitude(const std::int16_t* samples, std::size_t count)
+{
+    return peakMagnitudeKernel(activeAudioKernelTier())(samples, count);
+}
@@ -0,0 +1,43 @@
+#include "CaptureSource.hpp"
+
+#include <thread>
+
+namespace
+{
+    using Ticks100ns = std::chrono::duration<std::int64_t, std::ratio<1, 10'000'000>>;
+
+    // Timer sleeps can overshoot by a scheduler quantum; the remainder is
+    // spent yielding.
+    constexpr auto kSleepSlack = std::chrono::milliseconds(2);
+}
+
+bool FramePacer::waitFor(std::uint64_t timestamp100ns, std::uint64_t period100ns)
+{
+    const Clock::time_point now = Clock::now();
+    if (!started_ || timestamp100ns < originTimestamp100ns_)
+    {
+        started_ = true;
+        origin_ = now;
+        originTimestamp100ns_ = timestamp100ns;
+        return true;
+    }
+
+    const Clock::time_point due = origin_ + std::chrono::duration_cast<Clock::duration>(
+                                                Ticks100ns(static_cast<std::int64_t>(timestamp100ns - originTimestamp100ns_)));
+    if (now > due + std::chrono::duration_cast<Clock::duration>(Ticks100ns(static_cast<std::int64_t>(period100ns))))
+    {
+        origin_ = now;
+        originTimestamp100ns_ = timestamp100ns;
+        return false;
+    }
+
+    if (due - now > kSleepSlack)
+    {
+        std::this_thread::sleep_until(due - kSleepSlack);
+    }
+    while (Clock::now() < due)
+    {
+        std::this_thread::yield();
+    }
+    return true;
+}
@@ -0,0 +1,214 @@
+#include "CopyKernels.hpp"
+#include "KernelRegistry.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_COPY_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PCKVM_COPY_TARGET(features)
+#else
+#define PCKVM_COPY_TARGET(features) __attribute__((target(features)))
+#endif
+#else
+#define PCKVM_COPY_X86 0
+#endif
+
+namespace
+{
+    // Short rows are not worth the alignment prologue and the fence.
+    constexpr std::size_t kMinStreamBytes = 256;
+
+    void copyMemcpy(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes)
+    {
+        std::memcpy(dst, src, bytes);
+    }
+
+#if PCKVM_COPY_X86
+    // Brings dst up to `alignment` with ordinary stores; returns bytes consumed.
+    std::size_t alignHead(std::uint8_t* dst, const std::uint8_t* src, std::size_t alignment)
+    {
+        const std::size_t head = (alignment - (reinterpret_cast<std::uintptr_t>(dst) & (alignment - 1))) & (alignment - 1);
+        std::memcpy(dst, src, head);
+        return head;
+    }
+
+    PCKVM_COPY_TARGET("sse2")
+    void copyStreamSse2(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes)
+    {
+        if (bytes < kMinStreamBytes)
+        {
+            std::memcpy(dst, src, bytes);
+            return;
+        }
+
+        const std::size_t head = alignHead(dst, src, 16);
+        std::size_t i = head;
+        for (; i + 64 <= bytes; i += 64)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), d);
+        }
+        for (; i + 16 <= bytes; i += 16)
+        {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        }
+        std::memcpy(dst + i, src + i, bytes - i);
+    }
+
+    PCKVM_COPY_TARGET("avx2")
+    void copyStreamAvx2(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes)
+    {
+        if (bytes < kMinStreamBytes)
+        {
+            std::memcpy(dst, src, bytes);
+            return;
+        }
+
+        const std::size_t head = alignHead(dst, src, 32);
+        std::size_t i = head;
+        for (; i + 128 <= bytes; i += 128)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+            const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 64));
+            const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 96));
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), a);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 32), b);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 64), c);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 96), d);
+        }
+        for (; i + 32 <= bytes; i += 32)
+        {
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        }
+        std::memcpy(dst + i, src + i, bytes - i);
+    }
+
+    PCKVM_COPY_TARGET("avx512f")
+    void copyStreamAvx512(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes)
+    {
+        if (bytes < kMinStreamBytes)
+        {
+            std::memcpy(dst, src, bytes);
+            return;
+        }
+
+        const std::size_t head = alignHead(dst, src, 64);
+        std::size_t i = head;
+        for (; i + 256 <= bytes; i += 256)
+        {
+            const __m512i a = _mm512_loadu_si512(src + i);
+            const __m512i b = _mm512_loadu_si512(src + i + 64);
+            const __m512i c = _mm512_loadu_si512(src + i + 128);
+            const __m512i d = _mm512_loadu_si512(src + i + 192);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), a);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i + 64), b);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i + 128), c);
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i + 192), d);
+        }
+        for (; i + 64 <= bytes; i += 64)
+        {
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), _mm512_loadu_si512(src + i));
+        }
+        std::memcpy(dst + i, src + i, bytes - i);
+    }
+#endif
+
+    // Swapped by setActiveCopyKernelTier() while other threads copy; a row
+    // runs entirely on whichever kernel it loaded.
+    struct Selection {
+        std::atomic<CopyKernelTier> tier;
+        std::atomic<RowCopyFn> kernel;
+    };
+
+    Selection& selection()
+    {
+        static Selection selected = []() {
+            for (CopyKernelTier candidate : {CopyKernelTier::AVX512, CopyKernelTier::AVX2, CopyKernelTier::SSE2})
+            {
+                if (RowCopyFn kernel = copyKernelFor(candidate))
+                {
+                    return Selection{candidate, kernel};
+                }
+            }
+            return Selection{CopyKernelTier::Memcpy, copyMemcpy};
+        }();
+        return selected;
+    }
+}
+
+RowCopyFn copyKernelFor(CopyKernelTier tier)
+{
+#if PCKVM_COPY_X86
+    const CpuFeatures& features = cpuFeatures();
+    switch (tier)
+    {
+    case CopyKernelTier::Memcpy:
+        return copyMemcpy;
+    case CopyKernelTier::SSE2:
+        return copyStreamSse2;
+    case CopyKernelTier::AVX2:
+        return features.avx2 ? copyStreamAvx2 : nullptr;
+    case CopyKernelTier::AVX512:
+        return features.avx512f ? copyStreamAvx512 : nullptr;
+    }
+    return nullptr;
+#else
+    return tier == CopyKernelTier::Memcpy ? copyMemcpy : nullptr;
+#endif
+}
+
+bool setActiveCopyKernelTier(CopyKernelTier tier)
+{
+    RowCopyFn kernel = copyKernelFor(tier);
+    if (!kernel)
+    {
+        return false;
+    }
+    selection().kernel.store(kernel, std::memory_order_relaxed);
+    selection().tier.store(tier, std::memory_order_relaxed);
+    return true;
+}
+
+void streamCopy(std::uint8_t* dst, const std::uint8_t* src, std::size_t bytes)
+{
+    selection().kernel.load(std::memory_order_relaxed)(dst, src, bytes);
+}
+
+void streamCopyFence()
+{
+#if PCKVM_COPY_X86
+    _mm_sfence();
+#endif
+}
+
+CopyKernelTier activeCopyKernelTier()
+{
+    return selection().tier.load(std::memory_order_relaxed);
+}
+
+const char* copyKernelTierName(CopyKernelTier tier)
+{
+    switch (tier)
+    {
+    case CopyKernelTier::Memcpy:
+        return "memcpy";
+    case CopyKernelTier::SSE2:
+        return "SSE2";
+    case CopyKernelTier::AVX2:
+        return "AVX2";
+    case CopyKernelTier::AVX512:
+        return "AVX-512";
+    }
+    return "unknown";
+}
@@ -1,4 +1,6 @@
 #include "D3DRenderer.hpp"
+#include "CopyKernels.hpp"
+#include "ScalingFilter.hpp"
 
 #include <d3d12.h>
 #include <d3d12sdklayers.h>
@@ -16,6 +18,7 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #ifndef PCKVM_RENDERER_LOGGING
@@ -41,6 +44,24 @@ namespace
 
     constexpr std::array<std::uint16_t, 6> kIndices = {0, 1, 2, 2, 1, 3};
 
+    // MSVC's steady_clock reads QueryPerformanceCounter, so DXGI's QPC stamps
+    // become latencyClockNs() time by scaling alone.
+    std::uint64_t qpcToLatencyNs(LONGLONG ticks)
+    {
+        static const LONGLONG frequency = [] {
+            LARGE_INTEGER value{};
+            QueryPerformanceFrequency(&value);
+            return value.QuadPart;
+        }();
+        if (ticks <= 0 || frequency <= 0)
+        {
+            return 0;
+        }
+        const auto whole = static_cast<std::uint64_t>(ticks / frequency);
+        const auto part = static_cast<std::uint64_t>(ticks % frequency);
+        return whole * 1'000'000'000ull + part * 1'000'000'000ull / static_cast<std::uint64_t>(frequency);
+    }
+
     constexpr const char* kVertexShaderSource = R"(struct VSInput
 {
     float3 position : POSITION;
@@ -65,18 +86,117 @@ VSOutput main(VSInput input)
 }
 )";
 
+    // Compiled once per ScalingFilter with FILTER set to its value; the CPU
+    // kernels in ScalingFilter.cpp compute the same taps.
     constexpr const char* kPixelShaderSource = R"(Texture2D frameTex : register(t0);
 SamplerState frameSampler : register(s0);
 
+cbuffer FilterConstants : register(b0)
+{
+    float2 textureSize;
+    float sharpenPeak;
+    float unused;
+};
+
 struct PSInput
 {
     float4 position : SV_Position;
     float2 tex : TEXCOORD0;
 };
 
+float4 texel(int2 coord)
+{
+    return frameTex.Load(int3(clamp(coord, int2(0, 0), int2(textureSize) - 1), 0));
+}
+
+float catmullRom(float x)
+{
+    x = abs(x);
+    if (x < 1.0f)
+    {
+        return (1.5f * x - 2.5f) * x * x + 1.0f;
+    }
+    return x < 2.0f ? ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f : 0.0f;
+}
+
+float lanczos3(float x)
+{
+    x = abs(x);
+    if (x < 1e-5f)
+    {
+        return 1.0f;
+    }
+    if (x >= 3.0f)
+    {
+        return 0.0f;
+    }
+    const float px = 3.14159265f * x;
+    return 3.0f * sin(px) * sin(px / 3.0f) / (px * px);
+}
+
+float4 sharpenTexel(int2 coord)
+{
+    const float4 c = texel(coord);
+    const float4 n = texel(coord + int2(0, -1));
+    const float4 s = texel(coord + int2(0, 1));
+    const float4 e = texel(coord + int2(1, 0));
+    const float4 w = texel(coord + int2(-1, 0));
+    const float4 low = min(c, min(min(n, s), min(e, w)));
+    const float4 high = max(c, max(max(n, s), max(e, w)));
+    const float4 headroom = saturate(min(low, 1.0f - high) / max(high, 1.0f / 255.0f));
+    const float4 weight = sqrt(headroom) * sharpenPeak;
+    return saturate((c + weight * ((n + s) + (e + w))) / (1.0f + 4.0f * weight));
+}
+
 float4 main(PSInput input) : SV_Target
 {
+#if FILTER == 0
     return frameTex.Sample(frameSampler, input.tex);
+#elif FILTER == 1
+    return texel(int2(floor(input.tex * textureSize)));
+#elif FILTER == 4
+    const float2 position = input.tex * textureSize - 0.5f;
+    const int2 base = int2(floor(position));
+    const float2 fraction = position - floor(position);
+    const float4 top = lerp(sharpenTexel(base), sharpenTexel(base + int2(1, 0)), fraction.x);
+    const float4 bottom = lerp(sharpenTexel(base + int2(0, 1)), sharpenTexel(base + int2(1, 1)), fraction.x);
+    return lerp(top, bottom, fraction.y);
+#else
+#if FILTER == 2
+#define TAPS 4
+#else
+#define TAPS 6
+#endif
+    const float2 position = input.tex * textureSize - 0.5f;
+    const int2 base = int2(floor(position)) - (TAPS / 2 - 1);
+    const float2 fraction = position - floor(position);
+    float weightsX[TAPS];
+    float weightsY[TAPS];
+    float2 total = 0.0f;
+    [unroll] for (int i = 0; i < TAPS; ++i)
+    {
+        const float2 distance = float(i - (TAPS / 2 - 1)) - fraction;
+#if FILTER == 2
+        weightsX[i] = catmullRom(distance.x);
+        weightsY[i] = catmullRom(distance.y);
+#else
+        weightsX[i] = lanczos3(distance.x);
+        weightsY[i] = lanczos3(distance.y);
+#endif
+        total += float2(weightsX[i], weightsY[i]);
+    }
+    float4 color = 0.0f;
+    [unroll] for (int y = 0; y < TAPS; ++y)
+    {
+        float4 row = 0.0f;
+        [unroll] for (int x = 0; x < TAPS; ++x)
+        {
+            row += weightsX[x] * texel(base + int2(x, y));
+        }
+        color += weightsY[y] * row;
+    }
+    return saturate(color / (total.x * total.y));
+#endif
 }
 )";
 
@@ -266,6 +386,12 @@ void D3DRenderer::shutdown()
         fenceEvent_ = nullptr;
     }
 
+    if (sinkFenceEvent_)
+    {
+        CloseHandle(sinkFenceEvent_);
+        sinkFenceEvent_ = nullptr;
+    }
+
     commandList_.Reset();
     for (auto& ctx : frameContexts_)
     {
@@ -284,7 +410,10 @@ void D3DRenderer::shutdown()
     rtvHeap_.Reset();
 
     pipelineStateGradient_.Reset();
-    pipelineState_.Reset();
+    for (auto& pipelineState : pipelineStates_)
+    {
+        pipelineState.Reset();
+    }
     rootSignature_.Reset();
     indexBuffer_.Reset();
     vertexBuffer_.Reset();
@@ -293,7 +422,7 @@ void D3DRenderer::shutdown()
     commandQueue_.Reset();
     device_.Reset();
 
-    frameWidth_ = frameHeight_ = frameStride_ = 0;
+    frameWidth_ = frameHeight_ = 0;
     backBufferWidth_ = backBufferHeight_ = 0;
     fenceValue_ = 1;
     allowTearing_ = false;
@@ -338,145 +467,166 @@ void D3DRenderer::onResize(UINT width, UINT height)
     updateViewport(backBufferWidth_, backBufferHeight_);
 }
 
-bool D3DRenderer::ensureFrameResources(std::uint32_t width,
-                                       std::uint32_t height,
-                                       std::uint32_t stride)
+bool D3DRenderer::ensureFrameResources(std::uint32_t width, std::uint32_t height)
 {
     if (!device_ || width == 0 || height == 0)
     {
         return false;
     }
 
-    const std::uint32_t effectiveStride = stride != 0 ? stride : width * 4;
+    if (frameTexture_ && frameWidth_ == width && frameHeight_ == height)
+    {
+        return true;
+    }
 
-    const bool needsRecreate = !frameTexture_
-        || frameWidth_ != width
-        || frameHeight_ != height
-        || frameStride_ != effectiveStride;
+    waitForGpu();
+    destroyFrameResources();
 
-    if (needsRecreate)
+    D3D12_RESOURCE_DESC desc{};
+    desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    desc.Alignment = 0;
+    desc.Width = width;
+    desc.Height = height;
+    desc.DepthOrArraySize = 1;
+    desc.MipLevels = 1;
+    desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    D3D12_HEAP_PROPERTIES defaultHeap{};
+    defaultHeap.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+    HRESULT hr = device_->CreateCommittedResource(&defaultHeap,
+                                                  D3D12_HEAP_FLAG_NONE,
+                                                  &desc,
+                                                  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                                                  nullptr,
+                                                  IID_PPV_ARGS(frameTexture_.GetAddressOf()));
+    if (FAILED(hr))
     {
-        waitForGpu();
-        destroyFrameResources();
+        logFailure("CreateCommittedResource frame texture", hr);
+        frameTexture_.Reset();
+        return false;
+    }
 
-        D3D12_RESOURCE_DESC desc{};
-        desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-        desc.Alignment = 0;
-        desc.Width = width;
-        desc.Height = height;
-        desc.DepthOrArraySize = 1;
-        desc.MipLevels = 1;
-        desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-        desc.SampleDesc.Count = 1;
-        desc.SampleDesc.Quality = 0;
-        desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-        desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-        D3D12_HEAP_PROPERTIES defaultHeap{};
-        defaultHeap.Type = D3D12_HEAP_TYPE_DEFAULT;
-
-        HRESULT hr = device_->CreateCommittedResource(&defaultHeap,
-                                                      D3D12_HEAP_FLAG_NONE,
-                                                      &desc,
-                                                      D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                                                      nullptr,
-                                                      IID_PPV_ARGS(frameTexture_.GetAddressOf()));
-        if (FAILED(hr))
+    device_->CreateShaderResourceView(frameTexture_.Get(), nullptr, srvHandleFrameCpu_);
+
+    std::uint64_t totalBytes = 0;
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint{};
+
+    device_->GetCopyableFootprints(&desc,
+                                   0,
+                                   1,
+                                   0,
+                                   &footprint,
+                                   nullptr,
+                                   nullptr,
+                                   &totalBytes);
+
+    D3D12_HEAP_PROPERTIES uploadHeap{};
+    uploadHeap.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+    D3D12_RESOURCE_DESC uploadDesc{};
+    uploadDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    uploadDesc.Alignment = 0;
+    uploadDesc.Width = totalBytes;
+    uploadDesc.Height = 1;
+    uploadDesc.DepthOrArraySize = 1;
+    uploadDesc.MipLevels = 1;
+    uploadDesc.Format = DXGI_FORMAT_UNKNOWN;
+    uploadDesc.SampleDesc.Count = 1;
+    uploadDesc.SampleDesc.Quality = 0;
+    uploadDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    uploadDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    bool uploadsCreated = true;
+    frameUploads_.forEachSlot([&](UploadResource& upload) {
+        if (!uploadsCreated)
         {
-            logFailure("CreateCommittedResource frame texture", hr);
-            frameTexture_.Reset();
-            return false;
+            return;
         }
 
-        device_->CreateShaderResourceView(frameTexture_.Get(), nullptr, srvHandleFrameCpu_);
-
-        std::uint64_t totalBytes = 0;
-        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint{};
-
-        device_->GetCopyableFootprints(&desc,
-                                       0,
-                                       1,
-                                       0,
-                                       &footprint,
-                                       nullptr,
-                                       nullptr,
-                                       &totalBytes);
-
-        D3D12_HEAP_PROPERTIES uploadHeap{};
-        uploadHeap.Type = D3D12_HEAP_TYPE_UPLOAD;
-
-        D3D12_RESOURCE_DESC uploadDesc{};
-        uploadDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-        uploadDesc.Alignment = 0;
-        uploadDesc.Width = totalBytes;
-        uploadDesc.Height = 1;
-        uploadDesc.DepthOrArraySize = 1;
-        uploadDesc.MipLevels = 1;
-        uploadDesc.Format = DXGI_FORMAT_UNKNOWN;
-        uploadDesc.SampleDesc.Count = 1;
-        uploadDesc.SampleDesc.Quality = 0;
-        uploadDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-        uploadDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-        for (auto& upload : frameUploads_)
+        HRESULT uploadHr = device_->CreateCommittedResource(&uploadHeap,
+                                                            D3D12_HEAP_FLAG_NONE,
+                                                            &uploadDesc,
+                                                            D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                            nullptr,
+                                                            IID_PPV_ARGS(upload.resource.GetAddressOf()));
+        if (FAILED(uploadHr))
         {
-            HRESULT uploadHr = device_->CreateCommittedResource(&uploadHeap,
-                                                                D3D12_HEAP_FLAG_NONE,
-                                                                &uploadDesc,
-                                                                D3D12_RESOURCE_STATE_GENERIC_READ,
-                                                                nullptr,
-                                                                IID_PPV_ARGS(upload.resource.GetAddressOf()));
-            if (FAILED(uploadHr))
-            {
-                logFailure("CreateCommittedResource frame upload", uploadHr);
-                destroyFrameResources();
-                frameTexture_.Reset();
-                return false;
-            }
+            logFailure("CreateCommittedResource frame upload", uploadHr);
+            uploadsCreated = false;
+            return;
+        }
 
-            upload.layout = footprint;
-            upload.sizeBytes = totalBytes;
+        upload.layout = footprint;
+        upload.sizeBytes = totalBytes;
 
-            uploadHr = upload.resource->Map(0, nullptr, reinterpret_cast<void**>(&upload.cpuAddress));
-            if (FAILED(uploadHr))
-            {
-                logFailure("Map frame upload buffer", uploadHr);
-                destroyFrameResources();
-                frameTexture_.Reset();
-                return false;
-            }
+        uploadHr = upload.resource->Map(0, nullptr, reinterpret_cast<void**>(&upload.cpuAddress));
+        if (FAILED(uploadHr))
+        {
+            logFailure("Map frame upload buffer", uploadHr);
+            upload.cpuAddress = nullptr;
+            uploadsCreated = false;
         }
+    });
 
-        std::fill(std::begin(pendingUpload_), std::end(pendingUpload_), false);
+    if (!uploadsCreated)
+    {
+        destroyFrameResources();
+        return false;
     }
 
+    pendingUpload_ = false;
+    textureSequence_ = 0;
+    uploadRects_.reserve(DirtyTracker::kMaxRects);
     frameWidth_ = width;
     frameHeight_ = height;
-    frameStride_ = effectiveStride;
+    uploadsReady_.store(true, std::memory_order_seq_cst);
 
     return true;
 }
 
 void D3DRenderer::destroyFrameResources()
 {
-    for (auto& upload : frameUploads_)
+    // Fence the capture thread out of the upload ring before touching it.
+    uploadsReady_.store(false, std::memory_order_seq_cst);
+    while (sinkWriterActive_.load(std::memory_order_seq_cst))
     {
+        std::this_thread::yield();
+    }
+
+    frameUploads_.forEachSlot([](UploadResource& upload) {
         if (upload.resource && upload.cpuAddress)
         {
             upload.resource->Unmap(0, nullptr);
         }
-
-        upload.cpuAddress = nullptr;
-        upload.resource.Reset();
-        upload.layout = {};
-        upload.sizeBytes = 0;
-    }
+    });
+    frameUploads_.reset();
 
     frameTexture_.Reset();
-    std::fill(std::begin(pendingUpload_), std::end(pendingUpload_), false);
+    pendingUpload_ = false;
+    textureSequence_ = 0;
     frameWidth_ = 0;
     frameHeight_ = 0;
-    frameStride_ = 0;
+}
+
+void D3DRenderer::waitForUpload(const UploadResource& upload, HANDLE event)
+{
+    if (!fence_ || !event || upload.fenceValue == 0)
+    {
+        return;
+    }
+
+    if (fence_->GetCompletedValue() >= upload.fenceValue)
+    {
+        return;
+    }
+
+    fence_->SetEventOnCompletion(upload.fenceValue, event);
+    WaitForSingleObject(event, INFINITE);
 }
 
 void D3DRenderer::uploadFrame(const void* data,
@@ -490,26 +640,20 @@ void D3DRenderer::uploadFrame(const void* data,
     }
 
     const std::uint32_t effectiveStride = stride != 0 ? stride : width * 4;
-    if (!ensureFrameResources(width, height, effectiveStride))
+    if (!ensureFrameResources(width, height))
     {
         return;
     }
 
-    UINT uploadIndex = 0;
-    if (swapChain_)
-    {
-        uploadIndex = swapChain_->GetCurrentBackBufferIndex();
-        uploadIndex %= kFrameCount;
-    }
-
-    waitForFrame(frameContexts_[uploadIndex]);
-
-    UploadResource& upload = frameUploads_[uploadIndex];
+    // The consumer-owned slot of the ring; the capture thread never writes it.
+    UploadResource& upload = frameUploads_.frontSlot();
     if (!upload.cpuAddress || upload.layout.Footprint.RowPitch == 0)
     {
         return;
     }
 
+    waitForUpload(upload, fenceEvent_);
+
     const auto* sourceBytes = static_cast<const std::uint8_t*>(data);
     const std::uint32_t bytesPerPixel = 4;
     const std::size_t rowCopySize = static_cast<std::size_t>(frameWidth_) * bytesPerPixel;
@@ -521,17 +665,82 @@ void D3DRenderer::uploadFrame(const void* data,
     {
         const std::size_t srcOffset = static_cast<std::size_t>(row) * effectiveStride;
         std::uint8_t* dstRow = dstBase + static_cast<std::size_t>(row) * dstPitch;
-        std::memcpy(dstRow, sourceBytes + srcOffset, copyBytes);
+        streamCopy(dstRow, sourceBytes + srcOffset, copyBytes);
         if (copyBytes < dstPitch)
         {
             std::memset(dstRow + copyBytes, 0, dstPitch - copyBytes);
         }
     }
+    streamCopyFence();
 
-    pendingUpload_[uploadIndex] = true;
+    // Not a tracked frame, so the sink has to rewrite this slot in full.
+    upload.sequence = 0;
+    recordCopy(copyBytes * height);
+    pendingUpload_ = true;
     loggedGpuPixels_ = false;
 }
 
+bool D3DRenderer::beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target)
+{
+    sinkWriterActive_.store(true, std::memory_order_seq_cst);
+    if (!uploadsReady_.load(std::memory_order_seq_cst) || width != frameWidth_ || height != frameHeight_)
+    {
+        sinkWriterActive_.store(false, std::memory_order_release);
+        return false;
+    }
+
+    UploadResource& upload = frameUploads_.writeSlot();
+    if (!upload.cpuAddress || upload.layout.Footprint.RowPitch == 0)
+    {
+        sinkWriterActive_.store(false, std::memory_order_release);
+        return false;
+    }
+
+    // The GPU copy that last read this slot finishes long before the next
+    // capture normally arrives, so this almost never waits.
+    waitForUpload(upload, sinkFenceEvent_);
+
+    target.data = upload.cpuAddress + upload.layout.Offset;
+    target.rowPitch = upload.layout.Footprint.RowPitch;
+    target.width = width;
+    target.height = height;
+    target.contentSequence = upload.sequence;
+    return true;
+}
+
+void D3DRenderer::commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence)
+{
+    UploadResource& upload = frameUploads_.writeSlot();
+    upload.sequence = sequence;
+    upload.sourceWidth = frame.width;
+    upload.sourceHeight = frame.height;
+    upload.timestamps = FrameTimestamps{frame.arrivalNs, latencyClockNs()};
+    frameUploads_.publish();
+    sinkWriterActive_.store(false, std::memory_order_release);
+}
+
+bool D3DRenderer::acquireSinkFrame(FrameTimestamps* timestamps)
+{
+    if (!uploadsReady_.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    const UploadResource* upload = frameUploads_.acquireLatest();
+    if (!upload)
+    {
+        return false;
+    }
+    if (timestamps)
+    {
+        *timestamps = upload->timestamps;
+    }
+
+    pendingUpload_ = true;
+    loggedGpuPixels_ = false;
+    return true;
+}
+
 void D3DRenderer::render(const std::function<void(ID3D12GraphicsCommandList*)>& overlayCallback)
 {
     if (!swapChain_ || !commandQueue_ || !commandList_)
@@ -562,8 +771,39 @@ void D3DRenderer::render(const std::function<void(ID3D12GraphicsCommandList*)>&
         return;
     }
 
-    UploadResource& upload = frameUploads_[backBufferIndex];
-    if (pendingUpload_[backBufferIndex] && frameTexture_ && upload.resource)
+    UploadResource& upload = frameUploads_.frontSlot();
+    bool copyUpload = pendingUpload_ && frameTexture_ && upload.resource;
+    bool partialUpload = false;
+    if (copyUpload && dirtyTracker_ && dirtyTracker_->collectSince(textureSequence_, upload.sequence, uploadMask_))
+    {
+        // Tiles are tracked on the captured frame, which may have been
+        // downscaled to the texture.
+        const std::uint32_t sourceWidth = upload.sourceWidth != 0 ? upload.sourceWidth : frameWidth_;
+        const std::uint32_t sourceHeight = upload.sourceHeight != 0 ? upload.sourceHeight : frameHeight_;
+        const std::uint32_t tilesX = (sourceWidth + DirtyTracker::kTileSize - 1) / DirtyTracker::kTileSize;
+        const std::uint32_t tilesY = (sourceHeight + DirtyTracker::kTileSize - 1) / DirtyTracker::kTileSize;
+        if (uploadMask_.tilesX == 0 || (uploadMask_.tilesX == tilesX && uploadMask_.tilesY == tilesY))
+        {
+            DirtyTracker::buildRects(uploadMask_, sourceWidth, sourceHeight, uploadRects_);
+            if (sourceWidth != frameWidth_ || sourceHeight != frameHeight_)
+            {
+                for (DirtyRect& rect : uploadRects_)
+                {
+                    rect = scaleDirtyRect(rect, sourceWidth, sourceHeight, frameWidth_, frameHeight_);
+                }
+            }
+            partialUpload = true;
+        }
+        if (partialUpload && uploadRects_.empty())
+        {
+            // Nothing changed since the texture's frame.
+            copyUpload = false;
+            pendingUpload_ = false;
+            textureSequence_ = upload.sequence;
+        }
+    }
+
+    if (copyUpload)
     {
         D3D12_RESOURCE_BARRIER toCopy{};
         toCopy.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -584,7 +824,21 @@ void D3DRenderer::render(const std::function<void(ID3D12GraphicsCommandList*)>&
         src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
         src.PlacedFootprint = upload.layout;
 
-        commandList_->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        if (partialUpload)
+        {
+            for (const DirtyRect& rect : uploadRects_)
+            {
+                const D3D12_BOX box{rect.left, rect.top, 0, rect.right, rect.bottom, 1};
+                commandList_->CopyTextureRegion(&dst, rect.left, rect.top, 0, &src, &box);
+                texelsUploaded_ += static_cast<std::uint64_t>(rect.right - rect.left) * (rect.bottom - rect.top);
+            }
+        }
+        else
+        {
+            commandList_->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+            texelsUploaded_ += static_cast<std::uint64_t>(frameWidth_) * frameHeight_;
+        }
+        textureSequence_ = upload.sequence;
 
         D3D12_RESOURCE_BARRIER toShader{};
         toShader.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -595,7 +849,7 @@ void D3DRenderer::render(const std::function<void(ID3D12GraphicsCommandList*)>&
         toShader.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
         commandList_->ResourceBarrier(1, &toShader);
 
-        pendingUpload_[backBufferIndex] = false;
+        pendingUpload_ = false;
 
 #if PCKVM_RENDERER_LOGGING
         if (!loggedGpuPixels_ && upload.cpuAddress)
@@ -656,12 +910,15 @@ void D3DRenderer::render(const std::function<void(ID3D12GraphicsCommandList*)>&
     commandList_->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
 
     commandList_->SetGraphicsRootSignature(rootSignature_.Get());
-    commandList_->SetPipelineState(debugGradient_ ? pipelineStateGradient_.Get() : pipelineState_.Get());
+    commandList_->SetPipelineState(debugGradient_ ? pipelineStateGradient_.Get()
+                                                  : pipelineStates_[static_cast<unsigned int>(scalingFilter_)].Get());
 
     ID3D12DescriptorHeap* heaps[] = {srvHeap_.Get(), samplerHeap_.Get()};
     commandList_->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
     commandList_->SetGraphicsRootDescriptorTable(0, srvHandleFrameGpu_);
     commandList_->SetGraphicsRootDescriptorTable(1, samplerHandleGpu_);
+    const float filterConstants[] = {static_cast<float>(frameWidth_), static_cast<float>(frameHeight_), kSharpenPeak, 0.f};
+    commandList_->SetGraphicsRoot32BitConstants(2, static_cast<UINT>(std::size(filterConstants)), filterConstants, 0);
 
     commandList_->RSSetViewports(1, &viewport_);
     commandList_->RSSetScissorRects(1, &scissorRect_);
@@ -697,14 +954,36 @@ void D3DRenderer::render(const std::function<void(ID3D12GraphicsCommandList*)>&
 
     ID3D12CommandList* const commandLists[] = {commandList_.Get()};
     commandQueue_->ExecuteCommandLists(1, commandLists);
+    lastSubmitNs_ = latencyClockNs();
 
     const UINT syncInterval = allowTearing_ ? 0u : 1u;
     const UINT presentFlags = allowTearing_ ? DXGI_PRESENT_ALLOW_TEARING : 0u;
     swapChain_->Present(syncInterval, presentFlags);
+    lastPresentNs_ = latencyClockNs();
+
+    UINT presentId = 0;
+    if (SUCCEEDED(swapChain_->GetLastPresentCount(&presentId)))
+    {
+        lastPresentId_ = presentId;
+    }
+    // Fails until the first frame is on screen, and whenever DXGI lost track
+    // (mode changes, occlusion); the last good values are kept meanwhile.
+    DXGI_FRAME_STATISTICS frameStats{};
+    if (SUCCEEDED(swapChain_->GetFrameStatistics(&frameStats)) && frameStats.SyncQPCTime.QuadPart != 0)
+    {
+        presentStats_.presentId = frameStats.PresentCount;
+        presentStats_.presentRefresh = frameStats.PresentRefreshCount;
+        presentStats_.syncRefresh = frameStats.SyncRefreshCount;
+        presentStats_.syncNs = qpcToLatencyNs(frameStats.SyncQPCTime.QuadPart);
+    }
 
     const std::uint64_t fenceValue = fenceValue_++;
     commandQueue_->Signal(fence_.Get(), fenceValue);
     frameContext.fenceValue = fenceValue;
+    if (copyUpload)
+    {
+        upload.fenceValue = fenceValue;
+    }
 }
 
 void D3DRenderer::setDebugGradient(bool enable)
@@ -713,11 +992,16 @@ void D3DRenderer::setDebugGradient(bool enable)
 #if PCKVM_RENDERER_LOGGING
     std::ostringstream oss;
     oss << "[Renderer] Debug gradient " << (enable ? "enabled" : "disabled")
-        << " psoPtr=" << (enable ? pipelineStateGradient_.Get() : pipelineState_.Get());
+        << " psoPtr=" << (enable ? pipelineStateGradient_.Get() : pipelineStates_[static_cast<unsigned int>(scalingFilter_)].Get());
     logMessage(oss.str());
 #endif
 }
 
+void D3DRenderer::setScalingFilter(ScalingFilter filter)
+{
+    scalingFilter_ = static_cast<unsigned int>(filter) < kScalingFilterCount ? filter : ScalingFilter::Bilinear;
+}
+
 bool D3DRenderer::createDevice(HWND, bool useDebugLayer)
 {
     ComPtr<IDXGIFactory6> factory;
@@ -839,7 +1123,8 @@ bool D3DRenderer::createDevice(HWND, bool useDebugLayer)
     }
 
     fenceEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (!fenceEvent_)
+    sinkFenceEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!fenceEvent_ || !sinkFenceEvent_)
     {
         logMessage("[Renderer] CreateEvent failed");
         return false;
@@ -1055,7 +1340,7 @@ bool D3DRenderer::createPipelineResources()
     indexBufferView_.SizeInBytes = ibSize;
 
     ComPtr<ID3DBlob> vsBlob;
-    ComPtr<ID3DBlob> psBlob;
+    std::array<ComPtr<ID3DBlob>, kScalingFilterCount> psBlobs;
     ComPtr<ID3DBlob> psGradientBlob;
     ComPtr<ID3DBlob> errorBlob;
 
@@ -1080,21 +1365,27 @@ bool D3DRenderer::createPipelineResources()
         return false;
     }
 
-    errorBlob.Reset();
-    if (FAILED(D3DCompile(kPixelShaderSource,
-                          std::strlen(kPixelShaderSource),
-                          nullptr,
-                          nullptr,
-                          nullptr,
-                          "main",
-                          "ps_5_0",
-                          compileFlags,
-                          0,
-                          psBlob.GetAddressOf(),
-                          errorBlob.GetAddressOf())))
-    {
-        logMessage("[Renderer] Pixel shader compilation failed");
-        return false;
+    static constexpr const char* kFilterValues[kScalingFilterCount] = {"0", "1", "2", "3", "4"};
+    for (unsigned int filter = 0; filter < kScalingFilterCount; ++filter)
+    {
+        const D3D_SHADER_MACRO defines[] = {{"FILTER", kFilterValues[filter]}, {nullptr, nullptr}};
+        errorBlob.Reset();
+        if (FAILED(D3DCompile(kPixelShaderSource,
+                              std::strlen(kPixelShaderSource),
+                              nullptr,
+                              defines,
+                              nullptr,
+                              "main",
+                              "ps_5_0",
+                              compileFlags,
+                              0,
+                              psBlobs[filter].GetAddressOf(),
+                              errorBlob.GetAddressOf())))
+        {
+            logMessage(std::string("[Renderer] Pixel shader compilation failed (") +
+                       scalingFilterName(static_cast<ScalingFilter>(filter)) + ")");
+            return false;
+        }
     }
 
     errorBlob.Reset();
@@ -1128,7 +1419,7 @@ bool D3DRenderer::createPipelineResources()
     samplerRange.RegisterSpace = 0;
     samplerRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-    D3D12_ROOT_PARAMETER rootParameters[2] = {};
+    D3D12_ROOT_PARAMETER rootParameters[3] = {};
     rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
     rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
     rootParameters[0].DescriptorTable.NumDescriptorRanges = 1;
@@ -1139,8 +1430,14 @@ bool D3DRenderer::createPipelineResources()
     rootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
     rootParameters[1].DescriptorTable.pDescriptorRanges = &samplerRange;
 
+    rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+    rootParameters[2].Constants.ShaderRegister = 0;
+    rootParameters[2].Constants.RegisterSpace = 0;
+    rootParameters[2].Constants.Num32BitValues = 4;
+
     D3D12_ROOT_SIGNATURE_DESC rootDesc{};
-    rootDesc.NumParameters = 2;
+    rootDesc.NumParameters = static_cast<UINT>(std::size(rootParameters));
     rootDesc.pParameters = rootParameters;
     rootDesc.NumStaticSamplers = 0;
     rootDesc.pStaticSamplers = nullptr;
@@ -1208,7 +1505,6 @@ bool D3DRenderer::createPipelineResources()
     psoDesc.InputLayout = {inputLayout, static_cast<UINT>(std::size(inputLayout))};
     psoDesc.pRootSignature = rootSignature_.Get();
     psoDesc.VS = {vsBlob->GetBufferPointer(), vsBlob->GetBufferSize()};
-    psoDesc.PS = {psBlob->GetBufferPointer(), psBlob->GetBufferSize()};
     psoDesc.RasterizerState = rasterDesc;
     psoDesc.BlendState = blendDesc;
     psoDesc.DepthStencilState = depthDesc;
@@ -1218,12 +1514,16 @@ bool D3DRenderer::createPipelineResources()
     psoDesc.RTVFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM;
     psoDesc.SampleDesc.Count = 1;
 
-    hr = device_->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipelineState_.GetAddressOf()));
-    if (FAILED(hr))
+    for (unsigned int filter = 0; filter < kScalingFilterCount; ++filter)
     {
-        logFailure("CreateGraphicsPipelineState (frame)", hr);
-        logInfoQueueMessages(device_.Get(), "CreateGraphicsPipelineState (frame)");
-        return false;
+        psoDesc.PS = {psBlobs[filter]->GetBufferPointer(), psBlobs[filter]->GetBufferSize()};
+        hr = device_->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipelineStates_[filter].GetAddressOf()));
+        if (FAILED(hr))
+        {
+            logFailure("CreateGraphicsPipelineState (frame)", hr);
+            logInfoQueueMessages(device_.Get(), "CreateGraphicsPipelineState (frame)");
+            return false;
+        }
     }
 
     psoDesc.PS = {psGradientBlob->GetBufferPointer(), psGradientBlob->GetBufferSize()};
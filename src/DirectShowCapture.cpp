@@ -1,4 +1,5 @@
 #include "DirectShowCapture.hpp"
+#include "LatencyStats.hpp"
 
 #include <Windows.h>
 #include <OleAuto.h>
@@ -13,6 +14,7 @@
 #include <condition_variable>
 #include <exception>
 #include <fstream>
+#include <iomanip>
 #include <mutex>
 #include <sstream>
 #include <stdexcept>
@@ -107,6 +109,168 @@ namespace
             mt.pUnk = nullptr;
         }
     }
+
+    void deleteMediaType(AM_MEDIA_TYPE* mt)
+    {
+        if (mt)
+        {
+            freeMediaType(*mt);
+            CoTaskMemFree(mt);
+        }
+    }
+
+    // FOURCC subtypes, spelled out because older SDK headers lack them.
+    constexpr GUID kSubtypeNv12 = {0x3231564E, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71}};
+    constexpr GUID kSubtypeP010 = {0x30313050, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71}};
+    constexpr GUID kSubtypeV210 = {0x30313276, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71}};
+
+    // Sample subtypes the pipeline converts itself, best first. Taking the
+    // card's native YUV keeps DirectShow's Color Space Converter out of the
+    // graph and cuts the bytes every frame moves; many 4K120 devices offer
+    // nothing else. 8-bit formats win over P010 and v210 at the same size.
+    // MJPEG costs a decode, so it only wins when it is faster (see
+    // preferCapability()). RGB24 moves a quarter less than RGB32; RGB565 loses
+    // colour depth, so it only beats the compressed format. Anything else is
+    // left to DirectShow to turn into RGB32.
+    constexpr int kForeignSubtype = 9;
+
+    int subtypePreference(const GUID& subtype)
+    {
+        if (subtype == kSubtypeNv12)
+        {
+            return 0;
+        }
+        if (subtype == MEDIASUBTYPE_YUY2)
+        {
+            return 1;
+        }
+        if (subtype == MEDIASUBTYPE_UYVY)
+        {
+            return 2;
+        }
+        if (subtype == kSubtypeP010)
+        {
+            return 3;
+        }
+        if (subtype == kSubtypeV210)
+        {
+            return 4;
+        }
+        if (subtype == MEDIASUBTYPE_RGB24)
+        {
+            return 5;
+        }
+        if (subtype == MEDIASUBTYPE_RGB32)
+        {
+            return 6;
+        }
+        if (subtype == MEDIASUBTYPE_RGB565)
+        {
+            return 7;
+        }
+        if (subtype == MEDIASUBTYPE_MJPG)
+        {
+            return 8;
+        }
+        return kForeignSubtype;
+    }
+
+    // Frame intervals within 1% count as the same rate, so 29.97 ties with 30.
+    bool fasterInterval(REFERENCE_TIME interval, REFERENCE_TIME other)
+    {
+        return interval > 0 && (other <= 0 || interval * 100 < other * 99);
+    }
+
+    // Capability ranking: subtypes the pipeline handles, then frame rate, then
+    // subtypePreference(). USB 2 capture dongles typically reach 1080p60 only
+    // in MJPEG and offer YUY2 at a fraction of that.
+    bool preferCapability(int preference, REFERENCE_TIME interval, int otherPreference, REFERENCE_TIME otherInterval)
+    {
+        const bool handled = preference < kForeignSubtype;
+        if (handled != (otherPreference < kForeignSubtype))
+        {
+            return handled;
+        }
+        if (fasterInterval(interval, otherInterval))
+        {
+            return true;
+        }
+        if (fasterInterval(otherInterval, interval))
+        {
+            return false;
+        }
+        return preference < otherPreference;
+    }
+
+    DirectShowCapture::PixelFormat pixelFormatForSubtype(const GUID& subtype)
+    {
+        if (subtype == kSubtypeNv12)
+        {
+            return DirectShowCapture::PixelFormat::NV12;
+        }
+        if (subtype == MEDIASUBTYPE_YUY2)
+        {
+            return DirectShowCapture::PixelFormat::YUY2;
+        }
+        if (subtype == MEDIASUBTYPE_UYVY)
+        {
+            return DirectShowCapture::PixelFormat::UYVY;
+        }
+        if (subtype == kSubtypeP010)
+        {
+            return DirectShowCapture::PixelFormat::P010;
+        }
+        if (subtype == kSubtypeV210)
+        {
+            return DirectShowCapture::PixelFormat::V210;
+        }
+        if (subtype == MEDIASUBTYPE_RGB24)
+        {
+            return DirectShowCapture::PixelFormat::RGB24;
+        }
+        if (subtype == MEDIASUBTYPE_RGB565)
+        {
+            return DirectShowCapture::PixelFormat::RGB565;
+        }
+        if (subtype == MEDIASUBTYPE_MJPG)
+        {
+            return DirectShowCapture::PixelFormat::MJPEG;
+        }
+        return DirectShowCapture::PixelFormat::BGRA8;
+    }
+
+    std::string subtypeName(const GUID& subtype)
+    {
+        if (subtype == MEDIASUBTYPE_RGB32)
+        {
+            return "RGB32";
+        }
+        if (subtype == MEDIASUBTYPE_RGB24)
+        {
+            return "RGB24";
+        }
+        if (subtype == MEDIASUBTYPE_RGB565)
+        {
+            return "RGB565";
+        }
+        // FOURCC subtypes carry the code in Data1.
+        std::string fourcc;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            const char c = static_cast<char>((subtype.Data1 >> shift) & 0xFF);
+            if (c < 0x20 || c > 0x7E)
+            {
+                return "other";
+            }
+            fourcc.push_back(c);
+        }
+        return fourcc;
+    }
+
+    bool hasVideoInfo(const AM_MEDIA_TYPE& mt)
+    {
+        return mt.formattype == FORMAT_VideoInfo && mt.cbFormat >= sizeof(VIDEOINFOHEADER) && mt.pbFormat;
+    }
 }
 
 struct ISampleGrabberCB : public IUnknown
@@ -218,6 +382,7 @@ struct DirectShowCaptureImpl
     std::uint32_t contentRight = 0;
     std::uint32_t contentBottom = 0;
     bool bottomUp = false;
+    DirectShowCapture::PixelFormat pixelFormat = DirectShowCapture::PixelFormat::BGRA8;
     std::atomic<bool> loggedSampleSize{false};
 
     std::wstring requestedMoniker;
@@ -524,11 +689,32 @@ struct DirectShowCaptureImpl
         throwIfFailed(sampleGrabberFilter->QueryInterface(kIID_ISampleGrabber, reinterpret_cast<void**>(sampleGrabber.GetAddressOf())),
                       "Failed to query ISampleGrabber");
 
-        AM_MEDIA_TYPE mediaType{};
-        mediaType.majortype = MEDIATYPE_Video;
-        mediaType.subtype = MEDIASUBTYPE_RGB32;
-        mediaType.formattype = FORMAT_VideoInfo;
-        throwIfFailed(sampleGrabber->SetMediaType(&mediaType), "Failed to set Sample Grabber media type");
+        ComPtr<IAMStreamConfig> streamConfig;
+        HRESULT hrConfig = captureBuilder->FindInterface(&PIN_CATEGORY_CAPTURE,
+                                                         &MEDIATYPE_Video,
+                                                         captureFilter.Get(),
+                                                         IID_PPV_ARGS(streamConfig.GetAddressOf()));
+        if (FAILED(hrConfig) || !streamConfig)
+        {
+            hrConfig = captureBuilder->FindInterface(&PIN_CATEGORY_PREVIEW,
+                                                     &MEDIATYPE_Video,
+                                                     captureFilter.Get(),
+                                                     IID_PPV_ARGS(streamConfig.GetAddressOf()));
+        }
+
+        GUID sampleSubtype = MEDIASUBTYPE_RGB32;
+        if (streamConfig)
+        {
+            applyPreferredFormat(streamConfig.Get());
+            AM_MEDIA_TYPE* currentType = nullptr;
+            if (SUCCEEDED(streamConfig->GetFormat(&currentType)) && currentType &&
+                subtypePreference(currentType->subtype) < kForeignSubtype)
+            {
+                sampleSubtype = currentType->subtype;
+            }
+            deleteMediaType(currentType);
+        }
+        setSampleGrabberSubtype(sampleSubtype);
 
         throwIfFailed(graph->AddFilter(sampleGrabberFilter.Get(), L"Sample Grabber"),
                       "Failed to add Sample Grabber to graph");
@@ -546,28 +732,12 @@ struct DirectShowCaptureImpl
         throwIfFailed(sampleGrabber->SetBufferSamples(TRUE), "Failed to configure Sample Grabber buffering");
         throwIfFailed(sampleGrabber->SetCallback(callback, 1), "Failed to set Sample Grabber callback");
 
-        ComPtr<IAMStreamConfig> streamConfig;
-        HRESULT hrConfig = captureBuilder->FindInterface(&PIN_CATEGORY_CAPTURE,
-                                                         &MEDIATYPE_Video,
-                                                         captureFilter.Get(),
-                                                         IID_PPV_ARGS(streamConfig.GetAddressOf()));
-        if (FAILED(hrConfig) || !streamConfig)
-        {
-            hrConfig = captureBuilder->FindInterface(&PIN_CATEGORY_PREVIEW,
-                                                     &MEDIATYPE_Video,
-                                                     captureFilter.Get(),
-                                                     IID_PPV_ARGS(streamConfig.GetAddressOf()));
-        }
-
-        if (streamConfig && requestedWidth != 0 && requestedHeight != 0)
+        HRESULT hr = renderVideoStream();
+        if (FAILED(hr) && sampleSubtype != MEDIASUBTYPE_RGB32)
         {
-            applyRequestedFormat(streamConfig.Get());
-        }
-
-        HRESULT hr = captureBuilder->RenderStream(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video, captureFilter.Get(), sampleGrabberFilter.Get(), nullRenderer.Get());
-        if (FAILED(hr))
-        {
-            hr = captureBuilder->RenderStream(&PIN_CATEGORY_PREVIEW, &MEDIATYPE_Video, captureFilter.Get(), sampleGrabberFilter.Get(), nullRenderer.Get());
+            logMessage("[Capture] Native " + subtypeName(sampleSubtype) + " samples could not be connected; falling back to RGB32");
+            setSampleGrabberSubtype(MEDIASUBTYPE_RGB32);
+            hr = renderVideoStream();
         }
         throwIfFailed(hr, "Failed to build capture graph");
 
@@ -596,66 +766,133 @@ struct DirectShowCaptureImpl
         throwIfFailed(graph->QueryInterface(IID_PPV_ARGS(&control)), "Failed to query IMediaControl");
     }
 
-    void applyRequestedFormat(IAMStreamConfig* streamConfig)
+    void setSampleGrabberSubtype(const GUID& subtype)
     {
-        if (!streamConfig || requestedWidth == 0 || requestedHeight == 0)
+        AM_MEDIA_TYPE mediaType{};
+        mediaType.majortype = MEDIATYPE_Video;
+        mediaType.subtype = subtype;
+        mediaType.formattype = FORMAT_VideoInfo;
+        throwIfFailed(sampleGrabber->SetMediaType(&mediaType), "Failed to set Sample Grabber media type");
+        logMessage("[Capture] Sample Grabber accepts " + subtypeName(subtype));
+    }
+
+    HRESULT renderVideoStream()
+    {
+        HRESULT hr = captureBuilder->RenderStream(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video, captureFilter.Get(), sampleGrabberFilter.Get(), nullRenderer.Get());
+        if (FAILED(hr))
+        {
+            hr = captureBuilder->RenderStream(&PIN_CATEGORY_PREVIEW, &MEDIATYPE_Video, captureFilter.Get(), sampleGrabberFilter.Get(), nullRenderer.Get());
+        }
+        return hr;
+    }
+
+    // Chooses the capability for the requested size (the current size when
+    // none was requested) that preferCapability() ranks first, at its highest
+    // frame rate.
+    void applyPreferredFormat(IAMStreamConfig* streamConfig)
+    {
+        const bool sizeRequested = requestedWidth != 0 && requestedHeight != 0;
+        std::uint32_t targetWidth = requestedWidth;
+        std::uint32_t targetHeight = requestedHeight;
+        int currentPreference = kForeignSubtype;
+        REFERENCE_TIME currentInterval = 0;
+        {
+            AM_MEDIA_TYPE* currentType = nullptr;
+            if (SUCCEEDED(streamConfig->GetFormat(&currentType)) && currentType)
+            {
+                currentPreference = subtypePreference(currentType->subtype);
+                if (hasVideoInfo(*currentType))
+                {
+                    const auto* vih = reinterpret_cast<const VIDEOINFOHEADER*>(currentType->pbFormat);
+                    currentInterval = vih->AvgTimePerFrame;
+                    if (!sizeRequested)
+                    {
+                        targetWidth = static_cast<std::uint32_t>(std::abs(vih->bmiHeader.biWidth));
+                        targetHeight = static_cast<std::uint32_t>(std::abs(vih->bmiHeader.biHeight));
+                    }
+                }
+            }
+            deleteMediaType(currentType);
+        }
+        if (targetWidth == 0 || targetHeight == 0)
         {
             return;
         }
+        const std::string sizeLabel = std::to_string(targetWidth) + "x" + std::to_string(targetHeight);
 
         int capabilityCount = 0;
         int capabilitySize = 0;
         if (FAILED(streamConfig->GetNumberOfCapabilities(&capabilityCount, &capabilitySize)) || capabilityCount <= 0 || capabilitySize <= 0)
         {
-            logMessage("[Capture] Requested format " + std::to_string(requestedWidth) + "x" + std::to_string(requestedHeight) + " not supported (no capabilities)");
+            if (sizeRequested)
+            {
+                logMessage("[Capture] Requested format " + sizeLabel + " not supported (no capabilities)");
+            }
             return;
         }
 
-        std::vector<std::uint8_t> capabilityBuffer(static_cast<std::size_t>(capabilitySize));
-        bool applied = false;
+        std::vector<std::uint8_t> capabilityBuffer(std::max(static_cast<std::size_t>(capabilitySize), sizeof(VIDEO_STREAM_CONFIG_CAPS)));
+        const auto* capabilities = reinterpret_cast<const VIDEO_STREAM_CONFIG_CAPS*>(capabilityBuffer.data());
+        AM_MEDIA_TYPE* best = nullptr;
+        int bestPreference = kForeignSubtype + 1;
+        REFERENCE_TIME bestInterval = 0;
 
         for (int i = 0; i < capabilityCount; ++i)
         {
             AM_MEDIA_TYPE* mediaType = nullptr;
+            std::fill(capabilityBuffer.begin(), capabilityBuffer.end(), std::uint8_t{0});
             if (FAILED(streamConfig->GetStreamCaps(i, &mediaType, capabilityBuffer.data())) || !mediaType)
             {
                 continue;
             }
 
-            const bool hasVideoInfo = mediaType->formattype == FORMAT_VideoInfo && mediaType->cbFormat >= sizeof(VIDEOINFOHEADER) && mediaType->pbFormat;
-            if (hasVideoInfo)
+            if (hasVideoInfo(*mediaType))
             {
                 const auto* vih = reinterpret_cast<const VIDEOINFOHEADER*>(mediaType->pbFormat);
                 const std::uint32_t width = static_cast<std::uint32_t>(std::abs(vih->bmiHeader.biWidth));
                 const std::uint32_t height = static_cast<std::uint32_t>(std::abs(vih->bmiHeader.biHeight));
-                if (width == requestedWidth && height == requestedHeight)
+                const int preference = subtypePreference(mediaType->subtype);
+                const REFERENCE_TIME interval = capabilities->MinFrameInterval > 0 ? capabilities->MinFrameInterval : vih->AvgTimePerFrame;
+                if (width == targetWidth && height == targetHeight &&
+                    preferCapability(preference, interval, bestPreference, bestInterval))
                 {
-                    if (SUCCEEDED(streamConfig->SetFormat(mediaType)))
-                    {
-                        logMessage("[Capture] Requested capture format " + std::to_string(requestedWidth) + "x" + std::to_string(requestedHeight) + " applied successfully");
-                        applied = true;
-                    }
-                    else
-                    {
-                        logMessage("[Capture] Failed to apply requested capture format " + std::to_string(requestedWidth) + "x" + std::to_string(requestedHeight));
-                    }
-                    freeMediaType(*mediaType);
-                    CoTaskMemFree(mediaType);
-                    break;
+                    std::swap(best, mediaType);
+                    bestPreference = preference;
+                    bestInterval = interval;
                 }
             }
+            deleteMediaType(mediaType);
+        }
 
-            if (mediaType)
+        if (!best)
+        {
+            if (sizeRequested)
             {
-                freeMediaType(*mediaType);
-                CoTaskMemFree(mediaType);
+                logMessage("[Capture] Requested capture format " + sizeLabel + " not found in device capabilities");
             }
+            return;
         }
 
-        if (!applied)
+        if (sizeRequested || preferCapability(bestPreference, bestInterval, currentPreference, currentInterval))
         {
-            logMessage("[Capture] Requested capture format " + std::to_string(requestedWidth) + "x" + std::to_string(requestedHeight) + " not found in device capabilities");
+            std::string formatLabel = sizeLabel + " " + subtypeName(best->subtype);
+            if (bestInterval > 0)
+            {
+                reinterpret_cast<VIDEOINFOHEADER*>(best->pbFormat)->AvgTimePerFrame = bestInterval;
+                std::ostringstream rate;
+                rate << std::fixed << std::setprecision(2) << 10'000'000.0 / static_cast<double>(bestInterval);
+                formatLabel += " @ " + rate.str() + " fps";
+            }
+            if (SUCCEEDED(streamConfig->SetFormat(best)))
+            {
+                logMessage("[Capture] Capture format " + formatLabel + " applied successfully");
+            }
+            else
+            {
+                logMessage("[Capture] Failed to apply capture format " + formatLabel);
+            }
         }
+        deleteMediaType(best);
     }
 
     void logCurrentFormat(const std::string& context)
@@ -701,7 +938,7 @@ struct DirectShowCaptureImpl
         else
         {
             const auto* vih = reinterpret_cast<const VIDEOINFOHEADER*>(currentType->pbFormat);
-            describeVideoInfo(*vih, context, false);
+            describeVideoInfo(*vih, currentType->subtype, context, false);
         }
 
         if (currentType)
@@ -744,12 +981,14 @@ struct DirectShowCaptureImpl
         }
 
         const auto* vih = reinterpret_cast<const VIDEOINFOHEADER*>(connected.pbFormat);
-        describeVideoInfo(*vih, "SampleGrabber format", true);
+        describeVideoInfo(*vih, connected.subtype, "SampleGrabber format", true);
         freeMediaType(connected);
     }
 
-    void describeVideoInfo(const VIDEOINFOHEADER& vih, const std::string& context, bool updateState)
+    void describeVideoInfo(const VIDEOINFOHEADER& vih, const GUID& subtype, const std::string& context, bool updateState)
     {
+        const DirectShowCapture::PixelFormat format = pixelFormatForSubtype(subtype);
+        const bool rgb = isRgb(format);
         const LONG biWidth = vih.bmiHeader.biWidth;
         const LONG biHeight = vih.bmiHeader.biHeight;
         const std::uint32_t width = static_cast<std::uint32_t>(std::abs(biWidth));
@@ -770,21 +1009,31 @@ struct DirectShowCaptureImpl
         };
 
         active.left = clampRect(active.left, 0, static_cast<LONG>(width));
+        // Chroma is shared within a pixel group; a row can only be cut between them.
+        active.left -= active.left % static_cast<LONG>(pixelFormatGroupPixels(format));
         active.top = clampRect(active.top, 0, static_cast<LONG>(height));
         active.right = clampRect(active.right, active.left + 1, static_cast<LONG>(width));
         active.bottom = clampRect(active.bottom, active.top + 1, static_cast<LONG>(height));
 
-        std::uint32_t bytesPerPixel = bits != 0 ? static_cast<std::uint32_t>((bits + 7u) / 8u) : 4u;
-        if (bytesPerPixel == 0)
+        // biBitCount averages over the planes of semi-planar formats, so YUV
+        // strides come from the luma groups instead. RGB rows are DIB rows,
+        // padded to whole DWORDs; v210 rows to 128 bytes (48 pixels).
+        std::uint32_t stride = (width * bits + 31u) / 32u * 4u;
+        if (format == DirectShowCapture::PixelFormat::V210)
+        {
+            stride = (width + 47u) / 48u * 128u;
+        }
+        else if (!rgb)
         {
-            bytesPerPixel = 4;
+            stride = static_cast<std::uint32_t>(pixelFormatRowBytes(format, width));
         }
-        const std::uint32_t stride = width * bytesPerPixel;
-        const bool isBottomUp = biHeight > 0;
+        // YUV samples are top-down whatever the sign of biHeight.
+        const bool isBottomUp = rgb && biHeight > 0;
 
         std::ostringstream oss;
         oss << "[Capture] " << context
             << ": frame=" << width << "x" << height
+            << " subtype=" << subtypeName(subtype)
             << " stride=" << stride
             << " bottomUp=" << (isBottomUp ? "true" : "false")
             << " rcSource={" << active.left << ", " << active.top << ", " << active.right << ", " << active.bottom << "}";
@@ -796,6 +1045,7 @@ struct DirectShowCaptureImpl
             frameHeight = height;
             frameStride = stride;
             bottomUp = isBottomUp;
+            pixelFormat = format;
             contentLeft = static_cast<std::uint32_t>(active.left);
             contentTop = static_cast<std::uint32_t>(active.top);
             contentRight = static_cast<std::uint32_t>(active.right);
@@ -803,7 +1053,7 @@ struct DirectShowCaptureImpl
         }
     }
 
-    HRESULT processBuffer(double sampleTime, const BYTE* buffer, long bufferLen)
+    HRESULT processBuffer(double sampleTime, const BYTE* buffer, long bufferLen, std::uint64_t arrivalNs)
     {
         if (!running.load(std::memory_order_acquire) || !handler)
         {
@@ -830,9 +1080,14 @@ struct DirectShowCaptureImpl
 
         frame.width = activeWidth != 0 ? activeWidth : frameWidth;
         frame.height = activeHeight != 0 ? activeHeight : frameHeight;
-        frame.stride = frameStride != 0 ? frameStride : frameWidth * 4;
+        frame.stride = frameStride != 0 ? frameStride : static_cast<std::uint32_t>(pixelFormatRowBytes(pixelFormat, frameWidth));
         frame.timestamp100ns = sampleTime >= 0.0 ? static_cast<std::uint64_t>(sampleTime * 10'000'000.0) : 0;
         frame.bottomUp = bottomUp;
+        frame.arrivalNs = arrivalNs;
+        frame.format = pixelFormat;
+        frame.matrix = defaultColorMatrix(pixelFormat, frameHeight);
+        frame.fullRange = false;
+        frame.transfer = defaultTransferFunction(pixelFormat);
 
         try
         {
@@ -882,6 +1137,7 @@ struct DirectShowCaptureImpl
         contentLeft = contentTop = 0;
         contentRight = contentBottom = 0;
         bottomUp = false;
+        pixelFormat = DirectShowCapture::PixelFormat::BGRA8;
         audioEnabled = false;
     }
 
@@ -940,12 +1196,13 @@ struct DirectShowCaptureImpl
 
 HRESULT SampleGrabberCallback::BufferCB(double sampleTime, BYTE* buffer, long bufferLen)
 {
+    const std::uint64_t arrivalNs = latencyClockNs();
     auto* owner = owner_.load(std::memory_order_acquire);
     if (!owner)
     {
         return S_OK;
     }
-    return owner->processBuffer(sampleTime, buffer, bufferLen);
+    return owner->processBuffer(sampleTime, buffer, bufferLen, arrivalNs);
 }
 
 DirectShowCapture::DirectShowCapture()
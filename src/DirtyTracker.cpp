@@ -0,0 +1,385 @@
+#include "DirtyTracker.hpp"
+#include "FrameSink.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PCKVM_DIRTY_SSE2 1
+#else
+#define PCKVM_DIRTY_SSE2 0
+#endif
+
+namespace
+{
+    constexpr std::uint64_t kKeySeed0 = 0xBE4BA423396CFEB8ull;
+    constexpr std::uint64_t kKeySeed1 = 0x1CAD21F72C81017Cull;
+    constexpr std::uint64_t kKeyStep = 0x9E3779B97F4A7C15ull;
+    constexpr std::uint64_t kPrime = 0xC2B2AE3D27D4EB4Full;
+    constexpr std::uint64_t kMissingRow = 0x165667B19E3779F9ull;
+
+#if !PCKVM_DIRTY_SSE2
+    std::uint64_t load64(const std::uint8_t* p)
+    {
+        std::uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+#endif
+
+    std::uint32_t load32(const std::uint8_t* p)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    std::uint64_t rotl64(std::uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    std::uint64_t mix64(std::uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Folds one tile row into two 64-bit lanes. Each 16-byte block is keyed by
+    // its position inside the tile, so content that merely moves within a tile
+    // still changes the hash. The SSE2 and scalar paths produce identical
+    // results.
+    void accumulateRow(const std::uint8_t* row, std::size_t bytes, std::uint64_t acc[2], std::uint64_t key[2])
+    {
+        const std::size_t blocks = bytes / 16;
+#if PCKVM_DIRTY_SSE2
+        __m128i accVec = _mm_set_epi64x(static_cast<long long>(acc[1]), static_cast<long long>(acc[0]));
+        __m128i keyVec = _mm_set_epi64x(static_cast<long long>(key[1]), static_cast<long long>(key[0]));
+        const __m128i stepVec = _mm_set1_epi64x(static_cast<long long>(kKeyStep));
+        for (std::size_t i = 0; i < blocks; ++i)
+        {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 16));
+            const __m128i keyed = _mm_xor_si128(data, keyVec);
+            const __m128i keyedHigh = _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(keyed, keyedHigh);
+            const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            accVec = _mm_add_epi64(accVec, _mm_add_epi64(swapped, product));
+            keyVec = _mm_add_epi64(keyVec, stepVec);
+        }
+        alignas(16) std::uint64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), accVec);
+        acc[0] = lanes[0];
+        acc[1] = lanes[1];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), keyVec);
+        key[0] = lanes[0];
+        key[1] = lanes[1];
+#else
+        for (std::size_t i = 0; i < blocks; ++i)
+        {
+            const std::uint64_t d0 = load64(row + i * 16);
+            const std::uint64_t d1 = load64(row + i * 16 + 8);
+            const std::uint64_t k0 = d0 ^ key[0];
+            const std::uint64_t k1 = d1 ^ key[1];
+            acc[0] += d1 + (k0 & 0xFFFFFFFFull) * (k0 >> 32);
+            acc[1] += d0 + (k1 & 0xFFFFFFFFull) * (k1 >> 32);
+            key[0] += kKeyStep;
+            key[1] += kKeyStep;
+        }
+#endif
+
+        // Row spans need not be whole 32-bit words: RGB24 spans end on any
+        // byte, RGB565 and odd-width 4:2:2 ones on half a word. The last one
+        // to three bytes go in as a zero-padded word.
+        std::size_t offset = blocks * 16;
+        for (; offset + 4 <= bytes; offset += 4)
+        {
+            acc[0] = rotl64(acc[0] + (load32(row + offset) ^ key[0]) * kPrime, 31);
+            key[0] += kKeyStep;
+        }
+        if (offset < bytes)
+        {
+            std::uint32_t tail = 0;
+            for (std::size_t i = offset; i < bytes; ++i)
+            {
+                tail |= static_cast<std::uint32_t>(row[i]) << (8 * (i - offset));
+            }
+            acc[0] = rotl64(acc[0] + (tail ^ key[0]) * kPrime, 31);
+            key[0] += kKeyStep;
+        }
+    }
+}
+
+DirtyTracker::DirtyTracker()
+{
+    hashes_.resize(static_cast<std::size_t>(kMaxTilesX) * kMaxTilesY);
+    scratchRects_.reserve(kMaxRects);
+}
+
+bool DirtyTracker::configure(std::uint32_t width, std::uint32_t height)
+{
+    if (width == width_ && height == height_ && tilesX_ != 0)
+    {
+        return true;
+    }
+
+    const std::uint32_t tilesX = (width + kTileSize - 1) / kTileSize;
+    const std::uint32_t tilesY = (height + kTileSize - 1) / kTileSize;
+    width_ = width;
+    height_ = height;
+    hashesValid_ = false;
+    if (width == 0 || height == 0 || tilesX > kMaxTilesX || tilesY > kMaxTilesY)
+    {
+        tilesX_ = 0;
+        tilesY_ = 0;
+        return false;
+    }
+
+    tilesX_ = tilesX;
+    tilesY_ = tilesY;
+    // Older masks describe a different grid; nobody may union across this.
+    baseSequence_.store(nextSequence_, std::memory_order_release);
+    return true;
+}
+
+std::uint64_t DirtyTracker::analyze(const DirectShowCapture::Frame& frame)
+{
+    lastDirtyTiles_ = 0;
+    if (isCompressed(frame.format) || !configure(frame.width, frame.height))
+    {
+        return 0;
+    }
+
+    const std::uint64_t sequence = nextSequence_++;
+    HistoryEntry& entry = history_[sequence % kHistory];
+    entry.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.tilesX.store(tilesX_, std::memory_order_relaxed);
+    entry.tilesY.store(tilesY_, std::memory_order_relaxed);
+
+    // Hash the samples as captured. Semi-planar formats also hash the chroma
+    // row shared by each row pair, whose tile slice has the same byte width as
+    // the luma one. Tiles that split a pixel group (a v210 block) both hash
+    // all of it.
+    const bool semiPlanar = isSemiPlanar(frame.format);
+    const std::size_t rowBytes = pixelFormatRowBytes(frame.format, width_);
+
+    std::uint64_t dirty = 0;
+    std::uint64_t word = 0;
+    std::size_t tileIndex = 0;
+    for (std::uint32_t ty = 0; ty < tilesY_; ++ty)
+    {
+        for (std::uint32_t tx = 0; tx < tilesX_; ++tx)
+        {
+            rowState_[tx] = TileState{{0, 0}, {kKeySeed0, kKeySeed1}};
+        }
+
+        const std::uint32_t rowEnd = std::min(height_, (ty + 1) * kTileSize);
+        for (std::uint32_t y = ty * kTileSize; y < rowEnd; ++y)
+        {
+            const std::size_t offset = frameSourceRowOffset(frame, y);
+            const bool present = frame.data && offset != kMissingSourceRow && offset <= frame.dataSize &&
+                                 frame.dataSize - offset >= rowBytes;
+            std::size_t chromaOffset = kMissingSourceRow;
+            if (semiPlanar && (y % kTileSize == 0 || (frame.contentTop + y) % 2 == 0))
+            {
+                chromaOffset = frameChromaRowOffset(frame, y);
+                if (chromaOffset != kMissingSourceRow && (chromaOffset > frame.dataSize || frame.dataSize - chromaOffset < rowBytes))
+                {
+                    chromaOffset = kMissingSourceRow;
+                }
+            }
+            for (std::uint32_t tx = 0; tx < tilesX_; ++tx)
+            {
+                TileState& state = rowState_[tx];
+                const std::size_t begin = pixelFormatRowOffset(frame.format, static_cast<std::size_t>(tx) * kTileSize);
+                const std::size_t end = std::min(rowBytes, pixelFormatRowBytes(frame.format, static_cast<std::size_t>(tx + 1) * kTileSize));
+                if (present)
+                {
+                    accumulateRow(frame.data + offset + begin, end - begin, state.acc, state.key);
+                    if (chromaOffset != kMissingSourceRow)
+                    {
+                        accumulateRow(frame.data + chromaOffset + begin, end - begin, state.acc, state.key);
+                    }
+                }
+                else
+                {
+                    state.acc[0] = rotl64(state.acc[0] ^ kMissingRow, 27) * kPrime;
+                }
+            }
+        }
+
+        for (std::uint32_t tx = 0; tx < tilesX_; ++tx, ++tileIndex)
+        {
+            const TileState& state = rowState_[tx];
+            const std::uint64_t hash = mix64(state.acc[0] ^ rotl64(state.acc[1], 29));
+            if (!hashesValid_ || hashes_[tileIndex] != hash)
+            {
+                hashes_[tileIndex] = hash;
+                word |= 1ull << (tileIndex % 64);
+                ++dirty;
+            }
+            if (tileIndex % 64 == 63)
+            {
+                entry.bits[tileIndex / 64].store(word, std::memory_order_relaxed);
+                word = 0;
+            }
+        }
+    }
+    if (tileIndex % 64 != 0)
+    {
+        entry.bits[tileIndex / 64].store(word, std::memory_order_relaxed);
+    }
+
+    entry.sequence.store(sequence, std::memory_order_release);
+    hashesValid_ = true;
+    lastDirtyTiles_ = static_cast<std::uint32_t>(dirty);
+
+    framesAnalyzed_.fetch_add(1, std::memory_order_relaxed);
+    tilesDirty_.fetch_add(dirty, std::memory_order_relaxed);
+    tilesTotal_.fetch_add(tileIndex, std::memory_order_relaxed);
+    return sequence;
+}
+
+bool DirtyTracker::collectSince(std::uint64_t since, std::uint64_t until, TileMask& mask) const
+{
+    if (since == 0 || until == 0 || since > until)
+    {
+        return false;
+    }
+    if (since < baseSequence_.load(std::memory_order_acquire) || until - since > kHistory)
+    {
+        return false;
+    }
+
+    mask.tilesX = 0;
+    mask.tilesY = 0;
+    if (since == until)
+    {
+        return true;
+    }
+
+    for (std::uint64_t sequence = since + 1; sequence <= until; ++sequence)
+    {
+        const HistoryEntry& entry = history_[sequence % kHistory];
+        if (entry.sequence.load(std::memory_order_acquire) != sequence)
+        {
+            return false;
+        }
+
+        const std::uint32_t tilesX = entry.tilesX.load(std::memory_order_relaxed);
+        const std::uint32_t tilesY = entry.tilesY.load(std::memory_order_relaxed);
+        if (sequence == since + 1)
+        {
+            mask.tilesX = tilesX;
+            mask.tilesY = tilesY;
+            std::fill(mask.bits.begin(), mask.bits.begin() + static_cast<std::ptrdiff_t>(mask.wordCount()), 0);
+        }
+        else if (tilesX != mask.tilesX || tilesY != mask.tilesY)
+        {
+            return false;
+        }
+
+        const std::size_t words = mask.wordCount();
+        for (std::size_t i = 0; i < words; ++i)
+        {
+            mask.bits[i] |= entry.bits[i].load(std::memory_order_relaxed);
+        }
+
+        // Seqlock check: the capture thread may have reused the entry meanwhile.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != sequence)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<DirtyRect>* DirtyTracker::rectsSince(std::uint64_t since, std::uint64_t until)
+{
+    if (!collectSince(since, until, scratchMask_))
+    {
+        return nullptr;
+    }
+    buildRects(scratchMask_, width_, height_, scratchRects_);
+    return &scratchRects_;
+}
+
+void DirtyTracker::buildRects(const TileMask& mask,
+                              std::uint32_t width,
+                              std::uint32_t height,
+                              std::vector<DirtyRect>& rects)
+{
+    rects.clear();
+
+    // Tile-space rectangles: horizontal runs per tile row, extended downwards
+    // while the row below has a run with exactly the same span. There are at
+    // most kMaxRects candidates, so a linear search is cheap enough.
+    bool overflow = false;
+    for (std::uint32_t ty = 0; ty < mask.tilesY && !overflow; ++ty)
+    {
+        std::uint32_t tx = 0;
+        while (tx < mask.tilesX)
+        {
+            if (!mask.test(tx, ty))
+            {
+                ++tx;
+                continue;
+            }
+            const std::uint32_t runBegin = tx;
+            while (tx < mask.tilesX && mask.test(tx, ty))
+            {
+                ++tx;
+            }
+
+            auto open = std::find_if(rects.begin(), rects.end(), [&](const DirtyRect& rect) {
+                return rect.left == runBegin && rect.right == tx && rect.bottom == ty;
+            });
+            if (open != rects.end())
+            {
+                open->bottom = ty + 1;
+                continue;
+            }
+            if (rects.size() == kMaxRects)
+            {
+                overflow = true;
+                break;
+            }
+            rects.push_back(DirtyRect{runBegin, ty, tx, ty + 1});
+        }
+    }
+
+    if (overflow)
+    {
+        // Too fragmented to be worth separate copies: one bounding box.
+        DirtyRect bounds{mask.tilesX, mask.tilesY, 0, 0};
+        for (std::uint32_t ty = 0; ty < mask.tilesY; ++ty)
+        {
+            for (std::uint32_t tx = 0; tx < mask.tilesX; ++tx)
+            {
+                if (mask.test(tx, ty))
+                {
+                    bounds.left = std::min(bounds.left, tx);
+                    bounds.top = std::min(bounds.top, ty);
+                    bounds.right = std::max(bounds.right, tx + 1);
+                    bounds.bottom = std::max(bounds.bottom, ty + 1);
+                }
+            }
+        }
+        rects.clear();
+        rects.push_back(bounds);
+    }
+
+    for (auto& rect : rects)
+    {
+        rect.left = std::min(rect.left * kTileSize, width);
+        rect.top = std::min(rect.top * kTileSize, height);
+        rect.right = std::min(rect.right * kTileSize, width);
+        rect.bottom = std::min(rect.bottom * kTileSize, height);
+    }
+}
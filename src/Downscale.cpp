@@ -0,0 +1,710 @@
+#include "Downscale.hpp"
+#include "KernelRegistry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_DOWNSCALE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PCKVM_DOWNSCALE_TARGET(features)
+#else
+#define PCKVM_DOWNSCALE_TARGET(features) __attribute__((target(features)))
+#endif
+#else
+#define PCKVM_DOWNSCALE_X86 0
+#endif
+
+namespace
+{
+    constexpr int kWeightBits = 14;
+    constexpr std::int32_t kWeightOne = 1 << kWeightBits;
+    // Horizontal results keep 7 fractional bits, so they still fit int16 and
+    // the vertical pass can use 16-bit multiplies.
+    constexpr int kHorizontalShift = kWeightBits - 7;
+    constexpr int kVerticalShift = kWeightBits + 7;
+    constexpr std::uint32_t kNoRow = std::numeric_limits<std::uint32_t>::max();
+
+    void box2Scalar(std::uint8_t* dst, const std::uint8_t* row0, const std::uint8_t* row1, std::size_t dstPixels)
+    {
+        for (std::size_t i = 0; i < dstPixels * 4; ++i)
+        {
+            const std::size_t a = (i / 4) * 8 + i % 4;
+            dst[i] = static_cast<std::uint8_t>((row0[a] + row0[a + 4] + row1[a] + row1[a + 4] + 2) >> 2);
+        }
+    }
+
+    void box4Scalar(std::uint8_t* dst, const std::uint8_t* const* rows, std::size_t dstPixels)
+    {
+        for (std::size_t i = 0; i < dstPixels * 4; ++i)
+        {
+            const std::size_t a = (i / 4) * 16 + i % 4;
+            unsigned int sum = 8;
+            for (int r = 0; r < 4; ++r)
+            {
+                sum += rows[r][a] + rows[r][a + 4] + rows[r][a + 8] + rows[r][a + 12];
+            }
+            dst[i] = static_cast<std::uint8_t>(sum >> 4);
+        }
+    }
+
+    // Pixels [begin, dstPixels); the SIMD tiers finish their rows with it.
+    void horizontalScalarFrom(std::uint16_t* dst,
+                              const std::uint8_t* src,
+                              const std::uint32_t* firstColumn,
+                              const std::int16_t* weights,
+                              std::size_t taps,
+                              std::size_t begin,
+                              std::size_t dstPixels)
+    {
+        for (std::size_t i = begin; i < dstPixels; ++i)
+        {
+            const std::uint8_t* pixel = src + static_cast<std::size_t>(firstColumn[i]) * 4;
+            const std::int16_t* w = weights + i * taps;
+            for (int c = 0; c < 4; ++c)
+            {
+                std::int32_t sum = 1 << (kHorizontalShift - 1);
+                for (std::size_t t = 0; t < taps; ++t)
+                {
+                    sum += w[t] * pixel[t * 4 + c];
+                }
+                dst[i * 4 + c] = static_cast<std::uint16_t>(sum >> kHorizontalShift);
+            }
+        }
+    }
+
+    void horizontalScalar(std::uint16_t* dst,
+                          const std::uint8_t* src,
+                          std::size_t srcPixels,
+                          const std::uint32_t* firstColumn,
+                          const std::int16_t* weights,
+                          std::size_t taps,
+                          std::size_t dstPixels)
+    {
+        (void)srcPixels;
+        horizontalScalarFrom(dst, src, firstColumn, weights, taps, 0, dstPixels);
+    }
+
+    // Values [begin, values); the SIMD tiers finish their rows with it.
+    void verticalScalarFrom(std::uint8_t* dst,
+                            const std::uint16_t* const* rows,
+                            const std::int16_t* weights,
+                            std::size_t count,
+                            std::size_t begin,
+                            std::size_t values)
+    {
+        for (std::size_t i = begin; i < values; ++i)
+        {
+            std::int32_t sum = 1 << (kVerticalShift - 1);
+            for (std::size_t r = 0; r < count; ++r)
+            {
+                sum += weights[r] * rows[r][i];
+            }
+            dst[i] = static_cast<std::uint8_t>(sum >> kVerticalShift);
+        }
+    }
+
+    void verticalScalar(std::uint8_t* dst,
+                        const std::uint16_t* const* rows,
+                        const std::int16_t* weights,
+                        std::size_t count,
+                        std::size_t values)
+    {
+        verticalScalarFrom(dst, rows, weights, count, 0, values);
+    }
+
+#if PCKVM_DOWNSCALE_X86
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    void box2Sse2(std::uint8_t* dst, const std::uint8_t* row0, const std::uint8_t* row1, std::size_t dstPixels)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        std::size_t i = 0;
+        for (; i + 2 <= dstPixels; i += 2)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 8));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 8));
+            // Pixels 0 1 and 2 3 of both rows, summed per channel.
+            const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(average, average));
+        }
+        box2Scalar(dst + i * 4, row0 + i * 8, row1 + i * 8, dstPixels - i);
+    }
+
+    // Sum of one 4x4 block per 64-bit half: four channels of 16-bit.
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    __m128i box4BlockSse2(const std::uint8_t* const* rows, std::size_t offset)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = zero;
+        for (int r = 0; r < 4; ++r)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + offset));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+        }
+        return _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    }
+
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    void box4Sse2(std::uint8_t* dst, const std::uint8_t* const* rows, std::size_t dstPixels)
+    {
+        const __m128i eight = _mm_set1_epi16(8);
+        std::size_t i = 0;
+        for (; i + 2 <= dstPixels; i += 2)
+        {
+            const __m128i sum = _mm_unpacklo_epi64(box4BlockSse2(rows, i * 16), box4BlockSse2(rows, i * 16 + 16));
+            const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, eight), 4);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(average, average));
+        }
+        const std::uint8_t* const tail[4] = {rows[0] + i * 16, rows[1] + i * 16, rows[2] + i * 16, rows[3] + i * 16};
+        box4Scalar(dst + i * 4, tail, dstPixels - i);
+    }
+
+    // Neighbouring source pixels are interleaved channel by channel so one
+    // madd applies two taps.
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    void horizontalSse2From(std::uint16_t* dst,
+                            const std::uint8_t* src,
+                            const std::uint32_t* firstColumn,
+                            const std::int16_t* weights,
+                            std::size_t taps,
+                            std::size_t begin,
+                            std::size_t dstPixels)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi32(1 << (kHorizontalShift - 1));
+        std::size_t i = begin;
+        for (; i + 1 < dstPixels; ++i)
+        {
+            const std::uint8_t* pixel = src + static_cast<std::size_t>(firstColumn[i]) * 4;
+            const std::int16_t* w = weights + i * taps;
+            __m128i sum = rounding;
+            std::size_t t = 0;
+            for (; t + 2 <= taps; t += 2)
+            {
+                const __m128i two = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + t * 4)), zero);
+                std::int32_t pair;
+                std::memcpy(&pair, w + t, sizeof(pair));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(two, _mm_srli_si128(two, 8)), _mm_set1_epi32(pair)));
+            }
+            if (t < taps)
+            {
+                std::int32_t last;
+                std::memcpy(&last, pixel + t * 4, sizeof(last));
+                const __m128i one = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero), zero);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(one, _mm_set1_epi32(static_cast<std::uint16_t>(w[t]))));
+            }
+            const __m128i words = _mm_packs_epi32(_mm_srai_epi32(sum, kHorizontalShift), zero);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4), words);
+        }
+        horizontalScalarFrom(dst, src, firstColumn, weights, taps, i, dstPixels);
+    }
+
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    void horizontalSse2(std::uint16_t* dst,
+                        const std::uint8_t* src,
+                        std::size_t srcPixels,
+                        const std::uint32_t* firstColumn,
+                        const std::int16_t* weights,
+                        std::size_t taps,
+                        std::size_t dstPixels)
+    {
+        (void)srcPixels;
+        horizontalSse2From(dst, src, firstColumn, weights, taps, 0, dstPixels);
+    }
+
+    // Two rows' weights in one dword, as madd pairs them; a missing second
+    // row gets weight 0.
+    std::int32_t weightPair(const std::int16_t* weights, std::size_t r, std::size_t count)
+    {
+        const std::int32_t low = static_cast<std::uint16_t>(weights[r]);
+        const std::int32_t high = r + 1 < count ? static_cast<std::int32_t>(static_cast<std::uint16_t>(weights[r + 1])) << 16 : 0;
+        return low | high;
+    }
+
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    void verticalSse2From(std::uint8_t* dst,
+                          const std::uint16_t* const* rows,
+                          const std::int16_t* weights,
+                          std::size_t count,
+                          std::size_t begin,
+                          std::size_t values)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi32(1 << (kVerticalShift - 1));
+        std::size_t i = begin;
+        for (; i + 8 <= values; i += 8)
+        {
+            __m128i low = rounding;
+            __m128i high = rounding;
+            for (std::size_t r = 0; r < count; r += 2)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i));
+                const __m128i b = r + 1 < count ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r + 1] + i)) : zero;
+                const __m128i weight = _mm_set1_epi32(weightPair(weights, r, count));
+                low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weight));
+                high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weight));
+            }
+            const __m128i words = _mm_packs_epi32(_mm_srai_epi32(low, kVerticalShift), _mm_srai_epi32(high, kVerticalShift));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+        }
+        verticalScalarFrom(dst, rows, weights, count, i, values);
+    }
+
+    PCKVM_DOWNSCALE_TARGET("sse2")
+    void verticalSse2(std::uint8_t* dst,
+                      const std::uint16_t* const* rows,
+                      const std::int16_t* weights,
+                      std::size_t count,
+                      std::size_t values)
+    {
+        verticalSse2From(dst, rows, weights, count, 0, values);
+    }
+
+    PCKVM_DOWNSCALE_TARGET("avx2")
+    void box2Avx2(std::uint8_t* dst, const std::uint8_t* row0, const std::uint8_t* row1, std::size_t dstPixels)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i two = _mm256_set1_epi16(2);
+        std::size_t i = 0;
+        for (; i + 4 <= dstPixels; i += 4)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + i * 8));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + i * 8));
+            // Per 128-bit lane, exactly the SSE2 steps.
+            const __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+            const __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+            const __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(low, high), _mm256_unpackhi_epi64(low, high));
+            const __m256i average = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(average, average), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm256_castsi256_si128(packed));
+        }
+        box2Sse2(dst + i * 4, row0 + i * 8, row1 + i * 8, dstPixels - i);
+    }
+
+    PCKVM_DOWNSCALE_TARGET("avx2")
+    void box4Avx2(std::uint8_t* dst, const std::uint8_t* const* rows, std::size_t dstPixels)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i eight = _mm256_set1_epi16(8);
+        std::size_t i = 0;
+        for (; i + 4 <= dstPixels; i += 4)
+        {
+            // Lane 0 holds blocks i and i + 2, lane 1 blocks i + 1 and i + 3.
+            __m256i sum = zero;
+            for (int r = 0; r < 4; ++r)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i * 16));
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i * 16 + 32));
+                const __m256i pairsA = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpackhi_epi8(a, zero));
+                const __m256i pairsB = _mm256_add_epi16(_mm256_unpacklo_epi8(b, zero), _mm256_unpackhi_epi8(b, zero));
+                sum = _mm256_add_epi16(sum, _mm256_add_epi16(_mm256_unpacklo_epi64(pairsA, pairsB), _mm256_unpackhi_epi64(pairsA, pairsB)));
+            }
+            const __m256i average = _mm256_srli_epi16(_mm256_add_epi16(sum, eight), 4);
+            // Lane 0 now starts with blocks i, i + 2 and lane 1 with i + 1, i + 3.
+            const __m256i packed = _mm256_packus_epi16(average, average);
+            const __m128i lane0 = _mm256_castsi256_si128(packed);
+            const __m128i lane1 = _mm256_extracti128_si256(packed, 1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_unpacklo_epi32(lane0, lane1));
+        }
+        const std::uint8_t* const tail[4] = {rows[0] + i * 16, rows[1] + i * 16, rows[2] + i * 16, rows[3] + i * 16};
+        box4Sse2(dst + i * 4, tail, dstPixels - i);
+    }
+
+    // Four taps per madd: a shuffle pairs pixels (0, 1) and (2, 3) channel by
+    // channel and each lane sums one pair. Whole groups of four pixels and
+    // weights are read; weights past `taps` are masked off.
+    PCKVM_DOWNSCALE_TARGET("avx2")
+    void horizontalAvx2(std::uint16_t* dst,
+                        const std::uint8_t* src,
+                        std::size_t srcPixels,
+                        const std::uint32_t* firstColumn,
+                        const std::int16_t* weights,
+                        std::size_t taps,
+                        std::size_t dstPixels)
+    {
+        const __m128i interleave = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+        const __m256i spread = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+        const __m128i rounding = _mm_set1_epi32(1 << (kHorizontalShift - 1));
+        const std::size_t groups = taps / 4;
+        const __m128i tailMask = _mm_cmpgt_epi16(_mm_set1_epi16(static_cast<std::int16_t>(taps % 4)), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+        // Windows only move right, so once a group of four would overrun the
+        // row every later pixel is left to SSE2.
+        const std::size_t span = (taps + 3) & ~std::size_t{3};
+        std::size_t i = 0;
+        for (; i + 1 < dstPixels && firstColumn[i] + span <= srcPixels; ++i)
+        {
+            const std::uint8_t* pixel = src + static_cast<std::size_t>(firstColumn[i]) * 4;
+            const std::int16_t* w = weights + i * taps;
+            __m256i sum = _mm256_setzero_si256();
+            std::size_t g = 0;
+            for (; g < groups; ++g)
+            {
+                const __m256i four = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel + g * 16)), interleave));
+                const __m128i quad = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + g * 4));
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(four, _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(quad), spread)));
+            }
+            if (g * 4 < taps)
+            {
+                const __m256i four = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel + g * 16)), interleave));
+                const __m128i quad = _mm_and_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + g * 4)), tailMask);
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(four, _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(quad), spread)));
+            }
+            const __m128i total = _mm_add_epi32(_mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)), rounding);
+            const __m128i words = _mm_packs_epi32(_mm_srai_epi32(total, kHorizontalShift), _mm_setzero_si128());
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4), words);
+        }
+        horizontalSse2From(dst, src, firstColumn, weights, taps, i, dstPixels);
+    }
+
+    PCKVM_DOWNSCALE_TARGET("avx2")
+    void verticalAvx2(std::uint8_t* dst,
+                      const std::uint16_t* const* rows,
+                      const std::int16_t* weights,
+                      std::size_t count,
+                      std::size_t values)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i rounding = _mm256_set1_epi32(1 << (kVerticalShift - 1));
+        std::size_t i = 0;
+        for (; i + 16 <= values; i += 16)
+        {
+            __m256i low = rounding;
+            __m256i high = rounding;
+            for (std::size_t r = 0; r < count; r += 2)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i));
+                const __m256i b = r + 1 < count ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r + 1] + i)) : zero;
+                const __m256i weight = _mm256_set1_epi32(weightPair(weights, r, count));
+                low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weight));
+                high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weight));
+            }
+            // The unpacks and packs both work per lane, so the order survives.
+            const __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(low, kVerticalShift), _mm256_srai_epi32(high, kVerticalShift));
+            const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(bytes));
+        }
+        verticalSse2From(dst, rows, weights, count, i, values);
+    }
+
+    const DownscaleKernels kSse2Kernels{box2Sse2, box4Sse2, horizontalSse2, verticalSse2};
+    const DownscaleKernels kAvx2Kernels{box2Avx2, box4Avx2, horizontalAvx2, verticalAvx2};
+#endif
+
+    const DownscaleKernels kScalarKernels{box2Scalar, box4Scalar, horizontalScalar, verticalScalar};
+
+    std::atomic<DownscaleTier>& activeTier()
+    {
+        static std::atomic<DownscaleTier> tier = []() {
+            for (DownscaleTier candidate : {DownscaleTier::AVX2, DownscaleTier::SSE2})
+            {
+                if (downscaleKernels(candidate))
+                {
+                    return candidate;
+                }
+            }
+            return DownscaleTier::Scalar;
+        }();
+        return tier;
+    }
+
+    std::uint32_t scaleDown(std::uint32_t value, std::uint32_t from, std::uint32_t to)
+    {
+        return static_cast<std::uint32_t>(static_cast<std::uint64_t>(value) * to / from);
+    }
+
+    std::uint32_t scaleUp(std::uint32_t value, std::uint32_t from, std::uint32_t to)
+    {
+        return static_cast<std::uint32_t>((static_cast<std::uint64_t>(value) * to + from - 1) / from);
+    }
+}
+
+const DownscaleKernels* downscaleKernels(DownscaleTier tier)
+{
+    switch (tier)
+    {
+    case DownscaleTier::Scalar:
+        return &kScalarKernels;
+#if PCKVM_DOWNSCALE_X86
+    case DownscaleTier::SSE2:
+        return &kSse2Kernels;
+    case DownscaleTier::AVX2:
+        return cpuFeatures().avx2 ? &kAvx2Kernels : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+DownscaleTier activeDownscaleTier()
+{
+    return activeTier().load(std::memory_order_relaxed);
+}
+
+const char* downscaleTierName(DownscaleTier tier)
+{
+    switch (tier)
+    {
+    case DownscaleTier::Scalar:
+        return "scalar";
+    case DownscaleTier::SSE2:
+        return "SSE2";
+    case DownscaleTier::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+bool setActiveDownscaleTier(DownscaleTier tier)
+{
+    if (!downscaleKernels(tier))
+    {
+        return false;
+    }
+    activeTier().store(tier, std::memory_order_relaxed);
+    return true;
+}
+
+bool chooseDownscaleSize(std::uint32_t sourceWidth,
+                         std::uint32_t sourceHeight,
+                         std::uint32_t viewportWidth,
+                         std::uint32_t viewportHeight,
+                         std::uint32_t& outputWidth,
+                         std::uint32_t& outputHeight)
+{
+    if (sourceWidth == 0 || sourceHeight == 0 || viewportWidth == 0 || viewportHeight == 0)
+    {
+        return false;
+    }
+
+    // The axis shrunk least decides, so neither drops below the viewport.
+    double ratio = std::min(static_cast<double>(sourceWidth) / viewportWidth, static_cast<double>(sourceHeight) / viewportHeight);
+    if (ratio < kMinDownscaleRatio)
+    {
+        return false;
+    }
+    ratio = std::min(ratio, kMaxDownscaleRatio);
+
+    for (std::uint32_t factor : {4u, 2u})
+    {
+        if (ratio >= factor && ratio < factor * 1.125 && sourceWidth % factor == 0 && sourceHeight % factor == 0)
+        {
+            outputWidth = sourceWidth / factor;
+            outputHeight = sourceHeight / factor;
+            return true;
+        }
+    }
+
+    ratio = std::floor(ratio * 8.0) / 8.0;
+    outputWidth = static_cast<std::uint32_t>(std::ceil(sourceWidth / ratio));
+    outputHeight = static_cast<std::uint32_t>(std::ceil(sourceHeight / ratio));
+    return true;
+}
+
+DirtyRect scaleDirtyRect(const DirtyRect& rect,
+                         std::uint32_t sourceWidth,
+                         std::uint32_t sourceHeight,
+                         std::uint32_t outputWidth,
+                         std::uint32_t outputHeight)
+{
+    if (sourceWidth == 0 || sourceHeight == 0)
+    {
+        return {};
+    }
+    return DirtyRect{
+        scaleDown(rect.left, sourceWidth, outputWidth),
+        scaleDown(rect.top, sourceHeight, outputHeight),
+        std::min(scaleUp(rect.right, sourceWidth, outputWidth), outputWidth),
+        std::min(scaleUp(rect.bottom, sourceHeight, outputHeight), outputHeight),
+    };
+}
+
+AreaScaler::AreaScaler(std::uint32_t sourceWidth, std::uint32_t sourceHeight, std::uint32_t outputWidth, std::uint32_t outputHeight)
+    : sourceWidth_(std::max(sourceWidth, 1u))
+    , sourceHeight_(std::max(sourceHeight, 1u))
+    , outputWidth_(std::clamp(outputWidth, 1u, sourceWidth_))
+    , outputHeight_(std::clamp(outputHeight, 1u, sourceHeight_))
+{
+    for (std::uint32_t factor : {2u, 4u})
+    {
+        if (sourceWidth_ == outputWidth_ * factor && sourceHeight_ == outputHeight_ * factor)
+        {
+            boxFactor_ = factor;
+        }
+    }
+    columns_ = buildAxis(sourceWidth_, outputWidth_);
+    rows_ = buildAxis(sourceHeight_, outputHeight_);
+}
+
+// Output pixel i covers source interval [i * source, (i + 1) * source) / output;
+// each source pixel it touches is weighted by the overlap. Windows are
+// shifted inside the source so every tap can be read, and padded with zero
+// weights to a common length.
+AreaScaler::Axis AreaScaler::buildAxis(std::uint32_t source, std::uint32_t output)
+{
+    Axis axis;
+    std::uint32_t longest = 1;
+    for (std::uint32_t i = 0; i < output; ++i)
+    {
+        const std::uint64_t begin = static_cast<std::uint64_t>(i) * source;
+        const std::uint64_t end = begin + source;
+        const auto count = static_cast<std::uint32_t>((end + output - 1) / output - begin / output);
+        longest = std::max(longest, count);
+    }
+    axis.taps = std::min(longest, source);
+    axis.first.resize(output);
+    // Three spare zeros let kernels read the last pixel's taps in groups of four.
+    axis.weights.assign(static_cast<std::size_t>(output) * axis.taps + 3, 0);
+
+    for (std::uint32_t i = 0; i < output; ++i)
+    {
+        const std::uint64_t begin = static_cast<std::uint64_t>(i) * source;
+        const std::uint64_t end = begin + source;
+        const auto firstPixel = static_cast<std::uint32_t>(begin / output);
+        const auto lastPixel = static_cast<std::uint32_t>((end + output - 1) / output);
+        const std::uint32_t first = std::min(firstPixel, source - axis.taps);
+        axis.first[i] = first;
+
+        std::int16_t* weights = axis.weights.data() + static_cast<std::size_t>(i) * axis.taps;
+        std::int32_t total = 0;
+        std::size_t largest = firstPixel - first;
+        for (std::uint32_t pixel = firstPixel; pixel < lastPixel; ++pixel)
+        {
+            const std::uint64_t overlap = std::min<std::uint64_t>(end, static_cast<std::uint64_t>(pixel + 1) * output) -
+                                          std::max<std::uint64_t>(begin, static_cast<std::uint64_t>(pixel) * output);
+            const auto weight = static_cast<std::int16_t>((overlap * kWeightOne * 2 + source) / (2 * static_cast<std::uint64_t>(source)));
+            const std::size_t tap = pixel - first;
+            weights[tap] = weight;
+            total += weight;
+            if (weight > weights[largest])
+            {
+                largest = tap;
+            }
+        }
+        // Rounding may leave the sum a little off; flat areas must stay flat.
+        weights[largest] = static_cast<std::int16_t>(weights[largest] + kWeightOne - total);
+    }
+    return axis;
+}
+
+void AreaScaler::scaleRegion(std::uint8_t* dst,
+                             std::size_t dstPitch,
+                             const DirtyRect& region,
+                             std::uint32_t columnAlignment,
+                             const SourceRowFn& sourceRow,
+                             DownscaleScratch& scratch) const
+{
+    scaleRegionWith(activeDownscaleTier(), dst, dstPitch, region, columnAlignment, sourceRow, scratch);
+}
+
+bool AreaScaler::scaleRegionWith(DownscaleTier tier,
+                                 std::uint8_t* dst,
+                                 std::size_t dstPitch,
+                                 const DirtyRect& region,
+                                 std::uint32_t columnAlignment,
+                                 const SourceRowFn& sourceRow,
+                                 DownscaleScratch& scratch) const
+{
+    const DownscaleKernels* kernels = downscaleKernels(tier);
+    if (!kernels)
+    {
+        return false;
+    }
+
+    const std::uint32_t left = std::min(region.left, outputWidth_);
+    const std::uint32_t right = std::min(region.right, outputWidth_);
+    const std::uint32_t top = std::min(region.top, outputHeight_);
+    const std::uint32_t bottom = std::min(region.bottom, outputHeight_);
+    if (left >= right || top >= bottom)
+    {
+        return true;
+    }
+    const std::size_t pixels = right - left;
+
+    const std::uint32_t alignment = std::max(columnAlignment, 1u);
+    const std::uint32_t spanBegin = boxFactor_ != 0 ? left * boxFactor_ : columns_.first[left];
+    const std::uint32_t spanEnd = boxFactor_ != 0 ? right * boxFactor_ : columns_.first[right - 1] + columns_.taps;
+    const std::uint32_t columnBegin = spanBegin / alignment * alignment;
+    const std::uint32_t columnCount = spanEnd - columnBegin;
+    const std::size_t sourceBytes = static_cast<std::size_t>(columnCount) * 4;
+
+    if (boxFactor_ != 0)
+    {
+        const std::size_t skip = static_cast<std::size_t>(spanBegin - columnBegin) * 4;
+        scratch.sourceRows.resize(sourceBytes * boxFactor_);
+        const std::uint8_t* rows[4] = {};
+        for (std::uint32_t y = top; y < bottom; ++y)
+        {
+            for (std::uint32_t r = 0; r < boxFactor_; ++r)
+            {
+                rows[r] = sourceRow(y * boxFactor_ + r, columnBegin, columnCount, scratch.sourceRows.data() + r * sourceBytes) + skip;
+            }
+            std::uint8_t* out = dst + static_cast<std::size_t>(y) * dstPitch + static_cast<std::size_t>(left) * 4;
+            if (boxFactor_ == 2)
+            {
+                kernels->box2(out, rows[0], rows[1], pixels);
+            }
+            else
+            {
+                kernels->box4(out, rows, pixels);
+            }
+        }
+        return true;
+    }
+
+    // Filtered source rows live in a ring indexed by row number: a window is
+    // at most rows_.taps consecutive rows, so neighbouring output rows reuse
+    // the rows they share and never evict one still in use.
+    const std::size_t ringSize = rows_.taps;
+    const std::size_t filteredValues = pixels * 4;
+    scratch.sourceRows.resize(sourceBytes);
+    scratch.filteredRows.resize(ringSize * filteredValues);
+    scratch.filteredTags.assign(ringSize, kNoRow);
+    scratch.windowRows.resize(ringSize);
+    scratch.firstColumns.resize(pixels);
+    for (std::size_t i = 0; i < pixels; ++i)
+    {
+        scratch.firstColumns[i] = columns_.first[left + i] - columnBegin;
+    }
+    const std::int16_t* columnWeights = columns_.weights.data() + static_cast<std::size_t>(left) * columns_.taps;
+
+    for (std::uint32_t y = top; y < bottom; ++y)
+    {
+        const std::int16_t* weights = rows_.weights.data() + static_cast<std::size_t>(y) * rows_.taps;
+        std::uint32_t begin = 0;
+        std::uint32_t end = rows_.taps;
+        while (weights[begin] == 0)
+        {
+            ++begin;
+        }
+        while (weights[end - 1] == 0)
+        {
+            --end;
+        }
+        for (std::uint32_t tap = begin; tap < end; ++tap)
+        {
+            const std::uint32_t row = rows_.first[y] + tap;
+            const std::size_t slot = row % ringSize;
+            std::uint16_t* filtered = scratch.filteredRows.data() + slot * filteredValues;
+            if (scratch.filteredTags[slot] != row)
+            {
+                const std::uint8_t* source = sourceRow(row, columnBegin, columnCount, scratch.sourceRows.data());
+                kernels->horizontal(filtered, source, columnCount, scratch.firstColumns.data(), columnWeights, columns_.taps, pixels);
+                scratch.filteredTags[slot] = row;
+            }
+            scratch.windowRows[tap - begin] = filtered;
+        }
+        std::uint8_t* out = dst + static_cast<std::size_t>(y) * dstPitch + static_cast<std::size_t>(left) * 4;
+        kernels->vertical(out, scratch.windowRows.data(), weights + begin, end - begin, filteredValues);
+    }
+    return true;
+}
@@ -0,0 +1,598 @@
+#include "FileReplayCapture.hpp"
+#include "LatencyStats.hpp"
+#include "MjpegDecoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr std::uint32_t kMaxDimension = 16384;
+    constexpr char kY4mMagic[] = "YUV4MPEG2";
+    constexpr std::size_t kMaxHeaderLength = 1024;
+    constexpr std::size_t kMjpegChunkBytes = 1024 * 1024;
+    // A picture that has not ended by then is treated as corrupt.
+    constexpr std::size_t kMaxMjpegFrameBytes = 32 * 1024 * 1024;
+
+    void logMessage(const std::string& text)
+    {
+        std::ofstream("pckvm.log", std::ios::app) << text << '\n';
+    }
+
+    std::uint32_t parseDimension(const std::string& token)
+    {
+        const unsigned long value = std::stoul(token);
+        if (value == 0 || value > kMaxDimension)
+        {
+            throw std::runtime_error("Y4M frame size out of range");
+        }
+        return static_cast<std::uint32_t>(value);
+    }
+
+    std::uint8_t clampByte(std::int32_t value)
+    {
+        return static_cast<std::uint8_t>(std::clamp(value, 0, 255));
+    }
+
+    std::string fileName(const std::string& path)
+    {
+        const std::size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+FileReplayCapture::FileReplayCapture()
+    : FileReplayCapture(Config{})
+{
+}
+
+FileReplayCapture::FileReplayCapture(Config config)
+    : config_(std::move(config))
+{
+}
+
+FileReplayCapture::~FileReplayCapture()
+{
+    stop();
+}
+
+void FileReplayCapture::start(FrameHandler handler, const Options& options)
+{
+    if (!handler)
+    {
+        throw std::invalid_argument("Frame handler must not be empty");
+    }
+    if (running_.load(std::memory_order_acquire))
+    {
+        throw std::runtime_error("Capture already running");
+    }
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+    if (options.desiredWidth != 0 || options.desiredHeight != 0)
+    {
+        logMessage("[Replay] Ignoring requested resolution; frames keep the size they were recorded at");
+    }
+
+    open();
+    loadTimestamps();
+
+    preloaded_.clear();
+    preloadedOffsets_.clear();
+    if (config_.preload)
+    {
+        preloadedOffsets_.push_back(0);
+        while (const std::size_t frameBytes = readFrame())
+        {
+            if (preloaded_.size() + frameBytes > kPreloadLimitBytes)
+            {
+                preloaded_.clear();
+                preloaded_.shrink_to_fit();
+                preloadedOffsets_.clear();
+                throw std::runtime_error("Replay file is too large to preload");
+            }
+            preloaded_.insert(preloaded_.end(), buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(frameBytes));
+            preloadedOffsets_.push_back(preloaded_.size());
+        }
+        frameCount_ = preloadedOffsets_.size() - 1;
+        file_.close();
+        if (frameCount_ == 0)
+        {
+            throw std::runtime_error("Replay file '" + config_.path + "' contains no complete frames");
+        }
+    }
+
+    handler_ = std::move(handler);
+    framesDelivered_.store(0, std::memory_order_relaxed);
+    framesLate_.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_.clear();
+    }
+
+    running_.store(true, std::memory_order_release);
+    worker_ = std::thread([this]() { run(); });
+    logMessage("[Replay] Started " + currentDeviceFriendlyName() +
+               (config_.preload ? " (" + std::to_string(frameCount_) + " frames preloaded)" : std::string()));
+}
+
+void FileReplayCapture::stop()
+{
+    running_.store(false, std::memory_order_release);
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+    file_.close();
+}
+
+std::string FileReplayCapture::consumeLastError()
+{
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    std::string result = lastError_;
+    lastError_.clear();
+    return result;
+}
+
+std::string FileReplayCapture::currentDeviceFriendlyName() const
+{
+    std::ostringstream oss;
+    oss << "Replay of " << fileName(config_.path) << ' ' << width_ << 'x' << height_ << '@'
+        << static_cast<double>(rateNum_) / static_cast<double>(rateDen_);
+    return oss.str();
+}
+
+void FileReplayCapture::open()
+{
+    file_.close();
+    file_.clear();
+    file_.open(config_.path, std::ios::binary);
+    if (!file_)
+    {
+        throw std::runtime_error("Failed to open replay file '" + config_.path + "'");
+    }
+
+    char magic[sizeof(kY4mMagic) - 1] = {};
+    file_.read(magic, sizeof(magic));
+    const std::streamsize magicBytes = file_.gcount();
+    const bool isY4m = magicBytes == static_cast<std::streamsize>(sizeof(magic)) &&
+                       std::memcmp(magic, kY4mMagic, sizeof(magic)) == 0;
+    const bool isMjpeg = magicBytes >= 2 && static_cast<std::uint8_t>(magic[0]) == 0xFF && static_cast<std::uint8_t>(magic[1]) == 0xD8;
+    file_.clear();
+    file_.seekg(0);
+
+    if (isMjpeg)
+    {
+        if (!(config_.fps > 0.0))
+        {
+            throw std::invalid_argument("Replay frame rate must be positive");
+        }
+        container_ = Container::Mjpeg;
+        rateNum_ = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::llround(config_.fps * 1000.0)));
+        rateDen_ = 1000;
+        dataStart_ = 0;
+        rewind();
+        const std::size_t firstBytes = readMjpegFrame();
+        const bool pictureFound = firstBytes != 0 && MjpegDecoder::probe(buffer_.data(), firstBytes, width_, height_);
+        rewind();
+        if (pictureFound)
+        {
+            frameCount_ = 0;
+            return;
+        }
+        if (config_.width == 0 || config_.height == 0)
+        {
+            throw std::runtime_error("Replay file '" + config_.path + "' contains no complete JPEG pictures");
+        }
+        // Raw frames whose first pixel happens to start like a JPEG.
+    }
+
+    if (isY4m)
+    {
+        std::string header;
+        std::getline(file_, header);
+        if (!file_ || header.size() > kMaxHeaderLength)
+        {
+            throw std::runtime_error("Replay file '" + config_.path + "' has a malformed Y4M header");
+        }
+        container_ = Container::Y4M;
+        parseY4mHeader(header);
+        const std::size_t lumaBytes = static_cast<std::size_t>(width_) * height_;
+        const std::size_t chromaBytes = monochrome_ ? 0 : static_cast<std::size_t>((width_ + chromaShiftX_) >> chromaShiftX_) *
+                                                              ((height_ + chromaShiftY_) >> chromaShiftY_);
+        fileFrameBytes_ = lumaBytes + 2 * chromaBytes;
+        planes_.resize(fileFrameBytes_);
+    }
+    else
+    {
+        if (config_.width == 0 || config_.height == 0 || config_.width > kMaxDimension || config_.height > kMaxDimension)
+        {
+            throw std::invalid_argument("Raw replay needs a frame size");
+        }
+        if (!(config_.fps > 0.0))
+        {
+            throw std::invalid_argument("Replay frame rate must be positive");
+        }
+        container_ = Container::Raw;
+        width_ = config_.width;
+        height_ = config_.height;
+        rateNum_ = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::llround(config_.fps * 1000.0)));
+        rateDen_ = 1000;
+        fileFrameBytes_ = static_cast<std::size_t>(width_) * height_ * 4;
+    }
+    buffer_.resize(static_cast<std::size_t>(width_) * height_ * 4);
+
+    dataStart_ = file_.tellg();
+    file_.seekg(0, std::ios::end);
+    const std::streamoff payloadBytes = static_cast<std::streamoff>(file_.tellg()) - dataStart_;
+    file_.seekg(dataStart_);
+    if (payloadBytes < static_cast<std::streamoff>(fileFrameBytes_))
+    {
+        throw std::runtime_error("Replay file '" + config_.path + "' contains no complete frames");
+    }
+    frameCount_ = 0;
+}
+
+void FileReplayCapture::rewind()
+{
+    file_.clear();
+    file_.seekg(dataStart_);
+    pending_.clear();
+    pendingStart_ = 0;
+}
+
+void FileReplayCapture::parseY4mHeader(const std::string& header)
+{
+    width_ = 0;
+    height_ = 0;
+    rateNum_ = 0;
+    rateDen_ = 0;
+    bool rateDeclared = false;
+    chromaShiftX_ = 1;
+    chromaShiftY_ = 1;
+    monochrome_ = false;
+    fullRange_ = false;
+
+    std::istringstream tokens(header.substr(sizeof(kY4mMagic) - 1));
+    std::string token;
+    try
+    {
+        while (tokens >> token)
+        {
+            const std::string value = token.substr(1);
+            switch (token[0])
+            {
+            case 'W':
+                width_ = parseDimension(value);
+                break;
+            case 'H':
+                height_ = parseDimension(value);
+                break;
+            case 'F':
+            {
+                const std::size_t colon = value.find(':');
+                const std::uint64_t num = std::stoull(value.substr(0, colon));
+                const std::uint64_t den = colon == std::string::npos ? 1 : std::stoull(value.substr(colon + 1));
+                rateNum_ = num;
+                rateDen_ = den;
+                rateDeclared = true;
+                break;
+            }
+            case 'C':
+                if (value == "420" || value == "420jpeg" || value == "420mpeg2" || value == "420paldv")
+                {
+                    chromaShiftX_ = 1;
+                    chromaShiftY_ = 1;
+                }
+                else if (value == "422")
+                {
+                    chromaShiftX_ = 1;
+                    chromaShiftY_ = 0;
+                }
+                else if (value == "444")
+                {
+                    chromaShiftX_ = 0;
+                    chromaShiftY_ = 0;
+                }
+                else if (value == "mono")
+                {
+                    monochrome_ = true;
+                }
+                else
+                {
+                    throw std::runtime_error("Unsupported Y4M colour space C" + value);
+                }
+                break;
+            case 'X':
+                if (value == "COLORRANGE=FULL")
+                {
+                    fullRange_ = true;
+                }
+                break;
+            default:
+                // Interlacing (I) and pixel aspect (A) do not change the samples.
+                break;
+            }
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        throw std::runtime_error("Replay file '" + config_.path + "' has a malformed Y4M header");
+    }
+
+    if (width_ == 0 || height_ == 0)
+    {
+        throw std::runtime_error("Replay file '" + config_.path + "' does not declare a frame size");
+    }
+    if (!rateDeclared && config_.fps > 0.0)
+    {
+        rateNum_ = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::llround(config_.fps * 1000.0)));
+        rateDen_ = 1000;
+    }
+    if (rateNum_ == 0 || rateDen_ == 0)
+    {
+        throw std::invalid_argument("Replay frame rate must be positive");
+    }
+}
+
+void FileReplayCapture::loadTimestamps()
+{
+    timestamps100ns_.clear();
+    if (config_.timestampsPath.empty())
+    {
+        return;
+    }
+
+    std::ifstream input(config_.timestampsPath);
+    if (!input)
+    {
+        throw std::runtime_error("Failed to open timestamp file '" + config_.timestampsPath + "'");
+    }
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        double milliseconds = 0.0;
+        try
+        {
+            milliseconds = std::stod(line);
+        }
+        catch (const std::logic_error&)
+        {
+            throw std::runtime_error("Malformed timestamp '" + line + "' in '" + config_.timestampsPath + "'");
+        }
+        const std::uint64_t value = static_cast<std::uint64_t>(std::llround(std::max(milliseconds, 0.0) * 10'000.0));
+        if (!timestamps100ns_.empty() && value < timestamps100ns_.back())
+        {
+            throw std::runtime_error("Timestamps in '" + config_.timestampsPath + "' go backwards");
+        }
+        timestamps100ns_.push_back(value);
+    }
+}
+
+std::uint64_t FileReplayCapture::frameTimestamp(std::uint64_t index) const
+{
+    const double period100ns = 10'000'000.0 * static_cast<double>(rateDen_) / static_cast<double>(rateNum_);
+    if (timestamps100ns_.empty())
+    {
+        return static_cast<std::uint64_t>(std::llround(static_cast<double>(index) * period100ns));
+    }
+    if (index < timestamps100ns_.size())
+    {
+        return timestamps100ns_[index];
+    }
+    // More frames than timestamps: continue at the nominal rate.
+    const std::uint64_t beyond = index - (timestamps100ns_.size() - 1);
+    return timestamps100ns_.back() + static_cast<std::uint64_t>(std::llround(static_cast<double>(beyond) * period100ns));
+}
+
+std::size_t FileReplayCapture::readFrame()
+{
+    if (container_ == Container::Mjpeg)
+    {
+        return readMjpegFrame();
+    }
+
+    const std::size_t frameBytes = static_cast<std::size_t>(width_) * height_ * 4;
+    if (container_ == Container::Raw)
+    {
+        file_.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(fileFrameBytes_));
+        return file_.gcount() == static_cast<std::streamsize>(fileFrameBytes_) ? frameBytes : 0;
+    }
+
+    std::string frameHeader;
+    if (!std::getline(file_, frameHeader) || frameHeader.rfind("FRAME", 0) != 0)
+    {
+        return 0;
+    }
+    file_.read(reinterpret_cast<char*>(planes_.data()), static_cast<std::streamsize>(fileFrameBytes_));
+    if (file_.gcount() != static_cast<std::streamsize>(fileFrameBytes_))
+    {
+        return 0;
+    }
+    convertY4m(buffer_.data());
+    return frameBytes;
+}
+
+// The file has no index: pictures are found by walking their markers from
+// each SOI. Bytes between pictures, and pictures that never end, are skipped.
+std::size_t FileReplayCapture::readMjpegFrame()
+{
+    bool endOfFile = false;
+    for (;;)
+    {
+        const std::uint8_t* begin = pending_.data() + pendingStart_;
+        const std::size_t available = pending_.size() - pendingStart_;
+        std::size_t skipped = 0;
+        while (skipped + 1 < available && !(begin[skipped] == 0xFF && begin[skipped + 1] == 0xD8))
+        {
+            ++skipped;
+        }
+        pendingStart_ += skipped;
+        begin += skipped;
+        const std::size_t remaining = available - skipped;
+
+        if (remaining >= 2)
+        {
+            const std::size_t length = MjpegDecoder::frameLength(begin, remaining);
+            if (length != 0)
+            {
+                buffer_.assign(begin, begin + length);
+                pendingStart_ += length;
+                return length;
+            }
+            if (endOfFile || remaining > kMaxMjpegFrameBytes)
+            {
+                pendingStart_ += 2;
+                continue;
+            }
+        }
+        else if (endOfFile)
+        {
+            return 0;
+        }
+
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(pendingStart_));
+        pendingStart_ = 0;
+        const std::size_t kept = pending_.size();
+        pending_.resize(kept + kMjpegChunkBytes);
+        file_.read(reinterpret_cast<char*>(pending_.data() + kept), static_cast<std::streamsize>(kMjpegChunkBytes));
+        const auto bytesRead = static_cast<std::size_t>(std::max<std::streamsize>(file_.gcount(), 0));
+        pending_.resize(kept + bytesRead);
+        endOfFile = bytesRead == 0;
+    }
+}
+
+void FileReplayCapture::convertY4m(std::uint8_t* bgra) const
+{
+    // Y4M carries no matrix; follow the usual SD/HD convention.
+    const bool hd = height_ >= 720;
+    const double kr = hd ? 0.2126 : 0.299;
+    const double kb = hd ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+    const double lumaScale = fullRange_ ? 1.0 : 255.0 / 219.0;
+    const double chromaScale = fullRange_ ? 1.0 : 255.0 / 224.0;
+    const std::int32_t lumaOffset = fullRange_ ? 0 : 16;
+
+    const auto fixed = [](double value) { return static_cast<std::int32_t>(std::lround(value * 65536.0)); };
+    const std::int32_t yScale = fixed(lumaScale);
+    const std::int32_t crToR = fixed(2.0 * (1.0 - kr) * chromaScale);
+    const std::int32_t cbToB = fixed(2.0 * (1.0 - kb) * chromaScale);
+    const std::int32_t cbToG = fixed(2.0 * kb * (1.0 - kb) / kg * chromaScale);
+    const std::int32_t crToG = fixed(2.0 * kr * (1.0 - kr) / kg * chromaScale);
+
+    const std::size_t chromaWidth = (width_ + chromaShiftX_) >> chromaShiftX_;
+    const std::size_t chromaHeight = (height_ + chromaShiftY_) >> chromaShiftY_;
+    const std::uint8_t* lumaPlane = planes_.data();
+    const std::uint8_t* cbPlane = lumaPlane + static_cast<std::size_t>(width_) * height_;
+    const std::uint8_t* crPlane = cbPlane + chromaWidth * chromaHeight;
+
+    for (std::uint32_t y = 0; y < height_; ++y)
+    {
+        const std::uint8_t* luma = lumaPlane + static_cast<std::size_t>(y) * width_;
+        const std::uint8_t* cbRow = cbPlane + (y >> chromaShiftY_) * chromaWidth;
+        const std::uint8_t* crRow = crPlane + (y >> chromaShiftY_) * chromaWidth;
+        std::uint8_t* out = bgra + static_cast<std::size_t>(y) * width_ * 4;
+        for (std::uint32_t x = 0; x < width_; ++x)
+        {
+            const std::int32_t scaledLuma = (static_cast<std::int32_t>(luma[x]) - lumaOffset) * yScale + 32768;
+            std::int32_t cb = 0;
+            std::int32_t cr = 0;
+            if (!monochrome_)
+            {
+                cb = static_cast<std::int32_t>(cbRow[x >> chromaShiftX_]) - 128;
+                cr = static_cast<std::int32_t>(crRow[x >> chromaShiftX_]) - 128;
+            }
+            out[x * 4 + 0] = clampByte((scaledLuma + cbToB * cb) >> 16);
+            out[x * 4 + 1] = clampByte((scaledLuma - cbToG * cb - crToG * cr) >> 16);
+            out[x * 4 + 2] = clampByte((scaledLuma + crToR * cr) >> 16);
+            out[x * 4 + 3] = 0xFF;
+        }
+    }
+}
+
+void FileReplayCapture::run()
+{
+    const bool compressed = container_ == Container::Mjpeg;
+    const std::uint64_t period100ns = 10'000'000ull * rateDen_ / rateNum_;
+    FramePacer pacer;
+    std::uint64_t index = 0;
+    std::uint64_t loopBase = 0;
+    std::uint64_t lastTimestamp = 0;
+
+    try
+    {
+        while (running_.load(std::memory_order_acquire))
+        {
+            std::size_t frameBytes = 0;
+            if (!config_.preload)
+            {
+                frameBytes = readFrame();
+            }
+            else if (index < frameCount_)
+            {
+                frameBytes = preloadedOffsets_[index + 1] - preloadedOffsets_[index];
+            }
+            if (frameBytes == 0)
+            {
+                if (!config_.loop || index == 0)
+                {
+                    logMessage("[Replay] End of file after " + std::to_string(framesDelivered()) + " frames");
+                    break;
+                }
+                loopBase = lastTimestamp + period100ns;
+                index = 0;
+                if (!config_.preload)
+                {
+                    rewind();
+                }
+                continue;
+            }
+
+            Frame frame{};
+            frame.timestamp100ns = loopBase + frameTimestamp(index);
+            lastTimestamp = frame.timestamp100ns;
+            if (config_.paced && !pacer.waitFor(frame.timestamp100ns, period100ns))
+            {
+                framesLate_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            frame.data = config_.preload ? preloaded_.data() + preloadedOffsets_[index] : buffer_.data();
+            frame.dataSize = frameBytes;
+            frame.format = compressed ? PixelFormat::MJPEG : PixelFormat::BGRA8;
+            frame.width = width_;
+            frame.height = height_;
+            frame.stride = compressed ? 0 : width_ * 4;
+            frame.sampleWidth = width_;
+            frame.sampleHeight = height_;
+            frame.contentRight = width_;
+            frame.contentBottom = height_;
+            frame.bottomUp = container_ == Container::Raw && config_.bottomUp;
+            frame.arrivalNs = latencyClockNs();
+
+            handler_(frame);
+            framesDelivered_.fetch_add(1, std::memory_order_relaxed);
+            ++index;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_ = ex.what();
+        logMessage(std::string("[Replay] Runtime exception: ") + lastError_);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_ = "Unknown capture error";
+        logMessage("[Replay] Runtime exception: unknown");
+    }
+}
@@ -0,0 +1,285 @@
+#include "FramePool.hpp"
+
+#include <atomic>
+#include <new>
+
+struct FramePool::Block {
+    std::atomic<std::uint32_t> refs{0};
+    std::size_t bytes = 0;
+    PixelFormat format = PixelFormat::BGRA8;
+    FramePool* owner = nullptr;
+    Block* next = nullptr;
+    std::uint8_t* data = nullptr;
+};
+
+namespace
+{
+    // The block header and its payload share one allocation; the payload
+    // starts one alignment unit in.
+    constexpr std::size_t kHeaderBytes = FramePool::kAlignment;
+}
+
+FramePool::Handle::Handle(const Handle& other) noexcept
+    : block_(other.block_)
+{
+    if (block_)
+    {
+        block_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+FramePool::Handle::Handle(Handle&& other) noexcept
+    : block_(other.block_)
+{
+    other.block_ = nullptr;
+}
+
+FramePool::Handle& FramePool::Handle::operator=(const Handle& other) noexcept
+{
+    if (this != &other)
+    {
+        Handle copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+FramePool::Handle& FramePool::Handle::operator=(Handle&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        block_ = other.block_;
+        other.block_ = nullptr;
+    }
+    return *this;
+}
+
+FramePool::Handle::~Handle()
+{
+    reset();
+}
+
+std::uint8_t* FramePool::Handle::data() const noexcept
+{
+    return block_ ? block_->data : nullptr;
+}
+
+std::size_t FramePool::Handle::size() const noexcept
+{
+    return block_ ? block_->bytes : 0;
+}
+
+FramePool::PixelFormat FramePool::Handle::format() const noexcept
+{
+    return block_ ? block_->format : PixelFormat::BGRA8;
+}
+
+std::uint32_t FramePool::Handle::useCount() const noexcept
+{
+    return block_ ? block_->refs.load(std::memory_order_relaxed) : 0;
+}
+
+void FramePool::Handle::reset() noexcept
+{
+    Block* block = block_;
+    block_ = nullptr;
+    if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        block->owner->recycle(block);
+    }
+}
+
+FramePool::FramePool(std::size_t limitBytes)
+    : limitBytes_(limitBytes)
+{
+}
+
+FramePool::~FramePool()
+{
+    trim();
+}
+
+FramePool::Handle FramePool::acquire(std::size_t bytes, PixelFormat format)
+{
+    static_assert(sizeof(Block) <= kHeaderBytes, "block header must fit ahead of the aligned payload");
+
+    if (bytes == 0)
+    {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++clock_;
+
+    Bucket* bucket = findBucketLocked(bytes, format);
+    if (!bucket)
+    {
+        bucket = &claimBucketLocked(bytes, format);
+    }
+    bucket->lastUse = clock_;
+
+    if (Block* block = bucket->freeList)
+    {
+        bucket->freeList = block->next;
+        block->next = nullptr;
+        cachedBytes_ -= block->bytes;
+        block->refs.store(1, std::memory_order_relaxed);
+        return Handle(block);
+    }
+
+    while (totalBytes_ + bytes > limitBytes_ && evictOneLocked(bucket))
+    {
+    }
+    if (totalBytes_ + bytes > limitBytes_)
+    {
+        return {};
+    }
+
+    void* storage = ::operator new(kHeaderBytes + bytes, std::align_val_t{kAlignment}, std::nothrow);
+    if (!storage)
+    {
+        return {};
+    }
+
+    auto* block = new (storage) Block();
+    block->bytes = bytes;
+    block->format = format;
+    block->owner = this;
+    block->data = static_cast<std::uint8_t*>(storage) + kHeaderBytes;
+    block->refs.store(1, std::memory_order_relaxed);
+
+    totalBytes_ += bytes;
+    ++allocations_;
+    return Handle(block);
+}
+
+void FramePool::setLimit(std::size_t limitBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    limitBytes_ = limitBytes;
+    while (totalBytes_ > limitBytes_ && evictOneLocked(nullptr))
+    {
+    }
+}
+
+void FramePool::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& bucket : buckets_)
+    {
+        releaseFreeListLocked(bucket);
+    }
+}
+
+std::uint64_t FramePool::allocationCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocations_;
+}
+
+std::size_t FramePool::totalBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalBytes_;
+}
+
+std::size_t FramePool::cachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cachedBytes_;
+}
+
+FramePool::Bucket* FramePool::findBucketLocked(std::size_t bytes, PixelFormat format)
+{
+    for (auto& bucket : buckets_)
+    {
+        if (bucket.used && bucket.bytes == bytes && bucket.format == format)
+        {
+            return &bucket;
+        }
+    }
+    return nullptr;
+}
+
+FramePool::Bucket& FramePool::claimBucketLocked(std::size_t bytes, PixelFormat format)
+{
+    Bucket* victim = &buckets_[0];
+    for (auto& bucket : buckets_)
+    {
+        if (!bucket.used)
+        {
+            victim = &bucket;
+            break;
+        }
+        if (bucket.lastUse < victim->lastUse)
+        {
+            victim = &bucket;
+        }
+    }
+
+    // Buffers of the evicted key still in use are freed when they come back.
+    releaseFreeListLocked(*victim);
+    victim->bytes = bytes;
+    victim->format = format;
+    victim->used = true;
+    return *victim;
+}
+
+bool FramePool::evictOneLocked(const Bucket* keep)
+{
+    Bucket* victim = nullptr;
+    for (auto& bucket : buckets_)
+    {
+        if (&bucket == keep || !bucket.freeList)
+        {
+            continue;
+        }
+        if (!victim || bucket.lastUse < victim->lastUse)
+        {
+            victim = &bucket;
+        }
+    }
+    if (!victim)
+    {
+        return false;
+    }
+
+    Block* block = victim->freeList;
+    victim->freeList = block->next;
+    cachedBytes_ -= block->bytes;
+    destroyBlockLocked(block);
+    return true;
+}
+
+void FramePool::releaseFreeListLocked(Bucket& bucket)
+{
+    while (Block* block = bucket.freeList)
+    {
+        bucket.freeList = block->next;
+        cachedBytes_ -= block->bytes;
+        destroyBlockLocked(block);
+    }
+}
+
+void FramePool::destroyBlockLocked(Block* block)
+{
+    totalBytes_ -= block->bytes;
+    block->~Block();
+    ::operator delete(static_cast<void*>(block), std::align_val_t{kAlignment});
+}
+
+void FramePool::recycle(Block* block) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Bucket* bucket = findBucketLocked(block->bytes, block->format);
+    if (!bucket || totalBytes_ > limitBytes_)
+    {
+        destroyBlockLocked(block);
+        return;
+    }
+
+    block->next = bucket->freeList;
+    bucket->freeList = block;
+    cachedBytes_ += block->bytes;
+}
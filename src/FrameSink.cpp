@@ -0,0 +1,260 @@
+#include "FrameSink.hpp"
+#include "CopyKernels.hpp"
+#include "DirtyTracker.hpp"
+#include "Downscale.hpp"
+#include "PixelConversion.hpp"
+#include "StripeWorkerPool.hpp"
+#include "ToneMapping.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Below this a single core copies fast enough that waking workers costs
+    // more than it saves.
+    constexpr std::size_t kParallelCopyThresholdBytes = 4u * 1024u * 1024u;
+    // Tone mapping costs about ten times a plain conversion per pixel.
+    constexpr std::size_t kParallelToneMapThresholdBytes = kParallelCopyThresholdBytes / 8;
+
+    bool needsToneMapping(const DirectShowCapture::Frame& frame, const ToneMapper* toneMapper)
+    {
+        return toneMapper && frame.format == DirectShowCapture::PixelFormat::P010 &&
+               frame.transfer == DirectShowCapture::TransferFunction::PQ;
+    }
+
+    // Converts `spanPixels` pixels of source row `y`, starting at column
+    // `left`, to BGRA, zero-filling whatever the source buffer is too short
+    // to provide.
+    void convertSourceRow(const DirectShowCapture::Frame& frame,
+                          const YuvCoefficients& coefficients,
+                          const ToneMapper* toneMapper,
+                          std::uint32_t y,
+                          std::size_t left,
+                          std::size_t spanPixels,
+                          std::uint8_t* dstRow)
+    {
+        const std::size_t groupPixels = pixelFormatGroupPixels(frame.format);
+        const std::size_t groupBytes = pixelFormatGroupBytes(frame.format);
+        const std::size_t rowOffset = frameSourceRowOffset(frame, y);
+        const std::size_t srcOffset = rowOffset + pixelFormatRowOffset(frame.format, left);
+
+        // Whole groups only; only v210 can start partway into one.
+        std::size_t pixels = 0;
+        if (isSemiPlanar(frame.format))
+        {
+            const std::size_t chromaRow = frameChromaRowOffset(frame, y);
+            const std::size_t chromaOffset = chromaRow + pixelFormatRowOffset(frame.format, left);
+            if (frame.data && rowOffset != kMissingSourceRow && srcOffset < frame.dataSize &&
+                chromaRow != kMissingSourceRow && chromaOffset < frame.dataSize)
+            {
+                // A Cb Cr pair takes as many bytes as the two luma samples it serves.
+                const std::size_t lumaAvailable = (frame.dataSize - srcOffset) / groupBytes * groupPixels;
+                const std::size_t chromaAvailable = (frame.dataSize - chromaOffset) / groupBytes * groupPixels;
+                pixels = std::min({spanPixels, lumaAvailable, chromaAvailable});
+                if (needsToneMapping(frame, toneMapper))
+                {
+                    toneMapper->convertRow(dstRow, frame.data + srcOffset, frame.data + chromaOffset, pixels, coefficients);
+                }
+                else
+                {
+                    convertSemiPlanarRowToBgra(frame.format, dstRow, frame.data + srcOffset, frame.data + chromaOffset, pixels, coefficients);
+                }
+            }
+        }
+        else if (frame.data && rowOffset != kMissingSourceRow && srcOffset < frame.dataSize)
+        {
+            const std::size_t skip = left % groupPixels;
+            const std::size_t available = (frame.dataSize - srcOffset) / groupBytes * groupPixels;
+            pixels = std::min(spanPixels, available > skip ? available - skip : 0);
+            if (frame.format == DirectShowCapture::PixelFormat::V210)
+            {
+                convertV210RowToBgra(dstRow, frame.data + srcOffset, skip, pixels, coefficients);
+            }
+            else
+            {
+                convertRowToBgra(frame.format, dstRow, frame.data + srcOffset, pixels, coefficients);
+            }
+        }
+        if (pixels < spanPixels)
+        {
+            std::memset(dstRow + pixels * 4, 0, (spanPixels - pixels) * 4);
+        }
+    }
+
+    // Converts the pixel span [left, right) of destination rows [top, bottom)
+    // to BGRA. Returns the bytes written.
+    std::size_t copyRegion(const DirectShowCapture::Frame& frame,
+                           const FrameSinkTarget& target,
+                           const YuvCoefficients& coefficients,
+                           const ToneMapper* toneMapper,
+                           std::uint32_t top,
+                           std::uint32_t bottom,
+                           std::size_t left,
+                           std::size_t right)
+    {
+        for (std::uint32_t y = top; y < bottom; ++y)
+        {
+            std::uint8_t* dstRow = target.data + static_cast<std::size_t>(y) * target.rowPitch + left * 4;
+            convertSourceRow(frame, coefficients, toneMapper, y, left, right - left, dstRow);
+        }
+        return (right - left) * 4 * (bottom - top);
+    }
+
+    // Same for a region of a downscaled frame: BGRA rows are filtered where
+    // they lie, others are converted into per-thread scratch first.
+    std::size_t scaleRegion(const DirectShowCapture::Frame& frame,
+                            const FrameSinkTarget& target,
+                            const YuvCoefficients& coefficients,
+                            const ToneMapper* toneMapper,
+                            const AreaScaler& scaler,
+                            const DirtyRect& region)
+    {
+        thread_local DownscaleScratch scratch;
+        // Captured as one reference, which std::function stores without allocating.
+        const struct {
+            const DirectShowCapture::Frame& frame;
+            const YuvCoefficients& coefficients;
+            const ToneMapper* toneMapper;
+            bool bgra;
+        } source{frame, coefficients, toneMapper, frame.format == DirectShowCapture::PixelFormat::BGRA8};
+        // Spans start on a pixel group, so converted rows never start partway into one.
+        const std::uint32_t alignment = pixelFormatGroupPixels(frame.format);
+        scaler.scaleRegion(target.data, target.rowPitch, region, alignment,
+                           [&source](std::uint32_t row, std::uint32_t firstColumn, std::uint32_t columns, std::uint8_t* rowScratch) {
+                               const DirectShowCapture::Frame& frame = source.frame;
+                               if (source.bgra && frame.data)
+                               {
+                                   const std::size_t rowOffset = frameSourceRowOffset(frame, row);
+                                   const std::size_t offset = rowOffset + static_cast<std::size_t>(firstColumn) * 4;
+                                   if (rowOffset != kMissingSourceRow && offset <= frame.dataSize &&
+                                       frame.dataSize - offset >= static_cast<std::size_t>(columns) * 4)
+                                   {
+                                       return frame.data + offset;
+                                   }
+                               }
+                               convertSourceRow(frame, source.coefficients, source.toneMapper, row, firstColumn, columns, rowScratch);
+                               return static_cast<const std::uint8_t*>(rowScratch);
+                           },
+                           scratch);
+        return static_cast<std::size_t>(region.right - region.left) * 4 * (region.bottom - region.top);
+    }
+}
+
+FrameWriteResult writeFrameToSink(const DirectShowCapture::Frame& frame,
+                                  FrameSink& sink,
+                                  const FrameWriteOptions& options)
+{
+    FrameWriteResult result{};
+    if (frame.width == 0 || frame.height == 0 || isCompressed(frame.format))
+    {
+        return result;
+    }
+
+    const AreaScaler* scaler = options.scaler;
+    if (scaler && (scaler->sourceWidth() != frame.width || scaler->sourceHeight() != frame.height))
+    {
+        scaler = nullptr;
+    }
+    const std::uint32_t outputWidth = scaler ? scaler->outputWidth() : frame.width;
+    const std::uint32_t outputHeight = scaler ? scaler->outputHeight() : frame.height;
+
+    FrameSinkTarget target{};
+    if (!sink.beginFrame(outputWidth, outputHeight, target) || !target.data)
+    {
+        return result;
+    }
+
+    const std::size_t rowPixels = std::min<std::size_t>(outputWidth, target.rowPitch / 4);
+    const YuvCoefficients coefficients = yuvCoefficients(frame.matrix, frame.fullRange);
+
+    const std::vector<DirtyRect>* rects = nullptr;
+    if (options.tracker && options.sequence != 0)
+    {
+        rects = options.tracker->rectsSince(target.contentSequence, options.sequence);
+    }
+    // Tracked rectangles are in source pixels. Reserved once per thread, so
+    // downscaled frames allocate nothing.
+    thread_local std::vector<DirtyRect> scaledRects;
+    if (rects && scaler)
+    {
+        scaledRects.clear();
+        scaledRects.reserve(DirtyTracker::kMaxRects);
+        for (const DirtyRect& rect : *rects)
+        {
+            scaledRects.push_back(scaleDirtyRect(rect, frame.width, frame.height, outputWidth, outputHeight));
+        }
+        rects = &scaledRects;
+    }
+    const DirtyRect wholeFrame{0, 0, outputWidth, outputHeight};
+    const DirtyRect* regions = rects ? rects->data() : &wholeFrame;
+    const std::size_t regionCount = rects ? rects->size() : 1;
+
+    // Copies the part of every region that falls into rows [bandTop, bandBottom)
+    // and fences the streaming stores so the band is complete when it returns.
+    auto copyBand = [&](std::uint32_t bandTop, std::uint32_t bandBottom) {
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < regionCount; ++i)
+        {
+            const DirtyRect& region = regions[i];
+            const std::uint32_t top = std::max(region.top, bandTop);
+            const std::uint32_t bottom = std::min(region.bottom, bandBottom);
+            const std::size_t left = std::min<std::size_t>(region.left, rowPixels);
+            const std::size_t right = std::min<std::size_t>(region.right, rowPixels);
+            if (top >= bottom || left >= right)
+            {
+                continue;
+            }
+            if (scaler)
+            {
+                const DirtyRect clipped{static_cast<std::uint32_t>(left), top, static_cast<std::uint32_t>(right), bottom};
+                bytes += scaleRegion(frame, target, coefficients, options.toneMapper, *scaler, clipped);
+            }
+            else
+            {
+                bytes += copyRegion(frame, target, coefficients, options.toneMapper, top, bottom, left, right);
+            }
+        }
+        streamCopyFence();
+        return bytes;
+    };
+
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < regionCount; ++i)
+    {
+        const DirtyRect& region = regions[i];
+        const std::size_t span = std::min<std::size_t>(region.right, rowPixels) - std::min<std::size_t>(region.left, rowPixels);
+        total += span * 4 * (region.bottom - region.top);
+    }
+
+    // Downscaling reads every source pixel under the output it writes.
+    std::size_t work = total;
+    if (scaler)
+    {
+        work = total * frame.width / outputWidth * frame.height / outputHeight;
+    }
+
+    std::size_t written = 0;
+    const std::size_t stripes = options.workers ? options.workers->concurrency() : 1;
+    const std::size_t threshold = needsToneMapping(frame, options.toneMapper) ? kParallelToneMapThresholdBytes : kParallelCopyThresholdBytes;
+    if (stripes > 1 && work >= threshold && outputHeight >= stripes)
+    {
+        options.workers->run(stripes, [&](std::size_t stripe) {
+            const auto bandTop = static_cast<std::uint32_t>(outputHeight * stripe / stripes);
+            const auto bandBottom = static_cast<std::uint32_t>(outputHeight * (stripe + 1) / stripes);
+            copyBand(bandTop, bandBottom);
+        });
+        written = total;
+    }
+    else
+    {
+        written = copyBand(0, outputHeight);
+    }
+
+    sink.recordCopy(written);
+    sink.commitFrame(frame, options.sequence);
+    result.accepted = true;
+    result.bytesWritten = written;
+    return result;
+}
@@ -0,0 +1,833 @@
+#include "ImageEncoder.hpp"
+
+#include "StripeWorkerPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    void putBigEndian32(std::uint8_t* dst, std::uint32_t value)
+    {
+        dst[0] = static_cast<std::uint8_t>(value >> 24);
+        dst[1] = static_cast<std::uint8_t>(value >> 16);
+        dst[2] = static_cast<std::uint8_t>(value >> 8);
+        dst[3] = static_cast<std::uint8_t>(value);
+    }
+
+    constexpr std::uint8_t kQoiOpIndex = 0x00;
+    constexpr std::uint8_t kQoiOpDiff = 0x40;
+    constexpr std::uint8_t kQoiOpLuma = 0x80;
+    constexpr std::uint8_t kQoiOpRun = 0xc0;
+    constexpr std::uint8_t kQoiOpRgb = 0xfe;
+    constexpr std::size_t kQoiHeaderBytes = 14;
+    constexpr std::uint8_t kQoiEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+    // Deflate (RFC 1951) limits and the base value and extra bits of every
+    // length and distance code.
+    constexpr std::size_t kWindowSize = 32768;
+    constexpr std::size_t kMinMatch = 3;
+    constexpr std::size_t kMaxMatch = 258;
+    constexpr unsigned kHashBits = 15;
+    constexpr std::size_t kLiteralCodes = 286;
+    constexpr std::size_t kDistanceCodes = 30;
+    constexpr std::size_t kCodeLengthCodes = 19;
+    constexpr unsigned kMaxCodeBits = 15;
+    constexpr unsigned kMaxCodeLengthBits = 7;
+    constexpr unsigned kEndOfBlock = 256;
+
+    constexpr std::uint16_t kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr std::uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                               2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr std::uint16_t kDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                                 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                                 6145, 8193, 12289, 16385, 24577};
+    constexpr std::uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    constexpr std::uint8_t kCodeLengthOrder[kCodeLengthCodes] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+                                                                 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    struct CodeTables {
+        // Length code (0-based, add 257) for match lengths 0..258.
+        std::array<std::uint8_t, kMaxMatch + 1> lengthCode{};
+        // Distance code for distance - 1 below 256, then for (distance - 1) >> 7.
+        std::array<std::uint8_t, 512> distanceCode{};
+        std::array<std::uint32_t, 256> crc{};
+    };
+
+    const CodeTables& codeTables()
+    {
+        static const CodeTables tables = [] {
+            CodeTables t;
+            for (std::size_t code = 0; code < 29; ++code)
+            {
+                const std::size_t end = code + 1 < 29 ? kLengthBase[code + 1] : kMaxMatch + 1;
+                for (std::size_t length = kLengthBase[code]; length < end; ++length)
+                {
+                    t.lengthCode[length] = static_cast<std::uint8_t>(code);
+                }
+            }
+            for (std::size_t code = 0; code < kDistanceCodes; ++code)
+            {
+                const std::size_t first = kDistanceBase[code] - 1u;
+                const std::size_t count = std::size_t{1} << kDistanceExtra[code];
+                for (std::size_t d = first; d < first + count; ++d)
+                {
+                    if (d < 256)
+                    {
+                        t.distanceCode[d] = static_cast<std::uint8_t>(code);
+                    }
+                    else
+                    {
+                        t.distanceCode[256 + (d >> 7)] = static_cast<std::uint8_t>(code);
+                    }
+                }
+            }
+            for (std::uint32_t n = 0; n < 256; ++n)
+            {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                t.crc[n] = c;
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* data, std::size_t size)
+    {
+        const auto& table = codeTables().crc;
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    constexpr std::uint32_t kAdlerModulus = 65521;
+
+    std::uint32_t adler32(const std::uint8_t* data, std::size_t size)
+    {
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+        while (size > 0)
+        {
+            // The most bytes before b can overflow 32 bits.
+            const std::size_t chunk = std::min<std::size_t>(size, 5552);
+            for (std::size_t i = 0; i < chunk; ++i)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= kAdlerModulus;
+            b %= kAdlerModulus;
+            data += chunk;
+            size -= chunk;
+        }
+        return (b << 16) | a;
+    }
+
+    // The Adler-32 of A followed by B, from both checksums and B's length.
+    std::uint32_t combineAdler32(std::uint32_t first, std::uint32_t second, std::size_t secondLength)
+    {
+        const std::uint64_t remainder = secondLength % kAdlerModulus;
+        const std::uint64_t a1 = first & 0xffff;
+        const std::uint64_t b1 = first >> 16;
+        const std::uint64_t a2 = second & 0xffff;
+        const std::uint64_t b2 = second >> 16;
+        const std::uint64_t a = (a1 + a2 + kAdlerModulus - 1) % kAdlerModulus;
+        const std::uint64_t b = (b1 + b2 + remainder * a1 + kAdlerModulus - remainder) % kAdlerModulus;
+        return static_cast<std::uint32_t>((b << 16) | a);
+    }
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+        // Up to 32 bits, least significant first.
+        void put(std::uint32_t bits, unsigned count)
+        {
+            buffer_ |= static_cast<std::uint64_t>(bits) << count_;
+            count_ += count;
+            if (count_ >= 32)
+            {
+                const std::size_t size = out_.size();
+                out_.resize(size + 4);
+                for (std::size_t i = 0; i < 4; ++i)
+                {
+                    out_[size + i] = static_cast<std::uint8_t>(buffer_ >> (8 * i));
+                }
+                buffer_ >>= 32;
+                count_ -= 32;
+            }
+        }
+
+        // Pads to a byte boundary and writes out what is buffered.
+        void flush()
+        {
+            while (count_ > 0)
+            {
+                out_.push_back(static_cast<std::uint8_t>(buffer_));
+                buffer_ >>= 8;
+                count_ = count_ > 8 ? count_ - 8 : 0;
+            }
+            buffer_ = 0;
+        }
+
+    private:
+        std::vector<std::uint8_t>& out_;
+        std::uint64_t buffer_ = 0;
+        unsigned count_ = 0;
+    };
+
+    // A literal when distance is 0, else a match of `value` bytes.
+    struct Symbol {
+        std::uint16_t value;
+        std::uint16_t distance;
+    };
+
+    // Huffman code lengths of at most `maxBits` for `frequencies`; unused
+    // symbols get 0. Needs at least two used symbols.
+    void buildCodeLengths(const std::uint32_t* frequencies, std::size_t count, unsigned maxBits, std::uint8_t* lengths)
+    {
+        std::array<std::uint16_t, kLiteralCodes> order{};
+        std::size_t used = 0;
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            lengths[s] = 0;
+            if (frequencies[s] != 0)
+            {
+                order[used++] = static_cast<std::uint16_t>(s);
+            }
+        }
+        std::stable_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(used),
+                         [&](std::uint16_t a, std::uint16_t b) { return frequencies[a] < frequencies[b]; });
+
+        // Leaves come sorted and merged nodes are made in order of weight,
+        // so two queues replace a heap.
+        std::array<std::uint64_t, 2 * kLiteralCodes> weight{};
+        std::array<std::uint16_t, 2 * kLiteralCodes> parent{};
+        std::array<std::uint8_t, 2 * kLiteralCodes> depth{};
+        for (std::size_t i = 0; i < used; ++i)
+        {
+            weight[i] = frequencies[order[i]];
+        }
+        std::size_t nextLeaf = 0;
+        std::size_t nextNode = used;
+        for (std::size_t node = used; node < 2 * used - 1; ++node)
+        {
+            const auto take = [&]() {
+                if (nextLeaf < used && (nextNode >= node || weight[nextLeaf] <= weight[nextNode]))
+                {
+                    return nextLeaf++;
+                }
+                return nextNode++;
+            };
+            const std::size_t a = take();
+            const std::size_t b = take();
+            weight[node] = weight[a] + weight[b];
+            parent[a] = parent[b] = static_cast<std::uint16_t>(node);
+        }
+        std::array<std::uint32_t, 64> lengthCount{};
+        for (std::size_t node = 2 * used - 1; node-- > 0;)
+        {
+            depth[node] = node == 2 * used - 2 ? 0 : static_cast<std::uint8_t>(depth[parent[node]] + 1);
+            if (node < used)
+            {
+                ++lengthCount[std::min<std::size_t>(depth[node], 63)];
+            }
+        }
+
+        // Too deep: clamp to maxBits, then restore the Kraft sum by splitting
+        // shorter codes, one unit of excess per step.
+        for (std::size_t bits = maxBits + 1; bits < lengthCount.size(); ++bits)
+        {
+            lengthCount[maxBits] += lengthCount[bits];
+            lengthCount[bits] = 0;
+        }
+        std::uint64_t kraft = 0;
+        for (unsigned bits = 1; bits <= maxBits; ++bits)
+        {
+            kraft += static_cast<std::uint64_t>(lengthCount[bits]) << (maxBits - bits);
+        }
+        while (kraft > (std::uint64_t{1} << maxBits))
+        {
+            --lengthCount[maxBits];
+            for (unsigned bits = maxBits - 1; bits > 0; --bits)
+            {
+                if (lengthCount[bits] != 0)
+                {
+                    --lengthCount[bits];
+                    lengthCount[bits + 1] += 2;
+                    break;
+                }
+            }
+            --kraft;
+        }
+
+        // The rarest symbols take the longest codes.
+        std::size_t next = 0;
+        for (unsigned bits = maxBits; bits > 0; --bits)
+        {
+            for (std::uint32_t i = 0; i < lengthCount[bits]; ++i)
+            {
+                lengths[order[next++]] = static_cast<std::uint8_t>(bits);
+            }
+        }
+    }
+
+    std::uint16_t reverseBits(std::uint32_t value, unsigned bits)
+    {
+        std::uint32_t reversed = 0;
+        for (unsigned i = 0; i < bits; ++i)
+        {
+            reversed = (reversed << 1) | ((value >> i) & 1);
+        }
+        return static_cast<std::uint16_t>(reversed);
+    }
+
+    // Canonical codes for `lengths`, bit-reversed for the LSB-first writer.
+    void buildCodes(const std::uint8_t* lengths, std::size_t count, std::uint16_t* codes)
+    {
+        std::array<std::uint16_t, kMaxCodeBits + 2> lengthCount{};
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            ++lengthCount[lengths[s]];
+        }
+        lengthCount[0] = 0;
+        std::array<std::uint16_t, kMaxCodeBits + 2> nextCode{};
+        std::uint32_t code = 0;
+        for (unsigned bits = 1; bits <= kMaxCodeBits; ++bits)
+        {
+            code = (code + lengthCount[bits - 1]) << 1;
+            nextCode[bits] = static_cast<std::uint16_t>(code);
+        }
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            const unsigned bits = lengths[s];
+            if (bits == 0)
+            {
+                codes[s] = 0;
+                continue;
+            }
+            const std::uint32_t value = nextCode[bits]++;
+            codes[s] = reverseBits(value, bits);
+        }
+    }
+
+    // At least two used symbols, so every code is complete.
+    void ensureTwoSymbols(std::uint32_t* frequencies, std::size_t count)
+    {
+        std::size_t used = 0;
+        for (std::size_t s = 0; s < count && used < 2; ++s)
+        {
+            used += frequencies[s] != 0 ? 1 : 0;
+        }
+        for (std::size_t s = 0; used < 2; ++s)
+        {
+            if (frequencies[s] == 0)
+            {
+                frequencies[s] = 1;
+                ++used;
+            }
+        }
+    }
+
+    void writeDynamicBlock(BitWriter& writer, const Symbol* symbols, std::size_t count, bool final)
+    {
+        const CodeTables& tables = codeTables();
+        std::array<std::uint32_t, kLiteralCodes> literalFrequencies{};
+        std::array<std::uint32_t, kDistanceCodes> distanceFrequencies{};
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Symbol symbol = symbols[i];
+            if (symbol.distance == 0)
+            {
+                ++literalFrequencies[symbol.value];
+                continue;
+            }
+            ++literalFrequencies[257 + tables.lengthCode[symbol.value]];
+            const std::size_t d = symbol.distance - 1u;
+            ++distanceFrequencies[d < 256 ? tables.distanceCode[d] : tables.distanceCode[256 + (d >> 7)]];
+        }
+        literalFrequencies[kEndOfBlock] = 1;
+        ensureTwoSymbols(distanceFrequencies.data(), kDistanceCodes);
+
+        std::array<std::uint8_t, kLiteralCodes + kDistanceCodes> lengths{};
+        std::uint8_t* literalLengths = lengths.data();
+        buildCodeLengths(literalFrequencies.data(), kLiteralCodes, kMaxCodeBits, literalLengths);
+        std::size_t literalCount = kLiteralCodes;
+        while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+        {
+            --literalCount;
+        }
+        std::uint8_t* distanceLengths = lengths.data() + literalCount;
+        buildCodeLengths(distanceFrequencies.data(), kDistanceCodes, kMaxCodeBits, distanceLengths);
+        std::size_t distanceCount = kDistanceCodes;
+        while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+        {
+            --distanceCount;
+        }
+
+        // Both length lists as one run-length coded sequence: 16 repeats the
+        // previous length 3-6 times, 17 and 18 write 3-10 and 11-138 zeros.
+        struct LengthSymbol {
+            std::uint8_t code;
+            std::uint8_t extra;
+        };
+        std::array<LengthSymbol, kLiteralCodes + kDistanceCodes> runs{};
+        std::size_t runCount = 0;
+        std::array<std::uint32_t, kCodeLengthCodes> lengthFrequencies{};
+        const std::size_t total = literalCount + distanceCount;
+        for (std::size_t i = 0; i < total;)
+        {
+            const std::uint8_t value = lengths[i];
+            std::size_t repeat = 1;
+            while (i + repeat < total && lengths[i + repeat] == value)
+            {
+                ++repeat;
+            }
+            std::size_t left = repeat;
+            if (value == 0)
+            {
+                while (left >= 11)
+                {
+                    const std::size_t n = std::min<std::size_t>(left, 138);
+                    runs[runCount++] = {18, static_cast<std::uint8_t>(n - 11)};
+                    left -= n;
+                }
+                if (left >= 3)
+                {
+                    runs[runCount++] = {17, static_cast<std::uint8_t>(left - 3)};
+                    left = 0;
+                }
+            }
+            else if (left >= 4)
+            {
+                runs[runCount++] = {value, 0};
+                --left;
+                while (left >= 3)
+                {
+                    const std::size_t n = std::min<std::size_t>(left, 6);
+                    runs[runCount++] = {16, static_cast<std::uint8_t>(n - 3)};
+                    left -= n;
+                }
+            }
+            while (left-- > 0)
+            {
+                runs[runCount++] = {value, 0};
+            }
+            i += repeat;
+        }
+        for (std::size_t i = 0; i < runCount; ++i)
+        {
+            ++lengthFrequencies[runs[i].code];
+        }
+        ensureTwoSymbols(lengthFrequencies.data(), kCodeLengthCodes);
+        std::array<std::uint8_t, kCodeLengthCodes> codeLengthLengths{};
+        buildCodeLengths(lengthFrequencies.data(), kCodeLengthCodes, kMaxCodeLengthBits, codeLengthLengths.data());
+        std::array<std::uint16_t, kCodeLengthCodes> codeLengthCodes{};
+        buildCodes(codeLengthLengths.data(), kCodeLengthCodes, codeLengthCodes.data());
+        std::size_t orderCount = kCodeLengthCodes;
+        while (orderCount > 4 && codeLengthLengths[kCodeLengthOrder[orderCount - 1]] == 0)
+        {
+            --orderCount;
+        }
+
+        std::array<std::uint16_t, kLiteralCodes> literalCodes{};
+        std::array<std::uint16_t, kDistanceCodes> distanceCodes{};
+        buildCodes(literalLengths, literalCount, literalCodes.data());
+        buildCodes(distanceLengths, distanceCount, distanceCodes.data());
+
+        writer.put(final ? 1u : 0u, 1);
+        writer.put(2, 2);
+        writer.put(static_cast<std::uint32_t>(literalCount - 257), 5);
+        writer.put(static_cast<std::uint32_t>(distanceCount - 1), 5);
+        writer.put(static_cast<std::uint32_t>(orderCount - 4), 4);
+        for (std::size_t i = 0; i < orderCount; ++i)
+        {
+            writer.put(codeLengthLengths[kCodeLengthOrder[i]], 3);
+        }
+        static constexpr unsigned kRunExtraBits[3] = {2, 3, 7};
+        for (std::size_t i = 0; i < runCount; ++i)
+        {
+            const LengthSymbol run = runs[i];
+            writer.put(codeLengthCodes[run.code], codeLengthLengths[run.code]);
+            if (run.code >= 16)
+            {
+                writer.put(run.extra, kRunExtraBits[run.code - 16]);
+            }
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Symbol symbol = symbols[i];
+            if (symbol.distance == 0)
+            {
+                writer.put(literalCodes[symbol.value], literalLengths[symbol.value]);
+                continue;
+            }
+            const std::size_t lengthCode = tables.lengthCode[symbol.value];
+            writer.put(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+            writer.put(symbol.value - kLengthBase[lengthCode], kLengthExtra[lengthCode]);
+            const std::size_t d = symbol.distance - 1u;
+            const std::size_t distanceCode = d < 256 ? tables.distanceCode[d] : tables.distanceCode[256 + (d >> 7)];
+            writer.put(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+            writer.put(static_cast<std::uint32_t>(symbol.distance - kDistanceBase[distanceCode]), kDistanceExtra[distanceCode]);
+        }
+        writer.put(literalCodes[kEndOfBlock], literalLengths[kEndOfBlock]);
+    }
+
+    std::size_t matchLength(const std::uint8_t* a, const std::uint8_t* b, std::size_t limit)
+    {
+        std::size_t length = 0;
+        while (length + 8 <= limit)
+        {
+            std::uint64_t x;
+            std::uint64_t y;
+            std::memcpy(&x, a + length, 8);
+            std::memcpy(&y, b + length, 8);
+            if (x != y)
+            {
+                return length + static_cast<std::size_t>(std::countr_zero(x ^ y) >> 3);
+            }
+            length += 8;
+        }
+        while (length < limit && a[length] == b[length])
+        {
+            ++length;
+        }
+        return length;
+    }
+
+    // Greedy LZ77 over `data` into `symbols`.
+    void findMatches(const std::uint8_t* data, std::size_t size, std::vector<std::int32_t>& head, std::vector<Symbol>& symbols)
+    {
+        head.assign(std::size_t{1} << kHashBits, -1);
+        symbols.clear();
+        std::size_t i = 0;
+        while (i + kMinMatch <= size)
+        {
+            const std::uint32_t key = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+            const std::uint32_t hash = (key * 2654435761u) >> (32 - kHashBits);
+            const std::int32_t candidate = head[hash];
+            head[hash] = static_cast<std::int32_t>(i);
+            if (candidate >= 0 && i - static_cast<std::size_t>(candidate) <= kWindowSize)
+            {
+                const std::size_t length = matchLength(data + i, data + candidate, std::min(kMaxMatch, size - i));
+                if (length >= kMinMatch)
+                {
+                    symbols.push_back({static_cast<std::uint16_t>(length), static_cast<std::uint16_t>(i - static_cast<std::size_t>(candidate))});
+                    i += length;
+                    continue;
+                }
+            }
+            symbols.push_back({data[i], 0});
+            ++i;
+        }
+        for (; i < size; ++i)
+        {
+            symbols.push_back({data[i], 0});
+        }
+    }
+
+    constexpr std::size_t kPixelBytes = 3;
+
+    int paeth(int a, int b, int c)
+    {
+        const int pa = std::abs(b - c);
+        const int pb = std::abs(a - c);
+        const int pc = std::abs(a + b - 2 * c);
+        const int bc = pb <= pc ? b : c;
+        return pa <= pb && pa <= pc ? a : bc;
+    }
+
+    void bgraToRgb(std::uint8_t* dst, const std::uint8_t* src, std::uint32_t width)
+    {
+        for (std::uint32_t x = 0; x < width; ++x)
+        {
+            dst[x * 3] = src[x * 4 + 2];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4];
+        }
+    }
+
+    // Writes the filter byte and filtered bytes of `row` (RGB) to `dst`.
+    // `row` and `above` (the previous row, or zeros) are readable, as zeros,
+    // kPixelBytes before their start, so the first pixel needs no branch.
+    void filterRow(std::uint8_t* dst, const std::uint8_t* row, const std::uint8_t* above, std::size_t bytes)
+    {
+        std::uint32_t cost[5] = {};
+        for (std::size_t i = 0; i < bytes; ++i)
+        {
+            const int value = row[i];
+            const int left = row[i - kPixelBytes];
+            const int up = above[i];
+            const int upLeft = above[i - kPixelBytes];
+            cost[0] += static_cast<std::uint32_t>(std::abs(static_cast<std::int8_t>(value)));
+            cost[1] += static_cast<std::uint32_t>(std::abs(static_cast<std::int8_t>(value - left)));
+            cost[2] += static_cast<std::uint32_t>(std::abs(static_cast<std::int8_t>(value - up)));
+            cost[3] += static_cast<std::uint32_t>(std::abs(static_cast<std::int8_t>(value - ((left + up) >> 1))));
+            cost[4] += static_cast<std::uint32_t>(std::abs(static_cast<std::int8_t>(value - paeth(left, up, upLeft))));
+        }
+        const std::size_t best = static_cast<std::size_t>(std::min_element(cost, cost + 5) - cost);
+
+        dst[0] = static_cast<std::uint8_t>(best);
+        std::uint8_t* out = dst + 1;
+        switch (best)
+        {
+        case 0:
+            std::memcpy(out, row, bytes);
+            break;
+        case 1:
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                out[i] = static_cast<std::uint8_t>(row[i] - row[i - kPixelBytes]);
+            }
+            break;
+        case 2:
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                out[i] = static_cast<std::uint8_t>(row[i] - above[i]);
+            }
+            break;
+        case 3:
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                out[i] = static_cast<std::uint8_t>(row[i] - ((row[i - kPixelBytes] + above[i]) >> 1));
+            }
+            break;
+        default:
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                out[i] = static_cast<std::uint8_t>(row[i] - paeth(row[i - kPixelBytes], above[i], above[i - kPixelBytes]));
+            }
+            break;
+        }
+    }
+
+    struct PngBand {
+        std::vector<std::uint8_t> compressed;
+        std::uint32_t adler = 1;
+        std::size_t filteredBytes = 0;
+    };
+
+    void encodePngBand(PngBand& band,
+                       const std::uint8_t* bgra,
+                       std::size_t pitch,
+                       std::uint32_t width,
+                       std::uint32_t firstRow,
+                       std::uint32_t rows,
+                       bool first,
+                       bool last)
+    {
+        const std::size_t rowBytes = static_cast<std::size_t>(width) * 3;
+        std::vector<std::uint8_t> filtered((rowBytes + 1) * rows);
+        std::vector<std::uint8_t> work(2 * (kPixelBytes + rowBytes), 0);
+        std::uint8_t* above = work.data() + kPixelBytes;
+        std::uint8_t* row = above + rowBytes + kPixelBytes;
+        if (firstRow > 0)
+        {
+            bgraToRgb(above, bgra + (firstRow - 1) * pitch, width);
+        }
+        for (std::uint32_t y = 0; y < rows; ++y)
+        {
+            bgraToRgb(row, bgra + (firstRow + y) * pitch, width);
+            filterRow(filtered.data() + y * (rowBytes + 1), row, above, rowBytes);
+            std::swap(above, row);
+        }
+        band.filteredBytes = filtered.size();
+        band.adler = adler32(filtered.data(), filtered.size());
+
+        std::vector<std::int32_t> head;
+        std::vector<Symbol> symbols;
+        findMatches(filtered.data(), filtered.size(), head, symbols);
+
+        band.compressed.clear();
+        band.compressed.reserve(filtered.size() / 4 + 64);
+        if (first)
+        {
+            // zlib header: deflate, 32K window, fastest level.
+            band.compressed.push_back(0x78);
+            band.compressed.push_back(0x01);
+        }
+        BitWriter writer(band.compressed);
+        for (std::size_t start = 0; start < symbols.size(); start += kDeflateBlockSymbols)
+        {
+            const std::size_t count = std::min(kDeflateBlockSymbols, symbols.size() - start);
+            writeDynamicBlock(writer, symbols.data() + start, count, last && start + count == symbols.size());
+        }
+        if (!last)
+        {
+            // An empty stored block ends the band on a byte boundary, so the
+            // next band's blocks can simply follow.
+            writer.put(0, 3);
+            writer.flush();
+            const std::uint8_t stored[4] = {0x00, 0x00, 0xff, 0xff};
+            band.compressed.insert(band.compressed.end(), stored, stored + 4);
+        }
+        writer.flush();
+    }
+
+    void appendChunk(std::vector<std::uint8_t>& out, const char* type, const std::uint8_t* data, std::size_t size)
+    {
+        const std::size_t offset = out.size();
+        out.resize(offset + 12 + size);
+        std::uint8_t* chunk = out.data() + offset;
+        putBigEndian32(chunk, static_cast<std::uint32_t>(size));
+        std::memcpy(chunk + 4, type, 4);
+        if (size > 0)
+        {
+            std::memcpy(chunk + 8, data, size);
+        }
+        putBigEndian32(chunk + 8 + size, crc32(0, chunk + 4, size + 4));
+    }
+}
+
+void encodeQoi(const std::uint8_t* bgra,
+               std::size_t pitch,
+               std::uint32_t width,
+               std::uint32_t height,
+               std::vector<std::uint8_t>& out)
+{
+    // Worst case: every pixel an RGB op.
+    out.resize(kQoiHeaderBytes + static_cast<std::size_t>(width) * height * 4 + sizeof(kQoiEnd));
+    std::uint8_t* p = out.data();
+    std::memcpy(p, "qoif", 4);
+    putBigEndian32(p + 4, width);
+    putBigEndian32(p + 8, height);
+    p[12] = 3;
+    p[13] = 0;
+    p += kQoiHeaderBytes;
+
+    // Pixels as r | g << 8 | b << 16 | a << 24, alpha always opaque.
+    std::array<std::uint32_t, 64> index{};
+    std::uint32_t previous = 0xff000000u;
+    unsigned run = 0;
+    for (std::uint32_t y = 0; y < height; ++y)
+    {
+        const std::uint8_t* row = bgra + y * pitch;
+        for (std::uint32_t x = 0; x < width; ++x)
+        {
+            const std::uint32_t b = row[x * 4];
+            const std::uint32_t g = row[x * 4 + 1];
+            const std::uint32_t r = row[x * 4 + 2];
+            const std::uint32_t pixel = r | (g << 8) | (b << 16) | 0xff000000u;
+            if (pixel == previous)
+            {
+                if (++run == 62)
+                {
+                    *p++ = static_cast<std::uint8_t>(kQoiOpRun | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                *p++ = static_cast<std::uint8_t>(kQoiOpRun | (run - 1));
+                run = 0;
+            }
+
+            const std::uint32_t slot = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            if (index[slot] == pixel)
+            {
+                *p++ = static_cast<std::uint8_t>(kQoiOpIndex | slot);
+            }
+            else
+            {
+                index[slot] = pixel;
+                const int dr = static_cast<std::int8_t>(r - (previous & 0xff));
+                const int dg = static_cast<std::int8_t>(g - ((previous >> 8) & 0xff));
+                const int db = static_cast<std::int8_t>(b - ((previous >> 16) & 0xff));
+                const int drg = dr - dg;
+                const int dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                {
+                    *p++ = static_cast<std::uint8_t>(kQoiOpDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                }
+                else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+                {
+                    *p++ = static_cast<std::uint8_t>(kQoiOpLuma | (dg + 32));
+                    *p++ = static_cast<std::uint8_t>(((drg + 8) << 4) | (dbg + 8));
+                }
+                else
+                {
+                    *p++ = kQoiOpRgb;
+                    *p++ = static_cast<std::uint8_t>(r);
+                    *p++ = static_cast<std::uint8_t>(g);
+                    *p++ = static_cast<std::uint8_t>(b);
+                }
+            }
+            previous = pixel;
+        }
+    }
+    if (run > 0)
+    {
+        *p++ = static_cast<std::uint8_t>(kQoiOpRun | (run - 1));
+    }
+    std::memcpy(p, kQoiEnd, sizeof(kQoiEnd));
+    p += sizeof(kQoiEnd);
+    out.resize(static_cast<std::size_t>(p - out.data()));
+}
+
+void encodePng(const std::uint8_t* bgra,
+               std::size_t pitch,
+               std::uint32_t width,
+               std::uint32_t height,
+               std::vector<std::uint8_t>& out,
+               StripeWorkerPool* workers)
+{
+    const std::size_t bandCount = height == 0 ? 0 : (height + kPngBandRows - 1) / kPngBandRows;
+    std::vector<PngBand> bands(bandCount);
+    const auto encodeBand = [&](std::size_t index) {
+        const auto firstRow = static_cast<std::uint32_t>(index * kPngBandRows);
+        encodePngBand(bands[index], bgra, pitch, width, firstRow, std::min(kPngBandRows, height - firstRow),
+                      index == 0, index + 1 == bandCount);
+    };
+    if (workers && bandCount > 1)
+    {
+        workers->run(bandCount, encodeBand);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < bandCount; ++i)
+        {
+            encodeBand(i);
+        }
+    }
+
+    static constexpr std::uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.assign(kSignature, kSignature + sizeof(kSignature));
+    std::uint8_t header[13];
+    putBigEndian32(header, width);
+    putBigEndian32(header + 4, height);
+    header[8] = 8;  // bits per channel
+    header[9] = 2;  // RGB
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // not interlaced
+    appendChunk(out, "IHDR", header, sizeof(header));
+
+    std::uint32_t adler = 1;
+    for (std::size_t i = 0; i < bandCount; ++i)
+    {
+        PngBand& band = bands[i];
+        adler = i == 0 ? band.adler : combineAdler32(adler, band.adler, band.filteredBytes);
+        if (i + 1 == bandCount)
+        {
+            std::uint8_t trailer[4];
+            putBigEndian32(trailer, adler);
+            band.compressed.insert(band.compressed.end(), trailer, trailer + 4);
+        }
+        appendChunk(out, "IDAT", band.compressed.data(), band.compressed.size());
+    }
+    appendChunk(out, "IEND", nullptr, 0);
+}
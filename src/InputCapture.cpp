@@ -34,6 +34,7 @@ namespace
     }
 
     constexpr UINT kMenuHotkeyVirtualKey = 'M';
+    constexpr UINT kScreenshotHotkeyVirtualKey = 'S';
 
     bool isMenuModifierKey(UINT vk)
     {
@@ -81,6 +82,7 @@ void InputCaptureManager::setEnabled(bool enabled)
         keyboardOverflow_ = false;
         hasLastMousePoint_ = false;
         menuChordLatched_ = false;
+        screenshotChordLatched_ = false;
         skipNextRelativeEvent_ = false;
         menuChordEnabled_.store(false, std::memory_order_release);
         installHooks();
@@ -91,6 +93,7 @@ void InputCaptureManager::setEnabled(bool enabled)
         stopRelativeCapture(false);
         removeHooks();
         menuChordLatched_ = false;
+        screenshotChordLatched_ = false;
         skipNextRelativeEvent_ = false;
         menuChordEnabled_.store(false, std::memory_order_release);
         requestCursorClip(false);
@@ -468,6 +471,26 @@ void InputCaptureManager::handleKeyboardEvent(WPARAM wParam, const KBDLLHOOKSTRU
     const bool menuChord = chordEnabled && ctrlActive && altActive;
     const bool isMenuKey = chordEnabled && (vk == kMenuHotkeyVirtualKey);
 
+    // Ctrl+Alt+S while the remote has the keyboard; the window's own hotkey
+    // never sees it then.
+    if (chordEnabled && vk == kScreenshotHotkeyVirtualKey && (screenshotChordLatched_ || menuChord))
+    {
+        if (keyDown && !screenshotChordLatched_)
+        {
+            screenshotChordLatched_ = true;
+            HWND target = targetWindow_.load(std::memory_order_acquire);
+            if (target)
+            {
+                PostMessage(target, WM_INPUT_CAPTURE_SCREENSHOT, 0, 0);
+            }
+        }
+        else if (keyUp)
+        {
+            screenshotChordLatched_ = false;
+        }
+        return;
+    }
+
     if (isMenuKey)
     {
         if (menuChord && keyDown)
@@ -776,6 +799,7 @@ void InputCaptureManager::resetKeyboardState()
     leftCtrl_ = rightCtrl_ = leftShift_ = rightShift_ = false;
     leftAlt_ = rightAlt_ = leftWin_ = rightWin_ = false;
     menuChordLatched_ = false;
+    screenshotChordLatched_ = false;
     skipNextRelativeEvent_ = false;
     leftButtonDown_ = rightButtonDown_ = middleButtonDown_ = false;
     xButton1Down_ = xButton2Down_ = false;
@@ -790,6 +814,7 @@ void InputCaptureManager::clearModifierState()
     leftCtrl_ = rightCtrl_ = leftShift_ = rightShift_ = false;
     leftAlt_ = rightAlt_ = leftWin_ = rightWin_ = false;
     menuChordLatched_ = false;
+    screenshotChordLatched_ = false;
     leftButtonDown_ = rightButtonDown_ = middleButtonDown_ = false;
     xButton1Down_ = xButton2Down_ = false;
     sendKeyboardReport();
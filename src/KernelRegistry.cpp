@@ -0,0 +1,668 @@
+#include "KernelRegistry.hpp"
+#include "AudioKernels.hpp"
+#include "CopyKernels.hpp"
+#include "Downscale.hpp"
+#include "PixelConversion.hpp"
+#include "ScalingFilter.hpp"
+#include "ToneMapping.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_REGISTRY_X86 1
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#else
+#define PCKVM_REGISTRY_X86 0
+#endif
+
+namespace
+{
+    CpuFeatures detectCpuFeatures()
+    {
+        CpuFeatures features;
+#if PCKVM_REGISTRY_X86
+#if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        features.ssse3 = (info[2] & (1 << 9)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || maxLeaf < 7)
+        {
+            return features;
+        }
+        const unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        // The OS has to save YMM (and for AVX-512 also opmask/ZMM) state.
+        features.avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        features.avx512f = (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+#else
+        __builtin_cpu_init();
+        features.ssse3 = __builtin_cpu_supports("ssse3");
+        features.avx2 = __builtin_cpu_supports("avx2");
+        features.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+#endif
+        return features;
+    }
+
+    constexpr std::pair<SimdLevel, const char*> kLevelNames[] = {
+        {SimdLevel::Scalar, "scalar"},
+        {SimdLevel::SSE2, "sse2"},
+        {SimdLevel::SSSE3, "ssse3"},
+        {SimdLevel::AVX2, "avx2"},
+        {SimdLevel::AVX512, "avx512"},
+    };
+
+    // Deterministic input, so a failing tier fails the same way every launch.
+    class TestData {
+    public:
+        std::uint32_t next()
+        {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 17;
+            state_ ^= state_ << 5;
+            return state_;
+        }
+
+        void fill(std::uint8_t* data, std::size_t bytes)
+        {
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                data[i] = static_cast<std::uint8_t>(next() >> 24);
+            }
+        }
+
+    private:
+        std::uint32_t state_ = 0x9E3779B9u;
+    };
+
+    enum class TestResult {
+        Unavailable,
+        Passed,
+        Failed,
+    };
+
+    // Row lengths that cover empty rows, every SIMD tail and several full
+    // vector iterations. Packed and semi-planar rows may end mid pair.
+    constexpr std::size_t kTestPixels[] = {0, 1, 2, 7, 15, 16, 17, 31, 33, 64, 129, 261};
+    // Output slack past the row that no kernel may touch.
+    constexpr std::size_t kGuardBytes = 64;
+    constexpr std::uint8_t kGuardValue = 0xA5;
+
+    struct OutputPair {
+        std::array<std::uint8_t, 261 * 4 + kGuardBytes> reference;
+        std::array<std::uint8_t, 261 * 4 + kGuardBytes> candidate;
+
+        void reset()
+        {
+            reference.fill(kGuardValue);
+            candidate.fill(kGuardValue);
+        }
+        [[nodiscard]] bool matches() const { return reference == candidate; }
+    };
+
+    TestResult testCopy(CopyKernelTier tier)
+    {
+        RowCopyFn kernel = copyKernelFor(tier);
+        if (!kernel)
+        {
+            return TestResult::Unavailable;
+        }
+        TestData random;
+        std::array<std::uint8_t, 8192> source{};
+        random.fill(source.data(), source.size());
+        std::array<std::uint8_t, 8192 + kGuardBytes> destination{};
+        // Sizes around the streaming threshold, with source and destination
+        // at different alignments.
+        for (std::size_t bytes : {0u, 1u, 63u, 255u, 256u, 257u, 1000u, 4096u, 8000u})
+        {
+            for (std::size_t offset : {0u, 1u, 17u, 63u})
+            {
+                const std::uint8_t* src = source.data() + (offset * 7) % 64;
+                destination.fill(kGuardValue);
+                kernel(destination.data() + offset, src, bytes);
+                streamCopyFence();
+                if (std::memcmp(destination.data() + offset, src, bytes) != 0)
+                {
+                    return TestResult::Failed;
+                }
+                for (std::size_t i = 0; i < destination.size(); ++i)
+                {
+                    if ((i < offset || i >= offset + bytes) && destination[i] != kGuardValue)
+                    {
+                        return TestResult::Failed;
+                    }
+                }
+            }
+        }
+        return TestResult::Passed;
+    }
+
+    TestResult testConversion(ConversionTier tier)
+    {
+        using PixelFormat = CaptureSource::PixelFormat;
+        const YuvCoefficients coefficientSets[] = {
+            yuvCoefficients(CaptureSource::ColorMatrix::BT601, false),
+            yuvCoefficients(CaptureSource::ColorMatrix::BT2020, true),
+        };
+        TestData random;
+        // Room for the longest row of 16-bit samples, rounded up to a pair.
+        std::array<std::uint8_t, 262 * 4> luma{};
+        std::array<std::uint8_t, 262 * 4> chroma{};
+        OutputPair output;
+
+        for (PixelFormat format : {PixelFormat::YUY2, PixelFormat::UYVY})
+        {
+            Packed422RowFn reference = packed422Kernel(format, ConversionTier::Scalar);
+            Packed422RowFn candidate = packed422Kernel(format, tier);
+            if (!candidate)
+            {
+                return TestResult::Unavailable;
+            }
+            for (const YuvCoefficients& coefficients : coefficientSets)
+            {
+                for (std::size_t pixels : kTestPixels)
+                {
+                    random.fill(luma.data(), luma.size());
+                    output.reset();
+                    reference(output.reference.data(), luma.data(), pixels, coefficients);
+                    candidate(output.candidate.data(), luma.data(), pixels, coefficients);
+                    if (!output.matches())
+                    {
+                        return TestResult::Failed;
+                    }
+                }
+            }
+        }
+
+        for (PixelFormat format : {PixelFormat::NV12, PixelFormat::P010})
+        {
+            SemiPlanarRowFn reference = semiPlanarKernel(format, ConversionTier::Scalar);
+            SemiPlanarRowFn candidate = semiPlanarKernel(format, tier);
+            if (!candidate)
+            {
+                return TestResult::Unavailable;
+            }
+            for (const YuvCoefficients& coefficients : coefficientSets)
+            {
+                for (std::size_t pixels : kTestPixels)
+                {
+                    random.fill(luma.data(), luma.size());
+                    random.fill(chroma.data(), chroma.size());
+                    output.reset();
+                    reference(output.reference.data(), luma.data(), chroma.data(), pixels, coefficients);
+                    candidate(output.candidate.data(), luma.data(), chroma.data(), pixels, coefficients);
+                    if (!output.matches())
+                    {
+                        return TestResult::Failed;
+                    }
+                }
+            }
+        }
+
+        for (PixelFormat format : {PixelFormat::RGB24, PixelFormat::RGB565})
+        {
+            PackedRgbRowFn reference = packedRgbKernel(format, ConversionTier::Scalar);
+            PackedRgbRowFn candidate = packedRgbKernel(format, tier);
+            if (!candidate)
+            {
+                return TestResult::Unavailable;
+            }
+            for (std::size_t pixels : kTestPixels)
+            {
+                random.fill(luma.data(), luma.size());
+                output.reset();
+                reference(output.reference.data(), luma.data(), pixels);
+                candidate(output.candidate.data(), luma.data(), pixels);
+                if (!output.matches())
+                {
+                    return TestResult::Failed;
+                }
+            }
+        }
+
+        V210RowFn reference = v210Kernel(ConversionTier::Scalar);
+        V210RowFn candidate = v210Kernel(tier);
+        if (!candidate)
+        {
+            return TestResult::Unavailable;
+        }
+        for (const YuvCoefficients& coefficients : coefficientSets)
+        {
+            for (std::size_t pixels : kTestPixels)
+            {
+                // Random bits include the unused top two of every word.
+                random.fill(luma.data(), luma.size());
+                output.reset();
+                reference(output.reference.data(), luma.data(), pixels, coefficients);
+                candidate(output.candidate.data(), luma.data(), pixels, coefficients);
+                if (!output.matches())
+                {
+                    return TestResult::Failed;
+                }
+            }
+        }
+        return TestResult::Passed;
+    }
+
+    TestResult testToneMap(ConversionTier tier)
+    {
+        const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT2020, false);
+        TestData random;
+        std::array<std::uint8_t, 262 * 2> luma{};
+        std::array<std::uint8_t, 262 * 2> chroma{};
+        OutputPair output;
+        for (ToneMapCurve curve : {ToneMapCurve::Reinhard, ToneMapCurve::Hable})
+        {
+            ToneMapParams params;
+            params.curve = curve;
+            const ToneMapper mapper(params);
+            for (std::size_t pixels : kTestPixels)
+            {
+                random.fill(luma.data(), luma.size());
+                random.fill(chroma.data(), chroma.size());
+                output.reset();
+                mapper.convertRowWith(ConversionTier::Scalar, output.reference.data(), luma.data(), chroma.data(), pixels, coefficients);
+                if (!mapper.convertRowWith(tier, output.candidate.data(), luma.data(), chroma.data(), pixels, coefficients))
+                {
+                    return TestResult::Unavailable;
+                }
+                if (!output.matches())
+                {
+                    return TestResult::Failed;
+                }
+            }
+        }
+        return TestResult::Passed;
+    }
+
+    TestResult testDownscale(DownscaleTier tier)
+    {
+        if (!downscaleKernels(tier))
+        {
+            return TestResult::Unavailable;
+        }
+        struct Case {
+            std::uint32_t sourceWidth, sourceHeight, outputWidth, outputHeight;
+            DirtyRect region;
+            std::uint32_t alignment;
+        };
+        // Both box filters, fractional and near-integer ratios, regions that
+        // do not start at the origin and spans too short for a vector.
+        const Case cases[] = {
+            {262, 8, 131, 4, {0, 0, 131, 4}, 1},
+            {264, 8, 66, 2, {0, 0, 66, 2}, 1},
+            {264, 12, 66, 3, {1, 1, 65, 3}, 2},
+            {261, 9, 100, 4, {0, 0, 100, 4}, 1},
+            {261, 9, 100, 4, {33, 1, 97, 3}, 2},
+            {261, 16, 37, 3, {0, 0, 37, 3}, 1},
+            {255, 11, 170, 7, {5, 2, 9, 7}, 2},
+            {33, 5, 17, 3, {0, 0, 17, 3}, 1},
+        };
+        TestData random;
+        std::vector<std::uint8_t> source(264 * 16 * 4);
+        random.fill(source.data(), source.size());
+        std::vector<std::uint8_t> reference;
+        std::vector<std::uint8_t> candidate;
+        DownscaleScratch scratch;
+        for (const Case& test : cases)
+        {
+            const AreaScaler scaler(test.sourceWidth, test.sourceHeight, test.outputWidth, test.outputHeight);
+            const std::size_t pitch = static_cast<std::size_t>(test.outputWidth) * 4 + kGuardBytes;
+            const AreaScaler::SourceRowFn sourceRow = [&](std::uint32_t row, std::uint32_t firstColumn, std::uint32_t columns, std::uint8_t* scratchRow) {
+                std::memcpy(scratchRow, source.data() + (static_cast<std::size_t>(row) * test.sourceWidth + firstColumn) * 4, static_cast<std::size_t>(columns) * 4);
+                return static_cast<const std::uint8_t*>(scratchRow);
+            };
+            reference.assign(pitch * test.outputHeight, kGuardValue);
+            candidate.assign(pitch * test.outputHeight, kGuardValue);
+            scaler.scaleRegionWith(DownscaleTier::Scalar, reference.data(), pitch, test.region, test.alignment, sourceRow, scratch);
+            scaler.scaleRegionWith(tier, candidate.data(), pitch, test.region, test.alignment, sourceRow, scratch);
+            if (reference != candidate)
+            {
+                return TestResult::Failed;
+            }
+        }
+        return TestResult::Passed;
+    }
+
+    TestResult testScaling(ScalingTier tier)
+    {
+        if (!scalingKernels(tier))
+        {
+            return TestResult::Unavailable;
+        }
+        struct Case {
+            ScalingFilter filter;
+            std::uint32_t sourceWidth, sourceHeight, outputWidth, outputHeight;
+            DirtyRect region;
+        };
+        // Up and down, sources narrower than the filter, regions that do not
+        // start at the origin and spans too short for a vector.
+        const Case cases[] = {
+            {ScalingFilter::Nearest, 37, 9, 131, 20, {0, 0, 131, 20}},
+            {ScalingFilter::Nearest, 37, 9, 30, 7, {3, 1, 29, 7}},
+            {ScalingFilter::Bicubic, 37, 9, 64, 16, {0, 0, 64, 16}},
+            {ScalingFilter::Bicubic, 37, 9, 30, 7, {5, 2, 8, 7}},
+            {ScalingFilter::Bicubic, 3, 2, 17, 5, {0, 0, 17, 5}},
+            {ScalingFilter::Lanczos3, 37, 9, 100, 20, {0, 0, 100, 20}},
+            {ScalingFilter::Lanczos3, 37, 9, 33, 8, {1, 1, 32, 8}},
+            {ScalingFilter::Lanczos3, 5, 4, 19, 9, {0, 0, 19, 9}},
+        };
+        TestData random;
+        std::vector<std::uint8_t> source(37 * 9 * 4);
+        random.fill(source.data(), source.size());
+        std::vector<std::uint8_t> reference;
+        std::vector<std::uint8_t> candidate;
+        ScalingScratch scratch;
+        for (const Case& test : cases)
+        {
+            const FilterScaler scaler(test.filter, test.sourceWidth, test.sourceHeight, test.outputWidth, test.outputHeight);
+            const std::size_t pitch = static_cast<std::size_t>(test.outputWidth) * 4 + kGuardBytes;
+            reference.assign(pitch * test.outputHeight, kGuardValue);
+            candidate.assign(pitch * test.outputHeight, kGuardValue);
+            const std::size_t sourcePitch = static_cast<std::size_t>(test.sourceWidth) * 4;
+            scaler.scaleRegionWith(ScalingTier::Scalar, reference.data(), pitch, test.region, source.data(), sourcePitch, scratch);
+            scaler.scaleRegionWith(tier, candidate.data(), pitch, test.region, source.data(), sourcePitch, scratch);
+            if (reference != candidate)
+            {
+                return TestResult::Failed;
+            }
+        }
+
+        for (const auto& [width, height] : {std::pair{1u, 1u}, std::pair{2u, 3u}, std::pair{37u, 9u}})
+        {
+            const std::size_t pitch = static_cast<std::size_t>(width) * 4 + kGuardBytes;
+            reference.assign(pitch * height, kGuardValue);
+            candidate.assign(pitch * height, kGuardValue);
+            sharpenTextureWith(ScalingTier::Scalar, reference.data(), pitch, source.data(), static_cast<std::size_t>(width) * 4, width, height);
+            sharpenTextureWith(tier, candidate.data(), pitch, source.data(), static_cast<std::size_t>(width) * 4, width, height);
+            if (reference != candidate)
+            {
+                return TestResult::Failed;
+            }
+        }
+        return TestResult::Passed;
+    }
+
+    TestResult testAudio(AudioKernelTier tier)
+    {
+        FloatToPcm16Fn convert = floatToPcm16Kernel(tier);
+        PeakMagnitudeFn peak = peakMagnitudeKernel(tier);
+        if (!convert || !peak)
+        {
+            return TestResult::Unavailable;
+        }
+        TestData random;
+        std::array<float, 1024> floats{};
+        std::array<std::int16_t, 1024 + kGuardBytes> reference{};
+        std::array<std::int16_t, 1024 + kGuardBytes> candidate{};
+        for (float& value : floats)
+        {
+            // [-1.5, 1.5], so both clamps are exercised.
+            value = static_cast<float>(static_cast<std::int32_t>(random.next())) / 1431655765.0f;
+        }
+        const float specials[] = {1.0f, -1.0f, 0.0f, -0.0f, std::numeric_limits<float>::quiet_NaN(),
+                                  std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+        for (std::size_t i = 0; i < std::size(specials); ++i)
+        {
+            floats[i * 37] = specials[i];
+        }
+
+        for (std::size_t count : {0u, 1u, 7u, 8u, 15u, 16u, 17u, 100u, 1024u})
+        {
+            reference.fill(0x5A5A);
+            candidate.fill(0x5A5A);
+            floatToPcm16Kernel(AudioKernelTier::Scalar)(reference.data(), floats.data(), count);
+            convert(candidate.data(), floats.data(), count);
+            if (reference != candidate)
+            {
+                return TestResult::Failed;
+            }
+            // The converted samples never reach -32768; plant one.
+            if (count != 0)
+            {
+                candidate[count / 2] = std::numeric_limits<std::int16_t>::min();
+            }
+            if (peakMagnitudeKernel(AudioKernelTier::Scalar)(candidate.data(), count) != peak(candidate.data(), count))
+            {
+                return TestResult::Failed;
+            }
+        }
+        return TestResult::Passed;
+    }
+
+    template <typename Tier>
+    struct TierOption {
+        Tier tier;
+        SimdLevel level;
+    };
+
+    // The tiers of one family, narrowest first; the first is the scalar
+    // reference and always runs.
+    template <typename Tier, std::size_t Count>
+    struct Family {
+        const char* name;
+        std::array<TierOption<Tier>, Count> tiers;
+        TestResult (*test)(Tier);
+        bool (*activate)(Tier);
+        Tier (*active)();
+        const char* (*tierName)(Tier);
+    };
+
+    template <typename Tier, std::size_t Count>
+    class FamilyState {
+    public:
+        explicit FamilyState(const Family<Tier, Count>& family)
+            : family_(family)
+        {
+            results_[0] = TestResult::Passed;
+            for (std::size_t i = 1; i < Count; ++i)
+            {
+                results_[i] = family_.test(family_.tiers[i].tier);
+            }
+        }
+
+        KernelFamilyReport configure(SimdLevel limit) const
+        {
+            KernelFamilyReport report;
+            report.family = family_.name;
+            std::size_t chosen = 0;
+            for (std::size_t i = 0; i < Count; ++i)
+            {
+                if (results_[i] == TestResult::Failed)
+                {
+                    report.failed += (report.failed.empty() ? "" : ", ") + std::string(family_.tierName(family_.tiers[i].tier));
+                }
+                else if (results_[i] == TestResult::Passed && family_.tiers[i].level <= limit)
+                {
+                    chosen = i;
+                }
+            }
+            family_.activate(family_.tiers[chosen].tier);
+            report.active = family_.tierName(family_.active());
+            return report;
+        }
+
+    private:
+        Family<Tier, Count> family_;
+        std::array<TestResult, Count> results_{};
+    };
+
+    const Family<CopyKernelTier, 4> kCopyFamily{
+        "frame copy",
+        {{{CopyKernelTier::Memcpy, SimdLevel::Scalar},
+          {CopyKernelTier::SSE2, SimdLevel::SSE2},
+          {CopyKernelTier::AVX2, SimdLevel::AVX2},
+          {CopyKernelTier::AVX512, SimdLevel::AVX512}}},
+        testCopy,
+        setActiveCopyKernelTier,
+        activeCopyKernelTier,
+        copyKernelTierName,
+    };
+
+    const Family<ConversionTier, 3> kConversionFamily{
+        "pixel conversion",
+        {{{ConversionTier::Scalar, SimdLevel::Scalar},
+          {ConversionTier::SSSE3, SimdLevel::SSSE3},
+          {ConversionTier::AVX2, SimdLevel::AVX2}}},
+        testConversion,
+        setActiveConversionTier,
+        activeConversionTier,
+        conversionTierName,
+    };
+
+    const Family<ConversionTier, 2> kToneMapFamily{
+        "HDR tone mapping",
+        {{{ConversionTier::Scalar, SimdLevel::Scalar},
+          {ConversionTier::AVX2, SimdLevel::AVX2}}},
+        testToneMap,
+        setActiveToneMapTier,
+        activeToneMapTier,
+        conversionTierName,
+    };
+
+    const Family<DownscaleTier, 3> kDownscaleFamily{
+        "downscale",
+        {{{DownscaleTier::Scalar, SimdLevel::Scalar},
+          {DownscaleTier::SSE2, SimdLevel::SSE2},
+          {DownscaleTier::AVX2, SimdLevel::AVX2}}},
+        testDownscale,
+        setActiveDownscaleTier,
+        activeDownscaleTier,
+        downscaleTierName,
+    };
+
+    const Family<ScalingTier, 3> kScalingFamily{
+        "scaling filters",
+        {{{ScalingTier::Scalar, SimdLevel::Scalar},
+          {ScalingTier::SSE2, SimdLevel::SSE2},
+          {ScalingTier::AVX2, SimdLevel::AVX2}}},
+        testScaling,
+        setActiveScalingTier,
+        activeScalingTier,
+        scalingTierName,
+    };
+
+    const Family<AudioKernelTier, 3> kAudioFamily{
+        "audio samples",
+        {{{AudioKernelTier::Scalar, SimdLevel::Scalar},
+          {AudioKernelTier::SSE2, SimdLevel::SSE2},
+          {AudioKernelTier::AVX2, SimdLevel::AVX2}}},
+        testAudio,
+        setActiveAudioKernelTier,
+        activeAudioKernelTier,
+        audioKernelTierName,
+    };
+
+    // Self-tests run on first use and are kept for later reconfiguration.
+    struct Registry {
+        FamilyState<CopyKernelTier, 4> copy{kCopyFamily};
+        FamilyState<ConversionTier, 3> conversion{kConversionFamily};
+        FamilyState<ConversionTier, 2> toneMap{kToneMapFamily};
+        FamilyState<DownscaleTier, 3> downscale{kDownscaleFamily};
+        FamilyState<ScalingTier, 3> scaling{kScalingFamily};
+        FamilyState<AudioKernelTier, 3> audio{kAudioFamily};
+    };
+
+    const Registry& registry()
+    {
+        static const Registry instance;
+        return instance;
+    }
+}
+
+const CpuFeatures& cpuFeatures()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+SimdLevel detectedSimdLevel()
+{
+#if PCKVM_REGISTRY_X86
+    const CpuFeatures& features = cpuFeatures();
+    if (features.avx512f && features.avx2)
+    {
+        return SimdLevel::AVX512;
+    }
+    if (features.avx2 && features.ssse3)
+    {
+        return SimdLevel::AVX2;
+    }
+    return features.ssse3 ? SimdLevel::SSSE3 : SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    for (const auto& [value, name] : kLevelNames)
+    {
+        if (value == level)
+        {
+            return name;
+        }
+    }
+    return "unknown";
+}
+
+bool parseSimdLevel(std::string_view text, SimdLevel& level)
+{
+    for (const auto& [value, name] : kLevelNames)
+    {
+        if (text == name)
+        {
+            level = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+SimdLevel simdLevelFromEnvironment(SimdLevel fallback)
+{
+    std::string text;
+#if defined(_MSC_VER)
+    char* value = nullptr;
+    std::size_t length = 0;
+    if (_dupenv_s(&value, &length, kSimdLevelEnvironmentVariable) == 0 && value)
+    {
+        text = value;
+    }
+    std::free(value);
+#else
+    if (const char* value = std::getenv(kSimdLevelEnvironmentVariable))
+    {
+        text = value;
+    }
+#endif
+    SimdLevel level = fallback;
+    return parseSimdLevel(text, level) ? level : fallback;
+}
+
+std::vector<KernelFamilyReport> configureKernels(SimdLevel limit)
+{
+    const Registry& state = registry();
+    return {
+        state.copy.configure(limit),
+        state.conversion.configure(limit),
+        state.toneMap.configure(limit),
+        state.downscale.configure(limit),
+        state.scaling.configure(limit),
+        state.audio.configure(limit),
+    };
+}
@@ -0,0 +1,177 @@
+#include "LatencyStats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+std::uint64_t latencyClockNs()
+{
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+std::size_t LatencyHistogram::bucketIndex(std::uint64_t value) noexcept
+{
+    value = std::min<std::uint64_t>(value, (1ull << kMaxValueBits) - 1);
+    if (value < kSubBucketCount)
+    {
+        return static_cast<std::size_t>(value);
+    }
+
+    // Shift the value so it lands in the upper half of the sub-bucket range;
+    // each further power of two then adds another half-range of buckets.
+    const unsigned msb = static_cast<unsigned>(std::bit_width(value)) - 1;
+    const unsigned shift = msb - (kSubBucketBits - 1);
+    const std::uint64_t sub = value >> shift;
+    return static_cast<std::size_t>(kSubBucketCount + (shift - 1) * (kSubBucketCount / 2) + (sub - kSubBucketCount / 2));
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index) noexcept
+{
+    if (index < kSubBucketCount)
+    {
+        return index;
+    }
+    const std::size_t offset = index - kSubBucketCount;
+    const unsigned shift = static_cast<unsigned>(offset / (kSubBucketCount / 2)) + 1;
+    const std::uint64_t sub = offset % (kSubBucketCount / 2) + kSubBucketCount / 2;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t value) noexcept
+{
+    counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    total_.fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t currentMax = max_.load(std::memory_order_relaxed);
+    while (value > currentMax && !max_.compare_exchange_weak(currentMax, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::reset() noexcept
+{
+    for (auto& count : counts_)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const noexcept
+{
+    const std::uint64_t total = count();
+    return total == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(total);
+}
+
+std::uint64_t LatencyHistogram::valueAtQuantile(double quantile) const noexcept
+{
+    // Recorders may still be adding samples; walk against the bucket sum we
+    // actually see rather than the separately updated total.
+    std::uint64_t total = 0;
+    for (const auto& count : counts_)
+    {
+        total += count.load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    quantile = std::clamp(quantile, 0.0, 1.0);
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(quantile * static_cast<double>(total))));
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i)
+    {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+void LatencyTracker::record(const FrameTimestamps& stamps) noexcept
+{
+    auto add = [this](LatencyStage stage, std::uint64_t from, std::uint64_t to) {
+        if (from != 0 && to >= from)
+        {
+            histograms_[static_cast<std::size_t>(stage)].record(to - from);
+        }
+    };
+
+    add(LatencyStage::Handle, stamps.captured, stamps.handled);
+    add(LatencyStage::Queue, stamps.handled, stamps.uploaded);
+    add(LatencyStage::Record, stamps.uploaded, stamps.submitted);
+    add(LatencyStage::Present, stamps.submitted, stamps.presented);
+    add(LatencyStage::Total, stamps.captured, stamps.presented);
+}
+
+void LatencyTracker::reset() noexcept
+{
+    for (auto& histogram : histograms_)
+    {
+        histogram.reset();
+    }
+}
+
+const char* LatencyTracker::stageName(LatencyStage stage) noexcept
+{
+    switch (stage)
+    {
+    case LatencyStage::Handle:
+        return "Capture -> handled";
+    case LatencyStage::Queue:
+        return "Handled -> uploaded";
+    case LatencyStage::Record:
+        return "Uploaded -> submitted";
+    case LatencyStage::Present:
+        return "Submitted -> presented";
+    case LatencyStage::Total:
+        return "Capture -> presented";
+    default:
+        return "Unknown";
+    }
+}
+
+std::string LatencyTracker::formatReport() const
+{
+    std::string report;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %10s %10s %10s %10s %10s\n", "Stage (ms)", "count", "p50", "p99", "p99.9", "max");
+    report += line;
+
+    for (std::size_t i = 0; i < kStageCount; ++i)
+    {
+        const auto stage = static_cast<LatencyStage>(i);
+        const LatencyHistogram& h = histogram(stage);
+        std::snprintf(line, sizeof(line), "%-24s %10llu %10.3f %10.3f %10.3f %10.3f\n",
+                      stageName(stage),
+                      static_cast<unsigned long long>(h.count()),
+                      static_cast<double>(h.valueAtQuantile(0.5)) / 1e6,
+                      static_cast<double>(h.valueAtQuantile(0.99)) / 1e6,
+                      static_cast<double>(h.valueAtQuantile(0.999)) / 1e6,
+                      static_cast<double>(h.max()) / 1e6);
+        report += line;
+    }
+    return report;
+}
+
+bool LatencyTracker::writeReport(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+    out << formatReport();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,42 @@
+#include "MemoryFrameSink.hpp"
+
+bool MemoryFrameSink::beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target)
+{
+    if (width == 0 || height == 0)
+    {
+        return false;
+    }
+
+    CpuFrame& slot = mailbox_.writeSlot();
+    const std::size_t bytes = static_cast<std::size_t>(width) * 4 * height;
+    if (slot.data.size() != bytes)
+    {
+        // Hand the old buffer back first so it counts against the limit no longer.
+        slot.data.reset();
+        slot.sequence = 0;
+        slot.data = pool_.acquire(bytes, FramePool::PixelFormat::BGRA8);
+        if (slot.data.empty())
+        {
+            return false;
+        }
+    }
+    slot.width = width;
+    slot.height = height;
+    slot.stride = width * 4;
+
+    target.data = slot.data.data();
+    target.rowPitch = slot.stride;
+    target.width = width;
+    target.height = height;
+    target.contentSequence = slot.sequence;
+    return true;
+}
+
+void MemoryFrameSink::commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence)
+{
+    CpuFrame& slot = mailbox_.writeSlot();
+    slot.timestamp100ns = frame.timestamp100ns;
+    slot.sequence = sequence;
+    slot.timestamps = FrameTimestamps{frame.arrivalNs, latencyClockNs()};
+    mailbox_.publish();
+}
@@ -1,4 +1,5 @@
 #include "MicrophoneCapture.hpp"
+#include "AudioKernels.hpp"
 #include "SerialStreamer.hpp"
 
 #include <algorithm>
@@ -429,12 +430,7 @@ void MicrophoneCapture::processAvailableAudio()
         {
             const std::size_t sampleCount = static_cast<std::size_t>(frames) * channels;
             samples16.resize(sampleCount);
-            const float* samples = reinterpret_cast<const float*>(data);
-            for (std::size_t i = 0; i < sampleCount; ++i)
-            {
-                const float value = std::clamp(samples[i], -1.0f, 1.0f);
-                samples16[i] = static_cast<std::int16_t>(value * 32767.0f);
-            }
+            convertFloatToPcm16(samples16.data(), reinterpret_cast<const float*>(data), sampleCount);
         }
         else
         {
@@ -468,15 +464,7 @@ void MicrophoneCapture::processAvailableAudio()
         {
             if (autoGainEnabled_)
             {
-                int maxAbs = 0;
-                for (std::int16_t sample : finalSamples)
-                {
-                    const int absVal = std::abs(static_cast<int>(sample));
-                    if (absVal > maxAbs)
-                    {
-                        maxAbs = absVal;
-                    }
-                }
+                const int maxAbs = peakMagnitude(finalSamples.data(), finalSamples.size());
 
                 if (maxAbs > 0)
                 {
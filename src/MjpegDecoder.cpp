@@ -0,0 +1,1066 @@
+#include "MjpegDecoder.hpp"
+#include "StripeWorkerPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    enum Marker : std::uint8_t {
+        kSof0 = 0xC0,
+        kSof1 = 0xC1,
+        kDht = 0xC4,
+        kRst0 = 0xD0,
+        kRst7 = 0xD7,
+        kSoi = 0xD8,
+        kEoi = 0xD9,
+        kSos = 0xDA,
+        kDqt = 0xDB,
+        kDri = 0xDD,
+    };
+
+    // Below this many MCUs a frame decodes faster than the workers wake up.
+    constexpr std::size_t kParallelMinMcus = 2048;
+
+    constexpr int kLookupBits = 9;
+
+    constexpr std::array<std::uint8_t, 64> kZigzag = {
+        0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    };
+
+    // The example tables of ITU T.81 Annex K.3. Motion JPEG streams usually
+    // leave out their DHT segments and rely on these.
+    constexpr std::uint8_t kDcLumaCounts[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    constexpr std::uint8_t kDcChromaCounts[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    constexpr std::uint8_t kDcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    constexpr std::uint8_t kAcLumaCounts[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+    constexpr std::uint8_t kAcLumaValues[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+        0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+        0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+        0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA,
+    };
+
+    constexpr std::uint8_t kAcChromaCounts[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+    constexpr std::uint8_t kAcChromaValues[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+        0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+        0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+        0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+        0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+        0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA,
+    };
+
+    struct HuffmanTable {
+        // The next kLookupBits bits -> (code length << 8) | symbol, or 0 when
+        // the code is longer than that.
+        std::array<std::uint16_t, 1u << kLookupBits> lookup{};
+        // Largest code of each length, -1 for none; index 17 stops the search.
+        std::array<std::int32_t, 18> maxCode{};
+        std::array<std::int32_t, 17> valueOffset{};
+        std::array<std::uint8_t, 256> values{};
+        bool present = false;
+    };
+
+    // Builds the canonical code of T.81 Annex C. Fails on an over-full table.
+    bool buildHuffmanTable(HuffmanTable& table, const std::uint8_t counts[16], const std::uint8_t* values, std::size_t valueCount)
+    {
+        table = HuffmanTable{};
+        std::int32_t code = 0;
+        std::size_t index = 0;
+        for (int length = 1; length <= 16; ++length)
+        {
+            const std::uint8_t count = counts[length - 1];
+            table.valueOffset[length] = static_cast<std::int32_t>(index) - code;
+            for (std::uint8_t i = 0; i < count; ++i, ++code, ++index)
+            {
+                if (index >= valueCount || code >= (1 << length))
+                {
+                    return false;
+                }
+                table.values[index] = values[index];
+                if (length <= kLookupBits)
+                {
+                    const int spare = kLookupBits - length;
+                    const auto entry = static_cast<std::uint16_t>((length << 8) | values[index]);
+                    std::fill_n(table.lookup.begin() + (code << spare), 1 << spare, entry);
+                }
+            }
+            table.maxCode[length] = count != 0 ? code - 1 : -1;
+            code <<= 1;
+        }
+        table.maxCode[17] = 0x7FFFFFFF;
+        table.present = true;
+        return true;
+    }
+
+    // MSB-first reader over one restart interval. Stuffed zero bytes are
+    // dropped; past the end, or at a marker, it yields zero bits.
+    class BitReader {
+    public:
+        BitReader(const std::uint8_t* begin, const std::uint8_t* end) : pos_(begin), end_(end) {}
+
+        // Tops the buffer up to more than 56 bits, enough for one Huffman code
+        // plus its magnitude bits.
+        void refill()
+        {
+            while (count_ <= 56)
+            {
+                std::uint64_t byte = 0;
+                if (pos_ < end_)
+                {
+                    byte = *pos_;
+                    if (byte != 0xFF)
+                    {
+                        ++pos_;
+                    }
+                    else if (pos_ + 1 < end_ && pos_[1] == 0x00)
+                    {
+                        pos_ += 2;
+                    }
+                    else
+                    {
+                        byte = 0;
+                        pos_ = end_;
+                    }
+                }
+                bits_ |= byte << (56 - count_);
+                count_ += 8;
+            }
+        }
+
+        [[nodiscard]] std::uint32_t peek(int bits) const { return static_cast<std::uint32_t>(bits_ >> (64 - bits)); }
+
+        void consume(int bits)
+        {
+            bits_ <<= bits;
+            count_ -= bits;
+        }
+
+        // Returns the symbol, or -1 for a code that is not in the table.
+        int decode(const HuffmanTable& table)
+        {
+            const std::uint16_t entry = table.lookup[peek(kLookupBits)];
+            if (entry != 0)
+            {
+                consume(entry >> 8);
+                return entry & 0xFF;
+            }
+            int length = kLookupBits + 1;
+            std::int32_t code = static_cast<std::int32_t>(peek(length));
+            while (code > table.maxCode[length])
+            {
+                ++length;
+                code = static_cast<std::int32_t>(peek(length));
+            }
+            if (length > 16)
+            {
+                return -1;
+            }
+            consume(length);
+            return table.values[static_cast<std::size_t>(code + table.valueOffset[length]) & 0xFF];
+        }
+
+        // Reads `bits` magnitude bits and sign-extends them as T.81 F.2.2.1 describes.
+        std::int32_t receiveExtend(int bits)
+        {
+            if (bits == 0)
+            {
+                return 0;
+            }
+            const auto value = static_cast<std::int32_t>(peek(bits));
+            consume(bits);
+            return value < (1 << (bits - 1)) ? value - (1 << bits) + 1 : value;
+        }
+
+    private:
+        const std::uint8_t* pos_;
+        const std::uint8_t* end_;
+        std::uint64_t bits_ = 0;
+        int count_ = 0;
+    };
+
+    std::uint8_t clampSample(std::int32_t value)
+    {
+        return static_cast<std::uint8_t>(std::clamp(value, 0, 255));
+    }
+
+    // Integer inverse DCT after the Loeffler-Ligtenberg-Moschytz factorisation
+    // used by the IJG "islow" decoder: 13-bit constants, two extra fraction
+    // bits between the column and row passes.
+    constexpr int kConstBits = 13;
+    constexpr int kPass1Bits = 2;
+
+    constexpr std::int32_t kFix0_298631336 = 2446;
+    constexpr std::int32_t kFix0_390180644 = 3196;
+    constexpr std::int32_t kFix0_541196100 = 4433;
+    constexpr std::int32_t kFix0_765366865 = 6270;
+    constexpr std::int32_t kFix0_899976223 = 7373;
+    constexpr std::int32_t kFix1_175875602 = 9633;
+    constexpr std::int32_t kFix1_501321110 = 12299;
+    constexpr std::int32_t kFix1_847759065 = 15137;
+    constexpr std::int32_t kFix1_961570560 = 16069;
+    constexpr std::int32_t kFix2_053119869 = 16819;
+    constexpr std::int32_t kFix2_562915447 = 20995;
+    constexpr std::int32_t kFix3_072711026 = 25172;
+
+    // Unsigned so that the 32-bit arithmetic wraps instead of overflowing on
+    // corrupt coefficients; valid streams never wrap, so the two's-complement
+    // result is the same as the IJG decoder's.
+    using Accumulator = std::uint32_t;
+
+    constexpr std::int32_t descale(Accumulator value, int bits)
+    {
+        return static_cast<std::int32_t>(value + (Accumulator{1} << (bits - 1))) >> bits;
+    }
+
+    struct IdctOutputs {
+        Accumulator values[8];
+    };
+
+    // One 8-point pass; outputs are scaled up by 2^kConstBits.
+    IdctOutputs idct8(Accumulator in0, Accumulator in1, Accumulator in2, Accumulator in3,
+                      Accumulator in4, Accumulator in5, Accumulator in6, Accumulator in7)
+    {
+        // Even part.
+        Accumulator z1 = (in2 + in6) * kFix0_541196100;
+        const Accumulator evenA = z1 - in6 * kFix1_847759065;
+        const Accumulator evenB = z1 + in2 * kFix0_765366865;
+        const Accumulator sum = (in0 + in4) * (Accumulator{1} << kConstBits);
+        const Accumulator difference = (in0 - in4) * (Accumulator{1} << kConstBits);
+        const Accumulator tmp10 = sum + evenB;
+        const Accumulator tmp13 = sum - evenB;
+        const Accumulator tmp11 = difference + evenA;
+        const Accumulator tmp12 = difference - evenA;
+
+        // Odd part.
+        Accumulator tmp0 = in7;
+        Accumulator tmp1 = in5;
+        Accumulator tmp2 = in3;
+        Accumulator tmp3 = in1;
+        z1 = tmp0 + tmp3;
+        Accumulator z2 = tmp1 + tmp2;
+        Accumulator z3 = tmp0 + tmp2;
+        Accumulator z4 = tmp1 + tmp3;
+        const Accumulator z5 = (z3 + z4) * kFix1_175875602;
+
+        tmp0 *= kFix0_298631336;
+        tmp1 *= kFix2_053119869;
+        tmp2 *= kFix3_072711026;
+        tmp3 *= kFix1_501321110;
+        z1 *= -kFix0_899976223;
+        z2 *= -kFix2_562915447;
+        z3 = z3 * -kFix1_961570560 + z5;
+        z4 = z4 * -kFix0_390180644 + z5;
+
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        return {{tmp10 + tmp3, tmp11 + tmp2, tmp12 + tmp1, tmp13 + tmp0,
+                 tmp13 - tmp0, tmp12 - tmp1, tmp11 - tmp2, tmp10 - tmp3}};
+    }
+
+    // Dequantized coefficients in natural order -> 8x8 samples at `out`.
+    void inverseDct(const std::int32_t* coefficients, std::uint8_t* out, std::size_t outStride)
+    {
+        std::int32_t workspace[64];
+        for (int column = 0; column < 8; ++column)
+        {
+            const std::int32_t* in = coefficients + column;
+            std::int32_t* ws = workspace + column;
+            if ((in[8] | in[16] | in[24] | in[32] | in[40] | in[48] | in[56]) == 0)
+            {
+                const std::int32_t dc = in[0] * (1 << kPass1Bits);
+                for (int row = 0; row < 8; ++row)
+                {
+                    ws[row * 8] = dc;
+                }
+                continue;
+            }
+            const IdctOutputs result = idct8(in[0], in[8], in[16], in[24], in[32], in[40], in[48], in[56]);
+            for (int row = 0; row < 8; ++row)
+            {
+                ws[row * 8] = descale(result.values[row], kConstBits - kPass1Bits);
+            }
+        }
+
+        for (int row = 0; row < 8; ++row)
+        {
+            const std::int32_t* ws = workspace + row * 8;
+            std::uint8_t* dst = out + static_cast<std::size_t>(row) * outStride;
+            if ((ws[1] | ws[2] | ws[3] | ws[4] | ws[5] | ws[6] | ws[7]) == 0)
+            {
+                std::memset(dst, clampSample(descale(ws[0], kPass1Bits + 3) + 128), 8);
+                continue;
+            }
+            const IdctOutputs result = idct8(ws[0], ws[1], ws[2], ws[3], ws[4], ws[5], ws[6], ws[7]);
+            for (int x = 0; x < 8; ++x)
+            {
+                dst[x] = clampSample(descale(result.values[x], kConstBits + kPass1Bits + 3) + 128);
+            }
+        }
+    }
+
+    // Same result as inverseDct() for a block without AC coefficients.
+    void inverseDctDcOnly(std::int32_t dc, std::uint8_t* out, std::size_t outStride)
+    {
+        const std::uint8_t value = clampSample(descale(dc * (1 << kPass1Bits), kPass1Bits + 3) + 128);
+        for (int row = 0; row < 8; ++row)
+        {
+            std::memset(out + static_cast<std::size_t>(row) * outStride, value, 8);
+        }
+    }
+
+    constexpr std::int32_t kCoefficientLimit = 32767;
+
+    std::int32_t dequantize(std::int32_t value, std::int32_t step)
+    {
+        const std::int64_t product = static_cast<std::int64_t>(value) * step;
+        return static_cast<std::int32_t>(std::clamp<std::int64_t>(product, -kCoefficientLimit, kCoefficientLimit));
+    }
+
+    std::uint16_t readU16(const std::uint8_t* p)
+    {
+        return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    bool isRestartMarker(std::uint8_t marker)
+    {
+        return marker >= kRst0 && marker <= kRst7;
+    }
+
+    // Position of the first marker at or after `pos` that is neither a
+    // stuffed zero nor a restart marker, i.e. the end of entropy-coded data.
+    // Returns `size` when there is none.
+    std::size_t skipEntropyData(const std::uint8_t* data, std::size_t size, std::size_t pos)
+    {
+        while (pos < size)
+        {
+            const auto* found = static_cast<const std::uint8_t*>(std::memchr(data + pos, 0xFF, size - pos));
+            if (!found)
+            {
+                return size;
+            }
+            pos = static_cast<std::size_t>(found - data);
+            if (pos + 1 >= size)
+            {
+                return size;
+            }
+            const std::uint8_t next = data[pos + 1];
+            if (next == 0x00 || isRestartMarker(next))
+            {
+                pos += 2;
+            }
+            else if (next == 0xFF)
+            {
+                ++pos;
+            }
+            else
+            {
+                return pos;
+            }
+        }
+        return size;
+    }
+
+    // Walks marker segments from `pos`, which must be just past SOI. Calls
+    // visit(marker, payload, payloadSize, offsetAfterSegment) for each one;
+    // entropy-coded data after SOS is skipped. Stops when visit returns false,
+    // at EOI (returning the offset past it) or on malformed data (returning 0).
+    template <typename Visit>
+    std::size_t walkSegments(const std::uint8_t* data, std::size_t size, std::size_t pos, Visit&& visit)
+    {
+        while (pos + 1 < size)
+        {
+            if (data[pos] != 0xFF)
+            {
+                return 0;
+            }
+            const std::uint8_t marker = data[pos + 1];
+            pos += 2;
+            if (marker == 0xFF)
+            {
+                --pos;
+                continue;
+            }
+            if (marker == kEoi)
+            {
+                return pos;
+            }
+            if (isRestartMarker(marker) || marker == 0x01)
+            {
+                continue;
+            }
+            if (pos + 2 > size)
+            {
+                return 0;
+            }
+            const std::size_t length = readU16(data + pos);
+            if (length < 2 || pos + length > size)
+            {
+                return 0;
+            }
+            const std::uint8_t* payload = data + pos + 2;
+            pos += length;
+            if (marker == kSos)
+            {
+                pos = skipEntropyData(data, size, pos);
+            }
+            if (!visit(marker, payload, length - 2, pos))
+            {
+                return pos;
+            }
+        }
+        return 0;
+    }
+
+    bool startsWithSoi(const std::uint8_t* data, std::size_t size)
+    {
+        return size >= 2 && data[0] == 0xFF && data[1] == kSoi;
+    }
+
+    enum class Layout {
+        Grey,   // one component -> NV12 with neutral chroma
+        H1V1,   // 4:4:4 -> YUY2, chroma averaged over pixel pairs
+        H2V1,   // 4:2:2 -> YUY2
+        H2V2,   // 4:2:0 -> NV12
+    };
+
+    struct Component {
+        std::uint8_t id = 0;
+        int h = 1;
+        int v = 1;
+        int quant = 0;
+        int dcTable = 0;
+        int acTable = 0;
+    };
+
+    struct Segment {
+        const std::uint8_t* begin = nullptr;
+        const std::uint8_t* end = nullptr;
+    };
+}
+
+struct MjpegDecoderState {
+    std::array<HuffmanTable, 4> defaultDc{};
+    std::array<HuffmanTable, 4> defaultAc{};
+    std::array<HuffmanTable, 4> dc{};
+    std::array<HuffmanTable, 4> ac{};
+    std::array<std::array<std::int32_t, 64>, 4> quant{};
+    std::array<bool, 4> quantPresent{};
+
+    std::array<Component, 3> components{};
+    int componentCount = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::size_t restartInterval = 0;
+
+    Layout layout = Layout::Grey;
+    std::uint32_t mcuWidth = 8;
+    std::uint32_t mcuHeight = 8;
+    std::uint32_t mcusX = 0;
+    std::uint32_t mcusY = 0;
+
+    std::uint8_t* output = nullptr;
+    std::size_t stride = 0;
+    std::size_t chromaOffset = 0;
+
+    std::vector<Segment> segments;
+
+    MjpegDecoderState()
+    {
+        buildHuffmanTable(defaultDc[0], kDcLumaCounts, kDcValues, sizeof(kDcValues));
+        buildHuffmanTable(defaultDc[1], kDcChromaCounts, kDcValues, sizeof(kDcValues));
+        buildHuffmanTable(defaultAc[0], kAcLumaCounts, kAcLumaValues, sizeof(kAcLumaValues));
+        buildHuffmanTable(defaultAc[1], kAcChromaCounts, kAcChromaValues, sizeof(kAcChromaValues));
+    }
+
+    bool parseQuantTables(const std::uint8_t* p, std::size_t size)
+    {
+        while (size > 0)
+        {
+            const int precision = p[0] >> 4;
+            const int id = p[0] & 0x0F;
+            const std::size_t bytes = 1 + 64 * (precision ? 2 : 1);
+            if (id > 3 || precision > 1 || size < bytes)
+            {
+                return false;
+            }
+            for (int k = 0; k < 64; ++k)
+            {
+                quant[id][k] = precision ? readU16(p + 1 + k * 2) : p[1 + k];
+            }
+            quantPresent[id] = true;
+            p += bytes;
+            size -= bytes;
+        }
+        return true;
+    }
+
+    bool parseHuffmanTables(const std::uint8_t* p, std::size_t size)
+    {
+        while (size >= 17)
+        {
+            const int tableClass = p[0] >> 4;
+            const int id = p[0] & 0x0F;
+            std::size_t valueCount = 0;
+            for (int i = 0; i < 16; ++i)
+            {
+                valueCount += p[1 + i];
+            }
+            if (tableClass > 1 || id > 3 || valueCount > 256 || size < 17 + valueCount)
+            {
+                return false;
+            }
+            HuffmanTable& table = tableClass == 0 ? dc[id] : ac[id];
+            if (!buildHuffmanTable(table, p + 1, p + 17, valueCount))
+            {
+                return false;
+            }
+            p += 17 + valueCount;
+            size -= 17 + valueCount;
+        }
+        return size == 0;
+    }
+
+    bool parseFrameHeader(const std::uint8_t* p, std::size_t size, std::string& error)
+    {
+        if (size < 6 || p[0] != 8)
+        {
+            error = "Only 8-bit JPEG is supported";
+            return false;
+        }
+        height = readU16(p + 1);
+        width = readU16(p + 3);
+        componentCount = p[5];
+        if (width == 0 || height == 0)
+        {
+            error = "JPEG frame size is missing";
+            return false;
+        }
+        if ((componentCount != 1 && componentCount != 3) || size < 6 + static_cast<std::size_t>(componentCount) * 3)
+        {
+            error = "JPEG must have one or three components";
+            return false;
+        }
+        for (int i = 0; i < componentCount; ++i)
+        {
+            Component& component = components[i];
+            component.id = p[6 + i * 3];
+            component.h = p[7 + i * 3] >> 4;
+            component.v = p[7 + i * 3] & 0x0F;
+            component.quant = p[8 + i * 3] & 0x03;
+        }
+
+        if (componentCount == 1)
+        {
+            // A single-component scan is never interleaved: one block per MCU.
+            layout = Layout::Grey;
+            mcuWidth = 8;
+            mcuHeight = 8;
+        }
+        else
+        {
+            const Component& luma = components[0];
+            const bool chromaFull = components[1].h == 1 && components[1].v == 1 && components[2].h == 1 && components[2].v == 1;
+            if (chromaFull && luma.h == 1 && luma.v == 1)
+            {
+                layout = Layout::H1V1;
+            }
+            else if (chromaFull && luma.h == 2 && luma.v == 1)
+            {
+                layout = Layout::H2V1;
+            }
+            else if (chromaFull && luma.h == 2 && luma.v == 2)
+            {
+                layout = Layout::H2V2;
+            }
+            else
+            {
+                error = "Unsupported JPEG chroma subsampling";
+                return false;
+            }
+            mcuWidth = 8 * static_cast<std::uint32_t>(luma.h);
+            mcuHeight = 8 * static_cast<std::uint32_t>(luma.v);
+        }
+        mcusX = (width + mcuWidth - 1) / mcuWidth;
+        mcusY = (height + mcuHeight - 1) / mcuHeight;
+        return true;
+    }
+
+    bool parseScanHeader(const std::uint8_t* p, std::size_t size, std::string& error)
+    {
+        const std::size_t count = size > 0 ? p[0] : 0;
+        if (count != static_cast<std::size_t>(componentCount) || size < 4 + count * 2)
+        {
+            error = "JPEG scan must interleave every component";
+            return false;
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            // MCUs follow the frame header's component order.
+            Component& component = components[i];
+            if (p[1 + i * 2] != component.id)
+            {
+                error = "JPEG scan components are out of order";
+                return false;
+            }
+            component.dcTable = p[2 + i * 2] >> 4;
+            component.acTable = p[2 + i * 2] & 0x0F;
+            if (component.dcTable > 3 || component.acTable > 3 || !dc[component.dcTable].present ||
+                !ac[component.acTable].present || !quantPresent[component.quant])
+            {
+                error = "JPEG scan refers to a missing table";
+                return false;
+            }
+        }
+        const std::uint8_t* spectral = p + 1 + count * 2;
+        if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0)
+        {
+            error = "Only baseline sequential JPEG is supported";
+            return false;
+        }
+        return true;
+    }
+
+    // Entropy-decodes one block and writes its samples. Dequantized
+    // coefficients are held to 16 bits like the IJG decoder's; valid 8-bit
+    // streams never come close.
+    bool decodeBlock(BitReader& reader, const Component& component, std::int32_t& dcPredictor, std::uint8_t* out, std::size_t outStride) const
+    {
+        const HuffmanTable& dcTable = dc[component.dcTable];
+        const HuffmanTable& acTable = ac[component.acTable];
+        const std::array<std::int32_t, 64>& q = quant[component.quant];
+
+        reader.refill();
+        const int dcBits = reader.decode(dcTable);
+        if (dcBits < 0 || dcBits > 11)
+        {
+            return false;
+        }
+        dcPredictor = std::clamp(dcPredictor + reader.receiveExtend(dcBits), -kCoefficientLimit, kCoefficientLimit);
+        const std::int32_t dcValue = dequantize(dcPredictor, q[0]);
+
+        alignas(16) std::int32_t coefficients[64];
+        bool hasAc = false;
+        for (int k = 1; k < 64;)
+        {
+            reader.refill();
+            const int symbol = reader.decode(acTable);
+            if (symbol < 0)
+            {
+                return false;
+            }
+            const int run = symbol >> 4;
+            const int bits = symbol & 0x0F;
+            if (bits > 10)
+            {
+                return false;
+            }
+            if (bits == 0)
+            {
+                if (run != 15)
+                {
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+            k += run;
+            if (k > 63)
+            {
+                return false;
+            }
+            if (!hasAc)
+            {
+                std::memset(coefficients, 0, sizeof(coefficients));
+                hasAc = true;
+            }
+            coefficients[kZigzag[k]] = dequantize(reader.receiveExtend(bits), q[k]);
+            ++k;
+        }
+
+        if (!hasAc)
+        {
+            inverseDctDcOnly(dcValue, out, outStride);
+            return true;
+        }
+        coefficients[0] = dcValue;
+        inverseDct(coefficients, out, outStride);
+        return true;
+    }
+
+    // Stores one decoded MCU into the output picture.
+    void emitMcu(std::uint32_t mcuX, std::uint32_t mcuY, const std::uint8_t* luma, const std::uint8_t* cb, const std::uint8_t* cr) const
+    {
+        const std::size_t x0 = static_cast<std::size_t>(mcuX) * mcuWidth;
+        const std::size_t y0 = static_cast<std::size_t>(mcuY) * mcuHeight;
+        switch (layout)
+        {
+        case Layout::Grey:
+            for (int row = 0; row < 8; ++row)
+            {
+                std::memcpy(output + (y0 + row) * stride + x0, luma + row * 8, 8);
+            }
+            break;
+        case Layout::H2V2:
+            for (int row = 0; row < 16; ++row)
+            {
+                std::memcpy(output + (y0 + row) * stride + x0, luma + row * 16, 16);
+            }
+            for (int row = 0; row < 8; ++row)
+            {
+                std::uint8_t* dst = output + chromaOffset + (y0 / 2 + row) * stride + x0;
+                for (int i = 0; i < 8; ++i)
+                {
+                    dst[i * 2] = cb[row * 8 + i];
+                    dst[i * 2 + 1] = cr[row * 8 + i];
+                }
+            }
+            break;
+        case Layout::H2V1:
+            for (int row = 0; row < 8; ++row)
+            {
+                std::uint8_t* dst = output + (y0 + row) * stride + x0 * 2;
+                const std::uint8_t* y = luma + row * 16;
+                for (int i = 0; i < 8; ++i)
+                {
+                    dst[i * 4 + 0] = y[i * 2];
+                    dst[i * 4 + 1] = cb[row * 8 + i];
+                    dst[i * 4 + 2] = y[i * 2 + 1];
+                    dst[i * 4 + 3] = cr[row * 8 + i];
+                }
+            }
+            break;
+        case Layout::H1V1:
+            for (int row = 0; row < 8; ++row)
+            {
+                std::uint8_t* dst = output + (y0 + row) * stride + x0 * 2;
+                const std::uint8_t* y = luma + row * 8;
+                const std::uint8_t* u = cb + row * 8;
+                const std::uint8_t* v = cr + row * 8;
+                for (int i = 0; i < 4; ++i)
+                {
+                    dst[i * 4 + 0] = y[i * 2];
+                    dst[i * 4 + 1] = static_cast<std::uint8_t>((u[i * 2] + u[i * 2 + 1] + 1) >> 1);
+                    dst[i * 4 + 2] = y[i * 2 + 1];
+                    dst[i * 4 + 3] = static_cast<std::uint8_t>((v[i * 2] + v[i * 2 + 1] + 1) >> 1);
+                }
+            }
+            break;
+        }
+    }
+
+    // Decodes MCUs [firstMcu, firstMcu + mcuCount) from one restart interval.
+    bool decodeSegment(const Segment& segment, std::size_t firstMcu, std::size_t mcuCount) const
+    {
+        BitReader reader(segment.begin, segment.end);
+        std::int32_t predictors[3] = {};
+        alignas(16) std::uint8_t luma[256];
+        alignas(16) std::uint8_t cb[64];
+        alignas(16) std::uint8_t cr[64];
+        const Component& lumaComponent = components[0];
+        const std::size_t lumaStride = mcuWidth;
+
+        for (std::size_t mcu = firstMcu; mcu < firstMcu + mcuCount; ++mcu)
+        {
+            for (int by = 0; by < (layout == Layout::Grey ? 1 : lumaComponent.v); ++by)
+            {
+                for (int bx = 0; bx < (layout == Layout::Grey ? 1 : lumaComponent.h); ++bx)
+                {
+                    if (!decodeBlock(reader, lumaComponent, predictors[0], luma + by * 8 * lumaStride + bx * 8, lumaStride))
+                    {
+                        return false;
+                    }
+                }
+            }
+            if (componentCount == 3 &&
+                (!decodeBlock(reader, components[1], predictors[1], cb, 8) || !decodeBlock(reader, components[2], predictors[2], cr, 8)))
+            {
+                return false;
+            }
+            emitMcu(static_cast<std::uint32_t>(mcu % mcusX), static_cast<std::uint32_t>(mcu / mcusX), luma, cb, cr);
+        }
+        return true;
+    }
+};
+
+MjpegDecoder::MjpegDecoder(FramePool& pool, StripeWorkerPool* workers)
+    : pool_(pool)
+    , workers_(workers)
+    , state_(std::make_unique<MjpegDecoderState>())
+{
+}
+
+MjpegDecoder::~MjpegDecoder() = default;
+
+void MjpegDecoder::reset()
+{
+    previous_.clear();
+    previousValid_ = false;
+    picture_ = CaptureSource::Frame{};
+    output_.reset();
+}
+
+MjpegDecoder::Result MjpegDecoder::decode(const CaptureSource::Frame& compressed, CaptureSource::Frame& decoded)
+{
+    if (!compressed.data || compressed.dataSize == 0)
+    {
+        lastError_ = "Empty MJPEG sample";
+        framesFailed_.fetch_add(1, std::memory_order_relaxed);
+        return Result::Failed;
+    }
+
+    const bool duplicate = previousValid_ && previous_.size() == compressed.dataSize &&
+                           std::memcmp(previous_.data(), compressed.data, compressed.dataSize) == 0;
+    if (!duplicate)
+    {
+        previousValid_ = false;
+        if (!decodePicture(compressed.data, compressed.dataSize))
+        {
+            framesFailed_.fetch_add(1, std::memory_order_relaxed);
+            return Result::Failed;
+        }
+        previous_.assign(compressed.data, compressed.data + compressed.dataSize);
+        previousValid_ = true;
+    }
+
+    decoded = picture_;
+    decoded.timestamp100ns = compressed.timestamp100ns;
+    decoded.arrivalNs = compressed.arrivalNs;
+    if (duplicate)
+    {
+        framesDuplicate_.fetch_add(1, std::memory_order_relaxed);
+        return Result::Duplicate;
+    }
+    framesDecoded_.fetch_add(1, std::memory_order_relaxed);
+    return Result::Decoded;
+}
+
+bool MjpegDecoder::decodePicture(const std::uint8_t* data, std::size_t size)
+{
+    MjpegDecoderState& s = *state_;
+    if (!startsWithSoi(data, size))
+    {
+        lastError_ = "MJPEG sample does not start with SOI";
+        return false;
+    }
+
+    s.dc = s.defaultDc;
+    s.ac = s.defaultAc;
+    s.restartInterval = 0;
+    s.componentCount = 0;
+    std::size_t scanStart = 0;
+    std::size_t scanEnd = 0;
+    std::string error;
+
+    walkSegments(data, size, 2, [&](std::uint8_t marker, const std::uint8_t* payload, std::size_t payloadSize, std::size_t next) {
+        switch (marker)
+        {
+        case kSof0:
+        case kSof1:
+            return s.parseFrameHeader(payload, payloadSize, error);
+        case kDht:
+            if (!s.parseHuffmanTables(payload, payloadSize))
+            {
+                error = "Malformed JPEG Huffman table";
+                return false;
+            }
+            return true;
+        case kDqt:
+            if (!s.parseQuantTables(payload, payloadSize))
+            {
+                error = "Malformed JPEG quantization table";
+                return false;
+            }
+            return true;
+        case kDri:
+            if (payloadSize < 2)
+            {
+                error = "Malformed JPEG restart interval";
+                return false;
+            }
+            s.restartInterval = readU16(payload);
+            return true;
+        case kSos:
+            if (s.componentCount == 0)
+            {
+                error = "JPEG scan before frame header";
+                return false;
+            }
+            if (s.parseScanHeader(payload, payloadSize, error))
+            {
+                scanStart = static_cast<std::size_t>(payload - data) + payloadSize;
+                scanEnd = next;
+            }
+            return false;
+        default:
+            if ((marker >= 0xC2 && marker <= 0xCF && marker != kDht && marker != 0xC8 && marker != 0xCC))
+            {
+                error = "Only baseline sequential JPEG is supported";
+                return false;
+            }
+            return true;
+        }
+    });
+
+    if (scanStart == 0)
+    {
+        lastError_ = error.empty() ? "MJPEG sample has no scan" : error;
+        return false;
+    }
+
+    // One segment per restart interval, split at the RSTn markers.
+    s.segments.clear();
+    const std::uint8_t* segmentBegin = data + scanStart;
+    const std::uint8_t* scanLimit = data + scanEnd;
+    for (const std::uint8_t* p = segmentBegin; p + 1 < scanLimit;)
+    {
+        p = static_cast<const std::uint8_t*>(std::memchr(p, 0xFF, static_cast<std::size_t>(scanLimit - p - 1)));
+        if (!p)
+        {
+            break;
+        }
+        if (isRestartMarker(p[1]))
+        {
+            s.segments.push_back({segmentBegin, p});
+            p += 2;
+            segmentBegin = p;
+        }
+        else
+        {
+            p += p[1] == 0xFF ? 1 : 2;
+        }
+    }
+    s.segments.push_back({segmentBegin, scanLimit});
+
+    const std::size_t totalMcus = static_cast<std::size_t>(s.mcusX) * s.mcusY;
+    const std::size_t interval = s.restartInterval != 0 ? s.restartInterval : totalMcus;
+    const std::size_t expectedSegments = (totalMcus + interval - 1) / interval;
+    if (s.segments.size() < expectedSegments)
+    {
+        lastError_ = "MJPEG scan ends after " + std::to_string(s.segments.size()) + " of " +
+                     std::to_string(expectedSegments) + " restart intervals";
+        return false;
+    }
+
+    const bool nv12 = s.layout == Layout::Grey || s.layout == Layout::H2V2;
+    const std::uint32_t paddedWidth = s.mcusX * s.mcuWidth;
+    const std::uint32_t paddedHeight = s.mcusY * s.mcuHeight;
+    const CaptureSource::PixelFormat format = nv12 ? CaptureSource::PixelFormat::NV12 : CaptureSource::PixelFormat::YUY2;
+    s.stride = pixelFormatRowBytes(format, paddedWidth);
+    s.chromaOffset = s.stride * paddedHeight;
+    const std::size_t bytes = nv12 ? s.chromaOffset + s.chromaOffset / 2 : s.chromaOffset;
+
+    if (output_.empty() || output_.size() != bytes || output_.format() != format)
+    {
+        output_.reset();
+        output_ = pool_.acquire(bytes, format);
+        if (output_.empty())
+        {
+            lastError_ = "Frame pool cannot hold a " + std::to_string(bytes) + " byte picture";
+            return false;
+        }
+    }
+    s.output = output_.data();
+    if (s.layout == Layout::Grey)
+    {
+        std::memset(s.output + s.chromaOffset, 128, s.chromaOffset / 2);
+    }
+
+    std::atomic<std::size_t> failedSegment{expectedSegments};
+    const auto decodeSegments = [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i)
+        {
+            const std::size_t firstMcu = i * interval;
+            if (!s.decodeSegment(s.segments[i], firstMcu, std::min(interval, totalMcus - firstMcu)))
+            {
+                failedSegment.store(i, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    const std::size_t stripes = workers_ ? std::min(workers_->concurrency(), expectedSegments) : 1;
+    if (stripes > 1 && totalMcus >= kParallelMinMcus)
+    {
+        workers_->run(stripes, [&](std::size_t stripe) {
+            decodeSegments(expectedSegments * stripe / stripes, expectedSegments * (stripe + 1) / stripes);
+        });
+    }
+    else
+    {
+        decodeSegments(0, expectedSegments);
+    }
+
+    const std::size_t failed = failedSegment.load(std::memory_order_relaxed);
+    if (failed != expectedSegments)
+    {
+        lastError_ = "Corrupt MJPEG data in restart interval " + std::to_string(failed);
+        return false;
+    }
+
+    CaptureSource::Frame picture{};
+    picture.format = format;
+    // JFIF: full-range BT.601 whatever the resolution.
+    picture.matrix = CaptureSource::ColorMatrix::BT601;
+    picture.fullRange = true;
+    picture.data = s.output;
+    picture.dataSize = bytes;
+    picture.width = s.width;
+    picture.height = s.height;
+    picture.stride = static_cast<std::uint32_t>(s.stride);
+    picture.sampleWidth = paddedWidth;
+    picture.sampleHeight = paddedHeight;
+    picture.contentRight = s.width;
+    picture.contentBottom = s.height;
+    picture_ = picture;
+    return true;
+}
+
+bool MjpegDecoder::probe(const std::uint8_t* data, std::size_t size, std::uint32_t& width, std::uint32_t& height)
+{
+    if (!data || !startsWithSoi(data, size))
+    {
+        return false;
+    }
+    bool found = false;
+    walkSegments(data, size, 2, [&](std::uint8_t marker, const std::uint8_t* payload, std::size_t payloadSize, std::size_t) {
+        if ((marker == kSof0 || marker == kSof1) && payloadSize >= 5)
+        {
+            height = readU16(payload + 1);
+            width = readU16(payload + 3);
+            found = width != 0 && height != 0;
+            return false;
+        }
+        return marker != kSos;
+    });
+    return found;
+}
+
+std::size_t MjpegDecoder::frameLength(const std::uint8_t* data, std::size_t size)
+{
+    if (!data || !startsWithSoi(data, size))
+    {
+        return 0;
+    }
+    return walkSegments(data, size, 2, [](std::uint8_t, const std::uint8_t*, std::size_t, std::size_t) { return true; });
+}
@@ -17,6 +17,19 @@
 
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+namespace
+{
+    constexpr UINT_PTR kTimerOverlayRefresh = 0x7102;
+
+    // Messages that can change what the menu shows.
+    bool changesOverlay(UINT msg)
+    {
+        return (msg >= WM_MOUSEFIRST && msg <= WM_MOUSELAST) ||
+               (msg >= WM_KEYFIRST && msg <= WM_KEYLAST) ||
+               msg == WM_MOUSELEAVE || msg == WM_SETFOCUS || msg == WM_KILLFOCUS || msg == WM_SIZE;
+    }
+}
+
 OverlayUI::~OverlayUI()
 {
     shutdown();
@@ -65,12 +78,36 @@ void OverlayUI::shutdown()
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
 
+    if (menuVisible_)
+    {
+        KillTimer(hwnd_, kTimerOverlayRefresh);
+    }
     initialized_ = false;
     menuVisible_ = false;
     srvHeap_ = nullptr;
     renderer_ = nullptr;
     drawData_ = nullptr;
     drawDataValid_ = false;
+    pendingFrames_ = 0;
+}
+
+void OverlayUI::markDirty()
+{
+    pendingFrames_ = kSettleFrames;
+}
+
+bool OverlayUI::updateFrame(Application& app)
+{
+    if (!needsUpdate())
+    {
+        return false;
+    }
+
+    --pendingFrames_;
+    newFrame();
+    buildUI(app);
+    endFrame();
+    return true;
 }
 
 void OverlayUI::newFrame()
@@ -105,28 +142,22 @@ void OverlayUI::endFrame()
         return;
     }
 
+    // ImGui keeps the draw data until the next NewFrame().
     ImGui::Render();
     drawData_ = ImGui::GetDrawData();
-    drawDataValid_ = (drawData_ != nullptr) && (drawData_->CmdListsCount > 0);
+    drawDataValid_ = menuVisible_ && (drawData_ != nullptr) && (drawData_->CmdListsCount > 0);
 }
 
 void OverlayUI::render(ID3D12GraphicsCommandList* commandList)
 {
-    if (!initialized_ || !drawData_)
+    if (!initialized_ || !hasDrawData())
     {
-        drawDataValid_ = false;
         return;
     }
 
-    if (drawData_->CmdListsCount > 0)
-    {
-        ID3D12DescriptorHeap* heaps[] = {srvHeap_};
-        commandList->SetDescriptorHeaps(1, heaps);
-        ImGui_ImplDX12_RenderDrawData(drawData_, commandList);
-    }
-
-    drawData_ = nullptr;
-    drawDataValid_ = false;
+    ID3D12DescriptorHeap* heaps[] = {srvHeap_};
+    commandList->SetDescriptorHeaps(1, heaps);
+    ImGui_ImplDX12_RenderDrawData(drawData_, commandList);
 }
 
 bool OverlayUI::processEvent(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -135,8 +166,22 @@ bool OverlayUI::processEvent(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     {
         return false;
     }
-    bool handled = ImGui_ImplWin32_WndProcHandler(hwnd, msg, wParam, lParam);
-    return menuVisible_ && handled;
+    // ImGui queues input until the next frame, and a hidden menu has none.
+    if (!menuVisible_)
+    {
+        return false;
+    }
+    if (msg == WM_TIMER && wParam == kTimerOverlayRefresh)
+    {
+        // New numbers need no settling.
+        pendingFrames_ = std::max(pendingFrames_, 1u);
+        return true;
+    }
+    if (changesOverlay(msg))
+    {
+        markDirty();
+    }
+    return ImGui_ImplWin32_WndProcHandler(hwnd, msg, wParam, lParam) != 0;
 }
 
 void OverlayUI::toggleMenu(Application& app)
@@ -167,6 +212,8 @@ void OverlayUI::hideMenu(Application& app)
     }
     menuVisible_ = false;
     drawDataValid_ = false;
+    pendingFrames_ = 0;
+    KillTimer(hwnd_, kTimerOverlayRefresh);
     PostMessage(hwnd_, WM_INPUT_CAPTURE_UPDATE_CLIP, 1, 0);
     ImGui::GetIO().MouseDrawCursor = false;
     app.requestImmediateRender();
@@ -181,7 +228,11 @@ void OverlayUI::showMenu(Application& app)
     menuVisible_ = true;
     refreshDeviceLists(app);
     PostMessage(hwnd_, WM_INPUT_CAPTURE_UPDATE_CLIP, 0, 0);
+    // Keys held when the menu last closed were never seen to go up.
+    ImGui::GetIO().ClearInputKeys();
     ImGui::GetIO().MouseDrawCursor = true;
+    SetTimer(hwnd_, kTimerOverlayRefresh, kLiveRefreshMs, nullptr);
+    markDirty();
     app.requestImmediateRender();
 }
 
@@ -360,6 +411,89 @@ void OverlayUI::drawMenuWindow(Application& app)
         app.setVideoAspectMode(static_cast<VideoAspectMode>(currentAspect));
     }
 
+    static const char* filterOptions[] = {
+        scalingFilterName(ScalingFilter::Bilinear),
+        scalingFilterName(ScalingFilter::Nearest),
+        scalingFilterName(ScalingFilter::Bicubic),
+        scalingFilterName(ScalingFilter::Lanczos3),
+        scalingFilterName(ScalingFilter::Sharpen),
+    };
+    int currentFilter = static_cast<int>(app.settings().videoScalingFilter);
+    if (ImGui::Combo("Scaling Filter", &currentFilter, filterOptions, IM_ARRAYSIZE(filterOptions)))
+    {
+        currentFilter = std::clamp(currentFilter, 0, static_cast<int>(kScalingFilterCount) - 1);
+        app.setVideoScalingFilter(static_cast<ScalingFilter>(currentFilter));
+    }
+
+    bool downscale = app.settings().videoDownscale;
+    if (ImGui::Checkbox("Downscale Before Upload", &downscale))
+    {
+        app.setVideoDownscale(downscale);
+    }
+
+    bool presentPacing = app.settings().videoPresentPacing;
+    if (ImGui::Checkbox("Pace Presents to Capture", &presentPacing))
+    {
+        app.setVideoPresentPacing(presentPacing);
+    }
+
+    static const char* hdrInputOptions[] = {"Auto", "On (PQ)", "Off (SDR)"};
+    int currentHdrInput = static_cast<int>(app.settings().hdrInput);
+    if (ImGui::Combo("HDR Input", &currentHdrInput, hdrInputOptions, IM_ARRAYSIZE(hdrInputOptions)))
+    {
+        currentHdrInput = std::clamp(currentHdrInput, 0, 2);
+        app.setHdrInput(static_cast<HdrInputMode>(currentHdrInput));
+    }
+
+    // Only affects HDR10 (P010) capture.
+    static const char* toneMapOptions[] = {"Reinhard", "Hable", "Clip"};
+    int currentCurve = static_cast<int>(app.settings().hdrToneMapCurve);
+    if (!hdrPeakEditing_)
+    {
+        hdrPeakDraft_ = static_cast<int>(app.settings().hdrPeakNits);
+    }
+    bool toneMapChanged = ImGui::Combo("HDR Tone Map", &currentCurve, toneMapOptions, IM_ARRAYSIZE(toneMapOptions));
+    ImGui::SliderInt("HDR Peak (nits)", &hdrPeakDraft_, 203, 10000, "%d", ImGuiSliderFlags_Logarithmic);
+    hdrPeakEditing_ = ImGui::IsItemActive();
+    toneMapChanged = ImGui::IsItemDeactivatedAfterEdit() || toneMapChanged;
+    if (toneMapChanged)
+    {
+        currentCurve = std::clamp(currentCurve, 0, 2);
+        hdrPeakDraft_ = std::clamp(hdrPeakDraft_, 203, 10000);
+        app.setHdrToneMapping(static_cast<ToneMapCurve>(currentCurve), static_cast<unsigned int>(hdrPeakDraft_));
+    }
+
+    static const char* screenshotOptions[] = {"PNG", "QOI", "PNG + QOI"};
+    int currentScreenshotFormat = static_cast<int>(app.settings().screenshotFormat);
+    if (ImGui::Combo("Screenshot Format", &currentScreenshotFormat, screenshotOptions, IM_ARRAYSIZE(screenshotOptions)))
+    {
+        currentScreenshotFormat = std::clamp(currentScreenshotFormat, 0, 2);
+        app.setScreenshotFormat(static_cast<ScreenshotFormat>(currentScreenshotFormat));
+    }
+    if (ImGui::Button("Save Screenshot (Ctrl+Alt+S)"))
+    {
+        app.takeScreenshot();
+    }
+
+    bool sessionRecording = app.settings().sessionRecording;
+    if (ImGui::Checkbox("Record Session", &sessionRecording))
+    {
+        app.setSessionRecording(sessionRecording);
+    }
+    const SessionRecorder& recorder = app.sessionRecorder();
+    if (recorder.recording())
+    {
+        const SessionRecorderStats stats = recorder.stats();
+        ImGui::Text("Recorded %llu frames, dropped %llu, %.1f MB",
+                    static_cast<unsigned long long>(stats.framesRecorded),
+                    static_cast<unsigned long long>(stats.framesDropped),
+                    static_cast<double>(stats.fileBytes) / (1024.0 * 1024.0));
+    }
+    else if (app.settings().sessionRecording && !recorder.error().empty())
+    {
+        ImGui::TextDisabled("Recording stopped: %s", recorder.error().c_str());
+    }
+
     ImGui::Spacing();
 
     if (ImGui::Button("Refresh Devices"))
@@ -440,6 +574,7 @@ void OverlayUI::drawMenuWindow(Application& app)
     if (signalWidth != 0 && signalHeight != 0)
     {
         ImGui::Text("Current Signal: %ux%u", signalWidth, signalHeight);
+        ImGui::Text("Unchanged Frames Skipped: %llu", static_cast<unsigned long long>(app.framesSkipped()));
     }
     else
     {
@@ -497,6 +632,47 @@ void OverlayUI::drawMenuWindow(Application& app)
     }
     ImGui::EndChild();
 
+    ImGui::Spacing();
+
+    ImGui::TextUnformatted("Latency (ms)");
+    ImGui::Separator();
+    const LatencyTracker& latency = app.latency();
+    if (latency.histogram(LatencyStage::Total).count() == 0)
+    {
+        ImGui::TextDisabled("No frames presented yet");
+    }
+    else if (ImGui::BeginTable("Latency", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+        ImGui::TableSetupColumn("Stage", ImGuiTableColumnFlags_WidthStretch, 2.0f);
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("p99.9");
+        ImGui::TableHeadersRow();
+        for (std::size_t i = 0; i < LatencyTracker::kStageCount; ++i)
+        {
+            const auto stage = static_cast<LatencyStage>(i);
+            const LatencyHistogram& histogram = latency.histogram(stage);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(LatencyTracker::stageName(stage));
+            for (double quantile : {0.5, 0.99, 0.999})
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", static_cast<double>(histogram.valueAtQuantile(quantile)) / 1e6);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    const PresentPacer& pacer = app.presentPacer();
+    if (pacer.framesShown() != 0)
+    {
+        ImGui::Text("Frames shown %llu, dropped %llu, repeated %llu",
+                    static_cast<unsigned long long>(pacer.framesShown()),
+                    static_cast<unsigned long long>(pacer.framesDropped()),
+                    static_cast<unsigned long long>(pacer.framesRepeated()));
+    }
+
     if (ImGui::IsKeyReleased(ImGuiKey_Escape))
     {
         hideMenu(app);
@@ -20,11 +20,17 @@ public:
     bool initialize(HWND hwnd, D3DRenderer& renderer);
     void shutdown();
 
-    void newFrame();
-    void buildUI(Application& app);
-    void endFrame();
+    // Rebuilds the menu when it is open and something changed: input, a
+    // show, the live statistics refresh, or a settling frame after any of
+    // those. Returns whether new draw data was built. While the menu is
+    // hidden nothing is built at all.
+    bool updateFrame(Application& app);
+    // Draws the newest draw data, which is kept until the next rebuild, so
+    // a present for video alone reuses it.
     void render(ID3D12GraphicsCommandList* commandList);
-    bool hasDrawData() const { return drawDataValid_; }
+    bool hasDrawData() const { return menuVisible_ && drawDataValid_; }
+    bool needsUpdate() const { return initialized_ && menuVisible_ && pendingFrames_ != 0; }
+    void markDirty();
 
     bool processEvent(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -38,6 +44,15 @@ private:
         unsigned int suggestedBaud = 6000000;
     };
 
+    // Frames built after a change: ImGui shows hover and click results one
+    // frame after the input that caused them.
+    static constexpr unsigned kSettleFrames = 3;
+    // Statistics in the menu (latency, signal, pacing) redraw this often.
+    static constexpr UINT kLiveRefreshMs = 250;
+
+    void newFrame();
+    void buildUI(Application& app);
+    void endFrame();
     void showMenu(Application& app);
     void refreshDeviceLists(Application& app);
     void refreshVideoModes(Application& app);
@@ -47,6 +62,10 @@ private:
     bool initialized_ = false;
     bool menuVisible_ = false;
     bool drawDataValid_ = false;
+    unsigned pendingFrames_ = 0;
+    // Slider value while it is being dragged; settings change on release.
+    int hdrPeakDraft_ = 0;
+    bool hdrPeakEditing_ = false;
 
     D3DRenderer* renderer_ = nullptr;
     ID3D12DescriptorHeap* srvHeap_ = nullptr;
@@ -0,0 +1,962 @@
+#include "PixelConversion.hpp"
+#include "CopyKernels.hpp"
+#include "KernelRegistry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_CONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PCKVM_CONVERT_TARGET(features)
+#else
+#define PCKVM_CONVERT_TARGET(features) __attribute__((target(features)))
+#endif
+#else
+#define PCKVM_CONVERT_X86 0
+#endif
+
+namespace
+{
+    constexpr int kFractionBits = 13;
+
+    // 10-bit samples keep their two extra bits through the matrix and drop
+    // them in the final shift.
+    template <bool TenBit>
+    struct SampleDepth {
+        static constexpr int kExtraBits = TenBit ? 2 : 0;
+        static constexpr int kShift = kFractionBits + kExtraBits;
+        static constexpr std::int32_t kRounding = 1 << (kShift - 1);
+        static constexpr std::int32_t kChromaBias = 128 << kExtraBits;
+    };
+
+    template <int Shift>
+    std::uint8_t clampChannel(std::int32_t value)
+    {
+        return static_cast<std::uint8_t>(std::clamp(value >> Shift, 0, 255));
+    }
+
+    template <int Shift>
+    void storeBgraPixel(std::uint8_t* dst, std::int32_t luma, std::int32_t cb, std::int32_t cr, const YuvCoefficients& c)
+    {
+        dst[0] = clampChannel<Shift>(luma + c.cbToB * cb);
+        dst[1] = clampChannel<Shift>(luma - c.cbToG * cb - c.crToG * cr);
+        dst[2] = clampChannel<Shift>(luma + c.crToR * cr);
+        dst[3] = 0xFF;
+    }
+
+    template <bool Uyvy>
+    void convertPacked422Scalar(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels, const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<false>;
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            const std::uint8_t* pair = src + (i / 2) * 4;
+            const std::int32_t y = Uyvy ? pair[1 + (i & 1) * 2] : pair[(i & 1) * 2];
+            const std::int32_t cb = static_cast<std::int32_t>(Uyvy ? pair[0] : pair[1]) - Depth::kChromaBias;
+            const std::int32_t cr = static_cast<std::int32_t>(Uyvy ? pair[2] : pair[3]) - Depth::kChromaBias;
+            const std::int32_t luma = (y - c.lumaOffset) * c.lumaScale + Depth::kRounding;
+            storeBgraPixel<Depth::kShift>(dst + i * 4, luma, cb, cr, c);
+        }
+    }
+
+    template <bool TenBit>
+    std::int32_t loadSample(const std::uint8_t* plane, std::size_t index)
+    {
+        if constexpr (TenBit)
+        {
+            const std::uint8_t* p = plane + index * 2;
+            return (static_cast<std::int32_t>(p[0]) | (static_cast<std::int32_t>(p[1]) << 8)) >> 6;
+        }
+        else
+        {
+            return plane[index];
+        }
+    }
+
+    template <bool TenBit>
+    void convertSemiPlanarScalar(std::uint8_t* dst,
+                                 const std::uint8_t* lumaPlane,
+                                 const std::uint8_t* chromaPlane,
+                                 std::size_t pixels,
+                                 const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<TenBit>;
+        const std::int32_t lumaOffset = static_cast<std::int32_t>(c.lumaOffset) << Depth::kExtraBits;
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            const std::int32_t y = loadSample<TenBit>(lumaPlane, i);
+            const std::int32_t cb = loadSample<TenBit>(chromaPlane, (i & ~std::size_t{1})) - Depth::kChromaBias;
+            const std::int32_t cr = loadSample<TenBit>(chromaPlane, (i | 1)) - Depth::kChromaBias;
+            const std::int32_t luma = (y - lumaOffset) * c.lumaScale + Depth::kRounding;
+            storeBgraPixel<Depth::kShift>(dst + i * 4, luma, cb, cr, c);
+        }
+    }
+
+    void expandRgb24Scalar(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels)
+    {
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            dst[i * 4 + 0] = src[i * 3 + 0];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2];
+            dst[i * 4 + 3] = 0xFF;
+        }
+    }
+
+    void expandRgb565Scalar(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels)
+    {
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            const unsigned int value = src[i * 2] | (static_cast<unsigned int>(src[i * 2 + 1]) << 8);
+            const unsigned int blue = value & 0x1F;
+            const unsigned int green = (value >> 5) & 0x3F;
+            const unsigned int red = value >> 11;
+            dst[i * 4 + 0] = static_cast<std::uint8_t>((blue << 3) | (blue >> 2));
+            dst[i * 4 + 1] = static_cast<std::uint8_t>((green << 2) | (green >> 4));
+            dst[i * 4 + 2] = static_cast<std::uint8_t>((red << 3) | (red >> 2));
+            dst[i * 4 + 3] = 0xFF;
+        }
+    }
+
+    // A v210 block is four little-endian words of three 10-bit samples each,
+    // in the order Cb0 Y0 Cr0 Y1 Cb2 Y2 Cr2 Y3 Cb4 Y4 Cr4 Y5: UYVY, ten bits deep.
+    std::int32_t v210Sample(const std::uint8_t* block, std::size_t index)
+    {
+        const std::uint8_t* word = block + (index / 3) * 4;
+        const std::uint32_t value = word[0] | (static_cast<std::uint32_t>(word[1]) << 8) |
+                                    (static_cast<std::uint32_t>(word[2]) << 16) | (static_cast<std::uint32_t>(word[3]) << 24);
+        return static_cast<std::int32_t>((value >> ((index % 3) * 10)) & 0x3FF);
+    }
+
+    void convertV210Scalar(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels, const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<true>;
+        const std::int32_t lumaOffset = static_cast<std::int32_t>(c.lumaOffset) << Depth::kExtraBits;
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            const std::uint8_t* block = src + (i / 6) * 16;
+            const std::size_t column = i % 6;
+            const std::size_t pair = (column / 2) * 4;
+            const std::int32_t y = v210Sample(block, column * 2 + 1);
+            const std::int32_t cb = v210Sample(block, pair) - Depth::kChromaBias;
+            const std::int32_t cr = v210Sample(block, pair + 2) - Depth::kChromaBias;
+            const std::int32_t luma = (y - lumaOffset) * c.lumaScale + Depth::kRounding;
+            storeBgraPixel<Depth::kShift>(dst + i * 4, luma, cb, cr, c);
+        }
+    }
+
+#if PCKVM_CONVERT_X86
+    // Two int16 multipliers for _mm_madd_epi16: `low` for the even lane of each
+    // pair, `high` for the odd one.
+    std::int32_t maddPair(std::int32_t low, std::int32_t high)
+    {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(static_cast<std::uint16_t>(low)) |
+                                         (static_cast<std::uint32_t>(static_cast<std::uint16_t>(high)) << 16));
+    }
+
+    // Luma is paired with a constant 1 so a single madd applies both the scale
+    // and the rounding term; chroma pairs are (Cb, Cr) as every format stores them.
+    struct MaddConstants {
+        std::int32_t luma;
+        std::int32_t blue;
+        std::int32_t green;
+        std::int32_t red;
+    };
+
+    template <bool TenBit>
+    MaddConstants maddConstants(const YuvCoefficients& c)
+    {
+        return {maddPair(c.lumaScale, SampleDepth<TenBit>::kRounding),
+                maddPair(c.cbToB, 0),
+                maddPair(-c.cbToG, -c.crToG),
+                maddPair(0, c.crToR)};
+    }
+
+    // Four pixels of 32-bit luma and per-pixel chroma terms -> 16 BGRA bytes.
+    template <int Shift>
+    PCKVM_CONVERT_TARGET("ssse3")
+    __m128i packBgra(__m128i luma, __m128i blue, __m128i green, __m128i red)
+    {
+        const __m128i b = _mm_srai_epi32(_mm_add_epi32(luma, blue), Shift);
+        const __m128i g = _mm_srai_epi32(_mm_add_epi32(luma, green), Shift);
+        const __m128i r = _mm_srai_epi32(_mm_add_epi32(luma, red), Shift);
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(b, g), _mm_packs_epi32(r, _mm_set1_epi32(0xFF)));
+        return _mm_shuffle_epi8(bytes, _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    }
+
+    struct SsseConstants {
+        __m128i luma;
+        __m128i blue;
+        __m128i green;
+        __m128i red;
+        __m128i ones;
+    };
+
+    template <bool TenBit>
+    PCKVM_CONVERT_TARGET("ssse3")
+    SsseConstants ssseConstants(const YuvCoefficients& c)
+    {
+        const MaddConstants k = maddConstants<TenBit>(c);
+        return {_mm_set1_epi32(k.luma), _mm_set1_epi32(k.blue), _mm_set1_epi32(k.green), _mm_set1_epi32(k.red), _mm_set1_epi16(1)};
+    }
+
+    // Eight pixels from bias-free int16 luma and four (Cb, Cr) pairs -> 32 BGRA bytes.
+    template <bool TenBit>
+    PCKVM_CONVERT_TARGET("ssse3")
+    void storeEightPixels(std::uint8_t* dst, __m128i luma, __m128i chroma, const SsseConstants& k)
+    {
+        constexpr int kShift = SampleDepth<TenBit>::kShift;
+        const __m128i lumaLow = _mm_madd_epi16(_mm_unpacklo_epi16(luma, k.ones), k.luma);
+        const __m128i lumaHigh = _mm_madd_epi16(_mm_unpackhi_epi16(luma, k.ones), k.luma);
+        // One chroma term per pixel pair, duplicated to both pixels.
+        const __m128i blue = _mm_madd_epi16(chroma, k.blue);
+        const __m128i green = _mm_madd_epi16(chroma, k.green);
+        const __m128i red = _mm_madd_epi16(chroma, k.red);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         packBgra<kShift>(lumaLow, _mm_unpacklo_epi32(blue, blue), _mm_unpacklo_epi32(green, green), _mm_unpacklo_epi32(red, red)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+                         packBgra<kShift>(lumaHigh, _mm_unpackhi_epi32(blue, blue), _mm_unpackhi_epi32(green, green), _mm_unpackhi_epi32(red, red)));
+    }
+
+    template <bool Uyvy>
+    PCKVM_CONVERT_TARGET("ssse3")
+    void convertPacked422Ssse3(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels, const YuvCoefficients& c)
+    {
+        const SsseConstants k = ssseConstants<false>(c);
+        const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+        const __m128i lumaBias = _mm_set1_epi16(c.lumaOffset);
+        const __m128i chromaBias = _mm_set1_epi16(SampleDepth<false>::kChromaBias);
+
+        std::size_t i = 0;
+        for (; i + 8 <= pixels; i += 8)
+        {
+            const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            const __m128i luma = Uyvy ? _mm_srli_epi16(packed, 8) : _mm_and_si128(packed, lowBytes);
+            const __m128i chroma = Uyvy ? _mm_and_si128(packed, lowBytes) : _mm_srli_epi16(packed, 8);
+            storeEightPixels<false>(dst + i * 4, _mm_sub_epi16(luma, lumaBias), _mm_sub_epi16(chroma, chromaBias), k);
+        }
+        convertPacked422Scalar<Uyvy>(dst + i * 4, src + i * 2, pixels - i, c);
+    }
+
+    template <bool TenBit>
+    PCKVM_CONVERT_TARGET("ssse3")
+    void convertSemiPlanarSsse3(std::uint8_t* dst,
+                                const std::uint8_t* lumaPlane,
+                                const std::uint8_t* chromaPlane,
+                                std::size_t pixels,
+                                const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<TenBit>;
+        const SsseConstants k = ssseConstants<TenBit>(c);
+        const __m128i lumaBias = _mm_set1_epi16(static_cast<std::int16_t>(c.lumaOffset << Depth::kExtraBits));
+        const __m128i chromaBias = _mm_set1_epi16(Depth::kChromaBias);
+        const __m128i zero = _mm_setzero_si128();
+        constexpr std::size_t kSampleBytes = TenBit ? 2 : 1;
+
+        std::size_t i = 0;
+        for (; i + 8 <= pixels; i += 8)
+        {
+            __m128i luma;
+            __m128i chroma;
+            if constexpr (TenBit)
+            {
+                luma = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lumaPlane + i * 2)), 6);
+                chroma = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(chromaPlane + i * 2)), 6);
+            }
+            else
+            {
+                luma = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lumaPlane + i)), zero);
+                chroma = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(chromaPlane + i)), zero);
+            }
+            storeEightPixels<TenBit>(dst + i * 4, _mm_sub_epi16(luma, lumaBias), _mm_sub_epi16(chroma, chromaBias), k);
+        }
+        convertSemiPlanarScalar<TenBit>(dst + i * 4, lumaPlane + i * kSampleBytes, chromaPlane + i * kSampleBytes, pixels - i, c);
+    }
+
+    // Pulls each 10-bit sample of a block into a 16-bit lane: the shuffle
+    // gathers the two bytes it straddles, the multiply lines every sample up
+    // at bit 4 and the shift and mask drop its neighbours.
+    struct V210Unpack {
+        __m128i gatherLow;
+        __m128i alignLow;
+        __m128i gatherHigh;
+        __m128i alignHigh;
+        __m128i mask;
+    };
+
+    PCKVM_CONVERT_TARGET("ssse3")
+    V210Unpack v210Unpack()
+    {
+        return {_mm_setr_epi8(0, 1, 1, 2, 2, 3, 4, 5, 5, 6, 6, 7, 8, 9, 9, 10),
+                _mm_setr_epi16(16, 4, 1, 16, 4, 1, 16, 4),
+                _mm_setr_epi8(10, 11, 12, 13, 13, 14, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1),
+                _mm_setr_epi16(1, 16, 4, 1, 0, 0, 0, 0),
+                _mm_set1_epi16(0x3FF)};
+    }
+
+    // Samples 0-7 of the block.
+    PCKVM_CONVERT_TARGET("ssse3")
+    __m128i v210SamplesLow(__m128i block, const V210Unpack& u)
+    {
+        const __m128i aligned = _mm_mullo_epi16(_mm_shuffle_epi8(block, u.gatherLow), u.alignLow);
+        return _mm_and_si128(_mm_srli_epi16(aligned, 4), u.mask);
+    }
+
+    // Samples 8-11 of the block in the low half.
+    PCKVM_CONVERT_TARGET("ssse3")
+    __m128i v210SamplesHigh(__m128i block, const V210Unpack& u)
+    {
+        const __m128i aligned = _mm_mullo_epi16(_mm_shuffle_epi8(block, u.gatherHigh), u.alignHigh);
+        return _mm_and_si128(_mm_srli_epi16(aligned, 4), u.mask);
+    }
+
+    // Two runs of eight samples, four pixels each, split into luma and
+    // (Cb, Cr) pairs.
+    PCKVM_CONVERT_TARGET("ssse3")
+    void splitV210(__m128i first, __m128i second, __m128i lumaBias, __m128i chromaBias, __m128i& luma, __m128i& chroma)
+    {
+        const __m128i lowWords = _mm_set1_epi32(0xFFFF);
+        luma = _mm_sub_epi16(_mm_packs_epi32(_mm_srli_epi32(first, 16), _mm_srli_epi32(second, 16)), lumaBias);
+        chroma = _mm_sub_epi16(_mm_packs_epi32(_mm_and_si128(first, lowWords), _mm_and_si128(second, lowWords)), chromaBias);
+    }
+
+    // 24 pixels from four blocks; each block's 12 samples are regrouped
+    // into runs of eight that start on a pixel pair.
+    PCKVM_CONVERT_TARGET("ssse3")
+    void convertV210Ssse3(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels, const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<true>;
+        const SsseConstants k = ssseConstants<true>(c);
+        const V210Unpack u = v210Unpack();
+        const __m128i lumaBias = _mm_set1_epi16(static_cast<std::int16_t>(c.lumaOffset << Depth::kExtraBits));
+        const __m128i chromaBias = _mm_set1_epi16(Depth::kChromaBias);
+
+        std::size_t i = 0;
+        for (; i + 24 <= pixels; i += 24)
+        {
+            const std::uint8_t* in = src + (i / 6) * 16;
+            __m128i low[4];
+            __m128i high[4];
+            for (int block = 0; block < 4; ++block)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + block * 16));
+                low[block] = v210SamplesLow(bytes, u);
+                high[block] = v210SamplesHigh(bytes, u);
+            }
+            __m128i luma;
+            __m128i chroma;
+            std::uint8_t* out = dst + i * 4;
+            splitV210(low[0], _mm_unpacklo_epi64(high[0], low[1]), lumaBias, chromaBias, luma, chroma);
+            storeEightPixels<true>(out, luma, chroma, k);
+            splitV210(_mm_alignr_epi8(high[1], low[1], 8), low[2], lumaBias, chromaBias, luma, chroma);
+            storeEightPixels<true>(out + 32, luma, chroma, k);
+            splitV210(_mm_unpacklo_epi64(high[2], low[3]), _mm_alignr_epi8(high[3], low[3], 8), lumaBias, chromaBias, luma, chroma);
+            storeEightPixels<true>(out + 64, luma, chroma, k);
+        }
+        convertV210Scalar(dst + i * 4, src + (i / 6) * 16, pixels - i, c);
+    }
+
+    // Pixels 0-3 of a 16-byte load to BGRA; the alpha bytes are zeroed for
+    // the caller to fill.
+    PCKVM_CONVERT_TARGET("ssse3")
+    __m128i spreadRgb24(__m128i bytes)
+    {
+        return _mm_shuffle_epi8(bytes, _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+    }
+
+    // 16 pixels from exactly 48 bytes: the loads are realigned so each
+    // shuffle starts on a pixel, and nothing past the row is read.
+    PCKVM_CONVERT_TARGET("ssse3")
+    void expandRgb24Ssse3(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels)
+    {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        std::size_t i = 0;
+        for (; i + 16 <= pixels; i += 16)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 32));
+            std::uint8_t* out = dst + i * 4;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(spreadRgb24(a), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_or_si128(spreadRgb24(_mm_alignr_epi8(b, a, 12)), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), _mm_or_si128(spreadRgb24(_mm_alignr_epi8(c, b, 8)), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 48), _mm_or_si128(spreadRgb24(_mm_srli_si128(c, 4)), alpha));
+        }
+        expandRgb24Scalar(dst + i * 4, src + i * 3, pixels - i);
+    }
+
+    // Each channel is widened in its own 16-bit lane, then B | G << 8 and
+    // R | 0xFF00 words interleave into BGRA.
+    PCKVM_CONVERT_TARGET("ssse3")
+    void expandRgb565Ssse3(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels)
+    {
+        const __m128i low5 = _mm_set1_epi16(0x1F);
+        const __m128i low6 = _mm_set1_epi16(0x3F);
+        const __m128i alpha = _mm_set1_epi16(static_cast<std::int16_t>(0xFF00));
+        std::size_t i = 0;
+        for (; i + 8 <= pixels; i += 8)
+        {
+            const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            const __m128i blue5 = _mm_and_si128(words, low5);
+            const __m128i green6 = _mm_and_si128(_mm_srli_epi16(words, 5), low6);
+            const __m128i red5 = _mm_srli_epi16(words, 11);
+            const __m128i blue = _mm_or_si128(_mm_slli_epi16(blue5, 3), _mm_srli_epi16(blue5, 2));
+            const __m128i green = _mm_or_si128(_mm_slli_epi16(green6, 2), _mm_srli_epi16(green6, 4));
+            const __m128i red = _mm_or_si128(_mm_slli_epi16(red5, 3), _mm_srli_epi16(red5, 2));
+            const __m128i blueGreen = _mm_or_si128(blue, _mm_slli_epi16(green, 8));
+            const __m128i redAlpha = _mm_or_si128(red, alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_unpacklo_epi16(blueGreen, redAlpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), _mm_unpackhi_epi16(blueGreen, redAlpha));
+        }
+        expandRgb565Scalar(dst + i * 4, src + i * 2, pixels - i);
+    }
+
+    template <int Shift>
+    PCKVM_CONVERT_TARGET("avx2")
+    __m256i packBgraAvx2(__m256i luma, __m256i blue, __m256i green, __m256i red)
+    {
+        const __m256i b = _mm256_srai_epi32(_mm256_add_epi32(luma, blue), Shift);
+        const __m256i g = _mm256_srai_epi32(_mm256_add_epi32(luma, green), Shift);
+        const __m256i r = _mm256_srai_epi32(_mm256_add_epi32(luma, red), Shift);
+        const __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(b, g), _mm256_packs_epi32(r, _mm256_set1_epi32(0xFF)));
+        return _mm256_shuffle_epi8(bytes, _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                                           0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    }
+
+    struct AvxConstants {
+        __m256i luma;
+        __m256i blue;
+        __m256i green;
+        __m256i red;
+        __m256i ones;
+    };
+
+    template <bool TenBit>
+    PCKVM_CONVERT_TARGET("avx2")
+    AvxConstants avxConstants(const YuvCoefficients& c)
+    {
+        const MaddConstants k = maddConstants<TenBit>(c);
+        return {_mm256_set1_epi32(k.luma), _mm256_set1_epi32(k.blue), _mm256_set1_epi32(k.green), _mm256_set1_epi32(k.red), _mm256_set1_epi16(1)};
+    }
+
+    // Same arithmetic as storeEightPixels on 16 pixels. Every 128-bit lane
+    // holds eight pixels and their four chroma pairs; lane 0 is stored to
+    // `lane0` and lane 1 to `lane1`.
+    template <bool TenBit>
+    PCKVM_CONVERT_TARGET("avx2")
+    void storeSixteenPixels(std::uint8_t* lane0, std::uint8_t* lane1, __m256i luma, __m256i chroma, const AvxConstants& k)
+    {
+        constexpr int kShift = SampleDepth<TenBit>::kShift;
+        const __m256i lumaLow = _mm256_madd_epi16(_mm256_unpacklo_epi16(luma, k.ones), k.luma);
+        const __m256i lumaHigh = _mm256_madd_epi16(_mm256_unpackhi_epi16(luma, k.ones), k.luma);
+        const __m256i blue = _mm256_madd_epi16(chroma, k.blue);
+        const __m256i green = _mm256_madd_epi16(chroma, k.green);
+        const __m256i red = _mm256_madd_epi16(chroma, k.red);
+
+        // Per lane: `first` holds pixels 0-3 of the lane, `second` pixels 4-7.
+        const __m256i first = packBgraAvx2<kShift>(lumaLow,
+                                                   _mm256_unpacklo_epi32(blue, blue),
+                                                   _mm256_unpacklo_epi32(green, green),
+                                                   _mm256_unpacklo_epi32(red, red));
+        const __m256i second = packBgraAvx2<kShift>(lumaHigh,
+                                                    _mm256_unpackhi_epi32(blue, blue),
+                                                    _mm256_unpackhi_epi32(green, green),
+                                                    _mm256_unpackhi_epi32(red, red));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lane0), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lane1), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+
+    template <bool Uyvy>
+    PCKVM_CONVERT_TARGET("avx2")
+    void convertPacked422Avx2(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels, const YuvCoefficients& c)
+    {
+        const AvxConstants k = avxConstants<false>(c);
+        const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+        const __m256i lumaBias = _mm256_set1_epi16(c.lumaOffset);
+        const __m256i chromaBias = _mm256_set1_epi16(SampleDepth<false>::kChromaBias);
+
+        std::size_t i = 0;
+        for (; i + 16 <= pixels; i += 16)
+        {
+            const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+            const __m256i luma = Uyvy ? _mm256_srli_epi16(packed, 8) : _mm256_and_si256(packed, lowBytes);
+            const __m256i chroma = Uyvy ? _mm256_and_si256(packed, lowBytes) : _mm256_srli_epi16(packed, 8);
+            storeSixteenPixels<false>(dst + i * 4, dst + i * 4 + 32, _mm256_sub_epi16(luma, lumaBias), _mm256_sub_epi16(chroma, chromaBias), k);
+        }
+        convertPacked422Ssse3<Uyvy>(dst + i * 4, src + i * 2, pixels - i, c);
+    }
+
+    template <bool TenBit>
+    PCKVM_CONVERT_TARGET("avx2")
+    void convertSemiPlanarAvx2(std::uint8_t* dst,
+                               const std::uint8_t* lumaPlane,
+                               const std::uint8_t* chromaPlane,
+                               std::size_t pixels,
+                               const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<TenBit>;
+        const AvxConstants k = avxConstants<TenBit>(c);
+        const __m256i lumaBias = _mm256_set1_epi16(static_cast<std::int16_t>(c.lumaOffset << Depth::kExtraBits));
+        const __m256i chromaBias = _mm256_set1_epi16(Depth::kChromaBias);
+        constexpr std::size_t kSampleBytes = TenBit ? 2 : 1;
+
+        std::size_t i = 0;
+        for (; i + 16 <= pixels; i += 16)
+        {
+            // Samples stay in order, so lane 0 gets pixels 0-7 with chroma
+            // pairs 0-3 and lane 1 the rest, as storeSixteenPixels expects.
+            __m256i luma;
+            __m256i chroma;
+            if constexpr (TenBit)
+            {
+                luma = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lumaPlane + i * 2)), 6);
+                chroma = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(chromaPlane + i * 2)), 6);
+            }
+            else
+            {
+                luma = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lumaPlane + i)));
+                chroma = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(chromaPlane + i)));
+            }
+            storeSixteenPixels<TenBit>(dst + i * 4, dst + i * 4 + 32, _mm256_sub_epi16(luma, lumaBias), _mm256_sub_epi16(chroma, chromaBias), k);
+        }
+        convertSemiPlanarSsse3<TenBit>(dst + i * 4, lumaPlane + i * kSampleBytes, chromaPlane + i * kSampleBytes, pixels - i, c);
+    }
+
+    PCKVM_CONVERT_TARGET("avx2")
+    __m256i v210SamplesLowAvx2(__m256i blocks, const V210Unpack& u)
+    {
+        const __m256i aligned = _mm256_mullo_epi16(_mm256_shuffle_epi8(blocks, _mm256_broadcastsi128_si256(u.gatherLow)),
+                                                   _mm256_broadcastsi128_si256(u.alignLow));
+        return _mm256_and_si256(_mm256_srli_epi16(aligned, 4), _mm256_broadcastsi128_si256(u.mask));
+    }
+
+    PCKVM_CONVERT_TARGET("avx2")
+    __m256i v210SamplesHighAvx2(__m256i blocks, const V210Unpack& u)
+    {
+        const __m256i aligned = _mm256_mullo_epi16(_mm256_shuffle_epi8(blocks, _mm256_broadcastsi128_si256(u.gatherHigh)),
+                                                   _mm256_broadcastsi128_si256(u.alignHigh));
+        return _mm256_and_si256(_mm256_srli_epi16(aligned, 4), _mm256_broadcastsi128_si256(u.mask));
+    }
+
+    PCKVM_CONVERT_TARGET("avx2")
+    void storeV210Avx2(std::uint8_t* lane0,
+                       std::uint8_t* lane1,
+                       __m256i first,
+                       __m256i second,
+                       __m256i lumaBias,
+                       __m256i chromaBias,
+                       const AvxConstants& k)
+    {
+        const __m256i lowWords = _mm256_set1_epi32(0xFFFF);
+        const __m256i luma = _mm256_packs_epi32(_mm256_srli_epi32(first, 16), _mm256_srli_epi32(second, 16));
+        const __m256i chroma = _mm256_packs_epi32(_mm256_and_si256(first, lowWords), _mm256_and_si256(second, lowWords));
+        storeSixteenPixels<true>(lane0, lane1, _mm256_sub_epi16(luma, lumaBias), _mm256_sub_epi16(chroma, chromaBias), k);
+    }
+
+    // convertV210Ssse3 on two runs of four blocks at once: lane 0 holds
+    // blocks 0-3 and lane 1 blocks 4-7, 24 pixels further on.
+    PCKVM_CONVERT_TARGET("avx2")
+    void convertV210Avx2(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels, const YuvCoefficients& c)
+    {
+        using Depth = SampleDepth<true>;
+        const AvxConstants k = avxConstants<true>(c);
+        const V210Unpack u = v210Unpack();
+        const __m256i lumaBias = _mm256_set1_epi16(static_cast<std::int16_t>(c.lumaOffset << Depth::kExtraBits));
+        const __m256i chromaBias = _mm256_set1_epi16(Depth::kChromaBias);
+
+        std::size_t i = 0;
+        for (; i + 48 <= pixels; i += 48)
+        {
+            const std::uint8_t* in = src + (i / 6) * 16;
+            __m256i low[4];
+            __m256i high[4];
+            for (int block = 0; block < 4; ++block)
+            {
+                const __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + block * 16))),
+                                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 64 + block * 16)),
+                                                              1);
+                low[block] = v210SamplesLowAvx2(bytes, u);
+                high[block] = v210SamplesHighAvx2(bytes, u);
+            }
+            std::uint8_t* out = dst + i * 4;
+            storeV210Avx2(out, out + 96, low[0], _mm256_unpacklo_epi64(high[0], low[1]), lumaBias, chromaBias, k);
+            storeV210Avx2(out + 32, out + 128, _mm256_alignr_epi8(high[1], low[1], 8), low[2], lumaBias, chromaBias, k);
+            storeV210Avx2(out + 64, out + 160, _mm256_unpacklo_epi64(high[2], low[3]), _mm256_alignr_epi8(high[3], low[3], 8), lumaBias, chromaBias, k);
+        }
+        convertV210Ssse3(dst + i * 4, src + (i / 6) * 16, pixels - i, c);
+    }
+
+    // Eight pixels per register: lane 0 loads at pixel 0 and lane 1 at byte
+    // 8, four bytes before pixel 4, so neither load passes byte 24.
+    PCKVM_CONVERT_TARGET("avx2")
+    void expandRgb24Avx2(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels)
+    {
+        const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        std::size_t i = 0;
+        for (; i + 8 <= pixels; i += 8)
+        {
+            const std::uint8_t* in = src + i * 3;
+            const __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+                                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8)),
+                                                          1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(bytes, spread), alpha));
+        }
+        expandRgb24Scalar(dst + i * 4, src + i * 3, pixels - i);
+    }
+
+    // Same arithmetic as expandRgb565Ssse3 on 16 pixels.
+    PCKVM_CONVERT_TARGET("avx2")
+    void expandRgb565Avx2(std::uint8_t* dst, const std::uint8_t* src, std::size_t pixels)
+    {
+        const __m256i low5 = _mm256_set1_epi16(0x1F);
+        const __m256i low6 = _mm256_set1_epi16(0x3F);
+        const __m256i alpha = _mm256_set1_epi16(static_cast<std::int16_t>(0xFF00));
+        std::size_t i = 0;
+        for (; i + 16 <= pixels; i += 16)
+        {
+            const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+            const __m256i blue5 = _mm256_and_si256(words, low5);
+            const __m256i green6 = _mm256_and_si256(_mm256_srli_epi16(words, 5), low6);
+            const __m256i red5 = _mm256_srli_epi16(words, 11);
+            const __m256i blue = _mm256_or_si256(_mm256_slli_epi16(blue5, 3), _mm256_srli_epi16(blue5, 2));
+            const __m256i green = _mm256_or_si256(_mm256_slli_epi16(green6, 2), _mm256_srli_epi16(green6, 4));
+            const __m256i red = _mm256_or_si256(_mm256_slli_epi16(red5, 3), _mm256_srli_epi16(red5, 2));
+            const __m256i blueGreen = _mm256_or_si256(blue, _mm256_slli_epi16(green, 8));
+            const __m256i redAlpha = _mm256_or_si256(red, alpha);
+            // The unpacks work per lane: `first` holds pixels 0-3 and 8-11.
+            const __m256i first = _mm256_unpacklo_epi16(blueGreen, redAlpha);
+            const __m256i second = _mm256_unpackhi_epi16(blueGreen, redAlpha);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_permute2x128_si256(first, second, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+        }
+        expandRgb565Ssse3(dst + i * 4, src + i * 2, pixels - i);
+    }
+#endif
+
+    struct Selection {
+        ConversionTier tier = ConversionTier::Scalar;
+        Packed422RowFn yuy2 = convertPacked422Scalar<false>;
+        Packed422RowFn uyvy = convertPacked422Scalar<true>;
+        SemiPlanarRowFn nv12 = convertSemiPlanarScalar<false>;
+        SemiPlanarRowFn p010 = convertSemiPlanarScalar<true>;
+        PackedRgbRowFn rgb24 = expandRgb24Scalar;
+        PackedRgbRowFn rgb565 = expandRgb565Scalar;
+        V210RowFn v210 = convertV210Scalar;
+    };
+
+    constexpr ConversionTier kConversionTiers[] = {ConversionTier::Scalar, ConversionTier::SSSE3, ConversionTier::AVX2};
+
+    // The kernels of every tier this CPU runs; a tier it cannot run keeps
+    // `available` false.
+    struct TierTable {
+        bool available[std::size(kConversionTiers)]{};
+        Selection selections[std::size(kConversionTiers)]{};
+    };
+
+    const TierTable& tierTable()
+    {
+        static const TierTable table = []() {
+            TierTable result;
+            for (ConversionTier tier : kConversionTiers)
+            {
+                Packed422RowFn yuy2 = packed422Kernel(CaptureSource::PixelFormat::YUY2, tier);
+                Packed422RowFn uyvy = packed422Kernel(CaptureSource::PixelFormat::UYVY, tier);
+                SemiPlanarRowFn nv12 = semiPlanarKernel(CaptureSource::PixelFormat::NV12, tier);
+                SemiPlanarRowFn p010 = semiPlanarKernel(CaptureSource::PixelFormat::P010, tier);
+                PackedRgbRowFn rgb24 = packedRgbKernel(CaptureSource::PixelFormat::RGB24, tier);
+                PackedRgbRowFn rgb565 = packedRgbKernel(CaptureSource::PixelFormat::RGB565, tier);
+                V210RowFn v210 = v210Kernel(tier);
+                if (yuy2 && uyvy && nv12 && p010 && rgb24 && rgb565 && v210)
+                {
+                    const auto index = static_cast<std::size_t>(tier);
+                    result.available[index] = true;
+                    result.selections[index] = Selection{tier, yuy2, uyvy, nv12, p010, rgb24, rgb565, v210};
+                }
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    // Swapped by setActiveConversionTier(); the tables never change, so a row
+    // always sees one consistent set of kernels.
+    std::atomic<ConversionTier>& activeTier()
+    {
+        static std::atomic<ConversionTier> tier = []() {
+            const TierTable& table = tierTable();
+            for (ConversionTier candidate : {ConversionTier::AVX2, ConversionTier::SSSE3})
+            {
+                if (table.available[static_cast<std::size_t>(candidate)])
+                {
+                    return candidate;
+                }
+            }
+            return ConversionTier::Scalar;
+        }();
+        return tier;
+    }
+
+    const Selection& selection()
+    {
+        return tierTable().selections[static_cast<std::size_t>(activeTier().load(std::memory_order_relaxed))];
+    }
+}
+
+YuvCoefficients yuvCoefficients(CaptureSource::ColorMatrix matrix, bool fullRange)
+{
+    double kr = 0.2126;
+    double kb = 0.0722;
+    if (matrix == CaptureSource::ColorMatrix::BT601)
+    {
+        kr = 0.299;
+        kb = 0.114;
+    }
+    else if (matrix == CaptureSource::ColorMatrix::BT2020)
+    {
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    const double kg = 1.0 - kr - kb;
+    const double lumaScale = fullRange ? 1.0 : 255.0 / 219.0;
+    const double chromaScale = fullRange ? 1.0 : 255.0 / 224.0;
+    const auto fixed = [](double value) {
+        return static_cast<std::int16_t>(std::lround(value * static_cast<double>(1 << kFractionBits)));
+    };
+
+    YuvCoefficients c;
+    c.lumaScale = fixed(lumaScale);
+    c.lumaOffset = fullRange ? 0 : 16;
+    c.crToR = fixed(2.0 * (1.0 - kr) * chromaScale);
+    c.cbToG = fixed(2.0 * kb * (1.0 - kb) / kg * chromaScale);
+    c.crToG = fixed(2.0 * kr * (1.0 - kr) / kg * chromaScale);
+    c.cbToB = fixed(2.0 * (1.0 - kb) * chromaScale);
+    return c;
+}
+
+Packed422RowFn packed422Kernel(CaptureSource::PixelFormat format, ConversionTier tier)
+{
+    const bool uyvy = format == CaptureSource::PixelFormat::UYVY;
+    if (!uyvy && format != CaptureSource::PixelFormat::YUY2)
+    {
+        return nullptr;
+    }
+
+    switch (tier)
+    {
+    case ConversionTier::Scalar:
+        return uyvy ? convertPacked422Scalar<true> : convertPacked422Scalar<false>;
+#if PCKVM_CONVERT_X86
+    case ConversionTier::SSSE3:
+        if (cpuFeatures().ssse3)
+        {
+            return uyvy ? convertPacked422Ssse3<true> : convertPacked422Ssse3<false>;
+        }
+        return nullptr;
+    case ConversionTier::AVX2:
+        if (cpuFeatures().avx2 && cpuFeatures().ssse3)
+        {
+            return uyvy ? convertPacked422Avx2<true> : convertPacked422Avx2<false>;
+        }
+        return nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+SemiPlanarRowFn semiPlanarKernel(CaptureSource::PixelFormat format, ConversionTier tier)
+{
+    const bool tenBit = format == CaptureSource::PixelFormat::P010;
+    if (!tenBit && format != CaptureSource::PixelFormat::NV12)
+    {
+        return nullptr;
+    }
+
+    switch (tier)
+    {
+    case ConversionTier::Scalar:
+        return tenBit ? convertSemiPlanarScalar<true> : convertSemiPlanarScalar<false>;
+#if PCKVM_CONVERT_X86
+    case ConversionTier::SSSE3:
+        if (cpuFeatures().ssse3)
+        {
+            return tenBit ? convertSemiPlanarSsse3<true> : convertSemiPlanarSsse3<false>;
+        }
+        return nullptr;
+    case ConversionTier::AVX2:
+        if (cpuFeatures().avx2 && cpuFeatures().ssse3)
+        {
+            return tenBit ? convertSemiPlanarAvx2<true> : convertSemiPlanarAvx2<false>;
+        }
+        return nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+PackedRgbRowFn packedRgbKernel(CaptureSource::PixelFormat format, ConversionTier tier)
+{
+    const bool rgb565 = format == CaptureSource::PixelFormat::RGB565;
+    if (!rgb565 && format != CaptureSource::PixelFormat::RGB24)
+    {
+        return nullptr;
+    }
+
+    switch (tier)
+    {
+    case ConversionTier::Scalar:
+        return rgb565 ? expandRgb565Scalar : expandRgb24Scalar;
+#if PCKVM_CONVERT_X86
+    case ConversionTier::SSSE3:
+        if (cpuFeatures().ssse3)
+        {
+            return rgb565 ? expandRgb565Ssse3 : expandRgb24Ssse3;
+        }
+        return nullptr;
+    case ConversionTier::AVX2:
+        if (cpuFeatures().avx2 && cpuFeatures().ssse3)
+        {
+            return rgb565 ? expandRgb565Avx2 : expandRgb24Avx2;
+        }
+        return nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+V210RowFn v210Kernel(ConversionTier tier)
+{
+    switch (tier)
+    {
+    case ConversionTier::Scalar:
+        return convertV210Scalar;
+#if PCKVM_CONVERT_X86
+    case ConversionTier::SSSE3:
+        return cpuFeatures().ssse3 ? convertV210Ssse3 : nullptr;
+    case ConversionTier::AVX2:
+        return cpuFeatures().avx2 && cpuFeatures().ssse3 ? convertV210Avx2 : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+ConversionTier activeConversionTier()
+{
+    return activeTier().load(std::memory_order_relaxed);
+}
+
+bool setActiveConversionTier(ConversionTier tier)
+{
+    if (!tierTable().available[static_cast<std::size_t>(tier)])
+    {
+        return false;
+    }
+    activeTier().store(tier, std::memory_order_relaxed);
+    return true;
+}
+
+const char* conversionTierName(ConversionTier tier)
+{
+    switch (tier)
+    {
+    case ConversionTier::Scalar:
+        return "scalar";
+    case ConversionTier::SSSE3:
+        return "SSSE3";
+    case ConversionTier::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+void convertRowToBgra(CaptureSource::PixelFormat format,
+                      std::uint8_t* dst,
+                      const std::uint8_t* src,
+                      std::size_t pixels,
+                      const YuvCoefficients& coefficients)
+{
+    switch (format)
+    {
+    case CaptureSource::PixelFormat::BGRA8:
+        streamCopy(dst, src, pixels * 4);
+        break;
+    case CaptureSource::PixelFormat::RGB24:
+        selection().rgb24(dst, src, pixels);
+        break;
+    case CaptureSource::PixelFormat::RGB565:
+        selection().rgb565(dst, src, pixels);
+        break;
+    case CaptureSource::PixelFormat::YUY2:
+        selection().yuy2(dst, src, pixels, coefficients);
+        break;
+    case CaptureSource::PixelFormat::UYVY:
+        selection().uyvy(dst, src, pixels, coefficients);
+        break;
+    case CaptureSource::PixelFormat::V210:
+        selection().v210(dst, src, pixels, coefficients);
+        break;
+    case CaptureSource::PixelFormat::NV12:
+    case CaptureSource::PixelFormat::P010:
+        // Needs its chroma plane; see convertSemiPlanarRowToBgra().
+    case CaptureSource::PixelFormat::MJPEG:
+        std::memset(dst, 0, pixels * 4);
+        break;
+    }
+}
+
+void convertSemiPlanarRowToBgra(CaptureSource::PixelFormat format,
+                                std::uint8_t* dst,
+                                const std::uint8_t* luma,
+                                const std::uint8_t* chroma,
+                                std::size_t pixels,
+                                const YuvCoefficients& coefficients)
+{
+    if (format == CaptureSource::PixelFormat::NV12)
+    {
+        selection().nv12(dst, luma, chroma, pixels, coefficients);
+    }
+    else if (format == CaptureSource::PixelFormat::P010)
+    {
+        selection().p010(dst, luma, chroma, pixels, coefficients);
+    }
+}
+
+void convertV210RowToBgra(std::uint8_t* dst,
+                          const std::uint8_t* src,
+                          std::size_t skip,
+                          std::size_t pixels,
+                          const YuvCoefficients& coefficients)
+{
+    const Selection& kernels = selection();
+    if (skip != 0 && pixels != 0)
+    {
+        // The block the row starts in is converted whole and trimmed.
+        std::uint8_t head[6 * 4];
+        const std::size_t count = std::min(pixels, 6 - skip);
+        kernels.v210(head, src, skip + count, coefficients);
+        std::memcpy(dst, head + skip * 4, count * 4);
+        dst += count * 4;
+        src += 16;
+        pixels -= count;
+    }
+    kernels.v210(dst, src, pixels, coefficients);
+}
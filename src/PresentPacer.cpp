@@ -0,0 +1,327 @@
+#include "PresentPacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+void CadenceTracker::reset() noexcept
+{
+    *this = CadenceTracker{};
+}
+
+void CadenceTracker::observe(std::int64_t index, std::uint64_t timeNs) noexcept
+{
+    const double time = static_cast<double>(timeNs);
+    if (events_ == 0)
+    {
+        index_ = index;
+        time_ = time;
+        events_ = 1;
+        return;
+    }
+    if (index <= index_)
+    {
+        return;
+    }
+
+    const double steps = static_cast<double>(index - index_);
+    if (events_ == 1)
+    {
+        period_ = (time - time_) / steps;
+        index_ = index;
+        time_ = time;
+        events_ = period_ > 0.0 ? 2 : 1;
+        return;
+    }
+
+    const double predicted = time_ + period_ * steps;
+    const double residual = time - predicted;
+    if (locked() && std::abs(residual) > kOutlierFraction * period_)
+    {
+        if (++outliers_ > kMaxOutliers)
+        {
+            reset();
+            observe(index, timeNs);
+        }
+        return;
+    }
+    outliers_ = 0;
+    // Single late events are clipped to four deviations so a hiccup does
+    // not widen every margin built on the spread for the next few seconds.
+    const double squared = locked() ? std::min(residual * residual, 16.0 * variance_) : residual * residual;
+    variance_ += (squared - variance_) / std::min<double>(events_ - 1, 1.0 / kSteadyGain);
+
+    // Growing-memory least squares for the first events, then fixed gains
+    // with beta = alpha^2 / (2 - alpha), which keeps the loop critically damped.
+    events_ = std::min(events_ + 1, 1u << 20);
+    const double n = static_cast<double>(events_);
+    const double alpha = std::max(2.0 * (2.0 * n - 1.0) / (n * (n + 1.0)), kSteadyGain);
+    const double beta = std::max(6.0 / (n * (n + 1.0)), kSteadyGain * kSteadyGain / (2.0 - kSteadyGain));
+    time_ = predicted + alpha * residual;
+    period_ += beta * residual / steps;
+    index_ = index;
+}
+
+double CadenceTracker::jitterNs() const noexcept
+{
+    return std::sqrt(variance_);
+}
+
+double CadenceTracker::timeOf(std::int64_t index) const noexcept
+{
+    return time_ + period_ * static_cast<double>(index - index_);
+}
+
+std::int64_t CadenceTracker::firstIndexAtOrAfter(double timeNs) const noexcept
+{
+    return index_ + static_cast<std::int64_t>(std::ceil((timeNs - time_) / period_));
+}
+
+void PresentPacer::observeFrame(std::uint64_t timestamp100ns, std::uint64_t arrivalNs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Count the frames the card skipped from the capture timestamps, or from
+    // the arrival times when the source does not stamp its samples.
+    std::int64_t steps = 1;
+    if (observed_ != 0 && source_.hasPeriod())
+    {
+        double elapsedNs = 0.0;
+        if (timestamp100ns > lastTimestamp100ns_ && lastTimestamp100ns_ != 0)
+        {
+            elapsedNs = static_cast<double>(timestamp100ns - lastTimestamp100ns_) * 100.0;
+        }
+        else if (arrivalNs > lastArrivalNs_)
+        {
+            elapsedNs = static_cast<double>(arrivalNs - lastArrivalNs_);
+        }
+        steps = std::max<std::int64_t>(std::llround(elapsedNs / source_.periodNs()), 1);
+    }
+    if (steps > kMaxFrameGap)
+    {
+        source_.reset();
+        planned_ = false;
+    }
+
+    captured_ += steps;
+    source_.observe(captured_, arrivalNs);
+    lastTimestamp100ns_ = timestamp100ns;
+    lastArrivalNs_ = arrivalNs;
+    ++observed_;
+}
+
+void PresentPacer::frameDelivered()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (observed_ == 0)
+    {
+        return;
+    }
+    frame_ = captured_;
+    frameArrivalNs_ = lastArrivalNs_;
+    ++delivered_;
+}
+
+std::uint64_t PresentPacer::presentNotBefore(std::uint64_t nowNs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (delivered_ == 0 || !source_.locked() || !display_.locked())
+    {
+        planned_ = false;
+        return 0;
+    }
+
+    const double refresh = display_.periodNs();
+    const double latch = static_cast<double>(kLatchMarginNs);
+    const double margin = latch + kJitterSigmas * source_.jitterNs();
+    const double hysteresis = static_cast<double>(kHysteresisNs);
+    const double arrival = source_.timeOf(frame_);
+
+    // The first vblank with the margin, unless the previous frame's cadence
+    // is still close enough.
+    const auto chooseVBlank = [&](double frameArrival, std::int64_t previousVBlank, double previousArrival) {
+        const std::int64_t advance = std::max<std::int64_t>(std::llround((frameArrival - previousArrival) / refresh), 0);
+        const std::int64_t continued = previousVBlank + advance;
+        const double lead = display_.timeOf(continued) - frameArrival;
+        if (lead >= margin && lead < margin + refresh + hysteresis)
+        {
+            return continued;
+        }
+        return display_.firstIndexAtOrAfter(frameArrival + margin);
+    };
+
+    std::int64_t vblank = display_.firstIndexAtOrAfter(arrival + margin);
+    if (planned_ && frame_ == plannedFrame_)
+    {
+        vblank = plannedVBlank_;
+    }
+    else if (planned_ && frame_ > plannedFrame_)
+    {
+        vblank = chooseVBlank(arrival, plannedVBlank_, plannedArrivalNs_);
+    }
+
+    planned_ = true;
+    plannedFrame_ = frame_;
+    plannedVBlank_ = vblank;
+    plannedArrivalNs_ = arrival;
+
+    // Too late for its vblank: shown on the next one it can make, unless
+    // that is the next frame's. Then it waits for that frame until the last
+    // moment and only stands in if it does not arrive. The cadence stays
+    // where it was either way.
+    const double now = static_cast<double>(nowNs);
+    double notBefore = display_.timeOf(vblank - 1) + static_cast<double>(kVBlankGuardNs);
+    if (now + latch > display_.timeOf(vblank))
+    {
+        const std::int64_t landing = display_.firstIndexAtOrAfter(now + latch);
+        const std::int64_t next = std::max(chooseVBlank(source_.timeOf(frame_ + 1), vblank, arrival), vblank + 1);
+        notBefore = landing < next ? 0.0 : display_.timeOf(next) - latch;
+    }
+
+    if (notBefore <= now)
+    {
+        return 0;
+    }
+    const auto notBeforeNs = static_cast<std::uint64_t>(notBefore);
+    return notBeforeNs > nowNs ? notBeforeNs : 0;
+}
+
+void PresentPacer::presented(std::uint32_t presentId)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (delivered_ == 0 || frame_ == lastPresentedFrame_)
+    {
+        return;
+    }
+    lastPresentedFrame_ = frame_;
+
+    if (pendingCount_ == pending_.size())
+    {
+        std::move(pending_.begin() + 1, pending_.end(), pending_.begin());
+        --pendingCount_;
+        shown_ = false;
+    }
+    pending_[pendingCount_++] = {presentId, frame_, delivered_, frameArrivalNs_};
+}
+
+void PresentPacer::observeDisplay(std::uint32_t presentId, std::uint64_t presentRefresh, std::uint64_t syncRefresh, std::uint64_t syncNs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (syncNs != 0)
+    {
+        display_.observe(static_cast<std::int64_t>(syncRefresh), syncNs);
+    }
+
+    for (std::size_t i = 0; i < pendingCount_; ++i)
+    {
+        if (pending_[i].presentId != presentId)
+        {
+            continue;
+        }
+        // Statistics only name the latest displayed present; anything queued
+        // before it went by unseen, so its neighbours cannot be compared.
+        if (i != 0)
+        {
+            shown_ = false;
+        }
+        frameShown(pending_[i], presentRefresh);
+        std::move(pending_.begin() + static_cast<std::ptrdiff_t>(i) + 1, pending_.begin() + static_cast<std::ptrdiff_t>(pendingCount_), pending_.begin());
+        pendingCount_ -= i + 1;
+        break;
+    }
+}
+
+void PresentPacer::frameShown(const PendingPresent& present, std::uint64_t refresh)
+{
+    if (shown_ && (refresh <= lastShownRefresh_ || present.frame <= lastShown_.frame))
+    {
+        return;
+    }
+
+    if (shown_)
+    {
+        framesDropped_ += present.delivered - lastShown_.delivered - 1;
+        if (source_.hasPeriod() && display_.hasPeriod())
+        {
+            // The previous frame stayed up until this one replaced it. Counted
+            // when that is longer than its share of refreshes, rounded; a
+            // cadence that does not divide the refresh rate repeats frames at
+            // the rate the two differ by (one in 1001 for 59.94 on 60 Hz).
+            const double refreshesPerFrame = source_.periodNs() / display_.periodNs();
+            const double expected = refreshesPerFrame * static_cast<double>(present.frame - lastShown_.frame);
+            if (refresh - lastShownRefresh_ > static_cast<std::uint64_t>(std::llround(expected)))
+            {
+                ++framesRepeated_;
+            }
+        }
+    }
+
+    ++framesShown_;
+    if (display_.hasPeriod())
+    {
+        const double scanout = display_.timeOf(static_cast<std::int64_t>(refresh));
+        if (scanout > static_cast<double>(present.arrivalNs))
+        {
+            scanoutLatency_.record(static_cast<std::uint64_t>(scanout) - present.arrivalNs);
+        }
+    }
+
+    shown_ = true;
+    lastShown_ = present;
+    lastShownRefresh_ = refresh;
+}
+
+std::uint64_t PresentPacer::framesShown() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return framesShown_;
+}
+
+std::uint64_t PresentPacer::framesDropped() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return framesDropped_;
+}
+
+std::uint64_t PresentPacer::framesRepeated() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return framesRepeated_;
+}
+
+double PresentPacer::sourcePeriodNs() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return source_.hasPeriod() ? source_.periodNs() : 0.0;
+}
+
+bool PresentPacer::sourceLocked() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return source_.locked();
+}
+
+double PresentPacer::refreshPeriodNs() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return display_.hasPeriod() ? display_.periodNs() : 0.0;
+}
+
+std::string PresentPacer::formatReport() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    char text[320];
+    std::snprintf(text, sizeof(text),
+                  "Present pacing: source %.3f ms, refresh %.3f ms\n"
+                  "%-24s %10llu\n%-24s %10llu\n%-24s %10llu\n"
+                  "%-24s %10.3f %10.3f (p50, p99 ms)\n",
+                  source_.hasPeriod() ? source_.periodNs() / 1e6 : 0.0,
+                  display_.hasPeriod() ? display_.periodNs() / 1e6 : 0.0,
+                  "Frames shown", static_cast<unsigned long long>(framesShown_),
+                  "Frames dropped", static_cast<unsigned long long>(framesDropped_),
+                  "Frames repeated", static_cast<unsigned long long>(framesRepeated_),
+                  "Arrival -> scanout",
+                  static_cast<double>(scanoutLatency_.valueAtQuantile(0.5)) / 1e6,
+                  static_cast<double>(scanoutLatency_.valueAtQuantile(0.99)) / 1e6);
+    return text;
+}
@@ -0,0 +1,217 @@
+#include "ReferenceRenderer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr int kFractionBits = 8;
+    constexpr std::uint32_t kFractionOne = 1u << kFractionBits;
+
+    // The two texels a sample blends along one axis, and the weight of the
+    // second one.
+    struct Tap {
+        std::uint32_t first;
+        std::uint32_t second;
+        std::uint32_t weight;
+    };
+
+    // Target pixel `index` of a viewport `extent` pixels long covers texels
+    // [0, size). Its centre lands on texel coordinate
+    //   (index + 0.5) * size / extent - 0.5
+    // which is floored to kFractionBits fractional bits and clamped.
+    Tap tapFor(std::int64_t index, std::int64_t extent, std::int64_t size)
+    {
+        const std::int64_t numerator = ((2 * index + 1) * size - extent) * kFractionOne;
+        const std::int64_t denominator = 2 * extent;
+        std::int64_t position = numerator / denominator;
+        if (numerator % denominator != 0 && numerator < 0)
+        {
+            --position;
+        }
+        const std::int64_t texel = position >> kFractionBits;
+        const auto clampTexel = [size](std::int64_t value) {
+            return static_cast<std::uint32_t>(std::clamp<std::int64_t>(value, 0, size - 1));
+        };
+        return {clampTexel(texel), clampTexel(texel + 1), static_cast<std::uint32_t>(position & (kFractionOne - 1))};
+    }
+
+    void clearOpaqueBlack(std::uint8_t* target, std::size_t pitch, std::uint32_t width, std::uint32_t height)
+    {
+        for (std::uint32_t y = 0; y < height; ++y)
+        {
+            std::uint8_t* row = target + static_cast<std::size_t>(y) * pitch;
+            std::memset(row, 0, static_cast<std::size_t>(width) * 4);
+            for (std::uint32_t x = 0; x < width; ++x)
+            {
+                row[x * 4 + 3] = 0xFF;
+            }
+        }
+    }
+}
+
+void compositeTexture(std::uint8_t* target,
+                      std::size_t targetPitch,
+                      std::uint32_t targetWidth,
+                      std::uint32_t targetHeight,
+                      const ViewportRect& viewport,
+                      const std::uint8_t* texture,
+                      std::size_t texturePitch,
+                      std::uint32_t textureWidth,
+                      std::uint32_t textureHeight)
+{
+    clearOpaqueBlack(target, targetPitch, targetWidth, targetHeight);
+    if (!texture || textureWidth == 0 || textureHeight == 0 || viewport.width() <= 0 || viewport.height() <= 0)
+    {
+        return;
+    }
+
+    const std::int32_t left = std::max(viewport.left, 0);
+    const std::int32_t top = std::max(viewport.top, 0);
+    const std::int32_t right = std::min(viewport.right, static_cast<std::int32_t>(targetWidth));
+    const std::int32_t bottom = std::min(viewport.bottom, static_cast<std::int32_t>(targetHeight));
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    std::vector<Tap> columns(static_cast<std::size_t>(right - left));
+    for (std::int32_t x = left; x < right; ++x)
+    {
+        columns[static_cast<std::size_t>(x - left)] = tapFor(x - viewport.left, viewport.width(), textureWidth);
+    }
+
+    // Rows blend first, into 8.8 fixed point, so the columns only blend one
+    // row. The sum is the same as filtering the four texels at once.
+    std::vector<std::uint16_t> blended(static_cast<std::size_t>(textureWidth) * 4);
+    for (std::int32_t y = top; y < bottom; ++y)
+    {
+        const Tap row = tapFor(y - viewport.top, viewport.height(), textureHeight);
+        const std::uint8_t* upper = texture + static_cast<std::size_t>(row.first) * texturePitch;
+        const std::uint8_t* lower = texture + static_cast<std::size_t>(row.second) * texturePitch;
+        for (std::size_t i = 0; i < blended.size(); ++i)
+        {
+            blended[i] = static_cast<std::uint16_t>(upper[i] * (kFractionOne - row.weight) + lower[i] * row.weight);
+        }
+
+        std::uint8_t* out = target + static_cast<std::size_t>(y) * targetPitch + static_cast<std::size_t>(left) * 4;
+        for (const Tap& column : columns)
+        {
+            const std::uint16_t* a = blended.data() + static_cast<std::size_t>(column.first) * 4;
+            const std::uint16_t* b = blended.data() + static_cast<std::size_t>(column.second) * 4;
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                const std::uint32_t sum = a[channel] * (kFractionOne - column.weight) + b[channel] * column.weight;
+                out[channel] = static_cast<std::uint8_t>((sum + (1u << (2 * kFractionBits - 1))) >> (2 * kFractionBits));
+            }
+            out += 4;
+        }
+    }
+}
+
+bool ReferenceRenderer::render(const DirectShowCapture::Frame& frame,
+                               std::uint32_t clientWidth,
+                               std::uint32_t clientHeight,
+                               const ReferenceRenderOptions& options)
+{
+    width_ = clientWidth;
+    height_ = clientHeight;
+    image_.resize(static_cast<std::size_t>(clientWidth) * clientHeight * 4);
+    clearOpaqueBlack(image_.data(), stride(), width_, height_);
+    viewport_ = {};
+    textureWidth_ = 0;
+    textureHeight_ = 0;
+
+    if (!frame.data || isCompressed(frame.format) ||
+        !computeVideoViewport(options.aspectMode, frame.width, frame.height,
+                              static_cast<std::int32_t>(clientWidth), static_cast<std::int32_t>(clientHeight), viewport_))
+    {
+        return false;
+    }
+    if (options.filter == ScalingFilter::Nearest)
+    {
+        snapViewportToIntegerScale(options.aspectMode, frame.width, frame.height, viewport_);
+    }
+
+    // Application::updateDownscaler(), sized by the viewport just chosen.
+    std::uint32_t outputWidth = frame.width;
+    std::uint32_t outputHeight = frame.height;
+    if (options.downscale)
+    {
+        chooseDownscaleSize(frame.width, frame.height,
+                            static_cast<std::uint32_t>(viewport_.width()), static_cast<std::uint32_t>(viewport_.height()),
+                            outputWidth, outputHeight);
+    }
+    const bool scaled = outputWidth != frame.width || outputHeight != frame.height;
+    if (!scaled)
+    {
+        scaler_.reset();
+    }
+    else if (!scaler_ || scaler_->sourceWidth() != frame.width || scaler_->sourceHeight() != frame.height ||
+             scaler_->outputWidth() != outputWidth || scaler_->outputHeight() != outputHeight)
+    {
+        scaler_.emplace(frame.width, frame.height, outputWidth, outputHeight);
+    }
+
+    FrameWriteOptions writeOptions;
+    writeOptions.toneMapper = options.toneMapper;
+    writeOptions.scaler = scaler_ ? &*scaler_ : nullptr;
+    if (!writeFrameToSink(frame, texture_, writeOptions).accepted)
+    {
+        return false;
+    }
+    const CpuFrame* texture = texture_.acquireLatest();
+    if (!texture)
+    {
+        return false;
+    }
+
+    textureWidth_ = texture->width;
+    textureHeight_ = texture->height;
+    composite(*texture, options.filter);
+    return true;
+}
+
+void ReferenceRenderer::composite(const CpuFrame& texture, ScalingFilter filter)
+{
+    if (filter == ScalingFilter::Bilinear || filter == ScalingFilter::Sharpen)
+    {
+        const std::uint8_t* pixels = texture.data.data();
+        std::size_t pitch = texture.stride;
+        if (filter == ScalingFilter::Sharpen)
+        {
+            pitch = static_cast<std::size_t>(texture.width) * 4;
+            sharpened_.resize(pitch * texture.height);
+            sharpenTexture(sharpened_.data(), pitch, pixels, texture.stride, texture.width, texture.height);
+            pixels = sharpened_.data();
+        }
+        compositeTexture(image_.data(), stride(), width_, height_, viewport_, pixels, pitch, texture.width, texture.height);
+        return;
+    }
+
+    const std::int32_t left = std::max(viewport_.left, 0);
+    const std::int32_t top = std::max(viewport_.top, 0);
+    const std::int32_t right = std::min(viewport_.right, static_cast<std::int32_t>(width_));
+    const std::int32_t bottom = std::min(viewport_.bottom, static_cast<std::int32_t>(height_));
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    const auto viewportWidth = static_cast<std::uint32_t>(viewport_.width());
+    const auto viewportHeight = static_cast<std::uint32_t>(viewport_.height());
+    if (!filterScaler_ || filterScaler_->filter() != filter ||
+        filterScaler_->sourceWidth() != texture.width || filterScaler_->sourceHeight() != texture.height ||
+        filterScaler_->outputWidth() != viewportWidth || filterScaler_->outputHeight() != viewportHeight)
+    {
+        filterScaler_.emplace(filter, texture.width, texture.height, viewportWidth, viewportHeight);
+    }
+    const DirtyRect region{
+        static_cast<std::uint32_t>(left - viewport_.left),
+        static_cast<std::uint32_t>(top - viewport_.top),
+        static_cast<std::uint32_t>(right - viewport_.left),
+        static_cast<std::uint32_t>(bottom - viewport_.top),
+    };
+    std::uint8_t* out = image_.data() + static_cast<std::size_t>(top) * stride() + static_cast<std::size_t>(left) * 4;
+    filterScaler_->scaleRegion(out, stride(), region, texture.data.data(), texture.stride, scalingScratch_);
+}
@@ -0,0 +1,119 @@
+#include "RenderScheduler.hpp"
+
+#include "LatencyStats.hpp"
+
+#include <chrono>
+
+void RenderScheduler::setSwapChainWaitable(bool waitable)
+{
+    swapChainWaitable_ = waitable;
+    if (!waitable)
+    {
+        swapChainReady_ = true;
+    }
+}
+
+void RenderScheduler::notify(unsigned wakes)
+{
+    if ((wakes & kWakeFrame) != 0)
+    {
+        framePending_ = true;
+    }
+    if ((wakes & kWakeOverlay) != 0)
+    {
+        redrawPending_ = true;
+    }
+    if ((wakes & kWakeSwapChain) != 0)
+    {
+        swapChainReady_ = true;
+    }
+}
+
+unsigned RenderScheduler::waitSources() const noexcept
+{
+    unsigned sources = kWakeFrame | kWakeMessage | kWakeOverlay;
+    if (hasWork() && !swapChainReady_)
+    {
+        sources |= kWakeSwapChain;
+    }
+    return sources;
+}
+
+unsigned RenderScheduler::waitForWork(RenderWaitSet& waitSet)
+{
+    if (shouldRender())
+    {
+        const unsigned wakes = waitSet.wait(kWakeFrame | kWakeMessage | kWakeOverlay, 0);
+        notify(wakes);
+        return wakes;
+    }
+
+    unsigned seen = 0;
+    while (!shouldRender() && (seen & kWakeMessage) == 0)
+    {
+        const unsigned sources = waitSources();
+        const bool swapChainWait = (sources & kWakeSwapChain) != 0;
+        const bool holding = !swapChainWait && hasWork();
+        std::uint64_t timeoutNs = swapChainWait ? kSwapChainTimeoutNs : kWaitForever;
+        if (holding)
+        {
+            const std::uint64_t now = latencyClockNs();
+            timeoutNs = holdUntilNs_ > now ? holdUntilNs_ - now : 0;
+        }
+        const unsigned wakes = waitSet.wait(sources, timeoutNs);
+        if (wakes == 0 && swapChainWait)
+        {
+            swapChainReady_ = true;
+        }
+        notify(wakes);
+        seen |= wakes;
+        if (holding && (wakes & kWakeFrame) != 0)
+        {
+            // A newer frame ends the hold early so the caller can re-plan.
+            break;
+        }
+    }
+    return seen;
+}
+
+void RenderScheduler::rendered(bool presented)
+{
+    framePending_ = false;
+    redrawPending_ = false;
+    holdUntilNs_ = 0;
+    if (presented && swapChainWaitable_)
+    {
+        swapChainReady_ = false;
+    }
+}
+
+bool RenderScheduler::held() const
+{
+    return holdUntilNs_ != 0 && latencyClockNs() < holdUntilNs_;
+}
+
+void ConditionRenderWaitSet::signal(unsigned sources)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        signalled_ |= sources;
+    }
+    cv_.notify_one();
+}
+
+unsigned ConditionRenderWaitSet::wait(unsigned sources, std::uint64_t timeoutNs)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto ready = [&]() { return (signalled_ & sources) != 0; };
+    if (timeoutNs == kWaitForever)
+    {
+        cv_.wait(lock, ready);
+    }
+    else
+    {
+        cv_.wait_for(lock, std::chrono::nanoseconds(timeoutNs), ready);
+    }
+    const unsigned wakes = signalled_ & sources;
+    signalled_ &= ~wakes;
+    return wakes;
+}
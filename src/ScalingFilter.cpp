@@ -0,0 +1,705 @@
+#include "ScalingFilter.hpp"
+#include "KernelRegistry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_SCALING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PCKVM_SCALING_TARGET(features)
+#else
+#define PCKVM_SCALING_TARGET(features) __attribute__((target(features)))
+#endif
+#else
+#define PCKVM_SCALING_X86 0
+#endif
+
+namespace
+{
+    constexpr int kWeightBits = 14;
+    constexpr std::int32_t kWeightOne = 1 << kWeightBits;
+    // Horizontal results keep 6 fractional bits: Lanczos overshoot stays
+    // well inside int16 and the vertical pass can use 16-bit multiplies.
+    constexpr int kHorizontalShift = kWeightBits - 6;
+    constexpr int kVerticalShift = kWeightBits + 6;
+    constexpr std::uint32_t kNoRow = std::numeric_limits<std::uint32_t>::max();
+    constexpr double kPi = 3.14159265358979323846;
+
+    void gatherScalar(std::uint32_t* dst, const std::uint32_t* src, const std::uint32_t* columns, std::size_t pixels)
+    {
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            dst[i] = src[columns[i]];
+        }
+    }
+
+    // Pixels [begin, pixels); the SIMD tiers finish their rows with it.
+    void horizontalScalarFrom(std::int16_t* dst,
+                              const std::uint8_t* src,
+                              const std::uint32_t* firstColumn,
+                              const std::int16_t* weights,
+                              std::size_t taps,
+                              std::size_t begin,
+                              std::size_t pixels)
+    {
+        for (std::size_t i = begin; i < pixels; ++i)
+        {
+            const std::uint8_t* pixel = src + static_cast<std::size_t>(firstColumn[i]) * 4;
+            const std::int16_t* w = weights + i * taps;
+            for (int c = 0; c < 4; ++c)
+            {
+                std::int32_t sum = 1 << (kHorizontalShift - 1);
+                for (std::size_t t = 0; t < taps; ++t)
+                {
+                    sum += w[t] * pixel[t * 4 + c];
+                }
+                dst[i * 4 + c] = static_cast<std::int16_t>(std::clamp<std::int32_t>(sum >> kHorizontalShift, INT16_MIN, INT16_MAX));
+            }
+        }
+    }
+
+    void horizontalScalar(std::int16_t* dst,
+                          const std::uint8_t* src,
+                          const std::uint32_t* firstColumn,
+                          const std::int16_t* weights,
+                          std::size_t taps,
+                          std::size_t pixels)
+    {
+        horizontalScalarFrom(dst, src, firstColumn, weights, taps, 0, pixels);
+    }
+
+    // Values [begin, values); the SIMD tiers finish their rows with it.
+    void verticalScalarFrom(std::uint8_t* dst,
+                            const std::int16_t* const* rows,
+                            const std::int16_t* weights,
+                            std::size_t count,
+                            std::size_t begin,
+                            std::size_t values)
+    {
+        for (std::size_t i = begin; i < values; ++i)
+        {
+            std::int32_t sum = 1 << (kVerticalShift - 1);
+            for (std::size_t r = 0; r < count; ++r)
+            {
+                sum += weights[r] * rows[r][i];
+            }
+            dst[i] = static_cast<std::uint8_t>(std::clamp(sum >> kVerticalShift, 0, 255));
+        }
+    }
+
+    void verticalScalar(std::uint8_t* dst,
+                        const std::int16_t* const* rows,
+                        const std::int16_t* weights,
+                        std::size_t count,
+                        std::size_t values)
+    {
+        verticalScalarFrom(dst, rows, weights, count, 0, values);
+    }
+
+    // One channel: the neighbours pull away from the centre by up to
+    // kSharpenPeak each, scaled by how much headroom the local range leaves
+    // (none at full black or white, most for low contrast).
+    float sharpenValue(float c, float n, float s, float e, float w)
+    {
+        const float low = std::min(c, std::min(std::min(n, s), std::min(e, w)));
+        const float high = std::max(c, std::max(std::max(n, s), std::max(e, w)));
+        const float headroom = std::min(std::max(std::min(low, 255.0f - high) / std::max(high, 1.0f), 0.0f), 1.0f);
+        const float weight = std::sqrt(headroom) * kSharpenPeak;
+        const float value = (c + weight * ((n + s) + (e + w))) / (1.0f + 4.0f * weight);
+        return std::min(std::max(value, 0.0f), 255.0f);
+    }
+
+    void sharpenPixel(std::uint8_t* dst, const std::uint8_t* above, const std::uint8_t* row, const std::uint8_t* below, std::size_t x, std::size_t pixels)
+    {
+        const std::size_t left = x == 0 ? x : x - 1;
+        const std::size_t right = x + 1 == pixels ? x : x + 1;
+        for (std::size_t c = 0; c < 4; ++c)
+        {
+            const float value = sharpenValue(row[x * 4 + c], above[x * 4 + c], below[x * 4 + c], row[right * 4 + c], row[left * 4 + c]);
+            dst[x * 4 + c] = static_cast<std::uint8_t>(static_cast<std::int32_t>(value + 0.5f));
+        }
+    }
+
+    void sharpenScalar(std::uint8_t* dst, const std::uint8_t* above, const std::uint8_t* row, const std::uint8_t* below, std::size_t pixels)
+    {
+        for (std::size_t x = 0; x < pixels; ++x)
+        {
+            sharpenPixel(dst, above, row, below, x, pixels);
+        }
+    }
+
+#if PCKVM_SCALING_X86
+    std::int32_t weightPair(const std::int16_t* weights, std::size_t t, std::size_t count)
+    {
+        const auto low = static_cast<std::uint16_t>(weights[t]);
+        const auto high = t + 1 < count ? static_cast<std::uint16_t>(weights[t + 1]) : std::uint16_t{0};
+        return static_cast<std::int32_t>(low | (static_cast<std::uint32_t>(high) << 16));
+    }
+
+    // Channel sums of one pixel's taps, two taps per madd: the pixels' words
+    // are interleaved channel by channel so each lane adds one tap pair.
+    PCKVM_SCALING_TARGET("sse2")
+    __m128i horizontalSums(const std::uint8_t* pixel, const std::int16_t* w, std::size_t taps)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = _mm_set1_epi32(1 << (kHorizontalShift - 1));
+        std::size_t t = 0;
+        for (; t + 2 <= taps; t += 2)
+        {
+            const __m128i two = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + t * 4)), zero);
+            const __m128i pairs = _mm_unpacklo_epi16(two, _mm_srli_si128(two, 8));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pairs, _mm_set1_epi32(weightPair(w, t, taps))));
+        }
+        if (t < taps)
+        {
+            std::int32_t bytes = 0;
+            std::memcpy(&bytes, pixel + t * 4, sizeof(bytes));
+            const __m128i one = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(one, _mm_set1_epi32(weightPair(w, t, taps))));
+        }
+        return _mm_srai_epi32(sum, kHorizontalShift);
+    }
+
+    PCKVM_SCALING_TARGET("sse2")
+    void horizontalSse2(std::int16_t* dst,
+                        const std::uint8_t* src,
+                        const std::uint32_t* firstColumn,
+                        const std::int16_t* weights,
+                        std::size_t taps,
+                        std::size_t pixels)
+    {
+        std::size_t i = 0;
+        for (; i + 2 <= pixels; i += 2)
+        {
+            const __m128i a = horizontalSums(src + static_cast<std::size_t>(firstColumn[i]) * 4, weights + i * taps, taps);
+            const __m128i b = horizontalSums(src + static_cast<std::size_t>(firstColumn[i + 1]) * 4, weights + (i + 1) * taps, taps);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packs_epi32(a, b));
+        }
+        horizontalScalarFrom(dst, src, firstColumn, weights, taps, i, pixels);
+    }
+
+    PCKVM_SCALING_TARGET("sse2")
+    void verticalSse2From(std::uint8_t* dst,
+                          const std::int16_t* const* rows,
+                          const std::int16_t* weights,
+                          std::size_t count,
+                          std::size_t begin,
+                          std::size_t values)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi32(1 << (kVerticalShift - 1));
+        std::size_t i = begin;
+        for (; i + 8 <= values; i += 8)
+        {
+            __m128i low = rounding;
+            __m128i high = rounding;
+            for (std::size_t r = 0; r < count; r += 2)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i));
+                const __m128i b = r + 1 < count ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r + 1] + i)) : zero;
+                const __m128i weight = _mm_set1_epi32(weightPair(weights, r, count));
+                low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weight));
+                high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weight));
+            }
+            const __m128i words = _mm_packs_epi32(_mm_srai_epi32(low, kVerticalShift), _mm_srai_epi32(high, kVerticalShift));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+        }
+        verticalScalarFrom(dst, rows, weights, count, i, values);
+    }
+
+    PCKVM_SCALING_TARGET("sse2")
+    void verticalSse2(std::uint8_t* dst,
+                      const std::int16_t* const* rows,
+                      const std::int16_t* weights,
+                      std::size_t count,
+                      std::size_t values)
+    {
+        verticalSse2From(dst, rows, weights, count, 0, values);
+    }
+
+    // sharpenValue() on every channel, operation for operation: min and max
+    // are exact in any order and the sums are formed the same way, so the
+    // results match.
+    PCKVM_SCALING_TARGET("sse2")
+    __m128 sharpenSse2Values(__m128 c, __m128 n, __m128 s, __m128 e, __m128 w)
+    {
+        const __m128 low = _mm_min_ps(c, _mm_min_ps(_mm_min_ps(n, s), _mm_min_ps(e, w)));
+        const __m128 high = _mm_max_ps(c, _mm_max_ps(_mm_max_ps(n, s), _mm_max_ps(e, w)));
+        const __m128 ratio = _mm_div_ps(_mm_min_ps(low, _mm_sub_ps(_mm_set1_ps(255.0f), high)), _mm_max_ps(high, _mm_set1_ps(1.0f)));
+        const __m128 headroom = _mm_min_ps(_mm_max_ps(ratio, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        const __m128 weight = _mm_mul_ps(_mm_sqrt_ps(headroom), _mm_set1_ps(kSharpenPeak));
+        const __m128 sum = _mm_add_ps(_mm_add_ps(n, s), _mm_add_ps(e, w));
+        const __m128 value = _mm_div_ps(_mm_add_ps(c, _mm_mul_ps(weight, sum)), _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(4.0f), weight)));
+        return _mm_add_ps(_mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    }
+
+    PCKVM_SCALING_TARGET("sse2")
+    __m128 loadPixelSse2(const std::uint8_t* pixel)
+    {
+        std::int32_t bytes = 0;
+        std::memcpy(&bytes, pixel, sizeof(bytes));
+        const __m128i zero = _mm_setzero_si128();
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero));
+    }
+
+    PCKVM_SCALING_TARGET("sse2")
+    void sharpenSse2(std::uint8_t* dst, const std::uint8_t* above, const std::uint8_t* row, const std::uint8_t* below, std::size_t pixels)
+    {
+        if (pixels < 3)
+        {
+            sharpenScalar(dst, above, row, below, pixels);
+            return;
+        }
+        sharpenPixel(dst, above, row, below, 0, pixels);
+        for (std::size_t x = 1; x + 1 < pixels; ++x)
+        {
+            const __m128 value = sharpenSse2Values(loadPixelSse2(row + x * 4), loadPixelSse2(above + x * 4), loadPixelSse2(below + x * 4),
+                                               loadPixelSse2(row + x * 4 + 4), loadPixelSse2(row + x * 4 - 4));
+            const __m128i words = _mm_packs_epi32(_mm_cvttps_epi32(value), _mm_setzero_si128());
+            const std::int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+            std::memcpy(dst + x * 4, &bytes, sizeof(bytes));
+        }
+        sharpenPixel(dst, above, row, below, pixels - 1, pixels);
+    }
+
+    PCKVM_SCALING_TARGET("avx2")
+    void gatherAvx2(std::uint32_t* dst, const std::uint32_t* src, const std::uint32_t* columns, std::size_t pixels)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= pixels; i += 8)
+        {
+            const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_i32gather_epi32(reinterpret_cast<const int*>(src), index, 4));
+        }
+        gatherScalar(dst + i, src, columns + i, pixels - i);
+    }
+
+    // Two pixels at a time, one per 128-bit lane.
+    PCKVM_SCALING_TARGET("avx2")
+    void horizontalAvx2(std::int16_t* dst,
+                        const std::uint8_t* src,
+                        const std::uint32_t* firstColumn,
+                        const std::int16_t* weights,
+                        std::size_t taps,
+                        std::size_t pixels)
+    {
+        const __m256i rounding = _mm256_set1_epi32(1 << (kHorizontalShift - 1));
+        std::size_t i = 0;
+        for (; i + 4 <= pixels; i += 4)
+        {
+            __m256i sums[2];
+            for (std::size_t half = 0; half < 2; ++half)
+            {
+                const std::size_t p = i + half * 2;
+                const std::uint8_t* first = src + static_cast<std::size_t>(firstColumn[p]) * 4;
+                const std::uint8_t* second = src + static_cast<std::size_t>(firstColumn[p + 1]) * 4;
+                const std::int16_t* w0 = weights + p * taps;
+                const std::int16_t* w1 = w0 + taps;
+                __m256i sum = rounding;
+                std::size_t t = 0;
+                for (; t + 2 <= taps; t += 2)
+                {
+                    const __m256i two = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(first + t * 4)),
+                                                                                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(second + t * 4))));
+                    // Per lane: one pixel pair's words, interleaved by channel.
+                    const __m256i pairs = _mm256_shuffle_epi8(two, _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+                                                                                    0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15));
+                    const __m256i weight = _mm256_setr_epi32(weightPair(w0, t, taps), weightPair(w0, t, taps), weightPair(w0, t, taps), weightPair(w0, t, taps),
+                                                             weightPair(w1, t, taps), weightPair(w1, t, taps), weightPair(w1, t, taps), weightPair(w1, t, taps));
+                    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, weight));
+                }
+                if (t < taps)
+                {
+                    std::int32_t a = 0;
+                    std::int32_t b = 0;
+                    std::memcpy(&a, first + t * 4, sizeof(a));
+                    std::memcpy(&b, second + t * 4, sizeof(b));
+                    const __m256i one = _mm256_cvtepu8_epi32(_mm_unpacklo_epi32(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b)));
+                    const __m256i weight = _mm256_setr_epi32(w0[t], w0[t], w0[t], w0[t], w1[t], w1[t], w1[t], w1[t]);
+                    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(one, weight));
+                }
+                sums[half] = _mm256_srai_epi32(sum, kHorizontalShift);
+            }
+            // packs works per lane: [p0, p2 | p1, p3], then put them in order.
+            const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(sums[0], sums[1]), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), words);
+        }
+        horizontalSse2(dst + i * 4, src, firstColumn + i, weights + i * taps, taps, pixels - i);
+    }
+
+    PCKVM_SCALING_TARGET("avx2")
+    void verticalAvx2(std::uint8_t* dst,
+                      const std::int16_t* const* rows,
+                      const std::int16_t* weights,
+                      std::size_t count,
+                      std::size_t values)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i rounding = _mm256_set1_epi32(1 << (kVerticalShift - 1));
+        std::size_t i = 0;
+        for (; i + 16 <= values; i += 16)
+        {
+            __m256i low = rounding;
+            __m256i high = rounding;
+            for (std::size_t r = 0; r < count; r += 2)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i));
+                const __m256i b = r + 1 < count ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r + 1] + i)) : zero;
+                const __m256i weight = _mm256_set1_epi32(weightPair(weights, r, count));
+                low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weight));
+                high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weight));
+            }
+            // The unpacks and packs both work per lane, so the order survives.
+            const __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(low, kVerticalShift), _mm256_srai_epi32(high, kVerticalShift));
+            const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(bytes));
+        }
+        verticalSse2From(dst, rows, weights, count, i, values);
+    }
+
+    PCKVM_SCALING_TARGET("avx2")
+    __m256 sharpenAvx2Values(__m256 c, __m256 n, __m256 s, __m256 e, __m256 w)
+    {
+        const __m256 low = _mm256_min_ps(c, _mm256_min_ps(_mm256_min_ps(n, s), _mm256_min_ps(e, w)));
+        const __m256 high = _mm256_max_ps(c, _mm256_max_ps(_mm256_max_ps(n, s), _mm256_max_ps(e, w)));
+        const __m256 ratio = _mm256_div_ps(_mm256_min_ps(low, _mm256_sub_ps(_mm256_set1_ps(255.0f), high)), _mm256_max_ps(high, _mm256_set1_ps(1.0f)));
+        const __m256 headroom = _mm256_min_ps(_mm256_max_ps(ratio, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        const __m256 weight = _mm256_mul_ps(_mm256_sqrt_ps(headroom), _mm256_set1_ps(kSharpenPeak));
+        const __m256 sum = _mm256_add_ps(_mm256_add_ps(n, s), _mm256_add_ps(e, w));
+        const __m256 value = _mm256_div_ps(_mm256_add_ps(c, _mm256_mul_ps(weight, sum)), _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(4.0f), weight)));
+        return _mm256_add_ps(_mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f));
+    }
+
+    PCKVM_SCALING_TARGET("avx2")
+    __m256 loadPixelsAvx2(const std::uint8_t* pixels)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels))));
+    }
+
+    PCKVM_SCALING_TARGET("avx2")
+    void sharpenAvx2(std::uint8_t* dst, const std::uint8_t* above, const std::uint8_t* row, const std::uint8_t* below, std::size_t pixels)
+    {
+        if (pixels < 3)
+        {
+            sharpenScalar(dst, above, row, below, pixels);
+            return;
+        }
+        sharpenPixel(dst, above, row, below, 0, pixels);
+        std::size_t x = 1;
+        for (; x + 2 < pixels; x += 2)
+        {
+            const __m256 value = sharpenAvx2Values(loadPixelsAvx2(row + x * 4), loadPixelsAvx2(above + x * 4), loadPixelsAvx2(below + x * 4),
+                                               loadPixelsAvx2(row + x * 4 + 4), loadPixelsAvx2(row + x * 4 - 4));
+            const __m256i values = _mm256_cvttps_epi32(value);
+            const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(words, words));
+        }
+        for (; x < pixels; ++x)
+        {
+            sharpenPixel(dst, above, row, below, x, pixels);
+        }
+    }
+
+    const ScalingKernels kSse2Kernels{gatherScalar, horizontalSse2, verticalSse2, sharpenSse2};
+    const ScalingKernels kAvx2Kernels{gatherAvx2, horizontalAvx2, verticalAvx2, sharpenAvx2};
+#endif
+
+    const ScalingKernels kScalarKernels{gatherScalar, horizontalScalar, verticalScalar, sharpenScalar};
+
+    std::atomic<ScalingTier>& activeTier()
+    {
+        static std::atomic<ScalingTier> tier = []() {
+            for (ScalingTier candidate : {ScalingTier::AVX2, ScalingTier::SSE2})
+            {
+                if (scalingKernels(candidate))
+                {
+                    return candidate;
+                }
+            }
+            return ScalingTier::Scalar;
+        }();
+        return tier;
+    }
+
+    double catmullRom(double x)
+    {
+        x = std::abs(x);
+        if (x < 1.0)
+        {
+            return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+        }
+        if (x < 2.0)
+        {
+            return -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0;
+        }
+        return 0.0;
+    }
+
+    double lanczos3(double x)
+    {
+        x = std::abs(x);
+        if (x < 1e-9)
+        {
+            return 1.0;
+        }
+        if (x >= 3.0)
+        {
+            return 0.0;
+        }
+        const double px = kPi * x;
+        return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+    }
+}
+
+const char* scalingFilterName(ScalingFilter filter)
+{
+    switch (filter)
+    {
+    case ScalingFilter::Bilinear:
+        return "Bilinear";
+    case ScalingFilter::Nearest:
+        return "Nearest (Integer Scale)";
+    case ScalingFilter::Bicubic:
+        return "Bicubic";
+    case ScalingFilter::Lanczos3:
+        return "Lanczos-3";
+    case ScalingFilter::Sharpen:
+        return "Bilinear + Sharpen";
+    }
+    return "unknown";
+}
+
+const ScalingKernels* scalingKernels(ScalingTier tier)
+{
+    switch (tier)
+    {
+    case ScalingTier::Scalar:
+        return &kScalarKernels;
+#if PCKVM_SCALING_X86
+    case ScalingTier::SSE2:
+        return &kSse2Kernels;
+    case ScalingTier::AVX2:
+        return cpuFeatures().avx2 ? &kAvx2Kernels : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+ScalingTier activeScalingTier()
+{
+    return activeTier().load(std::memory_order_relaxed);
+}
+
+const char* scalingTierName(ScalingTier tier)
+{
+    switch (tier)
+    {
+    case ScalingTier::Scalar:
+        return "scalar";
+    case ScalingTier::SSE2:
+        return "SSE2";
+    case ScalingTier::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+bool setActiveScalingTier(ScalingTier tier)
+{
+    if (!scalingKernels(tier))
+    {
+        return false;
+    }
+    activeTier().store(tier, std::memory_order_relaxed);
+    return true;
+}
+
+FilterScaler::FilterScaler(ScalingFilter filter, std::uint32_t sourceWidth, std::uint32_t sourceHeight, std::uint32_t outputWidth, std::uint32_t outputHeight)
+    : filter_(filter)
+    , sourceWidth_(std::max(sourceWidth, 1u))
+    , sourceHeight_(std::max(sourceHeight, 1u))
+    , outputWidth_(std::max(outputWidth, 1u))
+    , outputHeight_(std::max(outputHeight, 1u))
+{
+    columns_ = buildAxis(filter_, sourceWidth_, outputWidth_);
+    rows_ = buildAxis(filter_, sourceHeight_, outputHeight_);
+}
+
+// Output pixel i samples at c = (i + 0.5) * source / output - 0.5. Nearest
+// takes texel floor(c + 0.5); the others weigh the texels around c, folding
+// any past an edge into the edge texel, and the window is shifted inside the
+// source so every tap can be read.
+FilterScaler::Axis FilterScaler::buildAxis(ScalingFilter filter, std::uint32_t source, std::uint32_t output)
+{
+    Axis axis;
+    axis.first.resize(output);
+    if (filter != ScalingFilter::Bicubic && filter != ScalingFilter::Lanczos3)
+    {
+        axis.taps = 1;
+        axis.weights.assign(output, static_cast<std::int16_t>(kWeightOne));
+        for (std::uint32_t i = 0; i < output; ++i)
+        {
+            const std::uint64_t texel = (2 * static_cast<std::uint64_t>(i) + 1) * source / (2 * static_cast<std::uint64_t>(output));
+            axis.first[i] = static_cast<std::uint32_t>(std::min<std::uint64_t>(texel, source - 1));
+        }
+        return axis;
+    }
+
+    const bool lanczos = filter == ScalingFilter::Lanczos3;
+    const std::int64_t kernelTaps = lanczos ? 6 : 4;
+    axis.taps = static_cast<std::uint32_t>(std::min<std::int64_t>(kernelTaps, source));
+    axis.weights.assign(static_cast<std::size_t>(output) * axis.taps, 0);
+    std::vector<double> folded(axis.taps);
+    for (std::uint32_t i = 0; i < output; ++i)
+    {
+        const double centre = (static_cast<double>(i) + 0.5) * source / output - 0.5;
+        const double base = std::floor(centre);
+        const double fraction = centre - base;
+        const std::int64_t start = static_cast<std::int64_t>(base) - (kernelTaps / 2 - 1);
+        const auto first = static_cast<std::uint32_t>(std::clamp<std::int64_t>(start, 0, static_cast<std::int64_t>(source - axis.taps)));
+        axis.first[i] = first;
+
+        std::fill(folded.begin(), folded.end(), 0.0);
+        double total = 0.0;
+        for (std::int64_t k = 0; k < kernelTaps; ++k)
+        {
+            const double distance = static_cast<double>(k - (kernelTaps / 2 - 1)) - fraction;
+            const double weight = lanczos ? lanczos3(distance) : catmullRom(distance);
+            const std::int64_t texel = std::clamp<std::int64_t>(start + k, 0, static_cast<std::int64_t>(source) - 1);
+            folded[static_cast<std::size_t>(texel - first)] += weight;
+            total += weight;
+        }
+
+        std::int16_t* weights = axis.weights.data() + static_cast<std::size_t>(i) * axis.taps;
+        std::int32_t sum = 0;
+        std::size_t largest = 0;
+        for (std::size_t t = 0; t < axis.taps; ++t)
+        {
+            weights[t] = static_cast<std::int16_t>(std::lround(folded[t] / total * kWeightOne));
+            sum += weights[t];
+            if (weights[t] > weights[largest])
+            {
+                largest = t;
+            }
+        }
+        // Rounding may leave the sum a little off; flat areas must stay flat.
+        weights[largest] = static_cast<std::int16_t>(weights[largest] + kWeightOne - sum);
+    }
+    return axis;
+}
+
+void FilterScaler::scaleRegion(std::uint8_t* dst,
+                               std::size_t dstPitch,
+                               const DirtyRect& region,
+                               const std::uint8_t* src,
+                               std::size_t srcPitch,
+                               ScalingScratch& scratch) const
+{
+    scaleRegionWith(activeScalingTier(), dst, dstPitch, region, src, srcPitch, scratch);
+}
+
+bool FilterScaler::scaleRegionWith(ScalingTier tier,
+                                   std::uint8_t* dst,
+                                   std::size_t dstPitch,
+                                   const DirtyRect& region,
+                                   const std::uint8_t* src,
+                                   std::size_t srcPitch,
+                                   ScalingScratch& scratch) const
+{
+    const ScalingKernels* kernels = scalingKernels(tier);
+    if (!kernels)
+    {
+        return false;
+    }
+
+    const std::uint32_t left = std::min(region.left, outputWidth_);
+    const std::uint32_t right = std::min(region.right, outputWidth_);
+    const std::uint32_t top = std::min(region.top, outputHeight_);
+    const std::uint32_t bottom = std::min(region.bottom, outputHeight_);
+    if (left >= right || top >= bottom)
+    {
+        return true;
+    }
+    const std::size_t pixels = right - left;
+    const std::uint32_t* columns = columns_.first.data() + left;
+
+    if (columns_.taps == 1)
+    {
+        for (std::uint32_t y = top; y < bottom; ++y)
+        {
+            const auto* row = reinterpret_cast<const std::uint32_t*>(src + static_cast<std::size_t>(rows_.first[y]) * srcPitch);
+            auto* out = reinterpret_cast<std::uint32_t*>(dst + static_cast<std::size_t>(y - top) * dstPitch);
+            kernels->gather(out, row, columns, pixels);
+        }
+        return true;
+    }
+
+    // Filtered source rows live in a ring indexed by row number, as in
+    // AreaScaler: neighbouring output rows share most of their window.
+    const std::size_t ringSize = rows_.taps;
+    const std::size_t filteredValues = pixels * 4;
+    scratch.filteredRows.resize(ringSize * filteredValues);
+    scratch.filteredTags.assign(ringSize, kNoRow);
+    scratch.windowRows.resize(ringSize);
+    const std::int16_t* columnWeights = columns_.weights.data() + static_cast<std::size_t>(left) * columns_.taps;
+
+    for (std::uint32_t y = top; y < bottom; ++y)
+    {
+        for (std::uint32_t tap = 0; tap < rows_.taps; ++tap)
+        {
+            const std::uint32_t row = rows_.first[y] + tap;
+            const std::size_t slot = row % ringSize;
+            std::int16_t* filtered = scratch.filteredRows.data() + slot * filteredValues;
+            if (scratch.filteredTags[slot] != row)
+            {
+                kernels->horizontal(filtered, src + static_cast<std::size_t>(row) * srcPitch, columns, columnWeights, columns_.taps, pixels);
+                scratch.filteredTags[slot] = row;
+            }
+            scratch.windowRows[tap] = filtered;
+        }
+        std::uint8_t* out = dst + static_cast<std::size_t>(y - top) * dstPitch;
+        kernels->vertical(out, scratch.windowRows.data(), rows_.weights.data() + static_cast<std::size_t>(y) * rows_.taps, rows_.taps, filteredValues);
+    }
+    return true;
+}
+
+void sharpenTexture(std::uint8_t* dst,
+                    std::size_t dstPitch,
+                    const std::uint8_t* src,
+                    std::size_t srcPitch,
+                    std::uint32_t width,
+                    std::uint32_t height)
+{
+    sharpenTextureWith(activeScalingTier(), dst, dstPitch, src, srcPitch, width, height);
+}
+
+bool sharpenTextureWith(ScalingTier tier,
+                        std::uint8_t* dst,
+                        std::size_t dstPitch,
+                        const std::uint8_t* src,
+                        std::size_t srcPitch,
+                        std::uint32_t width,
+                        std::uint32_t height)
+{
+    const ScalingKernels* kernels = scalingKernels(tier);
+    if (!kernels)
+    {
+        return false;
+    }
+    for (std::uint32_t y = 0; y < height; ++y)
+    {
+        const std::uint8_t* row = src + static_cast<std::size_t>(y) * srcPitch;
+        const std::uint8_t* above = y == 0 ? row : row - srcPitch;
+        const std::uint8_t* below = y + 1 == height ? row : row + srcPitch;
+        kernels->sharpen(dst + static_cast<std::size_t>(y) * dstPitch, above, row, below, width);
+    }
+    return true;
+}
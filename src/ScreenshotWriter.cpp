@@ -0,0 +1,200 @@
+#include "ScreenshotWriter.hpp"
+
+#include "ImageEncoder.hpp"
+#include "StripeWorkerPool.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+ScreenshotWriter::ScreenshotWriter()
+    : thread_([this]() { writerLoop(); })
+{
+}
+
+ScreenshotWriter::~ScreenshotWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exitRequested_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void ScreenshotWriter::request(std::filesystem::path stem, ScreenshotFormat format)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    requestStem_ = std::move(stem);
+    requestFormat_ = format;
+    requested_.store(true, std::memory_order_release);
+}
+
+bool ScreenshotWriter::beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target)
+{
+    if (width == 0 || height == 0 || !requested_.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    Job job;
+    bool busy = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!requested_.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        requested_.store(false, std::memory_order_relaxed);
+        job.stem = requestStem_;
+        job.format = requestFormat_;
+        busy = queue_.size() >= kMaxQueued;
+    }
+    if (busy)
+    {
+        job.error = "still saving earlier screenshots";
+        enqueue(std::move(job));
+        return false;
+    }
+
+    const std::size_t bytes = static_cast<std::size_t>(width) * 4 * height;
+    job.frame.data = pool_.acquire(bytes, FramePool::PixelFormat::BGRA8);
+    if (job.frame.data.empty())
+    {
+        job.error = "no memory for a " + std::to_string(width) + "x" + std::to_string(height) + " copy";
+        enqueue(std::move(job));
+        return false;
+    }
+    job.frame.width = width;
+    job.frame.height = height;
+    job.frame.stride = width * 4;
+
+    target.data = job.frame.data.data();
+    target.rowPitch = job.frame.stride;
+    target.width = width;
+    target.height = height;
+    target.contentSequence = 0;
+    pending_ = std::move(job);
+    return true;
+}
+
+void ScreenshotWriter::commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence)
+{
+    if (!pending_)
+    {
+        return;
+    }
+    pending_->frame.timestamp100ns = frame.timestamp100ns;
+    pending_->frame.sequence = sequence;
+    pending_->frame.timestamps = FrameTimestamps{frame.arrivalNs, latencyClockNs()};
+    enqueue(std::move(*pending_));
+    pending_.reset();
+}
+
+void ScreenshotWriter::enqueue(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void ScreenshotWriter::writerLoop()
+{
+    // Made on the first screenshot, so an unused writer costs one idle thread.
+    std::optional<StripeWorkerPool> workers;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return exitRequested_ || !queue_.empty(); });
+            if (queue_.empty())
+            {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        if (!job.frame.data.empty() && !workers)
+        {
+            workers.emplace();
+        }
+        const ScreenshotResult result = save(job, workers ? &*workers : nullptr);
+        if (onComplete_)
+        {
+            onComplete_(result);
+        }
+
+        // Once idle, keep only the buffer just used cached: the next
+        // screenshot is likely the same size, while the extra copies of a
+        // burst or an earlier mode would only hold memory.
+        bool idle = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle = queue_.empty();
+        }
+        if (idle)
+        {
+            pool_.trim();
+        }
+        job.frame.data.reset();
+    }
+}
+
+ScreenshotResult ScreenshotWriter::save(const Job& job, StripeWorkerPool* workers)
+{
+    ScreenshotResult result;
+    result.width = job.frame.width;
+    result.height = job.frame.height;
+    if (job.frame.data.empty())
+    {
+        result.error = job.error;
+        return result;
+    }
+
+    if (job.stem.has_parent_path())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(job.stem.parent_path(), ec);
+    }
+
+    const std::uint8_t* pixels = job.frame.data.data();
+    std::vector<std::uint8_t> encoded;
+    const auto write = [&](const char* extension, auto&& encode) {
+        const auto start = std::chrono::steady_clock::now();
+        encode();
+        result.encodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::filesystem::path file = job.stem;
+        file += extension;
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        if (!out)
+        {
+            result.error = "could not write " + file.string();
+            return false;
+        }
+        result.files.push_back(std::move(file));
+        return true;
+    };
+
+    if (job.format != ScreenshotFormat::Qoi &&
+        !write(".png", [&]() { encodePng(pixels, job.frame.stride, job.frame.width, job.frame.height, encoded, workers); }))
+    {
+        return result;
+    }
+    if (job.format != ScreenshotFormat::Png &&
+        !write(".qoi", [&]() { encodeQoi(pixels, job.frame.stride, job.frame.width, job.frame.height, encoded); }))
+    {
+        return result;
+    }
+    result.saved = true;
+    return result;
+}
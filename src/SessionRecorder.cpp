@@ -0,0 +1,994 @@
+#include "SessionRecorder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+namespace
+{
+    constexpr char kFileMagic[8] = {'P', 'K', 'V', 'M', 'R', 'E', 'C', '1'};
+    constexpr std::size_t kFileHeaderBytes = 16;
+    constexpr std::size_t kRecordHeaderBytes = 8;
+    constexpr std::size_t kFrameFieldsBytes = 40;
+
+    constexpr std::uint32_t fourCC(const char (&text)[5])
+    {
+        return static_cast<std::uint32_t>(static_cast<unsigned char>(text[0])) |
+               (static_cast<std::uint32_t>(static_cast<unsigned char>(text[1])) << 8) |
+               (static_cast<std::uint32_t>(static_cast<unsigned char>(text[2])) << 16) |
+               (static_cast<std::uint32_t>(static_cast<unsigned char>(text[3])) << 24);
+    }
+
+    constexpr std::uint32_t kFrameRecord = fourCC("FRAM");
+    constexpr std::uint32_t kEndRecord = fourCC("END ");
+
+    void put32(std::vector<std::uint8_t>& out, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void put64(std::vector<std::uint8_t>& out, std::uint64_t value)
+    {
+        put32(out, static_cast<std::uint32_t>(value));
+        put32(out, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    void patch32(std::vector<std::uint8_t>& out, std::size_t offset, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out[offset + i] = static_cast<std::uint8_t>(value >> (8 * i));
+        }
+    }
+
+    std::uint32_t get32(const std::uint8_t* p)
+    {
+        return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+               (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+    }
+
+    std::uint64_t get64(const std::uint8_t* p)
+    {
+        return get32(p) | (static_cast<std::uint64_t>(get32(p + 4)) << 32);
+    }
+
+    std::uint32_t tileCount(std::uint32_t pixels)
+    {
+        return (pixels + kRecordTileSize - 1) / kRecordTileSize;
+    }
+
+    // Whether two spans of BGRA pixels hold the same colours. Alpha is not
+    // recorded and capture leaves it undefined, so it must not mark a tile.
+    bool sameBgr(const std::uint8_t* a, const std::uint8_t* b, std::size_t pixels)
+    {
+        std::uint32_t difference = 0;
+        for (std::size_t x = 0; x < pixels; ++x)
+        {
+            std::uint32_t left;
+            std::uint32_t right;
+            std::memcpy(&left, a + x * 4, sizeof(left));
+            std::memcpy(&right, b + x * 4, sizeof(right));
+            difference |= left ^ right;
+        }
+        return (difference & 0x00FFFFFFu) == 0;
+    }
+
+    // LZ4 block format (github.com/lz4/lz4, doc/lz4_Block_format.md), so any
+    // LZ4 decoder can read the tile data. Greedy, one hash probe, and the
+    // reference encoder's skip heuristic on incompressible stretches.
+    constexpr int kLz4HashLog = 14;
+    constexpr std::size_t kLz4MinMatch = 4;
+    constexpr std::size_t kLz4LastLiterals = 5;
+    constexpr std::size_t kLz4MatchFindLimit = 12;
+    constexpr std::size_t kLz4MaxOffset = 65535;
+
+    std::size_t lz4Bound(std::size_t bytes)
+    {
+        return bytes + bytes / 255 + 16;
+    }
+
+    std::uint32_t read32(const std::uint8_t* p)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    std::uint64_t read64(const std::uint8_t* p)
+    {
+        std::uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    std::uint32_t lz4Hash(std::uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - kLz4HashLog);
+    }
+
+    std::uint8_t* lz4Length(std::uint8_t* op, std::size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            *op++ = 255;
+        }
+        *op++ = static_cast<std::uint8_t>(length);
+        return op;
+    }
+
+    // `dst` holds lz4Bound(size) bytes; `table` 1 << kLz4HashLog entries.
+    std::size_t lz4Compress(const std::uint8_t* src, std::size_t size, std::uint8_t* dst, std::uint32_t* table)
+    {
+        std::uint8_t* op = dst;
+        const std::uint8_t* anchor = src;
+
+        if (size > kLz4MatchFindLimit)
+        {
+            std::fill(table, table + (std::size_t{1} << kLz4HashLog), 0u);
+            const std::uint8_t* const matchStartLimit = src + size - kLz4MatchFindLimit;
+            const std::uint8_t* const matchEndLimit = src + size - kLz4LastLiterals;
+            const std::uint8_t* ip = src + 1;
+
+            for (;;)
+            {
+                const std::uint8_t* match = nullptr;
+                unsigned searches = 1u << 6;
+                for (;;)
+                {
+                    if (ip > matchStartLimit)
+                    {
+                        goto lastLiterals;
+                    }
+                    const std::uint32_t sequence = read32(ip);
+                    const std::uint32_t hash = lz4Hash(sequence);
+                    match = src + table[hash];
+                    table[hash] = static_cast<std::uint32_t>(ip - src);
+                    if (static_cast<std::size_t>(ip - match) <= kLz4MaxOffset && read32(match) == sequence)
+                    {
+                        break;
+                    }
+                    ip += searches++ >> 6;
+                }
+
+                while (ip > anchor && match > src && ip[-1] == match[-1])
+                {
+                    --ip;
+                    --match;
+                }
+
+                std::uint8_t* token = op++;
+                const std::size_t literals = static_cast<std::size_t>(ip - anchor);
+                *token = static_cast<std::uint8_t>(std::min<std::size_t>(literals, 15) << 4);
+                if (literals >= 15)
+                {
+                    op = lz4Length(op, literals - 15);
+                }
+                std::memcpy(op, anchor, literals);
+                op += literals;
+
+                const std::size_t offset = static_cast<std::size_t>(ip - match);
+                *op++ = static_cast<std::uint8_t>(offset);
+                *op++ = static_cast<std::uint8_t>(offset >> 8);
+
+                const std::uint8_t* end = ip + kLz4MinMatch;
+                const std::uint8_t* ref = match + kLz4MinMatch;
+                while (end + 8 <= matchEndLimit)
+                {
+                    const std::uint64_t diff = read64(end) ^ read64(ref);
+                    if (diff != 0)
+                    {
+                        end += std::countr_zero(diff) / 8;
+                        goto matchEnd;
+                    }
+                    end += 8;
+                    ref += 8;
+                }
+                while (end < matchEndLimit && *end == *ref)
+                {
+                    ++end;
+                    ++ref;
+                }
+            matchEnd:
+                const std::size_t matchLength = static_cast<std::size_t>(end - ip) - kLz4MinMatch;
+                *token |= static_cast<std::uint8_t>(std::min<std::size_t>(matchLength, 15));
+                if (matchLength >= 15)
+                {
+                    op = lz4Length(op, matchLength - 15);
+                }
+
+                ip = end;
+                anchor = ip;
+                if (ip > matchStartLimit)
+                {
+                    break;
+                }
+                table[lz4Hash(read32(ip - 2))] = static_cast<std::uint32_t>(ip - 2 - src);
+            }
+        }
+
+    lastLiterals:
+        const std::size_t literals = static_cast<std::size_t>(src + size - anchor);
+        *op++ = static_cast<std::uint8_t>(std::min<std::size_t>(literals, 15) << 4);
+        if (literals >= 15)
+        {
+            op = lz4Length(op, literals - 15);
+        }
+        std::memcpy(op, anchor, literals);
+        op += literals;
+        return static_cast<std::size_t>(op - dst);
+    }
+
+    bool lz4Decompress(const std::uint8_t* src, std::size_t size, std::uint8_t* dst, std::size_t dstSize)
+    {
+        const std::uint8_t* ip = src;
+        const std::uint8_t* const ipEnd = src + size;
+        std::uint8_t* op = dst;
+        std::uint8_t* const opEnd = dst + dstSize;
+
+        const auto readLength = [&](std::size_t& length) {
+            std::uint8_t byte = 255;
+            while (byte == 255)
+            {
+                if (ip == ipEnd)
+                {
+                    return false;
+                }
+                byte = *ip++;
+                length += byte;
+            }
+            return true;
+        };
+
+        while (ip < ipEnd)
+        {
+            const std::uint8_t token = *ip++;
+            std::size_t literals = token >> 4;
+            if (literals == 15 && !readLength(literals))
+            {
+                return false;
+            }
+            if (literals > static_cast<std::size_t>(ipEnd - ip) || literals > static_cast<std::size_t>(opEnd - op))
+            {
+                return false;
+            }
+            std::memcpy(op, ip, literals);
+            op += literals;
+            ip += literals;
+            if (ip == ipEnd)
+            {
+                break;
+            }
+
+            if (ipEnd - ip < 2)
+            {
+                return false;
+            }
+            const std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+            ip += 2;
+            std::size_t matchLength = token & 15;
+            if (matchLength == 15 && !readLength(matchLength))
+            {
+                return false;
+            }
+            matchLength += kLz4MinMatch;
+            if (offset == 0 || offset > static_cast<std::size_t>(op - dst) ||
+                matchLength > static_cast<std::size_t>(opEnd - op))
+            {
+                return false;
+            }
+            // Byte by byte: the match may overlap what it writes.
+            const std::uint8_t* ref = op - offset;
+            for (std::size_t i = 0; i < matchLength; ++i)
+            {
+                op[i] = ref[i];
+            }
+            op += matchLength;
+        }
+        return op == opEnd;
+    }
+}
+
+// Appends to a file through a few rotating buffers. On Windows each buffer is
+// written with overlapped I/O, so the encoder can fill the next one meanwhile.
+// (NTFS completes writes that extend a file synchronously; either way only the
+// encoder thread waits.) Elsewhere, for tools and tests, writes are plain.
+class RecordingFile {
+public:
+    static constexpr std::size_t kBuffers = 4;
+
+    RecordingFile() = default;
+    ~RecordingFile() { close(); }
+
+    RecordingFile(const RecordingFile&) = delete;
+    RecordingFile& operator=(const RecordingFile&) = delete;
+
+    bool open(const std::filesystem::path& path)
+    {
+#if defined(_WIN32)
+        file_ = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        for (OVERLAPPED& overlapped : overlapped_)
+        {
+            overlapped = OVERLAPPED{};
+            overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            if (!overlapped.hEvent)
+            {
+                close();
+                return false;
+            }
+        }
+        return true;
+#else
+        file_ = std::fopen(path.string().c_str(), "wb");
+        return file_ != nullptr;
+#endif
+    }
+
+    // The buffer to fill next, emptied. Null once a write has failed.
+    std::vector<std::uint8_t>* acquire()
+    {
+        if (!waitFor(next_))
+        {
+            return nullptr;
+        }
+        buffers_[next_].clear();
+        return &buffers_[next_];
+    }
+
+    // Writes the buffer acquire() returned.
+    bool submit()
+    {
+        std::vector<std::uint8_t>& buffer = buffers_[next_];
+#if defined(_WIN32)
+        OVERLAPPED& overlapped = overlapped_[next_];
+        overlapped.Offset = static_cast<DWORD>(offset_);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset_ >> 32);
+        ResetEvent(overlapped.hEvent);
+        if (!WriteFile(file_, buffer.data(), static_cast<DWORD>(buffer.size()), nullptr, &overlapped) &&
+            GetLastError() != ERROR_IO_PENDING)
+        {
+            failed_ = true;
+            return false;
+        }
+        pending_[next_] = true;
+#else
+        if (std::fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size())
+        {
+            failed_ = true;
+            return false;
+        }
+#endif
+        offset_ += buffer.size();
+        next_ = (next_ + 1) % kBuffers;
+        return true;
+    }
+
+    // Waits for every write and closes the file. False if any write failed.
+    bool close()
+    {
+        bool ok = true;
+        for (std::size_t i = 0; i < kBuffers; ++i)
+        {
+            ok = waitFor(i) && ok;
+        }
+#if defined(_WIN32)
+        for (OVERLAPPED& overlapped : overlapped_)
+        {
+            if (overlapped.hEvent)
+            {
+                CloseHandle(overlapped.hEvent);
+                overlapped.hEvent = nullptr;
+            }
+        }
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (file_)
+        {
+            ok = std::fclose(file_) == 0 && ok;
+            file_ = nullptr;
+        }
+#endif
+        return ok && !failed_;
+    }
+
+    [[nodiscard]] std::uint64_t bytesWritten() const noexcept { return offset_; }
+
+private:
+    bool waitFor(std::size_t index)
+    {
+#if defined(_WIN32)
+        if (pending_[index])
+        {
+            pending_[index] = false;
+            DWORD written = 0;
+            if (!GetOverlappedResult(file_, &overlapped_[index], &written, TRUE) ||
+                written != buffers_[index].size())
+            {
+                failed_ = true;
+            }
+        }
+#else
+        (void)index;
+#endif
+        return !failed_;
+    }
+
+    std::array<std::vector<std::uint8_t>, kBuffers> buffers_;
+    std::size_t next_ = 0;
+    std::uint64_t offset_ = 0;
+    bool failed_ = false;
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    std::array<OVERLAPPED, kBuffers> overlapped_{};
+    std::array<bool, kBuffers> pending_{};
+#else
+    std::FILE* file_ = nullptr;
+#endif
+};
+
+SessionRecorder::SessionRecorder() = default;
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+bool SessionRecorder::start(const std::filesystem::path& path)
+{
+    stop();
+
+    if (path.has_parent_path())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    auto file = std::make_unique<RecordingFile>();
+    std::vector<std::uint8_t>* header = file->open(path) ? file->acquire() : nullptr;
+    if (!header)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = "could not create " + path.string();
+        return false;
+    }
+    header->insert(header->end(), std::begin(kFileMagic), std::end(kFileMagic));
+    put32(*header, kRecordingVersion);
+    put32(*header, kRecordTileSize);
+    file->submit();
+
+    if (!workers_)
+    {
+        workers_ = std::make_unique<StripeWorkerPool>();
+    }
+    file_ = std::move(file);
+    referenceWidth_ = 0;
+    referenceHeight_ = 0;
+    frameIndex_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.clear();
+        stopRequested_ = false;
+        droppedSinceCommit_ = 0;
+        error_.clear();
+        stats_ = SessionRecorderStats{};
+        stats_.fileBytes = kFileHeaderBytes;
+        recording_.store(true, std::memory_order_release);
+    }
+    thread_ = std::thread([this]() { encoderLoop(); });
+    return true;
+}
+
+SessionRecorderStats SessionRecorder::stop()
+{
+    if (!thread_.joinable())
+    {
+        return stats();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recording_.store(false, std::memory_order_release);
+        stopRequested_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    // A recording holds a few frames' worth of memory; give it back.
+    file_.reset();
+    for (Slot& slot : slots_)
+    {
+        slot.frame.data.reset();
+        slot.frame.sequence = 0;
+    }
+    pool_.trim();
+    reference_ = {};
+    bands_.clear();
+    return stats();
+}
+
+SessionRecorderStats SessionRecorder::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::string SessionRecorder::error() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+bool SessionRecorder::beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target)
+{
+    if (width == 0 || height == 0 || !recording_.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recording_.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    // The free slot holding the newest frame needs the fewest tiles copied.
+    std::size_t index = kSlots;
+    for (std::size_t i = 0; i < kSlots; ++i)
+    {
+        if (slots_[i].state == SlotState::Free && (index == kSlots || slots_[i].frame.sequence > slots_[index].frame.sequence))
+        {
+            index = i;
+        }
+    }
+    Slot* slot = index != kSlots ? &slots_[index] : nullptr;
+
+    const std::size_t bytes = static_cast<std::size_t>(width) * 4 * height;
+    if (slot && slot->frame.data.size() != bytes)
+    {
+        slot->frame.data.reset();
+        slot->frame.sequence = 0;
+        slot->frame.data = pool_.acquire(bytes, FramePool::PixelFormat::BGRA8);
+        if (slot->frame.data.empty())
+        {
+            slot = nullptr;
+        }
+    }
+    if (!slot)
+    {
+        ++droppedSinceCommit_;
+        ++stats_.framesDropped;
+        return false;
+    }
+
+    slot->state = SlotState::Writing;
+    slot->frame.width = width;
+    slot->frame.height = height;
+    slot->frame.stride = width * 4;
+    writingSlot_ = index;
+
+    target.data = slot->frame.data.data();
+    target.rowPitch = slot->frame.stride;
+    target.width = width;
+    target.height = height;
+    target.contentSequence = slot->frame.sequence;
+    return true;
+}
+
+void SessionRecorder::commitFrame(const DirectShowCapture::Frame& frame, std::uint64_t sequence)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writingSlot_ == kSlots)
+        {
+            return;
+        }
+        Slot& slot = slots_[writingSlot_];
+        slot.frame.timestamp100ns = frame.timestamp100ns;
+        slot.frame.sequence = sequence;
+        slot.frame.timestamps = FrameTimestamps{frame.arrivalNs, latencyClockNs()};
+        slot.droppedBefore = droppedSinceCommit_;
+        droppedSinceCommit_ = 0;
+        slot.state = SlotState::Queued;
+        queue_.push_back(writingSlot_);
+        writingSlot_ = kSlots;
+    }
+    cv_.notify_all();
+}
+
+bool SessionRecorder::missedFrame() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return droppedSinceCommit_ != 0;
+}
+
+void SessionRecorder::fail(const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty())
+    {
+        error_ = message;
+    }
+    recording_.store(false, std::memory_order_release);
+}
+
+void SessionRecorder::encoderLoop()
+{
+    for (;;)
+    {
+        std::size_t index = kSlots;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return !queue_.empty() || (stopRequested_ && writingSlot_ == kSlots); });
+            if (queue_.empty())
+            {
+                break;
+            }
+            index = queue_.front();
+            queue_.pop_front();
+            slots_[index].state = SlotState::Encoding;
+        }
+
+        Slot& slot = slots_[index];
+        std::vector<std::uint8_t>* out = file_->acquire();
+        double encodeMs = 0.0;
+        bool key = false;
+        if (out)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            key = encodeFrame(slot, *out);
+            encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        const std::size_t recordBytes = out ? out->size() : 0;
+        const bool written = out && file_->submit();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.state = SlotState::Free;
+            if (written)
+            {
+                ++stats_.framesRecorded;
+                stats_.keyFrames += key ? 1 : 0;
+                stats_.rawBytes += static_cast<std::uint64_t>(slot.frame.width) * slot.frame.height * 3;
+                stats_.fileBytes += recordBytes;
+                stats_.encodeMs += encodeMs;
+            }
+            else
+            {
+                ++stats_.framesDropped;
+            }
+        }
+        if (!written)
+        {
+            fail("could not write to the recording");
+        }
+    }
+
+    std::uint64_t recorded = 0;
+    std::uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recorded = stats_.framesRecorded;
+        dropped = stats_.framesDropped;
+    }
+    std::vector<std::uint8_t>* trailer = file_->acquire();
+    if (trailer)
+    {
+        put32(*trailer, kEndRecord);
+        put32(*trailer, 16);
+        put64(*trailer, recorded);
+        put64(*trailer, dropped);
+        file_->submit();
+    }
+    const bool closed = file_->close();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.fileBytes = file_->bytesWritten();
+    }
+    if (!trailer || !closed)
+    {
+        fail("could not write to the recording");
+    }
+}
+
+bool SessionRecorder::encodeFrame(const Slot& slot, std::vector<std::uint8_t>& out)
+{
+    const std::uint32_t width = slot.frame.width;
+    const std::uint32_t height = slot.frame.height;
+    const std::size_t stride = slot.frame.stride;
+    const std::uint8_t* pixels = slot.frame.data.data();
+    const std::uint32_t tilesX = tileCount(width);
+    const std::uint32_t tilesY = tileCount(height);
+
+    bool key = frameIndex_ % kKeyFrameInterval == 0;
+    if (referenceWidth_ != width || referenceHeight_ != height)
+    {
+        reference_.assign(static_cast<std::size_t>(width) * 4 * height, 0);
+        referenceWidth_ = width;
+        referenceHeight_ = height;
+        key = true;
+    }
+    const std::size_t referenceStride = static_cast<std::size_t>(width) * 4;
+
+    if (bands_.size() < tilesY)
+    {
+        bands_.resize(tilesY);
+    }
+    workers_->run(tilesY, [&](std::size_t ty) {
+        BandScratch& band = bands_[ty];
+        const std::uint32_t top = static_cast<std::uint32_t>(ty) * kRecordTileSize;
+        const std::uint32_t bottom = std::min(height, top + kRecordTileSize);
+        band.marked.assign(tilesX, 0);
+        band.raw.clear();
+        band.raw.reserve(static_cast<std::size_t>(width) * kRecordTileSize * 3);
+
+        for (std::uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            const std::uint32_t left = tx * kRecordTileSize;
+            const std::size_t tileWidth = std::min(width, left + kRecordTileSize) - left;
+            const std::size_t rowBytes = tileWidth * 4;
+            bool changed = key;
+            for (std::uint32_t y = top; y < bottom && !changed; ++y)
+            {
+                changed = !sameBgr(pixels + y * stride + left * 4, reference_.data() + y * referenceStride + left * 4, tileWidth);
+            }
+            if (!changed)
+            {
+                continue;
+            }
+
+            band.marked[tx] = 1;
+            std::size_t offset = band.raw.size();
+            band.raw.resize(offset + tileWidth * (bottom - top) * 3);
+            for (std::uint32_t y = top; y < bottom; ++y)
+            {
+                const std::uint8_t* src = pixels + y * stride + left * 4;
+                std::uint8_t* ref = reference_.data() + y * referenceStride + left * 4;
+                std::uint8_t* dst = band.raw.data() + offset;
+                if (key)
+                {
+                    for (std::size_t x = 0; x < tileWidth; ++x)
+                    {
+                        dst[x * 3 + 0] = src[x * 4 + 0];
+                        dst[x * 3 + 1] = src[x * 4 + 1];
+                        dst[x * 3 + 2] = src[x * 4 + 2];
+                    }
+                }
+                else
+                {
+                    for (std::size_t x = 0; x < tileWidth; ++x)
+                    {
+                        dst[x * 3 + 0] = src[x * 4 + 0] ^ ref[x * 4 + 0];
+                        dst[x * 3 + 1] = src[x * 4 + 1] ^ ref[x * 4 + 1];
+                        dst[x * 3 + 2] = src[x * 4 + 2] ^ ref[x * 4 + 2];
+                    }
+                }
+                std::memcpy(ref, src, rowBytes);
+                offset += tileWidth * 3;
+            }
+        }
+
+        band.packed.clear();
+        if (!band.raw.empty())
+        {
+            band.hashTable.resize(std::size_t{1} << kLz4HashLog);
+            band.packed.resize(lz4Bound(band.raw.size()));
+            band.packed.resize(lz4Compress(band.raw.data(), band.raw.size(), band.packed.data(), band.hashTable.data()));
+        }
+    });
+
+    put32(out, kFrameRecord);
+    const std::size_t sizeOffset = out.size();
+    put32(out, 0);
+    put64(out, frameIndex_);
+    put64(out, slot.frame.timestamp100ns);
+    put64(out, slot.frame.timestamps.captured);
+    put32(out, width);
+    put32(out, height);
+    put32(out, key ? kRecordKeyFrame : 0);
+    put32(out, slot.droppedBefore);
+
+    const std::size_t maskOffset = out.size();
+    out.resize(maskOffset + (static_cast<std::size_t>(tilesX) * tilesY + 7) / 8, 0);
+    for (std::uint32_t ty = 0; ty < tilesY; ++ty)
+    {
+        for (std::uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            const std::size_t bit = static_cast<std::size_t>(ty) * tilesX + tx;
+            out[maskOffset + bit / 8] |= static_cast<std::uint8_t>(bands_[ty].marked[tx] << (bit % 8));
+        }
+    }
+    for (std::uint32_t ty = 0; ty < tilesY; ++ty)
+    {
+        const BandScratch& band = bands_[ty];
+        if (band.raw.empty())
+        {
+            continue;
+        }
+        const bool stored = band.packed.size() >= band.raw.size();
+        const std::vector<std::uint8_t>& data = stored ? band.raw : band.packed;
+        put32(out, static_cast<std::uint32_t>(band.raw.size()));
+        put32(out, static_cast<std::uint32_t>(data.size()));
+        out.insert(out.end(), data.begin(), data.end());
+    }
+    patch32(out, sizeOffset, static_cast<std::uint32_t>(out.size() - sizeOffset - 4));
+    ++frameIndex_;
+    return key;
+}
+
+bool RecordingReader::open(const std::filesystem::path& path)
+{
+    file_.open(path, std::ios::binary);
+    std::uint8_t header[kFileHeaderBytes];
+    if (!file_.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, kFileMagic, sizeof(kFileMagic)) != 0)
+    {
+        error_ = "not a recording";
+        return false;
+    }
+    if (get32(header + 8) != kRecordingVersion || get32(header + 12) != kRecordTileSize)
+    {
+        error_ = "unsupported recording version";
+        return false;
+    }
+    return true;
+}
+
+bool RecordingReader::next(RecordedFrame& frame)
+{
+    if (finished_ || !error_.empty())
+    {
+        return false;
+    }
+
+    std::uint8_t header[kRecordHeaderBytes];
+    if (!file_.read(reinterpret_cast<char*>(header), sizeof(header)))
+    {
+        // A recording that was never stopped cleanly just ends.
+        error_ = "recording ends without a trailer";
+        return false;
+    }
+    payload_.resize(get32(header + 4));
+    if (!file_.read(reinterpret_cast<char*>(payload_.data()), static_cast<std::streamsize>(payload_.size())))
+    {
+        error_ = "truncated record";
+        return false;
+    }
+    const std::uint8_t* p = payload_.data();
+    const std::uint8_t* const end = p + payload_.size();
+
+    if (get32(header) == kEndRecord && payload_.size() >= 16)
+    {
+        framesRecorded_ = get64(p);
+        framesDropped_ = get64(p + 8);
+        finished_ = true;
+        return false;
+    }
+    if (get32(header) != kFrameRecord || payload_.size() < kFrameFieldsBytes)
+    {
+        error_ = "unknown record";
+        return false;
+    }
+
+    frame.index = get64(p);
+    frame.timestamp100ns = get64(p + 8);
+    frame.arrivalNs = get64(p + 16);
+    frame.width = get32(p + 24);
+    frame.height = get32(p + 28);
+    frame.flags = get32(p + 32);
+    frame.droppedBefore = get32(p + 36);
+    p += kFrameFieldsBytes;
+
+    const bool key = (frame.flags & kRecordKeyFrame) != 0;
+    if (frame.width != referenceWidth_ || frame.height != referenceHeight_)
+    {
+        if (!key)
+        {
+            error_ = "frame size changed without a key frame";
+            return false;
+        }
+        reference_.assign(static_cast<std::size_t>(frame.width) * 4 * frame.height, 255);
+        referenceWidth_ = frame.width;
+        referenceHeight_ = frame.height;
+    }
+
+    const std::uint32_t tilesX = tileCount(frame.width);
+    const std::uint32_t tilesY = tileCount(frame.height);
+    const std::uint8_t* mask = p;
+    p += (static_cast<std::size_t>(tilesX) * tilesY + 7) / 8;
+    if (p > end)
+    {
+        error_ = "truncated tile mask";
+        return false;
+    }
+    const auto marked = [&](std::uint32_t tx, std::uint32_t ty) {
+        const std::size_t bit = static_cast<std::size_t>(ty) * tilesX + tx;
+        return (mask[bit / 8] >> (bit % 8)) & 1u;
+    };
+
+    const std::size_t stride = static_cast<std::size_t>(frame.width) * 4;
+    for (std::uint32_t ty = 0; ty < tilesY; ++ty)
+    {
+        const std::uint32_t top = ty * kRecordTileSize;
+        const std::uint32_t bottom = std::min(frame.height, top + kRecordTileSize);
+        std::size_t expected = 0;
+        for (std::uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            if (marked(tx, ty))
+            {
+                expected += static_cast<std::size_t>(std::min(frame.width, (tx + 1) * kRecordTileSize) - tx * kRecordTileSize) * (bottom - top) * 3;
+            }
+        }
+        if (expected == 0)
+        {
+            continue;
+        }
+
+        if (end - p < 8)
+        {
+            error_ = "truncated tile row";
+            return false;
+        }
+        const std::size_t rawBytes = get32(p);
+        const std::size_t storedBytes = get32(p + 4);
+        p += 8;
+        if (rawBytes != expected || storedBytes > static_cast<std::size_t>(end - p))
+        {
+            error_ = "damaged tile row";
+            return false;
+        }
+        const std::uint8_t* raw = p;
+        if (storedBytes != rawBytes)
+        {
+            raw_.resize(rawBytes);
+            if (!lz4Decompress(p, storedBytes, raw_.data(), rawBytes))
+            {
+                error_ = "damaged tile data";
+                return false;
+            }
+            raw = raw_.data();
+        }
+        p += storedBytes;
+
+        for (std::uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            if (!marked(tx, ty))
+            {
+                continue;
+            }
+            const std::uint32_t left = tx * kRecordTileSize;
+            const std::size_t tileWidth = std::min(frame.width, left + kRecordTileSize) - left;
+            for (std::uint32_t y = top; y < bottom; ++y)
+            {
+                std::uint8_t* dst = reference_.data() + y * stride + left * 4;
+                for (std::size_t x = 0; x < tileWidth; ++x)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        dst[x * 4 + c] = key ? raw[x * 3 + c] : static_cast<std::uint8_t>(dst[x * 4 + c] ^ raw[x * 3 + c]);
+                    }
+                }
+                raw += tileWidth * 3;
+            }
+        }
+    }
+
+    frame.pixels = reference_;
+    return true;
+}
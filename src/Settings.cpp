@@ -2,6 +2,7 @@
 
 #include <Windows.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
@@ -383,6 +384,8 @@ AppSettings SettingsManager::load()
     tryParseUInt(content, "videoPreferredWidth", settings.videoPreferredWidth);
     tryParseUInt(content, "videoPreferredHeight", settings.videoPreferredHeight);
     tryParseBool(content, "videoAllowResizing", settings.videoAllowResizing);
+    tryParseBool(content, "videoDownscale", settings.videoDownscale);
+    tryParseBool(content, "videoPresentPacing", settings.videoPresentPacing);
 
     if (settings.videoPreferredWidth == 0 || settings.videoPreferredHeight == 0)
     {
@@ -406,6 +409,35 @@ AppSettings SettingsManager::load()
             settings.videoAspectMode = legacyForceAspect ? VideoAspectMode::Maintain : VideoAspectMode::Stretch;
         }
     }
+
+    unsigned int scalingFilterValue = static_cast<unsigned int>(settings.videoScalingFilter);
+    if (tryParseUInt(content, "videoScalingFilter", scalingFilterValue) && scalingFilterValue < kScalingFilterCount)
+    {
+        settings.videoScalingFilter = static_cast<ScalingFilter>(scalingFilterValue);
+    }
+
+    unsigned int hdrInputValue = static_cast<unsigned int>(settings.hdrInput);
+    if (tryParseUInt(content, "hdrInput", hdrInputValue) && hdrInputValue <= static_cast<unsigned int>(HdrInputMode::Off))
+    {
+        settings.hdrInput = static_cast<HdrInputMode>(hdrInputValue);
+    }
+
+    unsigned int toneMapCurveValue = static_cast<unsigned int>(settings.hdrToneMapCurve);
+    if (tryParseUInt(content, "hdrToneMapCurve", toneMapCurveValue) &&
+        toneMapCurveValue <= static_cast<unsigned int>(ToneMapCurve::Clip))
+    {
+        settings.hdrToneMapCurve = static_cast<ToneMapCurve>(toneMapCurveValue);
+    }
+    tryParseUInt(content, "hdrPeakNits", settings.hdrPeakNits);
+    settings.hdrPeakNits = std::clamp(settings.hdrPeakNits, 203u, 10000u);
+    tryParseString(content, "simdLevel", settings.simdLevel);
+    unsigned int screenshotFormatValue = static_cast<unsigned int>(settings.screenshotFormat);
+    if (tryParseUInt(content, "screenshotFormat", screenshotFormatValue) &&
+        screenshotFormatValue <= static_cast<unsigned int>(ScreenshotFormat::PngAndQoi))
+    {
+        settings.screenshotFormat = static_cast<ScreenshotFormat>(screenshotFormatValue);
+    }
+    tryParseBool(content, "sessionRecording", settings.sessionRecording);
     parseMenuHotkey(content, settings.menuHotkey);
 
     const bool legacyMenuHotkey =
@@ -463,6 +495,15 @@ void SettingsManager::save(const AppSettings& settings) const
     file << "  \"videoPreferredHeight\": " << settings.videoPreferredHeight << ",\n";
     file << "  \"videoAllowResizing\": " << (settings.videoAllowResizing ? "true" : "false") << ",\n";
     file << "  \"videoAspectMode\": " << static_cast<unsigned int>(settings.videoAspectMode) << ",\n";
+    file << "  \"videoScalingFilter\": " << static_cast<unsigned int>(settings.videoScalingFilter) << ",\n";
+    file << "  \"videoDownscale\": " << (settings.videoDownscale ? "true" : "false") << ",\n";
+    file << "  \"videoPresentPacing\": " << (settings.videoPresentPacing ? "true" : "false") << ",\n";
+    file << "  \"hdrInput\": " << static_cast<unsigned int>(settings.hdrInput) << ",\n";
+    file << "  \"hdrToneMapCurve\": " << static_cast<unsigned int>(settings.hdrToneMapCurve) << ",\n";
+    file << "  \"hdrPeakNits\": " << settings.hdrPeakNits << ",\n";
+    file << "  \"simdLevel\": \"" << escapeJson(settings.simdLevel) << "\",\n";
+    file << "  \"screenshotFormat\": " << static_cast<unsigned int>(settings.screenshotFormat) << ",\n";
+    file << "  \"sessionRecording\": " << (settings.sessionRecording ? "true" : "false") << ",\n";
     file << "  \"menuHotkey\": {\n";
     file << "    \"virtualKey\": \"VK_0x";
     file << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << settings.menuHotkey.virtualKey;
@@ -0,0 +1,124 @@
+#include "StripeWorkerPool.hpp"
+
+#include <algorithm>
+
+StripeWorkerPool::StripeWorkerPool(std::size_t workerCount)
+{
+    workers_.reserve(workerCount);
+    for (std::size_t i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+StripeWorkerPool::~StripeWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exitRequested_ = true;
+    }
+    workCv_.notify_all();
+
+    for (auto& worker : workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+std::size_t StripeWorkerPool::defaultWorkerCount()
+{
+    // Copies are bandwidth-bound; a few helpers saturate the memory bus and
+    // more only steal cores from capture and rendering.
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware <= 2 ? 0 : std::min<std::size_t>(3, hardware / 2);
+}
+
+void StripeWorkerPool::dispatch(std::size_t stripes, Invoke invoke, void* context)
+{
+    if (stripes == 0)
+    {
+        return;
+    }
+    if (workers_.empty() || stripes == 1)
+    {
+        for (std::size_t stripe = 0; stripe < stripes; ++stripe)
+        {
+            invoke(context, stripe);
+        }
+        return;
+    }
+
+    {
+        // A worker that woke up late for the previous job may still be
+        // looking at it; the job fields only change once it has left.
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCv_.wait(lock, [this]() { return activeWorkers_ == 0; });
+        stripes_ = stripes;
+        invoke_ = invoke;
+        context_ = context;
+        nextStripe_.store(0, std::memory_order_relaxed);
+        remaining_.store(stripes, std::memory_order_relaxed);
+        ++generation_;
+    }
+    workCv_.notify_all();
+
+    runStripes(stripes, invoke, context);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCv_.wait(lock, [this]() { return remaining_.load(std::memory_order_acquire) == 0; });
+}
+
+void StripeWorkerPool::runStripes(std::size_t stripes, Invoke invoke, void* context)
+{
+    for (;;)
+    {
+        const std::size_t stripe = nextStripe_.fetch_add(1, std::memory_order_relaxed);
+        if (stripe >= stripes)
+        {
+            return;
+        }
+
+        invoke(context, stripe);
+
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            doneCv_.notify_all();
+        }
+    }
+}
+
+void StripeWorkerPool::workerLoop()
+{
+    std::uint64_t seenGeneration = 0;
+    for (;;)
+    {
+        std::size_t stripes = 0;
+        Invoke invoke = nullptr;
+        void* context = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [&]() { return exitRequested_ || generation_ != seenGeneration; });
+            if (exitRequested_)
+            {
+                return;
+            }
+            seenGeneration = generation_;
+            stripes = stripes_;
+            invoke = invoke_;
+            context = context_;
+            ++activeWorkers_;
+        }
+
+        runStripes(stripes, invoke, context);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--activeWorkers_ == 0)
+        {
+            doneCv_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,333 @@
+#include "TestPatternCapture.hpp"
+#include "LatencyStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr std::uint32_t kMaxDimension = 16384;
+    constexpr std::uint32_t kBoxSize = 128;
+    constexpr std::uint32_t kBoxStepX = 7;
+    constexpr std::uint32_t kBoxStepY = 5;
+    constexpr std::uint32_t kScrollStep = 8;
+    constexpr std::uint32_t kBlack = 0xFF000000u;
+    constexpr std::uint32_t kBoxColor = 0xFFFFFFFFu;
+
+    // 75% SMPTE-style bars, BGRA in a little-endian word.
+    constexpr std::uint32_t kBars[] = {
+        0xFFBFBFBFu, 0xFF00BFBFu, 0xFFBFBF00u, 0xFF00BF00u,
+        0xFFBF00BFu, 0xFF0000BFu, 0xFFBF0000u, 0xFF101010u,
+    };
+
+    void logMessage(const std::string& text)
+    {
+        std::ofstream("pckvm.log", std::ios::app) << text << '\n';
+    }
+
+    // Distance along a bounce path folded back into [0, span].
+    std::uint32_t bounce(std::uint64_t distance, std::uint32_t span)
+    {
+        if (span == 0)
+        {
+            return 0;
+        }
+        const std::uint64_t period = 2ull * span;
+        const std::uint64_t position = distance % period;
+        return static_cast<std::uint32_t>(position <= span ? position : period - position);
+    }
+}
+
+TestPatternCapture::TestPatternCapture()
+    : TestPatternCapture(Config{})
+{
+}
+
+TestPatternCapture::TestPatternCapture(Config config)
+    : config_(config)
+{
+}
+
+TestPatternCapture::~TestPatternCapture()
+{
+    stop();
+}
+
+const char* TestPatternCapture::motionName(Motion motion)
+{
+    switch (motion)
+    {
+    case Motion::Static:
+        return "static";
+    case Motion::MovingBox:
+        return "moving box";
+    case Motion::ScrollingBars:
+        return "scrolling bars";
+    case Motion::Noise:
+        return "noise";
+    }
+    return "unknown";
+}
+
+void TestPatternCapture::start(FrameHandler handler, const Options& options)
+{
+    if (!handler)
+    {
+        throw std::invalid_argument("Frame handler must not be empty");
+    }
+    if (running_.load(std::memory_order_acquire))
+    {
+        throw std::runtime_error("Capture already running");
+    }
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+
+    Config config = config_;
+    if (options.desiredWidth != 0 && options.desiredHeight != 0)
+    {
+        config.width = options.desiredWidth;
+        config.height = options.desiredHeight;
+    }
+    if (config.width == 0 || config.height == 0 || config.width > kMaxDimension || config.height > kMaxDimension)
+    {
+        throw std::invalid_argument("Test pattern size out of range");
+    }
+    if (!(config.fps > 0.0))
+    {
+        throw std::invalid_argument("Test pattern frame rate must be positive");
+    }
+    if (config.stride == 0)
+    {
+        config.stride = config.width * 4;
+    }
+    if (config.stride < config.width * 4 || config.stride % 4 != 0)
+    {
+        throw std::invalid_argument("Test pattern stride must be a multiple of 4 covering a row");
+    }
+    if (config.contentRight == 0 && config.contentBottom == 0)
+    {
+        config.contentLeft = 0;
+        config.contentTop = 0;
+        config.contentRight = config.width;
+        config.contentBottom = config.height;
+    }
+    if (config.contentLeft >= config.contentRight || config.contentTop >= config.contentBottom ||
+        config.contentRight > config.width || config.contentBottom > config.height)
+    {
+        throw std::invalid_argument("Test pattern content rectangle is outside the sample");
+    }
+    config_ = config;
+
+    const std::uint32_t contentWidth = config_.contentRight - config_.contentLeft;
+    buffer_.assign(static_cast<std::size_t>(config_.stride) * config_.height, 0);
+    patternRows_.resize(2 * static_cast<std::size_t>(contentWidth));
+    for (std::uint32_t y = 0; y < config_.height; ++y)
+    {
+        auto* pixels = reinterpret_cast<std::uint32_t*>(row(y));
+        std::fill(pixels, pixels + config_.width, kBlack);
+    }
+    drawBackground(0);
+    boxDrawn_ = false;
+    noiseState_ = 0x9E3779B97F4A7C15ull;
+
+    handler_ = std::move(handler);
+    framesDelivered_.store(0, std::memory_order_relaxed);
+    framesLate_.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_.clear();
+    }
+
+    running_.store(true, std::memory_order_release);
+    worker_ = std::thread([this]() { run(); });
+    logMessage("[TestPattern] Started " + currentDeviceFriendlyName());
+}
+
+void TestPatternCapture::stop()
+{
+    running_.store(false, std::memory_order_release);
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+}
+
+std::string TestPatternCapture::consumeLastError()
+{
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    std::string result = lastError_;
+    lastError_.clear();
+    return result;
+}
+
+std::string TestPatternCapture::currentDeviceFriendlyName() const
+{
+    return "Test pattern " + std::to_string(config_.width) + "x" + std::to_string(config_.height) + "@" +
+           std::to_string(static_cast<int>(std::lround(config_.fps))) + " (" + motionName(config_.motion) + ")";
+}
+
+std::uint8_t* TestPatternCapture::row(std::uint32_t y) noexcept
+{
+    const std::uint32_t stored = config_.bottomUp ? config_.height - 1 - y : y;
+    return buffer_.data() + static_cast<std::size_t>(stored) * config_.stride;
+}
+
+void TestPatternCapture::drawBackground(std::uint32_t phase)
+{
+    const std::uint32_t contentWidth = config_.contentRight - config_.contentLeft;
+    const std::uint32_t contentHeight = config_.contentBottom - config_.contentTop;
+    std::uint32_t* bars = patternRows_.data();
+    std::uint32_t* ramp = bars + contentWidth;
+    for (std::uint32_t x = 0; x < contentWidth; ++x)
+    {
+        const std::uint32_t shifted = static_cast<std::uint32_t>((static_cast<std::uint64_t>(x) + phase) % contentWidth);
+        bars[x] = kBars[static_cast<std::uint64_t>(shifted) * std::size(kBars) / contentWidth];
+        const std::uint32_t level = static_cast<std::uint32_t>(static_cast<std::uint64_t>(shifted) * 255 / contentWidth);
+        ramp[x] = 0xFF000000u | (level << 16) | (level << 8) | level;
+    }
+
+    const std::uint32_t split = contentHeight - contentHeight / 3;
+    for (std::uint32_t y = 0; y < contentHeight; ++y)
+    {
+        std::memcpy(row(config_.contentTop + y) + static_cast<std::size_t>(config_.contentLeft) * 4,
+                    y < split ? bars : ramp,
+                    static_cast<std::size_t>(contentWidth) * 4);
+    }
+}
+
+void TestPatternCapture::drawBox(std::uint32_t left, std::uint32_t top, bool erase)
+{
+    const std::uint32_t contentWidth = config_.contentRight - config_.contentLeft;
+    const std::uint32_t contentHeight = config_.contentBottom - config_.contentTop;
+    const std::uint32_t boxWidth = std::min(kBoxSize, contentWidth);
+    const std::uint32_t boxHeight = std::min(kBoxSize, contentHeight);
+    const std::uint32_t split = contentHeight - contentHeight / 3;
+
+    for (std::uint32_t y = top; y < top + boxHeight; ++y)
+    {
+        auto* pixels = reinterpret_cast<std::uint32_t*>(row(config_.contentTop + y)) + config_.contentLeft + left;
+        if (erase)
+        {
+            const std::uint32_t* source = patternRows_.data() + (y < split ? 0 : contentWidth) + left;
+            std::memcpy(pixels, source, static_cast<std::size_t>(boxWidth) * 4);
+        }
+        else
+        {
+            std::fill(pixels, pixels + boxWidth, kBoxColor);
+        }
+    }
+}
+
+void TestPatternCapture::drawNoise()
+{
+    const std::uint32_t contentWidth = config_.contentRight - config_.contentLeft;
+    for (std::uint32_t y = config_.contentTop; y < config_.contentBottom; ++y)
+    {
+        auto* pixels = reinterpret_cast<std::uint32_t*>(row(y)) + config_.contentLeft;
+        for (std::uint32_t x = 0; x < contentWidth; x += 2)
+        {
+            // xorshift64*, two pixels per step
+            noiseState_ ^= noiseState_ >> 12;
+            noiseState_ ^= noiseState_ << 25;
+            noiseState_ ^= noiseState_ >> 27;
+            const std::uint64_t bits = noiseState_ * 0x2545F4914F6CDD1Dull;
+            pixels[x] = static_cast<std::uint32_t>(bits) | 0xFF000000u;
+            if (x + 1 < contentWidth)
+            {
+                pixels[x + 1] = static_cast<std::uint32_t>(bits >> 32) | 0xFF000000u;
+            }
+        }
+    }
+}
+
+void TestPatternCapture::renderFrame(std::uint64_t index)
+{
+    switch (config_.motion)
+    {
+    case Motion::Static:
+        break;
+    case Motion::MovingBox:
+    {
+        const std::uint32_t contentWidth = config_.contentRight - config_.contentLeft;
+        const std::uint32_t contentHeight = config_.contentBottom - config_.contentTop;
+        const std::uint32_t left = bounce(index * kBoxStepX, contentWidth - std::min(kBoxSize, contentWidth));
+        const std::uint32_t top = bounce(index * kBoxStepY, contentHeight - std::min(kBoxSize, contentHeight));
+        if (boxDrawn_)
+        {
+            drawBox(boxLeft_, boxTop_, true);
+        }
+        drawBox(left, top, false);
+        boxLeft_ = left;
+        boxTop_ = top;
+        boxDrawn_ = true;
+        break;
+    }
+    case Motion::ScrollingBars:
+        drawBackground(static_cast<std::uint32_t>((index * kScrollStep) % (config_.contentRight - config_.contentLeft)));
+        break;
+    case Motion::Noise:
+        drawNoise();
+        break;
+    }
+}
+
+void TestPatternCapture::run()
+{
+    const double period100ns = 10'000'000.0 / config_.fps;
+    FramePacer pacer;
+
+    try
+    {
+        for (std::uint64_t index = 0; running_.load(std::memory_order_acquire); ++index)
+        {
+            if (config_.frameLimit != 0 && index >= config_.frameLimit)
+            {
+                break;
+            }
+
+            renderFrame(index);
+
+            Frame frame{};
+            frame.timestamp100ns = static_cast<std::uint64_t>(std::llround(static_cast<double>(index) * period100ns));
+            if (config_.paced && !pacer.waitFor(frame.timestamp100ns, static_cast<std::uint64_t>(period100ns)))
+            {
+                framesLate_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            frame.data = buffer_.data();
+            frame.dataSize = buffer_.size();
+            frame.sampleWidth = config_.width;
+            frame.sampleHeight = config_.height;
+            frame.contentLeft = config_.contentLeft;
+            frame.contentTop = config_.contentTop;
+            frame.contentRight = config_.contentRight;
+            frame.contentBottom = config_.contentBottom;
+            frame.width = config_.contentRight - config_.contentLeft;
+            frame.height = config_.contentBottom - config_.contentTop;
+            frame.stride = config_.stride;
+            frame.bottomUp = config_.bottomUp;
+            frame.arrivalNs = latencyClockNs();
+
+            handler_(frame);
+            framesDelivered_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_ = ex.what();
+        logMessage(std::string("[TestPattern] Runtime exception: ") + lastError_);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_ = "Unknown capture error";
+        logMessage("[TestPattern] Runtime exception: unknown");
+    }
+}
@@ -0,0 +1,393 @@
+#include "ToneMapping.hpp"
+#include "KernelRegistry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PCKVM_TONEMAP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PCKVM_TONEMAP_TARGET(features)
+#else
+#define PCKVM_TONEMAP_TARGET(features) __attribute__((target(features)))
+#endif
+#else
+#define PCKVM_TONEMAP_X86 0
+#endif
+
+namespace
+{
+    constexpr float kIndexScale = static_cast<float>(ToneMapper::kTableSize - 1);
+    // The output table is indexed by the top bits of the float itself, so
+    // its entries are spaced logarithmically (128 per octave) and 1.0 lands
+    // on the last one. That keeps the dark end fine without a sqrt or pow.
+    constexpr int kOetfShift = 16;
+    constexpr std::int32_t kOetfBase = (std::bit_cast<std::int32_t>(1.0f) >> kOetfShift) - static_cast<std::int32_t>(ToneMapper::kTableSize - 1);
+
+    // BT.2020 to BT.709 primaries in linear light (ITU-R BT.2087).
+    constexpr float kGamut[3][3] = {
+        {1.6605f, -0.5876f, -0.0728f},
+        {-0.1246f, 1.1329f, -0.0083f},
+        {-0.0182f, -0.1006f, 1.1187f},
+    };
+    constexpr float kLumaR = 0.2126f;
+    constexpr float kLumaG = 0.7152f;
+    constexpr float kLumaB = 0.0722f;
+
+    // The Q13 coefficients as floats that take 10-bit samples to [0, 1].
+    struct FloatCoefficients {
+        std::int32_t lumaOffset;
+        float lumaScale;
+        float crToR;
+        float cbToG;
+        float crToG;
+        float cbToB;
+    };
+
+    FloatCoefficients floatCoefficients(const YuvCoefficients& c)
+    {
+        constexpr float scale = 1.0f / (255.0f * static_cast<float>(1 << 15));
+        return {c.lumaOffset * 4, c.lumaScale * scale, c.crToR * scale, c.cbToG * scale, c.crToG * scale, c.cbToB * scale};
+    }
+
+    // SMPTE ST 2084 EOTF: code value in [0, 1] -> nits.
+    double pqToNits(double code)
+    {
+        constexpr double m1 = 2610.0 / 16384.0;
+        constexpr double m2 = 2523.0 / 4096.0 * 128.0;
+        constexpr double c1 = 3424.0 / 4096.0;
+        constexpr double c2 = 2413.0 / 4096.0 * 32.0;
+        constexpr double c3 = 2392.0 / 4096.0 * 32.0;
+        const double p = std::pow(code, 1.0 / m2);
+        return 10000.0 * std::pow(std::max(p - c1, 0.0) / (c2 - c3 * p), 1.0 / m1);
+    }
+
+    double hable(double x)
+    {
+        constexpr double a = 0.15;
+        constexpr double b = 0.50;
+        constexpr double c = 0.10;
+        constexpr double d = 0.20;
+        constexpr double e = 0.02;
+        constexpr double f = 0.30;
+        return (x * (a * x + c * b) + d * e) / (x * (a * x + b) + d * f) - e / f;
+    }
+
+    // Linear light relative to SDR white -> SDR linear light in [0, 1].
+    double applyCurve(const ToneMapParams& params, double light, double peak)
+    {
+        switch (params.curve)
+        {
+        case ToneMapCurve::Reinhard:
+            // Extended Reinhard: reaches 1 exactly at the peak.
+            return std::min(light * (1.0 + light / (peak * peak)) / (1.0 + light), 1.0);
+        case ToneMapCurve::Hable:
+            return std::min(hable(light) / hable(peak), 1.0);
+        case ToneMapCurve::Clip:
+            break;
+        }
+        return std::min(light, 1.0);
+    }
+
+    std::int32_t tableIndex(float value)
+    {
+        return static_cast<std::int32_t>(std::lrint(std::clamp(value * kIndexScale, 0.0f, kIndexScale)));
+    }
+
+    // `value` must already be clamped to [0, 1].
+    std::int32_t oetfIndex(float value)
+    {
+        return std::max((std::bit_cast<std::int32_t>(value) >> kOetfShift) - kOetfBase, 0);
+    }
+
+    // The scalar tier, and the tail of the SIMD one. The operation order is
+    // the contract the vector code reproduces.
+    void toneMapPixel(std::uint8_t* dst,
+                      std::int32_t y,
+                      std::int32_t cb,
+                      std::int32_t cr,
+                      const FloatCoefficients& k,
+                      const ToneMapper::Tables& t)
+    {
+        const float luma = static_cast<float>(y - k.lumaOffset) * k.lumaScale;
+        const float cbf = static_cast<float>(cb - 512);
+        const float crf = static_cast<float>(cr - 512);
+        const std::int32_t ri = tableIndex(luma + crf * k.crToR);
+        const std::int32_t gi = tableIndex(luma - cbf * k.cbToG - crf * k.crToG);
+        const std::int32_t bi = tableIndex(luma + cbf * k.cbToB);
+
+        const float gain = t.gain[static_cast<std::size_t>(std::max(std::max(ri, gi), bi))];
+        const float r2020 = t.eotf[static_cast<std::size_t>(ri)] * gain;
+        const float g2020 = t.eotf[static_cast<std::size_t>(gi)] * gain;
+        const float b2020 = t.eotf[static_cast<std::size_t>(bi)] * gain;
+
+        float r = kGamut[0][0] * r2020 + kGamut[0][1] * g2020 + kGamut[0][2] * b2020;
+        float g = kGamut[1][0] * r2020 + kGamut[1][1] * g2020 + kGamut[1][2] * b2020;
+        float b = kGamut[2][0] * r2020 + kGamut[2][1] * g2020 + kGamut[2][2] * b2020;
+
+        // Outside BT.709: move toward grey of the same luminance until the
+        // weakest channel reaches zero, then scale down anything above white.
+        const float grey = std::max(kLumaR * r + kLumaG * g + kLumaB * b, 0.0f);
+        const float lowest = std::min(std::min(r, g), b);
+        if (lowest < 0.0f)
+        {
+            const float toward = grey / (grey - lowest);
+            r = grey + (r - grey) * toward;
+            g = grey + (g - grey) * toward;
+            b = grey + (b - grey) * toward;
+        }
+        const float highest = std::max(std::max(r, g), b);
+        if (highest > 1.0f)
+        {
+            const float scale = 1.0f / highest;
+            r *= scale;
+            g *= scale;
+            b *= scale;
+        }
+
+        dst[0] = static_cast<std::uint8_t>(t.oetf[static_cast<std::size_t>(oetfIndex(std::clamp(b, 0.0f, 1.0f)))]);
+        dst[1] = static_cast<std::uint8_t>(t.oetf[static_cast<std::size_t>(oetfIndex(std::clamp(g, 0.0f, 1.0f)))]);
+        dst[2] = static_cast<std::uint8_t>(t.oetf[static_cast<std::size_t>(oetfIndex(std::clamp(r, 0.0f, 1.0f)))]);
+        dst[3] = 0xFF;
+    }
+
+    std::int32_t loadSample(const std::uint8_t* plane, std::size_t index)
+    {
+        const std::uint8_t* p = plane + index * 2;
+        return (static_cast<std::int32_t>(p[0]) | (static_cast<std::int32_t>(p[1]) << 8)) >> 6;
+    }
+
+    void toneMapRowScalar(std::uint8_t* dst,
+                          const std::uint8_t* lumaPlane,
+                          const std::uint8_t* chromaPlane,
+                          std::size_t pixels,
+                          const FloatCoefficients& k,
+                          const ToneMapper::Tables& t)
+    {
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            const std::size_t pair = i & ~std::size_t{1};
+            toneMapPixel(dst + i * 4, loadSample(lumaPlane, i), loadSample(chromaPlane, pair), loadSample(chromaPlane, pair + 1), k, t);
+        }
+    }
+
+#if PCKVM_TONEMAP_X86
+    PCKVM_TONEMAP_TARGET("avx2")
+    __m256i tableIndexAvx2(__m256 value)
+    {
+        const __m256 scaled = _mm256_mul_ps(value, _mm256_set1_ps(kIndexScale));
+        return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(scaled, _mm256_setzero_ps()), _mm256_set1_ps(kIndexScale)));
+    }
+
+    PCKVM_TONEMAP_TARGET("avx2")
+    __m256 gamutRowAvx2(const float* row, __m256 r, __m256 g, __m256 b)
+    {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(row[0]), r), _mm256_mul_ps(_mm256_set1_ps(row[1]), g)),
+                             _mm256_mul_ps(_mm256_set1_ps(row[2]), b));
+    }
+
+    PCKVM_TONEMAP_TARGET("avx2")
+    __m256i outputCodeAvx2(__m256 value, const ToneMapper::Tables& t)
+    {
+        const __m256 clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        const __m256i index = _mm256_sub_epi32(_mm256_srai_epi32(_mm256_castps_si256(clamped), kOetfShift), _mm256_set1_epi32(kOetfBase));
+        return _mm256_i32gather_epi32(t.oetf.data(), _mm256_max_epi32(index, _mm256_setzero_si256()), 4);
+    }
+
+    // Eight pixels per step: four Cb Cr pairs are widened and each sample is
+    // duplicated across its two pixels, then every stage of toneMapPixel()
+    // runs on whole registers with the tables read through gathers.
+    PCKVM_TONEMAP_TARGET("avx2")
+    void toneMapRowAvx2(std::uint8_t* dst,
+                        const std::uint8_t* lumaPlane,
+                        const std::uint8_t* chromaPlane,
+                        std::size_t pixels,
+                        const FloatCoefficients& k,
+                        const ToneMapper::Tables& t)
+    {
+        const __m256i lumaOffset = _mm256_set1_epi32(k.lumaOffset);
+        const __m256i chromaBias = _mm256_set1_epi32(512);
+        const __m256i cbLanes = _mm256_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6);
+        const __m256i crLanes = _mm256_setr_epi32(1, 1, 3, 3, 5, 5, 7, 7);
+        const __m256 lumaScale = _mm256_set1_ps(k.lumaScale);
+        const __m256 crToR = _mm256_set1_ps(k.crToR);
+        const __m256 cbToG = _mm256_set1_ps(k.cbToG);
+        const __m256 crToG = _mm256_set1_ps(k.crToG);
+        const __m256 cbToB = _mm256_set1_ps(k.cbToB);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+        std::size_t i = 0;
+        for (; i + 8 <= pixels; i += 8)
+        {
+            const __m256i y = _mm256_srli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lumaPlane + i * 2))), 6);
+            const __m256i pairs = _mm256_srli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(chromaPlane + i * 2))), 6);
+            const __m256 cb = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_permutevar8x32_epi32(pairs, cbLanes), chromaBias));
+            const __m256 cr = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_permutevar8x32_epi32(pairs, crLanes), chromaBias));
+            const __m256 luma = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(y, lumaOffset)), lumaScale);
+
+            const __m256i ri = tableIndexAvx2(_mm256_add_ps(luma, _mm256_mul_ps(cr, crToR)));
+            const __m256i gi = tableIndexAvx2(_mm256_sub_ps(_mm256_sub_ps(luma, _mm256_mul_ps(cb, cbToG)), _mm256_mul_ps(cr, crToG)));
+            const __m256i bi = tableIndexAvx2(_mm256_add_ps(luma, _mm256_mul_ps(cb, cbToB)));
+
+            const __m256 gain = _mm256_i32gather_ps(t.gain.data(), _mm256_max_epi32(_mm256_max_epi32(ri, gi), bi), 4);
+            const __m256 r2020 = _mm256_mul_ps(_mm256_i32gather_ps(t.eotf.data(), ri, 4), gain);
+            const __m256 g2020 = _mm256_mul_ps(_mm256_i32gather_ps(t.eotf.data(), gi, 4), gain);
+            const __m256 b2020 = _mm256_mul_ps(_mm256_i32gather_ps(t.eotf.data(), bi, 4), gain);
+
+            __m256 r = gamutRowAvx2(kGamut[0], r2020, g2020, b2020);
+            __m256 g = gamutRowAvx2(kGamut[1], r2020, g2020, b2020);
+            __m256 b = gamutRowAvx2(kGamut[2], r2020, g2020, b2020);
+
+            const __m256 grey = _mm256_max_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kLumaR), r), _mm256_mul_ps(_mm256_set1_ps(kLumaG), g)),
+                                                            _mm256_mul_ps(_mm256_set1_ps(kLumaB), b)),
+                                              zero);
+            const __m256 lowest = _mm256_min_ps(_mm256_min_ps(r, g), b);
+            const __m256 outside = _mm256_cmp_ps(lowest, zero, _CMP_LT_OQ);
+            if (_mm256_movemask_ps(outside) != 0)
+            {
+                const __m256 toward = _mm256_div_ps(grey, _mm256_sub_ps(grey, lowest));
+                r = _mm256_blendv_ps(r, _mm256_add_ps(grey, _mm256_mul_ps(_mm256_sub_ps(r, grey), toward)), outside);
+                g = _mm256_blendv_ps(g, _mm256_add_ps(grey, _mm256_mul_ps(_mm256_sub_ps(g, grey), toward)), outside);
+                b = _mm256_blendv_ps(b, _mm256_add_ps(grey, _mm256_mul_ps(_mm256_sub_ps(b, grey), toward)), outside);
+            }
+            const __m256 highest = _mm256_max_ps(_mm256_max_ps(r, g), b);
+            const __m256 above = _mm256_cmp_ps(highest, one, _CMP_GT_OQ);
+            if (_mm256_movemask_ps(above) != 0)
+            {
+                const __m256 scale = _mm256_blendv_ps(one, _mm256_div_ps(one, highest), above);
+                r = _mm256_mul_ps(r, scale);
+                g = _mm256_mul_ps(g, scale);
+                b = _mm256_mul_ps(b, scale);
+            }
+
+            __m256i bgra = _mm256_or_si256(outputCodeAvx2(b, t), alpha);
+            bgra = _mm256_or_si256(bgra, _mm256_slli_epi32(outputCodeAvx2(g, t), 8));
+            bgra = _mm256_or_si256(bgra, _mm256_slli_epi32(outputCodeAvx2(r, t), 16));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), bgra);
+        }
+        toneMapRowScalar(dst + i * 4, lumaPlane + i * 2, chromaPlane + i * 2, pixels - i, k, t);
+    }
+#endif
+
+    std::atomic<ConversionTier>& toneMapTier()
+    {
+        static std::atomic<ConversionTier> tier{cpuFeatures().avx2 ? ConversionTier::AVX2 : ConversionTier::Scalar};
+        return tier;
+    }
+
+    bool toneMapTierAvailable(ConversionTier tier)
+    {
+#if PCKVM_TONEMAP_X86
+        return tier == ConversionTier::Scalar || (tier == ConversionTier::AVX2 && cpuFeatures().avx2);
+#else
+        return tier == ConversionTier::Scalar;
+#endif
+    }
+}
+
+ToneMapper::ToneMapper(const ToneMapParams& params)
+    : params_(params)
+{
+    params_.whiteNits = std::clamp(params_.whiteNits, 1.0f, 10000.0f);
+    params_.peakNits = std::clamp(params_.peakNits, params_.whiteNits, 10000.0f);
+    const double peak = static_cast<double>(params_.peakNits) / params_.whiteNits;
+
+    for (std::size_t i = 0; i < kTableSize; ++i)
+    {
+        const double code = static_cast<double>(i) / (kTableSize - 1);
+        const double light = pqToNits(code) / params_.whiteNits;
+        tables_.eotf[i] = static_cast<float>(light);
+        tables_.gain[i] = light > 0.0 ? static_cast<float>(applyCurve(params_, light, peak) / light) : 1.0f;
+        // Entry i holds the floats whose top bits are kOetfBase + i; use the
+        // middle of that range. The last entry is exactly 1.0.
+        const std::int32_t bits = (kOetfBase + static_cast<std::int32_t>(i)) << kOetfShift;
+        const double low = std::bit_cast<float>(bits);
+        const double high = std::bit_cast<float>(bits + (1 << kOetfShift));
+        const double linear = i == kTableSize - 1 ? 1.0 : (low + high) * 0.5;
+        tables_.oetf[i] = static_cast<std::int32_t>(std::lround(255.0 * std::pow(linear, 1.0 / 2.2)));
+    }
+}
+
+void ToneMapper::convertRow(std::uint8_t* dst,
+                            const std::uint8_t* luma,
+                            const std::uint8_t* chroma,
+                            std::size_t pixels,
+                            const YuvCoefficients& coefficients) const
+{
+    convertRowWith(activeToneMapTier(), dst, luma, chroma, pixels, coefficients);
+}
+
+bool ToneMapper::convertRowWith(ConversionTier tier,
+                                std::uint8_t* dst,
+                                const std::uint8_t* luma,
+                                const std::uint8_t* chroma,
+                                std::size_t pixels,
+                                const YuvCoefficients& coefficients) const
+{
+    const FloatCoefficients k = floatCoefficients(coefficients);
+    switch (tier)
+    {
+    case ConversionTier::Scalar:
+        toneMapRowScalar(dst, luma, chroma, pixels, k, tables_);
+        return true;
+#if PCKVM_TONEMAP_X86
+    case ConversionTier::AVX2:
+        if (toneMapTierAvailable(tier))
+        {
+            toneMapRowAvx2(dst, luma, chroma, pixels, k, tables_);
+            return true;
+        }
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* toneMapCurveName(ToneMapCurve curve)
+{
+    switch (curve)
+    {
+    case ToneMapCurve::Reinhard:
+        return "Reinhard";
+    case ToneMapCurve::Hable:
+        return "Hable";
+    case ToneMapCurve::Clip:
+        return "Clip";
+    }
+    return "unknown";
+}
+
+const char* hdrInputModeName(HdrInputMode mode)
+{
+    switch (mode)
+    {
+    case HdrInputMode::Auto:
+        return "auto";
+    case HdrInputMode::On:
+        return "on";
+    case HdrInputMode::Off:
+        return "off";
+    }
+    return "unknown";
+}
+
+ConversionTier activeToneMapTier()
+{
+    return toneMapTier().load(std::memory_order_relaxed);
+}
+
+bool setActiveToneMapTier(ConversionTier tier)
+{
+    if (!toneMapTierAvailable(tier))
+    {
+        return false;
+    }
+    toneMapTier().store(tier, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,112 @@
+#include "VideoViewport.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Centres a width x height rectangle, clamped to the client area.
+    ViewportRect centred(int width, int height, std::int32_t clientWidth, std::int32_t clientHeight)
+    {
+        width = std::max(1, std::min(width, static_cast<int>(clientWidth)));
+        height = std::max(1, std::min(height, static_cast<int>(clientHeight)));
+        const int offsetX = (static_cast<int>(clientWidth) - width) / 2;
+        const int offsetY = (static_cast<int>(clientHeight) - height) / 2;
+        return {offsetX, offsetY, offsetX + width, offsetY + height};
+    }
+}
+
+bool computeVideoViewport(VideoAspectMode mode,
+                          std::uint32_t sourceWidth,
+                          std::uint32_t sourceHeight,
+                          std::int32_t clientWidth,
+                          std::int32_t clientHeight,
+                          ViewportRect& viewport)
+{
+    viewport = {};
+    if (clientWidth <= 0 || clientHeight <= 0 || sourceWidth == 0 || sourceHeight == 0)
+    {
+        return false;
+    }
+
+    switch (mode)
+    {
+    case VideoAspectMode::Stretch:
+        viewport = {0, 0, clientWidth, clientHeight};
+        return true;
+
+    case VideoAspectMode::Maintain:
+    {
+        const double srcAspect = static_cast<double>(sourceWidth) / static_cast<double>(sourceHeight);
+        const double clientAspect = static_cast<double>(clientWidth) / static_cast<double>(clientHeight);
+        constexpr double epsilon = 1e-4;
+
+        int viewportWidth = static_cast<int>(clientWidth);
+        int viewportHeight = static_cast<int>(clientHeight);
+        if (std::abs(clientAspect - srcAspect) > epsilon)
+        {
+            if (clientAspect > srcAspect)
+            {
+                viewportWidth = static_cast<int>(std::round(static_cast<double>(viewportHeight) * srcAspect));
+            }
+            else
+            {
+                viewportHeight = static_cast<int>(std::round(static_cast<double>(viewportWidth) / srcAspect));
+            }
+        }
+        viewport = centred(viewportWidth, viewportHeight, clientWidth, clientHeight);
+        return true;
+    }
+
+    case VideoAspectMode::Capture:
+    {
+        double scale = std::min<double>(static_cast<double>(clientWidth) / static_cast<double>(sourceWidth),
+                                        static_cast<double>(clientHeight) / static_cast<double>(sourceHeight));
+        if (scale <= 0.0)
+        {
+            scale = 1.0;
+        }
+        if (scale > 1.0)
+        {
+            scale = 1.0; // never upscale beyond native resolution
+        }
+
+        const int viewportWidth = static_cast<int>(std::round(static_cast<double>(sourceWidth) * scale));
+        const int viewportHeight = static_cast<int>(std::round(static_cast<double>(sourceHeight) * scale));
+        viewport = centred(viewportWidth, viewportHeight, clientWidth, clientHeight);
+        return true;
+    }
+    }
+
+    return false;
+}
+
+void snapViewportToIntegerScale(VideoAspectMode mode,
+                                std::uint32_t sourceWidth,
+                                std::uint32_t sourceHeight,
+                                ViewportRect& viewport)
+{
+    if (sourceWidth == 0 || sourceHeight == 0 || viewport.width() <= 0 || viewport.height() <= 0)
+    {
+        return;
+    }
+
+    std::uint32_t scaleX = static_cast<std::uint32_t>(viewport.width()) / sourceWidth;
+    std::uint32_t scaleY = static_cast<std::uint32_t>(viewport.height()) / sourceHeight;
+    if (mode != VideoAspectMode::Stretch)
+    {
+        scaleX = scaleY = std::min(scaleX, scaleY);
+    }
+
+    const auto snap = [](std::int32_t& low, std::int32_t& high, std::uint32_t scale, std::uint32_t source) {
+        if (scale == 0)
+        {
+            return;
+        }
+        const auto extent = static_cast<std::int32_t>(scale * source);
+        low += (high - low - extent) / 2;
+        high = low + extent;
+    };
+    snap(viewport.left, viewport.right, scaleX, sourceWidth);
+    snap(viewport.top, viewport.bottom, scaleY, sourceHeight);
+}
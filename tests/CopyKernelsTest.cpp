@@ -0,0 +1,90 @@
+#include "CopyKernels.hpp"
+#include "TestSupport.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr CopyKernelTier kTiers[] = {CopyKernelTier::Memcpy, CopyKernelTier::SSE2, CopyKernelTier::AVX2, CopyKernelTier::AVX512};
+
+// Every tier the CPU runs copies exactly the requested bytes for any source
+// and destination alignment, without touching the bytes around them.
+void testTiersMatchMemcpy()
+{
+    std::vector<std::uint8_t> source(1 << 16);
+    std::uint32_t state = 12345;
+    for (auto& byte : source)
+    {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(state >> 24);
+    }
+
+    CHECK(copyKernelFor(CopyKernelTier::Memcpy) != nullptr);
+    for (const CopyKernelTier tier : kTiers)
+    {
+        const RowCopyFn kernel = copyKernelFor(tier);
+        if (!kernel)
+        {
+            std::printf("%s: not supported here\n", copyKernelTierName(tier));
+            continue;
+        }
+        bool matches = true;
+        std::vector<std::uint8_t> expected(source.size() + 128);
+        std::vector<std::uint8_t> actual(source.size() + 128);
+        for (int i = 0; i < 2000; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            const std::size_t sourceOffset = state % 64;
+            const std::size_t destinationOffset = (state >> 8) % 64;
+            // Mostly short copies, where the head and tail handling lives.
+            const std::size_t bytes = i % 4 == 0 ? (state >> 12) % 40000 : (state >> 12) % 300;
+            std::memset(expected.data(), 0x5A, expected.size());
+            std::memset(actual.data(), 0x5A, actual.size());
+            std::memcpy(expected.data() + destinationOffset, source.data() + sourceOffset, bytes);
+            kernel(actual.data() + destinationOffset, source.data() + sourceOffset, bytes);
+            streamCopyFence();
+            matches &= std::memcmp(expected.data(), actual.data(), actual.size()) == 0;
+        }
+        if (!CHECK(matches))
+        {
+            std::fprintf(stderr, "  tier %s\n", copyKernelTierName(tier));
+        }
+    }
+}
+
+void testTierSelection()
+{
+    const CopyKernelTier original = activeCopyKernelTier();
+    CHECK(copyKernelFor(original) != nullptr);
+    for (const CopyKernelTier tier : kTiers)
+    {
+        const bool runnable = copyKernelFor(tier) != nullptr;
+        CHECK(setActiveCopyKernelTier(tier) == runnable);
+        if (runnable)
+        {
+            CHECK(activeCopyKernelTier() == tier);
+            std::uint8_t source[100];
+            std::uint8_t destination[100] = {};
+            for (int i = 0; i < 100; ++i)
+            {
+                source[i] = static_cast<std::uint8_t>(i);
+            }
+            streamCopy(destination, source, sizeof(source));
+            streamCopyFence();
+            CHECK(std::memcmp(source, destination, sizeof(source)) == 0);
+        }
+    }
+    CHECK(setActiveCopyKernelTier(original));
+}
+
+} // namespace
+
+int main()
+{
+    testTiersMatchMemcpy();
+    testTierSelection();
+    return testExitCode();
+}
@@ -0,0 +1,231 @@
+#include "DirtyTracker.hpp"
+#include "MemoryFrameSink.hpp"
+#include "TestSupport.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using PixelFormat = DirectShowCapture::PixelFormat;
+
+std::uint32_t pixelValue(std::uint32_t x, std::uint32_t y)
+{
+    return (x * 2654435761u) ^ (y * 40503u) ^ 0xA5000000u;
+}
+
+struct Sample {
+    std::vector<std::uint8_t> bytes;
+    DirectShowCapture::Frame frame{};
+};
+
+// A sample of noise in `format`, with padded rows, described as a frame that
+// shows all of it.
+Sample makeSample(PixelFormat format, std::uint32_t width, std::uint32_t height, bool bottomUp)
+{
+    Sample sample;
+    const std::uint32_t stride = static_cast<std::uint32_t>(pixelFormatRowBytes(format, width)) + 32;
+    const std::size_t rows = isSemiPlanar(format) ? height + height / 2 : height;
+    sample.bytes.resize(static_cast<std::size_t>(stride) * rows);
+    std::uint32_t state = 0x9E3779B9u ^ static_cast<std::uint32_t>(format);
+    for (auto& byte : sample.bytes)
+    {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(state >> 24);
+    }
+
+    DirectShowCapture::Frame& frame = sample.frame;
+    frame.format = format;
+    frame.data = sample.bytes.data();
+    frame.dataSize = sample.bytes.size();
+    frame.stride = stride;
+    frame.bottomUp = bottomUp;
+    frame.sampleWidth = width;
+    frame.sampleHeight = height;
+    frame.contentRight = width;
+    frame.contentBottom = height;
+    frame.width = width;
+    frame.height = height;
+    frame.matrix = DirectShowCapture::ColorMatrix::BT709;
+    return sample;
+}
+
+std::vector<std::uint8_t> writeTopDown(const DirectShowCapture::Frame& frame)
+{
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    if (!writeFrameToSink(frame, sink).accepted)
+    {
+        return {};
+    }
+    const CpuFrame* written = sink.acquireLatest();
+    return std::vector<std::uint8_t>(written->data.data(), written->data.data() + written->data.size());
+}
+
+// Copying only the content rectangle gives exactly that part of the whole
+// sample's image, in every format and either row order.
+void testCropMatchesWholeImage()
+{
+    const PixelFormat formats[] = {PixelFormat::BGRA8, PixelFormat::RGB24, PixelFormat::RGB565, PixelFormat::YUY2,
+                                   PixelFormat::UYVY,  PixelFormat::NV12,  PixelFormat::P010,   PixelFormat::V210};
+    constexpr std::uint32_t kWidth = 96;
+    constexpr std::uint32_t kHeight = 54;
+    for (const PixelFormat format : formats)
+    {
+        for (const bool bottomUp : {false, true})
+        {
+            if (bottomUp && !isRgb(format))
+            {
+                continue;
+            }
+            Sample sample = makeSample(format, kWidth, kHeight, bottomUp);
+            const std::vector<std::uint8_t> whole = writeTopDown(sample.frame);
+
+            // Offsets on a pixel group; odd edges on the right and bottom.
+            const std::uint32_t group = pixelFormatGroupPixels(format);
+            DirectShowCapture::Frame cropped = sample.frame;
+            cropped.contentLeft = 2 * group * (group == 1 ? 3 : 1);
+            cropped.contentTop = 5;
+            cropped.contentRight = kWidth - 7;
+            cropped.contentBottom = kHeight - 3;
+            cropped.width = cropped.contentRight - cropped.contentLeft;
+            cropped.height = cropped.contentBottom - cropped.contentTop;
+            const std::vector<std::uint8_t> part = writeTopDown(cropped);
+
+            bool matches = whole.size() == static_cast<std::size_t>(kWidth) * 4 * kHeight &&
+                           part.size() == static_cast<std::size_t>(cropped.width) * 4 * cropped.height;
+            for (std::uint32_t y = 0; matches && y < cropped.height; ++y)
+            {
+                const std::uint8_t* expected = whole.data() + (static_cast<std::size_t>(y + cropped.contentTop) * kWidth + cropped.contentLeft) * 4;
+                matches = std::memcmp(part.data() + static_cast<std::size_t>(y) * cropped.width * 4, expected, cropped.width * 4) == 0;
+            }
+            if (!CHECK(matches))
+            {
+                std::fprintf(stderr, "  format %d, bottomUp %d\n", static_cast<int>(format), bottomUp ? 1 : 0);
+            }
+        }
+    }
+}
+
+// Rows the sample is too short to hold come out black instead of being read
+// past its end.
+void testShortSampleIsZeroFilled()
+{
+    Sample sample = makeSample(PixelFormat::BGRA8, 64, 32, false);
+    const std::vector<std::uint8_t> whole = writeTopDown(sample.frame);
+
+    DirectShowCapture::Frame truncated = sample.frame;
+    truncated.dataSize = static_cast<std::size_t>(truncated.stride) * 20 + 10 * 4;
+    const std::vector<std::uint8_t> part = writeTopDown(truncated);
+    CHECK(part.size() == whole.size());
+    if (part.size() == whole.size())
+    {
+        const std::size_t rowBytes = 64 * 4;
+        CHECK(std::memcmp(part.data(), whole.data(), rowBytes * 20 + 10 * 4) == 0);
+        bool zero = true;
+        for (std::size_t i = rowBytes * 20 + 10 * 4; i < part.size(); ++i)
+        {
+            zero &= part[i] == 0;
+        }
+        CHECK(zero);
+    }
+}
+
+// Letterboxed BGRA through the tracker: only pixels inside the rectangle
+// matter, so changes in the borders neither dirty tiles nor reach the sink.
+void testTrackedCropIgnoresBorders()
+{
+    for (const bool bottomUp : {false, true})
+    {
+        constexpr std::uint32_t kSampleWidth = 200;
+        constexpr std::uint32_t kSampleHeight = 150;
+        constexpr std::uint32_t kLeft = 13;
+        constexpr std::uint32_t kTop = 21;
+        constexpr std::uint32_t kRight = 187;
+        constexpr std::uint32_t kBottom = 139;
+        constexpr std::uint32_t kStride = kSampleWidth * 4 + 32;
+        std::vector<std::uint8_t> bytes(static_cast<std::size_t>(kStride) * kSampleHeight);
+        const auto put = [&](std::uint32_t x, std::uint32_t y, std::uint32_t value) {
+            const std::uint32_t row = bottomUp ? kSampleHeight - 1 - y : y;
+            std::memcpy(&bytes[static_cast<std::size_t>(row) * kStride + x * 4], &value, 4);
+        };
+        for (std::uint32_t y = 0; y < kSampleHeight; ++y)
+        {
+            for (std::uint32_t x = 0; x < kSampleWidth; ++x)
+            {
+                put(x, y, pixelValue(x, y));
+            }
+        }
+
+        DirectShowCapture::Frame frame{};
+        frame.data = bytes.data();
+        frame.dataSize = bytes.size();
+        frame.sampleWidth = kSampleWidth;
+        frame.sampleHeight = kSampleHeight;
+        frame.contentLeft = kLeft;
+        frame.contentTop = kTop;
+        frame.contentRight = kRight;
+        frame.contentBottom = kBottom;
+        frame.width = kRight - kLeft;
+        frame.height = kBottom - kTop;
+        frame.stride = kStride;
+        frame.bottomUp = bottomUp;
+
+        FramePool pool;
+        MemoryFrameSink sink(pool);
+        DirtyTracker tracker;
+        bool matches = true;
+        for (int step = 0; step < 5; ++step)
+        {
+            if (step == 3)
+            {
+                put(kLeft + 100, kTop + 50, 0x12345678u);
+            }
+            if (step == 4)
+            {
+                put(3, 2, 0x0BADF00Du);
+                put(kRight, kBottom - 1, 0x0BADF00Du);
+            }
+            FrameWriteOptions options;
+            options.tracker = &tracker;
+            options.sequence = tracker.analyze(frame);
+            CHECK(writeFrameToSink(frame, sink, options).accepted);
+            if (step == 1 || step == 2 || step == 4)
+            {
+                CHECK(tracker.lastDirtyTiles() == 0);
+            }
+            if (step == 3)
+            {
+                CHECK(tracker.lastDirtyTiles() == 1);
+            }
+
+            const CpuFrame* written = sink.acquireLatest();
+            for (std::uint32_t y = 0; written && y < frame.height; ++y)
+            {
+                for (std::uint32_t x = 0; x < frame.width; ++x)
+                {
+                    std::uint32_t value = 0;
+                    std::memcpy(&value, written->data.data() + static_cast<std::size_t>(y) * written->stride + x * 4, 4);
+                    std::uint32_t expected = pixelValue(x + kLeft, y + kTop);
+                    if (step >= 3 && x == 100 && y == 50)
+                    {
+                        expected = 0x12345678u;
+                    }
+                    matches &= value == expected;
+                }
+            }
+        }
+        CHECK(matches);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testCropMatchesWholeImage();
+    testShortSampleIsZeroFilled();
+    testTrackedCropIgnoresBorders();
+    return testExitCode();
+}
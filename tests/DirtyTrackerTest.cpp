@@ -0,0 +1,285 @@
+#include "DirtyTracker.hpp"
+#include "MemoryFrameSink.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BgraImage {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::uint8_t> pixels;
+
+    BgraImage(std::uint32_t w, std::uint32_t h) : width(w), height(h), pixels(static_cast<std::size_t>(w) * 4 * h)
+    {
+        for (std::size_t i = 0; i < pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::uint8_t>(i * 31 + i / 4096);
+        }
+    }
+
+    [[nodiscard]] DirectShowCapture::Frame frame() const
+    {
+        DirectShowCapture::Frame frame{};
+        frame.width = width;
+        frame.height = height;
+        frame.stride = width * 4;
+        frame.data = pixels.data();
+        frame.dataSize = pixels.size();
+        return frame;
+    }
+
+    std::uint8_t& at(std::uint32_t x, std::uint32_t y, std::uint32_t channel)
+    {
+        return pixels[(static_cast<std::size_t>(y) * width + x) * 4 + channel];
+    }
+};
+
+void testUnchangedAndSingleByteChanges()
+{
+    BgraImage image(1920, 1080);
+    DirtyTracker tracker;
+
+    const std::uint64_t first = tracker.analyze(image.frame());
+    CHECK(first != 0);
+    CHECK(tracker.lastDirtyTiles() == 30 * 17);
+
+    const std::uint64_t second = tracker.analyze(image.frame());
+    CHECK(second == first + 1);
+    CHECK(tracker.lastDirtyTiles() == 0);
+
+    // One byte anywhere marks exactly its own tile, including the clipped
+    // tiles along the right and bottom edges.
+    const std::uint32_t points[][2] = {{0, 0}, {63, 63}, {64, 0}, {1000, 500}, {1919, 0}, {0, 1079}, {1919, 1079}};
+    for (const auto& point : points)
+    {
+        for (std::uint32_t channel = 0; channel < 4; ++channel)
+        {
+            image.at(point[0], point[1], channel) ^= 0x01;
+            const std::uint64_t sequence = tracker.analyze(image.frame());
+            CHECK(tracker.lastDirtyTiles() == 1);
+
+            const std::vector<DirtyRect>* rects = tracker.rectsSince(sequence - 1, sequence);
+            CHECK(rects != nullptr && rects->size() == 1);
+            if (rects && rects->size() == 1)
+            {
+                const DirtyRect& rect = rects->front();
+                CHECK(rect.left == point[0] / 64 * 64 && rect.top == point[1] / 64 * 64);
+                CHECK(rect.right == std::min(rect.left + 64, image.width));
+                CHECK(rect.bottom == std::min(rect.top + 64, image.height));
+            }
+        }
+    }
+
+    // Content moving inside a tile changes its hash too.
+    std::swap(image.at(10, 10, 0), image.at(11, 10, 0));
+    if (image.at(10, 10, 0) != image.at(11, 10, 0))
+    {
+        tracker.analyze(image.frame());
+        CHECK(tracker.lastDirtyTiles() == 1);
+    }
+
+    tracker.invalidate();
+    tracker.analyze(image.frame());
+    CHECK(tracker.lastDirtyTiles() == 30 * 17);
+}
+
+// RGB24 and RGB565 rows end partway into a 32-bit word; the bytes of the
+// last column still count. Rows are DIB rows padded to whole DWORDs.
+void testPackedRgbLastColumn()
+{
+    using PixelFormat = DirectShowCapture::PixelFormat;
+    for (const PixelFormat format : {PixelFormat::RGB24, PixelFormat::RGB565})
+    {
+        const std::uint32_t pixelBytes = format == PixelFormat::RGB24 ? 3 : 2;
+        for (const std::uint32_t width : {1u, 3u, 65u, 1921u})
+        {
+            constexpr std::uint32_t kHeight = 3;
+            const std::uint32_t stride = (width * pixelBytes + 3) / 4 * 4;
+            std::vector<std::uint8_t> pixels(static_cast<std::size_t>(stride) * kHeight);
+            for (std::size_t i = 0; i < pixels.size(); ++i)
+            {
+                pixels[i] = static_cast<std::uint8_t>(i * 7 + 1);
+            }
+            DirectShowCapture::Frame frame{};
+            frame.format = format;
+            frame.width = width;
+            frame.height = kHeight;
+            frame.stride = stride;
+            frame.data = pixels.data();
+            frame.dataSize = pixels.size();
+
+            DirtyTracker tracker;
+            tracker.analyze(frame);
+            tracker.analyze(frame);
+            CHECK(tracker.lastDirtyTiles() == 0);
+            for (std::uint32_t byte = 0; byte < pixelBytes; ++byte)
+            {
+                pixels[static_cast<std::size_t>(stride) * (kHeight - 1) + (width - 1) * pixelBytes + byte] ^= 0x01;
+                tracker.analyze(frame);
+                if (!CHECK(tracker.lastDirtyTiles() == 1))
+                {
+                    std::fprintf(stderr, "  %s width %u, byte %u of the last pixel\n", format == PixelFormat::RGB24 ? "RGB24" : "RGB565",
+                                 width, byte);
+                }
+            }
+        }
+    }
+}
+
+void testRectMerging()
+{
+    DirtyTracker::TileMask mask;
+    mask.tilesX = 10;
+    mask.tilesY = 8;
+    const auto set = [&](std::uint32_t x, std::uint32_t y) {
+        const std::size_t index = static_cast<std::size_t>(y) * mask.tilesX + x;
+        mask.bits[index / 64] |= 1ull << (index % 64);
+    };
+    // A 3x2 block, a separate run and the clipped corner tile.
+    for (std::uint32_t y = 1; y < 3; ++y)
+    {
+        for (std::uint32_t x = 2; x < 5; ++x)
+        {
+            set(x, y);
+        }
+    }
+    set(7, 2);
+    set(8, 2);
+    set(9, 7);
+
+    std::vector<DirtyRect> rects;
+    DirtyTracker::buildRects(mask, 600, 470, rects);
+    CHECK(rects.size() == 3);
+    if (rects.size() == 3)
+    {
+        CHECK(rects[0].left == 128 && rects[0].top == 64 && rects[0].right == 320 && rects[0].bottom == 192);
+        CHECK(rects[1].left == 448 && rects[1].top == 128 && rects[1].right == 576 && rects[1].bottom == 192);
+        CHECK(rects[2].left == 576 && rects[2].top == 448 && rects[2].right == 600 && rects[2].bottom == 470);
+    }
+
+    // A checkerboard is too fragmented and becomes one bounding box.
+    DirtyTracker::TileMask checker;
+    checker.tilesX = 30;
+    checker.tilesY = 17;
+    for (std::uint32_t y = 0; y < checker.tilesY; ++y)
+    {
+        for (std::uint32_t x = (y % 2); x < checker.tilesX; x += 2)
+        {
+            const std::size_t index = static_cast<std::size_t>(y) * checker.tilesX + x;
+            checker.bits[index / 64] |= 1ull << (index % 64);
+        }
+    }
+    DirtyTracker::buildRects(checker, 1920, 1080, rects);
+    CHECK(rects.size() == 1);
+    if (rects.size() == 1)
+    {
+        CHECK(rects[0].left == 0 && rects[0].top == 0 && rects[0].right == 1920 && rects[0].bottom == 1080);
+    }
+}
+
+void testHistoryLimits()
+{
+    BgraImage image(256, 128);
+    DirtyTracker tracker;
+    const std::uint64_t first = tracker.analyze(image.frame());
+    std::uint64_t last = first;
+    for (std::size_t i = 0; i < DirtyTracker::kHistory; ++i)
+    {
+        image.at(0, 0, 0) ^= 0xFF;
+        last = tracker.analyze(image.frame());
+    }
+    DirtyTracker::TileMask mask;
+    CHECK(tracker.collectSince(last - DirtyTracker::kHistory, last, mask));
+    CHECK(!tracker.collectSince(first - 1, last, mask));
+    CHECK(!tracker.collectSince(0, last, mask));
+    CHECK(tracker.rectsSince(last, last) != nullptr && tracker.rectsSince(last, last)->empty());
+
+    // A new size starts a new grid that older frames cannot be compared with.
+    BgraImage resized(320, 128);
+    const std::uint64_t afterResize = tracker.analyze(resized.frame());
+    CHECK(!tracker.collectSince(last, afterResize, mask));
+    CHECK(tracker.lastDirtyTiles() == 5 * 2);
+}
+
+// Tracked writes through the memory sink's three rotating slots must leave
+// every slot identical to the frame it claims to hold, while copying only the
+// changed tiles.
+void testPartialUploadsMatchFullFrames()
+{
+    constexpr std::uint64_t kFrames = 240;
+
+    TestPatternCapture::Config config;
+    config.width = 1280;
+    config.height = 720;
+    config.bottomUp = true;
+    config.contentLeft = 8;
+    config.contentTop = 4;
+    config.contentRight = 1272;
+    config.contentBottom = 716;
+    config.motion = TestPatternCapture::Motion::MovingBox;
+    config.paced = false;
+    config.frameLimit = kFrames;
+    TestPatternCapture capture(config);
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    MemoryFrameSink reference(pool);
+    DirtyTracker tracker;
+    std::uint64_t mismatches = 0;
+    std::uint64_t partialFrames = 0;
+
+    capture.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            FrameWriteOptions options;
+            options.tracker = &tracker;
+            options.sequence = tracker.analyze(frame);
+            const FrameWriteResult result = writeFrameToSink(frame, sink, options);
+            writeFrameToSink(frame, reference);
+            const CpuFrame* tracked = sink.acquireLatest();
+            const CpuFrame* full = reference.acquireLatest();
+            if (!result.accepted || !tracked || !full ||
+                std::memcmp(tracked->data.data(), full->data.data(), full->data.size()) != 0)
+            {
+                ++mismatches;
+            }
+            if (result.bytesWritten < full->data.size())
+            {
+                ++partialFrames;
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (capture.framesDelivered() < kFrames && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    CHECK(capture.framesDelivered() == kFrames);
+    CHECK(mismatches == 0);
+    // Only the first pass over each slot needs a full copy.
+    CHECK(partialFrames >= kFrames - 3);
+    CHECK(sink.bytesCopied() * 4 < reference.bytesCopied());
+}
+
+} // namespace
+
+int main()
+{
+    testUnchangedAndSingleByteChanges();
+    testPackedRgbLastColumn();
+    testRectMerging();
+    testHistoryLimits();
+    testPartialUploadsMatchFullFrames();
+    return testExitCode();
+}
@@ -0,0 +1,279 @@
+#include "Downscale.hpp"
+#include "MemoryFrameSink.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr DownscaleTier kTiers[] = {DownscaleTier::Scalar, DownscaleTier::SSE2, DownscaleTier::AVX2};
+
+struct Size {
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+struct Case {
+    Size source;
+    Size output;
+};
+
+// Both box filters, ratios between and beyond them, odd sizes and a single
+// output column.
+constexpr Case kCases[] = {
+    {{64, 48}, {32, 24}},   {{64, 48}, {16, 12}},  {{100, 60}, {61, 37}}, {{97, 83}, {31, 29}},
+    {{120, 90}, {40, 30}},  {{173, 5}, {23, 2}},   {{33, 33}, {1, 1}},    {{256, 144}, {80, 45}},
+};
+
+std::vector<std::uint8_t> noise(std::size_t bytes, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> data(bytes);
+    for (auto& byte : data)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(seed >> 24);
+    }
+    return data;
+}
+
+AreaScaler::SourceRowFn bgraRows(const std::vector<std::uint8_t>& pixels, std::uint32_t width)
+{
+    return [&pixels, width](std::uint32_t row, std::uint32_t firstColumn, std::uint32_t, std::uint8_t*) {
+        return pixels.data() + (static_cast<std::size_t>(row) * width + firstColumn) * 4;
+    };
+}
+
+// Exact area average: output pixel (x, y) covers source
+// [x * sw / ow, (x + 1) * sw / ow) x [y * sh / oh, (y + 1) * sh / oh).
+std::vector<std::uint8_t> referenceScale(const std::vector<std::uint8_t>& source, const Case& c)
+{
+    const auto overlap = [](std::uint32_t pixel, std::uint32_t index, std::uint32_t source, std::uint32_t output) {
+        const double begin = static_cast<double>(index) * source / output;
+        const double end = static_cast<double>(index + 1) * source / output;
+        return std::max(0.0, std::min<double>(end, pixel + 1) - std::max<double>(begin, pixel));
+    };
+    const double area = static_cast<double>(c.source.width) / c.output.width * c.source.height / c.output.height;
+    std::vector<std::uint8_t> out(static_cast<std::size_t>(c.output.width) * c.output.height * 4);
+    for (std::uint32_t y = 0; y < c.output.height; ++y)
+    {
+        for (std::uint32_t x = 0; x < c.output.width; ++x)
+        {
+            double sum[4] = {};
+            for (std::uint32_t sy = 0; sy < c.source.height; ++sy)
+            {
+                const double wy = overlap(sy, y, c.source.height, c.output.height);
+                for (std::uint32_t sx = 0; wy > 0.0 && sx < c.source.width; ++sx)
+                {
+                    const double w = wy * overlap(sx, x, c.source.width, c.output.width);
+                    for (int channel = 0; channel < 4; ++channel)
+                    {
+                        sum[channel] += w * source[(static_cast<std::size_t>(sy) * c.source.width + sx) * 4 + channel];
+                    }
+                }
+            }
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                out[(static_cast<std::size_t>(y) * c.output.width + x) * 4 + channel] =
+                    static_cast<std::uint8_t>(std::lround(std::clamp(sum[channel] / area, 0.0, 255.0)));
+            }
+        }
+    }
+    return out;
+}
+
+void testAgainstReference()
+{
+    for (const Case& c : kCases)
+    {
+        const AreaScaler scaler(c.source.width, c.source.height, c.output.width, c.output.height);
+        const std::vector<std::uint8_t> source = noise(static_cast<std::size_t>(c.source.width) * c.source.height * 4, c.source.width * 31 + c.output.width);
+        const std::vector<std::uint8_t> reference = referenceScale(source, c);
+        const DirtyRect whole{0, 0, c.output.width, c.output.height};
+        DownscaleScratch scratch;
+
+        std::vector<std::uint8_t> expected(reference.size());
+        CHECK(scaler.scaleRegionWith(DownscaleTier::Scalar, expected.data(), c.output.width * 4, whole, 1,
+                                     bgraRows(source, c.source.width), scratch));
+        int worst = 0;
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            worst = std::max(worst, std::abs(expected[i] - reference[i]));
+        }
+        // Q14 weights and Q7 intermediate rows round twice.
+        if (!CHECK(worst <= 1))
+        {
+            std::fprintf(stderr, "  %ux%u -> %ux%u: %d steps off\n", c.source.width, c.source.height, c.output.width, c.output.height, worst);
+        }
+
+        for (const DownscaleTier tier : kTiers)
+        {
+            std::vector<std::uint8_t> actual(reference.size());
+            if (tier == DownscaleTier::Scalar ||
+                !scaler.scaleRegionWith(tier, actual.data(), c.output.width * 4, whole, 1, bgraRows(source, c.source.width), scratch))
+            {
+                continue;
+            }
+            if (!CHECK(actual == expected))
+            {
+                std::fprintf(stderr, "  %s %ux%u -> %ux%u\n", downscaleTierName(tier), c.source.width, c.source.height, c.output.width,
+                             c.output.height);
+            }
+        }
+    }
+}
+
+// Flat areas stay flat whatever the weights round to.
+void testFlatStaysFlat()
+{
+    for (const Case& c : kCases)
+    {
+        const AreaScaler scaler(c.source.width, c.source.height, c.output.width, c.output.height);
+        std::vector<std::uint8_t> source(static_cast<std::size_t>(c.source.width) * c.source.height * 4);
+        for (std::size_t i = 0; i < source.size(); ++i)
+        {
+            source[i] = static_cast<std::uint8_t>(i % 4 == 3 ? 255 : 17 + 80 * (i % 4));
+        }
+        std::vector<std::uint8_t> out(static_cast<std::size_t>(c.output.width) * c.output.height * 4);
+        DownscaleScratch scratch;
+        scaler.scaleRegion(out.data(), c.output.width * 4, DirtyRect{0, 0, c.output.width, c.output.height}, 1,
+                           bgraRows(source, c.source.width), scratch);
+        bool flat = true;
+        for (std::size_t i = 0; i < out.size(); ++i)
+        {
+            flat &= out[i] == source[i % 4];
+        }
+        CHECK(flat);
+    }
+}
+
+void testChooseSize()
+{
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    // Too little to gain from.
+    CHECK(!chooseDownscaleSize(1920, 1080, 1600, 900, width, height));
+    CHECK(!chooseDownscaleSize(1920, 1080, 0, 0, width, height));
+    // Just above 2:1 and 4:1 snap to the box filters.
+    CHECK(chooseDownscaleSize(3840, 2160, 1900, 1060, width, height) && width == 1920 && height == 1080);
+    CHECK(chooseDownscaleSize(3840, 2160, 950, 530, width, height) && width == 960 && height == 540);
+    // Otherwise 1/8 steps, never smaller than the viewport.
+    CHECK(chooseDownscaleSize(3840, 2160, 1280, 700, width, height) && width >= 1280 && height >= 700);
+    CHECK(width == 1280 && height == 720);
+    // The sampler takes over beyond 8:1.
+    CHECK(chooseDownscaleSize(3840, 2160, 100, 100, width, height) && width == 480 && height == 270);
+}
+
+// Every output pixel a source change can affect lies in the scaled rectangle.
+void testDirtyRectsCover()
+{
+    for (const Case& c : kCases)
+    {
+        const AreaScaler scaler(c.source.width, c.source.height, c.output.width, c.output.height);
+        std::vector<std::uint8_t> before = noise(static_cast<std::size_t>(c.source.width) * c.source.height * 4, 3);
+        std::vector<std::uint8_t> after = before;
+        const DirtyRect changed{c.source.width / 3, c.source.height / 2, c.source.width / 3 + 1, c.source.height / 2 + 1};
+        after[(static_cast<std::size_t>(changed.top) * c.source.width + changed.left) * 4] ^= 0xFF;
+
+        const DirtyRect whole{0, 0, c.output.width, c.output.height};
+        std::vector<std::uint8_t> outBefore(static_cast<std::size_t>(c.output.width) * c.output.height * 4);
+        std::vector<std::uint8_t> outAfter(outBefore.size());
+        DownscaleScratch scratch;
+        scaler.scaleRegion(outBefore.data(), c.output.width * 4, whole, 1, bgraRows(before, c.source.width), scratch);
+        scaler.scaleRegion(outAfter.data(), c.output.width * 4, whole, 1, bgraRows(after, c.source.width), scratch);
+
+        const DirtyRect scaled = scaleDirtyRect(changed, c.source.width, c.source.height, c.output.width, c.output.height);
+        bool covered = scaled.right <= c.output.width && scaled.bottom <= c.output.height;
+        for (std::uint32_t y = 0; y < c.output.height; ++y)
+        {
+            for (std::uint32_t x = 0; x < c.output.width; ++x)
+            {
+                const std::size_t at = (static_cast<std::size_t>(y) * c.output.width + x) * 4;
+                const bool inside = x >= scaled.left && x < scaled.right && y >= scaled.top && y < scaled.bottom;
+                covered &= inside || std::equal(outBefore.begin() + static_cast<std::ptrdiff_t>(at),
+                                                outBefore.begin() + static_cast<std::ptrdiff_t>(at + 4),
+                                                outAfter.begin() + static_cast<std::ptrdiff_t>(at));
+            }
+        }
+        CHECK(covered);
+    }
+}
+
+// A moving test pattern written through the tracked, downscaled frame path
+// into a sink whose buffers only get the changed rectangles ends up identical
+// to downscaling each frame whole.
+void testPartialDownscaleMatchesWholeFrames()
+{
+    constexpr std::uint64_t kFrames = 120;
+
+    TestPatternCapture::Config config;
+    config.width = 1280;
+    config.height = 720;
+    config.bottomUp = true;
+    config.motion = TestPatternCapture::Motion::MovingBox;
+    config.paced = false;
+    config.frameLimit = kFrames;
+    TestPatternCapture capture(config);
+    const AreaScaler scaler(config.width, config.height, 560, 315);
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    MemoryFrameSink reference(pool);
+    DirtyTracker tracker;
+    std::uint64_t mismatches = 0;
+    std::uint64_t partialFrames = 0;
+
+    capture.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            FrameWriteOptions options;
+            options.tracker = &tracker;
+            options.sequence = tracker.analyze(frame);
+            options.scaler = &scaler;
+            const FrameWriteResult result = writeFrameToSink(frame, sink, options);
+            FrameWriteOptions wholeOptions;
+            wholeOptions.scaler = &scaler;
+            writeFrameToSink(frame, reference, wholeOptions);
+            const CpuFrame* tracked = sink.acquireLatest();
+            const CpuFrame* full = reference.acquireLatest();
+            if (!result.accepted || !tracked || !full || tracked->width != scaler.outputWidth() ||
+                std::memcmp(tracked->data.data(), full->data.data(), full->data.size()) != 0)
+            {
+                ++mismatches;
+            }
+            if (full && result.bytesWritten < full->data.size())
+            {
+                ++partialFrames;
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (capture.framesDelivered() < kFrames && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    CHECK(capture.framesDelivered() == kFrames);
+    CHECK(mismatches == 0);
+    CHECK(partialFrames >= kFrames - 3);
+}
+
+} // namespace
+
+int main()
+{
+    testAgainstReference();
+    testFlatStaysFlat();
+    testChooseSize();
+    testDirtyRectsCover();
+    testPartialDownscaleMatchesWholeFrames();
+    return testExitCode();
+}
@@ -0,0 +1,284 @@
+#include "FileReplayCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One Y4M test file: its layout, the planes written for each frame and what
+// replay should make of them.
+struct Y4mCase {
+    const char* name;
+    std::uint32_t width;
+    std::uint32_t height;
+    // The header after the size, e.g. "F30000:1001 C420jpeg".
+    const char* parameters;
+    // Chroma subsampling the colour space implies; mono has no chroma planes.
+    std::uint32_t chromaShiftX;
+    std::uint32_t chromaShiftY;
+    bool monochrome;
+    bool fullRange;
+    std::uint64_t rateNum;
+    std::uint64_t rateDen;
+    // Config::fps for files that declare no rate.
+    double fps;
+    const char* frameHeader;
+};
+
+constexpr int kFrames = 3;
+
+std::uint8_t sample(int plane, int frame, std::uint32_t x, std::uint32_t y)
+{
+    switch (plane)
+    {
+    case 0:
+        return static_cast<std::uint8_t>(16 + (x * 37 + y * 11 + frame * 71) % 220);
+    case 1:
+        return static_cast<std::uint8_t>(30 + (x * 53 + y * 29 + frame * 13) % 196);
+    default:
+        return static_cast<std::uint8_t>(30 + (x * 19 + y * 61 + frame * 41) % 196);
+    }
+}
+
+std::uint32_t chromaSize(std::uint32_t size, std::uint32_t shift)
+{
+    return (size + (1u << shift) - 1) >> shift;
+}
+
+std::filesystem::path testPath(const std::string& name)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "pckvm-replay-test";
+    std::filesystem::create_directories(directory);
+    return directory / name;
+}
+
+void writeY4m(const std::filesystem::path& path, const Y4mCase& c, int frames, bool truncatedTail)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "YUV4MPEG2 W" << c.width << " H" << c.height << ' ' << c.parameters << '\n';
+    const int planes = c.monochrome ? 1 : 3;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        file << c.frameHeader << '\n';
+        for (int plane = 0; plane < planes; ++plane)
+        {
+            const std::uint32_t width = plane == 0 ? c.width : chromaSize(c.width, c.chromaShiftX);
+            const std::uint32_t height = plane == 0 ? c.height : chromaSize(c.height, c.chromaShiftY);
+            for (std::uint32_t y = 0; y < height; ++y)
+            {
+                for (std::uint32_t x = 0; x < width; ++x)
+                {
+                    file.put(static_cast<char>(sample(plane, frame, x, y)));
+                }
+            }
+        }
+    }
+    if (truncatedTail)
+    {
+        // A frame cut short by a full disk or an interrupted copy.
+        file << c.frameHeader << '\n';
+        for (std::uint32_t i = 0; i < c.width; ++i)
+        {
+            file.put(static_cast<char>(0x80));
+        }
+    }
+}
+
+// BT.601 below 720 lines, BT.709 from there, in double precision.
+void expectedBgr(const Y4mCase& c, int frame, std::uint32_t x, std::uint32_t y, int bgr[3])
+{
+    const bool hd = c.height >= 720;
+    const double kr = hd ? 0.2126 : 0.299;
+    const double kb = hd ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+    const double luma = c.fullRange ? sample(0, frame, x, y) : (sample(0, frame, x, y) - 16.0) * 255.0 / 219.0;
+    double cb = 0.0;
+    double cr = 0.0;
+    if (!c.monochrome)
+    {
+        const double chromaScale = c.fullRange ? 1.0 : 255.0 / 224.0;
+        cb = (sample(1, frame, x >> c.chromaShiftX, y >> c.chromaShiftY) - 128.0) * chromaScale;
+        cr = (sample(2, frame, x >> c.chromaShiftX, y >> c.chromaShiftY) - 128.0) * chromaScale;
+    }
+    const double rgb[3] = {luma + 2.0 * (1.0 - kr) * cr, luma - 2.0 * kb * (1.0 - kb) / kg * cb - 2.0 * kr * (1.0 - kr) / kg * cr,
+                           luma + 2.0 * (1.0 - kb) * cb};
+    for (int i = 0; i < 3; ++i)
+    {
+        bgr[2 - i] = static_cast<int>(std::lround(std::clamp(rgb[i], 0.0, 255.0)));
+    }
+}
+
+struct Delivered {
+    std::uint64_t timestamp100ns = 0;
+    CaptureSource::Frame frame{};
+    std::vector<std::uint8_t> bgra;
+};
+
+// Plays `path` once, unpaced, and keeps every frame delivered.
+std::vector<Delivered> replay(const std::filesystem::path& path, double fps, std::size_t expected)
+{
+    FileReplayCapture::Config config;
+    config.path = path.string();
+    config.fps = fps;
+    config.loop = false;
+    config.paced = false;
+    FileReplayCapture capture(config);
+
+    std::mutex mutex;
+    std::vector<Delivered> delivered;
+    capture.start(
+        [&](const CaptureSource::Frame& frame) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Delivered copy;
+            copy.timestamp100ns = frame.timestamp100ns;
+            copy.frame = frame;
+            copy.bgra.assign(frame.data, frame.data + frame.dataSize);
+            copy.frame.data = nullptr;
+            delivered.push_back(std::move(copy));
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (capture.framesDelivered() < expected && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Long enough for a frame past the expected ones to show up.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    capture.stop();
+    CHECK(capture.consumeLastError().empty());
+    return delivered;
+}
+
+// Every chroma layout, with odd sizes where the chroma planes round up, the
+// rate forms the F token takes, full range, the HD matrix and frame headers
+// with parameters. A truncated last frame is not delivered.
+void testChromaLayouts()
+{
+    const Y4mCase cases[] = {
+        {"420 odd", 5, 3, "F30000:1001 C420jpeg", 1, 1, false, false, 30000, 1001, 0.0, "FRAME"},
+        {"420 default", 6, 4, "F25:1 Ip A1:1", 1, 1, false, false, 25, 1, 0.0, "FRAME"},
+        {"422 odd", 7, 4, "F50 C422", 1, 0, false, false, 50, 1, 0.0, "FRAME Ip XFOO=1"},
+        {"444", 4, 3, "F60000:1001 C444", 0, 0, false, false, 60000, 1001, 0.0, "FRAME"},
+        {"mono", 6, 5, "Cmono", 0, 0, true, false, 24000, 1000, 24.0, "FRAME"},
+        {"420 full range", 4, 4, "F30:1 C420 XCOLORRANGE=FULL", 1, 1, false, true, 30, 1, 0.0, "FRAME"},
+        {"420 HD", 3, 720, "F60:1 C420mpeg2", 1, 1, false, false, 60, 1, 0.0, "FRAME"},
+    };
+
+    for (const Y4mCase& c : cases)
+    {
+        const std::filesystem::path path = testPath("layout.y4m");
+        writeY4m(path, c, kFrames, true);
+        std::vector<Delivered> frames;
+        try
+        {
+            frames = replay(path, c.fps, kFrames);
+        }
+        catch (const std::exception& error)
+        {
+            std::fprintf(stderr, "%s: %s\n", c.name, error.what());
+        }
+        if (!CHECK(frames.size() == kFrames))
+        {
+            std::fprintf(stderr, "  %s: %zu frames\n", c.name, frames.size());
+            continue;
+        }
+
+        int worst = 0;
+        for (int index = 0; index < kFrames; ++index)
+        {
+            const Delivered& delivered = frames[static_cast<std::size_t>(index)];
+            const auto expectedTimestamp = static_cast<std::uint64_t>(
+                std::llround(index * 10'000'000.0 * static_cast<double>(c.rateDen) / static_cast<double>(c.rateNum)));
+            CHECK(delivered.timestamp100ns == expectedTimestamp);
+            CHECK(delivered.frame.format == CaptureSource::PixelFormat::BGRA8);
+            CHECK(delivered.frame.width == c.width && delivered.frame.height == c.height);
+            CHECK(delivered.frame.stride == c.width * 4 && !delivered.frame.bottomUp);
+            if (!CHECK(delivered.bgra.size() == static_cast<std::size_t>(c.width) * 4 * c.height))
+            {
+                continue;
+            }
+            for (std::uint32_t y = 0; y < c.height; ++y)
+            {
+                for (std::uint32_t x = 0; x < c.width; ++x)
+                {
+                    const std::uint8_t* pixel = &delivered.bgra[(static_cast<std::size_t>(y) * c.width + x) * 4];
+                    int bgr[3];
+                    expectedBgr(c, index, x, y, bgr);
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        worst = std::max(worst, std::abs(pixel[i] - bgr[i]));
+                    }
+                    worst = std::max(worst, pixel[3] == 0xFF ? 0 : 255);
+                }
+            }
+        }
+        if (!CHECK(worst <= 1))
+        {
+            std::fprintf(stderr, "  %s: off by %d\n", c.name, worst);
+        }
+    }
+    std::filesystem::remove(testPath("layout.y4m"));
+}
+
+bool startFails(const std::string& header, double fps)
+{
+    const std::filesystem::path path = testPath("header.y4m");
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << header << "\nFRAME\n" << std::string(64 * 64 * 3, '\x80');
+    }
+    FileReplayCapture::Config config;
+    config.path = path.string();
+    config.fps = fps;
+    config.paced = false;
+    FileReplayCapture capture(config);
+    bool failed = false;
+    try
+    {
+        capture.start([](const CaptureSource::Frame&) {}, {});
+    }
+    catch (const std::exception&)
+    {
+        failed = true;
+    }
+    capture.stop();
+    std::filesystem::remove(path);
+    return failed;
+}
+
+// A file without a rate plays at Config::fps, and is refused like a raw file
+// when there is none; a zero rate is refused either way.
+void testHeaderErrors()
+{
+    CHECK(!startFails("YUV4MPEG2 W4 H4 F30:1", 0.0));
+    CHECK(!startFails("YUV4MPEG2 W4 H4", 30.0));
+    CHECK(startFails("YUV4MPEG2 W4 H4", 0.0));
+    CHECK(startFails("YUV4MPEG2 W4 H4 F0:1", 60.0));
+    CHECK(startFails("YUV4MPEG2 W4 H4 F30:0", 60.0));
+    CHECK(startFails("YUV4MPEG2 W4 H4 Fx", 60.0));
+    CHECK(startFails("YUV4MPEG2 W4 F30:1", 60.0));
+    CHECK(startFails("YUV4MPEG2 W4 H0 F30:1", 60.0));
+    CHECK(startFails("YUV4MPEG2 W4 H4 F30:1 C420p10", 60.0));
+    // Less than one frame of samples.
+    CHECK(startFails("YUV4MPEG2 W64 H65 F30:1 C444", 60.0));
+}
+
+} // namespace
+
+int main()
+{
+    testChromaLayouts();
+    testHeaderErrors();
+    return testExitCode();
+}
@@ -0,0 +1,202 @@
+#include "FrameMailbox.hpp"
+#include "MemoryFrameSink.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct StressSlot {
+    std::uint64_t sequence = 0;
+    std::vector<std::uint64_t> payload;
+};
+
+void testSingleThreadedOrder()
+{
+    FrameMailbox<StressSlot> mailbox;
+    CHECK(mailbox.acquireLatest() == nullptr);
+
+    for (std::uint64_t i = 1; i <= 3; ++i)
+    {
+        mailbox.writeSlot().sequence = i;
+        mailbox.publish();
+    }
+    const StressSlot* slot = mailbox.acquireLatest();
+    CHECK(slot != nullptr && slot->sequence == 3);
+    CHECK(mailbox.overwrittenCount() == 2);
+    CHECK(mailbox.acquireLatest() == nullptr);
+    CHECK(mailbox.frontSlot().sequence == 3);
+
+    mailbox.reset();
+    CHECK(mailbox.acquireLatest() == nullptr);
+    CHECK(mailbox.overwrittenCount() == 0);
+}
+
+// A producer publishing as fast as it can while the consumer checks every
+// frame it gets: whole (no slot shared with the producer), newer than the last
+// one, and the final frame always arrives.
+void testConcurrentStress()
+{
+    constexpr std::uint64_t kFrames = 200000;
+    constexpr std::size_t kPayloadWords = 512;
+
+    FrameMailbox<StressSlot> mailbox;
+    mailbox.forEachSlot([](StressSlot& slot) { slot.payload.resize(kPayloadWords); });
+
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+        for (std::uint64_t i = 1; i <= kFrames; ++i)
+        {
+            StressSlot& slot = mailbox.writeSlot();
+            slot.sequence = i;
+            for (auto& word : slot.payload)
+            {
+                word = i;
+            }
+            mailbox.publish();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::uint64_t last = 0;
+    std::uint64_t received = 0;
+    bool torn = false;
+    bool reordered = false;
+    for (;;)
+    {
+        const bool finished = done.load(std::memory_order_acquire);
+        if (const StressSlot* slot = mailbox.acquireLatest())
+        {
+            for (const auto word : slot->payload)
+            {
+                torn |= word != slot->sequence;
+            }
+            reordered |= slot->sequence <= last;
+            last = slot->sequence;
+            ++received;
+        }
+        else if (finished)
+        {
+            break;
+        }
+    }
+    producer.join();
+
+    CHECK(!torn);
+    CHECK(!reordered);
+    CHECK(last == kFrames);
+    CHECK(received + mailbox.overwrittenCount() == kFrames);
+}
+
+// The producer never waits for the consumer, even while the consumer holds on
+// to its frame.
+void testProducerNeverBlocks()
+{
+    FrameMailbox<StressSlot> mailbox;
+    mailbox.writeSlot().sequence = 1;
+    mailbox.publish();
+    const StressSlot* held = mailbox.acquireLatest();
+    CHECK(held != nullptr && held->sequence == 1);
+
+    std::thread producer([&]() {
+        for (std::uint64_t i = 2; i <= 100000; ++i)
+        {
+            mailbox.writeSlot().sequence = i;
+            mailbox.publish();
+        }
+    });
+    producer.join();
+
+    CHECK(held->sequence == 1);
+    const StressSlot* latest = mailbox.acquireLatest();
+    CHECK(latest != nullptr && latest->sequence == 100000);
+}
+
+// The same contract end to end: a synthetic capture source writing through
+// MemoryFrameSink while a render-side thread drains it.
+void testMemorySinkWithSyntheticCapture()
+{
+    constexpr std::uint64_t kFrames = 600;
+
+    TestPatternCapture::Config config;
+    config.width = 640;
+    config.height = 360;
+    config.motion = TestPatternCapture::Motion::ScrollingBars;
+    config.paced = false;
+    config.frameLimit = kFrames;
+    TestPatternCapture capture(config);
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    std::atomic<std::uint64_t> lastTimestamp{0};
+    std::atomic<std::uint64_t> written{0};
+
+    std::atomic<bool> stopConsumer{false};
+    std::uint64_t received = 0;
+    bool reordered = false;
+    bool wrongSize = false;
+    std::uint64_t lastSeen = 0;
+    std::thread consumer([&]() {
+        std::uint64_t previous = 0;
+        bool first = true;
+        for (;;)
+        {
+            const bool finishing = stopConsumer.load(std::memory_order_acquire);
+            if (const CpuFrame* frame = sink.acquireLatest())
+            {
+                reordered |= !first && frame->timestamp100ns <= previous;
+                wrongSize |= frame->width != config.width || frame->height != config.height ||
+                             frame->data.size() < static_cast<std::size_t>(frame->stride) * frame->height;
+                previous = frame->timestamp100ns;
+                lastSeen = previous;
+                first = false;
+                ++received;
+            }
+            else if (finishing)
+            {
+                return;
+            }
+        }
+    });
+
+    capture.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            if (writeFrameToSink(frame, sink).accepted)
+            {
+                lastTimestamp.store(frame.timestamp100ns, std::memory_order_relaxed);
+                written.fetch_add(1, std::memory_order_relaxed);
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (capture.framesDelivered() < kFrames && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+    stopConsumer.store(true, std::memory_order_release);
+    consumer.join();
+
+    CHECK(written.load() == kFrames);
+    CHECK(received >= 1);
+    CHECK(!reordered);
+    CHECK(!wrongSize);
+    CHECK(lastSeen == lastTimestamp.load());
+    CHECK(received + sink.overwrittenCount() == kFrames);
+}
+
+} // namespace
+
+int main()
+{
+    testSingleThreadedOrder();
+    testConcurrentStress();
+    testProducerNeverBlocks();
+    testMemorySinkWithSyntheticCapture();
+    return testExitCode();
+}
@@ -0,0 +1,219 @@
+#include "DirtyTracker.hpp"
+#include "Downscale.hpp"
+#include "FramePool.hpp"
+#include "MemoryFrameSink.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Every heap allocation in the process goes through these, so a test can
+// assert that a stretch of work did not allocate at all.
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+void* countedAllocate(std::size_t bytes, std::size_t alignment) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (bytes == 0)
+    {
+        bytes = 1;
+    }
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return std::malloc(bytes);
+    }
+    return std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+}
+
+void* countedAllocateOrThrow(std::size_t bytes, std::size_t alignment)
+{
+    if (void* memory = countedAllocate(bytes, alignment))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t bytes) { return countedAllocateOrThrow(bytes, 0); }
+void* operator new[](std::size_t bytes) { return countedAllocateOrThrow(bytes, 0); }
+void* operator new(std::size_t bytes, std::align_val_t alignment) { return countedAllocateOrThrow(bytes, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t bytes, std::align_val_t alignment) { return countedAllocateOrThrow(bytes, static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept { return countedAllocate(bytes, 0); }
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept { return countedAllocate(bytes, 0); }
+void* operator new(std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(bytes, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(bytes, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+
+namespace {
+
+void testHandlesAndLimit()
+{
+    FramePool pool(8u * 1024u * 1024u);
+    const std::uint64_t allocationsBefore = g_allocations.load();
+    FramePool::Handle first = pool.acquire(1024 * 1024, FramePool::PixelFormat::BGRA8);
+    CHECK(!first.empty());
+    // The counter sees the pool's own allocations.
+    CHECK(g_allocations.load() > allocationsBefore);
+    CHECK(reinterpret_cast<std::uintptr_t>(first.data()) % FramePool::kAlignment == 0);
+    CHECK(first.size() == 1024 * 1024);
+
+    FramePool::Handle shared = first;
+    CHECK(first.useCount() == 2);
+    std::uint8_t* const memory = first.data();
+    first.reset();
+    shared.reset();
+    CHECK(pool.cachedBytes() >= 1024 * 1024);
+
+    // The same size comes back from the cache.
+    FramePool::Handle again = pool.acquire(1024 * 1024, FramePool::PixelFormat::BGRA8);
+    CHECK(again.data() == memory);
+    CHECK(pool.allocationCount() == 1);
+
+    // Over the limit even with the cache dropped.
+    CHECK(pool.acquire(16u * 1024u * 1024u, FramePool::PixelFormat::BGRA8).empty());
+    again.reset();
+    pool.trim();
+    CHECK(pool.cachedBytes() == 0);
+}
+
+// Runs the capture thread's steady state (dirty tracking, then a tracked,
+// striped write into the memory sink) from a synthetic source with a render
+// thread draining the sink, and counts heap allocations across the middle
+// stretch of frames on every thread. With `scaler` the frames are downscaled
+// on the way, as when the window is much smaller than the source.
+void testSteadyStateCaptureDoesNotAllocate(const AreaScaler* scaler)
+{
+    constexpr std::uint64_t kWarmupFrames = 60;
+    constexpr std::uint64_t kMeasuredFrames = 600;
+
+    TestPatternCapture::Config config;
+    config.width = 1920;
+    config.height = 1080;
+    config.bottomUp = true;
+    config.motion = TestPatternCapture::Motion::MovingBox;
+    config.paced = false;
+    config.frameLimit = kWarmupFrames + kMeasuredFrames + 10;
+    TestPatternCapture capture(config);
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    DirtyTracker tracker;
+    StripeWorkerPool workers(2);
+
+    std::atomic<bool> stopRender{false};
+    std::thread render([&]() {
+        while (!stopRender.load(std::memory_order_acquire))
+        {
+            (void)sink.acquireLatest();
+        }
+    });
+
+    std::uint64_t frames = 0;
+    std::uint64_t allocationsAtStart = 0;
+    std::uint64_t allocationsAtEnd = 0;
+    std::uint64_t poolAllocationsAtStart = 0;
+    std::uint64_t poolAllocationsAtEnd = 0;
+    capture.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            if (frames == kWarmupFrames)
+            {
+                allocationsAtStart = g_allocations.load(std::memory_order_relaxed);
+                poolAllocationsAtStart = pool.allocationCount();
+            }
+            FrameWriteOptions options;
+            options.tracker = &tracker;
+            options.sequence = tracker.analyze(frame);
+            options.workers = &workers;
+            options.scaler = scaler;
+            writeFrameToSink(frame, sink, options);
+            if (++frames == kWarmupFrames + kMeasuredFrames)
+            {
+                allocationsAtEnd = g_allocations.load(std::memory_order_relaxed);
+                poolAllocationsAtEnd = pool.allocationCount();
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (capture.framesDelivered() < config.frameLimit && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+    stopRender.store(true, std::memory_order_release);
+    render.join();
+
+    CHECK(frames >= kWarmupFrames + kMeasuredFrames);
+    CHECK(allocationsAtEnd == allocationsAtStart);
+    CHECK(poolAllocationsAtEnd == poolAllocationsAtStart);
+}
+
+// A mode switch and the switch back reuse the cached buffers.
+void testResolutionChangeReusesBuffers()
+{
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    std::vector<std::uint8_t> sample(1920u * 1080u * 4u, 0x40);
+    DirectShowCapture::Frame frame{};
+    frame.data = sample.data();
+    frame.dataSize = sample.size();
+
+    const auto runMode = [&](std::uint32_t width, std::uint32_t height) {
+        sink.reset();
+        frame.width = width;
+        frame.height = height;
+        frame.stride = width * 4;
+        for (int i = 0; i < 8; ++i)
+        {
+            writeFrameToSink(frame, sink);
+            (void)sink.acquireLatest();
+        }
+    };
+
+    runMode(1920, 1080);
+    runMode(1280, 720);
+    const std::uint64_t allocations = pool.allocationCount();
+    runMode(1920, 1080);
+    runMode(1280, 720);
+    CHECK(pool.allocationCount() == allocations);
+}
+
+} // namespace
+
+int main()
+{
+    testHandlesAndLimit();
+    testSteadyStateCaptureDoesNotAllocate(nullptr);
+    const AreaScaler scaler(1920, 1080, 1280, 720);
+    testSteadyStateCaptureDoesNotAllocate(&scaler);
+    testResolutionChangeReusesBuffers();
+    return testExitCode();
+}
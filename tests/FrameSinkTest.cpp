@@ -0,0 +1,164 @@
+#include "MemoryFrameSink.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::uint32_t pixelValue(std::uint32_t x, std::uint32_t y)
+{
+    return (y << 16) ^ (x * 2654435761u);
+}
+
+// Sink that hands out a fixed buffer, like the renderer's mapped upload
+// memory, and counts what it is given.
+class BufferSink : public FrameSink {
+public:
+    BufferSink(std::uint32_t width, std::uint32_t height, std::uint32_t rowPitch)
+        : width_(width), height_(height), rowPitch_(rowPitch), pixels_(static_cast<std::size_t>(rowPitch) * height, 0xCD)
+    {
+    }
+
+    bool beginFrame(std::uint32_t width, std::uint32_t height, FrameSinkTarget& target) override
+    {
+        if (!accepting || width != width_ || height != height_)
+        {
+            return false;
+        }
+        target.data = pixels_.data();
+        target.rowPitch = rowPitch_;
+        target.width = width;
+        target.height = height;
+        return true;
+    }
+
+    void commitFrame(const DirectShowCapture::Frame&, std::uint64_t) override { ++commits; }
+
+    [[nodiscard]] const std::uint8_t* row(std::uint32_t y) const { return pixels_.data() + static_cast<std::size_t>(y) * rowPitch_; }
+
+    bool accepting = true;
+    int commits = 0;
+
+private:
+    std::uint32_t width_;
+    std::uint32_t height_;
+    std::uint32_t rowPitch_;
+    std::vector<std::uint8_t> pixels_;
+};
+
+// A bottom-up sample, padded rows, with the content rectangle inside it: the
+// sink receives the rectangle top-down in one copy and nothing else.
+void testSingleCopyIntoSink()
+{
+    constexpr std::uint32_t kSampleWidth = 37;
+    constexpr std::uint32_t kSampleHeight = 23;
+    constexpr std::uint32_t kStride = kSampleWidth * 4 + 12;
+    std::vector<std::uint8_t> sample(static_cast<std::size_t>(kStride) * kSampleHeight);
+    for (std::uint32_t row = 0; row < kSampleHeight; ++row)
+    {
+        const std::uint32_t imageRow = kSampleHeight - 1 - row;
+        for (std::uint32_t x = 0; x < kSampleWidth; ++x)
+        {
+            const std::uint32_t value = pixelValue(x, imageRow);
+            std::memcpy(sample.data() + static_cast<std::size_t>(row) * kStride + x * 4, &value, 4);
+        }
+    }
+
+    DirectShowCapture::Frame frame{};
+    frame.data = sample.data();
+    frame.dataSize = sample.size();
+    frame.stride = kStride;
+    frame.bottomUp = true;
+    frame.sampleWidth = kSampleWidth;
+    frame.sampleHeight = kSampleHeight;
+    frame.contentLeft = 3;
+    frame.contentTop = 2;
+    frame.contentRight = 33;
+    frame.contentBottom = 21;
+    frame.width = frame.contentRight - frame.contentLeft;
+    frame.height = frame.contentBottom - frame.contentTop;
+
+    BufferSink sink(frame.width, frame.height, frame.width * 4 + 64);
+    const FrameWriteResult result = writeFrameToSink(frame, sink);
+    CHECK(result.accepted);
+    CHECK(result.bytesWritten == static_cast<std::size_t>(frame.width) * 4 * frame.height);
+    CHECK(sink.bytesCopied() == result.bytesWritten);
+    CHECK(sink.framesCopied() == 1);
+    CHECK(sink.commits == 1);
+
+    bool matches = true;
+    for (std::uint32_t y = 0; y < frame.height; ++y)
+    {
+        for (std::uint32_t x = 0; x < frame.width; ++x)
+        {
+            std::uint32_t value = 0;
+            std::memcpy(&value, sink.row(y) + x * 4, 4);
+            matches &= value == pixelValue(x + frame.contentLeft, y + frame.contentTop);
+        }
+        // Row padding of the sink is left alone.
+        matches &= sink.row(y)[frame.width * 4] == 0xCD;
+    }
+    CHECK(matches);
+
+    sink.accepting = false;
+    const FrameWriteResult rejected = writeFrameToSink(frame, sink);
+    CHECK(!rejected.accepted);
+    CHECK(rejected.bytesWritten == 0);
+    CHECK(sink.framesCopied() == 1);
+    CHECK(sink.commits == 1);
+}
+
+// Frames from a synthetic source cost exactly their active bytes each, once.
+void testSyntheticCaptureCopiesOnce()
+{
+    constexpr std::uint64_t kFrames = 120;
+
+    TestPatternCapture::Config config;
+    config.width = 1280;
+    config.height = 720;
+    config.bottomUp = true;
+    config.contentLeft = 16;
+    config.contentTop = 8;
+    config.contentRight = 1264;
+    config.contentBottom = 712;
+    config.paced = false;
+    config.frameLimit = kFrames;
+    TestPatternCapture capture(config);
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    capture.start([&](const DirectShowCapture::Frame& frame) { writeFrameToSink(frame, sink); }, {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (capture.framesDelivered() < kFrames && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    const std::uint64_t activeBytes = static_cast<std::uint64_t>(config.contentRight - config.contentLeft) * 4 *
+                                      (config.contentBottom - config.contentTop);
+    CHECK(sink.framesCopied() == kFrames);
+    CHECK(sink.bytesCopied() == activeBytes * kFrames);
+
+    const CpuFrame* latest = sink.acquireLatest();
+    CHECK(latest != nullptr);
+    if (latest)
+    {
+        CHECK(latest->width == config.contentRight - config.contentLeft);
+        CHECK(latest->height == config.contentBottom - config.contentTop);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testSingleCopyIntoSink();
+    testSyntheticCaptureCopiesOnce();
+    return testExitCode();
+}
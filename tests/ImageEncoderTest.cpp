@@ -0,0 +1,703 @@
+#include "ImageEncoder.hpp"
+#include "MemoryFrameSink.hpp"
+#include "ScreenshotWriter.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::uint32_t bigEndian32(const std::uint8_t* p)
+{
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+           (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+}
+
+struct Image {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::uint8_t> rgb;
+};
+
+// QOI decoder after the specification at qoiformat.org.
+bool decodeQoi(const std::vector<std::uint8_t>& file, Image& image)
+{
+    if (file.size() < 22 || std::memcmp(file.data(), "qoif", 4) != 0)
+    {
+        return false;
+    }
+    image.width = bigEndian32(&file[4]);
+    image.height = bigEndian32(&file[8]);
+    const std::size_t pixels = static_cast<std::size_t>(image.width) * image.height;
+    image.rgb.clear();
+    image.rgb.reserve(pixels * 3);
+
+    std::array<std::array<std::uint8_t, 4>, 64> index{};
+    std::array<std::uint8_t, 4> pixel{0, 0, 0, 255};
+    std::size_t at = 14;
+    const std::size_t end = file.size() - 8;
+    while (image.rgb.size() < pixels * 3 && at < end)
+    {
+        const std::uint8_t tag = file[at++];
+        std::size_t run = 1;
+        if (tag == 0xFE)
+        {
+            pixel[0] = file[at];
+            pixel[1] = file[at + 1];
+            pixel[2] = file[at + 2];
+            at += 3;
+        }
+        else if (tag == 0xFF)
+        {
+            std::copy_n(&file[at], 4, pixel.begin());
+            at += 4;
+        }
+        else if ((tag >> 6) == 0)
+        {
+            pixel = index[tag & 63];
+        }
+        else if ((tag >> 6) == 1)
+        {
+            pixel[0] = static_cast<std::uint8_t>(pixel[0] + ((tag >> 4) & 3) - 2);
+            pixel[1] = static_cast<std::uint8_t>(pixel[1] + ((tag >> 2) & 3) - 2);
+            pixel[2] = static_cast<std::uint8_t>(pixel[2] + (tag & 3) - 2);
+        }
+        else if ((tag >> 6) == 2)
+        {
+            const int green = (tag & 63) - 32;
+            const std::uint8_t next = file[at++];
+            pixel[0] = static_cast<std::uint8_t>(pixel[0] + green - 8 + (next >> 4));
+            pixel[1] = static_cast<std::uint8_t>(pixel[1] + green);
+            pixel[2] = static_cast<std::uint8_t>(pixel[2] + green - 8 + (next & 15));
+        }
+        else
+        {
+            run = (tag & 63) + 1u;
+        }
+        index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64] = pixel;
+        for (std::size_t i = 0; i < run; ++i)
+        {
+            image.rgb.insert(image.rgb.end(), pixel.begin(), pixel.begin() + 3);
+        }
+    }
+    static constexpr std::uint8_t kEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    return image.rgb.size() == pixels * 3 && at == end && std::memcmp(&file[end], kEnd, 8) == 0;
+}
+
+// A plain inflate (RFC 1951) for checking the encoder's streams.
+class Inflater {
+public:
+    explicit Inflater(const std::vector<std::uint8_t>& data) : data_(data) {}
+
+    bool run(std::vector<std::uint8_t>& out)
+    {
+        for (;;)
+        {
+            const std::uint32_t last = bits(1);
+            const std::uint32_t type = bits(2);
+            bool ok = false;
+            if (type == 0)
+            {
+                ok = stored(out);
+            }
+            else if (type == 1)
+            {
+                ok = fixed(out);
+            }
+            else if (type == 2)
+            {
+                ok = dynamic(out);
+            }
+            if (!ok || failed_)
+            {
+                return false;
+            }
+            if (last)
+            {
+                return true;
+            }
+        }
+    }
+
+    // Bytes consumed, after skipping to a byte boundary.
+    [[nodiscard]] std::size_t position() const noexcept { return position_; }
+
+private:
+    struct Huffman {
+        std::array<std::uint16_t, 16> counts{};
+        std::vector<std::uint16_t> symbols;
+    };
+
+    std::uint32_t bits(unsigned count)
+    {
+        std::uint32_t value = 0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (bitCount_ == 0)
+            {
+                if (position_ >= data_.size())
+                {
+                    failed_ = true;
+                    return 0;
+                }
+                bitBuffer_ = data_[position_++];
+                bitCount_ = 8;
+            }
+            value |= (bitBuffer_ & 1u) << i;
+            bitBuffer_ >>= 1;
+            --bitCount_;
+        }
+        return value;
+    }
+
+    static Huffman build(const std::uint8_t* lengths, std::size_t count)
+    {
+        Huffman table;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ++table.counts[lengths[i]];
+        }
+        table.counts[0] = 0;
+        std::array<std::uint16_t, 16> offsets{};
+        for (std::size_t length = 1; length < 16; ++length)
+        {
+            offsets[length] = static_cast<std::uint16_t>(offsets[length - 1] + table.counts[length - 1]);
+        }
+        table.symbols.assign(count, 0);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (lengths[i] != 0)
+            {
+                table.symbols[offsets[lengths[i]]++] = static_cast<std::uint16_t>(i);
+            }
+        }
+        return table;
+    }
+
+    int decode(const Huffman& table)
+    {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (std::size_t length = 1; length < 16; ++length)
+        {
+            code |= static_cast<int>(bits(1));
+            const int count = table.counts[length];
+            if (code - count < first)
+            {
+                return table.symbols[static_cast<std::size_t>(index + code - first)];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        failed_ = true;
+        return -1;
+    }
+
+    bool stored(std::vector<std::uint8_t>& out)
+    {
+        bitCount_ = 0;
+        if (position_ + 4 > data_.size())
+        {
+            return false;
+        }
+        const std::size_t length = data_[position_] | (data_[position_ + 1] << 8);
+        position_ += 4;
+        if (position_ + length > data_.size())
+        {
+            return false;
+        }
+        out.insert(out.end(), data_.begin() + static_cast<std::ptrdiff_t>(position_),
+                   data_.begin() + static_cast<std::ptrdiff_t>(position_ + length));
+        position_ += length;
+        return true;
+    }
+
+    bool codes(std::vector<std::uint8_t>& out, const Huffman& lengthCodes, const Huffman& distanceCodes)
+    {
+        static constexpr std::uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr std::uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr std::uint16_t kDistanceBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                            193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static constexpr std::uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                            6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        for (;;)
+        {
+            const int symbol = decode(lengthCodes);
+            if (symbol < 0 || failed_)
+            {
+                return false;
+            }
+            if (symbol < 256)
+            {
+                out.push_back(static_cast<std::uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256)
+            {
+                return true;
+            }
+            const int lengthIndex = symbol - 257;
+            if (lengthIndex >= 29)
+            {
+                return false;
+            }
+            const std::size_t length = kLengthBase[lengthIndex] + bits(kLengthExtra[lengthIndex]);
+            const int distanceIndex = decode(distanceCodes);
+            if (distanceIndex < 0 || distanceIndex >= 30)
+            {
+                return false;
+            }
+            const std::size_t distance = kDistanceBase[distanceIndex] + bits(kDistanceExtra[distanceIndex]);
+            if (distance > out.size())
+            {
+                return false;
+            }
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                out.push_back(out[out.size() - distance]);
+            }
+        }
+    }
+
+    bool fixed(std::vector<std::uint8_t>& out)
+    {
+        std::uint8_t lengths[288 + 30];
+        std::fill_n(lengths, 144, 8);
+        std::fill_n(lengths + 144, 112, 9);
+        std::fill_n(lengths + 256, 24, 7);
+        std::fill_n(lengths + 280, 8, 8);
+        std::fill_n(lengths + 288, 30, 5);
+        return codes(out, build(lengths, 288), build(lengths + 288, 30));
+    }
+
+    bool dynamic(std::vector<std::uint8_t>& out)
+    {
+        static constexpr std::uint8_t kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        const std::size_t literals = bits(5) + 257;
+        const std::size_t distances = bits(5) + 1;
+        const std::size_t codeLengths = bits(4) + 4;
+        std::uint8_t lengths[320] = {};
+        for (std::size_t i = 0; i < codeLengths; ++i)
+        {
+            lengths[kOrder[i]] = static_cast<std::uint8_t>(bits(3));
+        }
+        const Huffman lengthLengths = build(lengths, 19);
+        std::size_t index = 0;
+        while (index < literals + distances)
+        {
+            const int symbol = decode(lengthLengths);
+            if (symbol < 0)
+            {
+                return false;
+            }
+            if (symbol < 16)
+            {
+                lengths[index++] = static_cast<std::uint8_t>(symbol);
+                continue;
+            }
+            std::uint8_t value = 0;
+            std::size_t repeat = 0;
+            if (symbol == 16)
+            {
+                if (index == 0)
+                {
+                    return false;
+                }
+                value = lengths[index - 1];
+                repeat = 3 + bits(2);
+            }
+            else if (symbol == 17)
+            {
+                repeat = 3 + bits(3);
+            }
+            else
+            {
+                repeat = 11 + bits(7);
+            }
+            if (index + repeat > literals + distances)
+            {
+                return false;
+            }
+            std::fill_n(lengths + index, repeat, value);
+            index += repeat;
+        }
+        return codes(out, build(lengths, literals), build(lengths + literals, distances));
+    }
+
+    const std::vector<std::uint8_t>& data_;
+    std::size_t position_ = 0;
+    std::uint32_t bitBuffer_ = 0;
+    unsigned bitCount_ = 0;
+    bool failed_ = false;
+};
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size)
+{
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+std::uint8_t paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    return static_cast<std::uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Walks the chunks checking every CRC, inflates the zlib stream the IDATs
+// carry, checks its Adler-32 and undoes the row filters of 8-bit RGB.
+bool decodePng(const std::vector<std::uint8_t>& file, Image& image)
+{
+    static constexpr std::uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (file.size() < 8 || std::memcmp(file.data(), kSignature, 8) != 0)
+    {
+        return false;
+    }
+    std::vector<std::uint8_t> stream;
+    bool ended = false;
+    std::size_t at = 8;
+    while (at + 12 <= file.size() && !ended)
+    {
+        const std::uint32_t length = bigEndian32(&file[at]);
+        if (at + 12 + length > file.size() || crc32(&file[at + 4], length + 4) != bigEndian32(&file[at + 8 + length]))
+        {
+            return false;
+        }
+        const std::uint8_t* payload = &file[at + 8];
+        if (std::memcmp(&file[at + 4], "IHDR", 4) == 0)
+        {
+            image.width = bigEndian32(payload);
+            image.height = bigEndian32(payload + 4);
+            if (payload[8] != 8 || payload[9] != 2 || payload[12] != 0)
+            {
+                return false;
+            }
+        }
+        else if (std::memcmp(&file[at + 4], "IDAT", 4) == 0)
+        {
+            stream.insert(stream.end(), payload, payload + length);
+        }
+        else if (std::memcmp(&file[at + 4], "IEND", 4) == 0)
+        {
+            ended = at + 12 == file.size();
+        }
+        at += 12 + length;
+    }
+
+    if (!ended || stream.size() < 6 || ((stream[0] << 8) | stream[1]) % 31 != 0)
+    {
+        return false;
+    }
+    const std::vector<std::uint8_t> deflate(stream.begin() + 2, stream.end());
+    Inflater inflater(deflate);
+    std::vector<std::uint8_t> filtered;
+    if (!inflater.run(filtered) || inflater.position() + 4 != deflate.size())
+    {
+        return false;
+    }
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    for (const std::uint8_t byte : filtered)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    const std::size_t rowBytes = static_cast<std::size_t>(image.width) * 3;
+    if (((b << 16) | a) != bigEndian32(&deflate[deflate.size() - 4]) || filtered.size() != (rowBytes + 1) * image.height)
+    {
+        return false;
+    }
+    image.rgb.assign(rowBytes * image.height, 0);
+    for (std::uint32_t y = 0; y < image.height; ++y)
+    {
+        const std::uint8_t filter = filtered[y * (rowBytes + 1)];
+        const std::uint8_t* in = &filtered[y * (rowBytes + 1) + 1];
+        std::uint8_t* row = &image.rgb[y * rowBytes];
+        const std::uint8_t* above = y > 0 ? row - rowBytes : nullptr;
+        for (std::size_t x = 0; x < rowBytes; ++x)
+        {
+            const int left = x >= 3 ? row[x - 3] : 0;
+            const int up = above ? above[x] : 0;
+            const int upLeft = above && x >= 3 ? above[x - 3] : 0;
+            int predicted = 0;
+            switch (filter)
+            {
+            case 0:
+                break;
+            case 1:
+                predicted = left;
+                break;
+            case 2:
+                predicted = up;
+                break;
+            case 3:
+                predicted = (left + up) / 2;
+                break;
+            case 4:
+                predicted = paeth(left, up, upLeft);
+                break;
+            default:
+                return false;
+            }
+            row[x] = static_cast<std::uint8_t>(in[x] + predicted);
+        }
+    }
+    return true;
+}
+
+std::vector<std::uint8_t> rgbOf(const std::vector<std::uint8_t>& bgra)
+{
+    std::vector<std::uint8_t> rgb;
+    rgb.reserve(bgra.size() / 4 * 3);
+    for (std::size_t i = 0; i < bgra.size(); i += 4)
+    {
+        rgb.push_back(bgra[i + 2]);
+        rgb.push_back(bgra[i + 1]);
+        rgb.push_back(bgra[i]);
+    }
+    return rgb;
+}
+
+enum class Content {
+    Noise,
+    Flat,
+    Desktop,
+};
+
+// Random alpha throughout, which both formats must ignore.
+std::vector<std::uint8_t> makeImage(std::uint32_t width, std::uint32_t height, Content content, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> bgra(static_cast<std::size_t>(width) * height * 4);
+    const auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<std::uint8_t>(seed >> 24);
+    };
+    for (std::uint32_t y = 0; y < height; ++y)
+    {
+        for (std::uint32_t x = 0; x < width; ++x)
+        {
+            std::uint8_t* pixel = &bgra[(static_cast<std::size_t>(y) * width + x) * 4];
+            if (content == Content::Noise)
+            {
+                pixel[0] = next();
+                pixel[1] = next();
+                pixel[2] = next();
+            }
+            else if (content == Content::Flat)
+            {
+                pixel[0] = 0x7F;
+                pixel[1] = 0x7F;
+                pixel[2] = 0x7F;
+            }
+            else
+            {
+                // Panels, a gradient title bar, glyph-like strokes and a photo.
+                std::uint8_t value = x < width / 5 ? 45 : 30;
+                pixel[0] = pixel[1] = pixel[2] = value;
+                if (y < height / 10)
+                {
+                    pixel[2] = static_cast<std::uint8_t>(x * 255 / width);
+                    pixel[1] = static_cast<std::uint8_t>(y * 255 / (height / 10 + 1));
+                    pixel[0] = 120;
+                }
+                else if (x > width * 3 / 5 && y > height / 2)
+                {
+                    pixel[2] = next();
+                    pixel[1] = static_cast<std::uint8_t>(pixel[2] / 2 + (next() & 31));
+                    pixel[0] = static_cast<std::uint8_t>(pixel[1] / 2);
+                }
+                else if (x >= width / 5 && ((x / 9 + y / 18) * 2654435761u >> 28) & 1 && (x + y) % 3 != 0)
+                {
+                    pixel[0] = pixel[1] = pixel[2] = 220;
+                }
+            }
+            pixel[3] = next();
+        }
+    }
+    return bgra;
+}
+
+// Every size class the encoders special-case: single pixels, rows shorter
+// than a QOI run or a filter's reach, a band boundary, and rows padded past
+// their width as captured frames are.
+void testRoundTrip()
+{
+    struct Case {
+        std::uint32_t width;
+        std::uint32_t height;
+        Content content;
+    };
+    const Case cases[] = {
+        {1, 1, Content::Noise},      {7, 3, Content::Noise},        {300, 200, Content::Desktop}, {300, 200, Content::Noise},
+        {129, 130, Content::Flat},   {64, kPngBandRows + 1, Content::Desktop}, {1920, 1080, Content::Desktop},
+    };
+    StripeWorkerPool workers(3);
+    std::uint32_t seed = 1;
+    for (const Case& c : cases)
+    {
+        const std::vector<std::uint8_t> bgra = makeImage(c.width, c.height, c.content, seed++);
+        const std::size_t pitch = static_cast<std::size_t>(c.width) * 4 + 16;
+        std::vector<std::uint8_t> padded(pitch * c.height, 0xAA);
+        for (std::uint32_t y = 0; y < c.height; ++y)
+        {
+            std::memcpy(&padded[y * pitch], &bgra[static_cast<std::size_t>(y) * c.width * 4], static_cast<std::size_t>(c.width) * 4);
+        }
+        const std::vector<std::uint8_t> expected = rgbOf(bgra);
+
+        std::vector<std::uint8_t> qoi;
+        encodeQoi(padded.data(), pitch, c.width, c.height, qoi);
+        Image fromQoi;
+        if (!CHECK(decodeQoi(qoi, fromQoi) && fromQoi.width == c.width && fromQoi.height == c.height && fromQoi.rgb == expected))
+        {
+            std::fprintf(stderr, "  QOI %ux%u\n", c.width, c.height);
+        }
+
+        std::vector<std::uint8_t> png;
+        std::vector<std::uint8_t> pngSerial;
+        encodePng(padded.data(), pitch, c.width, c.height, png, &workers);
+        encodePng(padded.data(), pitch, c.width, c.height, pngSerial);
+        Image fromPng;
+        if (!CHECK(decodePng(png, fromPng) && fromPng.width == c.width && fromPng.height == c.height && fromPng.rgb == expected))
+        {
+            std::fprintf(stderr, "  PNG %ux%u\n", c.width, c.height);
+        }
+        // The file does not depend on the worker count.
+        CHECK(png == pngSerial);
+    }
+}
+
+// Both formats actually compress what they are for: flat areas to almost
+// nothing, and a desktop-like 1080p frame well below raw RGB.
+void testCompression()
+{
+    std::vector<std::uint8_t> out;
+    const std::vector<std::uint8_t> flat = makeImage(512, 512, Content::Flat, 1);
+    encodeQoi(flat.data(), 512 * 4, 512, 512, out);
+    CHECK(out.size() < 512 * 512 / 50);
+    encodePng(flat.data(), 512 * 4, 512, 512, out);
+    CHECK(out.size() < 512 * 512 / 50);
+
+    const std::vector<std::uint8_t> desktop = makeImage(1920, 1080, Content::Desktop, 2);
+    const std::size_t raw = std::size_t{1920} * 1080 * 3;
+    encodeQoi(desktop.data(), 1920 * 4, 1920, 1080, out);
+    const std::size_t qoiSize = out.size();
+    encodePng(desktop.data(), 1920 * 4, 1920, 1080, out);
+    CHECK(qoiSize < raw / 2);
+    CHECK(out.size() < qoiSize);
+}
+
+std::vector<std::uint8_t> readFile(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+// Screenshots go through the frame path like any sink: refused until
+// requested, saved as the requested formats and readable back to the
+// frame's pixels, with a request beyond kMaxQueued reported, not waited for.
+void testScreenshotWriter()
+{
+    constexpr std::uint32_t kWidth = 640;
+    constexpr std::uint32_t kHeight = 360;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "pckvm-screenshot-test";
+    std::filesystem::remove_all(directory);
+
+    std::vector<std::uint8_t> bgra = makeImage(kWidth, kHeight, Content::Desktop, 9);
+    DirectShowCapture::Frame frame{};
+    frame.data = bgra.data();
+    frame.dataSize = bgra.size();
+    frame.width = kWidth;
+    frame.height = kHeight;
+    frame.stride = kWidth * 4;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::vector<ScreenshotResult> results;
+    {
+        ScreenshotWriter writer;
+        writer.setCompletionHandler([&](const ScreenshotResult& result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results.push_back(result);
+            done.notify_one();
+        });
+
+        CHECK(!writeFrameToSink(frame, writer, {}).accepted);
+        const ScreenshotFormat formats[] = {ScreenshotFormat::PngAndQoi, ScreenshotFormat::Qoi, ScreenshotFormat::Png, ScreenshotFormat::Png,
+                                            ScreenshotFormat::Png, ScreenshotFormat::Png};
+        int accepted = 0;
+        for (std::size_t i = 0; i < std::size(formats); ++i)
+        {
+            writer.request(directory / ("shot" + std::to_string(i)), formats[i]);
+            CHECK(writer.requested());
+            accepted += writeFrameToSink(frame, writer, {}).accepted ? 1 : 0;
+            CHECK(!writer.requested());
+        }
+        CHECK(accepted >= static_cast<int>(ScreenshotWriter::kMaxQueued));
+
+        std::unique_lock<std::mutex> lock(mutex);
+        CHECK(done.wait_for(lock, std::chrono::seconds(30), [&]() { return results.size() == std::size(formats); }));
+    }
+
+    const std::vector<std::uint8_t> expected = rgbOf(bgra);
+    std::size_t saved = 0;
+    for (const ScreenshotResult& result : results)
+    {
+        if (!result.saved)
+        {
+            CHECK(!result.error.empty() && result.files.empty());
+            continue;
+        }
+        ++saved;
+        CHECK(result.width == kWidth && result.height == kHeight);
+        for (const std::filesystem::path& file : result.files)
+        {
+            Image image;
+            const std::vector<std::uint8_t> contents = readFile(file);
+            const bool decoded = file.extension() == ".qoi" ? decodeQoi(contents, image) : decodePng(contents, image);
+            if (!CHECK(decoded && image.rgb == expected))
+            {
+                std::fprintf(stderr, "  %s\n", file.string().c_str());
+            }
+        }
+    }
+    CHECK(saved >= ScreenshotWriter::kMaxQueued);
+    CHECK(results.front().saved && results.front().files.size() == 2);
+    std::filesystem::remove_all(directory);
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testCompression();
+    testScreenshotWriter();
+    return testExitCode();
+}
@@ -0,0 +1,184 @@
+#include "AudioKernels.hpp"
+#include "CopyKernels.hpp"
+#include "Downscale.hpp"
+#include "KernelRegistry.hpp"
+#include "PixelConversion.hpp"
+#include "ScalingFilter.hpp"
+#include "TestSupport.hpp"
+#include "ToneMapping.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr SimdLevel kLevels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::SSSE3, SimdLevel::AVX2, SimdLevel::AVX512};
+
+struct TierLevel {
+    const char* name;
+    SimdLevel level;
+};
+
+// Each family's tiers and the level they need, in configureKernels() order,
+// with the tier its dispatch actually uses.
+struct ExpectedFamily {
+    const char* family;
+    std::vector<TierLevel> tiers;
+    const char* (*active)();
+};
+
+std::vector<ExpectedFamily> expectedFamilies()
+{
+    return {
+        {"frame copy",
+         {{copyKernelTierName(CopyKernelTier::Memcpy), SimdLevel::Scalar},
+          {copyKernelTierName(CopyKernelTier::SSE2), SimdLevel::SSE2},
+          {copyKernelTierName(CopyKernelTier::AVX2), SimdLevel::AVX2},
+          {copyKernelTierName(CopyKernelTier::AVX512), SimdLevel::AVX512}},
+         []() { return copyKernelTierName(activeCopyKernelTier()); }},
+        {"pixel conversion",
+         {{conversionTierName(ConversionTier::Scalar), SimdLevel::Scalar},
+          {conversionTierName(ConversionTier::SSSE3), SimdLevel::SSSE3},
+          {conversionTierName(ConversionTier::AVX2), SimdLevel::AVX2}},
+         []() { return conversionTierName(activeConversionTier()); }},
+        {"HDR tone mapping",
+         {{conversionTierName(ConversionTier::Scalar), SimdLevel::Scalar},
+          {conversionTierName(ConversionTier::AVX2), SimdLevel::AVX2}},
+         []() { return conversionTierName(activeToneMapTier()); }},
+        {"downscale",
+         {{downscaleTierName(DownscaleTier::Scalar), SimdLevel::Scalar},
+          {downscaleTierName(DownscaleTier::SSE2), SimdLevel::SSE2},
+          {downscaleTierName(DownscaleTier::AVX2), SimdLevel::AVX2}},
+         []() { return downscaleTierName(activeDownscaleTier()); }},
+        {"scaling filters",
+         {{scalingTierName(ScalingTier::Scalar), SimdLevel::Scalar},
+          {scalingTierName(ScalingTier::SSE2), SimdLevel::SSE2},
+          {scalingTierName(ScalingTier::AVX2), SimdLevel::AVX2}},
+         []() { return scalingTierName(activeScalingTier()); }},
+        {"audio samples",
+         {{audioKernelTierName(AudioKernelTier::Scalar), SimdLevel::Scalar},
+          {audioKernelTierName(AudioKernelTier::SSE2), SimdLevel::SSE2},
+          {audioKernelTierName(AudioKernelTier::AVX2), SimdLevel::AVX2}},
+         []() { return audioKernelTierName(activeAudioKernelTier()); }},
+    };
+}
+
+void setSimdEnvironment(const char* value)
+{
+#if defined(_MSC_VER)
+    _putenv_s(kSimdLevelEnvironmentVariable, value ? value : "");
+#else
+    if (value)
+    {
+        setenv(kSimdLevelEnvironmentVariable, value, 1);
+    }
+    else
+    {
+        unsetenv(kSimdLevelEnvironmentVariable);
+    }
+#endif
+}
+
+void testLevelNames()
+{
+    for (const SimdLevel level : kLevels)
+    {
+        SimdLevel parsed = level == SimdLevel::Scalar ? SimdLevel::AVX512 : SimdLevel::Scalar;
+        CHECK(parseSimdLevel(simdLevelName(level), parsed));
+        CHECK(parsed == level);
+    }
+
+    for (const char* text : {"", "auto", "AVX2", "avx", "sse4", "avx2 ", "avx5120"})
+    {
+        SimdLevel level = SimdLevel::SSSE3;
+        if (!CHECK(!parseSimdLevel(text, level)))
+        {
+            std::fprintf(stderr, "  parsed '%s'\n", text);
+        }
+        CHECK(level == SimdLevel::SSSE3);
+    }
+}
+
+// PCKVM_SIMD wins when it names a level; unset, empty or anything else
+// leaves the fallback.
+void testEnvironmentOverride()
+{
+    setSimdEnvironment(nullptr);
+    CHECK(simdLevelFromEnvironment(SimdLevel::AVX2) == SimdLevel::AVX2);
+    for (const SimdLevel level : kLevels)
+    {
+        setSimdEnvironment(simdLevelName(level));
+        CHECK(simdLevelFromEnvironment(SimdLevel::SSE2) == level);
+    }
+    for (const char* text : {"", "AVX2", "fastest", "3"})
+    {
+        setSimdEnvironment(text);
+        CHECK(simdLevelFromEnvironment(SimdLevel::SSSE3) == SimdLevel::SSSE3);
+    }
+    setSimdEnvironment(nullptr);
+}
+
+// Every level up to what the CPU runs caps each family at its widest tier
+// within the limit, and no tier fails its self-test on this host. Ends at
+// the detected level, as the other tests expect.
+void testConfigureKernels()
+{
+    const std::vector<ExpectedFamily> families = expectedFamilies();
+    const SimdLevel detected = detectedSimdLevel();
+    std::printf("CPU supports %s\n", simdLevelName(detected));
+
+    for (const SimdLevel limit : kLevels)
+    {
+        if (limit > detected)
+        {
+            break;
+        }
+        const std::vector<KernelFamilyReport> reports = configureKernels(limit);
+        if (!CHECK(reports.size() == families.size()))
+        {
+            continue;
+        }
+        for (std::size_t i = 0; i < families.size(); ++i)
+        {
+            const ExpectedFamily& family = families[i];
+            const KernelFamilyReport& report = reports[i];
+            const char* expected = family.tiers.front().name;
+            for (const TierLevel& tier : family.tiers)
+            {
+                if (tier.level <= limit)
+                {
+                    expected = tier.name;
+                }
+            }
+            CHECK(std::strcmp(report.family, family.family) == 0);
+            if (!CHECK(std::strcmp(report.active, expected) == 0))
+            {
+                std::fprintf(stderr, "  %s at %s: %s, expected %s\n", family.family, simdLevelName(limit), report.active, expected);
+            }
+            CHECK(std::strcmp(family.active(), report.active) == 0);
+            if (!CHECK(report.failed.empty()))
+            {
+                std::fprintf(stderr, "  %s self-test failed for %s\n", family.family, report.failed.c_str());
+            }
+        }
+    }
+
+    const std::vector<KernelFamilyReport> restored = configureKernels(detected);
+    for (std::size_t i = 0; i < restored.size() && i < families.size(); ++i)
+    {
+        CHECK(std::strcmp(families[i].active(), restored[i].active) == 0);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testLevelNames();
+    testEnvironmentOverride();
+    testConfigureKernels();
+    return testExitCode();
+}
@@ -0,0 +1,196 @@
+#include "LatencyStats.hpp"
+#include "MemoryFrameSink.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void testBucketBounds()
+{
+    bool monotonic = true;
+    bool contained = true;
+    bool precise = true;
+    std::size_t previous = 0;
+    std::uint64_t state = 0x2545F4914F6CDD1Dull;
+    std::vector<std::uint64_t> values;
+    for (std::uint64_t value = 0; value < 4096; ++value)
+    {
+        values.push_back(value);
+    }
+    for (unsigned bit = 12; bit < LatencyHistogram::kMaxValueBits; ++bit)
+    {
+        values.push_back((1ull << bit) - 1);
+        values.push_back(1ull << bit);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        values.push_back((1ull << bit) | (state & ((1ull << bit) - 1)));
+    }
+
+    for (const std::uint64_t value : values)
+    {
+        const std::size_t index = LatencyHistogram::bucketIndex(value);
+        monotonic &= index >= previous;
+        previous = index;
+        contained &= index < LatencyHistogram::kBucketCount;
+        contained &= value <= LatencyHistogram::bucketUpperBound(index);
+        contained &= index == 0 || value > LatencyHistogram::bucketUpperBound(index - 1);
+        precise &= LatencyHistogram::bucketUpperBound(index) - value <= value / 64;
+    }
+    CHECK(monotonic);
+    CHECK(contained);
+    CHECK(precise);
+
+    // Values past the range land in the last bucket.
+    CHECK(LatencyHistogram::bucketIndex(~0ull) == LatencyHistogram::kBucketCount - 1);
+}
+
+void testQuantiles()
+{
+    LatencyHistogram histogram;
+    CHECK(histogram.valueAtQuantile(0.5) == 0);
+    CHECK(histogram.mean() == 0.0);
+
+    for (std::uint64_t value = 1; value <= 100000; ++value)
+    {
+        histogram.record(value * 1000);
+    }
+    CHECK(histogram.count() == 100000);
+    CHECK(histogram.max() == 100000000);
+    CHECK(histogram.mean() == 50000500.0);
+
+    const auto near = [](std::uint64_t measured, std::uint64_t expected) {
+        return measured >= expected && measured - expected <= expected / 64;
+    };
+    CHECK(near(histogram.valueAtQuantile(0.5), 50000000));
+    CHECK(near(histogram.valueAtQuantile(0.99), 99000000));
+    CHECK(near(histogram.valueAtQuantile(0.999), 99900000));
+    CHECK(histogram.valueAtQuantile(1.0) == 100000000);
+    CHECK(near(histogram.valueAtQuantile(0.0), 1000));
+
+    histogram.reset();
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.max() == 0);
+}
+
+void testConcurrentRecording()
+{
+    constexpr std::uint64_t kPerThread = 200000;
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (std::uint64_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&histogram, t]() {
+            for (std::uint64_t i = 0; i < kPerThread; ++i)
+            {
+                histogram.record(t * 1000000 + i);
+            }
+        });
+    }
+    // Readers may run at the same time.
+    for (int i = 0; i < 100; ++i)
+    {
+        (void)histogram.valueAtQuantile(0.99);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(histogram.count() == 4 * kPerThread);
+    CHECK(histogram.max() == 3000000 + kPerThread - 1);
+}
+
+void testTrackerStages()
+{
+    LatencyTracker tracker;
+    tracker.record(FrameTimestamps{1000, 3000, 7000, 8000, 20000});
+    // Missing stamps skip the stages that need them; reversed ones are ignored.
+    tracker.record(FrameTimestamps{1000, 2000, 0, 0, 0});
+    tracker.record(FrameTimestamps{5000, 4000, 0, 0, 0});
+
+    CHECK(tracker.histogram(LatencyStage::Handle).count() == 2);
+    CHECK(tracker.histogram(LatencyStage::Handle).max() == 2000);
+    CHECK(tracker.histogram(LatencyStage::Queue).count() == 1);
+    CHECK(tracker.histogram(LatencyStage::Queue).max() == 4000);
+    CHECK(tracker.histogram(LatencyStage::Record).max() == 1000);
+    CHECK(tracker.histogram(LatencyStage::Present).max() == 12000);
+    CHECK(tracker.histogram(LatencyStage::Total).count() == 1);
+    CHECK(tracker.histogram(LatencyStage::Total).max() == 19000);
+
+    const std::string report = tracker.formatReport();
+    for (std::size_t i = 0; i < LatencyTracker::kStageCount; ++i)
+    {
+        CHECK(report.find(LatencyTracker::stageName(static_cast<LatencyStage>(i))) != std::string::npos);
+    }
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "pckvm_latency_report.txt";
+    CHECK(tracker.writeReport(path.string()));
+    std::ifstream in(path);
+    std::stringstream written;
+    written << in.rdbuf();
+    CHECK(written.str() == report);
+    in.close();
+    std::filesystem::remove(path);
+
+    tracker.reset();
+    CHECK(tracker.histogram(LatencyStage::Total).count() == 0);
+}
+
+// Frames reaching a sink carry the capture stamp from the source and the
+// handled stamp from the commit, in order.
+void testStampsThroughSink()
+{
+    TestPatternCapture::Config config;
+    config.width = 320;
+    config.height = 240;
+    config.paced = false;
+    config.frameLimit = 50;
+    TestPatternCapture capture(config);
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    LatencyTracker tracker;
+    std::uint64_t badStamps = 0;
+    capture.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            writeFrameToSink(frame, sink);
+            const CpuFrame* latest = sink.acquireLatest();
+            if (!latest || latest->timestamps.captured != frame.arrivalNs || latest->timestamps.handled < frame.arrivalNs ||
+                latest->timestamps.handled > latencyClockNs())
+            {
+                ++badStamps;
+                return;
+            }
+            tracker.record(latest->timestamps);
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (capture.framesDelivered() < config.frameLimit && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    CHECK(badStamps == 0);
+    CHECK(tracker.histogram(LatencyStage::Handle).count() == config.frameLimit);
+}
+
+} // namespace
+
+int main()
+{
+    testBucketBounds();
+    testQuantiles();
+    testConcurrentRecording();
+    testTrackerStages();
+    testStampsThroughSink();
+    return testExitCode();
+}
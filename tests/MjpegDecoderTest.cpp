@@ -0,0 +1,231 @@
+#include "FileReplayCapture.hpp"
+#include "MemoryFrameSink.hpp"
+#include "MjpegDecoder.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestSupport.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The recordings in data/ were written by libjpeg (quality 95, baseline)
+// from the picture below, with the frame index moving the checkerboard:
+//   yuv420_restart.mjpeg  150x110 4:2:0, a restart marker every MCU row,
+//                         frames 0, 0 (a duplicate bitstream) and 1
+//   yuv422_restart.mjpeg  160x120 4:2:2, a restart marker every 3 MCUs,
+//                         frames 0 and 1
+//   yuv444.jpg            96x64 4:4:4, no restart markers
+//   grey.jpg              70x45 greyscale, (R + G) / 2 of the picture
+namespace {
+
+void patternRgb(std::uint32_t width, std::uint32_t height, std::uint32_t frame, std::uint32_t x, std::uint32_t y, int rgb[3])
+{
+    rgb[0] = static_cast<int>(x * 255 / (width - 1));
+    rgb[1] = static_cast<int>(y * 255 / (height - 1));
+    rgb[2] = (((x + 8 * frame) / 20 + y / 20) % 2) != 0 ? 190 : 60;
+}
+
+std::string dataPath(const char* name)
+{
+    return std::string(PCKVM_TEST_DATA_DIR) + "/" + name;
+}
+
+struct DecodedFrame {
+    MjpegDecoder::Result result = MjpegDecoder::Result::Failed;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::uint8_t> bgra;
+};
+
+// Replays a recording like a USB dongle would deliver it, decodes every
+// frame with and without workers, and keeps the BGRA that reached the sink.
+struct ReplayResult {
+    std::vector<DecodedFrame> serial;
+    std::vector<DecodedFrame> parallel;
+};
+
+ReplayResult replay(const char* name, std::size_t frames)
+{
+    FileReplayCapture::Config config;
+    config.path = dataPath(name);
+    config.loop = false;
+    config.paced = false;
+    FileReplayCapture capture(config);
+
+    FramePool pool;
+    StripeWorkerPool workers(3);
+    MjpegDecoder serialDecoder(pool);
+    MjpegDecoder parallelDecoder(pool, &workers);
+    MemoryFrameSink sink(pool);
+
+    ReplayResult result;
+    const auto decode = [&](MjpegDecoder& decoder, const CaptureSource::Frame& compressed, std::vector<DecodedFrame>& out) {
+        DecodedFrame decoded;
+        CaptureSource::Frame picture{};
+        decoded.result = decoder.decode(compressed, picture);
+        if (decoded.result != MjpegDecoder::Result::Failed && writeFrameToSink(picture, sink).accepted)
+        {
+            const CpuFrame* written = sink.acquireLatest();
+            decoded.width = written->width;
+            decoded.height = written->height;
+            decoded.bgra.assign(written->data.data(), written->data.data() + written->data.size());
+        }
+        out.push_back(std::move(decoded));
+    };
+
+    try
+    {
+        capture.start(
+            [&](const CaptureSource::Frame& frame) {
+                decode(serialDecoder, frame, result.serial);
+                decode(parallelDecoder, frame, result.parallel);
+            },
+            {});
+    }
+    catch (const std::exception& error)
+    {
+        std::fprintf(stderr, "%s: %s\n", name, error.what());
+        return result;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (capture.framesDelivered() < frames && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+    return result;
+}
+
+// Peak signal-to-noise ratio of the decoded picture against the source
+// picture, over the colour channels.
+double psnr(const DecodedFrame& decoded, std::uint32_t frame, bool grey)
+{
+    double squaredError = 0.0;
+    for (std::uint32_t y = 0; y < decoded.height; ++y)
+    {
+        for (std::uint32_t x = 0; x < decoded.width; ++x)
+        {
+            int rgb[3];
+            patternRgb(decoded.width, decoded.height, frame, x, y, rgb);
+            if (grey)
+            {
+                rgb[0] = rgb[1] = rgb[2] = (rgb[0] + rgb[1]) / 2;
+            }
+            const std::uint8_t* pixel = decoded.bgra.data() + (static_cast<std::size_t>(y) * decoded.width + x) * 4;
+            for (int c = 0; c < 3; ++c)
+            {
+                const double error = static_cast<double>(pixel[2 - c]) - rgb[c];
+                squaredError += error * error;
+            }
+        }
+    }
+    const double mse = squaredError / (3.0 * decoded.width * decoded.height);
+    return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void checkRecording(const char* name,
+                    std::uint32_t width,
+                    std::uint32_t height,
+                    const std::vector<std::uint32_t>& pictures,
+                    const std::vector<MjpegDecoder::Result>& results,
+                    bool grey = false)
+{
+    const ReplayResult replayed = replay(name, pictures.size());
+    if (!CHECK(replayed.serial.size() == pictures.size() && replayed.parallel.size() == pictures.size()))
+    {
+        std::fprintf(stderr, "  %s: %zu frames\n", name, replayed.serial.size());
+        return;
+    }
+    for (std::size_t i = 0; i < pictures.size(); ++i)
+    {
+        const DecodedFrame& serial = replayed.serial[i];
+        const DecodedFrame& parallel = replayed.parallel[i];
+        CHECK(serial.result == results[i]);
+        CHECK(parallel.result == results[i]);
+        CHECK(serial.width == width && serial.height == height);
+        // Restart intervals decoded on workers give the same picture.
+        CHECK(parallel.bgra == serial.bgra);
+        const double quality = serial.bgra.empty() ? 0.0 : psnr(serial, pictures[i], grey);
+        if (!CHECK(quality > 36.0))
+        {
+            std::fprintf(stderr, "  %s frame %zu: PSNR %.2f dB\n", name, i, quality);
+        }
+    }
+}
+
+void testRecordings()
+{
+    using Result = MjpegDecoder::Result;
+    checkRecording("yuv420_restart.mjpeg", 150, 110, {0, 0, 1}, {Result::Decoded, Result::Duplicate, Result::Decoded});
+    checkRecording("yuv422_restart.mjpeg", 160, 120, {0, 1}, {Result::Decoded, Result::Decoded});
+    checkRecording("yuv444.jpg", 96, 64, {0}, {Result::Decoded});
+    checkRecording("grey.jpg", 70, 45, {0}, {Result::Decoded}, true);
+}
+
+std::vector<std::uint8_t> readFile(const char* name)
+{
+    std::ifstream in(dataPath(name), std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void testHeadersAndDamage()
+{
+    const std::vector<std::uint8_t> jpeg = readFile("yuv444.jpg");
+    CHECK(!jpeg.empty());
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    CHECK(MjpegDecoder::probe(jpeg.data(), jpeg.size(), width, height));
+    CHECK(width == 96 && height == 64);
+    CHECK(MjpegDecoder::frameLength(jpeg.data(), jpeg.size()) == jpeg.size());
+    CHECK(MjpegDecoder::frameLength(jpeg.data(), jpeg.size() / 2) == 0);
+
+    FramePool pool;
+    MjpegDecoder decoder(pool);
+    CaptureSource::Frame compressed{};
+    compressed.format = CaptureSource::PixelFormat::MJPEG;
+    compressed.width = width;
+    compressed.height = height;
+    CaptureSource::Frame decoded{};
+
+    // Cut off halfway through the entropy-coded data, as when a transfer
+    // loses its end: the rest of the picture decodes from zero bits.
+    compressed.data = jpeg.data();
+    compressed.dataSize = jpeg.size() / 2;
+    CHECK(decoder.decode(compressed, decoded) == MjpegDecoder::Result::Decoded);
+    CHECK(decoded.width == 96 && decoded.height == 64);
+
+    // Cut off inside the headers, or garbage, is rejected and does not stop
+    // the next good picture.
+    compressed.dataSize = 100;
+    CHECK(decoder.decode(compressed, decoded) == MjpegDecoder::Result::Failed);
+    CHECK(!decoder.lastError().empty());
+    std::vector<std::uint8_t> garbage(jpeg.size(), 0x5A);
+    compressed.data = garbage.data();
+    compressed.dataSize = garbage.size();
+    CHECK(decoder.decode(compressed, decoded) == MjpegDecoder::Result::Failed);
+
+    compressed.data = jpeg.data();
+    compressed.dataSize = jpeg.size();
+    CHECK(decoder.decode(compressed, decoded) == MjpegDecoder::Result::Decoded);
+    CHECK(decoded.width == 96 && decoded.height == 64);
+    CHECK(decoder.decode(compressed, decoded) == MjpegDecoder::Result::Duplicate);
+    decoder.reset();
+    CHECK(decoder.decode(compressed, decoded) == MjpegDecoder::Result::Decoded);
+    CHECK(decoder.framesFailed() == 2);
+    CHECK(decoder.framesDuplicate() == 1);
+}
+
+} // namespace
+
+int main()
+{
+    testRecordings();
+    testHeadersAndDamage();
+    return testExitCode();
+}
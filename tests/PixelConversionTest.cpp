@@ -0,0 +1,617 @@
+#include "DirtyTracker.hpp"
+#include "MemoryFrameSink.hpp"
+#include "PixelConversion.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using PixelFormat = CaptureSource::PixelFormat;
+using ColorMatrix = CaptureSource::ColorMatrix;
+
+constexpr ConversionTier kTiers[] = {ConversionTier::Scalar, ConversionTier::SSSE3, ConversionTier::AVX2};
+constexpr ColorMatrix kMatrices[] = {ColorMatrix::BT601, ColorMatrix::BT709, ColorMatrix::BT2020};
+// Row lengths around every vector width, plus one long row.
+constexpr std::size_t kRowLengths[] = {1, 2, 3, 5, 7, 8, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 97, 1001};
+constexpr std::uint8_t kCanary = 0xEE;
+
+std::vector<std::uint8_t> noise(std::size_t bytes, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> data(bytes);
+    for (auto& byte : data)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(seed >> 24);
+    }
+    return data;
+}
+
+// Floating-point YCbCr -> BGR straight from the matrix definition, on 8-bit
+// scale samples (10-bit ones divided by four).
+void referenceBgr(double y, double cb, double cr, ColorMatrix matrix, bool fullRange, int bgr[3])
+{
+    double kr = 0.2126;
+    double kb = 0.0722;
+    if (matrix == ColorMatrix::BT601)
+    {
+        kr = 0.299;
+        kb = 0.114;
+    }
+    else if (matrix == ColorMatrix::BT2020)
+    {
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    const double kg = 1.0 - kr - kb;
+    const double luma = fullRange ? y : (y - 16.0) * 255.0 / 219.0;
+    const double chromaScale = fullRange ? 1.0 : 255.0 / 224.0;
+    const double u = (cb - 128.0) * chromaScale;
+    const double v = (cr - 128.0) * chromaScale;
+    const double rgb[3] = {luma + 2.0 * (1.0 - kb) * u,
+                           luma - 2.0 * kb * (1.0 - kb) / kg * u - 2.0 * kr * (1.0 - kr) / kg * v,
+                           luma + 2.0 * (1.0 - kr) * v};
+    for (int i = 0; i < 3; ++i)
+    {
+        bgr[i] = static_cast<int>(std::lround(std::clamp(rgb[i], 0.0, 255.0)));
+    }
+}
+
+// Fixed point may be one step off the exact value.
+bool nearReference(const std::uint8_t* pixel, const int bgr[3])
+{
+    return std::abs(pixel[0] - bgr[0]) <= 1 && std::abs(pixel[1] - bgr[1]) <= 1 && std::abs(pixel[2] - bgr[2]) <= 1 && pixel[3] == 255;
+}
+
+// Output of `pixels` BGRA pixels with canaries behind them; true when the
+// canaries survived.
+struct OutputRow {
+    explicit OutputRow(std::size_t pixels) : bytes(pixels * 4 + 64, kCanary), pixels(pixels) {}
+
+    [[nodiscard]] std::uint8_t* data() { return bytes.data(); }
+    [[nodiscard]] bool intact() const
+    {
+        return std::all_of(bytes.begin() + static_cast<std::ptrdiff_t>(pixels * 4), bytes.end(), [](std::uint8_t b) { return b == kCanary; });
+    }
+
+    std::vector<std::uint8_t> bytes;
+    std::size_t pixels;
+};
+
+void testPacked422()
+{
+    for (const PixelFormat format : {PixelFormat::YUY2, PixelFormat::UYVY})
+    {
+        const bool uyvy = format == PixelFormat::UYVY;
+        const Packed422RowFn scalar = packed422Kernel(format, ConversionTier::Scalar);
+        CHECK(scalar != nullptr);
+        for (const ColorMatrix matrix : kMatrices)
+        {
+            for (const bool fullRange : {false, true})
+            {
+                const YuvCoefficients coefficients = yuvCoefficients(matrix, fullRange);
+                for (const std::size_t pixels : kRowLengths)
+                {
+                    const std::vector<std::uint8_t> source = noise((pixels + 1) / 2 * 4, static_cast<std::uint32_t>(pixels * 7 + 1));
+
+                    OutputRow expected(pixels);
+                    scalar(expected.data(), source.data(), pixels, coefficients);
+                    bool accurate = expected.intact();
+                    for (std::size_t x = 0; x < pixels; ++x)
+                    {
+                        const std::uint8_t* group = source.data() + x / 2 * 4;
+                        const double y = uyvy ? group[1 + (x % 2) * 2] : group[(x % 2) * 2];
+                        const double cb = uyvy ? group[0] : group[1];
+                        const double cr = uyvy ? group[2] : group[3];
+                        int bgr[3];
+                        referenceBgr(y, cb, cr, matrix, fullRange, bgr);
+                        accurate &= nearReference(expected.data() + x * 4, bgr);
+                    }
+                    if (!CHECK(accurate))
+                    {
+                        std::fprintf(stderr, "  %s scalar, %zu pixels\n", uyvy ? "UYVY" : "YUY2", pixels);
+                    }
+
+                    for (const ConversionTier tier : kTiers)
+                    {
+                        const Packed422RowFn kernel = packed422Kernel(format, tier);
+                        if (!kernel || tier == ConversionTier::Scalar)
+                        {
+                            continue;
+                        }
+                        OutputRow actual(pixels);
+                        kernel(actual.data(), source.data(), pixels, coefficients);
+                        if (!CHECK(actual.bytes == expected.bytes))
+                        {
+                            std::fprintf(stderr, "  %s %s, %zu pixels\n", uyvy ? "UYVY" : "YUY2", conversionTierName(tier), pixels);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Nominal black and white in both ranges.
+    const std::uint8_t limited[] = {16, 128, 235, 128};
+    const std::uint8_t full[] = {0, 128, 255, 128};
+    std::uint8_t out[8];
+    const Packed422RowFn yuy2 = packed422Kernel(PixelFormat::YUY2, ConversionTier::Scalar);
+    yuy2(out, limited, 2, yuvCoefficients(ColorMatrix::BT709, false));
+    CHECK(out[0] == 0 && out[1] == 0 && out[2] == 0 && out[3] == 255);
+    CHECK(out[4] == 255 && out[5] == 255 && out[6] == 255 && out[7] == 255);
+    yuy2(out, full, 2, yuvCoefficients(ColorMatrix::BT601, true));
+    CHECK(out[0] == 0 && out[1] == 0 && out[2] == 0);
+    CHECK(out[4] == 255 && out[5] == 255 && out[6] == 255);
+}
+
+void testSemiPlanar()
+{
+    for (const PixelFormat format : {PixelFormat::NV12, PixelFormat::P010})
+    {
+        const bool tenBit = format == PixelFormat::P010;
+        const std::size_t sampleBytes = tenBit ? 2 : 1;
+        const SemiPlanarRowFn scalar = semiPlanarKernel(format, ConversionTier::Scalar);
+        CHECK(scalar != nullptr);
+        for (const ColorMatrix matrix : kMatrices)
+        {
+            for (const bool fullRange : {false, true})
+            {
+                const YuvCoefficients coefficients = yuvCoefficients(matrix, fullRange);
+                for (const std::size_t pixels : kRowLengths)
+                {
+                    const std::size_t rowBytes = (pixels + 1) / 2 * 2 * sampleBytes;
+                    const std::vector<std::uint8_t> luma = noise(rowBytes, static_cast<std::uint32_t>(pixels * 3 + 5));
+                    const std::vector<std::uint8_t> chroma = noise(rowBytes, static_cast<std::uint32_t>(pixels * 11 + 9));
+                    const auto sample = [&](const std::vector<std::uint8_t>& plane, std::size_t index) {
+                        if (!tenBit)
+                        {
+                            return static_cast<double>(plane[index]);
+                        }
+                        const unsigned value = (plane[index * 2] | (plane[index * 2 + 1] << 8)) >> 6;
+                        return static_cast<double>(value) / 4.0;
+                    };
+
+                    OutputRow expected(pixels);
+                    scalar(expected.data(), luma.data(), chroma.data(), pixels, coefficients);
+                    bool accurate = expected.intact();
+                    for (std::size_t x = 0; x < pixels; ++x)
+                    {
+                        int bgr[3];
+                        referenceBgr(sample(luma, x), sample(chroma, x / 2 * 2), sample(chroma, x / 2 * 2 + 1), matrix, fullRange, bgr);
+                        accurate &= nearReference(expected.data() + x * 4, bgr);
+                    }
+                    if (!CHECK(accurate))
+                    {
+                        std::fprintf(stderr, "  %s scalar, %zu pixels\n", tenBit ? "P010" : "NV12", pixels);
+                    }
+
+                    for (const ConversionTier tier : kTiers)
+                    {
+                        const SemiPlanarRowFn kernel = semiPlanarKernel(format, tier);
+                        if (!kernel || tier == ConversionTier::Scalar)
+                        {
+                            continue;
+                        }
+                        OutputRow actual(pixels);
+                        kernel(actual.data(), luma.data(), chroma.data(), pixels, coefficients);
+                        if (!CHECK(actual.bytes == expected.bytes))
+                        {
+                            std::fprintf(stderr, "  %s %s, %zu pixels\n", tenBit ? "P010" : "NV12", conversionTierName(tier), pixels);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// DIB byte order: RGB24 is B G R, RGB565 a little-endian word with blue in
+// the low bits. Channels widen by repeating their top bits.
+void referenceRgb(PixelFormat format, const std::uint8_t* pixel, std::uint8_t bgra[4])
+{
+    if (format == PixelFormat::RGB24)
+    {
+        bgra[0] = pixel[0];
+        bgra[1] = pixel[1];
+        bgra[2] = pixel[2];
+    }
+    else
+    {
+        const unsigned word = pixel[0] | (pixel[1] << 8);
+        const unsigned b = word & 0x1F;
+        const unsigned g = (word >> 5) & 0x3F;
+        const unsigned r = word >> 11;
+        bgra[0] = static_cast<std::uint8_t>((b << 3) | (b >> 2));
+        bgra[1] = static_cast<std::uint8_t>((g << 2) | (g >> 4));
+        bgra[2] = static_cast<std::uint8_t>((r << 3) | (r >> 2));
+    }
+    bgra[3] = 255;
+}
+
+void testPackedRgb()
+{
+    for (const PixelFormat format : {PixelFormat::RGB24, PixelFormat::RGB565})
+    {
+        const std::size_t pixelBytes = format == PixelFormat::RGB24 ? 3 : 2;
+        const char* name = format == PixelFormat::RGB24 ? "RGB24" : "RGB565";
+        const PackedRgbRowFn scalar = packedRgbKernel(format, ConversionTier::Scalar);
+        CHECK(scalar != nullptr);
+        for (const std::size_t pixels : kRowLengths)
+        {
+            // Exactly the row's bytes, so a kernel reading past the last pixel
+            // shows up under a sanitizer.
+            const std::vector<std::uint8_t> source = noise(pixels * pixelBytes, static_cast<std::uint32_t>(pixels * 5 + 3));
+
+            OutputRow expected(pixels);
+            scalar(expected.data(), source.data(), pixels);
+            bool exact = expected.intact();
+            for (std::size_t x = 0; x < pixels; ++x)
+            {
+                std::uint8_t bgra[4];
+                referenceRgb(format, source.data() + x * pixelBytes, bgra);
+                exact &= std::equal(bgra, bgra + 4, expected.data() + x * 4);
+            }
+            if (!CHECK(exact))
+            {
+                std::fprintf(stderr, "  %s scalar, %zu pixels\n", name, pixels);
+            }
+
+            for (const ConversionTier tier : kTiers)
+            {
+                const PackedRgbRowFn kernel = packedRgbKernel(format, tier);
+                if (!kernel || tier == ConversionTier::Scalar)
+                {
+                    continue;
+                }
+                OutputRow actual(pixels);
+                kernel(actual.data(), source.data(), pixels);
+                if (!CHECK(actual.bytes == expected.bytes))
+                {
+                    std::fprintf(stderr, "  %s %s, %zu pixels\n", name, conversionTierName(tier), pixels);
+                }
+            }
+        }
+
+        // Through the frame path: odd widths, DWORD-padded bottom-up rows.
+        for (const std::uint32_t width : {1u, 3u, 65u, 333u})
+        {
+            constexpr std::uint32_t kHeight = 5;
+            const std::uint32_t stride = static_cast<std::uint32_t>((width * pixelBytes + 3) / 4 * 4);
+            const std::vector<std::uint8_t> bytes = noise(static_cast<std::size_t>(stride) * kHeight, width);
+            DirectShowCapture::Frame frame{};
+            frame.format = format;
+            frame.width = width;
+            frame.height = kHeight;
+            frame.stride = stride;
+            frame.bottomUp = true;
+            frame.data = bytes.data();
+            frame.dataSize = bytes.size();
+
+            FramePool pool;
+            MemoryFrameSink sink(pool);
+            CHECK(writeFrameToSink(frame, sink).accepted);
+            const CpuFrame* written = sink.acquireLatest();
+            bool matches = written != nullptr;
+            for (std::uint32_t y = 0; matches && y < kHeight; ++y)
+            {
+                const std::uint8_t* sourceRow = bytes.data() + static_cast<std::size_t>(kHeight - 1 - y) * stride;
+                for (std::uint32_t x = 0; x < width; ++x)
+                {
+                    std::uint8_t bgra[4];
+                    referenceRgb(format, sourceRow + x * pixelBytes, bgra);
+                    matches &= std::equal(bgra, bgra + 4, written->data.data() + static_cast<std::size_t>(y) * written->stride + x * 4);
+                }
+            }
+            if (!CHECK(matches))
+            {
+                std::fprintf(stderr, "  %s frame, width %u\n", name, width);
+            }
+        }
+    }
+}
+
+// Packs 10-bit 4:2:2 samples into v210 blocks: per six pixels the words
+// hold Cb0 Y0 Cr0 | Y1 Cb2 Y2 | Cr2 Y3 Cb4 | Y4 Cr4 Y5, low bits first.
+// `chroma` is Cb Cr per pixel pair, as in UYVY.
+std::vector<std::uint8_t> packV210(const std::vector<unsigned>& luma, const std::vector<unsigned>& chroma, std::size_t rowBytes)
+{
+    std::vector<std::uint8_t> row(rowBytes);
+    const std::size_t pixels = luma.size();
+    std::vector<unsigned> samples((pixels + 5) / 6 * 12);
+    for (std::size_t x = 0; x < pixels; ++x)
+    {
+        samples[x / 6 * 12 + x % 6 * 2 + 1] = luma[x];
+        if (x % 2 == 0)
+        {
+            samples[x / 6 * 12 + x % 6 * 2] = chroma[x];
+            samples[x / 6 * 12 + x % 6 * 2 + 2] = chroma[x + 1];
+        }
+    }
+    for (std::size_t word = 0; word < samples.size() / 3; ++word)
+    {
+        const std::uint32_t value = samples[word * 3] | (samples[word * 3 + 1] << 10) | (samples[word * 3 + 2] << 20);
+        for (int b = 0; b < 4; ++b)
+        {
+            row[word * 4 + b] = static_cast<std::uint8_t>(value >> (8 * b));
+        }
+    }
+    return row;
+}
+
+std::vector<unsigned> samples10(std::size_t count, std::uint32_t seed)
+{
+    std::vector<unsigned> values(count);
+    for (auto& value : values)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = seed >> 22;
+    }
+    return values;
+}
+
+void testV210()
+{
+    const V210RowFn scalar = v210Kernel(ConversionTier::Scalar);
+    CHECK(scalar != nullptr);
+    for (const ColorMatrix matrix : kMatrices)
+    {
+        for (const bool fullRange : {false, true})
+        {
+            const YuvCoefficients coefficients = yuvCoefficients(matrix, fullRange);
+            for (const std::size_t pixels : kRowLengths)
+            {
+                const std::size_t even = (pixels + 1) / 2 * 2;
+                const std::vector<unsigned> luma = samples10(even, static_cast<std::uint32_t>(pixels * 3 + 1));
+                const std::vector<unsigned> chroma = samples10(even, static_cast<std::uint32_t>(pixels * 5 + 2));
+                // Whole blocks, as the kernels may read the last one in full.
+                const std::vector<std::uint8_t> source = packV210(luma, chroma, (pixels + 5) / 6 * 16);
+
+                OutputRow expected(pixels);
+                scalar(expected.data(), source.data(), pixels, coefficients);
+                bool accurate = expected.intact();
+                for (std::size_t x = 0; x < pixels; ++x)
+                {
+                    int bgr[3];
+                    referenceBgr(luma[x] / 4.0, chroma[x / 2 * 2] / 4.0, chroma[x / 2 * 2 + 1] / 4.0, matrix, fullRange, bgr);
+                    accurate &= nearReference(expected.data() + x * 4, bgr);
+                }
+                if (!CHECK(accurate))
+                {
+                    std::fprintf(stderr, "  v210 scalar, %zu pixels\n", pixels);
+                }
+
+                for (const ConversionTier tier : kTiers)
+                {
+                    const V210RowFn kernel = v210Kernel(tier);
+                    if (!kernel || tier == ConversionTier::Scalar)
+                    {
+                        continue;
+                    }
+                    OutputRow actual(pixels);
+                    kernel(actual.data(), source.data(), pixels, coefficients);
+                    if (!CHECK(actual.bytes == expected.bytes))
+                    {
+                        std::fprintf(stderr, "  v210 %s, %zu pixels\n", conversionTierName(tier), pixels);
+                    }
+                }
+
+                // A span starting inside a block, as a dirty rectangle at a
+                // 64-pixel tile edge does, gives the same pixels.
+                for (std::size_t skip = 1; skip < 6 && skip < pixels; ++skip)
+                {
+                    OutputRow tail(pixels - skip);
+                    convertV210RowToBgra(tail.data(), source.data(), skip, pixels - skip, coefficients);
+                    if (!CHECK(tail.intact() && std::equal(tail.bytes.begin(), tail.bytes.begin() + static_cast<std::ptrdiff_t>((pixels - skip) * 4),
+                                                           expected.bytes.begin() + static_cast<std::ptrdiff_t>(skip * 4))))
+                    {
+                        std::fprintf(stderr, "  v210 skipping %zu of %zu pixels\n", skip, pixels);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// 100% colour bars in BT.709 limited-range code values, as a capture card
+// would send them.
+struct Bar {
+    std::uint8_t y, cb, cr;
+    std::uint8_t b, g, r;
+};
+constexpr Bar kBars[] = {
+    {235, 128, 128, 255, 255, 255}, // white
+    {219, 16, 138, 0, 255, 255},    // yellow
+    {188, 154, 16, 255, 255, 0},    // cyan
+    {173, 42, 26, 0, 255, 0},       // green
+    {78, 214, 230, 255, 0, 255},    // magenta
+    {63, 102, 240, 0, 0, 255},      // red
+    {32, 240, 118, 255, 0, 0},      // blue
+    {16, 128, 128, 0, 0, 0},        // black
+};
+
+// The bars through the whole frame path. The expected BGRA is the nominal
+// colour of each bar.
+void testSemiPlanarGoldenBars()
+{
+    constexpr std::uint32_t kBarWidth = 10;
+    constexpr std::uint32_t kWidth = kBarWidth * 8;
+    constexpr std::uint32_t kHeight = 6;
+
+    for (const PixelFormat format : {PixelFormat::NV12, PixelFormat::P010})
+    {
+        const bool tenBit = format == PixelFormat::P010;
+        const std::size_t sampleBytes = tenBit ? 2 : 1;
+        const std::uint32_t stride = static_cast<std::uint32_t>(kWidth * sampleBytes + 16);
+        std::vector<std::uint8_t> bytes(static_cast<std::size_t>(stride) * (kHeight + kHeight / 2));
+        const auto put = [&](std::size_t offset, std::uint8_t value) {
+            if (tenBit)
+            {
+                const unsigned sample = static_cast<unsigned>(value) << 8; // 10-bit value * 4, MSB-aligned
+                bytes[offset * 2] = static_cast<std::uint8_t>(sample);
+                bytes[offset * 2 + 1] = static_cast<std::uint8_t>(sample >> 8);
+            }
+            else
+            {
+                bytes[offset] = value;
+            }
+        };
+        for (std::uint32_t y = 0; y < kHeight; ++y)
+        {
+            for (std::uint32_t x = 0; x < kWidth; ++x)
+            {
+                const Bar& bar = kBars[x / kBarWidth];
+                put(static_cast<std::size_t>(y) * stride / sampleBytes + x, bar.y);
+                if (y % 2 == 0 && x % 2 == 0)
+                {
+                    const std::size_t chroma = (static_cast<std::size_t>(kHeight) + y / 2) * stride / sampleBytes + x;
+                    put(chroma, bar.cb);
+                    put(chroma + 1, bar.cr);
+                }
+            }
+        }
+
+        DirectShowCapture::Frame frame{};
+        frame.format = format;
+        frame.matrix = ColorMatrix::BT709;
+        frame.width = kWidth;
+        frame.height = kHeight;
+        frame.stride = stride;
+        frame.data = bytes.data();
+        frame.dataSize = bytes.size();
+
+        FramePool pool;
+        MemoryFrameSink sink(pool);
+        CHECK(writeFrameToSink(frame, sink).accepted);
+        const CpuFrame* written = sink.acquireLatest();
+        bool matches = written != nullptr;
+        for (std::uint32_t y = 0; matches && y < kHeight; ++y)
+        {
+            for (std::uint32_t x = 0; x < kWidth; ++x)
+            {
+                const Bar& bar = kBars[x / kBarWidth];
+                const std::uint8_t* pixel = written->data.data() + static_cast<std::size_t>(y) * written->stride + x * 4;
+                matches &= std::abs(pixel[0] - bar.b) <= 2 && std::abs(pixel[1] - bar.g) <= 2 && std::abs(pixel[2] - bar.r) <= 2 &&
+                           pixel[3] == 255;
+            }
+        }
+        if (!CHECK(matches))
+        {
+            std::fprintf(stderr, "  %s colour bars\n", tenBit ? "P010" : "NV12");
+        }
+    }
+}
+
+// The bars as v210: 10-bit values, rows padded to 128 bytes and a tile edge
+// (x = 64) in the middle of a block. Tracked writes that only redo the
+// changed tiles must leave the same frame as whole ones.
+void testV210GoldenBars()
+{
+    constexpr std::uint32_t kBarWidth = 16;
+    constexpr std::uint32_t kWidth = kBarWidth * 8;
+    constexpr std::uint32_t kHeight = 70;
+    constexpr std::uint32_t kStride = (kWidth + 47) / 48 * 128;
+
+    const auto makeFrame = [&](std::uint32_t shift) {
+        std::vector<std::uint8_t> bytes(static_cast<std::size_t>(kStride) * kHeight);
+        for (std::uint32_t y = 0; y < kHeight; ++y)
+        {
+            std::vector<unsigned> luma(kWidth);
+            std::vector<unsigned> chroma(kWidth);
+            for (std::uint32_t x = 0; x < kWidth; ++x)
+            {
+                // Only the bottom right tile changes.
+                const std::uint32_t bar = (x / kBarWidth + (x >= 64 && y >= 64 ? shift : 0)) % 8;
+                luma[x] = kBars[bar].y * 4u;
+                chroma[x] = (x % 2 == 0 ? kBars[bar].cb : kBars[bar].cr) * 4u;
+            }
+            const std::vector<std::uint8_t> row = packV210(luma, chroma, kStride);
+            std::copy(row.begin(), row.end(), bytes.begin() + static_cast<std::ptrdiff_t>(y) * kStride);
+        }
+        return bytes;
+    };
+
+    std::vector<std::uint8_t> bytes = makeFrame(0);
+    DirectShowCapture::Frame frame{};
+    frame.format = PixelFormat::V210;
+    frame.matrix = ColorMatrix::BT709;
+    frame.width = kWidth;
+    frame.height = kHeight;
+    frame.stride = kStride;
+    frame.data = bytes.data();
+    frame.dataSize = bytes.size();
+
+    FramePool pool;
+    MemoryFrameSink sink(pool);
+    MemoryFrameSink reference(pool);
+    DirtyTracker tracker;
+    for (std::uint32_t shift = 0; shift < 6; ++shift)
+    {
+        bytes = makeFrame(shift);
+        frame.data = bytes.data();
+        FrameWriteOptions options;
+        options.tracker = &tracker;
+        options.sequence = tracker.analyze(frame);
+        CHECK(writeFrameToSink(frame, sink, options).accepted);
+        CHECK(writeFrameToSink(frame, reference).accepted);
+        if (shift > 0)
+        {
+            // The block holding x = 60..65 is hashed into both tiles it touches.
+            CHECK(tracker.lastDirtyTiles() == 2);
+        }
+
+        const CpuFrame* written = sink.acquireLatest();
+        const CpuFrame* whole = reference.acquireLatest();
+        bool matches = written != nullptr && whole != nullptr;
+        for (std::uint32_t y = 0; matches && y < kHeight; ++y)
+        {
+            const std::uint8_t* row = written->data.data() + static_cast<std::size_t>(y) * written->stride;
+            matches &= std::equal(row, row + kWidth * 4, whole->data.data() + static_cast<std::size_t>(y) * whole->stride);
+            for (std::uint32_t x = 0; x < kWidth; ++x)
+            {
+                const Bar& bar = kBars[(x / kBarWidth + (x >= 64 && y >= 64 ? shift : 0)) % 8];
+                const std::uint8_t* pixel = row + x * 4;
+                matches &= std::abs(pixel[0] - bar.b) <= 2 && std::abs(pixel[1] - bar.g) <= 2 && std::abs(pixel[2] - bar.r) <= 2 &&
+                           pixel[3] == 255;
+            }
+        }
+        if (!CHECK(matches))
+        {
+            std::fprintf(stderr, "  v210 colour bars, frame %u\n", shift);
+        }
+    }
+}
+
+void testTierSelection()
+{
+    const ConversionTier original = activeConversionTier();
+    for (const ConversionTier tier : kTiers)
+    {
+        const bool runnable = packed422Kernel(PixelFormat::YUY2, tier) != nullptr;
+        CHECK(setActiveConversionTier(tier) == runnable);
+        if (runnable)
+        {
+            CHECK(activeConversionTier() == tier);
+        }
+    }
+    CHECK(setActiveConversionTier(original));
+}
+
+} // namespace
+
+int main()
+{
+    testPacked422();
+    testSemiPlanar();
+    testPackedRgb();
+    testV210();
+    testSemiPlanarGoldenBars();
+    testV210GoldenBars();
+    testTierSelection();
+    return testExitCode();
+}
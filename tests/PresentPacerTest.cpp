@@ -0,0 +1,281 @@
+#include "PresentPacer.hpp"
+#include "TestSupport.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+
+namespace {
+
+constexpr double kRefresh60 = 1.0e9 / 60.0;
+constexpr double kSource5994 = 1001.0e6 / 60.0;
+
+// Deterministic approximately normal noise: a sum of twelve uniforms.
+class Jitter {
+public:
+    explicit Jitter(double sigmaNs, std::uint32_t seed = 1) : sigma_(sigmaNs), seed_(seed) {}
+
+    double next()
+    {
+        double sum = -6.0;
+        for (int i = 0; i < 12; ++i)
+        {
+            seed_ = seed_ * 1664525u + 1013904223u;
+            sum += static_cast<double>(seed_ >> 8) / static_cast<double>(1u << 24);
+        }
+        return sum * sigma_;
+    }
+
+private:
+    double sigma_;
+    std::uint32_t seed_;
+};
+
+constexpr std::uint64_t kStartNs = 1'000'000'000;
+
+std::uint64_t at(double timeNs)
+{
+    return kStartNs + static_cast<std::uint64_t>(std::llround(timeNs));
+}
+
+void testLocksOnCleanCadence()
+{
+    CadenceTracker tracker;
+    for (std::int64_t i = 0; i < CadenceTracker::kLockEvents; ++i)
+    {
+        CHECK(!tracker.locked());
+        tracker.observe(i, at(kRefresh60 * static_cast<double>(i)));
+    }
+    CHECK(tracker.locked());
+    CHECK(std::abs(tracker.periodNs() - kRefresh60) < 1.0);
+    CHECK(tracker.jitterNs() < 1.0);
+    CHECK(std::abs(tracker.timeOf(100) - static_cast<double>(at(kRefresh60 * 100.0))) < 100.0);
+    CHECK(tracker.firstIndexAtOrAfter(static_cast<double>(at(kRefresh60 * 20.5))) == 21);
+
+    // Indices that do not increase are ignored.
+    tracker.observe(3, at(0.0));
+    CHECK(tracker.lastIndex() == CadenceTracker::kLockEvents - 1);
+}
+
+// Gaussian arrival jitter averages out of the period and phase, and its
+// spread is what jitterNs() reports.
+void testJitterAveragesOut()
+{
+    constexpr double kSigma = 500'000.0;
+    Jitter jitter(kSigma);
+    CadenceTracker tracker;
+    double worstPhase = 0.0;
+    for (std::int64_t i = 0; i < 3000; ++i)
+    {
+        const double ideal = kSource5994 * static_cast<double>(i);
+        tracker.observe(i, at(ideal + jitter.next()));
+        if (i > 600)
+        {
+            worstPhase = std::max(worstPhase, std::abs(tracker.timeOf(i) - static_cast<double>(at(ideal))));
+        }
+    }
+    CHECK(std::abs(tracker.periodNs() - kSource5994) < 20'000.0);
+    // The smoothed time line sits far closer to the ideal one than any event.
+    if (!CHECK(worstPhase < kSigma))
+    {
+        std::fprintf(stderr, "  phase error %.0f ns\n", worstPhase);
+    }
+    CHECK(tracker.jitterNs() > 0.8 * kSigma && tracker.jitterNs() < 1.2 * kSigma);
+}
+
+// A source clock drifting 100 ppm over the trace stays tracked: the period
+// follows it and events keep landing close to their prediction.
+void testFollowsDrift()
+{
+    constexpr int kEvents = 6000;
+    constexpr double kDrift = 100e-6;
+    Jitter jitter(100'000.0, 7);
+    CadenceTracker tracker;
+    double time = 0.0;
+    double worstPrediction = 0.0;
+    double period = kRefresh60;
+    for (std::int64_t i = 0; i < kEvents; ++i)
+    {
+        period = kRefresh60 * (1.0 + kDrift * static_cast<double>(i) / kEvents);
+        const double arrival = time + jitter.next();
+        if (tracker.locked())
+        {
+            worstPrediction = std::max(worstPrediction, std::abs(tracker.timeOf(i) - static_cast<double>(at(arrival))));
+        }
+        tracker.observe(i, at(arrival));
+        time += period;
+    }
+    CHECK(std::abs(tracker.periodNs() - period) < 5'000.0);
+    if (!CHECK(worstPrediction < 1'000'000.0))
+    {
+        std::fprintf(stderr, "  prediction error %.0f ns\n", worstPrediction);
+    }
+}
+
+// Missed events are gaps in the index, a lone late event is ignored, and a
+// changed rate restarts the loop after kMaxOutliers.
+void testGapsOutliersAndModeChanges()
+{
+    CadenceTracker tracker;
+    for (std::int64_t i = 0; i < 40; ++i)
+    {
+        if (i % 5 != 3)
+        {
+            tracker.observe(i, at(kRefresh60 * static_cast<double>(i)));
+        }
+    }
+    CHECK(tracker.locked());
+    CHECK(std::abs(tracker.periodNs() - kRefresh60) < 1.0);
+
+    tracker.observe(40, at(kRefresh60 * 40.0 + 0.45 * kRefresh60));
+    CHECK(tracker.lastIndex() == 39);
+    CHECK(std::abs(tracker.periodNs() - kRefresh60) < 1.0);
+
+    const double base = kRefresh60 * 40.0;
+    constexpr double kRefresh50 = 1.0e9 / 50.0;
+    for (std::int64_t i = 40; i < 80; ++i)
+    {
+        tracker.observe(i, at(base + kRefresh50 * static_cast<double>(i - 40)));
+    }
+    CHECK(tracker.locked());
+    CHECK(std::abs(tracker.periodNs() - kRefresh50) < 10.0);
+}
+
+struct PacingResult {
+    std::uint64_t shown = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t repeated = 0;
+    // The source cadence unlocked after first locking.
+    bool lostLock = false;
+};
+
+// Drives a PresentPacer the way the render loop does, against a simulated
+// flip-model swap chain with one frame of latency: a present takes a
+// millisecond to render, shows on the next vblank after that, and the next
+// present waits until it is on screen. Frame statistics name the newest
+// present on screen. Frames arrive with Gaussian jitter and are presented
+// once each, when presentNotBefore() allows, unless a newer frame replaces
+// them first. Frames from `staticFrom` up to `staticTo` repeat the one before,
+// so like the capture path they are observed but not delivered.
+PacingResult simulatePacing(double sourcePeriod, double refreshPeriod, double jitterNs, int frames, int staticFrom = 0, int staticTo = 0)
+{
+    constexpr double kStep = 50'000.0;
+    constexpr double kRender = 1'000'000.0;
+
+    PresentPacer pacer;
+    Jitter jitter(jitterNs, 3);
+    struct Queued {
+        std::uint32_t id;
+        double readyNs;
+    };
+    std::deque<Queued> queue;
+    std::uint32_t nextPresentId = 1;
+    std::uint32_t shownId = 0;
+    std::uint64_t shownRefresh = 0;
+    std::uint64_t lastVBlank = 0;
+    int arrived = 0;
+    double nextArrival = sourcePeriod + jitter.next();
+    bool framePending = false;
+    bool locked = false;
+    bool lostLock = false;
+
+    const double end = sourcePeriod * (frames + 2);
+    for (double now = 0.0; now < end; now += kStep)
+    {
+        const auto vblank = static_cast<std::uint64_t>(now / refreshPeriod);
+        for (; lastVBlank < vblank; ++lastVBlank)
+        {
+            const double vblankTime = refreshPeriod * static_cast<double>(lastVBlank + 1);
+            if (!queue.empty() && queue.front().readyNs <= vblankTime)
+            {
+                shownId = queue.front().id;
+                shownRefresh = lastVBlank + 1;
+                queue.pop_front();
+            }
+            pacer.observeDisplay(shownId, shownRefresh, lastVBlank + 1, at(vblankTime));
+        }
+
+        if (arrived < frames && now >= nextArrival)
+        {
+            ++arrived;
+            pacer.observeFrame(static_cast<std::uint64_t>(sourcePeriod * arrived / 100.0), at(now));
+            if (arrived <= staticFrom || arrived > staticTo)
+            {
+                pacer.frameDelivered();
+                framePending = true;
+            }
+            nextArrival = sourcePeriod * (arrived + 1) + jitter.next();
+            locked = locked || pacer.sourceLocked();
+            lostLock = lostLock || (locked && !pacer.sourceLocked());
+        }
+
+        if (framePending && queue.empty() && pacer.presentNotBefore(at(now)) == 0)
+        {
+            const std::uint32_t id = nextPresentId++;
+            pacer.presented(id);
+            queue.push_back({id, now + kRender});
+            framePending = false;
+        }
+    }
+    return {pacer.framesShown(), pacer.framesDropped(), pacer.framesRepeated(), lostLock};
+}
+
+bool expectPacing(const char* name, const PacingResult& result, std::uint64_t minShown, std::uint64_t maxDropped,
+                  std::uint64_t minRepeated, std::uint64_t maxRepeated)
+{
+    const bool passed = result.shown >= minShown && result.dropped <= maxDropped && result.repeated >= minRepeated &&
+                        result.repeated <= maxRepeated && !result.lostLock;
+    if (!CHECK(passed))
+    {
+        std::fprintf(stderr, "  %s: %llu shown, %llu dropped, %llu repeated%s\n", name, static_cast<unsigned long long>(result.shown),
+                     static_cast<unsigned long long>(result.dropped), static_cast<unsigned long long>(result.repeated),
+                     result.lostLock ? ", lost lock" : "");
+    }
+    return passed;
+}
+
+// With matching rates and realistic jitter every frame is shown once.
+void testPacingAtMatchingRates()
+{
+    expectPacing("60 on 60", simulatePacing(kRefresh60, kRefresh60, 300'000.0, 1200), 1200, 0, 0, 0);
+}
+
+// 59.94 Hz on 60 Hz slips one refresh every 1001 frames: over 2500 frames
+// that is two or three repeats and no drops, not a burst around each slip,
+// however much the arrivals jitter. The other way round each slip drops one
+// frame and repeats none.
+void testPacingAcrossDrift()
+{
+    for (const double jitterNs : {0.0, 300'000.0, 600'000.0})
+    {
+        expectPacing("59.94 on 60", simulatePacing(kSource5994, kRefresh60, jitterNs, 2500), 2500, 0, 2, 3);
+        expectPacing("60 on 59.94", simulatePacing(kRefresh60, kSource5994, jitterNs, 2500), 2496, 3, 0, 0);
+    }
+}
+
+// A static desktop: five seconds of repeats that are never presented keep
+// the cadence locked, and none of them count as dropped, so the first
+// change afterwards is paced like any other frame.
+void testPacingThroughStaticScreen()
+{
+    for (const double jitterNs : {0.0, 300'000.0})
+    {
+        expectPacing("60 on 60, static", simulatePacing(kRefresh60, kRefresh60, jitterNs, 1200, 300, 600), 900, 0, 0, 0);
+        expectPacing("59.94 on 60, static", simulatePacing(kSource5994, kRefresh60, jitterNs, 1200, 300, 600), 900, 0, 0, 2);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testLocksOnCleanCadence();
+    testJitterAveragesOut();
+    testFollowsDrift();
+    testGapsOutliersAndModeChanges();
+    testPacingAtMatchingRates();
+    testPacingAcrossDrift();
+    testPacingThroughStaticScreen();
+    return testExitCode();
+}
@@ -0,0 +1,317 @@
+#include "FileReplayCapture.hpp"
+#include "MjpegDecoder.hpp"
+#include "ReferenceRenderer.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Image {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::uint8_t> pixels;
+
+    Image(std::uint32_t w, std::uint32_t h) : width(w), height(h), pixels(static_cast<std::size_t>(w) * 4 * h, 0xFF) {}
+
+    [[nodiscard]] DirectShowCapture::Frame frame() const
+    {
+        DirectShowCapture::Frame frame{};
+        frame.width = width;
+        frame.height = height;
+        frame.stride = width * 4;
+        frame.data = pixels.data();
+        frame.dataSize = pixels.size();
+        return frame;
+    }
+
+    std::uint8_t* at(std::uint32_t x, std::uint32_t y) { return pixels.data() + (static_cast<std::size_t>(y) * width + x) * 4; }
+};
+
+const std::uint8_t* pixelAt(const ReferenceRenderer& renderer, std::uint32_t x, std::uint32_t y)
+{
+    return renderer.pixels() + static_cast<std::size_t>(y) * renderer.stride() + static_cast<std::size_t>(x) * 4;
+}
+
+bool isBlack(const std::uint8_t* pixel)
+{
+    return pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0 && pixel[3] == 255;
+}
+
+// The first frame a capture source delivers, copied out.
+struct CapturedFrame {
+    DirectShowCapture::Frame frame{};
+    std::vector<std::uint8_t> bytes;
+};
+
+CapturedFrame firstFrame(CaptureSource& source)
+{
+    CapturedFrame captured;
+    std::atomic<bool> done{false};
+    source.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            if (!done.load(std::memory_order_acquire))
+            {
+                captured.bytes.assign(frame.data, frame.data + frame.dataSize);
+                captured.frame = frame;
+                captured.frame.data = captured.bytes.data();
+                done.store(true, std::memory_order_release);
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!done.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    source.stop();
+    return captured;
+}
+
+// Same size reproduces the texture; a 0/255 pair of texels stretched to four
+// pixels samples at 0.25 and 0.75 of the way across.
+void testCompositeGolden()
+{
+    Image texture(7, 5);
+    for (std::size_t i = 0; i < texture.pixels.size(); ++i)
+    {
+        texture.pixels[i] = static_cast<std::uint8_t>(i * 37 + 11);
+    }
+    std::vector<std::uint8_t> target(7 * 5 * 4);
+    compositeTexture(target.data(), 7 * 4, 7, 5, ViewportRect{0, 0, 7, 5}, texture.pixels.data(), 7 * 4, 7, 5);
+    CHECK(target == texture.pixels);
+
+    Image ramp(2, 1);
+    std::fill(ramp.at(0, 0), ramp.at(0, 0) + 3, std::uint8_t{0});
+    std::fill(ramp.at(1, 0), ramp.at(1, 0) + 3, std::uint8_t{255});
+    std::vector<std::uint8_t> stretched(6 * 3 * 4);
+    compositeTexture(stretched.data(), 6 * 4, 6, 3, ViewportRect{1, 1, 5, 2}, ramp.pixels.data(), 2 * 4, 2, 1);
+    const int expected[6] = {0, 0, 64, 191, 255, 0};
+    bool matches = true;
+    for (std::uint32_t y = 0; y < 3; ++y)
+    {
+        for (std::uint32_t x = 0; x < 6; ++x)
+        {
+            const std::uint8_t* pixel = stretched.data() + (static_cast<std::size_t>(y) * 6 + x) * 4;
+            const int value = y == 1 ? expected[x] : 0;
+            matches &= pixel[0] == value && pixel[1] == value && pixel[2] == value && pixel[3] == 255;
+        }
+    }
+    CHECK(matches);
+}
+
+// Letterbox and pillarbox bars are opaque black and the video is exact where
+// the texture is flat, in every aspect mode.
+void testViewportsAndBars()
+{
+    Image grey(1280, 720);
+    for (std::size_t i = 0; i < grey.pixels.size(); ++i)
+    {
+        grey.pixels[i] = i % 4 == 3 ? 255 : 90;
+    }
+
+    struct Case {
+        VideoAspectMode mode;
+        std::uint32_t clientWidth;
+        std::uint32_t clientHeight;
+        ViewportRect viewport;
+    };
+    const Case cases[] = {
+        {VideoAspectMode::Maintain, 1000, 1000, {0, 218, 1000, 781}},
+        {VideoAspectMode::Maintain, 1920, 720, {320, 0, 1600, 720}},
+        {VideoAspectMode::Stretch, 1000, 1000, {0, 0, 1000, 1000}},
+        {VideoAspectMode::Capture, 1600, 1000, {160, 140, 1440, 860}},
+    };
+    ReferenceRenderer renderer;
+    for (const Case& c : cases)
+    {
+        ReferenceRenderOptions options;
+        options.aspectMode = c.mode;
+        CHECK(renderer.render(grey.frame(), c.clientWidth, c.clientHeight, options));
+        const ViewportRect& viewport = renderer.viewport();
+        if (!CHECK(viewport.left == c.viewport.left && viewport.top == c.viewport.top && viewport.right == c.viewport.right &&
+                   viewport.bottom == c.viewport.bottom))
+        {
+            std::fprintf(stderr, "  viewport {%d, %d, %d, %d}\n", viewport.left, viewport.top, viewport.right, viewport.bottom);
+        }
+        bool matches = renderer.width() == c.clientWidth && renderer.height() == c.clientHeight;
+        for (std::uint32_t y = 0; matches && y < c.clientHeight; ++y)
+        {
+            for (std::uint32_t x = 0; x < c.clientWidth; ++x)
+            {
+                const std::uint8_t* pixel = pixelAt(renderer, x, y);
+                const bool inside = static_cast<std::int32_t>(x) >= viewport.left && static_cast<std::int32_t>(x) < viewport.right &&
+                                    static_cast<std::int32_t>(y) >= viewport.top && static_cast<std::int32_t>(y) < viewport.bottom;
+                matches &= inside ? (pixel[0] == 90 && pixel[1] == 90 && pixel[2] == 90 && pixel[3] == 255) : isBlack(pixel);
+            }
+        }
+        CHECK(matches);
+    }
+}
+
+// Nearest snaps the viewport to whole multiples, so every texel of a
+// checkerboard becomes an exact block.
+void testNearestBlocks()
+{
+    Image checker(4, 4);
+    for (std::uint32_t y = 0; y < 4; ++y)
+    {
+        for (std::uint32_t x = 0; x < 4; ++x)
+        {
+            std::fill(checker.at(x, y), checker.at(x, y) + 3, static_cast<std::uint8_t>((x + y) % 2 ? 200 : 30));
+        }
+    }
+    ReferenceRenderer renderer;
+    ReferenceRenderOptions options;
+    options.aspectMode = VideoAspectMode::Stretch;
+    options.filter = ScalingFilter::Nearest;
+    CHECK(renderer.render(checker.frame(), 17, 13, options));
+    const ViewportRect& viewport = renderer.viewport();
+    CHECK(viewport.width() == 16 && viewport.height() == 12);
+    bool blocks = true;
+    for (std::int32_t y = viewport.top; y < viewport.bottom; ++y)
+    {
+        for (std::int32_t x = viewport.left; x < viewport.right; ++x)
+        {
+            const int texel = ((x - viewport.left) / 4 + (y - viewport.top) / 3) % 2 ? 200 : 30;
+            blocks &= pixelAt(renderer, static_cast<std::uint32_t>(x), static_cast<std::uint32_t>(y))[1] == texel;
+        }
+    }
+    CHECK(blocks);
+}
+
+// A 1080p test pattern in a 960x540 window: downscaled, the texture is the
+// 2x2 box average and lands pixel for pixel; without downscaling the sampler
+// blends the same four texels. Both are within a step of the exact average.
+void testDownscaledPattern()
+{
+    TestPatternCapture::Config config;
+    config.width = 1920;
+    config.height = 1080;
+    config.bottomUp = true;
+    config.motion = TestPatternCapture::Motion::Noise;
+    config.paced = false;
+    TestPatternCapture capture(config);
+    const CapturedFrame captured = firstFrame(capture);
+    CHECK(!captured.bytes.empty());
+    if (captured.bytes.empty())
+    {
+        return;
+    }
+    const DirectShowCapture::Frame& frame = captured.frame;
+
+    ReferenceRenderer downscaled;
+    ReferenceRenderer sampled;
+    ReferenceRenderOptions options;
+    CHECK(downscaled.render(frame, 960, 540, options));
+    CHECK(downscaled.textureWidth() == 960 && downscaled.textureHeight() == 540);
+    options.downscale = false;
+    CHECK(sampled.render(frame, 960, 540, options));
+    CHECK(sampled.textureWidth() == 1920 && sampled.textureHeight() == 1080);
+
+    int worstDownscaled = 0;
+    int worstSampled = 0;
+    for (std::uint32_t y = 0; y < 540; ++y)
+    {
+        for (std::uint32_t x = 0; x < 960; ++x)
+        {
+            for (std::uint32_t channel = 0; channel < 3; ++channel)
+            {
+                int sum = 0;
+                for (std::uint32_t dy = 0; dy < 2; ++dy)
+                {
+                    // Bottom-up rows: source row r is stored at height - 1 - r.
+                    const std::size_t row = 1079 - (y * 2 + dy);
+                    for (std::uint32_t dx = 0; dx < 2; ++dx)
+                    {
+                        sum += frame.data[row * frame.stride + (x * 2 + dx) * 4 + channel];
+                    }
+                }
+                const double average = sum / 4.0;
+                worstDownscaled = std::max(worstDownscaled, static_cast<int>(std::ceil(std::abs(pixelAt(downscaled, x, y)[channel] - average))));
+                worstSampled = std::max(worstSampled, static_cast<int>(std::ceil(std::abs(pixelAt(sampled, x, y)[channel] - average))));
+            }
+        }
+    }
+    if (!CHECK(worstDownscaled <= 1 && worstSampled <= 1))
+    {
+        std::fprintf(stderr, "  off by %d downscaled, %d sampled\n", worstDownscaled, worstSampled);
+    }
+}
+
+// An MJPEG recording replayed and decoded as the window would get it, shown
+// at twice its size. The picture is smooth gradients under a checkerboard,
+// so bilinear upscaling stays close to the picture evaluated at each pixel's
+// texel coordinate.
+void testReplayedRecording()
+{
+    FileReplayCapture::Config config;
+    config.path = std::string(PCKVM_TEST_DATA_DIR) + "/yuv422_restart.mjpeg";
+    config.loop = false;
+    config.paced = false;
+    FileReplayCapture capture(config);
+    const CapturedFrame captured = firstFrame(capture);
+
+    FramePool pool;
+    MjpegDecoder decoder(pool);
+    DirectShowCapture::Frame picture{};
+    CHECK(!captured.bytes.empty() && decoder.decode(captured.frame, picture) == MjpegDecoder::Result::Decoded);
+    if (picture.width != 160 || picture.height != 120)
+    {
+        CHECK(false);
+        return;
+    }
+
+    ReferenceRenderer renderer;
+    CHECK(renderer.render(picture, 320, 240));
+    CHECK(renderer.viewport().width() == 320 && renderer.viewport().height() == 240);
+    double squaredError = 0.0;
+    for (std::uint32_t y = 0; y < 240; ++y)
+    {
+        for (std::uint32_t x = 0; x < 320; ++x)
+        {
+            const double u = std::clamp((x + 0.5) / 2.0 - 0.5, 0.0, 159.0);
+            const double v = std::clamp((y + 0.5) / 2.0 - 0.5, 0.0, 119.0);
+            const auto nearestX = static_cast<std::uint32_t>(std::lround(u));
+            const auto nearestY = static_cast<std::uint32_t>(std::lround(v));
+            const double expected[3] = {
+                (((nearestX / 20) + nearestY / 20) % 2 != 0) ? 190.0 : 60.0,
+                v * 255.0 / 119.0,
+                u * 255.0 / 159.0,
+            };
+            const std::uint8_t* pixel = pixelAt(renderer, x, y);
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                const double error = pixel[channel] - expected[channel];
+                squaredError += error * error;
+            }
+        }
+    }
+    const double psnr = 10.0 * std::log10(255.0 * 255.0 / (squaredError / (320.0 * 240.0 * 3.0)));
+    if (!CHECK(psnr > 30.0))
+    {
+        std::fprintf(stderr, "  PSNR %.1f dB\n", psnr);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testCompositeGolden();
+    testViewportsAndBars();
+    testNearestBlocks();
+    testDownscaledPattern();
+    testReplayedRecording();
+    return testExitCode();
+}
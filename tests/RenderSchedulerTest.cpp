@@ -0,0 +1,299 @@
+#include "LatencyStats.hpp"
+#include "RenderScheduler.hpp"
+#include "TestSupport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Hands out scripted wakes in order and records what each wait asked for.
+// An empty script times out, as a real wait would.
+class ScriptedWaitSet : public RenderWaitSet {
+public:
+    struct Call {
+        unsigned sources;
+        std::uint64_t timeoutNs;
+    };
+
+    void push(unsigned wakes) { script_.push_back(wakes); }
+
+    unsigned wait(unsigned sources, std::uint64_t timeoutNs) override
+    {
+        calls.push_back({sources, timeoutNs});
+        if (script_.empty())
+        {
+            return 0;
+        }
+        const unsigned wakes = script_.front() & sources;
+        script_.pop_front();
+        return wakes;
+    }
+
+    std::vector<Call> calls;
+
+private:
+    std::deque<unsigned> script_;
+};
+
+// Nothing to do: the loop sleeps on frames, messages and redraws only, with
+// no timeout, so an idle window never wakes on its own.
+void testIdleWaitsForever()
+{
+    RenderScheduler scheduler;
+    CHECK(!scheduler.hasWork());
+    CHECK(scheduler.waitSources() == (kWakeFrame | kWakeMessage | kWakeOverlay));
+
+    ScriptedWaitSet waitSet;
+    waitSet.push(kWakeFrame);
+    CHECK(scheduler.waitForWork(waitSet) == kWakeFrame);
+    CHECK(waitSet.calls.size() == 1);
+    CHECK(waitSet.calls[0].sources == (kWakeFrame | kWakeMessage | kWakeOverlay));
+    CHECK(waitSet.calls[0].timeoutNs == kWaitForever);
+    CHECK(scheduler.shouldRender());
+}
+
+// Frames arriving while the swap chain is busy are coalesced into one render
+// that happens the moment the swap chain signals.
+void testFramesCoalesceUntilSwapChainReady()
+{
+    RenderScheduler scheduler;
+    scheduler.notify(kWakeFrame);
+    scheduler.rendered(true);
+    CHECK(!scheduler.hasWork());
+    // Idle again: the swap chain is not waited on without work.
+    CHECK((scheduler.waitSources() & kWakeSwapChain) == 0);
+
+    ScriptedWaitSet waitSet;
+    waitSet.push(kWakeFrame);
+    waitSet.push(kWakeFrame);
+    waitSet.push(kWakeFrame);
+    waitSet.push(kWakeSwapChain);
+    const unsigned seen = scheduler.waitForWork(waitSet);
+    CHECK(seen == (kWakeFrame | kWakeSwapChain));
+    CHECK(waitSet.calls.size() == 4);
+    CHECK(waitSet.calls[0].timeoutNs == kWaitForever);
+    for (std::size_t i = 1; i < waitSet.calls.size(); ++i)
+    {
+        CHECK((waitSet.calls[i].sources & kWakeSwapChain) != 0);
+        CHECK(waitSet.calls[i].timeoutNs == RenderScheduler::kSwapChainTimeoutNs);
+    }
+    CHECK(scheduler.shouldRender());
+    scheduler.rendered(true);
+    CHECK(!scheduler.framePending());
+}
+
+// A message ends the wait even with work blocked on the swap chain, and is
+// polled without blocking when there is already something to render.
+void testMessagesAreNeverStarved()
+{
+    RenderScheduler scheduler;
+    scheduler.notify(kWakeFrame);
+    scheduler.rendered(true);
+    scheduler.notify(kWakeFrame);
+    CHECK(!scheduler.shouldRender());
+
+    ScriptedWaitSet blocked;
+    blocked.push(kWakeMessage);
+    CHECK(scheduler.waitForWork(blocked) == kWakeMessage);
+    CHECK(blocked.calls.size() == 1);
+    CHECK(!scheduler.shouldRender());
+
+    scheduler.notify(kWakeSwapChain);
+    CHECK(scheduler.shouldRender());
+    ScriptedWaitSet ready;
+    ready.push(kWakeMessage | kWakeSwapChain);
+    CHECK(scheduler.waitForWork(ready) == kWakeMessage);
+    CHECK(ready.calls.size() == 1);
+    CHECK(ready.calls[0].timeoutNs == 0);
+    CHECK((ready.calls[0].sources & kWakeSwapChain) == 0);
+}
+
+// A swap chain that never signals is assumed ready after the timeout.
+void testSwapChainTimeout()
+{
+    RenderScheduler scheduler;
+    scheduler.notify(kWakeFrame);
+    scheduler.rendered(true);
+    scheduler.notify(kWakeOverlay);
+
+    ScriptedWaitSet waitSet;
+    CHECK(scheduler.waitForWork(waitSet) == 0);
+    CHECK(waitSet.calls.size() == 1);
+    CHECK(waitSet.calls[0].timeoutNs == RenderScheduler::kSwapChainTimeoutNs);
+    CHECK(scheduler.shouldRender());
+}
+
+void testNonWaitableSwapChain()
+{
+    RenderScheduler scheduler(false);
+    scheduler.notify(kWakeFrame);
+    scheduler.rendered(true);
+    scheduler.notify(kWakeFrame);
+    CHECK(scheduler.shouldRender());
+    CHECK((scheduler.waitSources() & kWakeSwapChain) == 0);
+
+    // Turning waiting off releases a present already waiting for a slot.
+    RenderScheduler switched;
+    switched.notify(kWakeFrame);
+    switched.rendered(true);
+    switched.notify(kWakeFrame);
+    CHECK(!switched.shouldRender());
+    switched.setSwapChainWaitable(false);
+    CHECK(switched.shouldRender());
+}
+
+// A changing overlay redraws on every swap-chain slot, and stops costing
+// anything once it settles.
+void testContinuousRedraw()
+{
+    RenderScheduler scheduler;
+    scheduler.setContinuousRedraw(true);
+    for (int i = 0; i < 3; ++i)
+    {
+        CHECK(scheduler.hasWork());
+        ScriptedWaitSet waitSet;
+        if (i > 0)
+        {
+            waitSet.push(kWakeSwapChain);
+        }
+        (void)scheduler.waitForWork(waitSet);
+        CHECK(scheduler.shouldRender());
+        scheduler.rendered(true);
+    }
+    scheduler.setContinuousRedraw(false);
+    CHECK(!scheduler.hasWork());
+    CHECK(scheduler.waitSources() == (kWakeFrame | kWakeMessage | kWakeOverlay));
+}
+
+// A hold keeps pending work back until its time, sleeping no longer than
+// that; a newer frame breaks out so the caller can re-plan; rendered() lifts it.
+void testHold()
+{
+    constexpr std::uint64_t kHoldNs = 5'000'000;
+
+    RenderScheduler scheduler;
+    scheduler.notify(kWakeFrame);
+    scheduler.holdUntil(latencyClockNs() + kHoldNs);
+    CHECK(!scheduler.shouldRender());
+
+    ScriptedWaitSet interrupted;
+    interrupted.push(kWakeFrame);
+    CHECK(scheduler.waitForWork(interrupted) == kWakeFrame);
+    CHECK(interrupted.calls.size() == 1);
+    CHECK(interrupted.calls[0].timeoutNs > 0 && interrupted.calls[0].timeoutNs <= kHoldNs);
+    CHECK((interrupted.calls[0].sources & kWakeSwapChain) == 0);
+    CHECK(!scheduler.shouldRender());
+
+    ConditionRenderWaitSet waitSet;
+    const std::uint64_t start = latencyClockNs();
+    scheduler.holdUntil(start + kHoldNs);
+    CHECK(scheduler.waitForWork(waitSet) == 0);
+    CHECK(latencyClockNs() - start >= kHoldNs);
+    CHECK(scheduler.shouldRender());
+
+    scheduler.holdUntil(latencyClockNs() + kHoldNs);
+    scheduler.rendered(false);
+    scheduler.notify(kWakeFrame);
+    CHECK(scheduler.shouldRender());
+}
+
+void testConditionWaitSet()
+{
+    ConditionRenderWaitSet waitSet;
+    CHECK(waitSet.wait(kWakeFrame, 0) == 0);
+    CHECK(waitSet.wait(kWakeFrame, 1'000'000) == 0);
+
+    // Sources outside the wait stay signalled for a later one.
+    waitSet.signal(kWakeFrame | kWakeOverlay);
+    CHECK(waitSet.wait(kWakeFrame | kWakeMessage, 0) == kWakeFrame);
+    CHECK(waitSet.wait(kWakeFrame, 0) == 0);
+    CHECK(waitSet.wait(kWakeOverlay, 0) == kWakeOverlay);
+
+    std::thread signaller([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        waitSet.signal(kWakeSwapChain);
+    });
+    CHECK(waitSet.wait(kWakeSwapChain, kWaitForever) == kWakeSwapChain);
+    signaller.join();
+}
+
+// A producer publishing far faster than a simulated display takes presents:
+// every present is of a frame, none are lost to a missed wake, and the
+// surplus frames are coalesced rather than queued.
+void testProducerFasterThanDisplay()
+{
+    constexpr int kFrames = 5000;
+    constexpr int kPresents = 20;
+
+    ConditionRenderWaitSet waitSet;
+    RenderScheduler scheduler;
+    std::atomic<int> published{0};
+    std::atomic<bool> stop{false};
+
+    std::thread producer([&]() {
+        for (int i = 0; i < kFrames && !stop.load(); ++i)
+        {
+            published.fetch_add(1);
+            waitSet.signal(kWakeFrame);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    std::thread display;
+
+    int presents = 0;
+    int lastSeen = 0;
+    bool framesAdvanced = true;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (presents < kPresents && std::chrono::steady_clock::now() < deadline)
+    {
+        (void)scheduler.waitForWork(waitSet);
+        if (!scheduler.shouldRender())
+        {
+            continue;
+        }
+        const int frame = published.load();
+        framesAdvanced &= frame > lastSeen;
+        lastSeen = frame;
+        scheduler.rendered(true);
+        ++presents;
+        if (display.joinable())
+        {
+            display.join();
+        }
+        display = std::thread([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            waitSet.signal(kWakeSwapChain);
+        });
+    }
+    stop.store(true);
+    producer.join();
+    if (display.joinable())
+    {
+        display.join();
+    }
+
+    CHECK(presents == kPresents);
+    CHECK(framesAdvanced);
+    CHECK(lastSeen < kFrames);
+}
+
+} // namespace
+
+int main()
+{
+    testIdleWaitsForever();
+    testFramesCoalesceUntilSwapChainReady();
+    testMessagesAreNeverStarved();
+    testSwapChainTimeout();
+    testNonWaitableSwapChain();
+    testContinuousRedraw();
+    testHold();
+    testConditionWaitSet();
+    testProducerFasterThanDisplay();
+    return testExitCode();
+}
@@ -0,0 +1,310 @@
+#include "ScalingFilter.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+constexpr ScalingTier kTiers[] = {ScalingTier::Scalar, ScalingTier::SSE2, ScalingTier::AVX2};
+constexpr ScalingFilter kSeparable[] = {ScalingFilter::Nearest, ScalingFilter::Bicubic, ScalingFilter::Lanczos3};
+
+struct Case {
+    std::uint32_t sourceWidth;
+    std::uint32_t sourceHeight;
+    std::uint32_t outputWidth;
+    std::uint32_t outputHeight;
+};
+
+// Up and down, odd ratios, a single texel, and rows narrower than a tap window.
+constexpr Case kCases[] = {
+    {37, 23, 64, 50}, {37, 23, 30, 20}, {3, 5, 17, 9}, {1, 1, 4, 4}, {64, 40, 160, 100}, {261, 9, 400, 13}, {96, 54, 128, 72},
+};
+
+std::vector<std::uint8_t> noise(std::size_t bytes, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> data(bytes);
+    for (auto& byte : data)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(seed >> 24);
+    }
+    return data;
+}
+
+double catmullRom(double x)
+{
+    x = std::abs(x);
+    if (x < 1.0)
+    {
+        return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+    }
+    if (x < 2.0)
+    {
+        return -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0;
+    }
+    return 0.0;
+}
+
+double lanczos3(double x)
+{
+    x = std::abs(x);
+    if (x < 1e-9)
+    {
+        return 1.0;
+    }
+    if (x >= 3.0)
+    {
+        return 0.0;
+    }
+    const double pi = 3.14159265358979323846 * x;
+    return 3.0 * std::sin(pi) * std::sin(pi / 3.0) / (pi * pi);
+}
+
+// What the pixel shaders compute, in double precision: taps around the
+// texel coordinate (i + 0.5) * size / extent - 0.5, normalised, with edge
+// texels repeated.
+std::uint8_t shaderReference(ScalingFilter filter, const std::vector<std::uint8_t>& texture, const Case& c, std::uint32_t x,
+                             std::uint32_t y, int channel)
+{
+    const auto texel = [&](int u, int v) {
+        u = std::clamp(u, 0, static_cast<int>(c.sourceWidth) - 1);
+        v = std::clamp(v, 0, static_cast<int>(c.sourceHeight) - 1);
+        return static_cast<double>(texture[(static_cast<std::size_t>(v) * c.sourceWidth + static_cast<std::size_t>(u)) * 4 + channel]);
+    };
+    const double u = (x + 0.5) * c.sourceWidth / c.outputWidth;
+    const double v = (y + 0.5) * c.sourceHeight / c.outputHeight;
+    if (filter == ScalingFilter::Nearest)
+    {
+        return static_cast<std::uint8_t>(texel(static_cast<int>(std::floor(u)), static_cast<int>(std::floor(v))));
+    }
+
+    const int taps = filter == ScalingFilter::Lanczos3 ? 6 : 4;
+    const int offset = taps / 2 - 1;
+    const double baseU = std::floor(u - 0.5);
+    const double baseV = std::floor(v - 0.5);
+    double weightsU[6];
+    double weightsV[6];
+    double sumU = 0.0;
+    double sumV = 0.0;
+    for (int i = 0; i < taps; ++i)
+    {
+        const double du = i - offset - (u - 0.5 - baseU);
+        const double dv = i - offset - (v - 0.5 - baseV);
+        weightsU[i] = filter == ScalingFilter::Lanczos3 ? lanczos3(du) : catmullRom(du);
+        weightsV[i] = filter == ScalingFilter::Lanczos3 ? lanczos3(dv) : catmullRom(dv);
+        sumU += weightsU[i];
+        sumV += weightsV[i];
+    }
+    double value = 0.0;
+    for (int j = 0; j < taps; ++j)
+    {
+        for (int i = 0; i < taps; ++i)
+        {
+            value += weightsU[i] * weightsV[j] * texel(static_cast<int>(baseU) - offset + i, static_cast<int>(baseV) - offset + j);
+        }
+    }
+    return static_cast<std::uint8_t>(std::lround(std::clamp(value / (sumU * sumV), 0.0, 255.0)));
+}
+
+// The sharpen shader's first pass in double precision.
+std::uint8_t sharpenReference(const std::vector<std::uint8_t>& texture, std::uint32_t width, std::uint32_t height, std::uint32_t x,
+                              std::uint32_t y, int channel)
+{
+    const auto texel = [&](std::int64_t u, std::int64_t v) {
+        u = std::clamp<std::int64_t>(u, 0, width - 1);
+        v = std::clamp<std::int64_t>(v, 0, height - 1);
+        return static_cast<double>(texture[(static_cast<std::size_t>(v) * width + static_cast<std::size_t>(u)) * 4 + channel]);
+    };
+    const double c = texel(x, y);
+    const double n = texel(x, static_cast<std::int64_t>(y) - 1);
+    const double s = texel(x, y + 1);
+    const double e = texel(x + 1, y);
+    const double w = texel(static_cast<std::int64_t>(x) - 1, y);
+    const double low = std::min({c, n, s, e, w});
+    const double high = std::max({c, n, s, e, w});
+    const double headroom = std::clamp(std::min(low, 255.0 - high) / std::max(high, 1.0), 0.0, 1.0);
+    const double weight = std::sqrt(headroom) * kSharpenPeak;
+    const double value = (c + weight * (n + s + e + w)) / (1.0 + 4.0 * weight);
+    return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.0, 255.0)));
+}
+
+// Scalar kernels against the shader model, and every tier against the scalar
+// one bit for bit, for whole viewports and for a region off the origin.
+void testSeparableFilters()
+{
+    for (const ScalingFilter filter : kSeparable)
+    {
+        for (const Case& c : kCases)
+        {
+            const std::vector<std::uint8_t> source = noise(static_cast<std::size_t>(c.sourceWidth) * c.sourceHeight * 4, c.sourceWidth * 7 + c.outputWidth);
+            const FilterScaler scaler(filter, c.sourceWidth, c.sourceHeight, c.outputWidth, c.outputHeight);
+            const std::size_t pitch = static_cast<std::size_t>(c.outputWidth) * 4;
+            const DirtyRect whole{0, 0, c.outputWidth, c.outputHeight};
+            ScalingScratch scratch;
+
+            std::vector<std::uint8_t> expected(pitch * c.outputHeight);
+            CHECK(scaler.scaleRegionWith(ScalingTier::Scalar, expected.data(), pitch, whole, source.data(), c.sourceWidth * 4, scratch));
+            int worst = 0;
+            for (std::uint32_t y = 0; y < c.outputHeight; ++y)
+            {
+                for (std::uint32_t x = 0; x < c.outputWidth; ++x)
+                {
+                    for (int channel = 0; channel < 4; ++channel)
+                    {
+                        worst = std::max(worst, std::abs(expected[y * pitch + x * 4 + channel] - shaderReference(filter, source, c, x, y, channel)));
+                    }
+                }
+            }
+            // Q14 taps and Q6 intermediate rows; Nearest copies texels.
+            if (!CHECK(worst <= (filter == ScalingFilter::Nearest ? 0 : 1)))
+            {
+                std::fprintf(stderr, "  %s %ux%u -> %ux%u: %d steps off\n", scalingFilterName(filter), c.sourceWidth, c.sourceHeight,
+                             c.outputWidth, c.outputHeight, worst);
+            }
+
+            const DirtyRect region{c.outputWidth / 3, c.outputHeight / 4, c.outputWidth - 1, c.outputHeight};
+            for (const ScalingTier tier : kTiers)
+            {
+                std::vector<std::uint8_t> actual(expected.size());
+                if (!scaler.scaleRegionWith(tier, actual.data(), pitch, whole, source.data(), c.sourceWidth * 4, scratch))
+                {
+                    continue;
+                }
+                bool matches = actual == expected;
+                if (region.right > region.left)
+                {
+                    std::vector<std::uint8_t> partial(expected.size(), 7);
+                    scaler.scaleRegionWith(tier, partial.data(), pitch, region, source.data(), c.sourceWidth * 4, scratch);
+                    const std::size_t bytes = static_cast<std::size_t>(region.right - region.left) * 4;
+                    for (std::uint32_t y = region.top; y < region.bottom; ++y)
+                    {
+                        matches &= std::equal(partial.begin() + static_cast<std::ptrdiff_t>((y - region.top) * pitch),
+                                              partial.begin() + static_cast<std::ptrdiff_t>((y - region.top) * pitch + bytes),
+                                              expected.begin() + static_cast<std::ptrdiff_t>(y * pitch + region.left * 4));
+                    }
+                }
+                if (!CHECK(matches))
+                {
+                    std::fprintf(stderr, "  %s %s %ux%u -> %ux%u\n", scalingFilterName(filter), scalingTierName(tier), c.sourceWidth,
+                                 c.sourceHeight, c.outputWidth, c.outputHeight);
+                }
+            }
+        }
+    }
+}
+
+// Taps sum to one, so flat areas stay flat, ringing and all.
+void testFlatStaysFlat()
+{
+    for (const ScalingFilter filter : kSeparable)
+    {
+        for (const Case& c : kCases)
+        {
+            std::vector<std::uint8_t> source(static_cast<std::size_t>(c.sourceWidth) * c.sourceHeight * 4);
+            for (std::size_t i = 0; i < source.size(); ++i)
+            {
+                source[i] = static_cast<std::uint8_t>(i % 4 == 3 ? 255 : 17 + 80 * (i % 4));
+            }
+            const FilterScaler scaler(filter, c.sourceWidth, c.sourceHeight, c.outputWidth, c.outputHeight);
+            std::vector<std::uint8_t> out(static_cast<std::size_t>(c.outputWidth) * c.outputHeight * 4);
+            ScalingScratch scratch;
+            scaler.scaleRegion(out.data(), c.outputWidth * 4, DirtyRect{0, 0, c.outputWidth, c.outputHeight}, source.data(), c.sourceWidth * 4,
+                               scratch);
+            bool flat = true;
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                flat &= out[i] == source[i % 4];
+            }
+            CHECK(flat);
+        }
+    }
+}
+
+// At a whole-number ratio Nearest turns every texel into an exact square
+// block, which is what keeps small text crisp.
+void testNearestIntegerBlocks()
+{
+    constexpr std::uint32_t kWidth = 13;
+    constexpr std::uint32_t kHeight = 7;
+    constexpr std::uint32_t kScale = 3;
+    const std::vector<std::uint8_t> source = noise(kWidth * kHeight * 4, 5);
+    const FilterScaler scaler(ScalingFilter::Nearest, kWidth, kHeight, kWidth * kScale, kHeight * kScale);
+    std::vector<std::uint32_t> out(kWidth * kScale * kHeight * kScale);
+    ScalingScratch scratch;
+    scaler.scaleRegion(reinterpret_cast<std::uint8_t*>(out.data()), kWidth * kScale * 4,
+                       DirtyRect{0, 0, kWidth * kScale, kHeight * kScale}, source.data(), kWidth * 4, scratch);
+    const auto* texels = reinterpret_cast<const std::uint32_t*>(source.data());
+    bool blocks = true;
+    for (std::uint32_t y = 0; y < kHeight * kScale; ++y)
+    {
+        for (std::uint32_t x = 0; x < kWidth * kScale; ++x)
+        {
+            blocks &= out[y * kWidth * kScale + x] == texels[(y / kScale) * kWidth + x / kScale];
+        }
+    }
+    CHECK(blocks);
+}
+
+void testSharpen()
+{
+    const std::uint32_t sizes[][2] = {{1, 1}, {2, 3}, {3, 2}, {37, 23}, {261, 9}};
+    for (const auto& size : sizes)
+    {
+        const std::uint32_t width = size[0];
+        const std::uint32_t height = size[1];
+        const std::vector<std::uint8_t> source = noise(static_cast<std::size_t>(width) * height * 4, width + height);
+        std::vector<std::uint8_t> expected(source.size());
+        CHECK(sharpenTextureWith(ScalingTier::Scalar, expected.data(), width * 4, source.data(), width * 4, width, height));
+        int worst = 0;
+        for (std::uint32_t y = 0; y < height; ++y)
+        {
+            for (std::uint32_t x = 0; x < width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    worst = std::max(worst, std::abs(expected[(y * width + x) * 4 + channel] - sharpenReference(source, width, height, x, y, channel)));
+                }
+            }
+        }
+        if (!CHECK(worst <= 1))
+        {
+            std::fprintf(stderr, "  sharpen %ux%u: %d steps off\n", width, height, worst);
+        }
+        for (const ScalingTier tier : kTiers)
+        {
+            std::vector<std::uint8_t> actual(source.size());
+            if (sharpenTextureWith(tier, actual.data(), width * 4, source.data(), width * 4, width, height) && !CHECK(actual == expected))
+            {
+                std::fprintf(stderr, "  sharpen %s %ux%u\n", scalingTierName(tier), width, height);
+            }
+        }
+    }
+
+    // A soft grey edge gains contrast on both sides; flat grey is untouched.
+    constexpr std::uint32_t kWidth = 8;
+    std::vector<std::uint8_t> edge(kWidth * 4);
+    for (std::uint32_t x = 0; x < kWidth; ++x)
+    {
+        std::fill_n(edge.begin() + x * 4, 4, static_cast<std::uint8_t>(x < kWidth / 2 ? 100 : 140));
+    }
+    std::vector<std::uint8_t> sharpened(edge.size());
+    sharpenTexture(sharpened.data(), kWidth * 4, edge.data(), kWidth * 4, kWidth, 1);
+    CHECK(sharpened[(kWidth / 2 - 1) * 4] < 100 && sharpened[(kWidth / 2) * 4] > 140);
+    CHECK(sharpened[0] == 100 && sharpened[(kWidth - 1) * 4] == 140);
+}
+
+} // namespace
+
+int main()
+{
+    testSeparableFilters();
+    testFlatStaysFlat();
+    testNearestIntegerBlocks();
+    testSharpen();
+    return testExitCode();
+}
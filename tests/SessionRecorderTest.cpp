@@ -0,0 +1,263 @@
+#include "DirtyTracker.hpp"
+#include "FrameSink.hpp"
+#include "SessionRecorder.hpp"
+#include "TestSupport.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// A BGRA frame the test edits between writes, with alpha left as capture
+// would: anything.
+class Screen {
+public:
+    Screen(std::uint32_t width, std::uint32_t height) : width_(width), height_(height), pixels_(static_cast<std::size_t>(width) * 4 * height)
+    {
+        std::uint32_t seed = 7;
+        for (std::size_t i = 0; i < pixels_.size(); ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            // Desktop-like: mostly flat with some texture.
+            pixels_[i] = (i / 4) % 23 < 3 ? static_cast<std::uint8_t>(seed >> 24) : static_cast<std::uint8_t>(i % 4 == 3 ? seed >> 16 : 0x30);
+        }
+    }
+
+    void fill(std::uint32_t left, std::uint32_t top, std::uint32_t width, std::uint32_t height, std::uint8_t value)
+    {
+        for (std::uint32_t y = top; y < top + height; ++y)
+        {
+            for (std::uint32_t x = left; x < left + width; ++x)
+            {
+                std::uint8_t* pixel = &pixels_[(static_cast<std::size_t>(y) * width_ + x) * 4];
+                pixel[0] = value;
+                pixel[1] = static_cast<std::uint8_t>(value ^ 0x5A);
+                pixel[2] = static_cast<std::uint8_t>(value + y);
+            }
+        }
+    }
+
+    void scrambleAlpha()
+    {
+        for (std::size_t i = 3; i < pixels_.size(); i += 4)
+        {
+            pixels_[i] = static_cast<std::uint8_t>(pixels_[i] * 13 + 101);
+        }
+    }
+
+    [[nodiscard]] DirectShowCapture::Frame frame(std::uint64_t timestamp) const
+    {
+        DirectShowCapture::Frame frame{};
+        frame.data = pixels_.data();
+        frame.dataSize = pixels_.size();
+        frame.width = width_;
+        frame.height = height_;
+        frame.stride = width_ * 4;
+        frame.sampleWidth = width_;
+        frame.sampleHeight = height_;
+        frame.contentRight = width_;
+        frame.contentBottom = height_;
+        frame.timestamp100ns = timestamp;
+        return frame;
+    }
+
+    // Whether `recorded` shows this screen, ignoring alpha.
+    [[nodiscard]] bool shownBy(const RecordedFrame& recorded) const
+    {
+        if (recorded.width != width_ || recorded.height != height_ || recorded.pixels.size() != pixels_.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < pixels_.size(); ++i)
+        {
+            if (i % 4 != 3 && recorded.pixels[i] != pixels_[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::uint32_t width_;
+    std::uint32_t height_;
+    std::vector<std::uint8_t> pixels_;
+};
+
+bool waitForEncoder(const SessionRecorder& recorder, std::uint64_t recorded)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (recorder.stats().framesRecorded < recorded)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+std::filesystem::path recordingPath(const char* name)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "pckvm-recorder-test";
+    std::filesystem::create_directories(directory);
+    return directory / name;
+}
+
+// Every frame comes back as written, tile edges that do not fill a tile
+// included, and a change to alpha alone marks no tiles.
+void testRoundTrip()
+{
+    // Not a multiple of the tile size either way.
+    constexpr std::uint32_t kWidth = 200;
+    constexpr std::uint32_t kHeight = 130;
+    const std::filesystem::path path = recordingPath("round-trip.pkvmrec");
+
+    Screen screen(kWidth, kHeight);
+    std::vector<Screen> written;
+    std::vector<std::uint64_t> recordBytes;
+    DirtyTracker tracker;
+    StripeWorkerPool workers(2);
+    SessionRecorder recorder;
+    CHECK(recorder.start(path));
+
+    const auto write = [&](std::uint64_t timestamp) {
+        const DirectShowCapture::Frame frame = screen.frame(timestamp);
+        FrameWriteOptions options;
+        options.tracker = &tracker;
+        options.sequence = tracker.analyze(frame);
+        options.workers = &workers;
+        const std::uint64_t before = recorder.stats().fileBytes;
+        CHECK(writeFrameToSink(frame, recorder, options).accepted);
+        written.push_back(screen);
+        CHECK(waitForEncoder(recorder, written.size()));
+        recordBytes.push_back(recorder.stats().fileBytes - before);
+    };
+
+    write(1);
+    screen.fill(10, 10, 16, 24, 0xFF);
+    write(2);
+    screen.fill(150, 100, 50, 30, 0x80);
+    write(3);
+    screen.scrambleAlpha();
+    write(4);
+    screen.fill(63, 63, 2, 2, 0x01);
+    write(5);
+    screen.fill(0, 0, kWidth, kHeight, 0x42);
+    write(6);
+
+    const SessionRecorderStats stats = recorder.stop();
+    CHECK(stats.framesRecorded == written.size());
+    CHECK(stats.framesDropped == 0);
+    CHECK(stats.keyFrames == 1);
+    // A frame record with an empty tile mask: header, fields and the mask.
+    constexpr std::uint32_t kTiles = ((kWidth + kRecordTileSize - 1) / kRecordTileSize) * ((kHeight + kRecordTileSize - 1) / kRecordTileSize);
+    CHECK(recordBytes[3] == 8 + 40 + (kTiles + 7) / 8);
+
+    RecordingReader reader;
+    CHECK(reader.open(path));
+    RecordedFrame frame;
+    std::size_t read = 0;
+    while (reader.next(frame))
+    {
+        if (!CHECK(read < written.size()))
+        {
+            break;
+        }
+        CHECK(frame.index == read);
+        CHECK(frame.timestamp100ns == read + 1);
+        CHECK((frame.flags & kRecordKeyFrame) == (read == 0 ? kRecordKeyFrame : 0));
+        CHECK(written[read].shownBy(frame));
+        ++read;
+    }
+    CHECK(reader.error().empty());
+    CHECK(read == written.size());
+    CHECK(reader.finished());
+    CHECK(reader.framesRecorded() == written.size());
+    std::filesystem::remove(path);
+}
+
+// Frames written faster than the encoder keeps up with are dropped and
+// counted. Once the screen stops changing, writing the unchanged frame while
+// missedFrame() holds, as the capture path does, still gets the final screen
+// into the recording.
+void testDropRecovery()
+{
+    constexpr std::uint32_t kWidth = 1280;
+    constexpr std::uint32_t kHeight = 720;
+    constexpr int kFrames = 60;
+    const std::filesystem::path path = recordingPath("drops.pkvmrec");
+
+    Screen screen(kWidth, kHeight);
+    DirtyTracker tracker;
+    StripeWorkerPool workers(2);
+    SessionRecorder recorder;
+    CHECK(recorder.start(path));
+
+    std::uint64_t timestamp = 0;
+    const auto write = [&]() {
+        const DirectShowCapture::Frame frame = screen.frame(++timestamp);
+        FrameWriteOptions options;
+        options.tracker = &tracker;
+        options.sequence = tracker.analyze(frame);
+        options.workers = &workers;
+        return writeFrameToSink(frame, recorder, options).accepted;
+    };
+
+    for (int i = 0; i < kFrames; ++i)
+    {
+        screen.fill(static_cast<std::uint32_t>(i * 17) % (kWidth - 300), static_cast<std::uint32_t>(i * 11) % (kHeight - 200), 300, 200,
+                    static_cast<std::uint8_t>(i * 37));
+        (void)write();
+    }
+    const std::uint64_t dropped = recorder.stats().framesDropped;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (recorder.missedFrame() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        (void)write();
+    }
+    CHECK(!recorder.missedFrame());
+
+    const SessionRecorderStats stats = recorder.stop();
+    CHECK(stats.framesRecorded >= 2);
+    CHECK(stats.framesDropped >= dropped);
+    std::printf("%llu of %d frames dropped\n", static_cast<unsigned long long>(dropped), kFrames);
+
+    RecordingReader reader;
+    CHECK(reader.open(path));
+    RecordedFrame frame;
+    RecordedFrame last;
+    std::uint64_t read = 0;
+    std::uint64_t droppedBefore = 0;
+    while (reader.next(frame))
+    {
+        ++read;
+        droppedBefore += frame.droppedBefore;
+        std::swap(last, frame);
+    }
+    CHECK(reader.error().empty());
+    CHECK(reader.finished());
+    CHECK(read == stats.framesRecorded);
+    CHECK(reader.framesRecorded() == stats.framesRecorded);
+    CHECK(reader.framesDropped() == stats.framesDropped);
+    CHECK(droppedBefore == stats.framesDropped);
+    CHECK(screen.shownBy(last));
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testDropRecovery();
+    return testExitCode();
+}
@@ -0,0 +1,93 @@
+#include "DirtyTracker.hpp"
+#include "MemoryFrameSink.hpp"
+#include "StripeWorkerPool.hpp"
+#include "TestPatternCapture.hpp"
+#include "TestSupport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void testEveryStripeRunsOnce()
+{
+    for (const std::size_t workers : {0u, 1u, 3u, 7u})
+    {
+        StripeWorkerPool pool(workers);
+        CHECK(pool.concurrency() == workers + 1);
+        for (const std::size_t stripes : {0u, 1u, 2u, 5u, 64u})
+        {
+            std::vector<std::atomic<int>> hits(stripes);
+            for (int round = 0; round < 50; ++round)
+            {
+                pool.run(stripes, [&](std::size_t stripe) { hits[stripe].fetch_add(1, std::memory_order_relaxed); });
+            }
+            bool once = true;
+            for (const auto& hit : hits)
+            {
+                once &= hit.load() == 50;
+            }
+            CHECK(once);
+        }
+    }
+}
+
+// Striped, flipped writes of large frames are byte-identical to the single
+// threaded ones, tracked or not.
+void testStripedWritesMatchSingleThreaded()
+{
+    TestPatternCapture::Config config;
+    config.width = 3840;
+    config.height = 2160;
+    config.bottomUp = true;
+    config.motion = TestPatternCapture::Motion::MovingBox;
+    config.paced = false;
+    config.frameLimit = 12;
+    TestPatternCapture capture(config);
+
+    StripeWorkerPool workers(3);
+    FramePool pool;
+    MemoryFrameSink striped(pool);
+    MemoryFrameSink single(pool);
+    DirtyTracker tracker;
+    std::uint64_t mismatches = 0;
+    capture.start(
+        [&](const DirectShowCapture::Frame& frame) {
+            FrameWriteOptions options;
+            options.tracker = &tracker;
+            options.sequence = tracker.analyze(frame);
+            options.workers = &workers;
+            const FrameWriteResult stripedResult = writeFrameToSink(frame, striped, options);
+            const FrameWriteResult singleResult = writeFrameToSink(frame, single);
+            const CpuFrame* a = striped.acquireLatest();
+            const CpuFrame* b = single.acquireLatest();
+            if (!stripedResult.accepted || !singleResult.accepted || !a || !b ||
+                std::memcmp(a->data.data(), b->data.data(), b->data.size()) != 0)
+            {
+                ++mismatches;
+            }
+        },
+        {});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (capture.framesDelivered() < config.frameLimit && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    CHECK(capture.framesDelivered() == config.frameLimit);
+    CHECK(mismatches == 0);
+}
+
+} // namespace
+
+int main()
+{
+    testEveryStripeRunsOnce();
+    testStripedWritesMatchSingleThreaded();
+    return testExitCode();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks for the headless tests. A failed check is reported and the test keeps
+// going, so one run shows every failure; main() returns testExitCode().
+inline int& testFailureCount()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline bool testCheck(bool passed, const char* expression, const char* file, int line)
+{
+    if (!passed)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++testFailureCount();
+    }
+    return passed;
+}
+
+#define CHECK(expression) testCheck(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+inline int testExitCode()
+{
+    if (testFailureCount() != 0)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", testFailureCount());
+        return 1;
+    }
+    return 0;
+}
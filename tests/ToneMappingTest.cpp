@@ -0,0 +1,262 @@
+#include "MemoryFrameSink.hpp"
+#include "ToneMapping.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+using PixelFormat = CaptureSource::PixelFormat;
+using TransferFunction = CaptureSource::TransferFunction;
+
+constexpr ConversionTier kTiers[] = {ConversionTier::Scalar, ConversionTier::SSSE3, ConversionTier::AVX2};
+constexpr ToneMapCurve kCurves[] = {ToneMapCurve::Reinhard, ToneMapCurve::Hable, ToneMapCurve::Clip};
+constexpr std::size_t kRowLengths[] = {1, 2, 3, 7, 8, 9, 15, 16, 17, 33, 1001};
+// The tables quantise PQ code values, the curve gain and the output gamma;
+// against exact arithmetic a channel may be this many 8-bit steps off.
+constexpr int kTolerance = 3;
+
+std::uint32_t nextRandom(std::uint32_t& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 16;
+}
+
+// A P010 row of limited-range 10-bit samples, MSB-aligned.
+std::vector<std::uint8_t> p010Row(std::size_t samples, std::uint32_t seed, unsigned low, unsigned high)
+{
+    std::vector<std::uint8_t> row(samples * 2);
+    for (std::size_t i = 0; i < samples; ++i)
+    {
+        const unsigned value = (low + nextRandom(seed) % (high - low + 1)) << 6;
+        row[i * 2] = static_cast<std::uint8_t>(value);
+        row[i * 2 + 1] = static_cast<std::uint8_t>(value >> 8);
+    }
+    return row;
+}
+
+unsigned sample(const std::vector<std::uint8_t>& row, std::size_t index)
+{
+    return (row[index * 2] | (row[index * 2 + 1] << 8)) >> 6;
+}
+
+double pqToNits(double code)
+{
+    const double m1 = 2610.0 / 16384.0;
+    const double m2 = 2523.0 / 4096.0 * 128.0;
+    const double c1 = 3424.0 / 4096.0;
+    const double c2 = 2413.0 / 4096.0 * 32.0;
+    const double c3 = 2392.0 / 4096.0 * 32.0;
+    const double p = std::pow(std::clamp(code, 0.0, 1.0), 1.0 / m2);
+    return 10000.0 * std::pow(std::max(p - c1, 0.0) / (c2 - c3 * p), 1.0 / m1);
+}
+
+double hable(double x)
+{
+    return (x * (0.15 * x + 0.05) + 0.004) / (x * (0.15 * x + 0.5) + 0.06) - 0.02 / 0.3;
+}
+
+// Every step of ToneMapper in double precision, without tables: BT.2020
+// limited-range YCbCr -> PQ -> nits -> curve on the brightest channel ->
+// BT.709 primaries -> desaturate into gamut -> gamma 2.2.
+void referenceBgr(unsigned y, unsigned cb, unsigned cr, const ToneMapParams& params, int bgr[3])
+{
+    const double kr = 0.2627;
+    const double kb = 0.0593;
+    const double kg = 1.0 - kr - kb;
+    const double luma = (static_cast<double>(y) - 64.0) / 876.0;
+    const double u = (static_cast<double>(cb) - 512.0) / 896.0;
+    const double v = (static_cast<double>(cr) - 512.0) / 896.0;
+    const double code[3] = {luma + 2.0 * (1.0 - kr) * v,
+                            luma - 2.0 * kb * (1.0 - kb) / kg * u - 2.0 * kr * (1.0 - kr) / kg * v,
+                            luma + 2.0 * (1.0 - kb) * u};
+
+    const double peak = params.peakNits / params.whiteNits;
+    const double brightest = pqToNits(std::max({code[0], code[1], code[2]})) / params.whiteNits;
+    double mapped = std::min(brightest, 1.0);
+    if (params.curve == ToneMapCurve::Reinhard)
+    {
+        mapped = std::min(brightest * (1.0 + brightest / (peak * peak)) / (1.0 + brightest), 1.0);
+    }
+    else if (params.curve == ToneMapCurve::Hable)
+    {
+        mapped = std::min(hable(brightest) / hable(peak), 1.0);
+    }
+    const double gain = brightest > 0.0 ? mapped / brightest : 1.0;
+
+    double linear[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        linear[i] = pqToNits(code[i]) / params.whiteNits * gain;
+    }
+    double rgb[3] = {1.6605 * linear[0] - 0.5876 * linear[1] - 0.0728 * linear[2],
+                     -0.1246 * linear[0] + 1.1329 * linear[1] - 0.0083 * linear[2],
+                     -0.0182 * linear[0] - 0.1006 * linear[1] + 1.1187 * linear[2]};
+    const double grey = std::max(0.2126 * rgb[0] + 0.7152 * rgb[1] + 0.0722 * rgb[2], 0.0);
+    const double lowest = std::min({rgb[0], rgb[1], rgb[2]});
+    if (lowest < 0.0)
+    {
+        for (double& channel : rgb)
+        {
+            channel = grey + (channel - grey) * grey / (grey - lowest);
+        }
+    }
+    const double highest = std::max({rgb[0], rgb[1], rgb[2]});
+    for (int i = 0; i < 3; ++i)
+    {
+        const double channel = std::clamp(highest > 1.0 ? rgb[i] / highest : rgb[i], 0.0, 1.0);
+        bgr[2 - i] = static_cast<int>(std::lround(255.0 * std::pow(channel, 1.0 / 2.2)));
+    }
+}
+
+void testAgainstReference()
+{
+    const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT2020, false);
+    for (const ToneMapCurve curve : kCurves)
+    {
+        for (const float peakNits : {400.0f, 1000.0f, 4000.0f})
+        {
+            ToneMapParams params;
+            params.curve = curve;
+            params.peakNits = peakNits;
+            const ToneMapper mapper(params);
+            for (const std::size_t pixels : kRowLengths)
+            {
+                const std::size_t samples = (pixels + 1) / 2 * 2;
+                const auto seed = static_cast<std::uint32_t>(pixels * 13 + static_cast<std::size_t>(peakNits));
+                const std::vector<std::uint8_t> luma = p010Row(samples, seed, 64, 940);
+                const std::vector<std::uint8_t> chroma = p010Row(samples, seed + 1, 64, 960);
+
+                std::vector<std::uint8_t> expected(pixels * 4 + 16, 0xEE);
+                CHECK(mapper.convertRowWith(ConversionTier::Scalar, expected.data(), luma.data(), chroma.data(), pixels, coefficients));
+                bool accurate = std::all_of(expected.begin() + static_cast<std::ptrdiff_t>(pixels * 4), expected.end(),
+                                            [](std::uint8_t b) { return b == 0xEE; });
+                int worst = 0;
+                for (std::size_t x = 0; x < pixels; ++x)
+                {
+                    int bgr[3];
+                    referenceBgr(sample(luma, x), sample(chroma, x / 2 * 2), sample(chroma, x / 2 * 2 + 1), params, bgr);
+                    const std::uint8_t* pixel = expected.data() + x * 4;
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        worst = std::max(worst, std::abs(pixel[c] - bgr[c]));
+                    }
+                    accurate &= pixel[3] == 255;
+                }
+                if (!CHECK(accurate && worst <= kTolerance))
+                {
+                    std::fprintf(stderr, "  %s, peak %.0f, %zu pixels: %d steps off\n", toneMapCurveName(curve), peakNits, pixels, worst);
+                }
+
+                // Every other tier matches the scalar one bit for bit.
+                for (const ConversionTier tier : kTiers)
+                {
+                    if (tier == ConversionTier::Scalar)
+                    {
+                        continue;
+                    }
+                    std::vector<std::uint8_t> actual(pixels * 4 + 16, 0xEE);
+                    if (!mapper.convertRowWith(tier, actual.data(), luma.data(), chroma.data(), pixels, coefficients))
+                    {
+                        continue;
+                    }
+                    if (!CHECK(actual == expected))
+                    {
+                        std::fprintf(stderr, "  %s %s, %zu pixels\n", toneMapCurveName(curve), conversionTierName(tier), pixels);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Nominal black stays black and reference white (203 nits) reaches SDR white
+// when nothing compresses it.
+void testAnchors()
+{
+    ToneMapParams params;
+    params.curve = ToneMapCurve::Clip;
+    const ToneMapper mapper(params);
+    const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT2020, false);
+
+    // PQ code of 203 nits is 0.5807, 64 + 0.5807 * 876 = 573 in 10 bits.
+    const unsigned values[] = {64, 573};
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+        const unsigned y = values[i] << 6;
+        const unsigned c = 512u << 6;
+        const std::uint8_t luma[] = {static_cast<std::uint8_t>(y), static_cast<std::uint8_t>(y >> 8), static_cast<std::uint8_t>(y),
+                                     static_cast<std::uint8_t>(y >> 8)};
+        const std::uint8_t chroma[] = {static_cast<std::uint8_t>(c), static_cast<std::uint8_t>(c >> 8), static_cast<std::uint8_t>(c),
+                                       static_cast<std::uint8_t>(c >> 8)};
+        std::uint8_t out[8];
+        mapper.convertRow(out, luma, chroma, 2, coefficients);
+        const int expected = i == 0 ? 0 : 255;
+        CHECK(std::abs(out[0] - expected) <= 1 && std::abs(out[1] - expected) <= 1 && std::abs(out[2] - expected) <= 1);
+    }
+}
+
+void testInputMode()
+{
+    DirectShowCapture::Frame frame{};
+    frame.format = PixelFormat::P010;
+    frame.transfer = TransferFunction::PQ;
+    CHECK(resolveTransferFunction(HdrInputMode::Auto, frame) == TransferFunction::PQ);
+    CHECK(resolveTransferFunction(HdrInputMode::Off, frame) == TransferFunction::SDR);
+    frame.transfer = TransferFunction::SDR;
+    CHECK(resolveTransferFunction(HdrInputMode::Auto, frame) == TransferFunction::SDR);
+    CHECK(resolveTransferFunction(HdrInputMode::On, frame) == TransferFunction::PQ);
+    frame.format = PixelFormat::NV12;
+    CHECK(resolveTransferFunction(HdrInputMode::On, frame) == TransferFunction::SDR);
+
+    // Through the frame path: only a PQ frame goes through the tone mapper.
+    constexpr std::uint32_t kWidth = 64;
+    constexpr std::uint32_t kHeight = 4;
+    std::vector<std::uint8_t> bytes = p010Row(static_cast<std::size_t>(kWidth) * kHeight * 3 / 2, 7, 64, 940);
+    frame.format = PixelFormat::P010;
+    frame.matrix = CaptureSource::ColorMatrix::BT2020;
+    frame.width = kWidth;
+    frame.height = kHeight;
+    frame.stride = kWidth * 2;
+    frame.data = bytes.data();
+    frame.dataSize = bytes.size();
+
+    const ToneMapper mapper{ToneMapParams{}};
+    FrameWriteOptions options;
+    options.toneMapper = &mapper;
+    const auto render = [&](TransferFunction transfer) {
+        frame.transfer = transfer;
+        FramePool pool;
+        MemoryFrameSink sink(pool);
+        CHECK(writeFrameToSink(frame, sink, options).accepted);
+        const CpuFrame* written = sink.acquireLatest();
+        return written ? std::vector<std::uint8_t>(written->data.data(), written->data.data() + written->data.size())
+                       : std::vector<std::uint8_t>{};
+    };
+    const std::vector<std::uint8_t> sdr = render(TransferFunction::SDR);
+    const std::vector<std::uint8_t> pq = render(TransferFunction::PQ);
+
+    std::vector<std::uint8_t> plain(kWidth * 4);
+    std::vector<std::uint8_t> mapped(kWidth * 4);
+    const YuvCoefficients coefficients = yuvCoefficients(CaptureSource::ColorMatrix::BT2020, false);
+    semiPlanarKernel(PixelFormat::P010, ConversionTier::Scalar)(plain.data(), bytes.data(), bytes.data() + kWidth * 2 * kHeight, kWidth,
+                                                                coefficients);
+    mapper.convertRow(mapped.data(), bytes.data(), bytes.data() + kWidth * 2 * kHeight, kWidth, coefficients);
+    CHECK(sdr.size() >= plain.size() && std::equal(plain.begin(), plain.end(), sdr.begin()));
+    CHECK(pq.size() >= mapped.size() && std::equal(mapped.begin(), mapped.end(), pq.begin()));
+}
+
+} // namespace
+
+int main()
+{
+    testAgainstReference();
+    testAnchors();
+    testInputMode();
+    return testExitCode();
+}